@@ -45,9 +45,13 @@ void Cconfig::fill_maps(const Cconfig* v)
 		{
 			"announce_interval", &m_announce_interval, 1800,
 			"clean_up_interval", &m_clean_up_interval, 60,
+			"peer_cache_size", &m_peer_cache_size, 200,
+			"peer_cache_ttl", &m_peer_cache_ttl, 30,
 			"read_config_interval", &m_read_config_interval, 60,
 			"read_db_interval", &m_read_db_interval, 60,
 			"scrape_interval", &m_scrape_interval, 0,
+			"shards", &m_shards, 16,
+			"worker_threads", &m_worker_threads, 1,
 			"write_db_interval", &m_write_db_interval, 15,
 			NULL
 		};
@@ -29,9 +29,13 @@ public:
 	bool m_log_scrape;
 	int m_announce_interval;
 	int m_clean_up_interval;
+	int m_peer_cache_size;
+	int m_peer_cache_ttl;
 	int m_read_config_interval;
 	int m_read_db_interval;
 	int m_scrape_interval;
+	int m_shards;
+	int m_worker_threads;
 	int m_write_db_interval;
 	std::string m_column_files_completed;
 	std::string m_column_files_fid;
@@ -125,6 +125,7 @@ void Cconnection::read(const std::string& v)
 #ifndef NDEBUG
 	std::cout << v << std::endl;
 #endif
+	p4p::detail::ScopedSharedLock reload_lock(m_server->reload_mutex());
 	if (m_server->config().m_log_access)
 	{
 		static std::ofstream f("xbt_tracker_raw.log");
@@ -0,0 +1,232 @@
+#include "stdafx.h"
+#include "db_writer.h"
+
+#include <iostream>
+
+/* Droppable writes beyond this many pending statements are dropped */
+const size_t c_queue_limit = 1 << 10;
+
+/* Statements taken off the queue per lock acquisition */
+const int c_batch_size = 64;
+
+Cdb_writer::Cdb_writer()
+{
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_cond, NULL);
+	m_running = false;
+	m_stop = false;
+	m_dropped = 0;
+	m_failed = 0;
+	m_written = 0;
+}
+
+Cdb_writer::~Cdb_writer()
+{
+	stop();
+	pthread_cond_destroy(&m_cond);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+void Cdb_writer::open(const std::string& host, const std::string& user, const std::string& password, const std::string& database)
+{
+	m_database.open(host, user, password, database, true);
+}
+
+void Cdb_writer::set_query_log(const std::string& v)
+{
+	m_database.set_query_log(v);
+}
+
+int Cdb_writer::start()
+{
+	if (m_running)
+		return 0;
+	m_stop = false;
+	if (pthread_create(&m_thread, NULL, threadfunc, this) != 0)
+		return 1;
+	m_running = true;
+	return 0;
+}
+
+void Cdb_writer::stop()
+{
+	if (!m_running)
+		return;
+	pthread_mutex_lock(&m_mutex);
+	m_stop = true;
+	pthread_cond_signal(&m_cond);
+	pthread_mutex_unlock(&m_mutex);
+	if (pthread_join(m_thread, NULL) != 0)
+		std::cerr << "Failed to join database writer thread" << std::endl;
+	m_running = false;
+}
+
+bool Cdb_writer::write(const std::string& q, bool droppable)
+{
+	if (!m_running)
+	{
+		bool written = true;
+		try
+		{
+			query(q);
+		}
+		catch (Cdatabase::exception&)
+		{
+			written = false;
+		}
+		pthread_mutex_lock(&m_mutex);
+		if (written)
+			m_written++;
+		else
+			m_failed++;
+		pthread_mutex_unlock(&m_mutex);
+		return true;
+	}
+	pthread_mutex_lock(&m_mutex);
+	bool queued = !droppable || m_jobs.size() < c_queue_limit;
+	if (queued)
+	{
+		m_jobs.push_back(t_job());
+		m_jobs.back().tag = -1;
+		m_jobs.back().query = q;
+		pthread_cond_signal(&m_cond);
+	}
+	else
+		m_dropped++;
+	pthread_mutex_unlock(&m_mutex);
+	return queued;
+}
+
+void Cdb_writer::read(int tag, const std::string& q)
+{
+	if (!m_running)
+	{
+		try
+		{
+			Csql_result result = query(q);
+			pthread_mutex_lock(&m_mutex);
+			m_results.push_back(t_result(tag, result));
+			pthread_mutex_unlock(&m_mutex);
+		}
+		catch (Cdatabase::exception&)
+		{
+			pthread_mutex_lock(&m_mutex);
+			m_failed++;
+			pthread_mutex_unlock(&m_mutex);
+		}
+		return;
+	}
+	pthread_mutex_lock(&m_mutex);
+	m_jobs.push_back(t_job());
+	m_jobs.back().tag = tag;
+	m_jobs.back().query = q;
+	pthread_cond_signal(&m_cond);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void Cdb_writer::results(t_results& v)
+{
+	pthread_mutex_lock(&m_mutex);
+	v.splice(v.end(), m_results);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+long long Cdb_writer::c_dropped() const
+{
+	pthread_mutex_lock(&m_mutex);
+	long long c = m_dropped;
+	pthread_mutex_unlock(&m_mutex);
+	return c;
+}
+
+long long Cdb_writer::c_failed() const
+{
+	pthread_mutex_lock(&m_mutex);
+	long long c = m_failed;
+	pthread_mutex_unlock(&m_mutex);
+	return c;
+}
+
+long long Cdb_writer::c_written() const
+{
+	pthread_mutex_lock(&m_mutex);
+	long long c = m_written;
+	pthread_mutex_unlock(&m_mutex);
+	return c;
+}
+
+size_t Cdb_writer::c_queued() const
+{
+	pthread_mutex_lock(&m_mutex);
+	size_t c = m_jobs.size();
+	pthread_mutex_unlock(&m_mutex);
+	return c;
+}
+
+Csql_result Cdb_writer::query(const std::string& q)
+{
+	return m_database.query(q);
+}
+
+void* Cdb_writer::threadfunc(void* arg)
+{
+	mysql_thread_init();
+	reinterpret_cast<Cdb_writer*>(arg)->run();
+	mysql_thread_end();
+	return NULL;
+}
+
+void Cdb_writer::run()
+{
+	t_jobs jobs;
+	while (1)
+	{
+		pthread_mutex_lock(&m_mutex);
+		while (m_jobs.empty() && !m_stop)
+			pthread_cond_wait(&m_cond, &m_mutex);
+		if (m_jobs.empty())
+		{
+			pthread_mutex_unlock(&m_mutex);
+			break;
+		}
+		for (int i = 0; i < c_batch_size && !m_jobs.empty(); i++)
+		{
+			jobs.push_back(t_job());
+			jobs.back().tag = m_jobs.front().tag;
+			jobs.back().query.swap(m_jobs.front().query);
+			m_jobs.pop_front();
+		}
+		pthread_mutex_unlock(&m_mutex);
+
+		/* Results are built in a local list and spliced over, so that the
+		 * non-atomic reference count of a result is only ever touched by
+		 * one thread at a time.
+		 */
+		t_results results;
+		int written = 0;
+		int failed = 0;
+		for (; !jobs.empty(); jobs.pop_front())
+		{
+			try
+			{
+				if (jobs.front().tag == -1)
+				{
+					query(jobs.front().query);
+					written++;
+				}
+				else
+					results.push_back(t_result(jobs.front().tag, query(jobs.front().query)));
+			}
+			catch (Cdatabase::exception&)
+			{
+				failed++;
+			}
+		}
+
+		pthread_mutex_lock(&m_mutex);
+		m_results.splice(m_results.end(), results);
+		m_failed += failed;
+		m_written += written;
+		pthread_mutex_unlock(&m_mutex);
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <boost/utility.hpp>
+#include <deque>
+#include <list>
+#include <pthread.h>
+#include <sql/database.h>
+
+/* Runs queries on a dedicated thread with its own connection, so that
+ * database round trips never stall the event loop. Writes are queued as
+ * complete statements; reads are queued with a tag and their results are
+ * handed back through results() for the main thread to apply. Only writes
+ * marked droppable, such as log inserts, are dropped when the queue is full;
+ * the others carry counts that would be lost.
+ */
+class Cdb_writer: boost::noncopyable
+{
+public:
+	typedef std::pair<int, Csql_result> t_result;
+	typedef std::list<t_result> t_results;
+
+	void open(const std::string& host, const std::string& user, const std::string& password, const std::string& database);
+	void set_query_log(const std::string&);
+	int start();
+	void stop();
+	bool write(const std::string&, bool droppable = false);
+	void read(int tag, const std::string&);
+	void results(t_results&);
+	size_t c_queued() const;
+	long long c_dropped() const;
+	long long c_failed() const;
+	long long c_written() const;
+	Cdb_writer();
+	virtual ~Cdb_writer();
+
+	bool running() const
+	{
+		return m_running;
+	}
+protected:
+	/* Runs one statement; overridden by tests to stand in for the database */
+	virtual Csql_result query(const std::string&);
+private:
+	struct t_job
+	{
+		int tag;
+		std::string query;
+	};
+
+	typedef std::deque<t_job> t_jobs;
+
+	static void* threadfunc(void*);
+	void run();
+
+	Cdatabase m_database;
+	t_jobs m_jobs;
+	t_results m_results;
+	mutable pthread_mutex_t m_mutex;
+	pthread_cond_t m_cond;
+	pthread_t m_thread;
+	bool m_running;
+	bool m_stop;
+	long long m_dropped;
+	long long m_failed;
+	long long m_written;
+};
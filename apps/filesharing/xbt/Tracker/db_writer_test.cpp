@@ -0,0 +1,140 @@
+#include "stdafx.h"
+#include "db_writer.h"
+
+#define BOOST_TEST_MAIN
+#include <boost/test/included/unit_test.hpp>
+
+/* Stands in for the database: statements starting with "fail" throw, and
+ * every statement waits while the backend is held.
+ */
+class Cstub_db_writer: public Cdb_writer
+{
+public:
+	Cstub_db_writer()
+	{
+		pthread_mutex_init(&m_stub_mutex, NULL);
+		pthread_cond_init(&m_stub_cond, NULL);
+		m_held = false;
+		m_entered = 0;
+	}
+
+	~Cstub_db_writer()
+	{
+		release();
+		stop();
+		pthread_cond_destroy(&m_stub_cond);
+		pthread_mutex_destroy(&m_stub_mutex);
+	}
+
+	void hold()
+	{
+		pthread_mutex_lock(&m_stub_mutex);
+		m_held = true;
+		pthread_mutex_unlock(&m_stub_mutex);
+	}
+
+	void release()
+	{
+		pthread_mutex_lock(&m_stub_mutex);
+		m_held = false;
+		pthread_cond_broadcast(&m_stub_cond);
+		pthread_mutex_unlock(&m_stub_mutex);
+	}
+
+	/* Waits until the writer thread is inside a statement */
+	void wait_entered()
+	{
+		pthread_mutex_lock(&m_stub_mutex);
+		while (!m_entered)
+			pthread_cond_wait(&m_stub_cond, &m_stub_mutex);
+		pthread_mutex_unlock(&m_stub_mutex);
+	}
+protected:
+	virtual Csql_result query(const std::string& q)
+	{
+		pthread_mutex_lock(&m_stub_mutex);
+		m_entered++;
+		pthread_cond_broadcast(&m_stub_cond);
+		while (m_held)
+			pthread_cond_wait(&m_stub_cond, &m_stub_mutex);
+		pthread_mutex_unlock(&m_stub_mutex);
+		if (q.compare(0, 4, "fail") == 0)
+			throw Cdatabase::exception("stub failure");
+		return Csql_result(NULL);
+	}
+private:
+	pthread_mutex_t m_stub_mutex;
+	pthread_cond_t m_stub_cond;
+	bool m_held;
+	int m_entered;
+};
+
+BOOST_AUTO_TEST_CASE(test_write_not_running)
+{
+	Cstub_db_writer writer;
+	BOOST_CHECK(writer.write("insert"));
+	BOOST_CHECK(writer.write("fail"));
+	BOOST_CHECK_EQUAL(writer.c_written(), 1);
+	BOOST_CHECK_EQUAL(writer.c_failed(), 1);
+	BOOST_CHECK_EQUAL(writer.c_dropped(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_write_failed)
+{
+	Cstub_db_writer writer;
+	BOOST_REQUIRE_EQUAL(writer.start(), 0);
+	for (int i = 0; i < 100; i++)
+		BOOST_CHECK(writer.write(i % 4 ? "insert" : "fail"));
+	writer.stop();
+	BOOST_CHECK_EQUAL(writer.c_written(), 75);
+	BOOST_CHECK_EQUAL(writer.c_failed(), 25);
+	BOOST_CHECK_EQUAL(writer.c_dropped(), 0);
+	BOOST_CHECK_EQUAL(writer.c_queued(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_write_dropped)
+{
+	Cstub_db_writer writer;
+	writer.hold();
+	BOOST_REQUIRE_EQUAL(writer.start(), 0);
+
+	/* Occupy the writer thread, then fill the queue behind it */
+	BOOST_CHECK(writer.write("insert", true));
+	writer.wait_entered();
+	size_t queued = 0;
+	while (writer.write("insert", true))
+		queued++;
+	BOOST_CHECK_EQUAL(writer.c_queued(), queued);
+	BOOST_CHECK(!writer.write("insert", true));
+	BOOST_CHECK_EQUAL(writer.c_dropped(), 2);
+
+	writer.release();
+	writer.stop();
+	BOOST_CHECK_EQUAL(writer.c_written(), (long long)queued + 1);
+	BOOST_CHECK_EQUAL(writer.c_failed(), 0);
+	BOOST_CHECK_EQUAL(writer.c_queued(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_write_not_droppable)
+{
+	Cstub_db_writer writer;
+	writer.hold();
+	BOOST_REQUIRE_EQUAL(writer.start(), 0);
+
+	/* Fill the queue with droppable writes; the others still get in */
+	BOOST_CHECK(writer.write("insert", true));
+	writer.wait_entered();
+	size_t queued = 0;
+	while (writer.write("insert", true))
+		queued++;
+	for (int i = 0; i < 10; i++)
+		BOOST_CHECK(writer.write("update"));
+	BOOST_CHECK_EQUAL(writer.c_queued(), queued + 10);
+	BOOST_CHECK_EQUAL(writer.c_dropped(), 1);
+
+	writer.release();
+	writer.stop();
+	BOOST_CHECK_EQUAL(writer.c_written(), (long long)queued + 11);
+	BOOST_CHECK_EQUAL(writer.c_dropped(), 1);
+	BOOST_CHECK_EQUAL(writer.c_queued(), 0u);
+}
@@ -12,11 +12,13 @@ g++ $@ -DNDEBUG -I ../misc -I . -O3 -o xbt_tracker \
 	client.cpp \
 	config.cpp \
 	connection.cpp \
+	db_writer.cpp \
 	epoll.cpp \
 	server.cpp \
 	tcp_listen_socket.cpp \
 	tracker_input.cpp \
 	transaction.cpp \
 	udp_listen_socket.cpp \
+	worker.cpp \
 	"XBT Tracker.cpp" \
 	`mysql_config --libs` && strip xbt_tracker
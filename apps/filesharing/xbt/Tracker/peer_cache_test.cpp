@@ -0,0 +1,50 @@
+#include "stdafx.h"
+#include "server.h"
+
+#define BOOST_TEST_MAIN
+#include <boost/test/included/unit_test.hpp>
+
+/* A block of 'n' peers selected at time 'ctime' under guidance 'guidance_time' */
+static Cserver::t_peer_block make_block(int n, time_t ctime, time_t guidance_time, int churn)
+{
+	Cserver::t_peer_block block;
+	block.peers.resize(6 * n);
+	block.ctime = ctime;
+	block.guidance_time = guidance_time;
+	block.churn = churn;
+	return block;
+}
+
+BOOST_AUTO_TEST_CASE(test_block_fresh)
+{
+	Cserver::t_peer_block block = make_block(60, 1000, 5000, 0);
+	BOOST_CHECK(block.fresh(1000, 30, 5000, 0));
+	BOOST_CHECK(block.fresh(1029, 30, 5000, 0));
+}
+
+BOOST_AUTO_TEST_CASE(test_block_expires)
+{
+	Cserver::t_peer_block block = make_block(60, 1000, 5000, 0);
+	BOOST_CHECK(!block.fresh(1030, 30, 5000, 0));
+}
+
+BOOST_AUTO_TEST_CASE(test_block_guidance_recomputed)
+{
+	/* Recomputing guidance moves its next compute time */
+	Cserver::t_peer_block block = make_block(60, 1000, 5000, 0);
+	BOOST_CHECK(!block.fresh(1001, 30, 5300, 0));
+
+	/* Guidance appearing for the first time, or going away */
+	block = make_block(60, 1000, p4p::app::PGMSelectionManager::TIME_INVALID, 0);
+	BOOST_CHECK(!block.fresh(1001, 30, 0, 0));
+	block = make_block(60, 1000, 5000, 0);
+	BOOST_CHECK(!block.fresh(1001, 30, p4p::app::PGMSelectionManager::TIME_INVALID, 0));
+}
+
+BOOST_AUTO_TEST_CASE(test_block_churn)
+{
+	/* A quarter of the block's peers may have changed */
+	Cserver::t_peer_block block = make_block(60, 1000, 5000, 10);
+	BOOST_CHECK(block.fresh(1001, 30, 5000, 25));
+	BOOST_CHECK(!block.fresh(1001, 30, 5000, 26));
+}
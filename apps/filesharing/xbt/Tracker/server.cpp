@@ -38,6 +38,14 @@ static unsigned short extract_port(const std::string& addr)
 	return (unsigned short)atoi(addr.substr(sep + 1).c_str());
 }
 
+static void* worker_threadfunc(void* arg)
+{
+	Cworker* worker = (Cworker*)arg;
+	while (!g_sig_term)
+		worker->poll(1000);
+	return NULL;
+}
+
 static std::vector<std::string> split_string(const std::string& s, char delim)
 {
 	std::vector<std::string> result;
@@ -80,6 +88,8 @@ Cserver::Cserver(Cdatabase& database, const std::string& table_prefix, bool use_
 
 Cserver::~Cserver()
 {
+	/* Files unregister their selection managers on destruction */
+	m_shards.clear();
 	delete update_mgr;
 }
 
@@ -105,59 +115,34 @@ int Cserver::run()
 
 	if (test_sql())
 		return 1;
-	if (m_epoll.create(1 << 10) == -1)
-	{
-		std::cerr << "epoll_create failed" << std::endl;
-		return 1;
-	}
-	t_tcp_sockets lt;
-	t_udp_sockets lu;
-	BOOST_FOREACH(Cconfig::t_listen_ipas::const_reference j, m_config.m_listen_ipas)
+	if (m_use_sql)
 	{
-		BOOST_FOREACH(Cconfig::t_listen_ports::const_reference i, m_config.m_listen_ports)
+		try
 		{
-			Csocket l;
-			if (l.open(SOCK_STREAM) == INVALID_SOCKET)
-				std::cerr << "socket failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
-			else if (l.setsockopt(SOL_SOCKET, SO_REUSEADDR, true),
-				l.bind(j, htons(i)))
-				std::cerr << "bind failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
-			else if (l.listen())
-				std::cerr << "listen failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
-			else
-			{
-#ifdef SO_ACCEPTFILTER
-				accept_filter_arg afa;
-				bzero(&afa, sizeof(afa));
-				strcpy(afa.af_name, "httpready");
-				if (l.setsockopt(SOL_SOCKET, SO_ACCEPTFILTER, &afa, sizeof(afa)))
-					std::cerr << "setsockopt failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
-#elif TCP_DEFER_ACCEPT
-				if (l.setsockopt(IPPROTO_TCP, TCP_DEFER_ACCEPT, true))
-					std::cerr << "setsockopt failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
-#endif
-				lt.push_back(Ctcp_listen_socket(this, l));
-				if (!m_epoll.ctl(EPOLL_CTL_ADD, l, EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLERR | EPOLLHUP, &lt.back()))
-					continue;
-			}
-			return 1;
+			m_db_writer.open(m_config.m_mysql_host, m_config.m_mysql_user, m_config.m_mysql_password, m_config.m_mysql_database);
 		}
-		BOOST_FOREACH(Cconfig::t_listen_ports::const_reference i, m_config.m_listen_ports)
+		catch (Cdatabase::exception& e)
 		{
-			Csocket l;
-			if (l.open(SOCK_DGRAM) == INVALID_SOCKET)
-				std::cerr << "socket failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
-			else if (l.setsockopt(SOL_SOCKET, SO_REUSEADDR, true),
-				l.bind(j, htons(i)))
-				std::cerr << "bind failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
-			else
-			{
-				lu.push_back(Cudp_listen_socket(this, l));
-				if (!m_epoll.ctl(EPOLL_CTL_ADD, l, EPOLLIN | EPOLLPRI | EPOLLERR | EPOLLHUP, &lu.back()))
-					continue;
-			}
+			std::cerr << e.what() << std::endl;
 			return 1;
 		}
+		m_db_writer.set_query_log(m_config.m_query_log);
+	}
+	int c_workers = std::max(m_config.m_worker_threads, 1);
+#if !defined(EPOLL) || !defined(SO_REUSEPORT)
+	if (c_workers > 1)
+	{
+		std::cerr << "worker_threads requires epoll and SO_REUSEPORT, using a single worker" << std::endl;
+		c_workers = 1;
+	}
+#endif
+	for (int i = std::max(m_config.m_shards, c_workers); i--; )
+		m_shards.push_back(new t_shard);
+	for (int i = 0; i < c_workers; i++)
+	{
+		m_workers.push_back(new Cworker(*this, !i));
+		if (m_workers.back().open(c_workers > 1))
+			return 1;
 	}
 	clean_up();
 	read_db_deny_from_hosts();
@@ -205,84 +190,34 @@ int Cserver::run()
 		exit(1);
 	}
 
-#ifdef EPOLL
-	const int c_events = 64;
+	/* Until now database access was synchronous; from here on it goes
+	 * through the writer thread.
+	 */
+	if (m_use_sql && m_db_writer.start())
+	{
+		std::cerr << "Failed to spawn database writer thread" << std::endl;
+		exit(1);
+	}
 
-	epoll_event events[c_events];
-#else
-	fd_set fd_read_set;
-	fd_set fd_write_set;
-	fd_set fd_except_set;
-#endif
-	while (!g_sig_term)
+	/* The first worker runs on this thread together with the periodic
+	 * database and config work below; the others get a thread each.
+	 */
+	std::vector<pthread_t> worker_thds;
+	for (t_workers::iterator i = m_workers.begin() + 1; i != m_workers.end(); i++)
 	{
-#ifdef EPOLL
-		int r = m_epoll.wait(events, c_events, 5000);
-		if (r == -1)
-			std::cerr << "epoll_wait failed: " << errno << std::endl;
-		else
-		{
-			int prev_time = m_time;
-			m_time = ::time(NULL);
-			for (int i = 0; i < r; i++)
-				reinterpret_cast<Cclient*>(events[i].data.ptr)->process_events(events[i].events);
-			if (m_time == prev_time)
-				continue;
-			for (t_connections::iterator i = m_connections.begin(); i != m_connections.end(); )
-			{
-				if (i->run())
-					i = m_connections.erase(i);
-				else
-					i++;
-			}
-		}
-#else
-		FD_ZERO(&fd_read_set);
-		FD_ZERO(&fd_write_set);
-		FD_ZERO(&fd_except_set);
-		int n = 0;
-		BOOST_FOREACH(t_connections::reference i, m_connections)
-		{
-			int z = i.pre_select(&fd_read_set, &fd_write_set);
-			n = std::max(n, z);
-		}
-		BOOST_FOREACH(t_tcp_sockets::reference i, lt)
-		{
-			FD_SET(i.s(), &fd_read_set);
-			n = std::max<int>(n, i.s());
-		}
-		BOOST_FOREACH(t_udp_sockets::reference i, lu)
+		pthread_t worker_thd;
+		if (pthread_create(&worker_thd, NULL, worker_threadfunc, &*i) != 0)
 		{
-			FD_SET(i.s(), &fd_read_set);
-			n = std::max<int>(n, i.s());
+			std::cerr << "Failed to spawn worker thread" << std::endl;
+			exit(1);
 		}
-		timeval tv;
-		tv.tv_sec = 5;
-		tv.tv_usec = 0;
-		if (select(n + 1, &fd_read_set, &fd_write_set, &fd_except_set, &tv) == SOCKET_ERROR)
-			std::cerr << "select failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
-		else
-		{
-			m_time = ::time(NULL);
-			BOOST_FOREACH(t_tcp_sockets::reference i, lt)
-			{
-				if (FD_ISSET(i.s(), &fd_read_set))
-					accept(i.s());
-			}
-			BOOST_FOREACH(t_udp_sockets::reference i, lu)
-			{
-				if (FD_ISSET(i.s(), &fd_read_set))
-					Ctransaction(*this, i.s()).recv();
-			}
-			for (t_connections::iterator i = m_connections.begin(); i != m_connections.end(); )
-			{
-				if (i->post_select(&fd_read_set, &fd_write_set))
-					i = m_connections.erase(i);
-				else
-					i++;
-			}
-		}
-#endif
+		worker_thds.push_back(worker_thd);
+	}
+
+	while (!g_sig_term)
+	{
+		m_workers.front().poll(5000);
+		read_db_results();
 		if (time() - m_read_config_time > m_config.m_read_config_interval)
 			read_config();
 		else if (time() - m_clean_up_time > m_config.m_clean_up_interval)
@@ -299,66 +234,59 @@ int Cserver::run()
 			write_db_users();
 	}
 
+	BOOST_FOREACH(pthread_t i, worker_thds)
+	{
+		if (pthread_join(i, NULL) != 0)
+			std::cerr << "Failed to join worker thread" << std::endl;
+	}
+
 	update_mgr->stop();
 	if (pthread_join(update_mgr_thd, NULL) != 0)
 		std::cerr << "Failed to join P4P update thread" << std::endl;
 
 	write_db_files();
 	write_db_users();
+	m_db_writer.stop();
+	/* Flush the counts of files whose fid came back while the writer drained */
+	read_db_results();
+	write_db_files();
 	unlink(m_config.m_pid_file.c_str());
 	return 0;
 }
 
-void Cserver::accept(const Csocket& l)
+bool Cserver::accept_host(unsigned int ipa)
 {
-	sockaddr_in a;
-	while (1)
+	p4p::detail::ScopedSharedLock reload_lock(m_reload_mutex);
+	t_deny_from_hosts::const_iterator i = m_deny_from_hosts.lower_bound(ipa);
+	if (i != m_deny_from_hosts.end() && ipa >= i->second.begin)
 	{
-		socklen_t cb_a = sizeof(sockaddr_in);
-		Csocket s = ::accept(l, reinterpret_cast<sockaddr*>(&a), &cb_a);
-		if (s == SOCKET_ERROR)
-		{
-			if (WSAGetLastError() == WSAECONNABORTED)
-				continue;
-			if (WSAGetLastError() != WSAEWOULDBLOCK)
-				std::cerr << "accept failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
-			break;
-		}
-		t_deny_from_hosts::const_iterator i = m_deny_from_hosts.lower_bound(ntohl(a.sin_addr.s_addr));
-		if (i != m_deny_from_hosts.end() && ntohl(a.sin_addr.s_addr) >= i->second.begin)
-		{
-			m_stats.rejected_tcp++;
-			continue;
-		}
-		m_stats.accepted_tcp++;
-		if (s.blocking(false))
-			std::cerr << "ioctlsocket failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
-		std::auto_ptr<Cconnection> connection(new Cconnection(this, s, a));
-		connection->process_events(EPOLLIN);
-		if (connection->s() != INVALID_SOCKET)
-		{
-			m_connections.push_back(connection.release());
-			m_epoll.ctl(EPOLL_CTL_ADD, m_connections.back().s(), EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLERR | EPOLLHUP | EPOLLET, &m_connections.back());
-		}
+		count(m_stats.rejected_tcp);
+		return false;
 	}
+	count(m_stats.accepted_tcp);
+	return true;
 }
 
 std::string Cserver::insert_peer(const Ctracker_input& v, bool udp, t_user* user)
 {
 	if (m_use_sql && m_config.m_log_announce)
 	{
-		m_announce_log_buffer += Csql_query(m_database, "(?,?,?,?,?,?,?,?,?,?),")
+		std::string announce_log = Csql_query(m_database, "(?,?,?,?,?,?,?,?,?,?),")
 			.p(ntohl(v.m_ipa)).p(ntohs(v.m_port)).p(v.m_event).p(v.m_info_hash).p(v.m_peer_id).p(v.m_downloaded).p(v.m_left).p(v.m_uploaded).p(user ? user->uid : 0).p(time()).read();
+		p4p::detail::ScopedExclusiveLock state_lock(m_state_mutex);
+		m_announce_log_buffer += announce_log;
 	}
 	if (!m_config.m_offline_message.empty())
 		return m_config.m_offline_message;
 	if (!m_config.m_anonymous_announce && !user)
 		return bts_unregistered_torrent_pass;
+	t_shard& shard = this->shard(v.m_info_hash);
+	p4p::detail::ScopedExclusiveLock shard_lock(shard.mutex);
 	if (!m_config.m_auto_register && !file(v.m_info_hash))
 		return bts_unregistered_torrent;
 	if (v.m_left && user && !user->can_leech)
 		return bts_can_not_leech;
-	t_file& file = m_files[v.m_info_hash];
+	t_file& file = shard.files[v.m_info_hash];
 	if (file.selection_mgr == NULL)
 		file.init_p4p(&isp_mgr, update_mgr,
 				extract_hostname(m_config.m_aoe_address),
@@ -372,6 +300,7 @@ std::string Cserver::insert_peer(const Ctracker_input& v, bool udp, t_user* user
 	if (i != file.peers.end())
 	{
 		(i->second.left ? file.leechers : file.seeders)--;
+		p4p::detail::ScopedExclusiveLock state_lock(m_state_mutex);
 		if (t_user* old_user = find_user_by_uid(i->second.uid))
 			(i->second.left ? old_user->incompletes : old_user->completes)--;
 	}
@@ -397,7 +326,7 @@ std::string Cserver::insert_peer(const Ctracker_input& v, bool udp, t_user* user
 			downloaded = v.m_downloaded - i->second.downloaded;
 			uploaded = v.m_uploaded - i->second.uploaded;
 		}
-		m_files_users_updates_buffer += Csql_query(m_database, "(?,1,?,?,?,?,?,?,?),")
+		std::string files_users_update = Csql_query(m_database, "(?,1,?,?,?,?,?,?,?),")
 			.p(v.m_event != Ctracker_input::e_stopped)
 			.p(v.m_event == Ctracker_input::e_completed)
 			.p(downloaded)
@@ -407,6 +336,8 @@ std::string Cserver::insert_peer(const Ctracker_input& v, bool udp, t_user* user
 			.p(file.fid)
 			.p(user->uid)
 			.read();
+		p4p::detail::ScopedExclusiveLock state_lock(m_state_mutex);
+		m_files_users_updates_buffer += files_users_update;
 		if (downloaded || uploaded)
 			m_users_updates_buffer += Csql_query(m_database, "(?,?,?),").p(downloaded).p(uploaded).p(user->uid).read();
 	}
@@ -417,6 +348,7 @@ std::string Cserver::insert_peer(const Ctracker_input& v, bool udp, t_user* user
 		{
 			file.selection_mgr->removePeer(&itr->second);
 			file.peers.erase(itr);
+			file.churn++;
 		}
 	}
 	else
@@ -426,6 +358,7 @@ std::string Cserver::insert_peer(const Ctracker_input& v, bool udp, t_user* user
 		{
 			peer_itr = file.peers.insert(std::make_pair(peer_key, t_peer(v.m_ipa))).first;
 			file.selection_mgr->addPeer(&peer_itr->second);
+			file.churn++;
 		}
 		t_peer& peer = peer_itr->second;
 		peer.downloaded = v.m_downloaded;
@@ -436,18 +369,77 @@ std::string Cserver::insert_peer(const Ctracker_input& v, bool udp, t_user* user
 		peer.uploaded = v.m_uploaded;
 		(peer.left ? file.leechers : file.seeders)++;
 		if (user)
+		{
+			p4p::detail::ScopedExclusiveLock state_lock(m_state_mutex);
 			(peer.left ? user->incompletes : user->completes)++;
+		}
 		peer.mtime = time();
 		file.selection_mgr->updatePeerStats(&peer);
 	}
 	if (v.m_event == Ctracker_input::e_completed)
 		file.completed++;
-	(udp ? m_stats.announced_udp : m_stats.announced_http)++;
+	count(udp ? m_stats.announced_udp : m_stats.announced_http);
 	file.dirty = true;
 	return "";
 }
 
-std::string Cserver::t_file::select_peers(const Ctracker_input& ti) const
+static void select_slice(const std::string& block, const std::string& self, size_t c, std::string& d)
+{
+	size_t n = block.size() / 6;
+	if (!n)
+		return;
+	d.reserve(6 * std::min(c, n));
+	size_t i = rand() % n;
+	for (size_t j = 0; j < n && d.size() < 6 * c; j++, i = (i + 1) % n)
+	{
+		if (!block.compare(6 * i, 6, self))
+			continue;
+		d.append(block, 6 * i, 6);
+	}
+}
+
+bool Cserver::t_file::select_cached_peers(const t_peer& peer, size_t c, const Cserver& server, const t_shard& shard, std::string& d) const
+{
+	const Cconfig& config = server.config();
+	t_peer_block_key key(peer.getHomeISP(), peer.getHomePID());
+	time_t guidance_time = selection_mgr->getNextComputeTime(key.first);
+	std::string self(reinterpret_cast<const char*>(&peer.ipaddr), 4);
+	self.append(reinterpret_cast<const char*>(&peer.port), 2);
+	{
+		p4p::detail::ScopedSharedLock cache_lock(shard.cache_mutex);
+		t_peer_blocks::const_iterator i = peer_blocks.find(key);
+		if (i != peer_blocks.end() && i->second.fresh(server.time(), config.m_peer_cache_ttl, guidance_time, churn))
+		{
+			select_slice(i->second.peers, self, c, d);
+			return true;
+		}
+	}
+
+	/* Select a full block on behalf of the whole PID. Peers are encoded
+	 * right away, so the block never refers to peers that have left.
+	 */
+	std::vector<const p4p::app::P4PPeerBase*> p4p_selected_peers;
+	p4p_selected_peers.reserve(config.m_peer_cache_size);
+	if (selection_mgr->selectPeers(&peer, config.m_peer_cache_size, p4p_selected_peers) != 0)
+		return false;
+	t_peer_block block;
+	block.peers.resize(6 * p4p_selected_peers.size());
+	for (unsigned int i = 0; i < p4p_selected_peers.size(); ++i)
+	{
+		const t_peer* selected = static_cast<const t_peer*>(p4p_selected_peers[i]);
+		memcpy(&block.peers[6 * i], &selected->ipaddr, 4);
+		memcpy(&block.peers[6 * i] + 4, &selected->port, 2);
+	}
+	block.ctime = server.time();
+	block.guidance_time = guidance_time;
+	block.churn = churn;
+	select_slice(block.peers, self, c, d);
+	p4p::detail::ScopedExclusiveLock cache_lock(shard.cache_mutex);
+	std::swap(peer_blocks[key], block);
+	return true;
+}
+
+std::string Cserver::t_file::select_peers(const Ctracker_input& ti, const Cserver& server, const t_shard& shard) const
 {
 	if (ti.m_event == Ctracker_input::e_stopped)
 		return "";
@@ -462,19 +454,30 @@ std::string Cserver::t_file::select_peers(const Ctracker_input& ti) const
 		return "";
 
 	size_t c = ti.m_num_want < 0 ? 50 : std::min(ti.m_num_want, 50);
-	std::vector<const p4p::app::P4PPeerBase*> p4p_selected_peers;
-	p4p_selected_peers.reserve(c);
-	if (selection_mgr->selectPeers(&peer_itr->second, c, p4p_selected_peers) == 0)
+	if (server.config().m_peer_cache_size > 0)
 	{
 		std::string d;
-		d.resize(6 * p4p_selected_peers.size());
-		for (unsigned int i = 0; i < p4p_selected_peers.size(); ++i)
+		if (peer_itr->second.getHomeISP()
+			&& peer_itr->second.getHomePID() >= 0
+			&& select_cached_peers(peer_itr->second, c, server, shard, d))
+			return d;
+	}
+	else
+	{
+		std::vector<const p4p::app::P4PPeerBase*> p4p_selected_peers;
+		p4p_selected_peers.reserve(c);
+		if (selection_mgr->selectPeers(&peer_itr->second, c, p4p_selected_peers) == 0)
 		{
-			t_peer* peer = (t_peer*)p4p_selected_peers[i];
-			memcpy(&d[6 * i], &peer->ipaddr, 4);
-			memcpy(&d[6 * i] + 4, &peer->port, 2);
+			std::string d;
+			d.resize(6 * p4p_selected_peers.size());
+			for (unsigned int i = 0; i < p4p_selected_peers.size(); ++i)
+			{
+				t_peer* peer = (t_peer*)p4p_selected_peers[i];
+				memcpy(&d[6 * i], &peer->ipaddr, 4);
+				memcpy(&d[6 * i] + 4, &peer->port, 2);
+			}
+			return d;
 		}
-		return d;
 	}
 
 	typedef std::vector<boost::array<char, 6> > t_candidates;
@@ -509,14 +512,63 @@ std::string Cserver::t_file::select_peers(const Ctracker_input& ti) const
 	return d;
 }
 
-Cvirtual_binary Cserver::select_peers(const Ctracker_input& ti) const
+bool Cserver::select_peers(const Ctracker_input& ti, std::string& peers, t_file_counts& counts) const
 {
+	const t_shard& shard = this->shard(ti.m_info_hash);
+	p4p::detail::ScopedSharedLock shard_lock(shard.mutex);
 	const t_file* f = file(ti.m_info_hash);
 	if (!f)
+		return false;
+	peers = f->select_peers(ti, *this, shard);
+	counts.completed = f->completed;
+	counts.leechers = f->leechers;
+	counts.seeders = f->seeders;
+	return true;
+}
+
+Cvirtual_binary Cserver::select_peers(const Ctracker_input& ti) const
+{
+	std::string peers;
+	t_file_counts counts;
+	if (!select_peers(ti, peers, counts))
 		return Cvirtual_binary();
-	std::string peers = f->select_peers(ti);
-	return Cvirtual_binary((boost::format("d8:completei%de10:incompletei%de8:intervali%de12:min intervali%de5:peers%d:%se")
-		% f->seeders % f->leechers % config().m_announce_interval % config().m_announce_interval % peers.size() % peers).str());
+	std::string interval = n(config().m_announce_interval);
+	std::string d;
+	d.reserve(96 + peers.size());
+	d += "d8:completei";
+	d += n(counts.seeders);
+	d += "e10:incompletei";
+	d += n(counts.leechers);
+	d += "e8:intervali";
+	d += interval;
+	d += "e12:min intervali";
+	d += interval;
+	d += "e5:peers";
+	d += n(peers.size());
+	d += ':';
+	d += peers;
+	d += 'e';
+	return Cvirtual_binary(d);
+}
+
+Cserver::t_file_counts Cserver::file_counts(const std::string& id) const
+{
+	const t_shard& shard = this->shard(id);
+	p4p::detail::ScopedSharedLock shard_lock(shard.mutex);
+	t_file_counts counts;
+	if (const t_file* f = file(id))
+	{
+		counts.completed = f->completed;
+		counts.leechers = f->leechers;
+		counts.seeders = f->seeders;
+	}
+	return counts;
+}
+
+void Cserver::count(long long& v)
+{
+	p4p::detail::ScopedExclusiveLock state_lock(m_state_mutex);
+	v++;
 }
 
 void Cserver::t_file::clean_up(time_t t, Cserver& server)
@@ -530,18 +582,32 @@ void Cserver::t_file::clean_up(time_t t, Cserver& server)
 				(i->second.left ? user->incompletes : user->completes)--;
 			if (i->second.uid)
 				server.m_files_users_updates_buffer += Csql_query(server.m_database, "(0,0,0,0,-1,0,-1,?,?),").p(fid).p(i->second.uid).read();
+			selection_mgr->removePeer(&i->second);
 			peers.erase(i++);
+			churn++;
 			dirty = true;
 		}
 		else
 			i++;
 	}
+	for (t_peer_blocks::iterator i = peer_blocks.begin(); i != peer_blocks.end(); )
+	{
+		if (i->second.ctime + server.config().m_peer_cache_ttl <= server.time())
+			peer_blocks.erase(i++);
+		else
+			i++;
+	}
 }
 
 void Cserver::clean_up()
 {
-	BOOST_FOREACH(t_files::reference i, m_files)
-		i.second.clean_up(time() - static_cast<int>(1.5 * m_config.m_announce_interval), *this);
+	BOOST_FOREACH(t_shards::reference shard, m_shards)
+	{
+		p4p::detail::ScopedExclusiveLock shard_lock(shard.mutex);
+		p4p::detail::ScopedExclusiveLock state_lock(m_state_mutex);
+		BOOST_FOREACH(t_files::reference i, shard.files)
+			i.second.clean_up(time() - static_cast<int>(1.5 * m_config.m_announce_interval), *this);
+	}
 	m_clean_up_time = time();
 }
 
@@ -575,46 +641,58 @@ Cvirtual_binary Cserver::scrape(const Ctracker_input& ti)
 		else
 			q.p(ti.m_info_hash);
 		q.p(time());
-		m_scrape_log_buffer += q.read();
+		std::string scrape_log = q.read();
+		p4p::detail::ScopedExclusiveLock state_lock(m_state_mutex);
+		m_scrape_log_buffer += scrape_log;
 	}
 	std::string d;
 	d += "d5:filesd";
 	if (ti.m_info_hashes.empty())
 	{
-		m_stats.scraped_full++;
+		count(m_stats.scraped_full);
 		if (ti.m_compact)
 		{
-			Cvirtual_binary d;
-			byte* w = d.write_start(32 * m_files.size() + 1);
-			*w++ = 'x';
-			BOOST_FOREACH(t_files::reference i, m_files)
+			std::string d;
+			d += 'x';
+			BOOST_FOREACH(t_shards::const_reference shard, m_shards)
 			{
-				if (!i.second.leechers && !i.second.seeders)
-					continue;
-				memcpy(w, i.first.data(), i.first.size());
-				w += i.first.size();
-				w = write_compact_int(w, i.second.seeders);
-				w = write_compact_int(w, i.second.leechers);
-				w = write_compact_int(w, i.second.completed);
+				p4p::detail::ScopedSharedLock shard_lock(shard.mutex);
+				d.reserve(d.size() + 32 * shard.files.size());
+				BOOST_FOREACH(t_files::const_reference i, shard.files)
+				{
+					if (!i.second.leechers && !i.second.seeders)
+						continue;
+					byte b[12];
+					byte* w = b;
+					w = write_compact_int(w, i.second.seeders);
+					w = write_compact_int(w, i.second.leechers);
+					w = write_compact_int(w, i.second.completed);
+					d += i.first;
+					d.append(reinterpret_cast<const char*>(b), w - b);
+				}
 			}
-			d.resize(w - d);
-			return d;
+			return Cvirtual_binary(d);
 		}
-		d.reserve(90 * m_files.size());
-		BOOST_FOREACH(t_files::reference i, m_files)
+		BOOST_FOREACH(t_shards::const_reference shard, m_shards)
 		{
-			if (i.second.leechers || i.second.seeders)
-				d += (boost::format("20:%sd8:completei%de10:downloadedi%de10:incompletei%dee") % i.first % i.second.seeders % i.second.completed % i.second.leechers).str();
+			p4p::detail::ScopedSharedLock shard_lock(shard.mutex);
+			d.reserve(d.size() + 90 * shard.files.size());
+			BOOST_FOREACH(t_files::const_reference i, shard.files)
+			{
+				if (i.second.leechers || i.second.seeders)
+					d += (boost::format("20:%sd8:completei%de10:downloadedi%de10:incompletei%dee") % i.first % i.second.seeders % i.second.completed % i.second.leechers).str();
+			}
 		}
 	}
 	else
 	{
-		m_stats.scraped_http++;
+		count(m_stats.scraped_http);
 		BOOST_FOREACH(Ctracker_input::t_info_hashes::const_reference j, ti.m_info_hashes)
 		{
-			t_files::const_iterator i = m_files.find(j);
-			if (i != m_files.end())
-				d += (boost::format("20:%sd8:completei%de10:downloadedi%de10:incompletei%dee") % i->first % i->second.seeders % i->second.completed % i->second.leechers).str();
+			const t_shard& shard = this->shard(j);
+			p4p::detail::ScopedSharedLock shard_lock(shard.mutex);
+			if (const t_file* f = file(j))
+				d += (boost::format("20:%sd8:completei%de10:downloadedi%de10:incompletei%dee") % j % f->seeders % f->completed % f->leechers).str();
 		}
 	}
 	d += "e";
@@ -629,28 +707,44 @@ void Cserver::read_db_deny_from_hosts()
 	m_read_db_deny_from_hosts_time = time();
 	if (!m_use_sql)
 		return;
-	try
+	m_db_writer.read(table_deny_from_hosts, Csql_query(m_database, "select begin, end from ?").p_name(table_name(table_deny_from_hosts)).read());
+	read_db_results();
+}
+
+void Cserver::read_db_deny_from_hosts(const Csql_result& result)
+{
+	t_deny_from_hosts deny_from_hosts;
+	for (Csql_row row; row = result.fetch_row(); )
+		deny_from_hosts[row[1].i()].begin = row[0].i();
+	p4p::detail::ScopedExclusiveLock reload_lock(m_reload_mutex);
+	m_deny_from_hosts.swap(deny_from_hosts);
+}
+
+void Cserver::read_db_results()
+{
+	Cdb_writer::t_results results;
+	m_db_writer.results(results);
+	BOOST_FOREACH(Cdb_writer::t_results::reference i, results)
 	{
-		Csql_result result = Csql_query(m_database, "select begin, end from ?").p_name(table_name(table_deny_from_hosts)).execute();
-		BOOST_FOREACH(t_deny_from_hosts::reference i, m_deny_from_hosts)
-			i.second.marked = true;
-		for (Csql_row row; row = result.fetch_row(); )
+		switch (i.first)
 		{
-			t_deny_from_host& deny_from_host = m_deny_from_hosts[row[1].i()];
-			deny_from_host.marked = false;
-			deny_from_host.begin = row[0].i();
-		}
-		for (t_deny_from_hosts::iterator i = m_deny_from_hosts.begin(); i != m_deny_from_hosts.end(); )
-		{
-			if (i->second.marked)
-				m_deny_from_hosts.erase(i++);
-			else
-				i++;
+		case table_deny_from_hosts:
+			read_db_deny_from_hosts(i.second);
+			break;
+		case table_files:
+			read_db_files(i.second);
+			break;
+		case read_files_deleted:
+			read_db_files_deleted(i.second);
+			break;
+		case read_files_fids:
+			read_db_files_fids(i.second);
+			break;
+		case table_users:
+			read_db_users(i.second);
+			break;
 		}
 	}
-	catch (Cdatabase::exception&)
-	{
-	}
 }
 
 void Cserver::read_db_files()
@@ -668,76 +762,126 @@ void Cserver::read_db_files()
 			s = hex_decode(s);
 			if (s.size() != 20)
 				continue;
-			m_files[s];
-			if (m_files[s].selection_mgr == NULL)
-				m_files[s].init_p4p(&isp_mgr, update_mgr,
+			t_shard& shard = this->shard(s);
+			p4p::detail::ScopedExclusiveLock shard_lock(shard.mutex);
+			t_file& file = shard.files[s];
+			if (file.selection_mgr == NULL)
+				file.init_p4p(&isp_mgr, update_mgr,
 							extract_hostname(m_config.m_aoe_address),
 							extract_port(m_config.m_aoe_address));
 			new_files.insert(s);
 		}
-		for (t_files::iterator i = m_files.begin(); i != m_files.end(); )
+		BOOST_FOREACH(t_shards::reference shard, m_shards)
 		{
-			if (new_files.find(i->first) == new_files.end())
-				m_files.erase(i++);
-			else
-				i++;
+			p4p::detail::ScopedExclusiveLock shard_lock(shard.mutex);
+			for (t_files::iterator i = shard.files.begin(); i != shard.files.end(); )
+			{
+				if (new_files.find(i->first) == new_files.end())
+					shard.files.erase(i++);
+				else
+					i++;
+			}
 		}
 	}
 }
 
 void Cserver::read_db_files_sql()
 {
-	try
+	if (!m_config.m_auto_register)
+		m_db_writer.read(read_files_deleted, Csql_query(m_database, "select info_hash, ? from ? where flags & 1").p_name(column_name(column_files_fid)).p_name(table_name(table_files)).read());
+	bool files_empty = true;
+	BOOST_FOREACH(t_shards::reference shard, m_shards)
+	{
+		p4p::detail::ScopedSharedLock shard_lock(shard.mutex);
+		files_empty &= shard.files.empty();
+	}
+	if (files_empty)
+		m_db_writer.write("update " + table_name(table_files) + " set " + column_name(column_files_leechers) + " = 0, " + column_name(column_files_seeders) + " = 0");
+	else if (m_config.m_auto_register)
 	{
-		if (!m_config.m_auto_register)
+		read_db_results();
+		return;
+	}
+	Csql_query q(m_database, "select info_hash, ?, ?, ctime from ? where ? >= ?");
+	/* Files deleted by the read above must not come back */
+	if (!m_config.m_auto_register)
+		q += " and (flags & 1) = 0";
+	q.p_name(column_name(column_files_completed));
+	q.p_name(column_name(column_files_fid));
+	q.p_name(table_name(table_files));
+	q.p_name(column_name(column_files_fid));
+	q.p(m_fid_end);
+	m_db_writer.read(table_files, q.read());
+	read_db_results();
+}
+
+void Cserver::read_db_files(const Csql_result& result)
+{
+	for (Csql_row row; row = result.fetch_row(); )
+	{
+		m_fid_end = std::max(m_fid_end, static_cast<int>(row[2].i()) + 1);
+		if (row[0].size() != 20)
+			continue;
+		t_shard& shard = this->shard(row[0].s());
+		p4p::detail::ScopedExclusiveLock shard_lock(shard.mutex);
+		if (file(row[0].s()))
+			continue;
+		t_file& file = shard.files[row[0].s()];
+		if (file.selection_mgr == NULL)
+			file.init_p4p(&isp_mgr, update_mgr,
+					extract_hostname(m_config.m_aoe_address),
+					extract_port(m_config.m_aoe_address));
+		if (file.fid)
+			continue;
+		file.completed = row[1].i();
+		file.dirty = false;
+		file.fid = row[2].i();
+		file.ctime = row[3].i();
+	}
+}
+
+void Cserver::read_db_files_deleted(const Csql_result& result)
+{
+	std::string fids;
+	for (Csql_row row; row = result.fetch_row(); )
+	{
+		t_shard& shard = this->shard(row[0].s());
 		{
-			Csql_result result = Csql_query(m_database, "select info_hash, ? from ? where flags & 1").p_name(column_name(column_files_fid)).p_name(table_name(table_files)).execute();
-			for (Csql_row row; row = result.fetch_row(); )
+			p4p::detail::ScopedExclusiveLock shard_lock(shard.mutex);
+			t_files::iterator i = shard.files.find(row[0].s());
+			if (i != shard.files.end())
 			{
-				t_files::iterator i = m_files.find(row[0].s());
-				if (i != m_files.end())
+				p4p::detail::ScopedExclusiveLock state_lock(m_state_mutex);
+				BOOST_FOREACH(t_peers::reference j, i->second.peers)
 				{
-					BOOST_FOREACH(t_peers::reference j, i->second.peers)
-					{
-						if (t_user* user = find_user_by_uid(j.second.uid))
-							(j.second.left ? user->incompletes : user->completes)--;
-					}
-					m_files.erase(i);
+					if (t_user* user = find_user_by_uid(j.second.uid))
+						(j.second.left ? user->incompletes : user->completes)--;
 				}
-				Csql_query(m_database, "delete from ? where ? = ?").p_name(table_name(table_files)).p_name(column_name(column_files_fid)).p(row[1].i()).execute();
+				shard.files.erase(i);
 			}
 		}
-		if (m_files.empty())
-			m_database.query("update " + table_name(table_files) + " set " + column_name(column_files_leechers) + " = 0, " + column_name(column_files_seeders) + " = 0");
-		else if (m_config.m_auto_register)
-			return;
-		Csql_result result = Csql_query(m_database, "select info_hash, ?, ?, ctime from ? where ? >= ?")
-			.p_name(column_name(column_files_completed))
-			.p_name(column_name(column_files_fid))
-			.p_name(table_name(table_files))
-			.p_name(column_name(column_files_fid))
-			.p(m_fid_end)
-			.execute();
-		for (Csql_row row; row = result.fetch_row(); )
-		{
-			m_fid_end = std::max(m_fid_end, static_cast<int>(row[2].i()) + 1);
-			if (row[0].size() != 20 || file(row[0].s()))
-				continue;
-			t_file& file = m_files[row[0].s()];
-			if (file.selection_mgr == NULL)
-				file.init_p4p(&isp_mgr, update_mgr,
-						extract_hostname(m_config.m_aoe_address),
-						extract_port(m_config.m_aoe_address));
-			if (file.fid)
-				continue;
-			file.completed = row[1].i();
-			file.dirty = false;
-			file.fid = row[2].i();
-			file.ctime = row[3].i();
-		}
+		fids += Csql_query(m_database, "?,").p(row[1].i()).read();
 	}
-	catch (Cdatabase::exception&)
+	if (fids.empty())
+		return;
+	fids.erase(fids.size() - 1);
+	m_db_writer.write("delete from " + table_name(table_files) + " where " + column_name(column_files_fid) + " in (" + fids + ")");
+}
+
+void Cserver::read_db_files_fids(const Csql_result& result)
+{
+	for (Csql_row row; row = result.fetch_row(); )
 	{
+		if (row[0].size() != 20)
+			continue;
+		t_shard& shard = this->shard(row[0].s());
+		p4p::detail::ScopedExclusiveLock shard_lock(shard.mutex);
+		t_files::iterator i = shard.files.find(row[0].s());
+		if (i == shard.files.end() || i->second.fid)
+			continue;
+		/* The counts held back by write_db_files go out next time */
+		i->second.fid = row[1].i();
+		i->second.dirty = true;
 	}
 }
 
@@ -746,62 +890,66 @@ void Cserver::read_db_users()
 	m_read_db_users_time = time();
 	if (!m_use_sql)
 		return;
-	try
+	Csql_query q(m_database, "select ?");
+	if (m_read_users_can_leech)
+		q += ", can_leech";
+	if (m_read_users_peers_limit)
+		q += ", peers_limit";
+	if (m_read_users_torrent_pass)
+		q += ", torrent_pass";
+	if (m_read_users_torrent_pass_version)
+		q += ", torrent_pass_version";
+	if (m_read_users_torrents_limit)
+		q += ", torrents_limit";
+	if (m_read_users_wait_time)
+		q += ", wait_time";
+	q += " from ?";
+	q.p_name(column_name(column_users_uid));
+	q.p_name(table_name(table_users));
+	m_db_writer.read(table_users, q.read());
+	read_db_results();
+}
+
+void Cserver::read_db_users(const Csql_result& result)
+{
+	/* Build the new tables aside and swap them in; only the counters kept
+	 * up to date by announces are carried over from the current ones.
+	 */
+	t_users users;
+	t_users_torrent_passes users_torrent_passes;
+	for (Csql_row row; row = result.fetch_row(); )
 	{
-		Csql_query q(m_database, "select ?");
+		t_user& user = users[row[0].i()];
+		int c = 0;
+		user.uid = row[c++].i();
 		if (m_read_users_can_leech)
-			q += ", can_leech";
+			user.can_leech = row[c++].i();
 		if (m_read_users_peers_limit)
-			q += ", peers_limit";
+			user.peers_limit = row[c++].i();
 		if (m_read_users_torrent_pass)
-			q += ", torrent_pass";
+		{
+			if (row[c].size())
+				users_torrent_passes[row[c].s()] = &user;
+			c++;
+		}
 		if (m_read_users_torrent_pass_version)
-			q += ", torrent_pass_version";
+			user.torrent_pass_version = row[c++].i();
 		if (m_read_users_torrents_limit)
-			q += ", torrents_limit";
+			user.torrents_limit = row[c++].i();
 		if (m_read_users_wait_time)
-			q += ", wait_time";
-		q += " from ?";
-		q.p_name(column_name(column_users_uid));
-		q.p_name(table_name(table_users));
-		Csql_result result = q.execute();
-		BOOST_FOREACH(t_users::reference i, m_users)
-			i.second.marked = true;
-		m_users_torrent_passes.clear();
-		for (Csql_row row; row = result.fetch_row(); )
-		{
-			t_user& user = m_users[row[0].i()];
-			user.marked = false;
-			int c = 0;
-			user.uid = row[c++].i();
-			if (m_read_users_can_leech)
-				user.can_leech = row[c++].i();
-			if (m_read_users_peers_limit)
-				user.peers_limit = row[c++].i();
-			if (m_read_users_torrent_pass)
-			{
-				if (row[c].size())
-					m_users_torrent_passes[row[c].s()] = &user;
-				c++;
-			}
-			if (m_read_users_torrent_pass_version)
-				user.torrent_pass_version = row[c++].i();
-			if (m_read_users_torrents_limit)
-				user.torrents_limit = row[c++].i();
-			if (m_read_users_wait_time)
-				user.wait_time = row[c++].i();
-		}
-		for (t_users::iterator i = m_users.begin(); i != m_users.end(); )
-		{
-			if (i->second.marked)
-				m_users.erase(i++);
-			else
-				i++;
-		}
+			user.wait_time = row[c++].i();
 	}
-	catch (Cdatabase::exception&)
+	p4p::detail::ScopedExclusiveLock reload_lock(m_reload_mutex);
+	BOOST_FOREACH(t_users::reference i, users)
 	{
+		t_users::const_iterator j = m_users.find(i.first);
+		if (j == m_users.end())
+			continue;
+		i.second.completes = j->second.completes;
+		i.second.incompletes = j->second.incompletes;
 	}
+	m_users.swap(users);
+	m_users_torrent_passes.swap(users_torrent_passes);
 }
 
 void Cserver::write_db_files()
@@ -809,61 +957,75 @@ void Cserver::write_db_files()
 	m_write_db_files_time = time();
 	if (!m_use_sql)
 		return;
+	std::string buffer;
+	std::string new_files;
+	std::string new_info_hashes;
 	try
 	{
-		std::string buffer;
-		BOOST_FOREACH(t_files::reference i, m_files)
+		BOOST_FOREACH(t_shards::reference shard, m_shards)
 		{
-			t_file& file = i.second;
-			if (!file.dirty)
-				continue;
-			if (!file.fid)
+			p4p::detail::ScopedExclusiveLock shard_lock(shard.mutex);
+			BOOST_FOREACH(t_files::reference i, shard.files)
 			{
-				Csql_query(m_database, "insert into ? (info_hash, mtime, ctime) values (?, unix_timestamp(), unix_timestamp())").p_name(table_name(table_files)).p(i.first).execute();
-				file.fid = m_database.insert_id();
+				t_file& file = i.second;
+				if (!file.dirty)
+					continue;
+				if (!file.fid)
+				{
+					/* New files stay dirty until read_db_files_fids hands
+					 * them the fid allocated below.
+					 */
+					new_files += Csql_query(m_database, "(?,unix_timestamp(),unix_timestamp()),").p(i.first).read();
+					new_info_hashes += Csql_query(m_database, "?,").p(i.first).read();
+					continue;
+				}
+				buffer += Csql_query(m_database, "(?,?,?,?),").p(file.leechers).p(file.seeders).p(file.completed).p(file.fid).read();
+				file.dirty = false;
 			}
-			buffer += Csql_query(m_database, "(?,?,?,?),").p(file.leechers).p(file.seeders).p(file.completed).p(file.fid).read();
-			file.dirty = false;
-		}
-		if (!buffer.empty())
-		{
-			buffer.erase(buffer.size() - 1);
-			m_database.query("insert into " + table_name(table_files) + " (" + column_name(column_files_leechers) + ", " + column_name(column_files_seeders) + ", " + column_name(column_files_completed) + ", " + column_name(column_files_fid) + ") values "
-				+ buffer
-				+ " on duplicate key update"
-				+ "  " + column_name(column_files_leechers) + " = values(" + column_name(column_files_leechers) + "),"
-				+ "  " + column_name(column_files_seeders) + " = values(" + column_name(column_files_seeders) + "),"
-				+ "  " + column_name(column_files_completed) + " = values(" + column_name(column_files_completed) + "),"
-				+ "  mtime = unix_timestamp()");
 		}
 	}
 	catch (Cdatabase::exception&)
 	{
 	}
-	if (!m_announce_log_buffer.empty())
+	if (!new_files.empty())
 	{
-		try
-		{
-			m_announce_log_buffer.erase(m_announce_log_buffer.size() - 1);
-			m_database.query("insert delayed into " + table_name(table_announce_log) + " (ipa, port, event, info_hash, peer_id, downloaded, left0, uploaded, uid, mtime) values " + m_announce_log_buffer);
-		}
-		catch (Cdatabase::exception&)
-		{
-		}
-		m_announce_log_buffer.erase();
+		/* Allocated on the writer connection, which runs the select after
+		 * the insert; insert ignore keeps a retry from failing the batch.
+		 */
+		new_files.erase(new_files.size() - 1);
+		new_info_hashes.erase(new_info_hashes.size() - 1);
+		m_db_writer.write("insert ignore into " + table_name(table_files) + " (info_hash, mtime, ctime) values " + new_files);
+		m_db_writer.read(read_files_fids, "select info_hash, " + column_name(column_files_fid) + " from " + table_name(table_files) + " where info_hash in (" + new_info_hashes + ")");
 	}
-	if (!m_scrape_log_buffer.empty())
+	if (!buffer.empty())
 	{
-		try
-		{
-			m_scrape_log_buffer.erase(m_scrape_log_buffer.size() - 1);
-			m_database.query("insert delayed into " + table_name(table_scrape_log) + " (ipa, info_hash, mtime) values " + m_scrape_log_buffer);
-		}
-		catch (Cdatabase::exception&)
-		{
-		}
-		m_scrape_log_buffer.erase();
+		buffer.erase(buffer.size() - 1);
+		m_db_writer.write("insert into " + table_name(table_files) + " (" + column_name(column_files_leechers) + ", " + column_name(column_files_seeders) + ", " + column_name(column_files_completed) + ", " + column_name(column_files_fid) + ") values "
+			+ buffer
+			+ " on duplicate key update"
+			+ "  " + column_name(column_files_leechers) + " = values(" + column_name(column_files_leechers) + "),"
+			+ "  " + column_name(column_files_seeders) + " = values(" + column_name(column_files_seeders) + "),"
+			+ "  " + column_name(column_files_completed) + " = values(" + column_name(column_files_completed) + "),"
+			+ "  mtime = unix_timestamp()");
 	}
+	std::string announce_log_buffer;
+	std::string scrape_log_buffer;
+	{
+		p4p::detail::ScopedExclusiveLock state_lock(m_state_mutex);
+		announce_log_buffer.swap(m_announce_log_buffer);
+		scrape_log_buffer.swap(m_scrape_log_buffer);
+	}
+	if (!announce_log_buffer.empty())
+	{
+		announce_log_buffer.erase(announce_log_buffer.size() - 1);
+		m_db_writer.write("insert delayed into " + table_name(table_announce_log) + " (ipa, port, event, info_hash, peer_id, downloaded, left0, uploaded, uid, mtime) values " + announce_log_buffer, true);
+	}
+	if (!scrape_log_buffer.empty())
+	{
+		scrape_log_buffer.erase(scrape_log_buffer.size() - 1);
+		m_db_writer.write("insert delayed into " + table_name(table_scrape_log) + " (ipa, info_hash, mtime) values " + scrape_log_buffer, true);
+	}
+	read_db_results();
 }
 
 void Cserver::write_db_users()
@@ -871,53 +1033,46 @@ void Cserver::write_db_users()
 	m_write_db_users_time = time();
 	if (!m_use_sql)
 		return;
-	if (!m_files_users_updates_buffer.empty())
+	std::string files_users_updates_buffer;
+	std::string users_updates_buffer;
 	{
-		m_files_users_updates_buffer.erase(m_files_users_updates_buffer.size() - 1);
-		try
-		{
-			m_database.query("insert into " + table_name(table_files_users) + " (active, announced, completed, downloaded, `left`, uploaded, mtime, fid, uid) values "
-				+ m_files_users_updates_buffer
-				+ " on duplicate key update"
-				+ "  active = values(active),"
-				+ "  announced = announced + values(announced),"
-				+ "  completed = completed + values(completed),"
-				+ "  downloaded = downloaded + values(downloaded),"
-				+ "  `left` = if(values(`left`) = -1, `left`, values(`left`)),"
-				+ "  uploaded = uploaded + values(uploaded),"
-				+ "  mtime = if(values(mtime) = -1, mtime, values(mtime))");
-		}
-		catch (Cdatabase::exception&)
-		{
-		}
-		m_files_users_updates_buffer.erase();
+		p4p::detail::ScopedExclusiveLock state_lock(m_state_mutex);
+		files_users_updates_buffer.swap(m_files_users_updates_buffer);
+		users_updates_buffer.swap(m_users_updates_buffer);
 	}
-	if (!m_users_updates_buffer.empty())
+	if (!files_users_updates_buffer.empty())
 	{
-		m_users_updates_buffer.erase(m_users_updates_buffer.size() - 1);
-		try
-		{
-			m_database.query("insert into " + table_name(table_users) + " (downloaded, uploaded, " + column_name(column_users_uid) + ") values "
-				+ m_users_updates_buffer
-				+ " on duplicate key update"
-				+ "  downloaded = downloaded + values(downloaded),"
-				+ "  uploaded = uploaded + values(uploaded)");
-		}
-		catch (Cdatabase::exception&)
-		{
-		}
-		m_users_updates_buffer.erase();
+		files_users_updates_buffer.erase(files_users_updates_buffer.size() - 1);
+		m_db_writer.write("insert into " + table_name(table_files_users) + " (active, announced, completed, downloaded, `left`, uploaded, mtime, fid, uid) values "
+			+ files_users_updates_buffer
+			+ " on duplicate key update"
+			+ "  active = values(active),"
+			+ "  announced = announced + values(announced),"
+			+ "  completed = completed + values(completed),"
+			+ "  downloaded = downloaded + values(downloaded),"
+			+ "  `left` = if(values(`left`) = -1, `left`, values(`left`)),"
+			+ "  uploaded = uploaded + values(uploaded),"
+			+ "  mtime = if(values(mtime) = -1, mtime, values(mtime))");
+	}
+	if (!users_updates_buffer.empty())
+	{
+		users_updates_buffer.erase(users_updates_buffer.size() - 1);
+		m_db_writer.write("insert into " + table_name(table_users) + " (downloaded, uploaded, " + column_name(column_users_uid) + ") values "
+			+ users_updates_buffer
+			+ " on duplicate key update"
+			+ "  downloaded = downloaded + values(downloaded),"
+			+ "  uploaded = uploaded + values(uploaded)");
 	}
 }
 
 void Cserver::read_config()
 {
+	Cconfig config;
 	if (m_use_sql)
 	{
 		try
 		{
 			Csql_result result = m_database.query("select name, value from " + table_name(table_config) + " where value is not null");
-			Cconfig config;
 			for (Csql_row row; row = result.fetch_row(); )
 			{
 				if (config.set(row[0].s(), row[1].s()))
@@ -929,22 +1084,22 @@ void Cserver::read_config()
 				config.m_torrent_pass_private_key = generate_random_string(27);
 				Csql_query(m_database, "insert into xbt_config (name, value) values ('torrent_pass_private_key', ?)").p(config.m_torrent_pass_private_key).execute();
 			}
-			m_config = config;
 		}
 		catch (Cdatabase::exception&)
 		{
+			config = m_config;
 		}
 	}
-	else
+	else if (config.load(m_conf_file))
+		config = m_config;
+	if (config.m_listen_ipas.empty())
+		config.m_listen_ipas.insert(htonl(INADDR_ANY));
+	if (config.m_listen_ports.empty())
+		config.m_listen_ports.insert(2710);
 	{
-		Cconfig config;
-		if (!config.load(m_conf_file))
-			m_config = config;
+		p4p::detail::ScopedExclusiveLock reload_lock(m_reload_mutex);
+		m_config = config;
 	}
-	if (m_config.m_listen_ipas.empty())
-		m_config.m_listen_ipas.insert(htonl(INADDR_ANY));
-	if (m_config.m_listen_ports.empty())
-		m_config.m_listen_ports.insert(2710);
 	m_read_config_time = time();
 }
 
@@ -971,25 +1126,30 @@ std::string Cserver::debug(const Ctracker_input& ti) const
 	os << "<table>";
 	if (ti.m_info_hash.empty())
 	{
-		BOOST_FOREACH(t_files::const_reference i, m_files)
+		BOOST_FOREACH(t_shards::const_reference shard, m_shards)
 		{
-			if (!i.second.leechers && !i.second.seeders)
-				continue;
-			leechers += i.second.leechers;
-			seeders += i.second.seeders;
-			torrents++;
-			os << "<tr><td align=right>" << i.second.fid
-				<< "<td><a href=\"?info_hash=" << uri_encode(i.first) << "\">" << hex_encode(i.first) << "</a>"
-				<< "<td>" << (i.second.dirty ? '*' : ' ')
-				<< "<td align=right>" << i.second.leechers
-				<< "<td align=right>" << i.second.seeders;
+			p4p::detail::ScopedSharedLock shard_lock(shard.mutex);
+			BOOST_FOREACH(t_files::const_reference i, shard.files)
+			{
+				if (!i.second.leechers && !i.second.seeders)
+					continue;
+				leechers += i.second.leechers;
+				seeders += i.second.seeders;
+				torrents++;
+				os << "<tr><td align=right>" << i.second.fid
+					<< "<td><a href=\"?info_hash=" << uri_encode(i.first) << "\">" << hex_encode(i.first) << "</a>"
+					<< "<td>" << (i.second.dirty ? '*' : ' ')
+					<< "<td align=right>" << i.second.leechers
+					<< "<td align=right>" << i.second.seeders;
+			}
 		}
 	}
 	else
 	{
-		t_files::const_iterator i = m_files.find(ti.m_info_hash);
-		if (i != m_files.end())
-			i->second.debug(os);
+		const t_shard& shard = this->shard(ti.m_info_hash);
+		p4p::detail::ScopedSharedLock shard_lock(shard.mutex);
+		if (const t_file* f = file(ti.m_info_hash))
+			f->debug(os);
 	}
 	os << "</table>";
 	return os.str();
@@ -1002,11 +1162,15 @@ std::string Cserver::statistics() const
 	int leechers = 0;
 	int seeders = 0;
 	int torrents = 0;
-	BOOST_FOREACH(t_files::const_reference i, m_files)
+	BOOST_FOREACH(t_shards::const_reference shard, m_shards)
 	{
-		leechers += i.second.leechers;
-		seeders += i.second.seeders;
-		torrents += i.second.leechers || i.second.seeders;
+		p4p::detail::ScopedSharedLock shard_lock(shard.mutex);
+		BOOST_FOREACH(t_files::const_reference i, shard.files)
+		{
+			leechers += i.second.leechers;
+			seeders += i.second.seeders;
+			torrents += i.second.leechers || i.second.seeders;
+		}
 	}
 	time_t t = time();
 	os << "<table><tr><td>leechers<td align=right>" << leechers
@@ -1037,6 +1201,8 @@ std::string Cserver::statistics() const
 		<< "<tr><td>anonymous scrape<td align=right>" << m_config.m_anonymous_scrape
 		<< "<tr><td>auto register<td align=right>" << m_config.m_auto_register
 		<< "<tr><td>full scrape<td align=right>" << m_config.m_full_scrape
+		<< "<tr><td>worker threads<td align=right>" << m_workers.size()
+		<< "<tr><td>shards<td align=right>" << m_shards.size()
 		<< "<tr><td>read config time<td align=right>" << t - m_read_config_time << " / " << m_config.m_read_config_interval
 		<< "<tr><td>clean up time<td align=right>" << t - m_clean_up_time << " / " << m_config.m_clean_up_interval
 		<< "<tr><td>read db files time<td align=right>" << t - m_read_db_files_time << " / " << m_config.m_read_db_interval;
@@ -1044,7 +1210,11 @@ std::string Cserver::statistics() const
 	{
 		os << "<tr><td>read db users time<td align=right>" << t - m_read_db_users_time << " / " << m_config.m_read_db_interval
 			<< "<tr><td>write db files time<td align=right>" << t - m_write_db_files_time << " / " << m_config.m_write_db_interval
-			<< "<tr><td>write db users time<td align=right>" << t - m_write_db_users_time << " / " << m_config.m_write_db_interval;
+			<< "<tr><td>write db users time<td align=right>" << t - m_write_db_users_time << " / " << m_config.m_write_db_interval
+			<< "<tr><td>db queue<td align=right>" << m_db_writer.c_queued()
+			<< "<tr><td>db written<td align=right>" << m_db_writer.c_written()
+			<< "<tr><td>db failed<td align=right>" << m_db_writer.c_failed()
+			<< "<tr><td>db dropped<td align=right>" << m_db_writer.c_dropped();
 	}
 	os << "</table>";
 	return os.str();
@@ -2,13 +2,17 @@
 
 #include "config.h"
 #include "connection.h"
+#include "db_writer.h"
 #include "epoll.h"
 #include "stats.h"
 #include "tcp_listen_socket.h"
 #include "tracker_input.h"
 #include "udp_listen_socket.h"
+#include "worker.h"
 #include <boost/array.hpp>
-#include <boost/ptr_container/ptr_list.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/unordered_map.hpp>
 #include <map>
 #include <sql/database.h>
 #include <xbt/virtual_binary.h>
@@ -16,6 +20,7 @@
 /* Include P4P library */
 #include <p4p/p4p.h>
 #include <p4p/app/p4papp.h>
+#include <p4p/detail/mutex.h>
 
 class Cserver
 {
@@ -44,6 +49,25 @@ public:
 #endif
 		}
 
+		bool operator==(peer_key_c v) const
+		{
+#ifdef PEERS_KEY
+			return host_ == v.host_ && uid_ == v.uid_;
+#else
+			return host_ == v.host_;
+#endif
+		}
+
+		friend size_t hash_value(peer_key_c v)
+		{
+			size_t seed = 0;
+			boost::hash_combine(seed, v.host_);
+#ifdef PEERS_KEY
+			boost::hash_combine(seed, v.uid_);
+#endif
+			return seed;
+		}
+
 		int host_;
 #ifdef PEERS_KEY
 		int uid_;
@@ -81,25 +105,53 @@ public:
 		uint32_t ipaddr;
 	};
 
-	typedef std::map<peer_key_c, t_peer> t_peers;
+	typedef boost::unordered_map<peer_key_c, t_peer> t_peers;
 
 	struct t_deny_from_host
 	{
 		unsigned int begin;
-		bool marked;
 	};
 
+	struct t_shard;
+
+	/* Compact (6 bytes per peer) list selected by the guidance for the
+	 * peers of one PID. Announces from that PID take a random slice of it
+	 * until the swarm churns, the guidance is recomputed or it expires.
+	 */
+	struct t_peer_block
+	{
+		/* Whether the block may still be served: it has not expired, it
+		 * was selected under the current guidance, and the torrent has
+		 * not churned through too many of its peers since */
+		bool fresh(time_t now, int ttl, time_t guidance, int file_churn) const
+		{
+			return ctime + ttl > now
+				&& guidance_time == guidance
+				&& 4 * (file_churn - churn) <= static_cast<int>(peers.size() / 6);
+		}
+
+		std::string peers;
+		time_t ctime;
+		time_t guidance_time;
+		int churn;
+	};
+
+	typedef std::pair<const p4p::ISP*, int> t_peer_block_key;
+	typedef std::map<t_peer_block_key, t_peer_block> t_peer_blocks;
+
 	struct t_file
 	{
 		void clean_up(time_t t, Cserver&);
 		void debug(std::ostream&) const;
-		std::string select_peers(const Ctracker_input&) const;
+		std::string select_peers(const Ctracker_input&, const Cserver&, const t_shard&) const;
+		bool select_cached_peers(const t_peer&, size_t c, const Cserver&, const t_shard&, std::string&) const;
 
 		t_file()
 		{
 			isp_mgr = NULL;
 			update_mgr = NULL;
 			selection_mgr = NULL;
+			churn = 0;
 			completed = 0;
 			dirty = true;
 			fid = 0;
@@ -114,7 +166,7 @@ public:
 		{
 			isp_mgr = isp_mgr_;
 			update_mgr = update_mgr_;
-			selection_mgr = new p4p::app::PGMSelectionManager(*isp_mgr);
+			selection_mgr = new p4p::app::PGMSelectionManager(isp_mgr);
 			update_mgr->addSelectionManager(selection_mgr);
 
 			/* We'll just use Location-only guidance for now. The Application
@@ -132,7 +184,9 @@ public:
 		}
 
 		t_peers peers;
+		mutable t_peer_blocks peer_blocks;
 		time_t ctime;
+		int churn;
 		int completed;
 		int fid;
 		int leechers;
@@ -159,7 +213,6 @@ public:
 		}
 
 		bool can_leech;
-		bool marked;
 		int uid;
 		int completes;
 		int incompletes;
@@ -169,37 +222,86 @@ public:
 		int wait_time;
 	};
 
-	typedef std::map<std::string, t_file> t_files;
+	struct t_file_counts
+	{
+		t_file_counts()
+		{
+			completed = 0;
+			leechers = 0;
+			seeders = 0;
+		}
+
+		int completed;
+		int leechers;
+		int seeders;
+	};
+
+	typedef boost::unordered_map<std::string, t_file> t_files;
+
+	/* Torrents are sharded by info hash. A shard's mutex guards its files,
+	 * their peer tables and their selection managers; it is taken shared
+	 * for peer selection and scrapes and exclusively for announces. Peer
+	 * selection under the shared lock fills peer_blocks under cache_mutex.
+	 */
+	struct t_shard
+	{
+		t_files files;
+		p4p::detail::SharedMutex mutex;
+		mutable p4p::detail::SharedMutex cache_mutex;	/* peer_blocks of the files */
+	};
+
+	typedef boost::ptr_vector<t_shard> t_shards;
 	typedef std::map<unsigned int, t_deny_from_host> t_deny_from_hosts;
 	typedef std::map<int, t_user> t_users;
 	typedef std::map<std::string, t_user*> t_users_torrent_passes;
 
 	int test_sql();
-	void accept(const Csocket&);
+	bool accept_host(unsigned int ipa);
 	t_user* find_user_by_torrent_pass(const std::string&, const std::string& info_hash);
 	t_user* find_user_by_uid(int);
 	void read_config();
 	void write_db_files();
 	void write_db_users();
 	void read_db_deny_from_hosts();
+	void read_db_deny_from_hosts(const Csql_result&);
 	void read_db_files();
 	void read_db_files_sql();
+	void read_db_files(const Csql_result&);
+	void read_db_files_deleted(const Csql_result&);
+	void read_db_files_fids(const Csql_result&);
+	void read_db_results();
 	void read_db_users();
+	void read_db_users(const Csql_result&);
 	void clean_up();
 	std::string insert_peer(const Ctracker_input&, bool udp, t_user*);
 	std::string debug(const Ctracker_input&) const;
 	std::string statistics() const;
 	Cvirtual_binary select_peers(const Ctracker_input&) const;
+	bool select_peers(const Ctracker_input&, std::string& peers, t_file_counts&) const;
+	t_file_counts file_counts(const std::string& id) const;
 	Cvirtual_binary scrape(const Ctracker_input&);
+	void count(long long& v);
 	int run();
 	static void term();
 	Cserver(Cdatabase&, const std::string& table_prefix, bool use_sql, const std::string& conf_file);
 	~Cserver();
 
+	t_shard& shard(const std::string& id)
+	{
+		return m_shards[boost::hash<std::string>()(id) % m_shards.size()];
+	}
+
+	const t_shard& shard(const std::string& id) const
+	{
+		return m_shards[boost::hash<std::string>()(id) % m_shards.size()];
+	}
+
+	/* The caller must hold the mutex of shard(id). */
 	const t_file* file(const std::string& id) const
 	{
-		t_files::const_iterator i = m_files.find(id);
-		return i == m_files.end() ? NULL : &i->second;
+		const t_files& files = shard(id).files;
+		t_files::const_iterator i = files.find(id);
+		return i == files.end() ? NULL : &i->second;
 	}
 
 	const Cconfig& config() const
@@ -221,6 +323,20 @@ public:
 	{
 		return m_time;
 	}
+
+	void update_time()
+	{
+		m_time = ::time(NULL);
+	}
+
+	/* Workers hold this shared while processing a request; the main thread
+	 * takes it exclusively when reloading the config, users and denied hosts.
+	 * Pointers returned by find_user_* stay valid while it is held.
+	 */
+	const p4p::detail::SharedMutex& reload_mutex() const
+	{
+		return m_reload_mutex;
+	}
 private:
 	enum
 	{
@@ -236,11 +352,12 @@ private:
 		table_files_users,
 		table_scrape_log,
 		table_users,
+		/* Tags of the other reads queued on m_db_writer */
+		read_files_deleted,
+		read_files_fids,
 	};
 
-	typedef boost::ptr_list<Cconnection> t_connections;
-	typedef std::list<Ctcp_listen_socket> t_tcp_sockets;
-	typedef std::list<Cudp_listen_socket> t_udp_sockets;
+	typedef boost::ptr_vector<Cworker> t_workers;
 
 	static void sig_handler(int v);
 	std::string column_name(int v) const;
@@ -265,11 +382,11 @@ private:
 	time_t m_write_db_users_time;
 	int m_fid_end;
 	long long m_secret;
-	t_connections m_connections;
 	Cdatabase& m_database;
-	Cepoll m_epoll;
+	Cdb_writer m_db_writer;
 	t_deny_from_hosts m_deny_from_hosts;
-	t_files m_files;
+	t_shards m_shards;
+	t_workers m_workers;
 	t_users m_users;
 	t_users_torrent_passes m_users_torrent_passes;
 	std::string m_announce_log_buffer;
@@ -281,4 +398,7 @@ private:
 
 	p4p::ISPManager isp_mgr;
 	p4p::app::P4PUpdateManager* update_mgr;
+
+	p4p::detail::SharedMutex m_reload_mutex;
+	p4p::detail::SharedMutex m_state_mutex;	/* user counters, SQL buffers and stats */
 };
@@ -1,20 +1,22 @@
 #include "stdafx.h"
 #include "tcp_listen_socket.h"
 
-#include "server.h"
+#include "worker.h"
 
 Ctcp_listen_socket::Ctcp_listen_socket()
 {
 	m_server = NULL;
+	m_worker = NULL;
 }
 
-Ctcp_listen_socket::Ctcp_listen_socket(Cserver* server, const Csocket& s)
+Ctcp_listen_socket::Ctcp_listen_socket(Cworker* worker, const Csocket& s)
 {
-	m_server = server;
+	m_server = &worker->server();
+	m_worker = worker;
 	m_s = s;
 }
 
 void Ctcp_listen_socket::process_events(int events)
 {
-	m_server->accept(m_s);
+	m_worker->accept(m_s);
 }
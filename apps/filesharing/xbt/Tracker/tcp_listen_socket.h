@@ -2,7 +2,7 @@
 
 #include "client.h"
 
-class Cserver;
+class Cworker;
 
 class Ctcp_listen_socket: public Cclient
 {
@@ -10,5 +10,7 @@ public:
 	virtual void process_events(int);
 	Cclient::s;
 	Ctcp_listen_socket();
-	Ctcp_listen_socket(Cserver*, const Csocket&);
+	Ctcp_listen_socket(Cworker*, const Csocket&);
+private:
+	Cworker* m_worker;
 };
@@ -40,6 +40,7 @@ void Ctransaction::recv()
 		}
 		if (r < uti_size)
 			return;
+		p4p::detail::ScopedSharedLock reload_lock(m_server.reload_mutex());
 		switch (read_int(4, b + uti_action, b + r))
 		{
 		case uta_connect:
@@ -99,17 +100,17 @@ void Ctransaction::send_announce(const_memory_range r)
 		send_error(r, error);
 		return;
 	}
-	const Cserver::t_file* file = m_server.file(ti.m_info_hash);
-	if (!file)
+	std::string peers;
+	Cserver::t_file_counts counts;
+	if (!m_server.select_peers(ti, peers, counts))
 		return;
 	const int cb_d = 2 << 10;
 	char d[cb_d];
 	write_int(4, d + uto_action, uta_announce);
 	write_int(4, d + uto_transaction_id, read_int(4, r + uti_transaction_id, r.end));
 	write_int(4, d + utoa_interval, m_server.config().m_announce_interval);
-	write_int(4, d + utoa_leechers, file->leechers);
-	write_int(4, d + utoa_seeders, file->seeders);
-	std::string peers = file->select_peers(ti);
+	write_int(4, d + utoa_leechers, counts.leechers);
+	write_int(4, d + utoa_seeders, counts.seeders);
 	memcpy(d + utoa_size, peers.data(), peers.size());
 	send(const_memory_range(d, d + utoa_size + peers.size()));
 }
@@ -130,20 +131,12 @@ void Ctransaction::send_scrape(const_memory_range r)
 	char* w = d + utos_size;
 	for (r += utis_size; r + 20 <= r.end && w + 12 <= d + cb_d; r += 20)
 	{
-		if (const Cserver::t_file* file = m_server.file(r.sub_range(0, 20).string()))
-		{
-			w = write_int(4, w, file->seeders);
-			w = write_int(4, w, file->completed);
-			w = write_int(4, w, file->leechers);
-		}
-		else
-		{
-			w = write_int(4, w, 0);
-			w = write_int(4, w, 0);
-			w = write_int(4, w, 0);
-		}
+		Cserver::t_file_counts counts = m_server.file_counts(r.sub_range(0, 20).string());
+		w = write_int(4, w, counts.seeders);
+		w = write_int(4, w, counts.completed);
+		w = write_int(4, w, counts.leechers);
 	}
-	m_server.stats().scraped_udp++;
+	m_server.count(m_server.stats().scraped_udp);
 	send(const_memory_range(d, w));
 }
 
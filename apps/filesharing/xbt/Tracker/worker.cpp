@@ -0,0 +1,186 @@
+#include "stdafx.h"
+#include "worker.h"
+
+#include <iostream>
+#include "server.h"
+#include "transaction.h"
+
+Cworker::Cworker(Cserver& server, bool update_time):
+	m_server(server)
+{
+	m_run_time = 0;
+	m_update_time = update_time;
+}
+
+int Cworker::open(bool reuse_port)
+{
+	if (m_epoll.create(1 << 10) == -1)
+	{
+		std::cerr << "epoll_create failed" << std::endl;
+		return 1;
+	}
+	const Cconfig& config = m_server.config();
+	BOOST_FOREACH(Cconfig::t_listen_ipas::const_reference j, config.m_listen_ipas)
+	{
+		BOOST_FOREACH(Cconfig::t_listen_ports::const_reference i, config.m_listen_ports)
+		{
+			Csocket l;
+			if (l.open(SOCK_STREAM) == INVALID_SOCKET)
+				std::cerr << "socket failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
+			else if (l.setsockopt(SOL_SOCKET, SO_REUSEADDR, true),
+#ifdef SO_REUSEPORT
+				reuse_port && l.setsockopt(SOL_SOCKET, SO_REUSEPORT, true),
+#endif
+				l.bind(j, htons(i)))
+				std::cerr << "bind failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
+			else if (l.listen())
+				std::cerr << "listen failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
+			else
+			{
+#ifdef SO_ACCEPTFILTER
+				accept_filter_arg afa;
+				bzero(&afa, sizeof(afa));
+				strcpy(afa.af_name, "httpready");
+				if (l.setsockopt(SOL_SOCKET, SO_ACCEPTFILTER, &afa, sizeof(afa)))
+					std::cerr << "setsockopt failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
+#elif TCP_DEFER_ACCEPT
+				if (l.setsockopt(IPPROTO_TCP, TCP_DEFER_ACCEPT, true))
+					std::cerr << "setsockopt failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
+#endif
+				m_tcp_sockets.push_back(Ctcp_listen_socket(this, l));
+				if (!m_epoll.ctl(EPOLL_CTL_ADD, l, EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLERR | EPOLLHUP, &m_tcp_sockets.back()))
+					continue;
+			}
+			return 1;
+		}
+		BOOST_FOREACH(Cconfig::t_listen_ports::const_reference i, config.m_listen_ports)
+		{
+			Csocket l;
+			if (l.open(SOCK_DGRAM) == INVALID_SOCKET)
+				std::cerr << "socket failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
+			else if (l.setsockopt(SOL_SOCKET, SO_REUSEADDR, true),
+#ifdef SO_REUSEPORT
+				reuse_port && l.setsockopt(SOL_SOCKET, SO_REUSEPORT, true),
+#endif
+				l.bind(j, htons(i)))
+				std::cerr << "bind failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
+			else
+			{
+				m_udp_sockets.push_back(Cudp_listen_socket(&m_server, l));
+				if (!m_epoll.ctl(EPOLL_CTL_ADD, l, EPOLLIN | EPOLLPRI | EPOLLERR | EPOLLHUP, &m_udp_sockets.back()))
+					continue;
+			}
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void Cworker::accept(const Csocket& l)
+{
+	sockaddr_in a;
+	while (1)
+	{
+		socklen_t cb_a = sizeof(sockaddr_in);
+		Csocket s = ::accept(l, reinterpret_cast<sockaddr*>(&a), &cb_a);
+		if (s == SOCKET_ERROR)
+		{
+			if (WSAGetLastError() == WSAECONNABORTED)
+				continue;
+			if (WSAGetLastError() != WSAEWOULDBLOCK)
+				std::cerr << "accept failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
+			break;
+		}
+		if (!m_server.accept_host(ntohl(a.sin_addr.s_addr)))
+			continue;
+		if (s.blocking(false))
+			std::cerr << "ioctlsocket failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
+		std::auto_ptr<Cconnection> connection(new Cconnection(&m_server, s, a));
+		connection->process_events(EPOLLIN);
+		if (connection->s() != INVALID_SOCKET)
+		{
+			m_connections.push_back(connection.release());
+			m_epoll.ctl(EPOLL_CTL_ADD, m_connections.back().s(), EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLERR | EPOLLHUP | EPOLLET, &m_connections.back());
+		}
+	}
+}
+
+void Cworker::poll(int timeout)
+{
+#ifdef EPOLL
+	const int c_events = 64;
+
+	epoll_event events[c_events];
+	int r = m_epoll.wait(events, c_events, timeout);
+	if (r == -1)
+	{
+		if (errno != EINTR)
+			std::cerr << "epoll_wait failed: " << errno << std::endl;
+		return;
+	}
+	if (m_update_time)
+		m_server.update_time();
+	for (int i = 0; i < r; i++)
+		reinterpret_cast<Cclient*>(events[i].data.ptr)->process_events(events[i].events);
+	if (m_server.time() == m_run_time)
+		return;
+	m_run_time = m_server.time();
+	for (t_connections::iterator i = m_connections.begin(); i != m_connections.end(); )
+	{
+		if (i->run())
+			i = m_connections.erase(i);
+		else
+			i++;
+	}
+#else
+	fd_set fd_read_set;
+	fd_set fd_write_set;
+	fd_set fd_except_set;
+	FD_ZERO(&fd_read_set);
+	FD_ZERO(&fd_write_set);
+	FD_ZERO(&fd_except_set);
+	int n = 0;
+	BOOST_FOREACH(t_connections::reference i, m_connections)
+	{
+		int z = i.pre_select(&fd_read_set, &fd_write_set);
+		n = std::max(n, z);
+	}
+	BOOST_FOREACH(t_tcp_sockets::reference i, m_tcp_sockets)
+	{
+		FD_SET(i.s(), &fd_read_set);
+		n = std::max<int>(n, i.s());
+	}
+	BOOST_FOREACH(t_udp_sockets::reference i, m_udp_sockets)
+	{
+		FD_SET(i.s(), &fd_read_set);
+		n = std::max<int>(n, i.s());
+	}
+	timeval tv;
+	tv.tv_sec = timeout / 1000;
+	tv.tv_usec = timeout % 1000 * 1000;
+	if (select(n + 1, &fd_read_set, &fd_write_set, &fd_except_set, &tv) == SOCKET_ERROR)
+	{
+		std::cerr << "select failed: " << Csocket::error2a(WSAGetLastError()) << std::endl;
+		return;
+	}
+	if (m_update_time)
+		m_server.update_time();
+	BOOST_FOREACH(t_tcp_sockets::reference i, m_tcp_sockets)
+	{
+		if (FD_ISSET(i.s(), &fd_read_set))
+			accept(i.s());
+	}
+	BOOST_FOREACH(t_udp_sockets::reference i, m_udp_sockets)
+	{
+		if (FD_ISSET(i.s(), &fd_read_set))
+			Ctransaction(m_server, i.s()).recv();
+	}
+	for (t_connections::iterator i = m_connections.begin(); i != m_connections.end(); )
+	{
+		if (i->post_select(&fd_read_set, &fd_write_set))
+			i = m_connections.erase(i);
+		else
+			i++;
+	}
+#endif
+}
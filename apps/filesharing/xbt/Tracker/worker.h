@@ -0,0 +1,41 @@
+#pragma once
+
+#include "connection.h"
+#include "epoll.h"
+#include "tcp_listen_socket.h"
+#include "udp_listen_socket.h"
+#include <boost/ptr_container/ptr_list.hpp>
+#include <list>
+
+class Cserver;
+
+/* A worker owns an epoll set, its own listen sockets and the connections
+ * accepted on them. With SO_REUSEPORT every worker binds the configured
+ * addresses itself and the kernel spreads incoming requests across them;
+ * torrent state is not owned by a worker but by the server's shards.
+ */
+class Cworker: boost::noncopyable
+{
+public:
+	void accept(const Csocket&);
+	int open(bool reuse_port);
+	void poll(int timeout);
+	Cworker(Cserver&, bool update_time);
+
+	Cserver& server()
+	{
+		return m_server;
+	}
+private:
+	typedef boost::ptr_list<Cconnection> t_connections;
+	typedef std::list<Ctcp_listen_socket> t_tcp_sockets;
+	typedef std::list<Cudp_listen_socket> t_udp_sockets;
+
+	Cserver& m_server;
+	Cepoll m_epoll;
+	t_connections m_connections;
+	t_tcp_sockets m_tcp_sockets;
+	t_udp_sockets m_udp_sockets;
+	time_t m_run_time;
+	bool m_update_time;
+};
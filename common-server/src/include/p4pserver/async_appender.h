@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef ASYNC_APPENDER_H
+#define ASYNC_APPENDER_H
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+#include <log4cpp/LayoutAppender.hh>
+#include <log4cpp/LoggingEvent.hh>
+#include <log4cpp/TimeStamp.hh>
+#include <p4pserver/compiler.h>
+
+/**
+ * Appender which hands events to a background thread, so that a thread
+ * logging a message never waits for the output to be written.
+ *
+ * Each logging thread copies its events into its own bounded ring without
+ * taking any locks. A drain thread periodically empties the rings, orders
+ * the batch by timestamp, and writes it either to a file descriptor
+ * (formatted with this appender's layout, in as few writes as possible) or
+ * to another appender such as a SyslogAppender. When a thread's ring is
+ * full, further events from that thread are dropped and counted, and the
+ * drain thread reports the number dropped.
+ */
+class p4p_common_server_EXPORT AsyncAppender : public log4cpp::LayoutAppender
+{
+public:
+	/**
+	 * Write to a file descriptor.
+	 * @param name		Appender name
+	 * @param fd		File descriptor; closed with the appender unless it is stdout or stderr
+	 * @param capacity	Events buffered per logging thread
+	 */
+	AsyncAppender(const std::string& name, int fd, unsigned int capacity);
+
+	/**
+	 * Forward to another appender from the drain thread.
+	 * @param name		Appender name
+	 * @param target	Appender receiving the events; owned by this appender
+	 * @param capacity	Events buffered per logging thread
+	 */
+	AsyncAppender(const std::string& name, log4cpp::Appender* target, unsigned int capacity);
+
+	virtual ~AsyncAppender();
+
+	virtual bool reopen();
+
+	/**
+	 * Write out all buffered events and stop the drain thread. Events
+	 * logged afterwards are dropped.
+	 */
+	virtual void close();
+
+	/**
+	 * Get the number of events dropped because a thread's buffer was full.
+	 */
+	unsigned long long get_dropped() const;
+
+protected:
+	virtual void _append(const log4cpp::LoggingEvent& event);
+
+private:
+	struct Event
+	{
+		std::string category;
+		std::string message;
+		std::string ndc;
+		std::string thread;
+		log4cpp::Priority::Value priority;
+		log4cpp::TimeStamp timestamp;
+	};
+
+	/* Single-producer, single-consumer ring of events */
+	class Ring
+	{
+	public:
+		Ring(unsigned int capacity);
+
+		bool push(const log4cpp::LoggingEvent& event);
+		bool empty() const { return head_ == tail_; }
+		unsigned long long get_dropped() const { return dropped_; }
+
+		/* Consumer side */
+		unsigned long available() const;
+		const Event& front() const;
+		void pop();
+
+	private:
+		std::vector<Event> slots_;
+		unsigned long mask_;
+		volatile unsigned long head_;
+		volatile unsigned long tail_;
+		volatile unsigned long long dropped_;
+	};
+	typedef boost::shared_ptr<Ring> RingPtr;
+
+	void start();
+	Ring* get_ring();
+	void run();
+	void drain();
+	void write_batch(std::vector<log4cpp::LoggingEvent*>& batch);
+
+	unsigned int capacity_;
+	int fd_;
+	log4cpp::Appender* target_;
+
+	/* Each thread's ring, also held by 'rings_'. When a thread exits, its
+	 * reference is released and the drain thread frees the ring once it
+	 * has been emptied. */
+	boost::thread_specific_ptr<RingPtr> ring_;
+
+	mutable boost::mutex rings_mutex_;
+	std::vector<RingPtr> rings_;
+	unsigned long long dropped_retired_;
+	unsigned long long dropped_reported_;
+
+	boost::mutex drain_mutex_;
+	boost::condition drain_cond_;
+	volatile bool stopped_;
+	boost::shared_ptr<boost::thread> thread_;
+};
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef ENCODED_BODY_H
+#define ENCODED_BODY_H
+
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <p4pserver/compiler.h>
+
+class EncodedBody;
+typedef boost::shared_ptr<const EncodedBody> EncodedBodyConstPtr;
+
+/**
+ * Response body kept along with its compressed encodings, so that a body
+ * served many times is compressed once rather than on every request.
+ */
+class p4p_common_server_EXPORT EncodedBody
+{
+public:
+	typedef enum
+	{
+		IDENTITY,
+		GZIP,
+		NUM_ENCODINGS
+	} Encoding;
+
+	/**
+	 * Store a body and compress it. An encoding which does not make the
+	 * body smaller is not kept.
+	 * @param body		Uncompressed body
+	 * @param level		zlib compression level
+	 */
+	EncodedBody(const std::string& body, int level = 9);
+
+	bool has(Encoding encoding) const			{ return has_[encoding]; }
+
+	/** Body in an encoding, or uncompressed if it is not kept */
+	const std::string& get(Encoding encoding) const		{ return bodies_[has_[encoding] ? encoding : IDENTITY]; }
+
+	/** Content-Encoding of an encoding, or NULL for IDENTITY */
+	static const char* get_name(Encoding encoding);
+
+	/**
+	 * Smallest kept encoding the client accepts, given its Accept-Encoding
+	 * header (which may be NULL).
+	 */
+	Encoding select(const char* accept_encoding) const;
+
+	/** Whether an Accept-Encoding header allows an encoding */
+	static bool accepts(const char* accept_encoding, Encoding encoding);
+
+private:
+	std::string bodies_[NUM_ENCODINGS];
+	bool has_[NUM_ENCODINGS];
+};
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <p4pserver/compiler.h>
+
+/* Formatted server-sent events, shared by every stream they are queued on */
+typedef boost::shared_ptr<const std::string> EventStreamMessagePtr;
+
+class EventStream;
+typedef boost::shared_ptr<EventStream> EventStreamPtr;
+
+class EventStreamHub;
+typedef boost::shared_ptr<EventStreamHub> EventStreamHubPtr;
+
+/**
+ * Told when the reader of a stream must wait for data and when data has
+ * arrived, so that the reader's connection can be set aside in between.
+ * Both are called with the stream locked.
+ */
+class p4p_common_server_EXPORT EventStreamWaiter
+{
+public:
+	virtual ~EventStreamWaiter() {}
+	virtual void suspend() = 0;
+	virtual void resume() = 0;
+};
+
+/**
+ * Queue of messages for one subscriber of an EventStreamHub.
+ *
+ * The bytes queued are bounded. A subscriber that reads too slowly to
+ * keep up is not allowed to hold back the others or to grow its queue:
+ * once a message would take it past its limit, the messages it has not
+ * started reading are dropped and it is sent the topic's snapshot
+ * instead (a resync).
+ */
+class p4p_common_server_EXPORT EventStream
+{
+public:
+	EventStream(const std::string& topic, size_t max_buffered);
+
+	/**
+	 * Copy queued data to 'buf'. Returns the number of bytes copied, 0 if
+	 * nothing is queued yet, or -1 once the stream has been closed. When
+	 * nothing is queued, 'waiter' (if given) is suspended and resumed
+	 * once data is queued; otherwise this waits up to 'timeout' (if
+	 * positive) for data.
+	 */
+	int read(char* buf, int max, EventStreamWaiter* waiter, const boost::posix_time::time_duration& timeout);
+
+	/**
+	 * Close the stream and forget its waiter. Called when the reader goes
+	 * away, and by the hub when the topic is removed.
+	 */
+	void close();
+
+	const std::string& get_topic() const	{ return topic_; }
+	size_t get_buffered() const;
+	unsigned long long get_resyncs() const;
+	bool is_closed() const;
+
+private:
+	friend class EventStreamHub;
+
+	/* Queue 'msg', or 'snapshot' if the stream has not been sent a
+	 * snapshot yet or 'msg' does not fit. Returns false on a resync. */
+	bool push(const EventStreamMessagePtr& msg, const EventStreamMessagePtr& snapshot);
+
+	/* Close from the hub's side; the reader gets what is queued first */
+	void end();
+
+	/* Wake the reader; called with the stream locked */
+	void wake();
+
+	std::string topic_;
+	size_t max_buffered_;
+
+	mutable boost::mutex mutex_;
+	boost::condition cond_;
+	std::deque<EventStreamMessagePtr> queue_;
+	size_t offset_;			/* Bytes of the first message already read */
+	size_t buffered_;		/* Bytes queued and not yet read */
+	EventStreamWaiter* waiter_;	/* Suspended reader, if any */
+	bool synced_;			/* Sent a snapshot */
+	bool closed_;
+	unsigned long long resyncs_;
+
+	/* Position in the hub's list of the topic's streams */
+	unsigned int index_;
+};
+
+/**
+ * Publishes server-sent events to subscribers of named topics.
+ *
+ * Each topic has a current snapshot, which new subscribers are sent
+ * first, and a stream of updates relative to it. Messages are formatted
+ * once and shared by all subscribers, so publishing to thousands of
+ * subscribers only queues a pointer for each.
+ */
+class p4p_common_server_EXPORT EventStreamHub
+{
+public:
+	EventStreamHub();
+
+	/**
+	 * Format an event with the given event type and id. Lines of 'data'
+	 * are sent as separate data fields.
+	 */
+	static void append_message(std::string& out, const std::string& event, unsigned long long id, const std::string& data);
+
+	/**
+	 * Subscribe to a topic; the topic's snapshot, if it has one, is
+	 * queued immediately.
+	 */
+	EventStreamPtr subscribe(const std::string& topic, size_t max_buffered);
+
+	void unsubscribe(const EventStreamPtr& stream);
+
+	/**
+	 * Replace a topic's snapshot and queue 'update' for its subscribers.
+	 * Subscribers which have not been sent a snapshot, or cannot buffer
+	 * the update, are sent 'snapshot' instead, as are all of them if
+	 * 'update' is NULL. Returns the number of subscribers resynced.
+	 */
+	unsigned int publish(const std::string& topic, const EventStreamMessagePtr& snapshot, const EventStreamMessagePtr& update);
+
+	/**
+	 * Close the streams of a topic and forget its snapshot.
+	 */
+	void remove(const std::string& topic);
+
+	/**
+	 * Forget the snapshot of a topic nobody is subscribed to, so that it
+	 * is not sent out once stale. Returns false, leaving the topic alone,
+	 * if it has subscribers.
+	 */
+	bool remove_if_unused(const std::string& topic);
+
+	bool has_snapshot(const std::string& topic) const;
+	bool has_subscribers(const std::string& topic) const;
+	void get_topics(std::vector<std::string>& result) const;
+
+	unsigned int get_subscribers() const;
+	unsigned long long get_published() const;
+	unsigned long long get_resyncs() const;
+
+private:
+	struct Topic
+	{
+		EventStreamMessagePtr snapshot;
+		std::vector<EventStreamPtr> streams;
+	};
+	typedef std::map<std::string, Topic> TopicMap;
+
+	mutable boost::mutex mutex_;
+	TopicMap topics_;
+	unsigned int subscribers_;
+	unsigned long long published_;
+	unsigned long long resyncs_;
+};
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef INCREMENTAL_SHORTEST_PATHS_H
+#define INCREMENTAL_SHORTEST_PATHS_H
+
+#include <limits>
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
+#include <p4pserver/compiler.h>
+
+/**
+ * Shortest-path trees from every source of a weighted directed graph,
+ * kept up to date as edges are added, removed or reweighted.
+ *
+ * Nodes are identified by name and assigned a slot, which stays the same
+ * as long as the node exists. A tree is computed with Dijkstra's algorithm
+ * the first time it is requested. After that, changing an edge only
+ * repairs the trees it affects. Lowering a weight or adding an edge
+ * propagates the shorter distances outwards from the edge's target.
+ * Raising a weight or removing an edge only matters to trees in which the
+ * edge is a tree edge. In those trees, the subtree below the edge is
+ * detached and its nodes are reattached through their best remaining
+ * incoming edges.
+ *
+ * Weights must be positive. When several predecessors give a node the
+ * same distance, the one whose name sorts first is chosen. A tree is
+ * therefore determined by the graph alone, and a repaired tree is
+ * identical to one computed from scratch.
+ */
+class p4p_common_server_EXPORT IncrementalShortestPaths
+{
+public:
+	static const int NO_PRED = -1;
+
+	struct Tree
+	{
+		/* Distance from the source; infinite if unreachable */
+		std::vector<double> dist;
+
+		/* Predecessor slot; NO_PRED for the source and unreachable nodes */
+		std::vector<int> pred;
+	};
+
+	/* Edge given to sync(); endpoints are positions in the node list */
+	struct Edge
+	{
+		Edge(unsigned int src, unsigned int dst, double weight) : src(src), dst(dst), weight(weight) {}
+
+		unsigned int src;
+		unsigned int dst;
+		double weight;
+	};
+
+	IncrementalShortestPaths();
+
+	/**
+	 * Add a node, or find it if it already exists.
+	 * @returns The node's slot
+	 */
+	unsigned int add_node(const std::string& name);
+
+	/**
+	 * Remove a node and its edges.
+	 */
+	void remove_node(unsigned int slot);
+
+	bool find_node(const std::string& name, unsigned int& result) const;
+	const std::string& get_name(unsigned int slot) const	{ return names_[slot]; }
+	bool is_live(unsigned int slot) const			{ return live_[slot]; }
+
+	/**
+	 * Get the number of slots. Slots of removed nodes are included.
+	 */
+	unsigned int get_num_slots() const			{ return names_.size(); }
+	unsigned int get_num_nodes() const			{ return num_live_; }
+	unsigned int get_num_edges() const			{ return num_edges_; }
+
+	/**
+	 * Add an edge or change its weight, and repair the computed trees.
+	 * Throws std::invalid_argument if the weight is not positive.
+	 */
+	void set_edge(unsigned int src, unsigned int dst, double weight);
+
+	/**
+	 * Remove an edge if it exists, and repair the computed trees.
+	 */
+	void remove_edge(unsigned int src, unsigned int dst);
+
+	/**
+	 * Make the graph equal to the given one, applying only the
+	 * differences. If there are more than a small fraction of the edges,
+	 * the computed trees are discarded rather than repaired.
+	 * @param nodes		Node names
+	 * @param edges		Edges between positions in 'nodes'
+	 * @param slots		Set to the slot of each node in 'nodes'
+	 * @returns The number of nodes and edges which changed
+	 */
+	unsigned int sync(const std::vector<std::string>& nodes, const std::vector<Edge>& edges, std::vector<unsigned int>& slots);
+
+	/**
+	 * Get the shortest-path tree from a node, computing it if needed.
+	 * The tree is valid until the graph is next changed.
+	 */
+	const Tree& get_tree(unsigned int src);
+
+	/**
+	 * Compute a tree from scratch, without using or updating the stored
+	 * trees.
+	 */
+	void compute_tree(unsigned int src, Tree& result) const;
+
+	/**
+	 * Discard all computed trees.
+	 */
+	void clear_trees();
+
+	/**
+	 * Get a counter which changes whenever the graph changes, so callers
+	 * can tell whether slots and trees they looked up are still current.
+	 */
+	unsigned long get_generation() const			{ return generation_; }
+
+	/* Number of trees computed from scratch, and of repairs to trees */
+	unsigned long long get_full_computations() const	{ return full_computations_; }
+	unsigned long long get_repairs() const			{ return repairs_; }
+
+private:
+	struct Arc
+	{
+		Arc(unsigned int node, double weight) : node(node), weight(weight) {}
+		bool operator<(const Arc& rhs) const { return node < rhs.node; }
+
+		unsigned int node;
+		double weight;
+	};
+	typedef std::vector<Arc> ArcVector;
+	typedef std::pair<double, unsigned int> HeapEntry;
+	typedef std::tr1::unordered_map<std::string, unsigned int> NameMap;
+
+	static const double INF;
+
+	static bool set_arc(ArcVector& arcs, unsigned int node, double weight, double& old_weight);
+	static bool remove_arc(ArcVector& arcs, unsigned int node, double& old_weight);
+
+	void reset();
+	void update_ranks() const;
+	bool prefer(unsigned int candidate, int current) const;
+
+	void relax(Tree& tree, const std::vector<char>* restrict_to) const;
+	void repair_decrease(Tree& tree, unsigned int u, unsigned int v, double weight);
+	void repair_increase(Tree& tree, unsigned int u, unsigned int v);
+	void edge_changed(unsigned int u, unsigned int v, double old_weight, double new_weight);
+
+	/* Graph, indexed by slot; arcs are sorted by node */
+	std::vector<std::string> names_;
+	std::vector<char> live_;
+	std::vector<ArcVector> out_;
+	std::vector<ArcVector> in_;
+	NameMap slots_;
+	unsigned int num_live_;
+	unsigned int num_edges_;
+
+	/* Position of each node's name in sorted order, for breaking ties */
+	mutable std::vector<unsigned int> ranks_;
+	mutable bool ranks_valid_;
+
+	/* Trees by source slot; a tree with no entries has not been computed */
+	std::vector<Tree> trees_;
+
+	/* Scratch space for repairs */
+	mutable std::vector<HeapEntry> heap_;
+	std::vector<char> affected_;
+	std::vector<unsigned int> stack_;
+	std::vector<ArcVector> wanted_;
+
+	unsigned long generation_;
+	unsigned long long full_computations_;
+	unsigned long long repairs_;
+};
+
+#endif
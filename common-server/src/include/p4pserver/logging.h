@@ -36,6 +36,27 @@
 #include <log4cpp/Category.hh>
 #include <p4pserver/compiler.h>
 
-p4p_common_server_EXPORT void init_logger(unsigned int level, const std::string& ident);
+/**
+ * Configure logging.
+ * @param level		0=critical, 1=errors, 2=warnings, 3=info, 4=debug
+ * @param ident		Log to syslog with this identity (if not empty and no file is given)
+ * @param file		Append to this file (if not empty)
+ * @param async_capacity If non-zero, write from a background thread, buffering
+ *			up to this many messages per logging thread; messages
+ *			beyond that are dropped and counted
+ */
+p4p_common_server_EXPORT void init_logger(unsigned int level, const std::string& ident,
+					  const std::string& file = "", unsigned int async_capacity = 0);
+
+/**
+ * Write out messages buffered for asynchronous logging and stop the
+ * background thread. Later messages are logged to stderr.
+ */
+p4p_common_server_EXPORT void shutdown_logger();
+
+/**
+ * Get the number of messages dropped by asynchronous logging.
+ */
+p4p_common_server_EXPORT unsigned long long get_logger_dropped();
 
 #endif
@@ -38,6 +38,7 @@
 #include <vector>
 #include <string>
 #include <p4p/pid.h>
+#include <p4p/detail/intern_table.h>
 #include <p4pserver/locking.h>
 #include <p4pserver/dist_obj.h>
 #include <p4pserver/compiler.h>
@@ -101,12 +102,25 @@ typedef std::set<NetVertex> NetVertexSet;
 typedef std::vector<NetVertex> NetVertexVector;
 typedef std::set<NetVertexName> NetVertexNameSet;
 typedef std::vector<NetVertexName> NetVertexNameVector;
+typedef unsigned int NetVertexNameId;
+typedef std::vector<NetVertexNameId> NetVertexNameIdVector;
 typedef std::vector<NetEdge> NetEdgeVector;
 
 typedef std::tr1::unordered_map<NetVertex, unsigned int, boost::hash<NetVertex> > NetVertexIndexMap;
 typedef std::tr1::unordered_map<NetVertex, NetVertex, boost::hash<NetVertex> > NetVertexPredMap;
 typedef std::map<NetEdge, double> NetEdgeWeightMap;
 
+/*
+ * Vertex names are interned in a process-wide table, so that the
+ * topology and every view refer to a vertex name by the same dense id.
+ * Names are never removed from the table.
+ */
+typedef p4p::detail::InternTable<NetVertexName, std::tr1::unordered_map<NetVertexName, unsigned int> > NetVertexNameTable;
+p4p_common_server_EXPORT NetVertexNameTable& get_vertex_names();
+
+/* Intern a set of vertex names; the resulting ids are sorted */
+p4p_common_server_EXPORT void intern_vertex_names(const NetVertexNameSet& names, NetVertexNameIdVector& result);
+
 /*
  * Specialized p4p::PID* that is pinned to at least one vertex
  */
@@ -145,6 +159,15 @@ public:
 	virtual ~NetState();
 
 	bool get_node(const NetVertexName& name, NetVertex& result, const ReadableLock& lock) const
+	{
+		NetVertexNameId id;
+		if (!get_vertex_names().find(name, id))
+			return false;
+
+		return get_node(id, result, lock);
+	}
+
+	bool get_node(NetVertexNameId name, NetVertex& result, const ReadableLock& lock) const
 	{
 		lock.check_read(get_local_mutex());
 	
@@ -270,9 +293,9 @@ public:
 	void set_name(const NetVertex& vertex, const NetVertexName& value, const WritableLock& lock)
 	{
 		lock.check_write(get_local_mutex());
-		name_vert_map_.erase(get_name(vertex, lock));
+		name_vert_map_.erase(get_vertex_names().intern(get_name(vertex, lock)));
 		boost::put(boost::get(netvertex_name, graph_), vertex, value);
-		name_vert_map_.insert(std::make_pair(value, vertex));
+		name_vert_map_.insert(std::make_pair(get_vertex_names().intern(value), vertex));
 		changed(lock);
 	}
 
@@ -357,7 +380,7 @@ protected:
 #endif
 
 private:
-	typedef std::map<NetVertexName, NetVertex> NameToVertexMap;
+	typedef std::tr1::unordered_map<NetVertexNameId, NetVertex> NameToVertexMap;
 	typedef std::map<NetEdgeName, NetEdge> NameToEdgeMap;
 
 	static const netvertex_external_t netvertex_external;
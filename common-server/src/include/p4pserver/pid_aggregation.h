@@ -34,6 +34,10 @@
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/member.hpp>
+#include <boost/foreach.hpp>
+#ifdef P4P_CLUSTER
+	#include <boost/serialization/split_member.hpp>
+#endif
 #include <map>
 #include <p4p/pid.h>
 #include <p4pserver/local_obj.h>
@@ -54,24 +58,51 @@ public:
 	{
 		PIDRecord() {}
 		PIDRecord(const std::string& _name, const p4p::PID&  _pid, const NetVertexNameSet& _vertices)
+		: name(_name),
+		  pid(_pid)
+		{
+			intern_vertex_names(_vertices, vertices);
+		}
+		PIDRecord(const std::string& _name, const p4p::PID&  _pid, const NetVertexNameIdVector& _vertices)
 		: name(_name),
 		  pid(_pid),
 		  vertices(_vertices)
 		{}
 
+		void get_vertices(NetVertexNameSet& result) const
+		{
+			result.clear();
+			BOOST_FOREACH(NetVertexNameId v, vertices)
+			{
+				result.insert(get_vertex_names().get(v));
+			}
+		}
+
 		std::string		name;
 		p4p::PID		pid;
-		NetVertexNameSet	vertices;
+		NetVertexNameIdVector	vertices;	/**< Interned vertex names, sorted by id */
 
 #ifdef P4P_CLUSTER
 		friend class boost::serialization::access;
 		template<class Archive>
-		void serialize(Archive& ar, const unsigned int version)
+		void save(Archive& ar, const unsigned int version) const
+		{
+			NetVertexNameSet names;
+			get_vertices(names);
+			ar & name;
+			ar & pid;
+			ar & names;
+		}
+		template<class Archive>
+		void load(Archive& ar, const unsigned int version)
 		{
+			NetVertexNameSet names;
 			ar & name;
 			ar & pid;
-			ar & vertices;
+			ar & names;
+			intern_vertex_names(names, vertices);
 		}
+		BOOST_SERIALIZATION_SPLIT_MEMBER()
 #endif
 	};
 
@@ -31,7 +31,9 @@
 #define PID_MAP_H
 
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include <string>
+#include <vector>
 #include <p4p/pid.h>
 #include <p4p/ip_addr.h>
 #include <p4p/detail/patricia_trie.h>
@@ -43,6 +45,32 @@ class PIDMap;
 typedef boost::shared_ptr<PIDMap> PIDMapPtr;
 typedef boost::shared_ptr<const PIDMap> PIDMapConstPtr;
 
+/*
+ * Prefixes of a PIDMap grouped by PID, in PID order. Built once per
+ * version of the map and never modified, so it may be used without
+ * holding the map's lock.
+ */
+class p4p_common_server_EXPORT PIDPrefixTable
+{
+public:
+	typedef std::pair<p4p::PID, std::vector<p4p::IPPrefix> > Entry;
+	typedef std::vector<Entry> EntryVector;
+
+	/* Takes over the contents of 'entries', which must be sorted by PID */
+	PIDPrefixTable(EntryVector& entries);
+
+	const EntryVector& get_entries() const	{ return entries_; }
+	unsigned int get_num_prefixes() const	{ return num_prefixes_; }
+
+	/* Entry of a PID, or NULL if the PID has no prefixes */
+	const Entry* find(const p4p::PID& pid) const;
+
+private:
+	EntryVector entries_;
+	unsigned int num_prefixes_;
+};
+typedef boost::shared_ptr<const PIDPrefixTable> PIDPrefixTableConstPtr;
+
 class p4p_common_server_EXPORT PIDMap : public DistributedObject
 {
 public:
@@ -71,6 +99,9 @@ public:
 
 	void enumerate(std::vector<std::pair<p4p::PID, std::vector<p4p::IPPrefix> > >& result, const ReadableLock& lock) const;
 
+	/* Prefixes grouped by PID; built on first use after each change */
+	PIDPrefixTableConstPtr get_table(const ReadableLock& lock) const;
+
 	template <class OutputIterator>
 	void enumerate_pids(OutputIterator out, const ReadableLock& lock) const
 	{
@@ -89,7 +120,14 @@ protected:
 #endif
 
 private:
+	/* Drop the table after a change to the tree */
+	void reset_table();
+
 	struct p4p::detail::PatriciaTrie<p4p::PID> tree_;
+
+	/* Guards table_, which readers holding a shared lock may build */
+	mutable boost::mutex table_mutex_;
+	mutable PIDPrefixTableConstPtr table_;
 };
 
 #endif
@@ -34,9 +34,10 @@
 #include <iterator>
 #include <boost/foreach.hpp>
 #include <boost/multi_index_container.hpp>
-#include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/random_access_index.hpp>
 #include <boost/multi_index/identity.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/matrix_sparse.hpp>
 #include <boost/shared_ptr.hpp>
@@ -94,7 +95,7 @@ typedef boost::multi_index::multi_index_container<
 		IndexedPID,
 		boost::multi_index::indexed_by<
 			boost::multi_index::random_access<>,
-			boost::multi_index::ordered_unique< boost::multi_index::identity<p4p::PID> >
+			boost::multi_index::hashed_unique< boost::multi_index::identity<p4p::PID>, boost::hash<p4p::PID> >
 		>
 	> PIDMatrixPIDs;
 typedef PIDMatrixPIDs::nth_index<0>::type PIDMatrixPIDsByIdx;
@@ -240,7 +241,7 @@ public:
 			{
 				/* If there was no entry in the existing matrix, we don't
 				   need to worry about copying. */
-				const VCost& p = (*matrix_)(i, j);
+				const VCost p = (*matrix_)(i, j);
 				if (std::isnan((double)p))
 					continue;
 
@@ -273,7 +274,7 @@ public:
 	double get(const IndexedPID&  src, const IndexedPID&  dst, const ReadableLock& lock, const VCost& dflt = VCost()) const
 	{
 		lock.check_read(get_local_mutex());
-		const VCost& result = (*matrix_)(src.get_index(), dst.get_index());
+		const VCost result = (*matrix_)(src.get_index(), dst.get_index());
 		return std::isnan((double)result) ? dflt : result;
 	}
 
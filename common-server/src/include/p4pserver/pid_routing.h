@@ -59,29 +59,96 @@ public:
 	typedef StaticRouteMap::iterator StaticRouteMapNonConstItr;
 	typedef std::pair<StaticRouteMapNonConstItr, StaticRouteMapNonConstItr> StaticRouteMapNonConstItrPair;
 
+	/* Typedefs for weights of static routes; routes not listed have weight 1 */
+	typedef std::map<NamedRoute, double> StaticRouteWeightMap;
+
 	/* Typedefs for results of route computations */
 	typedef std::vector<PinnedPID> PinnedRoute;
 	typedef std::tr1::unordered_map<PinnedPID, PinnedRoute, boost::hash<p4p::PID> > PinnedRouteMap;
 
+	/* Routes sharing the traffic to one destination, with the share each carries */
+	typedef std::vector<std::pair<PinnedRoute, double> > PinnedRouteSplit;
+	typedef std::tr1::unordered_map<PinnedPID, PinnedRouteSplit, boost::hash<p4p::PID> > PinnedRouteSplitMap;
+
+	/* Next hop toward a destination, by vertex index, with the share of traffic it carries */
+	struct MultipathHop
+	{
+		MultipathHop(unsigned int vertex, double fraction) : vertex(vertex), fraction(fraction) {}
+
+		unsigned int vertex;
+		double fraction;
+	};
+	typedef std::vector<MultipathHop> MultipathHopVector;
+	typedef std::pair<MultipathHopVector::const_iterator, MultipathHopVector::const_iterator> MultipathHopRange;
+
 	/* Mode for computing routes */
 	enum RouteMode
 	{
 		RM_STATIC,
 		RM_WEIGHTS,
+		RM_ECMP,
 	};
 
 	class RouteComputationContext
 	{
 	public:
+		RouteComputationContext() : incremental_(false), paths_generation_(0), reverse_generation_(0) {}
 		const PinnedRouteMap& get_result() const { return result_; }
+
+		/* Destinations with several static routes, and the share of each (RM_STATIC) */
+		const PinnedRouteSplitMap& get_splits() const { return splits_; }
+
+		/* Results of get_multipath(): the vertices which reach the destination,
+		 * nearest first (the destination itself is first), and the next hops
+		 * of each. Vertices are identified by index. */
+		const std::vector<unsigned int>& get_multipath_order() const { return multipath_order_; }
+		MultipathHopRange get_multipath_hops(unsigned int v) const
+		{
+			MultipathHopVector::const_iterator begin = multipath_hops_.begin() + multipath_hop_begin_[v];
+			return MultipathHopRange(begin, begin + multipath_hop_count_[v]);
+		}
+		const NetVertex& get_vertex(unsigned int v) const { return index_verts_[v]; }
+		bool get_vertex_index(const NetVertex& v, unsigned int& result) const
+		{
+			NetVertexIndexMap::const_iterator itr = vert_indexes_.find(v);
+			if (itr == vert_indexes_.end())
+				return false;
+			result = itr->second;
+			return true;
+		}
+
 	private:
 		friend class PIDRouting;
 		PinnedRouteMap result_;
+		PinnedRouteSplitMap splits_;
 		NetVertexIndexMap vert_indexes_;
 		NetEdgeWeightMap edge_weights_;
 		NetVertexPredMap vert_preds_;
 		PinnedRoute route_reverse_;
 		PinnedRoute route_forward_;
+
+		/* Whether routes come from the shared shortest-path trees (all weights
+		 * positive), the slot of each vertex index, the vertex of each slot,
+		 * and the generation of the trees these refer to */
+		bool incremental_;
+		std::vector<unsigned int> path_slots_;
+		std::vector<NetVertex> path_verts_;
+		unsigned long paths_generation_;
+
+		/* Vertex of each index, and the edges leaving each vertex index with their weights */
+		std::vector<NetVertex> index_verts_;
+		std::vector<std::vector<std::pair<unsigned int, double> > > out_arcs_;
+
+		/* Slot of each vertex index in the trees toward destinations */
+		std::vector<unsigned int> reverse_slots_;
+		unsigned long reverse_generation_;
+
+		/* Distance of each vertex index to the destination of get_multipath() */
+		std::vector<double> multipath_dist_;
+		std::vector<unsigned int> multipath_order_;
+		std::vector<unsigned int> multipath_hop_begin_;
+		std::vector<unsigned int> multipath_hop_count_;
+		MultipathHopVector multipath_hops_;
 	};
 
 	PIDRouting(double default_weight);
@@ -90,12 +157,23 @@ public:
 	RouteMode get_route_mode(const ReadableLock& lock) const;
 	void set_route_mode(RouteMode value, const WritableLock& lock);
 
+	static const char* get_route_mode_name(RouteMode value);
+	static bool parse_route_mode(const std::string& name, RouteMode& result);
+
 	/* Get the routes from a single vertex to all other pids
 	 * NOTE: This should not be called more than absolutely needed!
 	 * NOTE: It is assumed that the vertices in NetState already have valid PIDs assigned to them.
 	 */
 	bool get_routes(const PinnedPID&  src, const NetState& state, const ReadableLock& state_lock, const PinnedPIDSet& pids, RouteComputationContext& result, const ReadableLock& lock) const;
 
+	/* Get the equal-cost next hops of every vertex toward a single pid
+	 * (RM_ECMP). Traffic is split evenly between the next hops of each
+	 * vertex, as routers do; the results give the order in which
+	 * per-vertex values can be accumulated back from the destination.
+	 * Returns false if this needs link weights which are not positive.
+	 */
+	bool get_multipath(const PinnedPID&  dst, const NetState& state, const ReadableLock& state_lock, RouteComputationContext& result, const ReadableLock& lock) const;
+
 	StaticRouteMapItrPair get_static_routes(const ReadableLock& lock) const;
 	StaticRouteMapNonConstItrPair get_static_routes(const ReadableLock& lock);
 	StaticRouteMapItrPair get_static_routes(const p4p::PID&  src, const p4p::PID&  dst, const ReadableLock& lock) const;
@@ -104,6 +182,11 @@ public:
 	unsigned int get_num_static_routes(const ReadableLock& lock) const;
 
 	bool add_static_route(const NamedRoute& value, const WritableLock& lock);
+
+	/* Add a static route carrying traffic in proportion to 'weight' among the
+	 * static routes between the same pids */
+	bool add_static_route(const NamedRoute& value, double weight, const WritableLock& lock);
+	double get_static_route_weight(const NamedRoute& route, const ReadableLock& lock) const;
 	bool remove_static_route(const NamedRoute& route, const WritableLock& lock);
 	bool clear_static_routes(const WritableLock& lock);
 
@@ -111,6 +194,7 @@ public:
 	double get_weight(const p4p::PID&  src, const p4p::PID&  dst, const ReadableLock& lock) const;
 
 	void add_pid(const p4p::PID&  pid, const WritableLock& lock);
+	void add_pids(const p4p::PIDSet& pids, const WritableLock& lock);
 	void remove_pid(const p4p::PID&  pid, const WritableLock& lock);
 
 protected:
@@ -134,10 +218,16 @@ private:
 		}
 	};
 	typedef std::set<StaticRouteMapItr, StaticRouteMapItrLess> StaticRouteMapItrSet;
-	typedef std::multimap<p4p::PID, StaticRouteMapItr> PIDStaticRouteMap;
+	typedef std::tr1::unordered_multimap<p4p::PID, StaticRouteMapItr, boost::hash<p4p::PID> > PIDStaticRouteMap;
+
+	/* Shortest-path trees kept across route computations */
+	struct ShortestPaths;
+	typedef boost::shared_ptr<ShortestPaths> ShortestPathsPtr;
 
 	bool get_routes_static(const PinnedPID&  src, const NetState& state, const ReadableLock& state_lock, const PinnedPIDSet& pids, RouteComputationContext& result, const ReadableLock& lock) const;
 	bool get_routes_weights(const PinnedPID&  src, const NetState& state, const ReadableLock& state_lock, const PinnedPIDSet& pids, RouteComputationContext& result, const ReadableLock& lock) const;
+	void prepare_context(const NetState& state, const ReadableLock& state_lock, RouteComputationContext& result, const ReadableLock& lock) const;
+	bool sync_shortest_paths(const NetState& state, const ReadableLock& state_lock, RouteComputationContext& result, bool reverse) const;
 
 	void append_static_route_ptrs(const p4p::PID&  pid, StaticRouteMapItrSet& route_itrs);
 	void add_static_route_ptrs(StaticRouteMapItr r_itr);
@@ -150,9 +240,15 @@ private:
 
 	StaticRouteMap static_routes_;
 	PIDStaticRouteMap static_route_ptrs_;
+	StaticRouteWeightMap static_route_weights_;
 
 	SparsePIDMatrixPtr weights_;
 	WritableLock* weights_lock_;
+
+	/* Shared with copies of this object; the trees are matched to the
+	 * topology by vertex name, so a copy with different weights or
+	 * topology only causes repairs. */
+	ShortestPathsPtr shortest_paths_;
 };
 
 #endif
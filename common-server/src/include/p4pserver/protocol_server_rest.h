@@ -30,12 +30,14 @@
 #ifndef PROTOCOL_SERVER_REST_H
 #define PROTOCOL_SERVER_REST_H
 
-#include <queue>
+#include <ostream>
 #include <string>
 #include <boost/lexical_cast.hpp>
 #include <p4pserver/protocol_server_base.h>
 #include <p4pserver/marked_stream.h>
 #include <p4pserver/rest_request_state.h>
+#include <p4pserver/rest_request_pool.h>
+#include <p4pserver/rest_metrics.h>
 #include <p4pserver/compiler.h>
 
 class RESTRequestState;
@@ -62,12 +64,37 @@ public:
 	static const unsigned int HTTP_METHOD_PUT	= 2;
 	static const unsigned int HTTP_METHOD_DELETE	= 3;
 
+	/**
+	 * How the daemon waits for connection activity. MODE_SELECT cannot
+	 * watch descriptors above FD_SETSIZE; MODE_EPOLL runs one epoll set
+	 * per pool thread and scales to many idle keep-alive connections.
+	 * Modes not supported by the linked libmicrohttpd fall back to
+	 * MODE_SELECT with a warning.
+	 */
+	enum ConnectionMode
+	{
+		MODE_SELECT,
+		MODE_POLL,
+		MODE_EPOLL,
+		MODE_THREAD_PER_CONNECTION
+	};
+
+	/**
+	 * Parse a mode name ('select', 'poll', 'epoll' or
+	 * 'thread-per-connection'); throws std::invalid_argument otherwise.
+	 */
+	static ConnectionMode parse_mode(const std::string& name);
+	static const char* get_mode_name(ConnectionMode mode);
+
 	ProtocolServerRESTBase(const std::string& addr, unsigned short port,
 			       unsigned int num_threads,
 			       const std::string& ssl_cert, const std::string& ssl_key,
 			       unsigned int connection_timeout,
 			       unsigned int connection_limit,
-			       unsigned int ip_connection_limit);
+			       unsigned int ip_connection_limit,
+			       ConnectionMode mode,
+			       unsigned int listen_backlog,
+			       unsigned int connection_memory_limit);
 
 	virtual ~ProtocolServerRESTBase();
 
@@ -77,8 +104,25 @@ public:
 	unsigned int get_datalen(RESTRequestState* state, const char* data, unsigned int len);
 	int process_request_data(RESTRequestState* state, const char* data, unsigned int data_len);
 
+	RESTMetrics& get_metrics()			{ return metrics_; }
+
+	/**
+	 * Write request metrics and request state pool occupancy in the
+	 * Prometheus text exposition format.
+	 */
+	void write_metrics(std::ostream& os);
+
 	log4cpp::Category* get_server_logger()		{ return server_logger_; }
 	void* get_server_obj()				{ return server_obj_; }
+	ConnectionMode get_mode() const			{ return mode_; }
+
+	/**
+	 * Whether idle connections can be suspended. Long-lived responses
+	 * (event streams) suspend their connection while they have nothing
+	 * to send; with a thread per connection, the thread waits instead.
+	 */
+	bool get_suspend_resume() const			{ return suspend_resume_; }
+	bool supports_event_streams() const		{ return suspend_resume_ || mode_ == MODE_THREAD_PER_CONNECTION; }
 
 protected:
 
@@ -94,11 +138,15 @@ private:
 	unsigned int connection_timeout_;
 	unsigned int connection_limit_;
 	unsigned int ip_connection_limit_;
+	ConnectionMode mode_;
+	unsigned int listen_backlog_;
+	unsigned int connection_memory_limit_;
+	bool suspend_resume_;
 
 	struct MHD_Daemon* daemon_;
 
-	boost::mutex requests_mutex_;
-	std::queue<RESTRequestState*> requests_;
+	RESTMetrics metrics_;
+	RESTRequestPool requests_;
 
 	log4cpp::Category* server_logger_;
 	void* server_obj_;
@@ -113,14 +161,20 @@ public:
 			   const std::string& ssl_cert, const std::string& ssl_key,
 			   unsigned int connection_timeout = 0,
 			   unsigned int connection_limit = 100,
-			   unsigned int ip_connection_limit = 5)
+			   unsigned int ip_connection_limit = 5,
+			   ConnectionMode mode = MODE_SELECT,
+			   unsigned int listen_backlog = 0,
+			   unsigned int connection_memory_limit = 0)
 		: ProtocolServerBase<MSG_MAX>(addr, port),
 		  ProtocolServerRESTBase(addr, port,
 					 num_threads,
 					 ssl_cert, ssl_key,
 					 connection_timeout,
 					 connection_limit,
-					 ip_connection_limit)
+					 ip_connection_limit,
+					 mode,
+					 listen_backlog,
+					 connection_memory_limit)
 	{}
 
 	virtual ~ProtocolServerREST() {}
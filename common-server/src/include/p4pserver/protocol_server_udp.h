@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef PROTOCOL_SERVER_UDP_H
+#define PROTOCOL_SERVER_UDP_H
+
+#include <sys/socket.h>
+#include <string>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include <p4pserver/protocol_server_base.h>
+#include <p4pserver/compiler.h>
+
+/**
+ * Datagram server: a pool of threads reads batches of datagrams from one
+ * socket (with recvmmsg() where available), passes each to
+ * handle_datagram(), and sends the responses back in a batch (with
+ * sendmmsg()). Handlers run on the receiving thread and must not block.
+ */
+class p4p_common_server_EXPORT ProtocolServerUDPBase
+{
+public:
+	ProtocolServerUDPBase(const std::string& addr, unsigned short port,
+			      unsigned int num_threads,
+			      unsigned int batch_size);
+
+	virtual ~ProtocolServerUDPBase();
+
+	/**
+	 * Handle a single request datagram.
+	 *
+	 * @param req		Request payload
+	 * @param req_len	Length of request payload
+	 * @param rsp		Buffer for the response payload
+	 * @param rsp_max	Size of response buffer
+	 * @param sender	Address the request came from
+	 * @returns Length of the response, or 0 to send no response
+	 */
+	virtual unsigned int handle_datagram(const char* req, unsigned int req_len,
+					     char* rsp, unsigned int rsp_max,
+					     const struct sockaddr_storage& sender) = 0;
+
+	/** Number of datagrams received and answered, and of datagrams which could not be sent */
+	unsigned long long get_received() const		{ return load(received_); }
+	unsigned long long get_sent() const		{ return load(sent_); }
+	unsigned long long get_send_errors() const	{ return load(send_errors_); }
+
+	log4cpp::Category* get_server_logger()		{ return server_logger_; }
+
+protected:
+
+	void base_start(log4cpp::Category* server_logger);
+	void base_stop();
+
+private:
+	void worker();
+
+	std::string addr_;
+	unsigned short port_;
+	unsigned int num_threads_;
+	unsigned int batch_size_;
+
+	int sock_;
+	volatile bool stopping_;
+	boost::thread_group threads_;
+
+	/* Read a counter atomically; workers update them with __sync_fetch_and_add */
+	static unsigned long long load(const unsigned long long& counter)
+	{
+		return __sync_fetch_and_add(const_cast<unsigned long long*>(&counter), 0ULL);
+	}
+
+	/* Shared by all worker threads */
+	unsigned long long received_;
+	unsigned long long sent_;
+	unsigned long long send_errors_;
+
+	log4cpp::Category* server_logger_;
+};
+
+template <unsigned int MSG_MAX, class RequestHandler>
+class p4p_common_server_ex_EXPORT ProtocolServerUDP : public ProtocolServerBase<MSG_MAX>, public ProtocolServerUDPBase
+{
+public:
+	ProtocolServerUDP(const std::string& addr, unsigned short port,
+			  unsigned int num_threads,
+			  unsigned int batch_size = 32)
+		: ProtocolServerBase<MSG_MAX>(addr, port),
+		  ProtocolServerUDPBase(addr, port, num_threads, batch_size)
+	{}
+
+	virtual ~ProtocolServerUDP() {}
+
+	virtual unsigned int handle_datagram(const char* req, unsigned int req_len,
+					     char* rsp, unsigned int rsp_max,
+					     const struct sockaddr_storage& sender)
+	{
+		return handler_(this, req, req_len, rsp, rsp_max, sender);
+	}
+
+protected:
+
+	virtual void server_run()
+	{
+		base_start(this->get_logger());
+		while (!this->is_stopped())
+			boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+	}
+
+	virtual void server_stop()
+	{
+		base_stop();
+	}
+
+	virtual std::string get_logger_name() const
+	{
+		return "UDPHandler(" + boost::lexical_cast<std::string>(this->get_port()) + ")";
+	}
+
+private:
+	RequestHandler handler_;
+};
+
+#endif
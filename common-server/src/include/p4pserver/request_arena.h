@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+
+#include <cstddef>
+#include <vector>
+#include <p4pserver/compiler.h>
+
+/**
+ * Bump allocator for data that lives as long as one request, such as
+ * the parsed path and request headers.
+ *
+ * Allocations are carved out of a block and are all released at once by
+ * reset(). When a request overflows the block, reset() replaces it with
+ * one large enough for the whole request, so a pooled arena serving
+ * similar requests stops allocating after the first few. Blocks above
+ * MAX_RETAINED are not kept, so one huge request does not pin memory.
+ */
+class p4p_common_server_EXPORT RequestArena
+{
+public:
+	static const std::size_t BLOCK_SIZE = 4096;
+	static const std::size_t MAX_RETAINED = 1024 * 1024;
+
+	RequestArena();
+	~RequestArena();
+
+	/**
+	 * Allocate memory aligned for any pointer or integer type. The
+	 * memory is valid until the next reset().
+	 */
+	void* allocate(std::size_t size);
+
+	/**
+	 * Copy a string into the arena.
+	 * @param len	Number of characters to copy; a terminator is appended
+	 */
+	char* copy(const char* s, std::size_t len);
+
+	/**
+	 * Release all allocations.
+	 */
+	void reset();
+
+	/**
+	 * Get the number of blocks taken from the heap since construction.
+	 */
+	unsigned long get_heap_allocations() const	{ return heap_allocations_; }
+
+private:
+	RequestArena(const RequestArena&);
+	RequestArena& operator=(const RequestArena&);
+
+	char* new_block(std::size_t size);
+
+	/* Current block and the blocks it overflowed into */
+	char* block_;
+	std::size_t block_size_;
+	std::size_t used_;
+	std::vector<char*> overflow_;
+	std::size_t overflow_size_;
+
+	unsigned long heap_allocations_;
+};
+
+/**
+ * Contiguous buffer for request body data which has been received but
+ * not yet consumed by a handler.
+ *
+ * Data is appended at the back and consumed from the front. Unlike a
+ * circular buffer, the unread data is always contiguous, so handlers can
+ * parse it in place. Capacity is kept across clear() (up to
+ * MAX_RETAINED), so a pooled buffer stops allocating once it has grown
+ * to the size of the requests it serves.
+ */
+class p4p_common_server_EXPORT RequestBuffer
+{
+public:
+	static const std::size_t INITIAL_CAPACITY = 4096;
+	static const std::size_t MAX_RETAINED = 1024 * 1024;
+
+	RequestBuffer();
+	~RequestBuffer();
+
+	const char* data() const			{ return buf_ + begin_; }
+	std::size_t size() const			{ return end_ - begin_; }
+	bool empty() const				{ return begin_ == end_; }
+	std::size_t capacity() const			{ return capacity_; }
+
+	void append(const char* data, std::size_t len);
+
+	/**
+	 * Remove bytes from the front of the buffer.
+	 */
+	void consume(std::size_t len);
+
+	void clear();
+
+private:
+	RequestBuffer(const RequestBuffer&);
+	RequestBuffer& operator=(const RequestBuffer&);
+
+	char* buf_;
+	std::size_t capacity_;
+	std::size_t begin_;
+	std::size_t end_;
+};
+
+#endif
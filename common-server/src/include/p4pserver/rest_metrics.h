@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef REST_METRICS_H
+#define REST_METRICS_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include <p4pserver/compiler.h>
+
+/**
+ * Request counters for a REST server, broken down by handler.
+ *
+ * Each thread serving requests records into its own set of counters, so
+ * recording takes no locks; the per-thread counters are only summed when
+ * they are written out. When a thread exits, its counters are added to a
+ * retired total and freed. Counters are plain integers written by a single
+ * thread, so a concurrent scrape may see a slightly stale value but never
+ * blocks a request.
+ */
+class p4p_common_server_EXPORT RESTMetrics
+{
+public:
+	/* Maximum number of distinct handler names */
+	static const unsigned int MAX_HANDLERS = 32;
+
+	/* Handler used for requests which were not classified */
+	static const unsigned int HANDLER_OTHER = 0;
+
+	/* Status codes counted individually; all others count as "other" */
+	static const unsigned int NUM_STATUS = 8;
+
+	/* Number of finite latency histogram buckets */
+	static const unsigned int NUM_BUCKETS = 14;
+
+	/**
+	 * Get the identifier for a handler name, registering it if it has not
+	 * been seen before. Identifiers are shared by all servers in the process.
+	 * Returns HANDLER_OTHER if too many handlers have been registered.
+	 */
+	static unsigned int register_handler(const std::string& name);
+
+	RESTMetrics();
+	~RESTMetrics();
+
+	/**
+	 * Record a completed request.
+	 * @param handler	Handler identifier
+	 * @param status	HTTP status code sent (0 if none was sent)
+	 * @param usec		Time from the start of the request until it completed
+	 */
+	void record_request(unsigned int handler, unsigned int status, unsigned long long usec);
+
+	/**
+	 * Record a request which found a view lock held by a writer.
+	 */
+	void record_lock_busy(unsigned int handler);
+
+	/**
+	 * Record response body bytes sent by a handler.
+	 */
+	void record_bytes_out(unsigned int handler, unsigned long long bytes);
+
+	/**
+	 * Write the summed counters in the Prometheus text exposition format.
+	 * @param labels	Extra labels to attach to each sample, e.g. 'port="6671"'
+	 */
+	void write_prometheus(std::ostream& os, const std::string& labels) const;
+
+private:
+	struct HandlerCounters
+	{
+		unsigned long requests;
+		unsigned long status[NUM_STATUS];
+		unsigned long lock_busy;
+		unsigned long long bytes_out;
+		unsigned long latency[NUM_BUCKETS + 1];
+		unsigned long long latency_usec;
+	};
+
+	struct Shard
+	{
+		RESTMetrics* metrics;
+		HandlerCounters handlers[MAX_HANDLERS];
+	};
+
+	Shard& get_shard();
+	static void release_shard(Shard* shard);
+	static void add_counters(Shard& dst, const Shard& src);
+
+	boost::thread_specific_ptr<Shard> shard_;
+
+	mutable boost::mutex shards_mutex_;
+	std::vector<Shard*> shards_;	/* Shards of running threads */
+	Shard retired_;			/* Sum of the shards of exited threads */
+};
+
+#endif
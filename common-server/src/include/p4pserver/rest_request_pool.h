@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef REST_REQUEST_POOL_H
+#define REST_REQUEST_POOL_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include <p4pserver/compiler.h>
+
+class RESTRequestState;
+class RESTMetrics;
+
+/**
+ * Pool of request state objects for a REST server.
+ *
+ * Each thread serving requests keeps a small cache of idle states, so
+ * acquiring and releasing a state normally takes no locks. Threads only
+ * go to the shared list (under a mutex) when their cache is empty or
+ * full, and return their cache to it when they exit. Counters follow
+ * RESTMetrics: they are per-thread plain integers summed when read.
+ *
+ * Threads using the pool must exit before it is destroyed.
+ */
+class p4p_common_server_EXPORT RESTRequestPool
+{
+public:
+	/* Idle states cached by each thread */
+	static const unsigned int THREAD_CACHE_SIZE = 16;
+
+	struct Stats
+	{
+		unsigned long allocated;	/* States created */
+		unsigned long idle;		/* States not serving a request */
+		unsigned long thread_hits;	/* Acquired from the thread's cache */
+		unsigned long shared_hits;	/* Acquired from the shared list */
+		unsigned long misses;		/* Acquired by creating a state */
+	};
+
+	RESTRequestPool(RESTMetrics* metrics);
+	~RESTRequestPool();
+
+	RESTRequestState* get();
+	void put(RESTRequestState* state);
+
+	Stats get_stats() const;
+
+	/**
+	 * Write pool occupancy and hit counts in the Prometheus text
+	 * exposition format.
+	 */
+	void write_prometheus(std::ostream& os, const std::string& labels) const;
+
+private:
+	struct Cache
+	{
+		RESTRequestPool* pool;
+		RESTRequestState* states[THREAD_CACHE_SIZE];
+		volatile unsigned int size;
+		unsigned long thread_hits;
+		unsigned long shared_hits;
+		unsigned long misses;
+	};
+
+	Cache& get_cache();
+	static void release_cache(Cache* cache);
+
+	RESTMetrics* metrics_;
+
+	boost::thread_specific_ptr<Cache> cache_;
+
+	mutable boost::mutex mutex_;
+	std::vector<RESTRequestState*> shared_;
+	std::vector<Cache*> caches_;		/* All caches, for counters */
+	std::vector<Cache*> free_caches_;	/* Caches of exited threads */
+};
+
+#endif
@@ -31,12 +31,16 @@
 #define REST_REQUEST_STATE_H
 
 #include <boost/iostreams/stream.hpp>
-#include <boost/circular_buffer.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <string>
+#include <utility>
 #include <vector>
-#include <map>
 #include <p4pserver/protocol_server_base.h>
 #include <p4pserver/compiler.h>
+#include <p4pserver/encoded_body.h>
+#include <p4pserver/event_stream.h>
+#include <p4pserver/request_arena.h>
+#include <p4pserver/rest_metrics.h>
 #include <p4p/ip_addr.h>
 
 struct MHD_Connection;
@@ -48,18 +52,27 @@ typedef bool (*RESTRequestProcess)(void* server, RESTRequestState*, void*, std::
 typedef void (*RESTRequestFinish)(void* server, RESTRequestState*, void*);
 typedef void (*RESTRequestFree)(void*);
 
-typedef std::map<std::string, const char*> HTTPHeaders;
+/* Request headers in the order received; names and values live in the request's arena */
+typedef std::vector<std::pair<const char*, const char*> > HTTPHeaders;
 
 class p4p_common_server_EXPORT RESTRequestState
 {
 public:
-	typedef boost::circular_buffer<char> Buffer;
+	typedef RequestBuffer Buffer;
 
 	static const unsigned int MAX_PATH_LENGTH = 255;
 	static const unsigned int RESPONSE_BLOCK_SIZE = 4096;
 
+	/* Path components and headers reserved for up front */
+	static const unsigned int RESERVED_ARGS = 16;
+	static const unsigned int RESERVED_HEADERS = 32;
+
 	RESTRequestState();
 
+	/**
+	 * Reset for the next request. Memory used by the previous request is
+	 * kept, so a state serving similar requests does not allocate.
+	 */
 	void clear();
 
 	void set_conn(MHD_Connection* value) { conn_ = value; }
@@ -105,6 +118,15 @@ public:
 	void set_callback_data(void* value) { callback_data_ = value; }
 	void* get_callback_data() const { return callback_data_; }
 
+	void set_metrics(RESTMetrics* value) { metrics_ = value; }
+	RESTMetrics* get_metrics() const { return metrics_; }
+
+	void set_metrics_handler(unsigned int value) { metrics_handler_ = value; }
+	unsigned int get_metrics_handler() const { return metrics_handler_; }
+
+	void set_start_time(const boost::posix_time::ptime& value) { start_time_ = value; }
+	const boost::posix_time::ptime& get_start_time() const { return start_time_; }
+
 	void set_request_finished(bool value) { request_finished_ = value; }
 	bool get_request_finished() const { return request_finished_; }
 
@@ -112,6 +134,22 @@ public:
 	void set_text_response(unsigned int status, const std::string& text, const char* content_type = "text/plain");
 	void set_callback_response(RESTContentReaderCallback rsp_writer, const char* content_type = "text/plain");
 
+	/**
+	 * Respond with a body compressed in advance, in the smallest encoding
+	 * the client accepts. Nothing is compressed or copied per request
+	 * beyond handing the body to libmicrohttpd.
+	 */
+	void set_encoded_response(unsigned int status, EncodedBodyConstPtr body, const char* content_type = "text/plain");
+
+	/**
+	 * Respond with a stream of server-sent events, which lasts until the
+	 * client disconnects or the stream is ended. 'stream' is unsubscribed
+	 * from 'hub' when the response is done. If 'suspend' is set, the
+	 * connection is suspended while there is nothing to send; otherwise
+	 * the thread serving it waits.
+	 */
+	void set_event_stream_response(EventStreamHubPtr hub, EventStreamPtr stream, bool suspend);
+
 	void set_status(unsigned int value) { status_ = value; }
 	unsigned int get_status() const { return status_; }
 
@@ -121,7 +159,14 @@ public:
 	void add_response_header(const std::string& name, const std::string& value);
 
 	const HTTPHeaders& get_headers() const { return headers_; }
-	void add_header(const char* key, const char* value) { headers_[std::string(key)] = value; }
+	void add_header(const char* key, const char* value);
+
+	/**
+	 * Get a header added by add_header() (case-insensitive), or NULL.
+	 */
+	const char* get_header(const char* key) const;
+
+	RequestArena& get_arena() { return arena_; }
 
 private:
 	MHD_Connection* conn_;
@@ -129,7 +174,8 @@ private:
 	Buffer buffer_;
 	bool request_finished_;
 
-	char rawpath_[MAX_PATH_LENGTH+1];
+	RequestArena arena_;
+
 	std::vector<char*> args_;
 
 	unsigned int version_;
@@ -144,6 +190,10 @@ private:
 	MHD_Response* response_;
 	
 	HTTPHeaders headers_;
+
+	RESTMetrics* metrics_;
+	unsigned int metrics_handler_;
+	boost::posix_time::ptime start_time_;
 };
 
 #endif
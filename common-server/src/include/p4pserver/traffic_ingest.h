@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#ifndef TRAFFIC_INGEST_H
+#define TRAFFIC_INGEST_H
+
+#include <istream>
+#include <string>
+#include <tr1/unordered_map>
+#include <boost/shared_ptr.hpp>
+#include <p4pserver/net_state.h>
+#include <p4pserver/compiler.h>
+
+class TrafficIngest;
+typedef boost::shared_ptr<TrafficIngest> TrafficIngestPtr;
+
+/**
+ * Link traffic measurements gathered for a bulk update of a NetState.
+ *
+ * Records are parsed as the input arrives, in pieces of any size, and
+ * summed per link in a buffer kept apart from the NetState, so no lock
+ * is held while reading. apply() then sets the traffic of every link
+ * under a single write lock.
+ *
+ * Two input formats are accepted, distinguished by the first bytes:
+ *
+ * - Text: one record per line, a link name and a non-negative value
+ *   separated by a comma or whitespace. Blank lines and lines starting
+ *   with '#' are skipped.
+ *
+ * - Binary: the 8 bytes "P4PTRAF1", then records of a 1-byte name
+ *   length, the link name, and the value as a big-endian 64-bit
+ *   unsigned integer (e.g., a byte counter).
+ *
+ * Several records for the same link (such as one per flow) are added up.
+ */
+class p4p_common_server_EXPORT TrafficIngest
+{
+public:
+	static const char BINARY_MAGIC[];
+	static const unsigned int BINARY_MAGIC_LEN = 8;
+
+	TrafficIngest();
+
+	/**
+	 * Parse the next part of the input. A record may be split between
+	 * calls. Returns false once the input is found to be malformed; see
+	 * get_error().
+	 */
+	bool add_data(const char* data, size_t len);
+
+	/**
+	 * Parse everything remaining in a stream.
+	 */
+	bool add_data(std::istream& is);
+
+	/**
+	 * Parse the end of the input. Must be called after the last
+	 * add_data(); fails if the input ends within a record.
+	 */
+	bool finish();
+
+	/**
+	 * Add traffic for a link directly.
+	 */
+	void add(const NetEdgeName& link, double value);
+
+	/**
+	 * Set the traffic of each link in 'net' to its total multiplied by
+	 * 'scale'. If 'reset' is set, links without any records get a
+	 * traffic of 0; otherwise they are left alone. Links which are not
+	 * in 'net' are skipped. Returns the number of links updated.
+	 */
+	unsigned int apply(NetState& net, double scale, bool reset, const WritableLock& lock);
+
+	bool has_error() const			{ return !error_.empty(); }
+	const std::string& get_error() const	{ return error_; }
+
+	unsigned long long get_records() const	{ return records_; }
+	unsigned int get_links() const		{ return traffic_.size(); }
+
+	/* Links skipped by the last apply() since they were not in the NetState */
+	unsigned int get_unknown_links() const	{ return unknown_links_; }
+
+private:
+	typedef std::tr1::unordered_map<NetEdgeName, double> LinkTrafficMap;
+
+	typedef enum
+	{
+		FORMAT_UNKNOWN,
+		FORMAT_TEXT,
+		FORMAT_BINARY
+	} Format;
+
+	bool detect_format(bool finished);
+	size_t parse_text(const char* data, size_t len);
+	size_t parse_binary(const char* data, size_t len);
+	bool parse_line(const char* begin, const char* end);
+	void add_record(const char* name, size_t name_len, double value);
+	void fail(const std::string& msg);
+
+	Format format_;
+
+	/* Input not yet parsed, ending within a record */
+	std::string pending_;
+
+	/* Reused to look up link names without allocating */
+	std::string key_;
+
+	LinkTrafficMap traffic_;
+	unsigned long long records_;
+	unsigned long long lines_;
+	unsigned int unknown_links_;
+	std::string error_;
+};
+
+#endif
@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "p4pserver/async_appender.h"
+
+#include <algorithm>
+#include <sstream>
+#include <errno.h>
+#include <unistd.h>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+
+/* Interval at which the drain thread empties the buffers */
+static const unsigned int DRAIN_INTERVAL_MS = 50;
+
+/* Formatted output is written once this many bytes are pending */
+static const unsigned int WRITE_BATCH_BYTES = 65536;
+
+static bool event_before(const log4cpp::LoggingEvent* a, const log4cpp::LoggingEvent* b)
+{
+	if (a->timeStamp.getSeconds() != b->timeStamp.getSeconds())
+		return a->timeStamp.getSeconds() < b->timeStamp.getSeconds();
+	return a->timeStamp.getMicroSeconds() < b->timeStamp.getMicroSeconds();
+}
+
+static void write_all(int fd, const std::string& data)
+{
+	std::string::size_type pos = 0;
+	while (pos < data.size())
+	{
+		ssize_t rc = ::write(fd, data.data() + pos, data.size() - pos);
+		if (rc < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+		pos += rc;
+	}
+}
+
+AsyncAppender::Ring::Ring(unsigned int capacity)
+	: head_(0),
+	  tail_(0),
+	  dropped_(0)
+{
+	unsigned long size = 1;
+	while (size < capacity)
+		size <<= 1;
+	slots_.resize(size);
+	mask_ = size - 1;
+}
+
+bool AsyncAppender::Ring::push(const log4cpp::LoggingEvent& event)
+{
+	unsigned long tail = tail_;
+	if (tail - head_ > mask_)
+	{
+		++dropped_;
+		return false;
+	}
+
+	/* Assigning into the existing slot reuses its string buffers */
+	Event& slot = slots_[tail & mask_];
+	slot.category = event.categoryName;
+	slot.message = event.message;
+	slot.ndc = event.ndc;
+	slot.thread = event.threadName;
+	slot.priority = event.priority;
+	slot.timestamp = event.timeStamp;
+
+	/* Make the slot visible before the consumer can see the new tail */
+	__sync_synchronize();
+	tail_ = tail + 1;
+	return true;
+}
+
+unsigned long AsyncAppender::Ring::available() const
+{
+	unsigned long n = tail_ - head_;
+	__sync_synchronize();
+	return n;
+}
+
+const AsyncAppender::Event& AsyncAppender::Ring::front() const
+{
+	return slots_[head_ & mask_];
+}
+
+void AsyncAppender::Ring::pop()
+{
+	/* Finish reading the slot before the producer may reuse it */
+	__sync_synchronize();
+	head_ = head_ + 1;
+}
+
+AsyncAppender::AsyncAppender(const std::string& name, int fd, unsigned int capacity)
+	: log4cpp::LayoutAppender(name),
+	  capacity_(capacity),
+	  fd_(fd),
+	  target_(NULL),
+	  dropped_retired_(0),
+	  dropped_reported_(0),
+	  stopped_(true)
+{
+	start();
+}
+
+AsyncAppender::AsyncAppender(const std::string& name, log4cpp::Appender* target, unsigned int capacity)
+	: log4cpp::LayoutAppender(name),
+	  capacity_(capacity),
+	  fd_(-1),
+	  target_(target),
+	  dropped_retired_(0),
+	  dropped_reported_(0),
+	  stopped_(true)
+{
+	start();
+}
+
+AsyncAppender::~AsyncAppender()
+{
+	close();
+	delete target_;
+}
+
+void AsyncAppender::start()
+{
+	stopped_ = false;
+	thread_ = boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&AsyncAppender::run, this)));
+}
+
+bool AsyncAppender::reopen()
+{
+	return target_ ? target_->reopen() : true;
+}
+
+void AsyncAppender::close()
+{
+	{
+		boost::mutex::scoped_lock lock(drain_mutex_);
+		if (!thread_)
+			return;
+		stopped_ = true;
+		drain_cond_.notify_all();
+	}
+	thread_->join();
+	thread_.reset();
+
+	if (target_)
+		target_->close();
+	if (fd_ > STDERR_FILENO)
+		::close(fd_);
+	fd_ = -1;
+}
+
+unsigned long long AsyncAppender::get_dropped() const
+{
+	boost::mutex::scoped_lock lock(rings_mutex_);
+	unsigned long long dropped = dropped_retired_;
+	BOOST_FOREACH(const RingPtr& ring, rings_)
+		dropped += ring->get_dropped();
+	return dropped;
+}
+
+void AsyncAppender::_append(const log4cpp::LoggingEvent& event)
+{
+	if (stopped_)
+		return;
+	get_ring()->push(event);
+}
+
+AsyncAppender::Ring* AsyncAppender::get_ring()
+{
+	RingPtr* ring = ring_.get();
+	if (ring)
+		return ring->get();
+
+	/* First event from this thread */
+	ring = new RingPtr(new Ring(capacity_));
+	{
+		boost::mutex::scoped_lock lock(rings_mutex_);
+		rings_.push_back(*ring);
+	}
+	ring_.reset(ring);
+	return ring->get();
+}
+
+void AsyncAppender::run()
+{
+	boost::mutex::scoped_lock lock(drain_mutex_);
+	while (!stopped_)
+	{
+		drain_cond_.timed_wait(lock, boost::get_system_time() + boost::posix_time::milliseconds(DRAIN_INTERVAL_MS));
+
+		lock.unlock();
+		drain();
+		lock.lock();
+	}
+	lock.unlock();
+
+	/* Write out anything logged while stopping */
+	drain();
+}
+
+void AsyncAppender::drain()
+{
+	std::vector<RingPtr> rings;
+	unsigned long long dropped;
+	{
+		boost::mutex::scoped_lock lock(rings_mutex_);
+
+		/* Free rings whose threads have exited and which have been emptied */
+		for (std::vector<RingPtr>::iterator itr = rings_.begin(); itr != rings_.end(); )
+		{
+			if (itr->unique() && (*itr)->empty())
+			{
+				dropped_retired_ += (*itr)->get_dropped();
+				itr = rings_.erase(itr);
+			}
+			else
+				++itr;
+		}
+
+		rings = rings_;
+		dropped = dropped_retired_;
+		BOOST_FOREACH(const RingPtr& ring, rings_)
+			dropped += ring->get_dropped();
+	}
+
+	std::vector<log4cpp::LoggingEvent*> batch;
+	BOOST_FOREACH(const RingPtr& ring, rings)
+	{
+		for (unsigned long n = ring->available(); n > 0; --n)
+		{
+			const Event& e = ring->front();
+			log4cpp::LoggingEvent* event = new log4cpp::LoggingEvent(e.category, e.message, e.ndc, e.priority);
+			event->threadName = e.thread;
+			event->timeStamp = e.timestamp;
+			batch.push_back(event);
+			ring->pop();
+		}
+	}
+
+	/* Interleave the threads' events in the order they were logged */
+	std::stable_sort(batch.begin(), batch.end(), event_before);
+
+	if (dropped > dropped_reported_)
+	{
+		std::ostringstream msg;
+		msg << "dropped " << dropped - dropped_reported_ << " log messages (buffer full)";
+		batch.push_back(new log4cpp::LoggingEvent(getName(), msg.str(), "", log4cpp::Priority::WARN));
+		dropped_reported_ = dropped;
+	}
+
+	write_batch(batch);
+
+	BOOST_FOREACH(log4cpp::LoggingEvent* event, batch)
+		delete event;
+}
+
+void AsyncAppender::write_batch(std::vector<log4cpp::LoggingEvent*>& batch)
+{
+	if (batch.empty())
+		return;
+
+	if (target_)
+	{
+		BOOST_FOREACH(const log4cpp::LoggingEvent* event, batch)
+			target_->doAppend(*event);
+		return;
+	}
+
+	if (fd_ < 0)
+		return;
+
+	std::string out;
+	BOOST_FOREACH(const log4cpp::LoggingEvent* event, batch)
+	{
+		out += _getLayout().format(*event);
+		if (out.size() >= WRITE_BATCH_BYTES)
+		{
+			write_all(fd_, out);
+			out.clear();
+		}
+	}
+	write_all(fd_, out);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "p4pserver/encoded_body.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdexcept>
+#include <zlib.h>
+
+static bool gzip(const std::string& in, int level, std::string& out)
+{
+	z_stream zstrm;
+	zstrm.zalloc = Z_NULL;
+	zstrm.zfree = Z_NULL;
+	zstrm.opaque = Z_NULL;
+
+	/* NOTE: adding 16 to 'windowBits' parameter enables gzip compression */
+	if (deflateInit2(&zstrm, level, Z_DEFLATED, 16 + 15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		throw std::runtime_error("Illegal state: failed to initialize zlib");
+
+	/* The bound leaves room for the gzip header and trailer, so a single call finishes */
+	out.resize(deflateBound(&zstrm, in.size()) + 18);
+	zstrm.next_in = (unsigned char*)in.data();
+	zstrm.avail_in = in.size();
+	zstrm.next_out = (unsigned char*)&out[0];
+	zstrm.avail_out = out.size();
+	int rc = deflate(&zstrm, Z_FINISH);
+	out.resize(out.size() - zstrm.avail_out);
+	deflateEnd(&zstrm);
+	return rc == Z_STREAM_END;
+}
+
+EncodedBody::EncodedBody(const std::string& body, int level)
+{
+	bodies_[IDENTITY] = body;
+	has_[IDENTITY] = true;
+
+	has_[GZIP] = gzip(body, level, bodies_[GZIP]) && bodies_[GZIP].size() < body.size();
+	if (!has_[GZIP])
+		std::string().swap(bodies_[GZIP]);
+}
+
+const char* EncodedBody::get_name(Encoding encoding)
+{
+	switch (encoding)
+	{
+	case GZIP:	return "gzip";
+	default:	return NULL;
+	}
+}
+
+EncodedBody::Encoding EncodedBody::select(const char* accept_encoding) const
+{
+	if (has_[GZIP] && accepts(accept_encoding, GZIP))
+		return GZIP;
+	return IDENTITY;
+}
+
+bool EncodedBody::accepts(const char* accept_encoding, Encoding encoding)
+{
+	if (encoding == IDENTITY)
+		return true;
+	if (!accept_encoding)
+		return false;
+
+	const char* name = get_name(encoding);
+	size_t name_len = strlen(name);
+
+	/* Comma-separated codings, each optionally with ";q=<weight>" */
+	bool wildcard = false;
+	const char* p = accept_encoding;
+	while (*p)
+	{
+		while (*p == ',' || isspace((unsigned char)*p))
+			++p;
+		const char* token = p;
+		while (*p && *p != ',' && *p != ';' && !isspace((unsigned char)*p))
+			++p;
+		size_t token_len = p - token;
+
+		/* A weight of 0 means "not acceptable" */
+		bool allowed = true;
+		const char* end = strchr(p, ',');
+		if (!end)
+			end = p + strlen(p);
+		const char* q = p;
+		while ((q = strchr(q, ';')) != NULL && q < end)
+		{
+			++q;
+			while (isspace((unsigned char)*q))
+				++q;
+			if ((*q == 'q' || *q == 'Q') && q[1] == '=')
+				allowed = strtod(q + 2, NULL) > 0.0;
+		}
+		p = end;
+
+		if (token_len == name_len && strncasecmp(token, name, name_len) == 0)
+			return allowed;
+		if (token_len == 1 && *token == '*')
+			wildcard = allowed;
+	}
+	return wildcard;
+}
@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#include "p4pserver/event_stream.h"
+
+#include <string.h>
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread_time.hpp>
+
+EventStream::EventStream(const std::string& topic, size_t max_buffered)
+	: topic_(topic),
+	  max_buffered_(max_buffered),
+	  offset_(0),
+	  buffered_(0),
+	  waiter_(NULL),
+	  synced_(false),
+	  closed_(false),
+	  resyncs_(0),
+	  index_(0)
+{
+}
+
+int EventStream::read(char* buf, int max, EventStreamWaiter* waiter, const boost::posix_time::time_duration& timeout)
+{
+	boost::mutex::scoped_lock lock(mutex_);
+
+	if (queue_.empty() && !closed_)
+	{
+		if (waiter)
+		{
+			waiter_ = waiter;
+			waiter->suspend();
+			return 0;
+		}
+		if (timeout.ticks() > 0)
+			cond_.timed_wait(lock, boost::get_system_time() + timeout);
+	}
+
+	if (queue_.empty())
+		return closed_ ? -1 : 0;
+
+	int copied = 0;
+	while (copied < max && !queue_.empty())
+	{
+		const std::string& msg = *queue_.front();
+		size_t n = std::min((size_t)(max - copied), msg.size() - offset_);
+		memcpy(buf + copied, msg.data() + offset_, n);
+		copied += n;
+		offset_ += n;
+		buffered_ -= n;
+
+		if (offset_ == msg.size())
+		{
+			queue_.pop_front();
+			offset_ = 0;
+		}
+	}
+	return copied;
+}
+
+void EventStream::close()
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	closed_ = true;
+	waiter_ = NULL;
+	queue_.clear();
+	offset_ = 0;
+	buffered_ = 0;
+}
+
+void EventStream::end()
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	closed_ = true;
+	wake();
+}
+
+void EventStream::wake()
+{
+	if (waiter_)
+	{
+		EventStreamWaiter* waiter = waiter_;
+		waiter_ = NULL;
+		waiter->resume();
+	}
+	cond_.notify_all();
+}
+
+bool EventStream::push(const EventStreamMessagePtr& msg, const EventStreamMessagePtr& snapshot)
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	if (closed_)
+		return true;
+
+	if (msg && synced_ && buffered_ + msg->size() <= max_buffered_)
+	{
+		queue_.push_back(msg);
+		buffered_ += msg->size();
+		wake();
+		return true;
+	}
+
+	if (!snapshot)
+		return true;
+
+	/* A message partly read stays, so that the client never sees half
+	 * an event */
+	size_t keep = offset_ > 0 ? 1 : 0;
+	while (queue_.size() > keep)
+	{
+		buffered_ -= queue_.back()->size();
+		queue_.pop_back();
+	}
+
+	queue_.push_back(snapshot);
+	buffered_ += snapshot->size();
+	wake();
+
+	bool resync = msg && synced_;
+	if (resync)
+		++resyncs_;
+	synced_ = true;
+	return !resync;
+}
+
+size_t EventStream::get_buffered() const
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	return buffered_;
+}
+
+unsigned long long EventStream::get_resyncs() const
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	return resyncs_;
+}
+
+bool EventStream::is_closed() const
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	return closed_;
+}
+
+EventStreamHub::EventStreamHub()
+	: subscribers_(0),
+	  published_(0),
+	  resyncs_(0)
+{
+}
+
+void EventStreamHub::append_message(std::string& out, const std::string& event, unsigned long long id, const std::string& data)
+{
+	out += "event: ";
+	out += event;
+	out += "\nid: ";
+	out += boost::lexical_cast<std::string>(id);
+	out += '\n';
+
+	/* A field ends at a line break, so each line goes in its own field */
+	std::string::size_type begin = 0;
+	do
+	{
+		std::string::size_type end = data.find('\n', begin);
+		if (end == std::string::npos)
+			end = data.size();
+		out += "data: ";
+		out.append(data, begin, end - begin);
+		out += '\n';
+		begin = end + 1;
+	} while (begin < data.size());
+
+	out += '\n';
+}
+
+EventStreamPtr EventStreamHub::subscribe(const std::string& topic, size_t max_buffered)
+{
+	EventStreamPtr stream(new EventStream(topic, max_buffered));
+
+	boost::mutex::scoped_lock lock(mutex_);
+	Topic& t = topics_[topic];
+	stream->index_ = t.streams.size();
+	t.streams.push_back(stream);
+	++subscribers_;
+
+	if (t.snapshot)
+		stream->push(EventStreamMessagePtr(), t.snapshot);
+	return stream;
+}
+
+void EventStreamHub::unsubscribe(const EventStreamPtr& stream)
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	TopicMap::iterator itr = topics_.find(stream->get_topic());
+	if (itr == topics_.end())
+		return;
+
+	std::vector<EventStreamPtr>& streams = itr->second.streams;
+	unsigned int i = stream->index_;
+	if (i >= streams.size() || streams[i] != stream)
+		return;
+
+	streams[i] = streams.back();
+	streams[i]->index_ = i;
+	streams.pop_back();
+	--subscribers_;
+
+	if (streams.empty() && !itr->second.snapshot)
+		topics_.erase(itr);
+}
+
+unsigned int EventStreamHub::publish(const std::string& topic, const EventStreamMessagePtr& snapshot, const EventStreamMessagePtr& update)
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	Topic& t = topics_[topic];
+	t.snapshot = snapshot;
+	++published_;
+
+	unsigned int resynced = 0;
+	for (std::vector<EventStreamPtr>::const_iterator itr = t.streams.begin(); itr != t.streams.end(); ++itr)
+	{
+		if (!(*itr)->push(update, snapshot))
+			++resynced;
+	}
+	resyncs_ += resynced;
+	return resynced;
+}
+
+void EventStreamHub::remove(const std::string& topic)
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	TopicMap::iterator itr = topics_.find(topic);
+	if (itr == topics_.end())
+		return;
+
+	std::vector<EventStreamPtr>& streams = itr->second.streams;
+	for (std::vector<EventStreamPtr>::const_iterator s = streams.begin(); s != streams.end(); ++s)
+		(*s)->end();
+	subscribers_ -= streams.size();
+	topics_.erase(itr);
+}
+
+bool EventStreamHub::remove_if_unused(const std::string& topic)
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	TopicMap::iterator itr = topics_.find(topic);
+	if (itr == topics_.end())
+		return true;
+	if (!itr->second.streams.empty())
+		return false;
+
+	topics_.erase(itr);
+	return true;
+}
+
+bool EventStreamHub::has_snapshot(const std::string& topic) const
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	TopicMap::const_iterator itr = topics_.find(topic);
+	return itr != topics_.end() && itr->second.snapshot;
+}
+
+bool EventStreamHub::has_subscribers(const std::string& topic) const
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	TopicMap::const_iterator itr = topics_.find(topic);
+	return itr != topics_.end() && !itr->second.streams.empty();
+}
+
+void EventStreamHub::get_topics(std::vector<std::string>& result) const
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	for (TopicMap::const_iterator itr = topics_.begin(); itr != topics_.end(); ++itr)
+		result.push_back(itr->first);
+}
+
+unsigned int EventStreamHub::get_subscribers() const
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	return subscribers_;
+}
+
+unsigned long long EventStreamHub::get_published() const
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	return published_;
+}
+
+unsigned long long EventStreamHub::get_resyncs() const
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	return resyncs_;
+}
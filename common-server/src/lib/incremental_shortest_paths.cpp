@@ -0,0 +1,494 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "p4pserver/incremental_shortest_paths.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+/*
+ * A batch of changes given to sync() is repaired tree by tree when it
+ * touches no more than this many edges, or this fraction of all edges
+ * if that is more. Larger batches discard the trees instead, since
+ * recomputing them is cheaper than repairing them that many times.
+ */
+static const unsigned int REPAIR_MIN_CHANGES = 16;
+static const unsigned int REPAIR_EDGE_FRACTION = 10;
+
+const int IncrementalShortestPaths::NO_PRED;
+const double IncrementalShortestPaths::INF = std::numeric_limits<double>::infinity();
+
+IncrementalShortestPaths::IncrementalShortestPaths()
+	: num_live_(0),
+	  num_edges_(0),
+	  ranks_valid_(true),
+	  generation_(0),
+	  full_computations_(0),
+	  repairs_(0)
+{
+}
+
+void IncrementalShortestPaths::reset()
+{
+	names_.clear();
+	live_.clear();
+	out_.clear();
+	in_.clear();
+	slots_.clear();
+	num_live_ = 0;
+	num_edges_ = 0;
+	ranks_.clear();
+	ranks_valid_ = true;
+	trees_.clear();
+	affected_.clear();
+	wanted_.clear();
+	++generation_;
+}
+
+bool IncrementalShortestPaths::find_node(const std::string& name, unsigned int& result) const
+{
+	NameMap::const_iterator itr = slots_.find(name);
+	if (itr == slots_.end())
+		return false;
+
+	result = itr->second;
+	return true;
+}
+
+unsigned int IncrementalShortestPaths::add_node(const std::string& name)
+{
+	unsigned int slot;
+	if (find_node(name, slot))
+		return slot;
+
+	slot = names_.size();
+	names_.push_back(name);
+	live_.push_back(1);
+	out_.push_back(ArcVector());
+	in_.push_back(ArcVector());
+	slots_.insert(std::make_pair(name, slot));
+	++num_live_;
+
+	/* The new node is unreachable in the existing trees */
+	for (unsigned int s = 0; s < trees_.size(); ++s)
+	{
+		Tree& tree = trees_[s];
+		if (tree.dist.empty())
+			continue;
+		tree.dist.push_back(INF);
+		tree.pred.push_back(NO_PRED);
+	}
+	trees_.push_back(Tree());
+
+	ranks_valid_ = false;
+	++generation_;
+	return slot;
+}
+
+void IncrementalShortestPaths::remove_node(unsigned int slot)
+{
+	if (!live_[slot])
+		return;
+
+	/* Copies, since removing the edges modifies the lists */
+	ArcVector out = out_[slot];
+	for (unsigned int i = 0; i < out.size(); ++i)
+		remove_edge(slot, out[i].node);
+	ArcVector in = in_[slot];
+	for (unsigned int i = 0; i < in.size(); ++i)
+		remove_edge(in[i].node, slot);
+
+	slots_.erase(names_[slot]);
+	live_[slot] = 0;
+	--num_live_;
+
+	/* The slot is not reused, so its tree can be freed */
+	std::vector<double>().swap(trees_[slot].dist);
+	std::vector<int>().swap(trees_[slot].pred);
+
+	ranks_valid_ = false;
+	++generation_;
+}
+
+bool IncrementalShortestPaths::set_arc(ArcVector& arcs, unsigned int node, double weight, double& old_weight)
+{
+	ArcVector::iterator itr = std::lower_bound(arcs.begin(), arcs.end(), Arc(node, 0.0));
+	if (itr != arcs.end() && itr->node == node)
+	{
+		old_weight = itr->weight;
+		if (old_weight == weight)
+			return false;
+		itr->weight = weight;
+		return true;
+	}
+
+	old_weight = INF;
+	arcs.insert(itr, Arc(node, weight));
+	return true;
+}
+
+bool IncrementalShortestPaths::remove_arc(ArcVector& arcs, unsigned int node, double& old_weight)
+{
+	ArcVector::iterator itr = std::lower_bound(arcs.begin(), arcs.end(), Arc(node, 0.0));
+	if (itr == arcs.end() || itr->node != node)
+		return false;
+
+	old_weight = itr->weight;
+	arcs.erase(itr);
+	return true;
+}
+
+void IncrementalShortestPaths::set_edge(unsigned int src, unsigned int dst, double weight)
+{
+	if (!(weight > 0.0))
+		throw std::invalid_argument("edge weights must be positive");
+
+	double old_weight, unused;
+	bool added = !std::binary_search(out_[src].begin(), out_[src].end(), Arc(dst, 0.0));
+	if (!set_arc(out_[src], dst, weight, old_weight))
+		return;
+	set_arc(in_[dst], src, weight, unused);
+
+	if (added)
+		++num_edges_;
+	++generation_;
+	edge_changed(src, dst, old_weight, weight);
+}
+
+void IncrementalShortestPaths::remove_edge(unsigned int src, unsigned int dst)
+{
+	double old_weight, unused;
+	if (!remove_arc(out_[src], dst, old_weight))
+		return;
+	remove_arc(in_[dst], src, unused);
+
+	--num_edges_;
+	++generation_;
+	edge_changed(src, dst, old_weight, INF);
+}
+
+unsigned int IncrementalShortestPaths::sync(const std::vector<std::string>& nodes, const std::vector<Edge>& edges, std::vector<unsigned int>& slots)
+{
+	for (unsigned int i = 0; i < edges.size(); ++i)
+	{
+		if (!(edges[i].weight > 0.0))
+			throw std::invalid_argument("edge weights must be positive");
+	}
+
+	/* Start over once most slots belong to removed nodes */
+	if (names_.size() > 64 && num_live_ < names_.size() / 2)
+		reset();
+
+	unsigned int changes = 0;
+
+	/* Find or add the nodes */
+	slots.resize(nodes.size());
+	for (unsigned int i = 0; i < nodes.size(); ++i)
+	{
+		if (!find_node(nodes[i], slots[i]))
+		{
+			slots[i] = add_node(nodes[i]);
+			++changes;
+		}
+	}
+
+	std::vector<char> keep(names_.size(), 0);
+	for (unsigned int i = 0; i < slots.size(); ++i)
+		keep[slots[i]] = 1;
+
+	/* Group the wanted edges by source */
+	wanted_.resize(names_.size());
+	for (unsigned int s = 0; s < wanted_.size(); ++s)
+		wanted_[s].clear();
+	for (unsigned int i = 0; i < edges.size(); ++i)
+		wanted_[slots[edges[i].src]].push_back(Arc(slots[edges[i].dst], edges[i].weight));
+
+	/* Compare with the current edges; removed nodes take their edges with them */
+	std::vector<unsigned int> removed_nodes;
+	std::vector<std::pair<unsigned int, Arc> > set_edges;
+	std::vector<std::pair<unsigned int, unsigned int> > removed_edges;
+	unsigned int edge_changes = 0;
+	for (unsigned int u = 0; u < names_.size(); ++u)
+	{
+		if (!live_[u])
+			continue;
+
+		if (!keep[u])
+		{
+			removed_nodes.push_back(u);
+			edge_changes += out_[u].size() + in_[u].size();
+			continue;
+		}
+
+		ArcVector& wanted = wanted_[u];
+		std::sort(wanted.begin(), wanted.end());
+
+		const ArcVector& current = out_[u];
+		ArcVector::const_iterator w_itr = wanted.begin();
+		ArcVector::const_iterator c_itr = current.begin();
+		while (w_itr != wanted.end() || c_itr != current.end())
+		{
+			if (c_itr == current.end() || (w_itr != wanted.end() && w_itr->node < c_itr->node))
+			{
+				set_edges.push_back(std::make_pair(u, *w_itr++));
+			}
+			else if (w_itr == wanted.end() || c_itr->node < w_itr->node)
+			{
+				/* Edges to removed nodes are counted with the node */
+				if (keep[c_itr->node])
+					removed_edges.push_back(std::make_pair(u, c_itr->node));
+				++c_itr;
+			}
+			else
+			{
+				if (w_itr->weight != c_itr->weight)
+					set_edges.push_back(std::make_pair(u, *w_itr));
+				++w_itr;
+				++c_itr;
+			}
+		}
+	}
+	edge_changes += set_edges.size() + removed_edges.size();
+
+	if (edge_changes > std::max(REPAIR_MIN_CHANGES, num_edges_ / REPAIR_EDGE_FRACTION))
+		clear_trees();
+
+	for (unsigned int i = 0; i < removed_nodes.size(); ++i)
+		remove_node(removed_nodes[i]);
+	for (unsigned int i = 0; i < removed_edges.size(); ++i)
+		remove_edge(removed_edges[i].first, removed_edges[i].second);
+	for (unsigned int i = 0; i < set_edges.size(); ++i)
+		set_edge(set_edges[i].first, set_edges[i].second.node, set_edges[i].second.weight);
+
+	return changes + removed_nodes.size() + edge_changes;
+}
+
+const IncrementalShortestPaths::Tree& IncrementalShortestPaths::get_tree(unsigned int src)
+{
+	Tree& tree = trees_[src];
+	if (tree.dist.empty())
+	{
+		compute_tree(src, tree);
+		++full_computations_;
+	}
+	return tree;
+}
+
+void IncrementalShortestPaths::compute_tree(unsigned int src, Tree& result) const
+{
+	update_ranks();
+
+	result.dist.assign(names_.size(), INF);
+	result.pred.assign(names_.size(), NO_PRED);
+	if (!live_[src])
+		return;
+
+	result.dist[src] = 0.0;
+	heap_.clear();
+	heap_.push_back(HeapEntry(0.0, src));
+	relax(result, NULL);
+}
+
+void IncrementalShortestPaths::clear_trees()
+{
+	/* Keep the memory; the trees are likely to be computed again */
+	for (unsigned int s = 0; s < trees_.size(); ++s)
+	{
+		trees_[s].dist.clear();
+		trees_[s].pred.clear();
+	}
+}
+
+void IncrementalShortestPaths::update_ranks() const
+{
+	if (ranks_valid_)
+		return;
+
+	std::vector<std::pair<std::string, unsigned int> > order;
+	order.reserve(num_live_);
+	for (unsigned int s = 0; s < names_.size(); ++s)
+	{
+		if (live_[s])
+			order.push_back(std::make_pair(names_[s], s));
+	}
+	std::sort(order.begin(), order.end());
+
+	ranks_.assign(names_.size(), names_.size());
+	for (unsigned int i = 0; i < order.size(); ++i)
+		ranks_[order[i].second] = i;
+	ranks_valid_ = true;
+}
+
+bool IncrementalShortestPaths::prefer(unsigned int candidate, int current) const
+{
+	return current == NO_PRED || ranks_[candidate] < ranks_[current];
+}
+
+void IncrementalShortestPaths::relax(Tree& tree, const std::vector<char>* restrict_to) const
+{
+	std::greater<HeapEntry> cmp;
+	while (!heap_.empty())
+	{
+		std::pop_heap(heap_.begin(), heap_.end(), cmp);
+		HeapEntry entry = heap_.back();
+		heap_.pop_back();
+
+		/* Skip entries superseded by a shorter distance */
+		unsigned int u = entry.second;
+		if (entry.first != tree.dist[u])
+			continue;
+
+		const ArcVector& arcs = out_[u];
+		for (ArcVector::const_iterator itr = arcs.begin(); itr != arcs.end(); ++itr)
+		{
+			unsigned int v = itr->node;
+			if (restrict_to && !(*restrict_to)[v])
+				continue;
+
+			double d = entry.first + itr->weight;
+			if (d < tree.dist[v])
+			{
+				tree.dist[v] = d;
+				tree.pred[v] = u;
+				heap_.push_back(HeapEntry(d, v));
+				std::push_heap(heap_.begin(), heap_.end(), cmp);
+			}
+			else if (d == tree.dist[v] && d < INF && prefer(u, tree.pred[v]))
+			{
+				tree.pred[v] = u;
+			}
+		}
+	}
+}
+
+void IncrementalShortestPaths::repair_decrease(Tree& tree, unsigned int u, unsigned int v, double weight)
+{
+	if (tree.dist[u] == INF)
+		return;
+
+	double d = tree.dist[u] + weight;
+	if (d < tree.dist[v])
+	{
+		/* Propagate the shorter distance from 'v' */
+		tree.dist[v] = d;
+		tree.pred[v] = u;
+		heap_.clear();
+		heap_.push_back(HeapEntry(d, v));
+		relax(tree, NULL);
+		++repairs_;
+	}
+	else if (d == tree.dist[v] && d < INF && prefer(u, tree.pred[v]))
+	{
+		/* Equally short, and preferred */
+		tree.pred[v] = u;
+		++repairs_;
+	}
+}
+
+void IncrementalShortestPaths::repair_increase(Tree& tree, unsigned int u, unsigned int v)
+{
+	/* Nothing changes unless the edge is in the tree */
+	if (tree.pred[v] != (int)u)
+		return;
+
+	/* Detach the subtree below the edge */
+	affected_.resize(names_.size(), 0);
+	stack_.clear();
+	stack_.push_back(v);
+	affected_[v] = 1;
+	for (unsigned int i = 0; i < stack_.size(); ++i)
+	{
+		unsigned int x = stack_[i];
+		const ArcVector& arcs = out_[x];
+		for (ArcVector::const_iterator itr = arcs.begin(); itr != arcs.end(); ++itr)
+		{
+			if (!affected_[itr->node] && tree.pred[itr->node] == (int)x)
+			{
+				affected_[itr->node] = 1;
+				stack_.push_back(itr->node);
+			}
+		}
+	}
+	for (unsigned int i = 0; i < stack_.size(); ++i)
+	{
+		tree.dist[stack_[i]] = INF;
+		tree.pred[stack_[i]] = NO_PRED;
+	}
+
+	/* Attach each detached node through its best edge from the rest of the tree */
+	heap_.clear();
+	for (unsigned int i = 0; i < stack_.size(); ++i)
+	{
+		unsigned int x = stack_[i];
+		const ArcVector& arcs = in_[x];
+		for (ArcVector::const_iterator itr = arcs.begin(); itr != arcs.end(); ++itr)
+		{
+			unsigned int p = itr->node;
+			if (affected_[p] || tree.dist[p] == INF)
+				continue;
+
+			double d = tree.dist[p] + itr->weight;
+			if (d < tree.dist[x] || (d == tree.dist[x] && d < INF && prefer(p, tree.pred[x])))
+			{
+				tree.dist[x] = d;
+				tree.pred[x] = p;
+			}
+		}
+		if (tree.dist[x] < INF)
+			heap_.push_back(HeapEntry(tree.dist[x], x));
+	}
+	std::make_heap(heap_.begin(), heap_.end(), std::greater<HeapEntry>());
+
+	/* Then settle them in order of distance; nodes outside the subtree keep their distances */
+	relax(tree, &affected_);
+
+	for (unsigned int i = 0; i < stack_.size(); ++i)
+		affected_[stack_[i]] = 0;
+	++repairs_;
+}
+
+void IncrementalShortestPaths::edge_changed(unsigned int u, unsigned int v, double old_weight, double new_weight)
+{
+	if (new_weight == old_weight)
+		return;
+
+	update_ranks();
+	for (unsigned int s = 0; s < trees_.size(); ++s)
+	{
+		Tree& tree = trees_[s];
+		if (tree.dist.empty())
+			continue;
+
+		if (new_weight < old_weight)
+			repair_decrease(tree, u, v, new_weight);
+		else
+			repair_increase(tree, u, v);
+	}
+}
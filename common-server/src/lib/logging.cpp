@@ -29,12 +29,39 @@
 
 #include "p4pserver/logging.h"
 
+#include <log4cpp/BasicLayout.hh>
+#include <log4cpp/FileAppender.hh>
 #include <log4cpp/PatternLayout.hh>
 #include <log4cpp/OstreamAppender.hh>
 #include <log4cpp/SyslogAppender.hh>
+#include <fcntl.h>
 #include <iostream>
+#include <stdexcept>
+#include <boost/thread/mutex.hpp>
+#include "p4pserver/async_appender.h"
 
-void init_logger(unsigned int level, const std::string& ident)
+/* Asynchronous appender currently installed, if any (owned by the root category) */
+static AsyncAppender* ASYNC_APPENDER = NULL;
+static boost::mutex ASYNC_APPENDER_MUTEX;
+static unsigned long long ASYNC_DROPPED_PREVIOUS = 0;
+
+static void set_root_appender(log4cpp::Appender* appender)
+{
+	boost::mutex::scoped_lock lock(ASYNC_APPENDER_MUTEX);
+	if (ASYNC_APPENDER)
+	{
+		ASYNC_DROPPED_PREVIOUS += ASYNC_APPENDER->get_dropped();
+		ASYNC_APPENDER = NULL;
+	}
+
+	/* Deletes (and thereby flushes) the previous appender */
+	log4cpp::Category::getRoot().removeAllAppenders();
+	log4cpp::Category::getRoot().setAppender(appender);
+
+	ASYNC_APPENDER = dynamic_cast<AsyncAppender*>(appender);
+}
+
+void init_logger(unsigned int level, const std::string& ident, const std::string& file, unsigned int async_capacity)
 {
 	switch (level)
 	{
@@ -45,16 +72,62 @@ void init_logger(unsigned int level, const std::string& ident)
 	default:log4cpp::Category::setRootPriority(log4cpp::Priority::DEBUG); break;
 	}
 
-	if (!ident.empty())
+	if (!file.empty())
+	{
+		if (async_capacity > 0)
+		{
+			int fd = ::open(file.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+			if (fd < 0)
+				throw std::runtime_error("Failed to open log file " + file);
+
+			log4cpp::Appender* appender = new AsyncAppender("FILE", fd, async_capacity);
+			appender->setLayout(new log4cpp::BasicLayout());
+			set_root_appender(appender);
+		}
+		else
+		{
+			log4cpp::Appender* appender = new log4cpp::FileAppender("FILE", file);
+			appender->setLayout(new log4cpp::BasicLayout());
+			set_root_appender(appender);
+		}
+	}
+	else if (!ident.empty())
 	{
 		log4cpp::PatternLayout* layout = new log4cpp::PatternLayout();
 		layout->setConversionPattern("%c: %m%n");
 
 		log4cpp::Appender* appender = new log4cpp::SyslogAppender("SYSLOG", ident);
 		appender->setLayout(layout);
-		log4cpp::Category::getRoot().removeAllAppenders();
-		log4cpp::Category::getRoot().setAppender(appender);
+		if (async_capacity > 0)
+			appender = new AsyncAppender("SYSLOG-ASYNC", appender, async_capacity);
+		set_root_appender(appender);
 	}
+	else if (async_capacity > 0)
+	{
+		log4cpp::Appender* appender = new AsyncAppender("STDERR", STDERR_FILENO, async_capacity);
+		appender->setLayout(new log4cpp::BasicLayout());
+		set_root_appender(appender);
+	}
+}
+
+void shutdown_logger()
+{
+	boost::mutex::scoped_lock lock(ASYNC_APPENDER_MUTEX);
+	if (!ASYNC_APPENDER)
+		return;
+
+	ASYNC_APPENDER->close();
+	lock.unlock();
+
+	log4cpp::Appender* appender = new log4cpp::OstreamAppender("STDERR", &std::cerr);
+	appender->setLayout(new log4cpp::BasicLayout());
+	set_root_appender(appender);
+}
+
+unsigned long long get_logger_dropped()
+{
+	boost::mutex::scoped_lock lock(ASYNC_APPENDER_MUTEX);
+	return ASYNC_DROPPED_PREVIOUS + (ASYNC_APPENDER ? ASYNC_APPENDER->get_dropped() : 0);
 }
 
 void logging_init() __attribute__((constructor));
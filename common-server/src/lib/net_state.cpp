@@ -34,6 +34,27 @@
 #include <boost/graph/adj_list_serialize.hpp>
 #include <boost/foreach.hpp>
 #include <boost/graph/dijkstra_shortest_paths.hpp>
+#include <algorithm>
+
+NetVertexNameTable& get_vertex_names()
+{
+	/* Never freed, so names stay valid for objects destroyed at exit */
+	static NetVertexNameTable* names = new NetVertexNameTable();
+	return *names;
+}
+
+void intern_vertex_names(const NetVertexNameSet& names, NetVertexNameIdVector& result)
+{
+	NetVertexNameTable& table = get_vertex_names();
+
+	result.clear();
+	result.reserve(names.size());
+	BOOST_FOREACH(const NetVertexName& name, names)
+	{
+		result.push_back(table.intern(name));
+	}
+	std::sort(result.begin(), result.end());
+}
 
 NetState::NetState(const bfs::path& dist_file)
 	: DistributedObject(dist_file)
@@ -79,7 +100,7 @@ bool NetState::add_node(const NetVertexName& name, NetVertex& result, const Writ
 	 * Update graph and bookkeeping
 	 */
 	result = add_vertex(graph_);
-	name_vert_map_.insert(std::make_pair(name, result));
+	name_vert_map_.insert(std::make_pair(get_vertex_names().intern(name), result));
 	boost::put(boost::get(netvertex_name, graph_), result, name);
 
 	changed(lock);
@@ -188,7 +209,7 @@ void NetState::remove_node(const NetVertex& vertex, const WritableLock& lock)
 {
 	lock.check_write(get_local_mutex());
 
-	NetVertexName v_name = get_name(vertex, lock);
+	NetVertexNameId v_name = get_vertex_names().intern(get_name(vertex, lock));
 
 	/*
 	 * Update graph and bookkeeping
@@ -293,7 +314,7 @@ void NetState::refresh_names(const WritableLock& lock)
 
 	BOOST_FOREACH(const NetVertex& v, get_nodes(lock))
 	{
-		name_vert_map_[get_name(v, lock)] = v;
+		name_vert_map_[get_vertex_names().intern(get_name(v, lock))] = v;
 	}
 
 	BOOST_FOREACH(const NetEdge& e, get_edges(lock))
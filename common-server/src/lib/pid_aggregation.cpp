@@ -31,6 +31,8 @@
 
 #include <boost/serialization/map.hpp>
 #include <boost/serialization/set.hpp>
+#include <algorithm>
+#include <iterator>
 
 PIDAggregation::PIDAggregation()
 	: pid_records_by_name_(pid_records_.get<0>()),
@@ -140,7 +142,7 @@ bool PIDAggregation::get_vertices(const p4p::PID&  pid, NetVertexNameSet& result
 	if (itr == pid_records_by_pid_.end())
 		return false;
 
-	result = itr->vertices;
+	itr->get_vertices(result);
 	return true;
 }
 
@@ -168,8 +170,11 @@ bool PIDAggregation::add_vertices(const p4p::PID&  pid, const NetVertexNameSet&
 	if (itr == pid_records_by_pid_.end())
 		return false;
 
-	PIDRecord r(itr->name, itr->pid, itr->vertices);
-	std::copy(vertices.begin(), vertices.end(), std::inserter(r.vertices, r.vertices.end()));
+	NetVertexNameIdVector added;
+	intern_vertex_names(vertices, added);
+
+	PIDRecord r(itr->name, itr->pid, NetVertexNameIdVector());
+	std::set_union(itr->vertices.begin(), itr->vertices.end(), added.begin(), added.end(), std::back_inserter(r.vertices));
 	pid_records_by_pid_.erase(itr);
 	pid_records_.insert(r);
 
@@ -185,11 +190,18 @@ bool PIDAggregation::remove_vertices(const p4p::PID&  pid, const NetVertexNameSe
 	if (itr == pid_records_by_pid_.end())
 		return false;
 
-	PIDRecord r(itr->name, itr->pid, itr->vertices);
+	/* Names which were never interned can't be in the record */
+	NetVertexNameIdVector removed;
 	BOOST_FOREACH(const NetVertexName& v, vertices)
 	{
-		r.vertices.erase(v);
+		NetVertexNameId id;
+		if (get_vertex_names().find(v, id))
+			removed.push_back(id);
 	}
+	std::sort(removed.begin(), removed.end());
+
+	PIDRecord r(itr->name, itr->pid, NetVertexNameIdVector());
+	std::set_difference(itr->vertices.begin(), itr->vertices.end(), removed.begin(), removed.end(), std::back_inserter(r.vertices));
 	pid_records_by_pid_.erase(itr);
 	pid_records_.insert(r);
 
@@ -205,7 +217,7 @@ bool PIDAggregation::clear_vertices(const p4p::PID&  pid, const WritableLock& lo
 	if (itr == pid_records_by_pid_.end())
 		return false;
 
-	PIDRecord r(itr->name, itr->pid, NetVertexNameSet());
+	PIDRecord r(itr->name, itr->pid, NetVertexNameIdVector());
 	pid_records_by_pid_.erase(itr);
 	pid_records_.insert(r);
 
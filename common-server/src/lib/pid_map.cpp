@@ -29,6 +29,7 @@
 
 #include "p4pserver/pid_map.h"
 
+#include <algorithm>
 #include <boost/foreach.hpp>
 #include <boost/serialization/string.hpp>
 #include <sys/types.h>
@@ -37,6 +38,28 @@
 #include <string.h>
 #include <limits.h>
 
+/* Orders table entries by PID, for searching */
+struct PIDPrefixTableEntryLess
+{
+	bool operator()(const PIDPrefixTable::Entry& entry, const p4p::PID& pid) const { return entry.first < pid; }
+};
+
+PIDPrefixTable::PIDPrefixTable(EntryVector& entries)
+	: num_prefixes_(0)
+{
+	entries_.swap(entries);
+	for (unsigned int i = 0; i < entries_.size(); ++i)
+		num_prefixes_ += entries_[i].second.size();
+}
+
+const PIDPrefixTable::Entry* PIDPrefixTable::find(const p4p::PID& pid) const
+{
+	EntryVector::const_iterator itr = std::lower_bound(entries_.begin(), entries_.end(), pid, PIDPrefixTableEntryLess());
+	if (itr == entries_.end() || itr->first != pid)
+		return NULL;
+	return &*itr;
+}
+
 PIDMap::PIDMap()
 {
 	after_construct();
@@ -116,7 +139,10 @@ bool PIDMap::add(const p4p::IPPrefix& address, const p4p::PID&  pid, const Writa
 	bool res = tree_.add(address, pid);
 	
 	if (res)
+	{
+		reset_table();
 		changed(lock);
+	}
 	
 	return res;
 }
@@ -128,7 +154,10 @@ bool PIDMap::remove(const p4p::IPPrefix& address, const p4p::PID&  pid, const Wr
 	bool res = tree_.remove(address, pid);
 
 	if (res)
+	{
+		reset_table();
 		changed(lock);
+	}
 
 	return res;
 }
@@ -148,6 +177,7 @@ void PIDMap::clear(const WritableLock& lock)
 {
 	lock.check_write(get_local_mutex());
 	tree_.clear();
+	reset_table();
 	changed(lock);
 }
 
@@ -158,7 +188,10 @@ bool PIDMap::remove(const p4p::PID&  pid, const WritableLock& lock)
 	bool res = tree_.remove(pid);
 	
 	if (res)
+	{
+		reset_table();
 		changed(lock);
+	}
 
 	return res;
 }
@@ -187,14 +220,52 @@ const p4p::PID* PIDMap::lookup(int addr_family, const void* addr_struct, unsigne
 
 void PIDMap::get_prefixes(const p4p::PID&  pid, p4p::IPPrefixVector& result, const ReadableLock& lock) const
 {
-	lock.check_read(get_local_mutex());
-	tree_.get_prefixes(pid, result);
+	const PIDPrefixTable::Entry* entry = get_table(lock)->find(pid);
+	if (entry)
+		result = entry->second;
+	else
+		result.clear();
 }
 
 void PIDMap::enumerate(std::vector<std::pair<p4p::PID, std::vector<p4p::IPPrefix> > >& result, const ReadableLock& lock) const
+{
+	PIDPrefixTableConstPtr table = get_table(lock);
+
+	/* All PIDs if none were given */
+	if (result.empty())
+	{
+		result = table->get_entries();
+		return;
+	}
+
+	for (unsigned int i = 0; i < result.size(); ++i)
+	{
+		const PIDPrefixTable::Entry* entry = table->find(result[i].first);
+		if (entry)
+			result[i].second = entry->second;
+		else
+			result[i].second.clear();
+	}
+}
+
+PIDPrefixTableConstPtr PIDMap::get_table(const ReadableLock& lock) const
 {
 	lock.check_read(get_local_mutex());
-	tree_.enumerate(result);
+
+	boost::mutex::scoped_lock table_lock(table_mutex_);
+	if (!table_)
+	{
+		PIDPrefixTable::EntryVector entries;
+		tree_.enumerate(entries);
+		table_ = PIDPrefixTableConstPtr(new PIDPrefixTable(entries));
+	}
+	return table_;
+}
+
+void PIDMap::reset_table()
+{
+	boost::mutex::scoped_lock table_lock(table_mutex_);
+	table_.reset();
 }
 
 DistributedObjectPtr PIDMap::do_copy_properties(const ReadableLock& lock)
@@ -203,5 +274,9 @@ DistributedObjectPtr PIDMap::do_copy_properties(const ReadableLock& lock)
 
 	PIDMapPtr new_obj = boost::dynamic_pointer_cast<PIDMap>(PIDMap::create_empty_instance());
 	new_obj->tree_.copy_from(tree_);
+
+	/* The copy has the same prefixes until it is changed */
+	boost::mutex::scoped_lock table_lock(table_mutex_);
+	new_obj->table_ = table_;
 	return new_obj;
 }
@@ -32,13 +32,39 @@
 #include <boost/serialization/map.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "p4pserver/incremental_shortest_paths.h"
 #include "p4pserver/pid_matrix.h"
 
+struct PIDRouting::ShortestPaths
+{
+	boost::mutex mutex;
+	IncrementalShortestPaths paths;
+
+	/* Same graph with every edge reversed, so a tree gives the distance
+	 * from each node to its source */
+	IncrementalShortestPaths reverse_paths;
+};
+
+/* Orders vertex indexes by their distance to the destination */
+struct MultipathDistanceLess
+{
+	MultipathDistanceLess(const std::vector<double>& dist) : dist(dist) {}
+	bool operator()(unsigned int lhs, unsigned int rhs) const { return dist[lhs] < dist[rhs]; }
+
+	const std::vector<double>& dist;
+};
+
 PIDRouting::PIDRouting(double default_weight)
 	: default_weight_(default_weight),
 	  route_mode_(RM_WEIGHTS),
 	  weights_(SparsePIDMatrixPtr(new SparsePIDMatrix())),
-	  weights_lock_(new BlockWriteLock(*weights_))
+	  weights_lock_(new BlockWriteLock(*weights_)),
+	  shortest_paths_(new ShortestPaths())
 {
 	after_construct();
 }
@@ -50,15 +76,36 @@ PIDRouting::~PIDRouting()
 }
 
 #ifdef P4P_CLUSTER
+/*
+ * Version of the saved format. Version 1 (before static routes carried
+ * weights) stores the route mode right after the default weight; later
+ * versions store the negated version there, followed by the route mode.
+ */
+static const int PID_ROUTING_FORMAT_VERSION = 2;
+
 void PIDRouting::do_load(InputArchive& stream, const WritableLock& lock)
 {
 	lock.check_read(get_local_mutex());
 
+	int version = 1;
+	int mode;
 	stream >> default_weight_;
-	stream >> route_mode_;
+	stream >> mode;
+	if (mode < 0)
+	{
+		version = -mode;
+		if (version > PID_ROUTING_FORMAT_VERSION)
+			throw distributed_object_error("unsupported routing format version " + boost::lexical_cast<std::string>(version));
+		stream >> mode;
+	}
+	route_mode_ = (RouteMode)mode;
+
+	static_route_weights_.clear();
 	if (route_mode_ == RM_STATIC)
 	{
 		stream >> static_routes_;
+		if (version >= 2)
+			stream >> static_route_weights_;
 		static_route_ptrs_.clear();
 		for (StaticRouteMap::iterator r_itr = static_routes_.begin(); r_itr != static_routes_.end(); ++r_itr)
 			add_static_route_ptrs(r_itr);
@@ -72,10 +119,16 @@ void PIDRouting::do_save(OutputArchive& stream, const ReadableLock& lock) const
 {
 	lock.check_read(get_local_mutex());
 
+	const int version = -PID_ROUTING_FORMAT_VERSION;
+	const int mode = route_mode_;
 	stream << default_weight_;
-	stream << route_mode_;
+	stream << version;
+	stream << mode;
 	if (route_mode_ == RM_STATIC)
+	{
 		stream << static_routes_;
+		stream << static_route_weights_;
+	}
 	weights_->do_save(stream, *weights_lock_);
 }
 #endif
@@ -90,12 +143,14 @@ DistributedObjectPtr PIDRouting::do_copy_properties(const ReadableLock& lock)
 	if (route_mode_ == RM_STATIC)
 	{
 		new_obj->static_routes_ = static_routes_;
+		new_obj->static_route_weights_ = static_route_weights_;
 		for (StaticRouteMap::iterator r_itr = new_obj->static_routes_.begin(); r_itr != new_obj->static_routes_.end(); ++r_itr)
 			add_static_route_ptrs(r_itr);
 	}
 	delete new_obj->weights_lock_;
 	new_obj->weights_ = boost::dynamic_pointer_cast<SparsePIDMatrix>(weights_->copy(*weights_lock_));
 	new_obj->weights_lock_ = new BlockWriteLock(*new_obj->weights_);
+	new_obj->shortest_paths_ = shortest_paths_;
 	return new_obj;
 }
 
@@ -160,28 +215,131 @@ bool PIDRouting::get_routes_static(const PinnedPID&  src, const NetState& state,
 	lock.check_read(get_local_mutex());
 
 	result.result_.clear();
+	result.splits_.clear();
 
 	BOOST_FOREACH(const PinnedPID&  dst, pids)
 	{
 		/*
 		* Currently we silently ignore the case where a route doesn't exist
 		*/
-		const NamedRoute* route = get_static_route(src, dst, lock);
-		if (!route)
+		StaticRouteMapItrPair routes = get_static_routes(src, dst, lock);
+		if (routes.first == routes.second)
 			continue;
 
-		result.route_forward_.clear();
-		BOOST_FOREACH(const p4p::PID&  hop, *route)
+		double total_weight = 0.0;
+		for (StaticRouteMapItr r_itr = routes.first; r_itr != routes.second; ++r_itr)
 		{
-			const PinnedPIDSet::const_iterator itr = pids.find(PinnedPID(hop, NULL));
-			if (itr == pids.end())
-				return false;
+			result.route_forward_.clear();
+			BOOST_FOREACH(const p4p::PID&  hop, r_itr->second)
+			{
+				const PinnedPIDSet::const_iterator itr = pids.find(PinnedPID(hop, NULL));
+				if (itr == pids.end())
+					return false;
+
+				result.route_forward_.push_back(*itr);
+			}
+
+			/* The first route is the one used when traffic isn't split */
+			if (r_itr == routes.first)
+			{
+				result.result_[dst] = result.route_forward_;
+				if (++StaticRouteMapItr(r_itr) == routes.second)
+					break;
+			}
+
+			double weight = get_static_route_weight(r_itr->second, lock);
+			result.splits_[dst].push_back(std::make_pair(result.route_forward_, weight));
+			total_weight += weight;
+		}
+
+		/* Convert weights of multiple routes into the share of traffic each carries */
+		PinnedRouteSplitMap::iterator split_itr = result.splits_.find(dst);
+		if (split_itr == result.splits_.end())
+			continue;
+		PinnedRouteSplit& split = split_itr->second;
+		for (unsigned int i = 0; i < split.size(); ++i)
+			split[i].second = (total_weight > 0.0) ? split[i].second / total_weight : 1.0 / split.size();
+	}
+	result.route_forward_.clear();
+	return true;
+}
+
+void PIDRouting::prepare_context(const NetState& state, const ReadableLock& state_lock, RouteComputationContext& result, const ReadableLock& lock) const
+{
+	/*
+	 * Assign each vertex an index
+	 */
+	unsigned int v_idx = 0;
+	BOOST_FOREACH(const NetVertex& v, state.get_nodes(state_lock))
+	{
+		result.vert_indexes_[v] = v_idx++;
+		result.index_verts_.push_back(v);
+	}
+	result.out_arcs_.resize(v_idx);
+
+	/*
+	 * Construct a map of edge weights
+	 */
+	result.incremental_ = true;
+	BOOST_FOREACH(const NetEdge& e, state.get_edges(state_lock))
+	{
+		/*
+		 * Find the source and destination pids.  If either doesn't exist,
+		 * then assign the edge the default weight.
+		 */
+		NetVertex v_src, v_dst;
+		state.get_edge_vert(e, v_src, v_dst, state_lock);
+		double weight = get_weight(state.get_pid(v_src, state_lock), state.get_pid(v_dst, state_lock), lock);
+		result.edge_weights_[e] = weight;
+		result.out_arcs_[result.vert_indexes_[v_src]].push_back(std::make_pair(result.vert_indexes_[v_dst], weight));
+
+		/* The shared trees need positive weights */
+		if (!(weight > 0.0))
+			result.incremental_ = false;
+	}
 
-			result.route_forward_.push_back(*itr);
+	result.route_reverse_.reserve(state.get_num_nodes(state_lock) / 2);
+	result.route_forward_.reserve(state.get_num_nodes(state_lock) / 2);
+}
+
+bool PIDRouting::sync_shortest_paths(const NetState& state, const ReadableLock& state_lock, RouteComputationContext& result, bool reverse) const
+{
+	IncrementalShortestPaths& paths = reverse ? shortest_paths_->reverse_paths : shortest_paths_->paths;
+	std::vector<unsigned int>& slots = reverse ? result.reverse_slots_ : result.path_slots_;
+
+	/* Describe the topology by vertex index, which is stable for this context */
+	std::vector<std::string> names(result.index_verts_.size());
+	for (unsigned int i = 0; i < result.index_verts_.size(); ++i)
+		names[i] = state.get_name(result.index_verts_[i], state_lock);
+
+	std::vector<IncrementalShortestPaths::Edge> edges;
+	edges.reserve(result.edge_weights_.size());
+	for (unsigned int i = 0; i < result.out_arcs_.size(); ++i)
+	{
+		for (unsigned int j = 0; j < result.out_arcs_[i].size(); ++j)
+		{
+			unsigned int dst = result.out_arcs_[i][j].first;
+			double weight = result.out_arcs_[i][j].second;
+			edges.push_back(reverse ? IncrementalShortestPaths::Edge(dst, i, weight) : IncrementalShortestPaths::Edge(i, dst, weight));
 		}
+	}
 
-		result.result_[dst] = result.route_forward_;
+	/* Bring the trees up to date, and map their slots back to vertices.
+	 * Vertices must have distinct names to be told apart. */
+	paths.sync(names, edges, slots);
+	if (paths.get_num_nodes() != names.size())
+		return false;
+
+	if (reverse)
+	{
+		result.reverse_generation_ = paths.get_generation();
+		return true;
 	}
+
+	result.path_verts_.assign(paths.get_num_slots(), NetVertex());
+	for (unsigned int i = 0; i < result.index_verts_.size(); ++i)
+		result.path_verts_[result.path_slots_[i]] = result.index_verts_[i];
+	result.paths_generation_ = paths.get_generation();
 	return true;
 }
 
@@ -193,40 +351,43 @@ bool PIDRouting::get_routes_weights(const PinnedPID&  src, const NetState& state
 	* If the context is empty, fill it in
 	*/
 	if (result.vert_indexes_.empty())
+		prepare_context(state, state_lock, result, lock);
+
+	result.result_.clear();
+
+	/*
+	 * Compute the routes
+	 */
+	if (result.incremental_)
 	{
 		/*
-		 * Assign each vertex an index
+		 * Take the tree from the shared trees, which only need repairs if
+		 * the topology or weights changed since the last computation.
+		 * Resynchronize if another context changed them since this one
+		 * last looked.
 		 */
-		unsigned int v_idx = 0;
-		BOOST_FOREACH(const NetVertex& v, state.get_nodes(state_lock))
+		boost::mutex::scoped_lock paths_lock(shortest_paths_->mutex);
+		IncrementalShortestPaths& paths = shortest_paths_->paths;
+		if ((result.path_verts_.empty() || result.paths_generation_ != paths.get_generation())
+				&& !sync_shortest_paths(state, state_lock, result, false))
 		{
-			result.vert_indexes_[v] = v_idx++;
+			result.incremental_ = false;
 		}
-
-		/*
-		 * Construct a map of edge weights
-		 */
-		BOOST_FOREACH(const NetEdge& e, state.get_edges(state_lock))
+		else
 		{
-			/*
-			 * Find the source and destination pids.  If either doesn't exist,
-			 * then assign the edge the default weight.
-			 */
-			NetVertex v_src, v_dst;
-			state.get_edge_vert(e, v_src, v_dst, state_lock);
-			result.edge_weights_[e] = get_weight(state.get_pid(v_src, state_lock), state.get_pid(v_dst, state_lock), lock);
+			const IncrementalShortestPaths::Tree& tree = paths.get_tree(result.path_slots_[result.vert_indexes_[src.get_vertex()]]);
+			for (NetVertexIndexMap::const_iterator itr = result.vert_indexes_.begin(); itr != result.vert_indexes_.end(); ++itr)
+			{
+				int pred = tree.pred[result.path_slots_[itr->second]];
+				result.vert_preds_[itr->first] = (pred == IncrementalShortestPaths::NO_PRED) ? itr->first : result.path_verts_[pred];
+			}
 		}
-
-		result.route_reverse_.reserve(state.get_num_nodes(state_lock) / 2);
-		result.route_forward_.reserve(state.get_num_nodes(state_lock) / 2);
 	}
 
-	result.result_.clear();
-
-	/*
-	 * Compute the routes
-	 */
-	state.compute_shortest_paths(src.get_vertex(), result.vert_indexes_, result.vert_preds_, result.edge_weights_, state_lock);
+	if (!result.incremental_)
+	{
+		state.compute_shortest_paths(src.get_vertex(), result.vert_indexes_, result.vert_preds_, result.edge_weights_, state_lock);
+	}
 
 	BOOST_FOREACH(const PinnedPID&  pid, pids)
 	{
@@ -273,11 +434,91 @@ bool PIDRouting::get_routes(const PinnedPID&  src, const NetState& state, const
 	{
 		case RM_STATIC:  return get_routes_static(src, state, state_lock, pids, result, lock);
 		case RM_WEIGHTS: return get_routes_weights(src, state, state_lock, pids, result, lock);
+		case RM_ECMP:    return get_routes_weights(src, state, state_lock, pids, result, lock);
 		default:         throw std::runtime_error("Illegal state: invalid route mode");
 	}
 }
 
+bool PIDRouting::get_multipath(const PinnedPID&  dst, const NetState& state, const ReadableLock& state_lock, RouteComputationContext& result, const ReadableLock& lock) const
+{
+	lock.check_read(get_local_mutex());
+
+	if (result.vert_indexes_.empty())
+		prepare_context(state, state_lock, result, lock);
+
+	result.multipath_order_.clear();
+	result.multipath_hops_.clear();
+
+	/* Distances need positive weights to define the equal-cost next hops */
+	if (!result.incremental_)
+		return false;
+
+	unsigned int num_verts = result.index_verts_.size();
+	unsigned int dst_idx = result.vert_indexes_[dst.get_vertex()];
+
+	/*
+	 * Take the distance of every vertex to the destination from the
+	 * shared trees over the reversed graph
+	 */
+	{
+		boost::mutex::scoped_lock paths_lock(shortest_paths_->mutex);
+		IncrementalShortestPaths& paths = shortest_paths_->reverse_paths;
+		if ((result.reverse_slots_.empty() || result.reverse_generation_ != paths.get_generation())
+				&& !sync_shortest_paths(state, state_lock, result, true))
+		{
+			return false;
+		}
+
+		const IncrementalShortestPaths::Tree& tree = paths.get_tree(result.reverse_slots_[dst_idx]);
+		result.multipath_dist_.resize(num_verts);
+		for (unsigned int i = 0; i < num_verts; ++i)
+			result.multipath_dist_[i] = tree.dist[result.reverse_slots_[i]];
+	}
+	const std::vector<double>& dist = result.multipath_dist_;
+
+	/* Vertices which reach the destination, nearest first */
+	for (unsigned int i = 0; i < num_verts; ++i)
+	{
+		if (dist[i] < std::numeric_limits<double>::infinity())
+			result.multipath_order_.push_back(i);
+	}
+	std::stable_sort(result.multipath_order_.begin(), result.multipath_order_.end(), MultipathDistanceLess(dist));
+
+	/*
+	 * Next hops of each vertex are those on some shortest path: the edges
+	 * (x,y) with weight(x,y) + dist(y) == dist(x), allowing for rounding
+	 */
+	result.multipath_hop_begin_.assign(num_verts, 0);
+	result.multipath_hop_count_.assign(num_verts, 0);
+	BOOST_FOREACH(unsigned int x, result.multipath_order_)
+	{
+		result.multipath_hop_begin_[x] = result.multipath_hops_.size();
+		if (x == dst_idx)
+			continue;
+
+		double tolerance = 1e-9 * std::max(1.0, dist[x]);
+		const std::vector<std::pair<unsigned int, double> >& arcs = result.out_arcs_[x];
+		for (unsigned int i = 0; i < arcs.size(); ++i)
+		{
+			unsigned int y = arcs[i].first;
+			if (dist[y] < dist[x] && std::fabs(arcs[i].second + dist[y] - dist[x]) <= tolerance)
+				result.multipath_hops_.push_back(MultipathHop(y, 0.0));
+		}
+
+		unsigned int count = result.multipath_hops_.size() - result.multipath_hop_begin_[x];
+		result.multipath_hop_count_[x] = count;
+		for (unsigned int i = result.multipath_hop_begin_[x]; i < result.multipath_hops_.size(); ++i)
+			result.multipath_hops_[i].fraction = 1.0 / count;
+	}
+	return true;
+}
+
 bool PIDRouting::add_static_route(const NamedRoute& value, const WritableLock& lock)
+{
+	return add_static_route(value, 1.0, lock);
+}
+
+bool PIDRouting::add_static_route(const NamedRoute& value, double weight, const WritableLock& lock)
 {
 	lock.check_write(get_local_mutex());
 
@@ -288,12 +529,28 @@ bool PIDRouting::add_static_route(const NamedRoute& value, const WritableLock& l
 	if (value.size() < 2)
 		return false;
 
+	if (!(weight > 0.0))
+		return false;
+
 	add_static_route_ptrs(static_routes_.insert(std::make_pair(RouteEndpoints(value.front(), value.back()), value)));
+	if (weight == 1.0)
+		static_route_weights_.erase(value);
+	else
+		static_route_weights_[value] = weight;
 
 	changed(lock);
 	return true;
 }
 
+double PIDRouting::get_static_route_weight(const NamedRoute& route, const ReadableLock& lock) const
+{
+	lock.check_read(get_local_mutex());
+	StaticRouteWeightMap::const_iterator itr = static_route_weights_.find(route);
+	if (itr == static_route_weights_.end())
+		return 1.0;
+	return itr->second;
+}
+
 bool PIDRouting::remove_static_route(const NamedRoute& route, const WritableLock& lock)
 {
 	lock.check_write(get_local_mutex());
@@ -311,6 +568,7 @@ bool PIDRouting::remove_static_route(const NamedRoute& route, const WritableLock
 
 		remove_static_route_ptrs(r_itr);
 		static_routes_.erase(r_itr);
+		static_route_weights_.erase(route);
 
 		changed(lock);
 		return true;
@@ -328,6 +586,7 @@ bool PIDRouting::clear_static_routes(const WritableLock& lock)
 
 	static_routes_.clear();
 	static_route_ptrs_.clear();
+	static_route_weights_.clear();
 	changed(lock);
 	return true;
 }
@@ -349,8 +608,11 @@ void PIDRouting::set_route_mode(RouteMode value, const WritableLock& lock)
 	/* Update the mode */
 	route_mode_ = value;
 
-	/* initialize routes for the new mode */
-	clear_static_routes(lock);
+	/* initialize routes for the new mode (static routes are dropped
+	 * directly, since clear_static_routes() only applies to RM_STATIC) */
+	static_routes_.clear();
+	static_route_ptrs_.clear();
+	static_route_weights_.clear();
 	switch (route_mode_)
 	{
 		case RM_STATIC:
@@ -359,6 +621,9 @@ void PIDRouting::set_route_mode(RouteMode value, const WritableLock& lock)
 		case RM_WEIGHTS:
 			/* compute routes using the weights */
 			break;
+		case RM_ECMP:
+			/* compute routes using the weights, splitting between equal-cost next hops */
+			break;
 		default:
 			throw std::runtime_error("Invalid routing mode!");
 	}
@@ -366,6 +631,30 @@ void PIDRouting::set_route_mode(RouteMode value, const WritableLock& lock)
 	changed(lock);
 }
 
+const char* PIDRouting::get_route_mode_name(RouteMode value)
+{
+	switch (value)
+	{
+		case RM_STATIC:  return "static";
+		case RM_WEIGHTS: return "weights";
+		case RM_ECMP:    return "ecmp";
+		default:         return "unknown";
+	}
+}
+
+bool PIDRouting::parse_route_mode(const std::string& name, RouteMode& result)
+{
+	if (name == "static")
+		result = RM_STATIC;
+	else if (name == "weights")
+		result = RM_WEIGHTS;
+	else if (name == "ecmp")
+		result = RM_ECMP;
+	else
+		return false;
+	return true;
+}
+
 void PIDRouting::append_static_route_ptrs(const p4p::PID&  pid, StaticRouteMapItrSet& route_itrs)
 {
 	if (route_mode_ != RM_STATIC)
@@ -426,6 +715,7 @@ void PIDRouting::add_pid(const p4p::PID&  pid, const WritableLock& lock)
 		break;
 	}
 	case RM_WEIGHTS:
+	case RM_ECMP:
 	{
 		weights_->add_pid(pid, *weights_lock_);
 		break;
@@ -436,6 +726,27 @@ void PIDRouting::add_pid(const p4p::PID&  pid, const WritableLock& lock)
 	changed(lock);
 }
 
+/* Adding PIDs one at a time rebuilds the weight matrix for each */
+void PIDRouting::add_pids(const p4p::PIDSet& pids, const WritableLock& lock)
+{
+	switch (route_mode_)
+	{
+	case RM_STATIC:
+	{
+		break;
+	}
+	case RM_WEIGHTS:
+	case RM_ECMP:
+	{
+		weights_->add_pids(pids, *weights_lock_);
+		break;
+	}
+	default: throw std::runtime_error("Invalid routing mode!");
+	}
+
+	changed(lock);
+}
+
 void PIDRouting::remove_pid(const p4p::PID&  pid, const WritableLock& lock)
 {
 	lock.check_write(get_local_mutex());
@@ -450,6 +761,7 @@ void PIDRouting::remove_pid(const p4p::PID&  pid, const WritableLock& lock)
 		break;
 	}
 	case RM_WEIGHTS:
+	case RM_ECMP:
 	{
 		weights_->remove_pid(pid, *weights_lock_);
 		break;
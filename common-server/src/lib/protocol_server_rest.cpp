@@ -30,8 +30,13 @@
 #include "p4pserver/protocol_server_rest.h"
 
 #include <iostream>
+#include <stdexcept>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <sys/socket.h>
 
 #include <boost/thread/mutex.hpp>
+#include <p4pserver/locking.h>
 extern "C" {
 #include <microhttpd.h>
 }
@@ -45,6 +50,17 @@ int print_out_key (void *cls, enum MHD_ValueKind kind,
 }
 
 
+/* Handlers use non-blocking locks on views so that requests are not held up
+ * behind an update. If a lock is busy, answer with a 503 so that the client
+ * retries. */
+static void REST_LockBusy(ProtocolServerRESTBase* server, RESTRequestState* state)
+{
+	server->get_server_logger()->debug("view locked by update; returning 503");
+	server->get_metrics().record_lock_busy(state->get_metrics_handler());
+	if (!state->get_response())
+		state->set_empty_response(MHD_HTTP_SERVICE_UNAVAILABLE);
+}
+
 #if MHD_VERSION >= 0x00040001
 static int REST_AccessHandlerCallback(void* cls, struct MHD_Connection* connection, const char* url, const char* method, const char* version, const char* upload_data, size_t* upload_data_size, void** con_cls)
 #else
@@ -60,6 +76,7 @@ static int REST_AccessHandlerCallback(void* cls, struct MHD_Connection* connecti
 		state = server->get_request_state();
 		state->clear();
 		state->set_conn(connection);
+		state->set_start_time(boost::posix_time::microsec_clock::universal_time());
 
 		//MHD_get_connection_values (connection, MHD_HEADER_KIND, &print_out_key, state);
 
@@ -99,9 +116,17 @@ static int REST_AccessHandlerCallback(void* cls, struct MHD_Connection* connecti
 
 		/* Install callbacks for handling the request */
 		server->get_server_logger()->debug("Installing callbacks");
-		if ((!server->handle_request(state) || !state->get_finish_callback()) && !state->get_response())
+		try
 		{
-			state->set_empty_response(MHD_HTTP_METHOD_NOT_ACCEPTABLE);
+			if ((!server->handle_request(state) || !state->get_finish_callback()) && !state->get_response())
+			{
+				state->set_empty_response(MHD_HTTP_METHOD_NOT_ACCEPTABLE);
+				return MHD_YES;
+			}
+		}
+		catch (TryLockFailed& e)
+		{
+			REST_LockBusy(server, state);
 			return MHD_YES;
 		}
 	}
@@ -124,20 +149,26 @@ static int REST_AccessHandlerCallback(void* cls, struct MHD_Connection* connecti
 		/* Append data buffer. libmicrohttpd requires us to consume at least
 		 * some data, but we aren't guaranteed that our callback processes
 		 * any data.  Thus, we need an intermediate buffer. */
-
-		buffer.set_capacity(std::max(buffer.capacity(), buffer.size() + *upload_data_size));
-		buffer.insert(buffer.end(), upload_data, upload_data + *upload_data_size);
+		buffer.append(upload_data, *upload_data_size);
 		server->get_server_logger()->debug("added %d bytes to buffer; buffer has %u bytes total", *upload_data_size, buffer.size());
 
 		/* Process available data */
-		buffer.linearize();
-		int bytes_read = server->process_request_data(state, buffer.array_one().first, buffer.array_one().second);
+		int bytes_read;
+		try
+		{
+			bytes_read = server->process_request_data(state, buffer.data(), buffer.size());
+		}
+		catch (TryLockFailed& e)
+		{
+			REST_LockBusy(server, state);
+			bytes_read = buffer.size();
+		}
 		if (bytes_read < 0)
 			return MHD_NO;
 		server->get_server_logger()->debug("read %d bytes", bytes_read);
 
 		/* Remove processed data from the buffer */
-		buffer.rresize(buffer.size() - bytes_read);
+		buffer.consume(bytes_read);
 		server->get_server_logger()->debug("%u bytes left unread", (unsigned int)buffer.size());
 	}
 
@@ -151,7 +182,14 @@ static int REST_AccessHandlerCallback(void* cls, struct MHD_Connection* connecti
 		if (!state->get_response())
 		{
 			server->get_server_logger()->debug("request finished; performing callback");
-			state->get_finish_callback()(server->get_server_obj(), state, state->get_callback_data());
+			try
+			{
+				state->get_finish_callback()(server->get_server_obj(), state, state->get_callback_data());
+			}
+			catch (TryLockFailed& e)
+			{
+				REST_LockBusy(server, state);
+			}
 		}
 
 		/* If still no response generated, try again later */
@@ -186,6 +224,11 @@ static int REST_RequestCleanupCallback(void* cls, struct MHD_Connection* connect
 	if (!state)
 		return MHD_YES;
 
+	boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - state->get_start_time();
+	server->get_metrics().record_request(state->get_metrics_handler(),
+					     state->get_response() ? state->get_status() : 0,
+					     elapsed.total_microseconds());
+
 	if (state->get_free_callback() && state->get_callback_data())
 		state->get_free_callback()(state->get_callback_data());
 
@@ -196,13 +239,96 @@ static int REST_RequestCleanupCallback(void* cls, struct MHD_Connection* connect
 	return MHD_YES;
 }
 
+/* Daemon flags for a connection mode, or -1 if the linked libmicrohttpd
+ * does not support it */
+static int REST_ModeFlags(ProtocolServerRESTBase::ConnectionMode mode)
+{
+	switch (mode)
+	{
+	case ProtocolServerRESTBase::MODE_SELECT:
+		return MHD_USE_SELECT_INTERNALLY;
+	case ProtocolServerRESTBase::MODE_POLL:
+#if MHD_VERSION >= 0x00093000
+		return MHD_USE_SELECT_INTERNALLY | MHD_USE_POLL;
+#else
+		return -1;
+#endif
+	case ProtocolServerRESTBase::MODE_EPOLL:
+#if MHD_VERSION >= 0x00093200 && defined(__linux__)
+		return MHD_USE_SELECT_INTERNALLY | MHD_USE_EPOLL_LINUX_ONLY;
+#else
+		return -1;
+#endif
+	case ProtocolServerRESTBase::MODE_THREAD_PER_CONNECTION:
+		/* poll() is not limited to descriptors below FD_SETSIZE */
+#if MHD_VERSION >= 0x00093000
+		return MHD_USE_SELECT_INTERNALLY | MHD_USE_THREAD_PER_CONNECTION | MHD_USE_POLL;
+#else
+		return MHD_USE_SELECT_INTERNALLY | MHD_USE_THREAD_PER_CONNECTION;
+#endif
+	}
+	return -1;
+}
+
+/* Raise the soft descriptor limit so that the connection limit can
+ * actually be reached */
+static void REST_RaiseFileLimit(log4cpp::Category* logger, unsigned int connection_limit)
+{
+	/* Leave room for the listening socket, log files and other interfaces */
+	rlim_t wanted = (rlim_t)connection_limit + 64;
+
+	struct rlimit rl;
+	if (getrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur >= wanted)
+		return;
+
+	rlim_t old = rl.rlim_cur;
+	rl.rlim_cur = (rl.rlim_max == RLIM_INFINITY || rl.rlim_max >= wanted) ? wanted : rl.rlim_max;
+	if (setrlimit(RLIMIT_NOFILE, &rl) != 0)
+		rl.rlim_cur = old;
+
+	if (rl.rlim_cur < wanted)
+		logger->warn("descriptor limit %lu is too low for connection limit %u",
+			     (unsigned long)rl.rlim_cur, connection_limit);
+	else
+		logger->info("raised descriptor limit from %lu to %lu",
+			     (unsigned long)old, (unsigned long)rl.rlim_cur);
+}
+
+ProtocolServerRESTBase::ConnectionMode ProtocolServerRESTBase::parse_mode(const std::string& name)
+{
+	if (name == "select")
+		return MODE_SELECT;
+	if (name == "poll")
+		return MODE_POLL;
+	if (name == "epoll")
+		return MODE_EPOLL;
+	if (name == "thread-per-connection")
+		return MODE_THREAD_PER_CONNECTION;
+	throw std::invalid_argument("Invalid connection mode '" + name + "'");
+}
+
+const char* ProtocolServerRESTBase::get_mode_name(ConnectionMode mode)
+{
+	switch (mode)
+	{
+	case MODE_SELECT:			return "select";
+	case MODE_POLL:				return "poll";
+	case MODE_EPOLL:			return "epoll";
+	case MODE_THREAD_PER_CONNECTION:	return "thread-per-connection";
+	}
+	return "unknown";
+}
+
 ProtocolServerRESTBase::ProtocolServerRESTBase(
 		const std::string& addr, unsigned short port,
 		unsigned int num_threads,
 		const std::string& ssl_cert, const std::string& ssl_key,
 		unsigned int connection_timeout,
 		unsigned int connection_limit,
-		unsigned int ip_connection_limit)
+		unsigned int ip_connection_limit,
+		ConnectionMode mode,
+		unsigned int listen_backlog,
+		unsigned int connection_memory_limit)
 	: addr_(addr),
 	  port_(port),
 	  num_threads_(num_threads),
@@ -211,7 +337,12 @@ ProtocolServerRESTBase::ProtocolServerRESTBase(
 	  connection_timeout_(connection_timeout),
 	  connection_limit_(connection_limit),
 	  ip_connection_limit_(ip_connection_limit),
+	  mode_(mode),
+	  listen_backlog_(listen_backlog),
+	  connection_memory_limit_(connection_memory_limit),
+	  suspend_resume_(false),
 	  daemon_(NULL),
+	  requests_(&metrics_),
 	  server_logger_(NULL),
 	  server_obj_(NULL)
 {
@@ -219,31 +350,26 @@ ProtocolServerRESTBase::ProtocolServerRESTBase(
 
 ProtocolServerRESTBase::~ProtocolServerRESTBase()
 {
+	/* Stopping the daemon joins its threads, which must happen before
+	 * the request pool goes away */
 	base_stop();
-
-	while (!requests_.empty())
-	{
-		RESTRequestState* s = requests_.front();
-		requests_.pop();
-		delete s;
-	}
 }
 
 RESTRequestState* ProtocolServerRESTBase::get_request_state()
 {
-	boost::mutex::scoped_lock l(requests_mutex_);
-	if (requests_.empty())
-		return new RESTRequestState();
-
-	RESTRequestState* s = requests_.front();
-	requests_.pop();
-	return s;
+	return requests_.get();
 }
 
 void ProtocolServerRESTBase::put_request_state(RESTRequestState* state)
 {
-	boost::mutex::scoped_lock l(requests_mutex_);
-	requests_.push(state);
+	requests_.put(state);
+}
+
+void ProtocolServerRESTBase::write_metrics(std::ostream& os)
+{
+	std::string labels = "port=\"" + boost::lexical_cast<std::string>(port_) + "\"";
+	metrics_.write_prometheus(os, labels);
+	requests_.write_prometheus(os, labels);
 }
 
 void ProtocolServerRESTBase::base_start(log4cpp::Category* server_logger, void* server_obj)
@@ -251,27 +377,72 @@ void ProtocolServerRESTBase::base_start(log4cpp::Category* server_logger, void*
 	server_logger_ = server_logger;
 	server_obj_ = server_obj;
 
-	int flags = (!ssl_cert_.empty() && !ssl_key_.empty() ? MHD_USE_SSL : 0) | MHD_USE_SELECT_INTERNALLY;
+	int mode_flags = REST_ModeFlags(mode_);
+	if (mode_flags < 0)
+	{
+		server_logger_->warn("connection mode '%s' is not supported by this version of libmicrohttpd; using 'select'",
+				     get_mode_name(mode_));
+		mode_ = MODE_SELECT;
+		mode_flags = REST_ModeFlags(mode_);
+	}
+
+	if (mode_ == MODE_SELECT && connection_limit_ >= FD_SETSIZE)
+		server_logger_->warn("connection mode 'select' cannot watch descriptors above %d; use 'epoll' for %u connections",
+				     FD_SETSIZE, connection_limit_);
+
+	REST_RaiseFileLimit(server_logger_, connection_limit_);
+
+	int flags = (!ssl_cert_.empty() && !ssl_key_.empty() ? MHD_USE_SSL : 0) | mode_flags;
+
+	/* Lets event streams set their connections aside while idle; not
+	 * needed (nor allowed) with a thread per connection */
+#if MHD_VERSION >= 0x00093800
+	if (mode_ != MODE_THREAD_PER_CONNECTION)
+	{
+		flags |= MHD_USE_SUSPEND_RESUME;
+		suspend_resume_ = true;
+	}
+#endif
 #ifdef DEBUG
 	flags |= MHD_USE_DEBUG;
 #endif
 
+	/* Each connection is served by its own thread, so there is no pool */
+	unsigned int pool_size = mode_ == MODE_THREAD_PER_CONNECTION ? 1 : num_threads_;
+
+	/* Zero selects the library defaults */
+#if MHD_VERSION >= 0x00093500
+	unsigned int listen_backlog = listen_backlog_ ? listen_backlog_ : SOMAXCONN;
+#endif
+	size_t connection_memory_limit = connection_memory_limit_ ? connection_memory_limit_ : 32 * 1024;
+
+	server_logger_->info("starting HTTP daemon in '%s' mode (%u threads, %u connections)",
+			     get_mode_name(mode_), pool_size, connection_limit_);
+
 	daemon_ = MHD_start_daemon(flags,
 				   port_,
 				   NULL, NULL,
 				   &REST_AccessHandlerCallback, this,
 #if MHD_VERSION >= 0x00040100
-				   MHD_OPTION_THREAD_POOL_SIZE, num_threads_,
+				   MHD_OPTION_THREAD_POOL_SIZE, pool_size,
+#endif
+#if MHD_VERSION >= 0x00093500
+				   MHD_OPTION_LISTEN_BACKLOG_SIZE, listen_backlog,
 #endif
 				   MHD_OPTION_NOTIFY_COMPLETED, &REST_RequestCleanupCallback, this,
 				   MHD_OPTION_CONNECTION_TIMEOUT, connection_timeout_,
 				   MHD_OPTION_CONNECTION_LIMIT, connection_limit_,
 				   MHD_OPTION_PER_IP_CONNECTION_LIMIT, ip_connection_limit_,
+				   MHD_OPTION_CONNECTION_MEMORY_LIMIT, connection_memory_limit,
 				   MHD_OPTION_END);
 
 #if MHD_VERSION < 0x00040100
 	server_logger_->warn("The version of libmicrohttpd does not include thread pooling support; using default behavior");
 #endif
+#if MHD_VERSION < 0x00093500
+	if (listen_backlog_)
+		server_logger_->warn("The version of libmicrohttpd does not support setting the listen backlog; ignoring");
+#endif
 
 	if (!daemon_)
 		throw std::runtime_error("Failed to create HTTP daemon");
@@ -29,3 +29,261 @@
 
 #include "p4pserver/protocol_server_udp.h"
 
+#include <errno.h>
+#include <netdb.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <vector>
+
+/* Largest request accepted and response produced. Clients size their
+ * requests to avoid fragmentation, so this is generous. */
+static const unsigned int DATAGRAM_BUFFER = 8192;
+
+/* Interval at which blocked receivers check whether the server is stopping */
+static const unsigned int RECV_TIMEOUT_MS = 100;
+
+/* Requested socket receive buffer, to absorb bursts between batches */
+static const int SOCKET_RECV_BUFFER = 4 * 1024 * 1024;
+
+ProtocolServerUDPBase::ProtocolServerUDPBase(const std::string& addr, unsigned short port,
+					     unsigned int num_threads,
+					     unsigned int batch_size)
+	: addr_(addr),
+	  port_(port),
+	  num_threads_(std::max(num_threads, 1U)),
+	  batch_size_(std::max(batch_size, 1U)),
+	  sock_(-1),
+	  stopping_(false),
+	  received_(0),
+	  sent_(0),
+	  send_errors_(0),
+	  server_logger_(NULL)
+{
+}
+
+ProtocolServerUDPBase::~ProtocolServerUDPBase()
+{
+	base_stop();
+}
+
+void ProtocolServerUDPBase::base_start(log4cpp::Category* server_logger)
+{
+	server_logger_ = server_logger;
+
+	if (addr_.empty())
+	{
+		/* Prefer a dual-stack socket; fall back to IPv4 only */
+		sock_ = socket(AF_INET6, SOCK_DGRAM, 0);
+		if (sock_ >= 0)
+		{
+			int off = 0;
+			setsockopt(sock_, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+
+			struct sockaddr_in6 sa;
+			memset(&sa, 0, sizeof(sa));
+			sa.sin6_family = AF_INET6;
+			sa.sin6_addr = in6addr_any;
+			sa.sin6_port = htons(port_);
+			if (bind(sock_, (struct sockaddr*)&sa, sizeof(sa)) != 0)
+			{
+				close(sock_);
+				sock_ = -1;
+			}
+		}
+		if (sock_ < 0)
+		{
+			sock_ = socket(AF_INET, SOCK_DGRAM, 0);
+			if (sock_ < 0)
+				throw std::runtime_error("Failed to create UDP socket: " + std::string(strerror(errno)));
+
+			struct sockaddr_in sa;
+			memset(&sa, 0, sizeof(sa));
+			sa.sin_family = AF_INET;
+			sa.sin_addr.s_addr = INADDR_ANY;
+			sa.sin_port = htons(port_);
+			if (bind(sock_, (struct sockaddr*)&sa, sizeof(sa)) != 0)
+			{
+				std::string err = strerror(errno);
+				close(sock_);
+				sock_ = -1;
+				throw std::runtime_error("Failed to bind UDP port " + boost::lexical_cast<std::string>(port_) + ": " + err);
+			}
+		}
+	}
+	else
+	{
+		struct addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_DGRAM;
+		hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+
+		struct addrinfo* res = NULL;
+		int rc = getaddrinfo(addr_.c_str(), boost::lexical_cast<std::string>(port_).c_str(), &hints, &res);
+		if (rc != 0)
+			throw std::runtime_error("Invalid UDP binding address " + addr_ + ": " + gai_strerror(rc));
+
+		sock_ = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+		if (sock_ < 0 || bind(sock_, res->ai_addr, res->ai_addrlen) != 0)
+		{
+			std::string err = strerror(errno);
+			if (sock_ >= 0)
+				close(sock_);
+			sock_ = -1;
+			freeaddrinfo(res);
+			throw std::runtime_error("Failed to bind UDP address " + addr_ + ": " + err);
+		}
+		freeaddrinfo(res);
+	}
+
+	struct timeval tv;
+	tv.tv_sec = 0;
+	tv.tv_usec = RECV_TIMEOUT_MS * 1000;
+	setsockopt(sock_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(sock_, SOL_SOCKET, SO_RCVBUF, &SOCKET_RECV_BUFFER, sizeof(SOCKET_RECV_BUFFER));
+
+	stopping_ = false;
+	for (unsigned int i = 0; i < num_threads_; ++i)
+		threads_.create_thread(boost::bind(&ProtocolServerUDPBase::worker, this));
+}
+
+void ProtocolServerUDPBase::base_stop()
+{
+	stopping_ = true;
+	threads_.join_all();
+
+	if (sock_ >= 0)
+		close(sock_);
+	sock_ = -1;
+}
+
+#ifdef __linux__
+
+void ProtocolServerUDPBase::worker()
+{
+	const unsigned int n = batch_size_;
+
+	std::vector<char> in(n * DATAGRAM_BUFFER);
+	std::vector<char> out(n * DATAGRAM_BUFFER);
+	std::vector<struct sockaddr_storage> addrs(n);
+	std::vector<struct iovec> in_iov(n);
+	std::vector<struct iovec> out_iov(n);
+	std::vector<struct mmsghdr> in_msgs(n);
+	std::vector<struct mmsghdr> out_msgs(n);
+
+	while (!stopping_)
+	{
+		for (unsigned int i = 0; i < n; ++i)
+		{
+			in_iov[i].iov_base = &in[i * DATAGRAM_BUFFER];
+			in_iov[i].iov_len = DATAGRAM_BUFFER;
+			memset(&in_msgs[i].msg_hdr, 0, sizeof(in_msgs[i].msg_hdr));
+			in_msgs[i].msg_hdr.msg_name = &addrs[i];
+			in_msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+			in_msgs[i].msg_hdr.msg_iov = &in_iov[i];
+			in_msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		/* Wait for at least one datagram, then take whatever else is queued */
+		int received = recvmmsg(sock_, &in_msgs[0], n, MSG_WAITFORONE, NULL);
+		if (received < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				server_logger_->error("recvmmsg failed: %s", strerror(errno));
+			continue;
+		}
+		__sync_fetch_and_add(&received_, (unsigned long long)received);
+
+		unsigned int responses = 0;
+		for (int i = 0; i < received; ++i)
+		{
+			if (in_msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+				continue;
+
+			unsigned int len = 0;
+			try
+			{
+				len = handle_datagram(&in[i * DATAGRAM_BUFFER], in_msgs[i].msg_len,
+						      &out[responses * DATAGRAM_BUFFER], DATAGRAM_BUFFER,
+						      addrs[i]);
+			}
+			catch (std::exception& e)
+			{
+				server_logger_->warn("failed to handle datagram: %s", e.what());
+				continue;
+			}
+			if (len == 0)
+				continue;
+
+			out_iov[responses].iov_base = &out[responses * DATAGRAM_BUFFER];
+			out_iov[responses].iov_len = len;
+			memset(&out_msgs[responses].msg_hdr, 0, sizeof(out_msgs[responses].msg_hdr));
+			out_msgs[responses].msg_hdr.msg_name = &addrs[i];
+			out_msgs[responses].msg_hdr.msg_namelen = in_msgs[i].msg_hdr.msg_namelen;
+			out_msgs[responses].msg_hdr.msg_iov = &out_iov[responses];
+			out_msgs[responses].msg_hdr.msg_iovlen = 1;
+			++responses;
+		}
+
+		/* Send all responses; skip over any datagram that fails */
+		unsigned int done = 0;
+		while (done < responses)
+		{
+			int sent = sendmmsg(sock_, &out_msgs[done], responses - done, 0);
+			if (sent < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				__sync_fetch_and_add(&send_errors_, 1ULL);
+				++done;
+				continue;
+			}
+			__sync_fetch_and_add(&sent_, (unsigned long long)sent);
+			done += sent;
+		}
+	}
+}
+
+#else
+
+void ProtocolServerUDPBase::worker()
+{
+	std::vector<char> in(DATAGRAM_BUFFER);
+	std::vector<char> out(DATAGRAM_BUFFER);
+
+	while (!stopping_)
+	{
+		struct sockaddr_storage addr;
+		socklen_t addr_len = sizeof(addr);
+		ssize_t received = recvfrom(sock_, &in[0], in.size(), 0, (struct sockaddr*)&addr, &addr_len);
+		if (received < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				server_logger_->error("recvfrom failed: %s", strerror(errno));
+			continue;
+		}
+		__sync_fetch_and_add(&received_, 1ULL);
+
+		unsigned int len = 0;
+		try
+		{
+			len = handle_datagram(&in[0], received, &out[0], out.size(), addr);
+		}
+		catch (std::exception& e)
+		{
+			server_logger_->warn("failed to handle datagram: %s", e.what());
+			continue;
+		}
+		if (len == 0)
+			continue;
+
+		if (sendto(sock_, &out[0], len, 0, (struct sockaddr*)&addr, addr_len) < 0)
+			__sync_fetch_and_add(&send_errors_, 1ULL);
+		else
+			__sync_fetch_and_add(&sent_, 1ULL);
+	}
+}
+
+#endif
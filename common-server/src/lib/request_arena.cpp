@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "p4pserver/request_arena.h"
+
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+
+/* Alignment of arena allocations */
+static const std::size_t ARENA_ALIGN = sizeof(void*) > sizeof(long long) ? sizeof(void*) : sizeof(long long);
+
+static std::size_t align_up(std::size_t n)
+{
+	return (n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+RequestArena::RequestArena()
+	: block_(NULL),
+	  block_size_(BLOCK_SIZE),
+	  used_(0),
+	  overflow_size_(0),
+	  heap_allocations_(0)
+{
+	block_ = new_block(block_size_);
+}
+
+RequestArena::~RequestArena()
+{
+	delete[] block_;
+	for (std::vector<char*>::iterator itr = overflow_.begin(); itr != overflow_.end(); ++itr)
+		delete[] *itr;
+}
+
+char* RequestArena::new_block(std::size_t size)
+{
+	++heap_allocations_;
+	return new char[size];
+}
+
+void* RequestArena::allocate(std::size_t size)
+{
+	size = align_up(std::max(size, (std::size_t)1));
+	if (used_ + size > block_size_)
+	{
+		/* Keep the full block until reset(); allocations from it are still live */
+		overflow_.push_back(block_);
+		overflow_size_ += block_size_;
+
+		block_size_ = std::max(block_size_ * 2, align_up(size));
+		block_ = new_block(block_size_);
+		used_ = 0;
+	}
+
+	void* result = block_ + used_;
+	used_ += size;
+	return result;
+}
+
+char* RequestArena::copy(const char* s, std::size_t len)
+{
+	char* result = (char*)allocate(len + 1);
+	memcpy(result, s, len);
+	result[len] = '\0';
+	return result;
+}
+
+void RequestArena::reset()
+{
+	used_ = 0;
+	if (overflow_.empty() && block_size_ <= MAX_RETAINED)
+		return;
+
+	/* Replace the chain with one block big enough for the whole request */
+	std::size_t size = block_size_ + overflow_size_;
+	for (std::vector<char*>::iterator itr = overflow_.begin(); itr != overflow_.end(); ++itr)
+		delete[] *itr;
+	overflow_.clear();
+	overflow_size_ = 0;
+
+	delete[] block_;
+	block_size_ = size <= MAX_RETAINED ? size : BLOCK_SIZE;
+	block_ = new_block(block_size_);
+}
+
+RequestBuffer::RequestBuffer()
+	: buf_(new char[INITIAL_CAPACITY]),
+	  capacity_(INITIAL_CAPACITY),
+	  begin_(0),
+	  end_(0)
+{
+}
+
+RequestBuffer::~RequestBuffer()
+{
+	delete[] buf_;
+}
+
+void RequestBuffer::append(const char* data, std::size_t len)
+{
+	if (end_ + len > capacity_)
+	{
+		/* Reclaim the consumed space at the front first */
+		std::size_t n = size();
+		if (begin_ > 0)
+		{
+			memmove(buf_, buf_ + begin_, n);
+			begin_ = 0;
+			end_ = n;
+		}
+
+		if (n + len > capacity_)
+		{
+			std::size_t new_capacity = std::max(capacity_ * 2, n + len);
+			char* new_buf = new char[new_capacity];
+			memcpy(new_buf, buf_, n);
+			delete[] buf_;
+			buf_ = new_buf;
+			capacity_ = new_capacity;
+		}
+	}
+
+	memcpy(buf_ + end_, data, len);
+	end_ += len;
+}
+
+void RequestBuffer::consume(std::size_t len)
+{
+	if (len > size())
+		throw std::runtime_error("Illegal state: tried to remove too many bytes from buffer");
+
+	begin_ += len;
+	if (begin_ == end_)
+		begin_ = end_ = 0;
+}
+
+void RequestBuffer::clear()
+{
+	begin_ = end_ = 0;
+	if (capacity_ <= MAX_RETAINED)
+		return;
+
+	delete[] buf_;
+	buf_ = new char[INITIAL_CAPACITY];
+	capacity_ = INITIAL_CAPACITY;
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "p4pserver/rest_metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <boost/foreach.hpp>
+
+static const unsigned int STATUS_CODES[RESTMetrics::NUM_STATUS - 1] = { 200, 307, 400, 404, 406, 500, 503 };
+
+/* Upper bounds of the latency histogram buckets, in microseconds */
+static const unsigned long long BUCKET_USEC[RESTMetrics::NUM_BUCKETS] = {
+	100, 250, 500,
+	1000, 2500, 5000,
+	10000, 25000, 50000,
+	100000, 250000, 500000,
+	1000000, 2500000
+};
+
+static const char* BUCKET_LABELS[RESTMetrics::NUM_BUCKETS] = {
+	"0.0001", "0.00025", "0.0005",
+	"0.001", "0.0025", "0.005",
+	"0.01", "0.025", "0.05",
+	"0.1", "0.25", "0.5",
+	"1", "2.5"
+};
+
+static boost::mutex& handler_names_mutex()
+{
+	static boost::mutex mutex;
+	return mutex;
+}
+
+static std::vector<std::string>& handler_names()
+{
+	static std::vector<std::string> names(1, "other");
+	return names;
+}
+
+static unsigned int status_index(unsigned int status)
+{
+	for (unsigned int i = 0; i < RESTMetrics::NUM_STATUS - 1; ++i)
+	{
+		if (STATUS_CODES[i] == status)
+			return i;
+	}
+	return RESTMetrics::NUM_STATUS - 1;
+}
+
+unsigned int RESTMetrics::register_handler(const std::string& name)
+{
+	boost::mutex::scoped_lock lock(handler_names_mutex());
+	std::vector<std::string>& names = handler_names();
+	for (unsigned int i = 0; i < names.size(); ++i)
+	{
+		if (names[i] == name)
+			return i;
+	}
+
+	if (names.size() >= MAX_HANDLERS)
+		return HANDLER_OTHER;
+
+	names.push_back(name);
+	return names.size() - 1;
+}
+
+RESTMetrics::RESTMetrics()
+	: shard_(&RESTMetrics::release_shard)
+{
+	memset(&retired_, 0, sizeof(Shard));
+}
+
+RESTMetrics::~RESTMetrics()
+{
+	/* Retire this thread's shard, if it served any requests */
+	shard_.reset();
+
+	BOOST_FOREACH(Shard* shard, shards_)
+		delete shard;
+}
+
+RESTMetrics::Shard& RESTMetrics::get_shard()
+{
+	Shard* shard = shard_.get();
+	if (shard)
+		return *shard;
+
+	/* First request on this thread */
+	shard = new Shard();
+	memset(shard, 0, sizeof(Shard));
+	shard->metrics = this;
+	{
+		boost::mutex::scoped_lock lock(shards_mutex_);
+		shards_.push_back(shard);
+	}
+	shard_.reset(shard);
+	return *shard;
+}
+
+void RESTMetrics::release_shard(Shard* shard)
+{
+	RESTMetrics* metrics = shard->metrics;
+	{
+		boost::mutex::scoped_lock lock(metrics->shards_mutex_);
+		add_counters(metrics->retired_, *shard);
+		metrics->shards_.erase(std::find(metrics->shards_.begin(), metrics->shards_.end(), shard));
+	}
+	delete shard;
+}
+
+void RESTMetrics::add_counters(Shard& dst, const Shard& src)
+{
+	for (unsigned int h = 0; h < MAX_HANDLERS; ++h)
+	{
+		const HandlerCounters& s = src.handlers[h];
+		HandlerCounters& d = dst.handlers[h];
+		d.requests += s.requests;
+		for (unsigned int i = 0; i < NUM_STATUS; ++i)
+			d.status[i] += s.status[i];
+		d.lock_busy += s.lock_busy;
+		d.bytes_out += s.bytes_out;
+		for (unsigned int i = 0; i <= NUM_BUCKETS; ++i)
+			d.latency[i] += s.latency[i];
+		d.latency_usec += s.latency_usec;
+	}
+}
+
+void RESTMetrics::record_request(unsigned int handler, unsigned int status, unsigned long long usec)
+{
+	HandlerCounters& c = get_shard().handlers[handler < MAX_HANDLERS ? handler : HANDLER_OTHER];
+	++c.requests;
+	++c.status[status_index(status)];
+
+	unsigned int bucket = 0;
+	while (bucket < NUM_BUCKETS && usec > BUCKET_USEC[bucket])
+		++bucket;
+	++c.latency[bucket];
+	c.latency_usec += usec;
+}
+
+void RESTMetrics::record_lock_busy(unsigned int handler)
+{
+	++get_shard().handlers[handler < MAX_HANDLERS ? handler : HANDLER_OTHER].lock_busy;
+}
+
+void RESTMetrics::record_bytes_out(unsigned int handler, unsigned long long bytes)
+{
+	get_shard().handlers[handler < MAX_HANDLERS ? handler : HANDLER_OTHER].bytes_out += bytes;
+}
+
+void RESTMetrics::write_prometheus(std::ostream& os, const std::string& labels) const
+{
+	std::vector<std::string> names;
+	{
+		boost::mutex::scoped_lock lock(handler_names_mutex());
+		names = handler_names();
+	}
+
+	/* Sum the per-thread counters */
+	Shard total;
+	{
+		boost::mutex::scoped_lock lock(shards_mutex_);
+		total = retired_;
+		BOOST_FOREACH(const Shard* shard, shards_)
+			add_counters(total, *shard);
+	}
+
+	std::string prefix = labels.empty() ? "" : labels + ",";
+
+	os << "# HELP p4p_rest_requests_total Requests completed, by handler and HTTP status code.\n"
+	   << "# TYPE p4p_rest_requests_total counter\n";
+	for (unsigned int h = 0; h < names.size(); ++h)
+	{
+		for (unsigned int i = 0; i < NUM_STATUS; ++i)
+		{
+			if (total.handlers[h].status[i] == 0)
+				continue;
+			os << "p4p_rest_requests_total{" << prefix << "handler=\"" << names[h] << "\",code=\"";
+			if (i < NUM_STATUS - 1)
+				os << STATUS_CODES[i];
+			else
+				os << "other";
+			os << "\"} " << total.handlers[h].status[i] << "\n";
+		}
+	}
+
+	os << "# HELP p4p_rest_lock_busy_total Requests which found a view locked by an update.\n"
+	   << "# TYPE p4p_rest_lock_busy_total counter\n";
+	for (unsigned int h = 0; h < names.size(); ++h)
+	{
+		if (total.handlers[h].lock_busy == 0)
+			continue;
+		os << "p4p_rest_lock_busy_total{" << prefix << "handler=\"" << names[h] << "\"} " << total.handlers[h].lock_busy << "\n";
+	}
+
+	os << "# HELP p4p_rest_response_bytes_total Response body bytes sent.\n"
+	   << "# TYPE p4p_rest_response_bytes_total counter\n";
+	for (unsigned int h = 0; h < names.size(); ++h)
+	{
+		if (total.handlers[h].bytes_out == 0)
+			continue;
+		os << "p4p_rest_response_bytes_total{" << prefix << "handler=\"" << names[h] << "\"} " << total.handlers[h].bytes_out << "\n";
+	}
+
+	os << "# HELP p4p_rest_request_duration_seconds Time from receiving a request until it completed.\n"
+	   << "# TYPE p4p_rest_request_duration_seconds histogram\n";
+	for (unsigned int h = 0; h < names.size(); ++h)
+	{
+		const HandlerCounters& c = total.handlers[h];
+		if (c.requests == 0)
+			continue;
+
+		unsigned long cumulative = 0;
+		for (unsigned int i = 0; i < NUM_BUCKETS; ++i)
+		{
+			cumulative += c.latency[i];
+			os << "p4p_rest_request_duration_seconds_bucket{" << prefix << "handler=\"" << names[h] << "\",le=\"" << BUCKET_LABELS[i] << "\"} " << cumulative << "\n";
+		}
+		cumulative += c.latency[NUM_BUCKETS];
+		os << "p4p_rest_request_duration_seconds_bucket{" << prefix << "handler=\"" << names[h] << "\",le=\"+Inf\"} " << cumulative << "\n";
+		char sum[32];
+		snprintf(sum, sizeof(sum), "%llu.%06llu", c.latency_usec / 1000000, c.latency_usec % 1000000);
+		os << "p4p_rest_request_duration_seconds_sum{" << prefix << "handler=\"" << names[h] << "\"} " << sum << "\n";
+		os << "p4p_rest_request_duration_seconds_count{" << prefix << "handler=\"" << names[h] << "\"} " << cumulative << "\n";
+	}
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "p4pserver/rest_request_pool.h"
+
+#include <string.h>
+#include <boost/foreach.hpp>
+#include <p4pserver/rest_request_state.h>
+
+RESTRequestPool::RESTRequestPool(RESTMetrics* metrics)
+	: metrics_(metrics),
+	  cache_(&RESTRequestPool::release_cache)
+{
+}
+
+RESTRequestPool::~RESTRequestPool()
+{
+	/* Return this thread's states, if it served any */
+	cache_.reset();
+
+	BOOST_FOREACH(RESTRequestState* state, shared_)
+		delete state;
+	BOOST_FOREACH(Cache* cache, caches_)
+	{
+		for (unsigned int i = 0; i < cache->size; ++i)
+			delete cache->states[i];
+		delete cache;
+	}
+}
+
+RESTRequestPool::Cache& RESTRequestPool::get_cache()
+{
+	Cache* cache = cache_.get();
+	if (cache)
+		return *cache;
+
+	/* First request on this thread; reuse the cache of an exited thread if possible */
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (!free_caches_.empty())
+		{
+			cache = free_caches_.back();
+			free_caches_.pop_back();
+		}
+		else
+		{
+			cache = new Cache();
+			memset(cache, 0, sizeof(Cache));
+			cache->pool = this;
+			caches_.push_back(cache);
+		}
+	}
+	cache_.reset(cache);
+	return *cache;
+}
+
+void RESTRequestPool::release_cache(Cache* cache)
+{
+	RESTRequestPool* pool = cache->pool;
+	boost::mutex::scoped_lock lock(pool->mutex_);
+	for (unsigned int i = 0; i < cache->size; ++i)
+		pool->shared_.push_back(cache->states[i]);
+	cache->size = 0;
+	pool->free_caches_.push_back(cache);
+}
+
+RESTRequestState* RESTRequestPool::get()
+{
+	Cache& cache = get_cache();
+	if (cache.size > 0)
+	{
+		++cache.thread_hits;
+		return cache.states[--cache.size];
+	}
+
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (!shared_.empty())
+		{
+			++cache.shared_hits;
+			RESTRequestState* state = shared_.back();
+			shared_.pop_back();
+			return state;
+		}
+	}
+
+	++cache.misses;
+	RESTRequestState* state = new RESTRequestState();
+	state->set_metrics(metrics_);
+	return state;
+}
+
+void RESTRequestPool::put(RESTRequestState* state)
+{
+	Cache& cache = get_cache();
+	if (cache.size < THREAD_CACHE_SIZE)
+	{
+		cache.states[cache.size++] = state;
+		return;
+	}
+
+	boost::mutex::scoped_lock lock(mutex_);
+	shared_.push_back(state);
+}
+
+RESTRequestPool::Stats RESTRequestPool::get_stats() const
+{
+	Stats stats;
+	memset(&stats, 0, sizeof(stats));
+
+	boost::mutex::scoped_lock lock(mutex_);
+	stats.idle = shared_.size();
+	BOOST_FOREACH(const Cache* cache, caches_)
+	{
+		stats.idle += cache->size;
+		stats.thread_hits += cache->thread_hits;
+		stats.shared_hits += cache->shared_hits;
+		stats.misses += cache->misses;
+	}
+	stats.allocated = stats.misses;
+	return stats;
+}
+
+void RESTRequestPool::write_prometheus(std::ostream& os, const std::string& labels) const
+{
+	Stats stats = get_stats();
+
+	/* Counters are read without the owning threads' cooperation, so
+	 * in_use may briefly be off by the requests in flight */
+	unsigned long in_use = stats.allocated > stats.idle ? stats.allocated - stats.idle : 0;
+
+	os << "# HELP p4p_rest_request_states Request state objects, by whether they are serving a request.\n"
+	   << "# TYPE p4p_rest_request_states gauge\n"
+	   << "p4p_rest_request_states{" << labels << ",state=\"in_use\"} " << in_use << "\n"
+	   << "p4p_rest_request_states{" << labels << ",state=\"idle\"} " << stats.idle << "\n"
+	   << "# HELP p4p_rest_request_state_acquires_total Request state objects acquired, by where they came from.\n"
+	   << "# TYPE p4p_rest_request_state_acquires_total counter\n"
+	   << "p4p_rest_request_state_acquires_total{" << labels << ",source=\"thread\"} " << stats.thread_hits << "\n"
+	   << "p4p_rest_request_state_acquires_total{" << labels << ",source=\"shared\"} " << stats.shared_hits << "\n"
+	   << "p4p_rest_request_state_acquires_total{" << labels << ",source=\"new\"} " << stats.misses << "\n";
+}
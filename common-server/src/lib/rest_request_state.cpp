@@ -29,6 +29,8 @@
 
 #include "p4pserver/rest_request_state.h"
 
+#include <string.h>
+#include <strings.h>
 #include <zlib.h>
 extern "C" {
 #include <microhttpd.h>
@@ -40,11 +42,16 @@ public:
 	ContentReaderState(RESTContentReaderCallback callback_write,
 			   RESTRequestFree callback_free,
 			   void* callback_data,
-			   bool gzip = false)
+			   bool gzip = false,
+			   RESTMetrics* metrics = NULL,
+			   unsigned int metrics_handler = RESTMetrics::HANDLER_OTHER)
 		: callback_write_(callback_write),
 		  callback_free_(callback_free),
 		  callback_data_(callback_data),
 		  gzip_(gzip),
+		  metrics_(metrics),
+		  metrics_handler_(metrics_handler),
+		  bytes_out_(0),
 		  callback_finished_(false),
 		  z_finished_(false)
 	{
@@ -68,6 +75,9 @@ public:
 
 		if (callback_free_)
 			callback_free_(callback_data_);
+
+		if (metrics_)
+			metrics_->record_bytes_out(metrics_handler_, bytes_out_);
 	}
 
 	void buffer_read(std::string::size_type bytes)
@@ -151,10 +161,10 @@ public:
 
 		/* Produce output data. These functions internally remove
 		 * written data from the buffer. */
-		if (gzip_)
-			return process_gzip(pos, buf, max);
-		else
-			return process_normal(pos, buf, max);
+		int rc = gzip_ ? process_gzip(pos, buf, max) : process_normal(pos, buf, max);
+		if (rc > 0)
+			bytes_out_ += rc;
+		return rc;
 	}
 
 private:
@@ -163,6 +173,9 @@ private:
 	void* callback_data_;
 	bool gzip_;
 
+	RESTMetrics* metrics_;
+	unsigned int metrics_handler_;
+	unsigned long long bytes_out_;	/* Bytes handed to libmicrohttpd so far */
 
 	std::string buffer_;		/* Buffer of unwritten data */
 	bool callback_finished_;	/* Set to true when callback is finished producing data */
@@ -187,23 +200,146 @@ static void callback_free(void *cls)
 	delete state;
 }
 
+struct EncodedBodyReaderState
+{
+	EncodedBodyReaderState(EncodedBodyConstPtr _body, const std::string& _data)
+		: body(_body), data(_data)
+	{}
+
+	EncodedBodyConstPtr body;	/* Keeps 'data' alive */
+	const std::string& data;
+};
+
+#if MHD_VERSION >= 0x00040001
+static int64_t encoded_body_write(void *cls, uint64_t pos, char *buf, uint64_t max)
+#else
+static int encoded_body_write(void *cls, size_t pos, char *buf, int max)
+#endif
+{
+	EncodedBodyReaderState* state = (EncodedBodyReaderState*)cls;
+	if (pos >= state->data.size())
+		return -1;
+
+	size_t n = std::min((size_t)max, (size_t)(state->data.size() - pos));
+	memcpy(buf, state->data.data() + pos, n);
+	return n;
+}
+
+static void encoded_body_free(void *cls)
+{
+	EncodedBodyReaderState* state = (EncodedBodyReaderState*)cls;
+	delete state;
+}
+
+/* Interval at which a waiting event stream reader checks in */
+static const boost::posix_time::time_duration EVENT_STREAM_WAIT = boost::posix_time::seconds(1);
+
+class EventStreamReaderState : public EventStreamWaiter
+{
+public:
+	EventStreamReaderState(EventStreamHubPtr hub,
+			       EventStreamPtr stream,
+			       MHD_Connection* conn,
+			       bool suspend,
+			       RESTRequestFree callback_free,
+			       void* callback_data,
+			       RESTMetrics* metrics,
+			       unsigned int metrics_handler)
+		: hub_(hub),
+		  stream_(stream),
+		  conn_(conn),
+		  suspend_(suspend),
+		  callback_free_(callback_free),
+		  callback_data_(callback_data),
+		  metrics_(metrics),
+		  metrics_handler_(metrics_handler),
+		  bytes_out_(0)
+	{
+	}
+
+	~EventStreamReaderState()
+	{
+		/* Once closed, the stream no longer resumes the connection */
+		stream_->close();
+		hub_->unsubscribe(stream_);
+
+		if (callback_free_)
+			callback_free_(callback_data_);
+
+		if (metrics_)
+			metrics_->record_bytes_out(metrics_handler_, bytes_out_);
+	}
+
+	int process(char* buf, int max)
+	{
+		int rc = stream_->read(buf, max, suspend_ ? this : NULL, EVENT_STREAM_WAIT);
+		if (rc > 0)
+			bytes_out_ += rc;
+		return rc;
+	}
+
+	virtual void suspend()
+	{
+#if MHD_VERSION >= 0x00093800
+		MHD_suspend_connection(conn_);
+#endif
+	}
+
+	virtual void resume()
+	{
+#if MHD_VERSION >= 0x00093800
+		MHD_resume_connection(conn_);
+#endif
+	}
+
+private:
+	EventStreamHubPtr hub_;
+	EventStreamPtr stream_;
+	MHD_Connection* conn_;
+	bool suspend_;
+
+	RESTRequestFree callback_free_;
+	void* callback_data_;
+
+	RESTMetrics* metrics_;
+	unsigned int metrics_handler_;
+	unsigned long long bytes_out_;
+};
+
+#if MHD_VERSION >= 0x00040001
+static int64_t event_stream_write(void *cls, uint64_t pos, char *buf, uint64_t max)
+#else
+static int event_stream_write(void *cls, size_t pos, char *buf, int max)
+#endif
+{
+	EventStreamReaderState* state = (EventStreamReaderState*)cls;
+	return state->process(buf, max);
+}
+
+static void event_stream_free(void *cls)
+{
+	EventStreamReaderState* state = (EventStreamReaderState*)cls;
+	delete state;
+}
+
 
 RESTRequestState::RESTRequestState()
-	: buffer_(4096)
+	: metrics_(NULL)
 {
-	memset(rawpath_, 0, MAX_PATH_LENGTH + 1);
+	args_.reserve(RESERVED_ARGS);
+	headers_.reserve(RESERVED_HEADERS);
 	clear();
 }
 
 void RESTRequestState::clear()
 {
 	conn_ = NULL;
-	rawpath_[0] = '\0';
 	args_.clear();
+	headers_.clear();
+	arena_.reset();
 	version_ = 0;
 	method_ = 0;
 	buffer_.clear();
-	buffer_.set_capacity(4096);
 	request_finished_ = false;
 	process_callback_ = NULL;
 	finish_callback_ = NULL;
@@ -211,6 +347,7 @@ void RESTRequestState::clear()
 	callback_data_ = NULL;
 	status_ = MHD_HTTP_OK;
 	response_ = NULL;
+	metrics_handler_ = RESTMetrics::HANDLER_OTHER;
 }
 
 void RESTRequestState::set_empty_response(unsigned int status)
@@ -224,6 +361,9 @@ void RESTRequestState::set_text_response(unsigned int status, const std::string&
 	set_response(MHD_create_response_from_data(text.size(), (void*)text.c_str(), MHD_NO, MHD_YES));
 	MHD_add_response_header(get_response(), "Content-Type", content_type);
 	set_status(status);
+
+	if (metrics_)
+		metrics_->record_bytes_out(metrics_handler_, text.size());
 }
 
 void RESTRequestState::set_callback_response(RESTContentReaderCallback rsp_writer, const char* content_type)
@@ -234,7 +374,7 @@ void RESTRequestState::set_callback_response(RESTContentReaderCallback rsp_write
 	set_response(MHD_create_response_from_callback(
 			-1, RESPONSE_BLOCK_SIZE,
 			callback_write,
-			new ContentReaderState(rsp_writer, get_free_callback(), get_callback_data(), use_gzip),
+			new ContentReaderState(rsp_writer, get_free_callback(), get_callback_data(), use_gzip, metrics_, metrics_handler_),
 			callback_free));
 	MHD_add_response_header(get_response(), "Content-Type", content_type);
 	if (use_gzip)
@@ -244,19 +384,67 @@ void RESTRequestState::set_callback_response(RESTContentReaderCallback rsp_write
 	set_free_callback(NULL);
 }
 
+void RESTRequestState::set_encoded_response(unsigned int status, EncodedBodyConstPtr body, const char* content_type)
+{
+	EncodedBody::Encoding encoding = body->select(MHD_lookup_connection_value(get_conn(), MHD_HEADER_KIND, "Accept-Encoding"));
+	const std::string& data = body->get(encoding);
+
+	/* The body is only read, so it is shared with the requests sending it */
+	set_response(MHD_create_response_from_callback(
+			data.size(), RESPONSE_BLOCK_SIZE,
+			encoded_body_write,
+			new EncodedBodyReaderState(body, data),
+			encoded_body_free));
+	MHD_add_response_header(get_response(), "Content-Type", content_type);
+	MHD_add_response_header(get_response(), "Vary", "Accept-Encoding");
+	if (EncodedBody::get_name(encoding))
+		MHD_add_response_header(get_response(), "Content-Encoding", EncodedBody::get_name(encoding));
+	set_status(status);
+
+	if (metrics_)
+		metrics_->record_bytes_out(metrics_handler_, data.size());
+}
+
+void RESTRequestState::set_event_stream_response(EventStreamHubPtr hub, EventStreamPtr stream, bool suspend)
+{
+	/* Events are sent as they are queued, so they are not compressed */
+	set_response(MHD_create_response_from_callback(
+			-1, RESPONSE_BLOCK_SIZE,
+			event_stream_write,
+			new EventStreamReaderState(hub, stream, get_conn(), suspend, get_free_callback(), get_callback_data(), metrics_, metrics_handler_),
+			event_stream_free));
+	MHD_add_response_header(get_response(), "Content-Type", "text/event-stream");
+	MHD_add_response_header(get_response(), "Cache-Control", "no-cache");
+	set_status(MHD_HTTP_OK);
+
+	/* libmicrohttpd will call the appropriate callback to free the data instead of us */
+	set_free_callback(NULL);
+}
+
 void RESTRequestState::add_response_header(const std::string& name, const std::string& value)
 {
 	MHD_add_response_header(get_response(), name.c_str(), value.c_str());
 }
 
-void RESTRequestState::set_path(const char* value)
+void RESTRequestState::add_header(const char* key, const char* value)
 {
-	strncpy(rawpath_, value, MAX_PATH_LENGTH);
+	headers_.push_back(std::make_pair(arena_.copy(key, strlen(key)), arena_.copy(value, strlen(value))));
+}
 
+const char* RESTRequestState::get_header(const char* key) const
+{
+	for (HTTPHeaders::const_iterator itr = headers_.begin(); itr != headers_.end(); ++itr)
+		if (strcasecmp(itr->first, key) == 0)
+			return itr->second;
+	return NULL;
+}
+
+void RESTRequestState::set_path(const char* value)
+{
 	args_.clear();
 
-	/* Find components in the raw path */
-	char* p = rawpath_;
+	/* Find components in a copy of the raw path */
+	char* p = arena_.copy(value, strnlen(value, MAX_PATH_LENGTH));
 	while ((p = strchr(p, '/')) != NULL)
 	{
 		*p = '\0';
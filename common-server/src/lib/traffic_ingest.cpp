@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "p4pserver/traffic_ingest.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+
+const char TrafficIngest::BINARY_MAGIC[] = "P4PTRAF1";
+
+static bool is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+TrafficIngest::TrafficIngest()
+	: format_(FORMAT_UNKNOWN),
+	  records_(0),
+	  lines_(0),
+	  unknown_links_(0)
+{
+}
+
+void TrafficIngest::fail(const std::string& msg)
+{
+	if (error_.empty())
+		error_ = msg;
+}
+
+bool TrafficIngest::detect_format(bool finished)
+{
+	/* Binary input is recognized once enough of the magic has arrived */
+	size_t n = std::min(pending_.size(), (size_t)BINARY_MAGIC_LEN);
+	if (memcmp(pending_.data(), BINARY_MAGIC, n) != 0)
+		format_ = FORMAT_TEXT;
+	else if (n == BINARY_MAGIC_LEN)
+	{
+		format_ = FORMAT_BINARY;
+		pending_.erase(0, BINARY_MAGIC_LEN);
+	}
+	else if (finished)
+		format_ = FORMAT_TEXT;
+
+	return format_ != FORMAT_UNKNOWN;
+}
+
+bool TrafficIngest::add_data(const char* data, size_t len)
+{
+	if (has_error())
+		return false;
+
+	pending_.append(data, len);
+	if (format_ == FORMAT_UNKNOWN && !detect_format(false))
+		return true;
+
+	size_t consumed = format_ == FORMAT_TEXT
+		? parse_text(pending_.data(), pending_.size())
+		: parse_binary(pending_.data(), pending_.size());
+	pending_.erase(0, consumed);
+
+	return !has_error();
+}
+
+bool TrafficIngest::add_data(std::istream& is)
+{
+	char buf[65536];
+	while (is.read(buf, sizeof(buf)) || is.gcount() > 0)
+	{
+		if (!add_data(buf, is.gcount()))
+			return false;
+	}
+	return true;
+}
+
+bool TrafficIngest::finish()
+{
+	if (has_error())
+		return false;
+
+	if (format_ == FORMAT_UNKNOWN)
+		detect_format(true);
+
+	if (pending_.empty())
+		return true;
+
+	if (format_ == FORMAT_BINARY)
+	{
+		fail("input ends within a record");
+		return false;
+	}
+
+	/* The last line need not end with a newline */
+	pending_ += '\n';
+	pending_.erase(0, parse_text(pending_.data(), pending_.size()));
+	return !has_error();
+}
+
+size_t TrafficIngest::parse_text(const char* data, size_t len)
+{
+	const char* end = data + len;
+	const char* line = data;
+	while (line < end)
+	{
+		const char* eol = (const char*)memchr(line, '\n', end - line);
+		if (!eol)
+			break;
+
+		++lines_;
+		if (!parse_line(line, eol))
+			break;
+		line = eol + 1;
+	}
+	return line - data;
+}
+
+bool TrafficIngest::parse_line(const char* begin, const char* end)
+{
+	while (begin < end && is_space(*begin))
+		++begin;
+	while (end > begin && is_space(end[-1]))
+		--end;
+	if (begin == end || *begin == '#')
+		return true;
+
+	/* Link name */
+	const char* name_end = begin;
+	while (name_end < end && *name_end != ',' && !is_space(*name_end))
+		++name_end;
+
+	/* Separator: a comma and/or whitespace */
+	const char* value = name_end;
+	while (value < end && is_space(*value))
+		++value;
+	if (value < end && *value == ',')
+		++value;
+	while (value < end && is_space(*value))
+		++value;
+
+	/* Value; the line ends with whitespace or a newline, so strtod() stops there */
+	char* value_end;
+	double v = strtod(value, &value_end);
+	if (value == end || value_end != end || name_end == begin || !(v >= 0) || isinf(v))
+	{
+		fail("line " + boost::lexical_cast<std::string>(lines_) + ": expected '<link>,<value>'");
+		return false;
+	}
+
+	add_record(begin, name_end - begin, v);
+	return true;
+}
+
+size_t TrafficIngest::parse_binary(const char* data, size_t len)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	const unsigned char* end = p + len;
+	const unsigned char* record = p;
+	while (end - record >= 1)
+	{
+		size_t name_len = record[0];
+		if ((size_t)(end - record) < 1 + name_len + 8)
+			break;
+
+		if (name_len == 0)
+		{
+			fail("record " + boost::lexical_cast<std::string>(records_ + 1) + ": empty link name");
+			break;
+		}
+
+		const unsigned char* value = record + 1 + name_len;
+		unsigned long long v = 0;
+		for (unsigned int i = 0; i < 8; ++i)
+			v = (v << 8) | value[i];
+
+		add_record((const char*)record + 1, name_len, (double)v);
+		record = value + 8;
+	}
+	return record - p;
+}
+
+void TrafficIngest::add_record(const char* name, size_t name_len, double value)
+{
+	key_.assign(name, name_len);
+	traffic_[key_] += value;
+	++records_;
+}
+
+void TrafficIngest::add(const NetEdgeName& link, double value)
+{
+	traffic_[link] += value;
+	++records_;
+}
+
+unsigned int TrafficIngest::apply(NetState& net, double scale, bool reset, const WritableLock& lock)
+{
+	if (reset)
+	{
+		BOOST_FOREACH(const NetEdge& e, net.get_edges(lock))
+		{
+			net.set_traffic(e, 0.0, lock);
+		}
+	}
+
+	unsigned int updated = 0;
+	unknown_links_ = 0;
+	BOOST_FOREACH(const LinkTrafficMap::value_type& link, traffic_)
+	{
+		NetEdge e;
+		if (!net.get_edge(link.first, e, lock))
+		{
+			++unknown_links_;
+			continue;
+		}
+
+		net.set_traffic(e, link.second * scale, lock);
+		++updated;
+	}
+	return updated;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Unit Test: Precompressed response bodies
+ */
+
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include <zlib.h>
+
+#include "p4pserver/encoded_body.h"
+
+static std::string gunzip(const std::string& in)
+{
+	z_stream zstrm;
+	zstrm.zalloc = Z_NULL;
+	zstrm.zfree = Z_NULL;
+	zstrm.opaque = Z_NULL;
+	zstrm.next_in = (unsigned char*)in.data();
+	zstrm.avail_in = in.size();
+	BOOST_REQUIRE(inflateInit2(&zstrm, 16 + 15) == Z_OK);
+
+	std::string out;
+	char buf[4096];
+	int rc;
+	do
+	{
+		zstrm.next_out = (unsigned char*)buf;
+		zstrm.avail_out = sizeof(buf);
+		rc = inflate(&zstrm, Z_NO_FLUSH);
+		out.append(buf, sizeof(buf) - zstrm.avail_out);
+	} while (rc == Z_OK);
+	inflateEnd(&zstrm);
+	BOOST_CHECK_EQUAL(rc, Z_STREAM_END);
+	return out;
+}
+
+BOOST_AUTO_TEST_CASE ( encoded_body_gzip )
+{
+	std::string body;
+	for (unsigned int i = 0; i < 10000; ++i)
+		body += "{ \"pid\" : \"" + std::string(1, 'a' + i % 26) + "\", \"cost\" : 1.5 },\n";
+
+	EncodedBody encoded(body);
+	BOOST_CHECK(encoded.has(EncodedBody::IDENTITY));
+	BOOST_CHECK(encoded.has(EncodedBody::GZIP));
+	BOOST_CHECK_EQUAL(encoded.get(EncodedBody::IDENTITY), body);
+	BOOST_CHECK(encoded.get(EncodedBody::GZIP).size() < body.size() / 10);
+	BOOST_CHECK_EQUAL(gunzip(encoded.get(EncodedBody::GZIP)), body);
+
+	/* Compressing a tiny body makes it larger, so it is sent as is */
+	EncodedBody tiny("{}");
+	BOOST_CHECK(!tiny.has(EncodedBody::GZIP));
+	BOOST_CHECK_EQUAL(tiny.get(EncodedBody::GZIP), "{}");
+	BOOST_CHECK_EQUAL(tiny.select("gzip"), EncodedBody::IDENTITY);
+
+	EncodedBody empty("");
+	BOOST_CHECK_EQUAL(empty.get(empty.select("gzip")), "");
+}
+
+BOOST_AUTO_TEST_CASE ( encoded_body_accept_encoding )
+{
+	BOOST_CHECK(EncodedBody::accepts(NULL, EncodedBody::IDENTITY));
+	BOOST_CHECK(!EncodedBody::accepts(NULL, EncodedBody::GZIP));
+	BOOST_CHECK(!EncodedBody::accepts("", EncodedBody::GZIP));
+	BOOST_CHECK(EncodedBody::accepts("gzip", EncodedBody::GZIP));
+	BOOST_CHECK(EncodedBody::accepts("GZIP", EncodedBody::GZIP));
+	BOOST_CHECK(EncodedBody::accepts("deflate, gzip", EncodedBody::GZIP));
+	BOOST_CHECK(EncodedBody::accepts("gzip;q=0.5, deflate", EncodedBody::GZIP));
+	BOOST_CHECK(EncodedBody::accepts("*", EncodedBody::GZIP));
+	BOOST_CHECK(!EncodedBody::accepts("gzip;q=0", EncodedBody::GZIP));
+	BOOST_CHECK(!EncodedBody::accepts("gzip; q=0.0, deflate", EncodedBody::GZIP));
+	BOOST_CHECK(!EncodedBody::accepts("*, gzip;q=0", EncodedBody::GZIP));
+	BOOST_CHECK(!EncodedBody::accepts("x-gzipped, deflate", EncodedBody::GZIP));
+	BOOST_CHECK(!EncodedBody::accepts("identity", EncodedBody::GZIP));
+
+	std::string body(10000, 'x');
+	EncodedBody encoded(body);
+	BOOST_CHECK_EQUAL(encoded.select("deflate, gzip"), EncodedBody::GZIP);
+	BOOST_CHECK_EQUAL(encoded.select("deflate"), EncodedBody::IDENTITY);
+	BOOST_CHECK_EQUAL(encoded.select(NULL), EncodedBody::IDENTITY);
+	BOOST_CHECK_EQUAL(EncodedBody::get_name(EncodedBody::GZIP), std::string("gzip"));
+	BOOST_CHECK(EncodedBody::get_name(EncodedBody::IDENTITY) == NULL);
+}
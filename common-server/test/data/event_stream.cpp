@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+/*
+ * Unit Test: Server-sent event streams
+ */
+
+#include <string>
+#include <vector>
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "p4pserver/event_stream.h"
+
+static EventStreamMessagePtr message(const std::string& event, unsigned long long id, const std::string& data)
+{
+	std::string result;
+	EventStreamHub::append_message(result, event, id, data);
+	return EventStreamMessagePtr(new std::string(result));
+}
+
+/* Everything queued on a stream, without waiting */
+static std::string drain(const EventStreamPtr& stream, int block = 4096)
+{
+	std::string result;
+	std::vector<char> buf(block);
+	int n;
+	while ((n = stream->read(&buf[0], block, NULL, boost::posix_time::time_duration())) > 0)
+		result.append(&buf[0], n);
+	return result;
+}
+
+class CountingWaiter : public EventStreamWaiter
+{
+public:
+	CountingWaiter() : suspended(0), resumed(0) {}
+	virtual void suspend()	{ ++suspended; }
+	virtual void resume()	{ ++resumed; }
+	unsigned int suspended;
+	unsigned int resumed;
+};
+
+BOOST_AUTO_TEST_CASE ( event_stream_format )
+{
+	std::string out;
+	EventStreamHub::append_message(out, "networkmap", 7, "{\n\t\"a\" : 1\n}");
+	BOOST_CHECK_EQUAL(out, "event: networkmap\nid: 7\ndata: {\ndata: \t\"a\" : 1\ndata: }\n\n");
+
+	out.clear();
+	EventStreamHub::append_message(out, "ping", 1, "");
+	BOOST_CHECK_EQUAL(out, "event: ping\nid: 1\ndata: \n\n");
+}
+
+BOOST_AUTO_TEST_CASE ( event_stream_snapshot_then_updates )
+{
+	EventStreamHub hub;
+
+	/* Subscribed before there is anything to send */
+	EventStreamPtr early = hub.subscribe("view", 1024);
+	BOOST_CHECK_EQUAL(drain(early), "");
+
+	EventStreamMessagePtr snap1 = message("snapshot", 1, "one");
+	BOOST_CHECK_EQUAL(hub.publish("view", snap1, EventStreamMessagePtr()), 0U);
+	BOOST_CHECK_EQUAL(drain(early), *snap1);
+
+	/* New subscribers start from the snapshot; others get the update */
+	EventStreamMessagePtr snap2 = message("snapshot", 2, "two");
+	EventStreamMessagePtr update2 = message("update", 2, "+two");
+	hub.publish("view", snap2, update2);
+	EventStreamPtr late = hub.subscribe("view", 1024);
+	BOOST_CHECK_EQUAL(drain(early), *update2);
+	BOOST_CHECK_EQUAL(drain(late), *snap2);
+
+	/* A stream subscribed to a topic without a snapshot is sent the
+	 * snapshot rather than an update it has no base for */
+	EventStreamPtr other = hub.subscribe("other", 1024);
+	hub.publish("other", snap1, update2);
+	BOOST_CHECK_EQUAL(drain(other), *snap1);
+
+	BOOST_CHECK_EQUAL(hub.get_subscribers(), 3U);
+	hub.unsubscribe(early);
+	hub.unsubscribe(early);
+	BOOST_CHECK_EQUAL(hub.get_subscribers(), 2U);
+	BOOST_CHECK(hub.has_subscribers("view"));
+
+	/* Removing a topic ends its streams once they are drained */
+	hub.publish("view", snap1, update2);
+	hub.remove("view");
+	BOOST_CHECK(!hub.has_snapshot("view"));
+	BOOST_CHECK_EQUAL(hub.get_subscribers(), 1U);
+	BOOST_CHECK_EQUAL(drain(late), *update2);
+	char buf[16];
+	BOOST_CHECK_EQUAL(late->read(buf, sizeof(buf), NULL, boost::posix_time::time_duration()), -1);
+
+	/* Only topics without subscribers are forgotten */
+	BOOST_CHECK(!hub.remove_if_unused("other"));
+	BOOST_CHECK(hub.has_snapshot("other"));
+	hub.unsubscribe(other);
+	BOOST_CHECK(hub.remove_if_unused("other"));
+	BOOST_CHECK(!hub.has_snapshot("other"));
+	BOOST_CHECK(hub.remove_if_unused("missing"));
+}
+
+BOOST_AUTO_TEST_CASE ( event_stream_resync )
+{
+	EventStreamHub hub;
+	EventStreamMessagePtr snap = message("snapshot", 1, std::string(100, 's'));
+	EventStreamMessagePtr update = message("update", 2, std::string(100, 'u'));
+
+	EventStreamPtr stream = hub.subscribe("view", 3 * update->size());
+	hub.publish("view", snap, EventStreamMessagePtr());
+
+	/* Start reading the snapshot, then fall behind */
+	char buf[10];
+	BOOST_CHECK_EQUAL(stream->read(buf, sizeof(buf), NULL, boost::posix_time::time_duration()), 10);
+	unsigned int resynced = 0;
+	for (unsigned int i = 0; i < 4; ++i)
+		resynced += hub.publish("view", snap, update);
+	BOOST_CHECK_EQUAL(resynced, 1U);
+	BOOST_CHECK_EQUAL(stream->get_resyncs(), 1U);
+	BOOST_CHECK_EQUAL(hub.get_resyncs(), 1U);
+	BOOST_CHECK(stream->get_buffered() <= 3 * update->size());
+
+	/* The partly read snapshot is finished before the new one, followed
+	 * by the update published after the resync */
+	std::string expected = snap->substr(10) + *snap + *update;
+	BOOST_CHECK_EQUAL(drain(stream, 7), expected);
+}
+
+BOOST_AUTO_TEST_CASE ( event_stream_waiter )
+{
+	EventStreamHub hub;
+	CountingWaiter waiter;
+	EventStreamPtr stream = hub.subscribe("view", 1024);
+
+	char buf[64];
+	BOOST_CHECK_EQUAL(stream->read(buf, sizeof(buf), &waiter, boost::posix_time::time_duration()), 0);
+	BOOST_CHECK_EQUAL(waiter.suspended, 1U);
+	BOOST_CHECK_EQUAL(waiter.resumed, 0U);
+
+	EventStreamMessagePtr snap = message("snapshot", 1, "x");
+	hub.publish("view", snap, EventStreamMessagePtr());
+	BOOST_CHECK_EQUAL(waiter.resumed, 1U);
+	hub.publish("view", snap, snap);
+	BOOST_CHECK_EQUAL(waiter.resumed, 1U);
+	BOOST_CHECK_EQUAL(drain(stream), *snap + *snap);
+
+	/* A closed stream never resumes its reader */
+	BOOST_CHECK_EQUAL(stream->read(buf, sizeof(buf), &waiter, boost::posix_time::time_duration()), 0);
+	stream->close();
+	hub.publish("view", snap, snap);
+	BOOST_CHECK_EQUAL(waiter.suspended, 2U);
+	BOOST_CHECK_EQUAL(waiter.resumed, 1U);
+	hub.unsubscribe(stream);
+	BOOST_CHECK_EQUAL(hub.get_subscribers(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE ( event_stream_many_subscribers )
+{
+	/* Thousands of subscribers: a third read everything, a third read
+	 * now and then, and a third never read */
+	const unsigned int SUBSCRIBERS = 3000;
+	const unsigned int UPDATES = 200;
+	const size_t LIMIT = 16 * 1024;
+
+	EventStreamHub hub;
+	std::vector<EventStreamPtr> streams;
+	for (unsigned int i = 0; i < SUBSCRIBERS; ++i)
+		streams.push_back(hub.subscribe("view", LIMIT));
+
+	std::vector<std::string> received(SUBSCRIBERS);
+	EventStreamMessagePtr snap = message("snapshot", 0, std::string(2000, 's'));
+	hub.publish("view", snap, EventStreamMessagePtr());
+	for (unsigned int u = 1; u <= UPDATES; ++u)
+	{
+		snap = message("snapshot", u, std::string(2000, 's'));
+		hub.publish("view", snap, message("update", u, std::string(200, 'u')));
+		for (unsigned int i = 0; i < SUBSCRIBERS; ++i)
+		{
+			if (i % 3 == 0 || (i % 3 == 1 && u % 100 == 0))
+				received[i] += drain(streams[i]);
+			BOOST_REQUIRE(streams[i]->get_buffered() <= LIMIT + snap->size());
+		}
+	}
+
+	/* Fast readers were never resynced and saw every update */
+	std::string last_id = "id: " + boost::lexical_cast<std::string>(UPDATES) + "\n";
+	for (unsigned int i = 0; i < SUBSCRIBERS; ++i)
+	{
+		received[i] += drain(streams[i]);
+		if (i % 3 == 0)
+			BOOST_CHECK_EQUAL(streams[i]->get_resyncs(), 0U);
+		else
+			BOOST_CHECK(streams[i]->get_resyncs() > 0);
+		BOOST_CHECK(received[i].find(last_id) != std::string::npos);
+	}
+	BOOST_CHECK_EQUAL(hub.get_published(), UPDATES + 1);
+
+	for (unsigned int i = 0; i < SUBSCRIBERS; ++i)
+		hub.unsubscribe(streams[i]);
+	BOOST_CHECK_EQUAL(hub.get_subscribers(), 0U);
+}
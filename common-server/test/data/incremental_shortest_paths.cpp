@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Unit Test: IncrementalShortestPaths operations
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/lexical_cast.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include "p4pserver/incremental_shortest_paths.h"
+
+typedef std::map<std::pair<unsigned int, unsigned int>, double> EdgeMap;
+
+/* Distances by Bellman-Ford, independent of the class under test */
+static std::vector<double> reference_distances(const IncrementalShortestPaths& paths, const EdgeMap& edges, unsigned int src)
+{
+	std::vector<double> dist(paths.get_num_slots(), std::numeric_limits<double>::infinity());
+	dist[src] = 0.0;
+	for (unsigned int i = 0; i < paths.get_num_slots(); ++i)
+	{
+		for (EdgeMap::const_iterator itr = edges.begin(); itr != edges.end(); ++itr)
+		{
+			double d = dist[itr->first.first] + itr->second;
+			if (d < dist[itr->first.second])
+				dist[itr->first.second] = d;
+		}
+	}
+	return dist;
+}
+
+/* Check every stored tree against one computed from scratch and against the reference */
+static void check_trees(IncrementalShortestPaths& paths, const EdgeMap& edges)
+{
+	IncrementalShortestPaths::Tree full;
+	for (unsigned int s = 0; s < paths.get_num_slots(); ++s)
+	{
+		if (!paths.is_live(s))
+			continue;
+
+		const IncrementalShortestPaths::Tree& tree = paths.get_tree(s);
+		paths.compute_tree(s, full);
+		BOOST_REQUIRE(tree.dist == full.dist);
+		BOOST_REQUIRE(tree.pred == full.pred);
+
+		std::vector<double> ref = reference_distances(paths, edges, s);
+		for (unsigned int v = 0; v < paths.get_num_slots(); ++v)
+		{
+			if (paths.is_live(v))
+				BOOST_REQUIRE_EQUAL(tree.dist[v], ref[v]);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE ( incremental_shortest_paths_reroute )
+{
+	IncrementalShortestPaths paths;
+	unsigned int a = paths.add_node("a");
+	unsigned int b = paths.add_node("b");
+	unsigned int c = paths.add_node("c");
+	unsigned int d = paths.add_node("d");
+	paths.set_edge(a, b, 1.0);
+	paths.set_edge(a, c, 1.0);
+	paths.set_edge(b, d, 1.0);
+	paths.set_edge(c, d, 1.0);
+
+	/* Equal paths; the predecessor whose name sorts first wins */
+	BOOST_CHECK_EQUAL(paths.get_tree(a).pred[d], (int)b);
+	BOOST_CHECK_EQUAL(paths.get_tree(a).dist[d], 2.0);
+
+	paths.set_edge(a, b, 3.0);
+	BOOST_CHECK_EQUAL(paths.get_tree(a).pred[d], (int)c);
+	BOOST_CHECK_EQUAL(paths.get_tree(a).dist[b], 3.0);
+
+	paths.remove_edge(c, d);
+	BOOST_CHECK_EQUAL(paths.get_tree(a).pred[d], (int)b);
+	BOOST_CHECK_EQUAL(paths.get_tree(a).dist[d], 4.0);
+
+	paths.remove_node(b);
+	BOOST_CHECK_EQUAL(paths.get_tree(a).pred[d], IncrementalShortestPaths::NO_PRED);
+	BOOST_CHECK_EQUAL(paths.get_tree(a).dist[d], std::numeric_limits<double>::infinity());
+
+	paths.set_edge(c, d, 0.5);
+	BOOST_CHECK_EQUAL(paths.get_tree(a).pred[d], (int)c);
+	BOOST_CHECK_EQUAL(paths.get_tree(a).dist[d], 1.5);
+
+	/* Only the first tree was computed from scratch */
+	BOOST_CHECK_EQUAL(paths.get_full_computations(), 1ULL);
+	BOOST_CHECK_THROW(paths.set_edge(a, c, 0.0), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE ( incremental_shortest_paths_random_changes )
+{
+	boost::mt19937 rng(42);
+	boost::variate_generator<boost::mt19937&, boost::uniform_int<> > node(rng, boost::uniform_int<>(0, 39));
+	boost::variate_generator<boost::mt19937&, boost::uniform_int<> > weight(rng, boost::uniform_int<>(1, 4));
+	boost::variate_generator<boost::mt19937&, boost::uniform_int<> > action(rng, boost::uniform_int<>(0, 9));
+
+	IncrementalShortestPaths paths;
+	std::vector<unsigned int> slots;
+	for (unsigned int i = 0; i < 40; ++i)
+		slots.push_back(paths.add_node("n" + boost::lexical_cast<std::string>(i)));
+
+	/* Small integer weights, so that many paths tie */
+	EdgeMap edges;
+	unsigned int readded = 0;
+	for (unsigned int i = 0; i < 160; ++i)
+	{
+		unsigned int u = slots[node()], v = slots[node()];
+		if (u == v)
+			continue;
+		edges[std::make_pair(u, v)] = weight();
+		paths.set_edge(u, v, edges[std::make_pair(u, v)]);
+	}
+	check_trees(paths, edges);
+
+	for (unsigned int i = 0; i < 300; ++i)
+	{
+		unsigned int u = slots[node()], v = slots[node()];
+		if (u == v || !paths.is_live(u) || !paths.is_live(v))
+			continue;
+
+		int a = action();
+		if (a < 4)
+		{
+			/* Add an edge or change its weight */
+			double w = weight() + (a == 0 ? 0.5 : 0.0);
+			edges[std::make_pair(u, v)] = w;
+			paths.set_edge(u, v, w);
+		}
+		else if (a < 8 && !edges.empty())
+		{
+			/* Remove an existing edge */
+			EdgeMap::iterator itr = edges.lower_bound(std::make_pair(u, v));
+			if (itr == edges.end())
+				itr = edges.begin();
+			paths.remove_edge(itr->first.first, itr->first.second);
+			edges.erase(itr);
+		}
+		else if (a == 8)
+		{
+			/* Remove a node, then add it back under a new slot */
+			std::string name = paths.get_name(u);
+			paths.remove_node(u);
+			for (EdgeMap::iterator itr = edges.begin(); itr != edges.end(); )
+			{
+				if (itr->first.first == u || itr->first.second == u)
+					edges.erase(itr++);
+				else
+					++itr;
+			}
+			unsigned int n = paths.add_node(name);
+			BOOST_CHECK(n != u);
+			std::replace(slots.begin(), slots.end(), u, n);
+			++readded;
+		}
+		else
+		{
+			/* Lower a weight on an existing edge */
+			EdgeMap::iterator itr = edges.lower_bound(std::make_pair(u, v));
+			if (itr == edges.end() || itr->second <= 1.0)
+				continue;
+			itr->second -= 1.0;
+			paths.set_edge(itr->first.first, itr->first.second, itr->second);
+		}
+
+		check_trees(paths, edges);
+	}
+
+	/* Trees were only computed from scratch for new nodes */
+	BOOST_CHECK(paths.get_repairs() > 0);
+	BOOST_CHECK_EQUAL(paths.get_full_computations(), 40ULL + readded);
+}
+
+BOOST_AUTO_TEST_CASE ( incremental_shortest_paths_sync )
+{
+	std::vector<std::string> nodes;
+	std::vector<IncrementalShortestPaths::Edge> edges;
+	for (unsigned int i = 0; i < 100; ++i)
+	{
+		nodes.push_back("n" + boost::lexical_cast<std::string>(i));
+		edges.push_back(IncrementalShortestPaths::Edge(i, (i + 1) % 100, 1.0));
+		edges.push_back(IncrementalShortestPaths::Edge(i, (i + 7) % 100, 5.0));
+	}
+
+	IncrementalShortestPaths paths;
+	std::vector<unsigned int> slots;
+	BOOST_CHECK_EQUAL(paths.sync(nodes, edges, slots), 300u);
+	BOOST_CHECK_EQUAL(paths.get_num_edges(), 200u);
+	for (unsigned int i = 0; i < nodes.size(); ++i)
+		paths.get_tree(slots[i]);
+	BOOST_CHECK_EQUAL(paths.get_full_computations(), 100ULL);
+
+	/* The same graph changes nothing */
+	unsigned long generation = paths.get_generation();
+	BOOST_CHECK_EQUAL(paths.sync(nodes, edges, slots), 0u);
+	BOOST_CHECK_EQUAL(paths.get_generation(), generation);
+
+	/* One link is repaired in place */
+	edges[0].weight = 10.0;
+	BOOST_CHECK_EQUAL(paths.sync(nodes, edges, slots), 1u);
+	BOOST_CHECK_EQUAL(paths.get_tree(slots[0]).dist[slots[1]], 10.0);
+	BOOST_CHECK_EQUAL(paths.get_full_computations(), 100ULL);
+
+	/* A node leaving takes its edges with it */
+	std::vector<std::string> fewer(nodes.begin() + 1, nodes.end());
+	std::vector<IncrementalShortestPaths::Edge> fewer_edges;
+	for (unsigned int i = 0; i < edges.size(); ++i)
+	{
+		if (edges[i].src != 0 && edges[i].dst != 0)
+			fewer_edges.push_back(IncrementalShortestPaths::Edge(edges[i].src - 1, edges[i].dst - 1, edges[i].weight));
+	}
+	std::vector<unsigned int> fewer_slots;
+	BOOST_CHECK_EQUAL(paths.sync(fewer, fewer_edges, fewer_slots), 5u);
+	BOOST_CHECK_EQUAL(paths.get_num_nodes(), 99u);
+	BOOST_CHECK_EQUAL(paths.get_num_edges(), 196u);
+	BOOST_CHECK_EQUAL(fewer_slots[0], slots[1]);
+	BOOST_CHECK_EQUAL(paths.get_full_computations(), 100ULL);
+
+	/* Many changes at once discard the trees instead */
+	for (unsigned int i = 0; i < fewer_edges.size(); i += 2)
+		fewer_edges[i].weight = 2.0;
+	paths.sync(fewer, fewer_edges, fewer_slots);
+	paths.get_tree(fewer_slots[0]);
+	BOOST_CHECK_EQUAL(paths.get_full_computations(), 101ULL);
+
+	IncrementalShortestPaths::Tree full;
+	paths.compute_tree(fewer_slots[0], full);
+	BOOST_CHECK(paths.get_tree(fewer_slots[0]).pred == full.pred);
+}
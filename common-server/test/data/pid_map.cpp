@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+
+/*
+ * Unit Test: PIDMap prefix table
+ */
+
+#include <arpa/inet.h>
+#include <boost/test/unit_test.hpp>
+
+#include "p4p/pid.h"
+#include "p4pserver/pid_map.h"
+
+using namespace p4p;
+
+BOOST_AUTO_TEST_CASE ( pid_map_table )
+{
+	PIDMapPtr pidmap(new PIDMap());
+	PID a("isp", 1, false);
+	PID b("isp", 2, false);
+	PID c("isp", 3, false);
+
+	{
+		BlockWriteLock lock(*pidmap);
+		BOOST_CHECK(pidmap->add("10.0.0.0", 8, b, lock));
+		BOOST_CHECK(pidmap->add("11.0.0.0", 8, a, lock));
+		BOOST_CHECK(pidmap->add("12.0.0.0", 16, b, lock));
+	}
+
+	PIDPrefixTableConstPtr table;
+	{
+		BlockReadLock lock(*pidmap);
+		table = pidmap->get_table(lock);
+		BOOST_CHECK(pidmap->get_table(lock) == table);
+
+		/* Grouped by PID, in PID order */
+		BOOST_REQUIRE_EQUAL(table->get_entries().size(), 2U);
+		BOOST_CHECK(table->get_entries()[0].first == a);
+		BOOST_CHECK(table->get_entries()[1].first == b);
+		BOOST_CHECK_EQUAL(table->get_entries()[1].second.size(), 2U);
+		BOOST_CHECK_EQUAL(table->get_num_prefixes(), 3U);
+		BOOST_CHECK(table->find(c) == NULL);
+
+		IPPrefixVector prefixes;
+		pidmap->get_prefixes(b, prefixes, lock);
+		BOOST_CHECK_EQUAL(prefixes.size(), 2U);
+		pidmap->get_prefixes(c, prefixes, lock);
+		BOOST_CHECK(prefixes.empty());
+
+		/* Requested PIDs only, including one without prefixes */
+		std::vector<std::pair<PID, std::vector<IPPrefix> > > entries;
+		entries.push_back(std::make_pair(c, std::vector<IPPrefix>(1)));
+		entries.push_back(std::make_pair(a, std::vector<IPPrefix>()));
+		pidmap->enumerate(entries, lock);
+		BOOST_CHECK(entries[0].second.empty());
+		BOOST_CHECK_EQUAL(entries[1].second.size(), 1U);
+	}
+
+	/* A copy shares the table until it changes */
+	PIDMapPtr copy;
+	{
+		BlockReadLock lock(*pidmap);
+		copy = boost::dynamic_pointer_cast<PIDMap>(pidmap->copy(lock));
+	}
+	{
+		BlockReadLock lock(*copy);
+		BOOST_CHECK(copy->get_table(lock) == table);
+	}
+	{
+		BlockWriteLock lock(*copy);
+		BOOST_CHECK(copy->remove(a, lock));
+		BOOST_CHECK_EQUAL(copy->get_table(lock)->get_entries().size(), 1U);
+	}
+	{
+		BlockReadLock lock(*pidmap);
+		BOOST_CHECK(pidmap->get_table(lock) == table);
+	}
+
+	/* Changes build a new table; the old one is left as it was */
+	{
+		BlockWriteLock lock(*pidmap);
+		BOOST_CHECK(pidmap->add("13.0.0.0", 8, c, lock));
+		BOOST_CHECK_EQUAL(pidmap->get_table(lock)->get_entries().size(), 3U);
+		pidmap->clear(lock);
+		BOOST_CHECK(pidmap->get_table(lock)->get_entries().empty());
+	}
+	BOOST_CHECK_EQUAL(table->get_entries().size(), 2U);
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Unit Test: PIDRouting multipath and static route splitting
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+#include "p4p/pid.h"
+#include "p4pserver/net_state.h"
+#include "p4pserver/pid_routing.h"
+
+using namespace p4p;
+
+/* Diamond a->{b,c}->d, plus a longer direct link a->d */
+struct DiamondFixture
+{
+	DiamondFixture()
+		: routing(new PIDRouting(1.0))
+	{
+		const char* names[] = { "a", "b", "c", "d" };
+		for (unsigned int i = 0; i < 4; ++i)
+		{
+			BlockWriteLock state_lock(state);
+			BlockWriteLock routing_lock(*routing);
+			NetVertex v;
+			state.add_node(names[i], v, state_lock);
+			state.set_pid(v, PID("isp", i + 1, false), state_lock);
+			verts[i] = v;
+			pids.insert(PinnedPID(PID("isp", i + 1, false), v));
+			routing->add_pid(PID("isp", i + 1, false), routing_lock);
+		}
+
+		link(0, 1, 1.0);
+		link(0, 2, 1.0);
+		link(1, 3, 1.0);
+		link(2, 3, 1.0);
+		link(0, 3, 3.0);
+	}
+
+	void link(unsigned int src, unsigned int dst, double weight)
+	{
+		BlockWriteLock state_lock(state);
+		BlockWriteLock routing_lock(*routing);
+		NetEdge e;
+		if (!state.get_edge(verts[src], verts[dst], e, state_lock))
+			state.add_edge(verts[src], verts[dst], e, state_lock);
+		routing->set_weight(PID("isp", src + 1, false), PID("isp", dst + 1, false), weight, routing_lock);
+	}
+
+	unsigned int index(const PIDRouting::RouteComputationContext& context, unsigned int v)
+	{
+		unsigned int result = 0;
+		BOOST_REQUIRE(context.get_vertex_index(verts[v], result));
+		return result;
+	}
+
+	NetState state;
+	PIDRoutingPtr routing;
+	NetVertex verts[4];
+	PinnedPIDSet pids;
+};
+
+BOOST_AUTO_TEST_CASE ( pid_routing_ecmp_split )
+{
+	DiamondFixture f;
+	{
+		BlockWriteLock lock(*f.routing);
+		f.routing->set_route_mode(PIDRouting::RM_ECMP, lock);
+	}
+
+	BlockReadLock state_lock(f.state);
+	BlockReadLock routing_lock(*f.routing);
+	PIDRouting::RouteComputationContext context;
+	const PinnedPID& dst = *f.pids.find(PinnedPID(PID("isp", 4, false), NULL));
+	BOOST_REQUIRE(f.routing->get_multipath(dst, f.state, state_lock, context, routing_lock));
+
+	/* Destination first, source last */
+	const std::vector<unsigned int>& order = context.get_multipath_order();
+	BOOST_REQUIRE_EQUAL(order.size(), (unsigned int)4);
+	BOOST_CHECK_EQUAL(order.front(), f.index(context, 3));
+	BOOST_CHECK_EQUAL(order.back(), f.index(context, 0));
+
+	/* Both middle vertices carry half, and the longer link none */
+	PIDRouting::MultipathHopRange hops = context.get_multipath_hops(f.index(context, 0));
+	BOOST_REQUIRE_EQUAL(hops.second - hops.first, 2);
+	for (PIDRouting::MultipathHopVector::const_iterator itr = hops.first; itr != hops.second; ++itr)
+	{
+		BOOST_CHECK(itr->vertex == f.index(context, 1) || itr->vertex == f.index(context, 2));
+		BOOST_CHECK_CLOSE(itr->fraction, 0.5, 0.001);
+	}
+
+	hops = context.get_multipath_hops(f.index(context, 1));
+	BOOST_REQUIRE_EQUAL(hops.second - hops.first, 1);
+	BOOST_CHECK_EQUAL(hops.first->vertex, f.index(context, 3));
+	BOOST_CHECK_CLOSE(hops.first->fraction, 1.0, 0.001);
+
+	hops = context.get_multipath_hops(f.index(context, 3));
+	BOOST_CHECK(hops.first == hops.second);
+}
+
+BOOST_AUTO_TEST_CASE ( pid_routing_ecmp_unequal )
+{
+	DiamondFixture f;
+	f.link(2, 3, 2.0);
+	{
+		BlockWriteLock lock(*f.routing);
+		f.routing->set_route_mode(PIDRouting::RM_ECMP, lock);
+	}
+
+	BlockReadLock state_lock(f.state);
+	BlockReadLock routing_lock(*f.routing);
+	PIDRouting::RouteComputationContext context;
+	const PinnedPID& dst = *f.pids.find(PinnedPID(PID("isp", 4, false), NULL));
+	BOOST_REQUIRE(f.routing->get_multipath(dst, f.state, state_lock, context, routing_lock));
+
+	/* Only the cheaper side remains */
+	PIDRouting::MultipathHopRange hops = context.get_multipath_hops(f.index(context, 0));
+	BOOST_REQUIRE_EQUAL(hops.second - hops.first, 1);
+	BOOST_CHECK_EQUAL(hops.first->vertex, f.index(context, 1));
+	BOOST_CHECK_CLOSE(hops.first->fraction, 1.0, 0.001);
+}
+
+BOOST_AUTO_TEST_CASE ( pid_routing_static_weighted )
+{
+	DiamondFixture f;
+	PIDRouting::NamedRoute upper, lower;
+	upper.push_back(PID("isp", 1, false));
+	upper.push_back(PID("isp", 2, false));
+	upper.push_back(PID("isp", 4, false));
+	lower.push_back(PID("isp", 1, false));
+	lower.push_back(PID("isp", 3, false));
+	lower.push_back(PID("isp", 4, false));
+	{
+		BlockWriteLock lock(*f.routing);
+		f.routing->set_route_mode(PIDRouting::RM_STATIC, lock);
+		BOOST_CHECK(f.routing->add_static_route(upper, 3.0, lock));
+		BOOST_CHECK(f.routing->add_static_route(lower, lock));
+		BOOST_CHECK(!f.routing->add_static_route(lower, 0.0, lock));
+		BOOST_CHECK_CLOSE(f.routing->get_static_route_weight(upper, lock), 3.0, 0.001);
+		BOOST_CHECK_CLOSE(f.routing->get_static_route_weight(lower, lock), 1.0, 0.001);
+	}
+
+	{
+		BlockReadLock state_lock(f.state);
+		BlockReadLock routing_lock(*f.routing);
+		PIDRouting::RouteComputationContext context;
+		const PinnedPID& src = *f.pids.find(PinnedPID(PID("isp", 1, false), NULL));
+		BOOST_REQUIRE(f.routing->get_routes(src, f.state, state_lock, f.pids, context, routing_lock));
+
+		/* The first route is the unsplit result; the split covers both */
+		PIDRouting::PinnedRouteMap::const_iterator route = context.get_result().find(PinnedPID(PID("isp", 4, false), NULL));
+		BOOST_REQUIRE(route != context.get_result().end());
+		BOOST_CHECK_EQUAL(route->second.size(), (unsigned int)3);
+
+		PIDRouting::PinnedRouteSplitMap::const_iterator split = context.get_splits().find(PinnedPID(PID("isp", 4, false), NULL));
+		BOOST_REQUIRE(split != context.get_splits().end());
+		BOOST_REQUIRE_EQUAL(split->second.size(), (unsigned int)2);
+		for (unsigned int i = 0; i < split->second.size(); ++i)
+		{
+			bool is_upper = split->second[i].first.at(1) == PID("isp", 2, false);
+			BOOST_CHECK_CLOSE(split->second[i].second, is_upper ? 0.75 : 0.25, 0.001);
+		}
+	}
+
+	/* Leaving static mode drops the routes */
+	{
+		BlockWriteLock lock(*f.routing);
+		f.routing->set_route_mode(PIDRouting::RM_WEIGHTS, lock);
+		BOOST_CHECK_EQUAL(f.routing->get_num_static_routes(lock), (unsigned int)0);
+		BOOST_CHECK_CLOSE(f.routing->get_static_route_weight(upper, lock), 1.0, 0.001);
+	}
+}
+
+BOOST_AUTO_TEST_CASE ( pid_routing_route_mode_names )
+{
+	PIDRouting::RouteMode modes[] = { PIDRouting::RM_STATIC, PIDRouting::RM_WEIGHTS, PIDRouting::RM_ECMP };
+	for (unsigned int i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i)
+	{
+		PIDRouting::RouteMode mode;
+		BOOST_CHECK(PIDRouting::parse_route_mode(PIDRouting::get_route_mode_name(modes[i]), mode));
+		BOOST_CHECK_EQUAL(mode, modes[i]);
+	}
+
+	PIDRouting::RouteMode mode;
+	BOOST_CHECK(!PIDRouting::parse_route_mode("shortest", mode));
+}
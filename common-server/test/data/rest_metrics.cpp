@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Unit Test: REST request counters
+ */
+
+#include <sstream>
+#include <string>
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+#include "p4pserver/rest_metrics.h"
+
+static void serve_requests(RESTMetrics* metrics, unsigned int handler, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		metrics->record_request(handler, 200, 1000);
+		metrics->record_bytes_out(handler, 10);
+	}
+}
+
+static bool contains(const std::string& s, const std::string& sub)
+{
+	return s.find(sub) != std::string::npos;
+}
+
+BOOST_AUTO_TEST_CASE ( rest_metrics_exited_threads_counted )
+{
+	unsigned int handler = RESTMetrics::register_handler("unittest_exited");
+	RESTMetrics metrics;
+
+	/* One thread per connection, each exiting after its requests */
+	for (unsigned int round = 0; round < 4; ++round)
+	{
+		boost::thread_group threads;
+		for (unsigned int i = 0; i < 8; ++i)
+			threads.create_thread(boost::bind(&serve_requests, &metrics, handler, 25));
+		threads.join_all();
+	}
+
+	/* And some on this thread, which is still running */
+	serve_requests(&metrics, handler, 3);
+
+	std::ostringstream os;
+	metrics.write_prometheus(os, "");
+	BOOST_CHECK(contains(os.str(), "p4p_rest_requests_total{handler=\"unittest_exited\",code=\"200\"} 803\n"));
+	BOOST_CHECK(contains(os.str(), "p4p_rest_response_bytes_total{handler=\"unittest_exited\"} 8030\n"));
+}
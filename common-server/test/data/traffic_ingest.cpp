@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/*
+ * Unit Test: Bulk traffic ingest
+ */
+
+#include <sstream>
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+#include "p4pserver/net_state.h"
+#include "p4pserver/traffic_ingest.h"
+
+/* Nodes a, b, c with links ab, bc and ca */
+struct TriangleFixture
+{
+	TriangleFixture()
+	{
+		BlockWriteLock lock(state);
+		const char* names[] = { "a", "b", "c" };
+		NetVertex v;
+		for (unsigned int i = 0; i < 3; ++i)
+			state.add_node(names[i], v, lock);
+
+		NetEdge e;
+		state.add_edge("a", "b", e, lock);
+		state.set_name(e, "ab", lock);
+		state.add_edge("b", "c", e, lock);
+		state.set_name(e, "bc", lock);
+		state.add_edge("c", "a", e, lock);
+		state.set_name(e, "ca", lock);
+	}
+
+	double traffic(const char* link)
+	{
+		BlockReadLock lock(state);
+		NetEdge e;
+		BOOST_REQUIRE(state.get_edge(link, e, lock));
+		return state.get_traffic(e, lock);
+	}
+
+	NetState state;
+};
+
+static std::string binary_record(const std::string& name, unsigned long long value)
+{
+	std::string result(1, (char)name.size());
+	result += name;
+	for (int i = 7; i >= 0; --i)
+		result += (char)((value >> (i * 8)) & 0xff);
+	return result;
+}
+
+BOOST_FIXTURE_TEST_CASE ( traffic_ingest_text, TriangleFixture )
+{
+	TrafficIngest ingest;
+	std::istringstream input("# link,bytes\nab,100\nbc 50\n\n  ab , 25.5\r\nca\t7");
+	BOOST_CHECK(ingest.add_data(input));
+	BOOST_CHECK(ingest.finish());
+	BOOST_CHECK_EQUAL(ingest.get_records(), 4U);
+	BOOST_CHECK_EQUAL(ingest.get_links(), 3U);
+
+	{
+		BlockWriteLock lock(state);
+		BOOST_CHECK_EQUAL(ingest.apply(state, 2.0, false, lock), 3U);
+	}
+	BOOST_CHECK_CLOSE(traffic("ab"), 251.0, 1e-9);
+	BOOST_CHECK_CLOSE(traffic("bc"), 100.0, 1e-9);
+	BOOST_CHECK_CLOSE(traffic("ca"), 14.0, 1e-9);
+}
+
+BOOST_FIXTURE_TEST_CASE ( traffic_ingest_split_records, TriangleFixture )
+{
+	/* Feed the input one byte at a time */
+	std::string input = "ab,100\nbc,50\n";
+	TrafficIngest ingest;
+	for (unsigned int i = 0; i < input.size(); ++i)
+		BOOST_CHECK(ingest.add_data(input.data() + i, 1));
+	BOOST_CHECK(ingest.finish());
+	BOOST_CHECK_EQUAL(ingest.get_records(), 2U);
+
+	std::string binary = std::string(TrafficIngest::BINARY_MAGIC, TrafficIngest::BINARY_MAGIC_LEN)
+		+ binary_record("ab", 1) + binary_record("ca", 1ULL << 40) + binary_record("ab", 2);
+	TrafficIngest binary_ingest;
+	for (unsigned int i = 0; i < binary.size(); ++i)
+		BOOST_CHECK(binary_ingest.add_data(binary.data() + i, 1));
+	BOOST_CHECK(binary_ingest.finish());
+	BOOST_CHECK_EQUAL(binary_ingest.get_records(), 3U);
+
+	{
+		BlockWriteLock lock(state);
+		BOOST_CHECK_EQUAL(binary_ingest.apply(state, 1.0, false, lock), 2U);
+	}
+	BOOST_CHECK_CLOSE(traffic("ab"), 3.0, 1e-9);
+	BOOST_CHECK_CLOSE(traffic("ca"), (double)(1ULL << 40), 1e-9);
+}
+
+BOOST_FIXTURE_TEST_CASE ( traffic_ingest_reset_and_unknown, TriangleFixture )
+{
+	{
+		BlockWriteLock lock(state);
+		NetEdge e;
+		state.get_edge("bc", e, lock);
+		state.set_traffic(e, 9.0, lock);
+		state.get_edge("ca", e, lock);
+		state.set_traffic(e, 9.0, lock);
+	}
+
+	TrafficIngest ingest;
+	ingest.add("ab", 5.0);
+	ingest.add("zz", 5.0);
+	{
+		BlockWriteLock lock(state);
+		BOOST_CHECK_EQUAL(ingest.apply(state, 1.0, false, lock), 1U);
+	}
+	BOOST_CHECK_EQUAL(ingest.get_unknown_links(), 1U);
+	BOOST_CHECK_CLOSE(traffic("bc"), 9.0, 1e-9);
+
+	{
+		BlockWriteLock lock(state);
+		ingest.apply(state, 1.0, true, lock);
+	}
+	BOOST_CHECK_CLOSE(traffic("ab"), 5.0, 1e-9);
+	BOOST_CHECK_EQUAL(traffic("bc"), 0.0);
+	BOOST_CHECK_EQUAL(traffic("ca"), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE ( traffic_ingest_malformed )
+{
+	const char* inputs[] = { "ab\n", "ab,\n", "ab,-1\n", "ab,12x\n", "ab,1,2\n", ",5\n" };
+	for (unsigned int i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i)
+	{
+		TrafficIngest ingest;
+		std::string input = std::string("ok,1\n") + inputs[i];
+		BOOST_CHECK(!ingest.add_data(input.data(), input.size()));
+		BOOST_CHECK(ingest.has_error());
+		BOOST_CHECK_EQUAL(ingest.get_error().substr(0, 7), "line 2:");
+	}
+
+	/* Binary input cut off within a record */
+	std::string binary = std::string(TrafficIngest::BINARY_MAGIC, TrafficIngest::BINARY_MAGIC_LEN) + binary_record("ab", 1);
+	TrafficIngest ingest;
+	BOOST_CHECK(ingest.add_data(binary.data(), binary.size() - 1));
+	BOOST_CHECK(!ingest.finish());
+}
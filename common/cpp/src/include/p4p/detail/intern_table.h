@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#ifndef P4P_INTERN_TABLE_H
+#define P4P_INTERN_TABLE_H
+
+#include <map>
+#include <stdexcept>
+#include <string.h>
+#include <p4p/detail/mutex.h>
+
+namespace p4p {
+namespace detail {
+
+/**
+ * Append-only table assigning dense ids to distinct values. Ids are
+ * handed out in order starting at 0 and are never reused, so a table
+ * shared by the whole process lets containers store and compare a 32-bit
+ * id in place of the value itself.
+ *
+ * Interning takes a lock; mapping an id back to its value does not.
+ * Values are never moved once stored, and an id only reaches another
+ * thread after it has been interned, so get() needs no synchronization
+ * beyond whatever passed the id along.
+ *
+ * Index is the container used to look up values; it must not move its
+ * keys (std::map and std::tr1::unordered_map both qualify).
+ */
+template <class T, class Index = std::map<T, unsigned int> >
+class InternTable
+{
+public:
+	static const unsigned int CHUNK_BITS = 10;
+	static const unsigned int CHUNK_SIZE = 1 << CHUNK_BITS;
+	static const unsigned int MAX_CHUNKS = 4096;
+
+	InternTable()
+		: size_(0)
+	{
+		memset(chunks_, 0, sizeof(chunks_));
+	}
+
+	/**
+	 * Construct a table with a first value, which gets id 0.
+	 */
+	InternTable(const T& first)
+		: size_(0)
+	{
+		memset(chunks_, 0, sizeof(chunks_));
+		intern(first);
+	}
+
+	~InternTable()
+	{
+		for (unsigned int i = 0; i < MAX_CHUNKS && chunks_[i]; ++i)
+			delete [] chunks_[i];
+	}
+
+	/**
+	 * Get the id of a value, adding it to the table if necessary.
+	 */
+	unsigned int intern(const T& value)
+	{
+		unsigned int result;
+		if (find(value, result))
+			return result;
+
+		ScopedExclusiveLock lock(mutex_);
+
+		/* Another thread may have added it in the meantime */
+		std::pair<typename Index::iterator, bool> ins = index_.insert(std::make_pair(value, size_));
+		if (!ins.second)
+			return ins.first->second;
+
+		result = size_;
+		unsigned int chunk = result >> CHUNK_BITS;
+		if (chunk >= MAX_CHUNKS)
+		{
+			index_.erase(ins.first);
+			throw std::length_error("intern table full");
+		}
+
+		if (!chunks_[chunk])
+			chunks_[chunk] = new const T*[CHUNK_SIZE];
+		chunks_[chunk][result & (CHUNK_SIZE - 1)] = &ins.first->first;
+		size_ = result + 1;
+		return result;
+	}
+
+	/**
+	 * Look up the id of a value without adding it. Returns false if
+	 * the value has not been interned.
+	 */
+	bool find(const T& value, unsigned int& result) const
+	{
+		ScopedSharedLock lock(mutex_);
+		typename Index::const_iterator itr = index_.find(value);
+		if (itr == index_.end())
+			return false;
+		result = itr->second;
+		return true;
+	}
+
+	/**
+	 * Get the value with the given id, which must have been returned
+	 * by intern() or find().
+	 */
+	const T& get(unsigned int id) const
+	{
+		return *chunks_[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)];
+	}
+
+	/**
+	 * Get the number of values interned so far; ids range from 0 to size() - 1.
+	 */
+	unsigned int size() const
+	{
+		ScopedSharedLock lock(mutex_);
+		return size_;
+	}
+
+private:
+	/* Not copyable */
+	InternTable(const InternTable&);
+	InternTable& operator=(const InternTable&);
+
+	SharedMutex mutex_;
+	Index index_;
+	unsigned int size_;
+
+	/* Pointers to the keys stored in 'index_', by id */
+	const T** chunks_[MAX_CHUNKS];
+};
+
+}; // namespace detail
+}; // namespace p4p
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <p4p/detail/compiler.h>
+
+namespace p4p {
+namespace detail {
+
+/**
+ * Latency histogram in the style of HdrHistogram: values are kept
+ * exactly below 128 and with 64 linear sub-buckets per power of two
+ * above that, so percentiles are accurate to within about 1.5% over
+ * the whole range while recording stays a constant-time increment.
+ */
+class p4p_common_cpp_EXPORT LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	/* Record a single value (in microseconds) */
+	void record(unsigned long long value);
+
+	/* Add all values recorded in another histogram */
+	void merge(const LatencyHistogram& rhs);
+
+	unsigned long long getCount() const	{ return m_count; }
+	unsigned long long getMax() const	{ return m_max; }
+	double getMean() const;
+
+	/* Value at or below which the given percentage of values fall */
+	unsigned long long getPercentile(double pct) const;
+
+private:
+	static unsigned int bucketIndex(unsigned long long value);
+	static unsigned long long bucketValue(unsigned int index);
+
+	std::vector<unsigned long long> m_buckets;
+	unsigned long long m_count;
+	unsigned long long m_max;
+	long double m_sum;
+};
+
+/* Prints count, mean, common percentiles and maximum */
+p4p_common_cpp_EXPORT std::ostream& operator<<(std::ostream& os, const LatencyHistogram& rhs);
+
+}; // namespace detail
+}; // namespace p4p
+
+#endif
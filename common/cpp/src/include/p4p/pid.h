@@ -32,6 +32,8 @@
 
 #ifdef P4P_CLUSTER
 	#include <boost/serialization/access.hpp>
+	#include <boost/serialization/split_member.hpp>
+	#include <boost/serialization/string.hpp>
 #endif
 #include <string>
 #include <vector>
@@ -49,6 +51,10 @@ namespace p4p {
  * PID data type.  
  * This data type may be used as an opaque datatype for a PID.  
  * It supports common operators.
+ *
+ * The ISP identifier is interned in a process-wide table, so a PID is
+ * three words and comparing two PIDs only compares strings when their
+ * ISP identifiers differ.
  */
 class p4p_common_cpp_EXPORT PID
 {
@@ -59,16 +65,25 @@ public:
 	 * Construct PID from three parts: ISP identifier, PID index number, and 'external' indicator
 	 */
 	PID(const ISPID& isp = "", unsigned int num = 0, bool external = false)
-		: isp_(isp),
+		: isp_(intern_isp(isp)),
 		  num_(num),
 		  external_(external)
 	{}
 
+	/**
+	 * Construct a PID only if its ISP identifier is already in use in
+	 * this process; returns false otherwise. Such a PID cannot equal any
+	 * PID the process holds, and looking it up leaves the ISP table
+	 * untouched, so use this for PIDs read from untrusted input.
+	 */
+	static bool find(const ISPID& isp, unsigned int num, bool external, PID& result);
+
 	static const PID DEFAULT;  /*!< Default PID mapping to the whole IP address space */
 	static const PID INVALID;  /*!< Invalid PID */
 
 	bool get_external() const		{ return external_; }
-	const ISPID& get_isp() const		{ return isp_; }
+	const ISPID& get_isp() const		{ return get_interned_isp(isp_); }
+	unsigned int get_isp_id() const		{ return isp_; }
 	unsigned int get_num() const		{ return num_; }
 
 	bool is_default() const			{ return *this == DEFAULT; }
@@ -80,7 +95,7 @@ public:
 			return external_ < rhs.external_;
 
 		return (num_ < rhs.num_)
-		    || (num_ == rhs.num_ && isp_ < rhs.isp_);
+		    || (num_ == rhs.num_ && isp_ != rhs.isp_ && get_isp() < rhs.get_isp());
 	}
 
 	bool operator==(const PID& rhs) const
@@ -97,15 +112,28 @@ private:
 #ifdef P4P_CLUSTER
 	friend class boost::serialization::access;
 	template<class Archive>
-	void serialize(Archive& ar, const unsigned int version)
+	void save(Archive& ar, const unsigned int version) const
+	{
+		ar & get_isp();
+		ar & num_;
+		ar & external_;
+	}
+	template<class Archive>
+	void load(Archive& ar, const unsigned int version)
 	{
-		ar & isp_;
+		ISPID isp;
+		ar & isp;
+		isp_ = intern_isp(isp);
 		ar & num_;
 		ar & external_;
 	}
+	BOOST_SERIALIZATION_SPLIT_MEMBER()
 #endif
 
-	ISPID isp_;			/**< ISP Identifier */
+	static unsigned int intern_isp(const ISPID& isp);
+	static const ISPID& get_interned_isp(unsigned int id);
+
+	unsigned int isp_;		/**< Interned ISP Identifier */
 	unsigned int num_;		/**< Number defining the PID within the ISP */
 	bool external_;			/**< Indicator specifying whether the PID is intradomain or interdomain */
 
@@ -114,6 +142,14 @@ private:
 p4p_common_cpp_EXPORT std::ostream& operator<<(std::ostream& os, const PID& rhs);
 p4p_common_cpp_EXPORT std::istream& operator>>(std::istream& is, PID& rhs);
 
+/**
+ * Read a PID in the same format as operator>>, using PID::find() so that
+ * unknown ISP identifiers are not added to the ISP table. On a PID with an
+ * unknown ISP, 'known' is set to false and 'rhs' is left unchanged; the
+ * stream is not failed.
+ */
+p4p_common_cpp_EXPORT std::istream& read_known_pid(std::istream& is, PID& rhs, bool& known);
+
 p4p_common_cpp_EXPORT std::size_t hash_value(const PID& pid);
 
 typedef std::vector<PID> PIDVector;
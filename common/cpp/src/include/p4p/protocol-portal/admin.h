@@ -31,6 +31,7 @@
 #define P4P_PORTALAPI_ADMIN_H
 
 #include <string>
+#include <vector>
 #include <p4p/protocol/protobase.h>
 #include <p4p/protocol-portal/metainfo.h>
 #include <p4p/protocol-portal/admin_exceptions.h>
@@ -107,6 +108,11 @@ public:
 
 	void admin_net_add_link(const NamedNetLink& link) throw (P4PProtocolError);
 	void admin_net_del_link(const std::string& name) throw (P4PProtocolError);
+
+	/* Set link traffic from records in the text or binary format read by
+	 * the server's TrafficIngest. Each link's total is multiplied by
+	 * 'scale'; if 'reset' is set, links without records get no traffic. */
+	void admin_net_load_traffic(std::istream& records, double scale = 1.0, bool reset = false) throw (P4PProtocolError);
 	template <class OutputIterator>
 	void admin_net_list_links(OutputIterator result) throw (P4PProtocolError)
 	{
@@ -158,6 +164,13 @@ public:
 	void admin_view_set_pidlink_pdistance(const std::string& view, const std::string& link, const PDistanceBase& value) throw (P4PProtocolError);
 	PDistanceBase* admin_view_get_pidlink_pdistance(const std::string& view, const std::string& link) throw (P4PProtocolError);
 
+	/* Static routes (used when the view's route_mode is "static") run from
+	 * 'src' along each PID link in 'links' to 'dst'. Routes between the
+	 * same PIDs split traffic in proportion to their weights. */
+	void admin_view_add_static_route(const std::string& view, const std::string& src, const std::string& dst, const std::vector<std::string>& links, double weight = 1.0) throw (P4PProtocolError);
+	void admin_view_del_static_route(const std::string& view, const std::string& src, const std::string& dst, const std::vector<std::string>& links) throw (P4PProtocolError);
+	void admin_view_clear_static_routes(const std::string& view) throw (P4PProtocolError);
+
 	void admin_view_add_pid_prefix(const std::string& view, const std::string& name, const std::string& address, unsigned short len) throw (P4PProtocolError);
 	void admin_view_del_pid_prefix(const std::string& view, const std::string& name, const std::string& address, unsigned short len) throw (P4PProtocolError);
 	void admin_view_clear_pid_prefixes(const std::string& view, const std::string& name) throw (P4PProtocolError);
@@ -175,6 +188,9 @@ private:
 	/* Check that a transaction is in progress */
 	void check_txn() throw (P4PProtocolError);
 
+	/* Query string naming a static route */
+	std::string static_route_query(const std::string& src, const std::string& dst, const std::vector<std::string>& links);
+
 	/* Current token if an admin transaction is in progress */
 	std::string admin_token_;
 };
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef P4P_PORTALAPI_UDP_CODEC_H
+#define P4P_PORTALAPI_UDP_CODEC_H
+
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <p4p/pid.h>
+#include <p4p/ip_addr.h>
+
+namespace p4p {
+namespace protocol {
+namespace portal {
+namespace udp {
+
+/*
+ * Datagram encoding for PID and pDistance lookups over UDP. All integers
+ * are in network byte order. A request carries any number of queries of
+ * a single type; the response answers a prefix of them (as many as fit),
+ * and the client re-sends the remainder. A response is never longer than
+ * its request, so clients pad requests with trailing zero bytes to the
+ * size of response they can accept; the server ignores the padding.
+ * Requests too short to hold a response header are not answered.
+ *
+ * Request:   version(1) type(1) count(2) id(4) view_len(1) view(view_len) queries...
+ * Response:  version(1) type(1) count(2) id(4) status(1) reserved(3) ttl(4) seqno(4) answers...
+ *
+ * GetPIDs query:         family(1: 4 or 6) address(4 or 16)
+ * GetPIDs answer:        PID
+ * GetPDistances query:   PID(src) PID(dst)
+ * GetPDistances answer:  pdistance(4), PDISTANCE_UNAVAILABLE if not defined
+ * PID:                   flags(1: bit 0 = external) isp_len(1) isp(isp_len) num(4)
+ */
+
+const uint8_t VERSION				= 1;
+
+/* Message types (same values as the portal's message types) */
+const uint8_t MSG_ERROR_RSP			= 0x00;
+const uint8_t MSG_GET_PIDS_REQ			= 0x03;
+const uint8_t MSG_GET_PIDS_RSP			= 0x04;
+const uint8_t MSG_GET_PDISTANCES_REQ		= 0x05;
+const uint8_t MSG_GET_PDISTANCES_RSP		= 0x06;
+
+/* Response status */
+const uint8_t STATUS_OK				= 0;
+const uint8_t STATUS_MALFORMED			= 1;	/**< Request could not be parsed */
+const uint8_t STATUS_UNSUPPORTED		= 2;	/**< Unknown version or message type */
+const uint8_t STATUS_DISABLED			= 3;	/**< Message type disabled on this interface */
+const uint8_t STATUS_NO_VIEW			= 4;	/**< View does not exist (or is not yet published) */
+
+const unsigned int REQUEST_HEADER_LEN		= 9;	/**< Not including the view name */
+const unsigned int RESPONSE_HEADER_LEN		= 20;
+
+/** Largest UDP payload */
+const unsigned int MAX_DATAGRAM			= 65507;
+
+/** Datagram size used by the client, chosen to avoid IP fragmentation on Ethernet */
+const unsigned int DEFAULT_DATAGRAM		= 1472;
+
+const uint32_t PDISTANCE_UNAVAILABLE		= 0xffffffff;
+
+/**
+ * Appends to a datagram buffer. Once a value does not fit, the writer
+ * fails and ignores further values until truncated back.
+ */
+class Writer
+{
+public:
+	Writer(char* buf, unsigned int max) : buf_(buf), max_(max), pos_(0), ok_(true) {}
+
+	bool ok() const				{ return ok_; }
+	unsigned int size() const		{ return pos_; }
+
+	/** Drop everything written after position 'pos' and clear any failure */
+	void truncate(unsigned int pos)		{ pos_ = pos; ok_ = true; }
+
+	/** Fill the rest of the buffer with zero bytes */
+	void pad()				{ memset(buf_ + pos_, 0, max_ - pos_); pos_ = max_; }
+
+	bool put_bytes(const void* data, unsigned int len)
+	{
+		if (!ok_ || len > max_ - pos_)
+			return ok_ = false;
+		memcpy(buf_ + pos_, data, len);
+		pos_ += len;
+		return true;
+	}
+
+	bool put_u8(uint8_t v)			{ return put_bytes(&v, 1); }
+	bool put_u16(uint16_t v)		{ v = htons(v); return put_bytes(&v, 2); }
+	bool put_u32(uint32_t v)		{ v = htonl(v); return put_bytes(&v, 4); }
+
+	/** Overwrite a 16-bit value written earlier */
+	void set_u16(unsigned int pos, uint16_t v)
+	{
+		v = htons(v);
+		memcpy(buf_ + pos, &v, 2);
+	}
+
+	bool put_pid(const PID& pid)
+	{
+		const ISPID& isp = pid.get_isp();
+		if (isp.size() > UCHAR_MAX)
+			return ok_ = false;
+		return put_u8(pid.get_external() ? 1 : 0)
+		    && put_u8(isp.size())
+		    && put_bytes(isp.data(), isp.size())
+		    && put_u32(pid.get_num());
+	}
+
+	bool put_addr(const IPPrefix& addr)
+	{
+		if (addr.get_family() == AF_INET)
+			return put_u8(4) && put_bytes(addr.get_address(), sizeof(struct in_addr));
+		if (addr.get_family() == AF_INET6)
+			return put_u8(6) && put_bytes(addr.get_address(), sizeof(struct in6_addr));
+		return ok_ = false;
+	}
+
+private:
+	char* buf_;
+	unsigned int max_;
+	unsigned int pos_;
+	bool ok_;
+};
+
+/**
+ * Reads from a received datagram. Reads past the end fail without
+ * modifying the output.
+ */
+class Reader
+{
+public:
+	Reader(const char* buf, unsigned int len) : buf_(buf), len_(len), pos_(0) {}
+
+	unsigned int remaining() const		{ return len_ - pos_; }
+
+	bool get_bytes(void* data, unsigned int len)
+	{
+		if (len > len_ - pos_)
+			return false;
+		memcpy(data, buf_ + pos_, len);
+		pos_ += len;
+		return true;
+	}
+
+	bool get_u8(uint8_t& v)			{ return get_bytes(&v, 1); }
+	bool get_u16(uint16_t& v)		{ if (!get_bytes(&v, 2)) return false; v = ntohs(v); return true; }
+	bool get_u32(uint32_t& v)		{ if (!get_bytes(&v, 4)) return false; v = ntohl(v); return true; }
+
+	bool get_string(std::string& v, unsigned int len)
+	{
+		if (len > len_ - pos_)
+			return false;
+		v.assign(buf_ + pos_, len);
+		pos_ += len;
+		return true;
+	}
+
+	bool get_pid(PID& pid)
+	{
+		uint8_t flags, isp_len;
+		std::string isp;
+		uint32_t num;
+		if (!get_u8(flags) || !get_u8(isp_len) || !get_string(isp, isp_len) || !get_u32(num))
+			return false;
+		pid = PID(isp, num, flags & 1);
+		return true;
+	}
+
+	/**
+	 * Read a PID without adding its ISP identifier to the process; see
+	 * PID::find(). 'known' is false, and 'pid' unchanged, if the ISP is
+	 * not in use. Returns false only if the PID is malformed.
+	 */
+	bool get_known_pid(PID& pid, bool& known)
+	{
+		uint8_t flags, isp_len;
+		std::string isp;
+		uint32_t num;
+		if (!get_u8(flags) || !get_u8(isp_len) || !get_string(isp, isp_len) || !get_u32(num))
+			return false;
+		known = PID::find(isp, num, flags & 1, pid);
+		return true;
+	}
+
+	/** Returns the address family (AF_INET or AF_INET6), or 0 on failure */
+	int get_addr(void* addr)
+	{
+		uint8_t family;
+		if (!get_u8(family))
+			return 0;
+		if (family == 4)
+			return get_bytes(addr, sizeof(struct in_addr)) ? AF_INET : 0;
+		if (family == 6)
+			return get_bytes(addr, sizeof(struct in6_addr)) ? AF_INET6 : 0;
+		return 0;
+	}
+
+private:
+	const char* buf_;
+	unsigned int len_;
+	unsigned int pos_;
+};
+
+}; // namespace udp
+}; // namespace portal
+}; // namespace protocol
+}; // namespace p4p
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef P4P_PORTALAPI_UDP_H
+#define P4P_PORTALAPI_UDP_H
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <stdint.h>
+#include <p4p/pid.h>
+#include <p4p/ip_addr.h>
+#include <p4p/protocol/exceptions.h>
+#include <p4p/protocol-portal/detail/udp_codec.h>
+#include <p4p/detail/compiler.h>
+
+namespace p4p {
+namespace protocol {
+namespace portal {
+
+/**
+ * Client for the Portal's UDP interface, which answers PID and pDistance
+ * lookups with a single datagram exchange per batch of queries instead of
+ * an HTTP request. Intended for trackers which look up many individual
+ * peers.
+ *
+ * Each call packs as many queries as fit into each datagram, and waits for
+ * each response before sending the next datagram. Lost datagrams are
+ * retransmitted after a timeout. Instances are not thread-safe; use one per
+ * thread.
+ */
+class p4p_common_cpp_EXPORT UDPPortalProtocol
+{
+public:
+	/**
+	 * @param host		Portal hostname or address
+	 * @param port		Port of the Portal's UDP interface
+	 * @param view		View to query
+	 * @param timeout_ms	Time to wait for each response before retransmitting
+	 * @param retries	Number of retransmissions before giving up
+	 */
+	UDPPortalProtocol(const std::string& host, unsigned short port = 6673, const std::string& view = "DEFAULT",
+			  unsigned int timeout_ms = 1000, unsigned int retries = 2) throw (std::runtime_error, P4PProtocolError);
+	~UDPPortalProtocol();
+
+	const std::string& get_host() const { return host_; }
+	unsigned short get_port() const { return port_; }
+
+	/**
+	 * Map IP addresses to PIDs.
+	 *
+	 * @param addrs Addresses to look up
+	 * @param result The PID of each address (in order) is appended to 'result'. Addresses
+	 * 	not covered by the view map to PID::DEFAULT.
+	 * @param ttl Output parameter for the number of seconds the results may be cached. Ignored
+	 * 	if NULL.
+	 */
+	void get_pids(const std::vector<IPPrefix>& addrs, std::vector<PID>& result, unsigned int* ttl = NULL) throw (P4PProtocolError);
+
+	/**
+	 * Look up pDistances between pairs of PIDs.
+	 *
+	 * @param pairs (source, destination) PID pairs to look up
+	 * @param result The pDistance of each pair (in order) is appended to 'result'. Pairs
+	 * 	without a pDistance yield udp::PDISTANCE_UNAVAILABLE.
+	 * @param ttl Output parameter for the number of seconds the results may be cached. Ignored
+	 * 	if NULL.
+	 */
+	void get_pdistances(const PIDLinkVector& pairs, std::vector<uint32_t>& result, unsigned int* ttl = NULL) throw (P4PProtocolError);
+
+private:
+	/* Disallow copy constructor and assignment operator */
+	UDPPortalProtocol(const UDPPortalProtocol& dummy) {}
+	UDPPortalProtocol& operator=(const UDPPortalProtocol& dummy) { return *this; }
+
+	/* Write the request header, returning the position of the query count */
+	unsigned int begin_request(udp::Writer& req, uint8_t type, uint32_t id);
+
+	/* Send a request and wait for its response; returns the response length */
+	unsigned int exchange(const char* req, unsigned int req_len, uint32_t id, char* rsp) throw (P4PProtocolError);
+
+	/* Parse the response header; returns the number of answers */
+	unsigned int read_response_header(udp::Reader& rsp, uint8_t type, unsigned int* ttl) throw (P4PProtocolError);
+
+	std::string host_;
+	unsigned short port_;
+	std::string view_;
+	unsigned int timeout_ms_;
+	unsigned int retries_;
+
+	int sock_;
+	uint32_t next_id_;
+};
+
+}; // namespace portal
+}; // namespace protocol
+}; // namespace p4p
+
+#endif
@@ -30,6 +30,7 @@
 #ifndef P4P_APIBASE_PARSING_H
 #define P4P_APIBASE_PARSING_H
 
+#include <istream>
 #include <map>
 #include <p4p/pid.h>
 #include <p4p/ip_addr.h>
@@ -137,6 +138,17 @@ private:
 	InputIterator cur_, last_;
 };
 
+/* Sends the contents of a stream as-is */
+class p4p_common_cpp_EXPORT RequestStreamWriter : public RequestWriter
+{
+public:
+	RequestStreamWriter(std::istream& is) : is_(is) {}
+	virtual bool produce() throw (P4PProtocolError);
+private:
+	std::istream& is_;
+	std::string block_;	/* Read from the stream but not yet sent */
+};
+
 template <class OutputIterator>
 class p4p_common_cpp_ex_EXPORT ResponseTokenReader : public ResponseReader
 {
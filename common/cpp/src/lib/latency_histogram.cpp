@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "p4p/detail/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace p4p {
+namespace detail {
+
+static const unsigned int SUB_BUCKET_BITS = 6;
+static const unsigned int SUB_BUCKET_HALF = 1 << SUB_BUCKET_BITS;
+static const unsigned int SUB_BUCKET_COUNT = 2 * SUB_BUCKET_HALF;
+static const unsigned int NUM_BUCKETS = (64 - SUB_BUCKET_BITS) * SUB_BUCKET_HALF + SUB_BUCKET_COUNT;
+
+LatencyHistogram::LatencyHistogram()
+	: m_buckets(NUM_BUCKETS, 0),
+	  m_count(0),
+	  m_max(0),
+	  m_sum(0)
+{
+}
+
+unsigned int LatencyHistogram::bucketIndex(unsigned long long value)
+{
+	if (value < SUB_BUCKET_COUNT)
+		return value;
+
+	/* Shift the value down until it lands in the upper half of the
+	 * sub-buckets; the shift selects the power-of-two range. */
+	unsigned int shift = 0;
+	while ((value >> shift) >= SUB_BUCKET_COUNT)
+		++shift;
+
+	return shift * SUB_BUCKET_HALF + (value >> shift);
+}
+
+unsigned long long LatencyHistogram::bucketValue(unsigned int index)
+{
+	if (index < SUB_BUCKET_COUNT)
+		return index;
+
+	unsigned int shift = index / SUB_BUCKET_HALF - 1;
+	unsigned long long sub = index - shift * SUB_BUCKET_HALF;
+
+	/* Report the highest value that maps to this bucket */
+	return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(unsigned long long value)
+{
+	++m_buckets[bucketIndex(value)];
+	++m_count;
+	m_sum += value;
+	if (value > m_max)
+		m_max = value;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& rhs)
+{
+	for (unsigned int i = 0; i < NUM_BUCKETS; ++i)
+		m_buckets[i] += rhs.m_buckets[i];
+	m_count += rhs.m_count;
+	m_sum += rhs.m_sum;
+	if (rhs.m_max > m_max)
+		m_max = rhs.m_max;
+}
+
+double LatencyHistogram::getMean() const
+{
+	if (m_count == 0)
+		return 0;
+
+	return m_sum / m_count;
+}
+
+unsigned long long LatencyHistogram::getPercentile(double pct) const
+{
+	if (m_count == 0)
+		return 0;
+
+	unsigned long long target = (unsigned long long)std::ceil(pct / 100.0 * m_count);
+	if (target == 0)
+		target = 1;
+
+	unsigned long long seen = 0;
+	for (unsigned int i = 0; i < NUM_BUCKETS; ++i)
+	{
+		seen += m_buckets[i];
+		if (seen >= target)
+			return std::min(bucketValue(i), m_max);
+	}
+
+	return m_max;
+}
+
+std::ostream& operator<<(std::ostream& os, const LatencyHistogram& rhs)
+{
+	return os
+		<< "\tCount: "	<< rhs.getCount()
+		<< "\tMean: "	<< rhs.getMean()
+		<< "\tP50: "	<< rhs.getPercentile(50)
+		<< "\tP90: "	<< rhs.getPercentile(90)
+		<< "\tP99: "	<< rhs.getPercentile(99)
+		<< "\tP99.9: "	<< rhs.getPercentile(99.9)
+		<< "\tMax: "	<< rhs.getMax();
+}
+
+};
+};
@@ -30,9 +30,45 @@
 #include "p4p/pid.h"
 
 #include <string.h>
+#include <p4p/detail/intern_table.h>
 
 namespace p4p {
 
+/* ISP identifiers of all PIDs constructed so far. Allocated on first use
+ * and never freed, so that PIDs with static storage duration in any
+ * module can use it. The empty identifier is interned first as id 0. */
+typedef detail::InternTable<ISPID> ISPTable;
+static ISPTable& get_isp_table()
+{
+	static ISPTable* table = new ISPTable("");
+	return *table;
+}
+
+unsigned int PID::intern_isp(const ISPID& isp)
+{
+	/* Default-constructed PIDs are common; skip the lookup */
+	if (isp.empty())
+		return 0;
+	return get_isp_table().intern(isp);
+}
+
+bool PID::find(const ISPID& isp, unsigned int num, bool external, PID& result)
+{
+	unsigned int id = 0;
+	if (!isp.empty() && !get_isp_table().find(isp, id))
+		return false;
+
+	result.isp_ = id;
+	result.num_ = num;
+	result.external_ = external;
+	return true;
+}
+
+const ISPID& PID::get_interned_isp(unsigned int id)
+{
+	return get_isp_table().get(id);
+}
+
 const PID PID::INVALID = PID("invalid.p4p", 0, true);
 const PID PID::DEFAULT = PID("pid.p4p", 0);
 
@@ -47,10 +83,10 @@ std::ostream& operator<<(std::ostream& os, const PID& rhs)
 	return os;
 }
 
-std::istream& operator>>(std::istream& is, PID& rhs)
+/* Parse the parts of a PID; the stream is failed if they are malformed */
+static std::istream& read_pid_parts(std::istream& is, ISPID& isp, unsigned int& num, bool& external)
 {
 	/* First is the PID number */
-	unsigned int num;
 	if (!(is >> num))
 		return is;
 
@@ -66,7 +102,6 @@ std::istream& operator>>(std::istream& is, PID& rhs)
 	if (!is.getline(ext_buf, 2, '.'))
 		return is;
 
-	bool external;
 	if (strcmp("i", ext_buf) == 0)
 		external = false;
 	else if (strcmp("e", ext_buf) == 0)
@@ -78,11 +113,26 @@ std::istream& operator>>(std::istream& is, PID& rhs)
 	}
 
 	/* The rest is the ISP identifier */
+	return is >> isp;
+}
+
+std::istream& operator>>(std::istream& is, PID& rhs)
+{
 	ISPID isp;
-	if (!(is >> isp))
-		return is;
+	unsigned int num;
+	bool external;
+	if (read_pid_parts(is, isp, num, external))
+		rhs = PID(isp, num, external);
+	return is;
+}
 
-	rhs = PID(isp, num, external);
+std::istream& read_known_pid(std::istream& is, PID& rhs, bool& known)
+{
+	ISPID isp;
+	unsigned int num;
+	bool external;
+	if (read_pid_parts(is, isp, num, external))
+		known = PID::find(isp, num, external, rhs);
 	return is;
 }
 
@@ -103,6 +103,13 @@ void AdminPortalProtocol::admin_net_del_link(const std::string& name) throw (P4P
 	make_request("DELETE", "admin/" + admin_token_ + "/net/link/" + url_escape(name));
 }
 
+void AdminPortalProtocol::admin_net_load_traffic(std::istream& records, double scale, bool reset) throw (P4PProtocolError)
+{
+	check_txn();
+	p4p::protocol::detail::RequestStreamWriter writer(records);
+	make_request("PUT", "admin/" + admin_token_ + "/net/traffic?scale=" + p4p::detail::p4p_token_cast<std::string>(scale) + (reset ? "&reset=1" : ""), writer);
+}
+
 void AdminPortalProtocol::admin_view_add(const std::string& name) throw (P4PProtocolError)
 {
 	check_txn();
@@ -228,6 +235,32 @@ PDistanceBase* AdminPortalProtocol::admin_view_get_pidlink_pdistance(const std::
 	}
 }
 
+std::string AdminPortalProtocol::static_route_query(const std::string& src, const std::string& dst, const std::vector<std::string>& links)
+{
+	std::string result = "?src=" + url_escape(src) + "&dst=" + url_escape(dst) + "&links=";
+	for (unsigned int i = 0; i < links.size(); ++i)
+		result += (i > 0 ? "," : "") + url_escape(links[i]);
+	return result;
+}
+
+void AdminPortalProtocol::admin_view_add_static_route(const std::string& view, const std::string& src, const std::string& dst, const std::vector<std::string>& links, double weight) throw (P4PProtocolError)
+{
+	check_txn();
+	make_request("PUT", "admin/" + admin_token_ + '/' + url_escape(view) + "/route" + static_route_query(src, dst, links) + "&w=" + p4p::detail::p4p_token_cast<std::string>(weight));
+}
+
+void AdminPortalProtocol::admin_view_del_static_route(const std::string& view, const std::string& src, const std::string& dst, const std::vector<std::string>& links) throw (P4PProtocolError)
+{
+	check_txn();
+	make_request("DELETE", "admin/" + admin_token_ + '/' + url_escape(view) + "/route" + static_route_query(src, dst, links));
+}
+
+void AdminPortalProtocol::admin_view_clear_static_routes(const std::string& view) throw (P4PProtocolError)
+{
+	check_txn();
+	make_request("DELETE", "admin/" + admin_token_ + '/' + url_escape(view) + "/route");
+}
+
 void AdminPortalProtocol::admin_view_add_pid_prefix(const std::string& view, const std::string& name, const std::string& address, unsigned short len) throw (P4PProtocolError)
 {
 	check_txn();
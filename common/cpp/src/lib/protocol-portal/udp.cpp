@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "p4p/protocol-portal/udp.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <p4p/detail/util.h>
+
+namespace p4p {
+namespace protocol {
+namespace portal {
+
+UDPPortalProtocol::UDPPortalProtocol(const std::string& host, unsigned short port, const std::string& view,
+				     unsigned int timeout_ms, unsigned int retries) throw (std::runtime_error, P4PProtocolError)
+	: host_(host),
+	  port_(port),
+	  view_(view == "DEFAULT" ? "" : view),
+	  timeout_ms_(timeout_ms),
+	  retries_(retries),
+	  sock_(-1)
+{
+	if (view_.size() > UCHAR_MAX)
+		throw std::runtime_error("View name too long: " + view_);
+
+	/* Start from an arbitrary request ID so restarted clients don't match stale responses */
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	next_id_ = tv.tv_sec ^ (tv.tv_usec << 12) ^ getpid();
+
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	struct addrinfo* addrs = NULL;
+	std::string port_str = p4p::detail::p4p_token_cast<std::string>(port);
+	int rc = getaddrinfo(host.c_str(), port_str.c_str(), &hints, &addrs);
+	if (rc != 0)
+		throw P4PProtocolConnectionError(host, port, gai_strerror(rc));
+
+	/* Connect to the first address that works, so only its datagrams are received */
+	for (struct addrinfo* a = addrs; a; a = a->ai_next)
+	{
+		sock_ = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+		if (sock_ < 0)
+			continue;
+		if (connect(sock_, a->ai_addr, a->ai_addrlen) == 0)
+			break;
+		close(sock_);
+		sock_ = -1;
+	}
+	freeaddrinfo(addrs);
+
+	if (sock_ < 0)
+		throw P4PProtocolConnectionError(host, port, strerror(errno));
+}
+
+UDPPortalProtocol::~UDPPortalProtocol()
+{
+	if (sock_ >= 0)
+		close(sock_);
+}
+
+unsigned int UDPPortalProtocol::begin_request(udp::Writer& req, uint8_t type, uint32_t id)
+{
+	req.put_u8(udp::VERSION);
+	req.put_u8(type);
+	unsigned int count_pos = req.size();
+	req.put_u16(0);
+	req.put_u32(id);
+	req.put_u8(view_.size());
+	req.put_bytes(view_.data(), view_.size());
+	return count_pos;
+}
+
+unsigned int UDPPortalProtocol::exchange(const char* req, unsigned int req_len, uint32_t id, char* rsp) throw (P4PProtocolError)
+{
+	for (unsigned int attempt = 0; attempt <= retries_; ++attempt)
+	{
+		if (send(sock_, req, req_len, 0) < 0)
+			throw P4PProtocolConnectionError(host_, port_, strerror(errno));
+
+		struct timeval start, now;
+		gettimeofday(&start, NULL);
+		while (true)
+		{
+			gettimeofday(&now, NULL);
+			long elapsed_ms = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000;
+			if (elapsed_ms >= (long)timeout_ms_)
+				break;
+
+			struct pollfd pfd;
+			pfd.fd = sock_;
+			pfd.events = POLLIN;
+			int rc = poll(&pfd, 1, timeout_ms_ - elapsed_ms);
+			if (rc < 0 && errno == EINTR)
+				continue;
+			if (rc < 0)
+				throw P4PProtocolConnectionError(host_, port_, strerror(errno));
+			if (rc == 0)
+				break;
+
+			ssize_t len = recv(sock_, rsp, udp::MAX_DATAGRAM, 0);
+			if (len < 0)
+			{
+				/* e.g., ICMP port unreachable from an earlier datagram */
+				if (errno == EINTR || errno == ECONNREFUSED)
+					continue;
+				throw P4PProtocolConnectionError(host_, port_, strerror(errno));
+			}
+
+			/* Ignore late responses to earlier (retransmitted) requests */
+			uint32_t rsp_id;
+			udp::Reader r(rsp, len);
+			uint8_t dummy8;
+			uint16_t dummy16;
+			if (r.get_u8(dummy8) && r.get_u8(dummy8) && r.get_u16(dummy16) && r.get_u32(rsp_id) && rsp_id == id)
+				return len;
+		}
+	}
+
+	throw P4PProtocolConnectionError(host_, port_, "no response");
+}
+
+unsigned int UDPPortalProtocol::read_response_header(udp::Reader& rsp, uint8_t type, unsigned int* ttl) throw (P4PProtocolError)
+{
+	uint8_t version, rsp_type, status;
+	uint8_t reserved[3];
+	uint16_t count;
+	uint32_t id, rsp_ttl, seqno;
+	if (!rsp.get_u8(version) || !rsp.get_u8(rsp_type) || !rsp.get_u16(count) || !rsp.get_u32(id)
+	    || !rsp.get_u8(status) || !rsp.get_bytes(reserved, sizeof(reserved))
+	    || !rsp.get_u32(rsp_ttl) || !rsp.get_u32(seqno))
+		throw P4PProtocolParseError("truncated UDP response header");
+
+	if (version != udp::VERSION)
+		throw P4PProtocolParseError("unsupported UDP response version " + p4p::detail::p4p_token_cast<std::string>((unsigned int)version));
+	if (status != udp::STATUS_OK)
+		throw P4PProtocolError("UDP request failed with status " + p4p::detail::p4p_token_cast<std::string>((unsigned int)status));
+	if (rsp_type != type)
+		throw P4PProtocolParseError("unexpected UDP response type " + p4p::detail::p4p_token_cast<std::string>((unsigned int)rsp_type));
+
+	if (ttl)
+		*ttl = rsp_ttl;
+	return count;
+}
+
+void UDPPortalProtocol::get_pids(const std::vector<IPPrefix>& addrs, std::vector<PID>& result, unsigned int* ttl) throw (P4PProtocolError)
+{
+	std::vector<char> req_buf(udp::DEFAULT_DATAGRAM);
+	std::vector<char> rsp_buf(udp::MAX_DATAGRAM);
+
+	unsigned int pos = 0;
+	while (pos < addrs.size())
+	{
+		uint32_t id = next_id_++;
+		udp::Writer req(&req_buf[0], req_buf.size());
+		unsigned int count_pos = begin_request(req, udp::MSG_GET_PIDS_REQ, id);
+
+		unsigned int count = 0;
+		while (pos + count < addrs.size() && count < USHRT_MAX)
+		{
+			unsigned int mark = req.size();
+			if (!req.put_addr(addrs[pos + count]))
+			{
+				req.truncate(mark);
+				break;
+			}
+			++count;
+		}
+		if (count == 0)
+			throw P4PProtocolError("unsupported address family");
+		req.set_u16(count_pos, count);
+
+		/* Responses are no longer than requests */
+		req.pad();
+
+		udp::Reader rsp(&rsp_buf[0], exchange(&req_buf[0], req.size(), id, &rsp_buf[0]));
+		unsigned int answered = read_response_header(rsp, udp::MSG_GET_PIDS_RSP, ttl);
+		if (answered == 0 || answered > count)
+			throw P4PProtocolParseError("invalid number of answers in UDP response");
+
+		for (unsigned int i = 0; i < answered; ++i)
+		{
+			PID pid;
+			if (!rsp.get_pid(pid))
+				throw P4PProtocolParseError("truncated UDP response");
+			result.push_back(pid);
+		}
+		pos += answered;
+	}
+}
+
+void UDPPortalProtocol::get_pdistances(const PIDLinkVector& pairs, std::vector<uint32_t>& result, unsigned int* ttl) throw (P4PProtocolError)
+{
+	std::vector<char> req_buf(udp::DEFAULT_DATAGRAM);
+	std::vector<char> rsp_buf(udp::MAX_DATAGRAM);
+
+	unsigned int pos = 0;
+	while (pos < pairs.size())
+	{
+		uint32_t id = next_id_++;
+		udp::Writer req(&req_buf[0], req_buf.size());
+		unsigned int count_pos = begin_request(req, udp::MSG_GET_PDISTANCES_REQ, id);
+
+		unsigned int count = 0;
+		while (pos + count < pairs.size() && count < USHRT_MAX)
+		{
+			unsigned int mark = req.size();
+			if (!req.put_pid(pairs[pos + count].first) || !req.put_pid(pairs[pos + count].second))
+			{
+				req.truncate(mark);
+				break;
+			}
+			++count;
+		}
+		if (count == 0)
+			throw P4PProtocolError("PID too long for a UDP request");
+		req.set_u16(count_pos, count);
+
+		/* Responses are no longer than requests */
+		req.pad();
+
+		udp::Reader rsp(&rsp_buf[0], exchange(&req_buf[0], req.size(), id, &rsp_buf[0]));
+		unsigned int answered = read_response_header(rsp, udp::MSG_GET_PDISTANCES_RSP, ttl);
+		if (answered == 0 || answered > count)
+			throw P4PProtocolParseError("invalid number of answers in UDP response");
+
+		for (unsigned int i = 0; i < answered; ++i)
+		{
+			uint32_t pdistance;
+			if (!rsp.get_u32(pdistance))
+				throw P4PProtocolParseError("truncated UDP response");
+			result.push_back(pdistance);
+		}
+		pos += answered;
+	}
+}
+
+}; // namespace portal
+}; // namespace protocol
+}; // namespace p4p
@@ -320,6 +320,27 @@ void RequestWriter::write_checkpoint()
 	buffer_mark_ = buffer_pos_;
 }
 
+bool RequestStreamWriter::produce() throw (P4PProtocolError)
+{
+	/* Blocks are small enough to fit in any request chunk */
+	char buf[1024];
+	while (true)
+	{
+		if (block_.empty())
+		{
+			is_.read(buf, sizeof(buf));
+			if (is_.gcount() == 0)
+				return true;
+			block_.assign(buf, is_.gcount());
+		}
+
+		if (!write(block_))
+			return false;
+		write_checkpoint();
+		block_.clear();
+	}
+}
+
 };
 };
 };
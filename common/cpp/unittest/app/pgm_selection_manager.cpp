@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Unit Test: PGMSelectionManager
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "p4p/isp_manager.h"
+#include "p4p/app/pgm_selection_manager.h"
+#include "p4p/detail/temp_file_stream.h"
+
+using namespace p4p;
+using namespace p4p::app;
+using namespace p4p::detail;
+
+/* ISP read from files, with no pDistances so guidance is never requested */
+static ISP* make_isp(TempFileStream& pidmap_file, TempFileStream& pdist_file)
+{
+	pidmap_file << "0.i.isp.net 1 128.36.0.0/16" << std::endl;
+	pidmap_file << "100.e.isp.net 1 0.0.0.0/0" << std::endl;
+	pidmap_file.flush();
+	pdist_file.flush();
+
+	ISP* isp = new ISP(pidmap_file.getFilename(), pdist_file.getFilename());
+	BOOST_REQUIRE_EQUAL(0, isp->loadP4PInfo());
+	return isp;
+}
+
+BOOST_AUTO_TEST_CASE ( pgm_next_compute_time )
+{
+	TempFileStream pidmap_file, pdist_file;
+	ISPManager isp_mgr;
+	ISP* isp = isp_mgr.addISP("isp", make_isp(pidmap_file, pdist_file));
+	BOOST_REQUIRE(isp);
+
+	TempFileStream other_pidmap_file, other_pdist_file;
+	ISP* other_isp = make_isp(other_pidmap_file, other_pdist_file);
+
+	PGMSelectionManager selection_mgr(&isp_mgr);
+
+	/* No guidance yet, and an ISP the manager does not maintain */
+	BOOST_CHECK_EQUAL(selection_mgr.getNextComputeTime(isp), PGMSelectionManager::TIME_INVALID);
+	BOOST_CHECK_EQUAL(selection_mgr.getNextComputeTime(other_isp), PGMSelectionManager::TIME_INVALID);
+
+	/* Guidance exists but has not been computed */
+	PeeringGuidanceMatrixOptions options = PeeringGuidanceMatrixOptions::FilesharingGeneric();
+	selection_mgr.setDefaultOptions(options);
+	BOOST_REQUIRE(selection_mgr.initGuidance("127.0.0.1", 1));
+	BOOST_CHECK_EQUAL(selection_mgr.getNextComputeTime(isp), 0);
+	BOOST_CHECK_EQUAL(selection_mgr.getNextComputeTime(other_isp), PGMSelectionManager::TIME_INVALID);
+
+	delete other_isp;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/*
+ * Unit Test: Intern table
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include "p4p/detail/intern_table.h"
+
+using namespace p4p;
+using namespace p4p::detail;
+
+BOOST_AUTO_TEST_CASE ( intern_empty )
+{
+	InternTable<std::string> t;
+	unsigned int id;
+	BOOST_CHECK_EQUAL(t.size(), 0U);
+	BOOST_CHECK(!t.find("a", id));
+}
+
+BOOST_AUTO_TEST_CASE ( intern_first_value )
+{
+	InternTable<std::string> t("");
+	unsigned int id = 1;
+	BOOST_CHECK_EQUAL(t.size(), 1U);
+	BOOST_CHECK(t.find("", id));
+	BOOST_CHECK_EQUAL(id, 0U);
+}
+
+BOOST_AUTO_TEST_CASE ( intern_dense_ids )
+{
+	InternTable<std::string> t;
+	BOOST_CHECK_EQUAL(t.intern("b"), 0U);
+	BOOST_CHECK_EQUAL(t.intern("a"), 1U);
+	BOOST_CHECK_EQUAL(t.intern("b"), 0U);
+	BOOST_CHECK_EQUAL(t.intern("c"), 2U);
+	BOOST_CHECK_EQUAL(t.size(), 3U);
+	BOOST_CHECK_EQUAL(t.get(0), "b");
+	BOOST_CHECK_EQUAL(t.get(1), "a");
+	BOOST_CHECK_EQUAL(t.get(2), "c");
+}
+
+BOOST_AUTO_TEST_CASE ( intern_across_chunks )
+{
+	InternTable<unsigned int> t;
+	const unsigned int n = 3 * InternTable<unsigned int>::CHUNK_SIZE + 7;
+	for (unsigned int i = 0; i < n; ++i)
+		BOOST_CHECK_EQUAL(t.intern(i * 3), i);
+
+	/* References stay valid as the table grows */
+	const unsigned int& first = t.get(0);
+	t.intern(n * 3);
+	BOOST_CHECK_EQUAL(&first, &t.get(0));
+
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		unsigned int id;
+		BOOST_CHECK(t.find(i * 3, id));
+		BOOST_CHECK_EQUAL(id, i);
+		BOOST_CHECK_EQUAL(t.get(i), i * 3);
+	}
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+
+/*
+ * Unit Test: Latency histogram
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "p4p/detail/latency_histogram.h"
+
+using namespace p4p;
+using namespace p4p::detail;
+
+BOOST_AUTO_TEST_CASE ( latency_empty )
+{
+	LatencyHistogram h;
+	BOOST_CHECK_EQUAL(h.getCount(), 0ULL);
+	BOOST_CHECK_EQUAL(h.getMax(), 0ULL);
+	BOOST_CHECK_EQUAL(h.getMean(), 0.0);
+	BOOST_CHECK_EQUAL(h.getPercentile(50), 0ULL);
+}
+
+BOOST_AUTO_TEST_CASE ( latency_exact_small_values )
+{
+	LatencyHistogram h;
+	for (unsigned long long i = 1; i <= 100; ++i)
+		h.record(i);
+	BOOST_CHECK_EQUAL(h.getCount(), 100ULL);
+	BOOST_CHECK_EQUAL(h.getMax(), 100ULL);
+	BOOST_CHECK_CLOSE(h.getMean(), 50.5, 1e-9);
+	BOOST_CHECK_EQUAL(h.getPercentile(50), 50ULL);
+	BOOST_CHECK_EQUAL(h.getPercentile(99), 99ULL);
+	BOOST_CHECK_EQUAL(h.getPercentile(100), 100ULL);
+}
+
+BOOST_AUTO_TEST_CASE ( latency_relative_error )
+{
+	const unsigned long long values[] = { 129, 1000, 65537, 1000000, 123456789, 1ULL << 40 };
+	for (unsigned int i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+	{
+		LatencyHistogram h;
+		h.record(values[i]);
+		h.record(values[i] * 2);
+		unsigned long long p = h.getPercentile(50);
+		/* Reported as the upper end of the value's bucket */
+		BOOST_CHECK(p >= values[i]);
+		BOOST_CHECK(p <= values[i] + values[i] / 64);
+	}
+}
+
+BOOST_AUTO_TEST_CASE ( latency_merge )
+{
+	LatencyHistogram a, b;
+	for (unsigned long long i = 0; i < 10; ++i)
+	{
+		a.record(i);
+		b.record(1000 + i);
+	}
+	a.merge(b);
+	BOOST_CHECK_EQUAL(a.getCount(), 20ULL);
+	BOOST_CHECK_EQUAL(a.getMax(), 1009ULL);
+	BOOST_CHECK_EQUAL(a.getPercentile(50), 9ULL);
+	BOOST_CHECK(a.getPercentile(100) >= 1000ULL);
+}
@@ -33,6 +33,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <sstream>
+
 #include "p4p/detail/util.h"
 #include "p4p/pid.h"
 
@@ -94,3 +96,60 @@ BOOST_AUTO_TEST_CASE ( pid_external_string_identity )
 {
 	BOOST_CHECK_EQUAL(p4p_token_cast<std::string>(p4p_token_cast<PID>("4.e.myisp.net")), "4.e.myisp.net");
 }
+
+BOOST_AUTO_TEST_CASE ( pid_isp_interned )
+{
+	BOOST_CHECK_EQUAL(PID("myisp", 4).get_isp_id(), PID("myisp", 6, true).get_isp_id());
+	BOOST_CHECK(PID("myisp", 4).get_isp_id() != PID("otherisp", 4).get_isp_id());
+	BOOST_CHECK_EQUAL(PID().get_isp(), "");
+}
+
+BOOST_AUTO_TEST_CASE ( pid_order_by_isp )
+{
+	/* Ordering follows the ISP identifier, not the order of interning */
+	PID b("zz.isp", 4);
+	PID a("aa.isp", 4);
+	BOOST_CHECK(a < b);
+	BOOST_CHECK(!(b < a));
+	BOOST_CHECK(PID("zz.isp", 3) < a);
+	BOOST_CHECK(a < PID("aa.isp", 1, true));
+}
+
+BOOST_AUTO_TEST_CASE ( pid_find_known_isp )
+{
+	PID known("known.isp", 4, true);
+	PID result;
+	BOOST_CHECK(PID::find("known.isp", 4, true, result));
+	BOOST_CHECK_EQUAL(result, known);
+	BOOST_CHECK(PID::find("", 0, false, result));
+	BOOST_CHECK_EQUAL(result, PID());
+}
+
+BOOST_AUTO_TEST_CASE ( pid_find_unknown_isp )
+{
+	PID result("known.isp", 4);
+	BOOST_CHECK(!PID::find("unknown.find.isp", 4, false, result));
+	BOOST_CHECK_EQUAL(result, PID("known.isp", 4));
+
+	/* Looking it up did not add it */
+	BOOST_CHECK(!PID::find("unknown.find.isp", 4, false, result));
+}
+
+BOOST_AUTO_TEST_CASE ( pid_read_known )
+{
+	PID("known.isp", 4);
+
+	std::istringstream is("4.e.known.isp 5.i.unknown.read.isp 6.x.known.isp");
+	PID result;
+	bool known = false;
+	BOOST_CHECK(read_known_pid(is, result, known));
+	BOOST_CHECK(known);
+	BOOST_CHECK_EQUAL(result, PID("known.isp", 4, true));
+
+	BOOST_CHECK(read_known_pid(is, result, known));
+	BOOST_CHECK(!known);
+	BOOST_CHECK(!PID::find("unknown.read.isp", 5, false, result));
+
+	/* Malformed PIDs still fail the stream */
+	BOOST_CHECK(!read_known_pid(is, result, known));
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/perl -w
+
+use strict;
+use warnings;
+
+use File::Basename;
+use lib dirname($0);
+
+use Generate;
+
+# Usage:
+#   <scriptname> NumChannels NumPeersTotal NumSelectPeers JoinsPerSec MeanLifetimeSec [ChannelOptionsCode]
+#
+# Generate a binary trace (see src/replay.h) for the emulator's replay
+# mode (-t). Channels are all created at time 0. Peers arrive as a
+# Poisson process at JoinsPerSec, join a random channel, immediately
+# select peers, and leave after an exponentially-distributed lifetime.
+# ChannelOptionsCode is one of the TraceChannelOptions values (default
+# 0, native). Peer addresses come from the Portal servers listed in
+# PORTAL_SERVERS if set, and are random otherwise.
+
+my $NUM_CHANNELS = shift(@ARGV);
+defined($NUM_CHANNELS) || die("Invalid argument");
+
+my $NUM_PEERS_TOTAL = shift(@ARGV);
+defined($NUM_PEERS_TOTAL) || die("invalid argument");
+
+my $NUM_SELECT_PEERS = shift(@ARGV);
+defined($NUM_SELECT_PEERS) || die("invalid argument");
+
+my $JOINS_PER_SEC = shift(@ARGV);
+defined($JOINS_PER_SEC) && $JOINS_PER_SEC > 0 || die("invalid argument");
+
+my $MEAN_LIFETIME_SEC = shift(@ARGV);
+defined($MEAN_LIFETIME_SEC) || die("invalid argument");
+
+my $CHANNEL_OPTIONS = shift(@ARGV) || 0;
+
+# Event codes (TraceEvent)
+my $ADD_CHANNEL = 0;
+my $PEER_JOIN = 2;
+my $PEER_LEAVE = 3;
+my $SELECT_PEERS = 4;
+
+my %pidmaps;
+if (defined($ENV{"PORTAL_SERVERS"})) {
+	my @portals = split(/\s+/, $ENV{"PORTAL_SERVERS"});
+	%pidmaps = getPIDMaps(@portals);
+}
+
+sub randIP {
+	return getRandP4PClientIP(%pidmaps) if (%pidmaps);
+	return join('.', map { int(rand(256)) } (1..4));
+}
+
+sub expRand {
+	my ($mean) = @_;
+	return -$mean * log(1 - rand());
+}
+
+# TraceRecord: time_usec event channel peer addr port max_peers options param1 param2
+sub record {
+	my ($time, $event, $channel, $peer, $ip, $port, $max_peers) = @_;
+	my $addr = defined($ip) ? pack('C4', split('\.', $ip)) : "\0\0\0\0";
+	return pack('QLLLa4SSLff', int($time), $event, $channel, $peer, $addr, $port || 0, $max_peers || 0,
+		$event == $ADD_CHANNEL ? $CHANNEL_OPTIONS : 0, 0, 0);
+}
+
+# Collect [time, record] pairs; leaves are interleaved with later joins
+my @events;
+for (my $c = 0; $c < $NUM_CHANNELS; ++$c) {
+	push(@events, [0, record(0, $ADD_CHANNEL, $c, 0)]);
+}
+
+my $t = 0;
+for (my $p = 0; $p < $NUM_PEERS_TOTAL; ++$p) {
+	$t += expRand(1000000 / $JOINS_PER_SEC);
+	my $c = int(rand($NUM_CHANNELS));
+	my $ip = randIP();
+	defined($ip) || die("Failed to get random IP address");
+
+	push(@events, [$t, record($t, $PEER_JOIN, $c, $p, $ip, 1234)]);
+	push(@events, [$t, record($t, $SELECT_PEERS, $c, $p, undef, 0, $NUM_SELECT_PEERS)]);
+
+	my $leave = $t + expRand(1000000 * $MEAN_LIFETIME_SEC);
+	push(@events, [$leave, record($leave, $PEER_LEAVE, $c, $p)]);
+}
+
+# Sort is stable in Perl, so a join stays ahead of its own query
+use sort 'stable';
+@events = sort { $a->[0] <=> $b->[0] } @events;
+
+# TraceHeader: magic version reserved num_records
+binmode(STDOUT);
+print pack('a8LLQ', 'P4PTRACE', 1, 0, scalar(@events));
+foreach my $event (@events) {
+	print $event->[1];
+}
@@ -40,6 +40,8 @@
  * 
  * The emulator reads from standard input the events it should
  * execute, such as adding and removing channels and peers.
+ * Alternatively, it replays a binary trace (see replay.h) on
+ * multiple threads and reports per-event latency percentiles.
  */
 
 #include <iostream>			/* C++ includes */
@@ -50,6 +52,7 @@
 
 #include "meminfo.h"			/* Memory usage information */
 #include "options.h"			/* Options parsing */
+#include "replay.h"			/* Binary trace replay */
 
 #ifndef NO_P4P
 	#include <p4p/p4p.h>		/* Common P4P includes */
@@ -83,7 +86,19 @@ const char* USAGE =			/* String describing program usage */
 	"  -v                                                                       \n"
 	"      Print detailed information about emulation, such as details about    \n"
 	"      completed events (channel added, peer joined, peer selection         \n"
-	"      results, etc).                                                       \n";
+	"      results, etc).                                                       \n"
+	"                                                                           \n"
+	"  -t TRACE_FILE                                                            \n"
+	"      Replay events from a binary trace file instead of reading text       \n"
+	"      events from standard input, and print latency percentiles per event  \n"
+	"      type together with tracker and memory growth.                        \n"
+	"                                                                           \n"
+	"  -n THREADS                                                               \n"
+	"      Number of replay threads; channels are partitioned across them.      \n"
+	"                                                                           \n"
+	"  -x SPEEDUP                                                               \n"
+	"      Replay trace timestamps SPEEDUP times faster (default 1). A value of \n"
+	"      0 issues events back-to-back and measures service time only.         \n";
 
 /**
  * Simple function to check whether an input operation was
@@ -152,6 +167,39 @@ int main(int argc, const char** argv)
 #endif
 
 
+		/* Replay a binary trace with one tracker per replay thread */
+		if (!OPTION_TRACE_FILE.empty())
+		{
+			std::vector<Tracker*> trackers;
+			for (unsigned int i = 0; i < OPTION_REPLAY_THREADS; ++i)
+#ifndef NO_P4P
+				trackers.push_back(new Tracker(isp_mgr, &update_mgr, pidmap_filenames, OPTION_INTRA_PID_PCT, OPTION_INTRA_ISP_PCT));
+#else
+				trackers.push_back(new Tracker());
+#endif
+
+			int status = 0;
+			try
+			{
+				replay_trace(OPTION_TRACE_FILE, trackers, OPTION_REPLAY_SPEEDUP);
+			}
+			catch (std::exception& e)
+			{
+				std::cerr << "Exception Raised: " << e.what() << std::endl;
+				status = 1;
+			}
+
+			for (unsigned int i = 0; i < trackers.size(); ++i)
+				delete trackers[i];
+
+#ifndef NO_P4P
+			update_mgr.stop();
+			if (pthread_join(update_mgr_thd, NULL) != 0)
+				throw std::runtime_error("Failed to join update manager thread");
+#endif
+			return status;
+		}
+
 		/* Create tracker */
 #ifndef NO_P4P
 		Tracker tracker(isp_mgr, &update_mgr, pidmap_filenames, OPTION_INTRA_PID_PCT, OPTION_INTRA_ISP_PCT);
@@ -37,12 +37,16 @@ unsigned short				OPTION_OPTENGINE_PORT = 0;
 bool					OPTION_VERBOSE = false;
 double					OPTION_INTRA_PID_PCT = 0.7;
 double					OPTION_INTRA_ISP_PCT = 0.9;
+std::string				OPTION_TRACE_FILE;
+unsigned int				OPTION_REPLAY_THREADS = 1;
+double					OPTION_REPLAY_SPEEDUP = 1.0;
 
 /**
  * Prototypes for argument-parsing helpers
  */
 std::string	next_arg_string(int& argc, const char**& argv);
 unsigned short	next_arg_ushort(int& argc, const char**& argv);
+unsigned int	next_arg_uint(int& argc, const char**& argv);
 double		next_arg_double(int& argc, const char**& argv);
 void		print_usage();
 
@@ -81,6 +85,22 @@ void parse_command_line(int argc, const char** argv)
 		{
 			OPTION_VERBOSE = true;
 		}
+		else if (arg == "-t")
+		{
+			OPTION_TRACE_FILE = next_arg_string(argc, argv);
+		}
+		else if (arg == "-n")
+		{
+			OPTION_REPLAY_THREADS = next_arg_uint(argc, argv);
+			if (OPTION_REPLAY_THREADS == 0)
+				print_usage();
+		}
+		else if (arg == "-x")
+		{
+			OPTION_REPLAY_SPEEDUP = next_arg_double(argc, argv);
+			if (OPTION_REPLAY_SPEEDUP < 0)
+				print_usage();
+		}
 		else
 			print_usage();
 	}
@@ -115,6 +135,20 @@ unsigned short next_arg_ushort(int& argc, const char**& argv)
 	}
 }
 
+unsigned int next_arg_uint(int& argc, const char**& argv)
+{
+	std::string arg = next_arg_string(argc, argv);
+	try
+	{
+		return p4p::detail::p4p_token_cast<unsigned int>(arg);
+	}
+	catch (std::exception& e)
+	{
+		print_usage();
+		return 0;	/* Avoid compiler warnings */
+	}
+}
+
 double next_arg_double(int& argc, const char**& argv)
 {
 	std::string arg = next_arg_string(argc, argv);
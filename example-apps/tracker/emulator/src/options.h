@@ -53,6 +53,10 @@ extern bool					OPTION_VERBOSE;				/* True if detailed messages should be printe
 extern double					OPTION_INTRA_PID_PCT;
 extern double					OPTION_INTRA_ISP_PCT;
 
+extern std::string				OPTION_TRACE_FILE;			/* Binary trace to replay instead of reading events from stdin */
+extern unsigned int				OPTION_REPLAY_THREADS;			/* Number of replay threads */
+extern double					OPTION_REPLAY_SPEEDUP;			/* Trace time divisor; 0 replays as fast as possible */
+
 /* Function for parsing command-line options to fill in
  * global variables listed above. */
 void parse_command_line(int argc, const char** argv);
@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "replay.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <p4p/detail/latency_histogram.h>
+
+#include "meminfo.h"
+#include "options.h"
+
+using p4p::detail::LatencyHistogram;
+
+static const char* EVENT_NAMES[TRACE_NUM_EVENTS] = {
+	"add_channel",
+	"delete_channel",
+	"peer_join",
+	"peer_leave",
+	"select_peers",
+	"peer_update_stats",
+};
+
+/**
+ * Read-only memory mapping of a trace file. The records are read
+ * directly out of the mapping by all replay threads.
+ */
+class MappedTrace
+{
+public:
+	MappedTrace(const std::string& filename)
+		: m_data(NULL),
+		  m_size(0)
+	{
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error("Failed to open trace file: " + filename);
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(TraceHeader))
+		{
+			close(fd);
+			throw std::runtime_error("Invalid trace file: " + filename);
+		}
+
+		m_size = st.st_size;
+		m_data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (m_data == MAP_FAILED)
+		{
+			m_data = NULL;
+			throw std::runtime_error("Failed to map trace file: " + filename);
+		}
+		madvise(m_data, m_size, MADV_SEQUENTIAL);
+
+		const TraceHeader* hdr = getHeader();
+		if (memcmp(hdr->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0
+			|| hdr->version != TRACE_VERSION
+			|| hdr->num_records > (m_size - sizeof(TraceHeader)) / sizeof(TraceRecord))
+		{
+			munmap(m_data, m_size);
+			m_data = NULL;
+			throw std::runtime_error("Invalid trace file: " + filename);
+		}
+	}
+
+	~MappedTrace()
+	{
+		if (m_data)
+			munmap(m_data, m_size);
+	}
+
+	const TraceHeader* getHeader() const		{ return (const TraceHeader*)m_data; }
+	const TraceRecord* getRecords() const		{ return (const TraceRecord*)(getHeader() + 1); }
+	uint64_t getNumRecords() const			{ return getHeader()->num_records; }
+
+private:
+	MappedTrace(const MappedTrace&);
+	MappedTrace& operator=(const MappedTrace&);
+
+	void* m_data;
+	size_t m_size;
+};
+
+/* State for a single replay thread */
+struct ReplayContext
+{
+	const TraceRecord* records;
+	uint64_t num_records;
+	unsigned int index;
+	unsigned int num_threads;
+	Tracker* tracker;
+	double speedup;
+	unsigned long long start_usec;
+
+	LatencyHistogram latency[TRACE_NUM_EVENTS];
+	unsigned long long failures[TRACE_NUM_EVENTS];
+	std::string error;
+};
+
+static std::string make_id(char prefix, uint32_t n)
+{
+	char buf[16];
+	snprintf(buf, sizeof(buf), "%c%u", prefix, n);
+	return buf;
+}
+
+static bool add_channel(Tracker& tracker, const TraceRecord& rec, const std::string& channelid)
+{
+	switch (rec.options)
+	{
+	case TRACE_NATIVE:
+		return tracker.createChannel(channelid);
+#ifndef NO_P4P
+	case TRACE_LOCATION_ONLY:
+		return tracker.createChannel(channelid,
+				PeeringGuidanceMatrixOptions::LocationOnly(rec.param1, rec.param2),
+				OPTION_OPTENGINE_ADDR, OPTION_OPTENGINE_PORT);
+	case TRACE_FILESHARING_GENERIC:
+		return tracker.createChannel(channelid,
+				PeeringGuidanceMatrixOptions::FilesharingGeneric(),
+				OPTION_OPTENGINE_ADDR, OPTION_OPTENGINE_PORT);
+	case TRACE_FILESHARING_SWARM_DEPENDENT:
+		return tracker.createChannel(channelid,
+				PeeringGuidanceMatrixOptions::FilesharingSwarmDependent(),
+				OPTION_OPTENGINE_ADDR, OPTION_OPTENGINE_PORT);
+	case TRACE_STREAMING_SWARM_DEPENDENT:
+		return tracker.createChannel(channelid,
+				PeeringGuidanceMatrixOptions::StreamingSwarmDependent(rec.param1),
+				OPTION_OPTENGINE_ADDR, OPTION_OPTENGINE_PORT);
+#endif
+	default:
+		return false;
+	}
+}
+
+static bool replay_event(Tracker& tracker, const TraceRecord& rec, const std::string& channelid, const std::string& peerid, std::vector<Peer*>& selected_peers)
+{
+	switch (rec.event)
+	{
+	case TRACE_ADD_CHANNEL:
+		return add_channel(tracker, rec, channelid);
+	case TRACE_DELETE_CHANNEL:
+		return tracker.removeChannel(channelid);
+	case TRACE_PEER_JOIN:
+		{
+			in_addr addr;
+			addr.s_addr = rec.addr;
+			return tracker.peerJoin(peerid, channelid, addr, rec.port);
+		}
+	case TRACE_PEER_LEAVE:
+		return tracker.peerLeave(peerid, channelid);
+	case TRACE_SELECT_PEERS:
+		selected_peers.clear();
+		return tracker.peerQuery(peerid, channelid, rec.max_peers, selected_peers);
+	case TRACE_PEER_UPDATE_STATS:
+		return tracker.peerReport(peerid, channelid, rec.max_peers != 0, rec.param1, rec.param2);
+	default:
+		return false;
+	}
+}
+
+static void replay_records(ReplayContext& ctx)
+{
+	std::vector<Peer*> selected_peers;
+	for (uint64_t i = 0; i < ctx.num_records; ++i)
+	{
+		const TraceRecord& rec = ctx.records[i];
+		if (rec.channel % ctx.num_threads != ctx.index || rec.event >= TRACE_NUM_EVENTS)
+			continue;
+
+		/* Names are built before the clock starts so they are not
+		 * charged to the operation */
+		std::string channelid = make_id('C', rec.channel);
+		std::string peerid = make_id('P', rec.peer);
+
+		/* Wait for the scheduled time. Sleep rather than spin, so
+		 * replay threads don't compete with each other for CPU. */
+		unsigned long long now = GetCurrentTimeMicrosec();
+		unsigned long long due = now;
+		if (ctx.speedup > 0)
+		{
+			due = ctx.start_usec + (unsigned long long)(rec.time_usec / ctx.speedup);
+			while (now < due)
+			{
+				usleep(due - now);
+				now = GetCurrentTimeMicrosec();
+			}
+		}
+
+		bool result = replay_event(*ctx.tracker, rec, channelid, peerid, selected_peers);
+		ctx.latency[rec.event].record(GetCurrentTimeMicrosec() - due);
+		if (!result)
+			++ctx.failures[rec.event];
+	}
+}
+
+static void* replay_thread(void* arg)
+{
+	ReplayContext* ctx = (ReplayContext*)arg;
+	try
+	{
+		replay_records(*ctx);
+	}
+	catch (std::exception& e)
+	{
+		ctx->error = e.what();
+	}
+	return NULL;
+}
+
+void replay_trace(const std::string& filename, const std::vector<Tracker*>& trackers, double speedup)
+{
+	MappedTrace trace(filename);
+
+	/* Snapshot of stats before replay */
+	MemInfo meminfo_start = GetCurrentMemInfo();
+	TrackerInfo tracker_start;
+	memset(&tracker_start, 0, sizeof(tracker_start));
+	for (unsigned int i = 0; i < trackers.size(); ++i)
+		tracker_start += trackers[i]->getInfo();
+
+	/* All threads share the same time origin; leave them a moment to start */
+	unsigned long long start_usec = GetCurrentTimeMicrosec() + 10000;
+
+	std::vector<ReplayContext> contexts(trackers.size());
+	std::vector<pthread_t> threads(trackers.size());
+	for (unsigned int i = 0; i < trackers.size(); ++i)
+	{
+		ReplayContext& ctx = contexts[i];
+		ctx.records = trace.getRecords();
+		ctx.num_records = trace.getNumRecords();
+		ctx.index = i;
+		ctx.num_threads = trackers.size();
+		ctx.tracker = trackers[i];
+		ctx.speedup = speedup;
+		ctx.start_usec = start_usec;
+		memset(ctx.failures, 0, sizeof(ctx.failures));
+	}
+
+	unsigned int num_started = 0;
+	for (; num_started < trackers.size(); ++num_started)
+	{
+		if (pthread_create(&threads[num_started], NULL, replay_thread, &contexts[num_started]) != 0)
+			break;
+	}
+	for (unsigned int i = 0; i < num_started; ++i)
+		pthread_join(threads[i], NULL);
+	if (num_started < trackers.size())
+		throw std::runtime_error("Failed to create replay thread");
+
+	unsigned long long elapsed = GetCurrentTimeMicrosec() - start_usec;
+
+	/* Combine results from all threads */
+	LatencyHistogram latency[TRACE_NUM_EVENTS];
+	unsigned long long failures[TRACE_NUM_EVENTS];
+	memset(failures, 0, sizeof(failures));
+	unsigned long long num_events = 0;
+	for (unsigned int i = 0; i < contexts.size(); ++i)
+	{
+		if (!contexts[i].error.empty())
+			throw std::runtime_error("Replay thread failed: " + contexts[i].error);
+
+		for (unsigned int e = 0; e < TRACE_NUM_EVENTS; ++e)
+		{
+			latency[e].merge(contexts[i].latency[e]);
+			failures[e] += contexts[i].failures[e];
+			num_events += contexts[i].latency[e].getCount();
+		}
+	}
+
+	TrackerInfo tracker_end;
+	memset(&tracker_end, 0, sizeof(tracker_end));
+	for (unsigned int i = 0; i < trackers.size(); ++i)
+		tracker_end += trackers[i]->getInfo();
+
+	std::cout << "replay_summary " << elapsed
+		<< "\tThreads: " << trackers.size()
+		<< "\tEvents: " << num_events
+		<< "\tEventsPerSec: " << (elapsed > 0 ? num_events * 1000000.0 / elapsed : 0)
+		<< " " << (tracker_end - tracker_start)
+		<< " " << (GetCurrentMemInfo() - meminfo_start) << std::endl;
+
+	for (unsigned int e = 0; e < TRACE_NUM_EVENTS; ++e)
+	{
+		if (latency[e].getCount() == 0)
+			continue;
+
+		std::cout << "replay_latency " << EVENT_NAMES[e] << latency[e] << "\tFailed: " << failures[e] << std::endl;
+	}
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "tracker.h"
+
+/*
+ * Binary trace format for high-rate replay. A trace is a TraceHeader
+ * followed by num_records fixed-size TraceRecords sorted by time.
+ * Channels and peers are numbered; channel N is named "CN" and
+ * peer M within it "PM". All fields are in host byte order except
+ * addr, which is an IPv4 address in network byte order.
+ */
+
+static const char TRACE_MAGIC[8] = { 'P', '4', 'P', 'T', 'R', 'A', 'C', 'E' };
+static const uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t num_records;
+};
+
+enum TraceEvent
+{
+	TRACE_ADD_CHANNEL	= 0,
+	TRACE_DELETE_CHANNEL	= 1,
+	TRACE_PEER_JOIN		= 2,
+	TRACE_PEER_LEAVE	= 3,
+	TRACE_SELECT_PEERS	= 4,
+	TRACE_PEER_UPDATE_STATS	= 5,
+	TRACE_NUM_EVENTS
+};
+
+/* Channel option sets for TRACE_ADD_CHANNEL, matching the text event names */
+enum TraceChannelOptions
+{
+	TRACE_NATIVE				= 0,
+	TRACE_LOCATION_ONLY			= 1,	/* param1: intra-PID pct, param2: intra-ISP pct */
+	TRACE_FILESHARING_GENERIC		= 2,
+	TRACE_FILESHARING_SWARM_DEPENDENT	= 3,
+	TRACE_STREAMING_SWARM_DEPENDENT		= 4	/* param1: channel rate */
+};
+
+struct TraceRecord
+{
+	uint64_t time_usec;	/* Offset from start of trace */
+	uint32_t event;		/* TraceEvent */
+	uint32_t channel;
+	uint32_t peer;
+	uint32_t addr;		/* peer_join only */
+	uint16_t port;		/* peer_join only */
+	uint16_t max_peers;	/* select_peers only; downloading flag for peer_update_stats */
+	uint32_t options;	/* add_channel only */
+	float param1;		/* add_channel option parameter; upload capacity for peer_update_stats */
+	float param2;		/* add_channel option parameter; download capacity for peer_update_stats */
+};
+
+/**
+ * Replay a binary trace against the given trackers, one replay thread
+ * per tracker. Channels are partitioned across threads by channel
+ * number, so each tracker only ever sees its own channels and needs
+ * no locking. Events are issued open-loop at their trace timestamps
+ * divided by speedup (or back-to-back if speedup is 0), and latency
+ * is measured from the scheduled time, so a replay that falls behind
+ * shows up as queueing delay instead of a slower arrival rate.
+ * Prints per-event latency percentiles and memory growth to stdout.
+ */
+void replay_trace(const std::string& filename, const std::vector<Tracker*>& trackers, double speedup);
+
+#endif
@@ -29,6 +29,9 @@
 
 #include "admin_net.h"
 
+#include <stdexcept>
+#include "shared_object.h"
+
 bool AdminNetNodeAdd::commit(AdminState* admin) throw (admin_error)
 {
 	AdminNetNodeBase::commit(admin);
@@ -89,3 +92,33 @@ bool AdminNetLinkDelete::commit(AdminState* admin) throw (admin_error)
 	net->remove_edge(e, *net_rec.second);
 	return true;
 }
+
+bool AdminNetTrafficLoad::commit(AdminState* admin) throw (admin_error)
+{
+	AdminNetBase::commit(admin);
+
+	AdminState::WriteLockRecord net_rec = get_net_write();
+	NetStatePtr net = boost::dynamic_pointer_cast<NetState>(net_rec.first);
+
+	unsigned int updated = traffic_->apply(*net, scale_, reset_, *net_rec.second);
+	admin->get_logger().info("set traffic for %u links from %llu records (%u unknown links)",
+		updated, traffic_->get_records(), traffic_->get_unknown_links());
+	return true;
+}
+
+bool AdminNetPluginLoad::commit(AdminState* admin) throw (admin_error)
+{
+	AdminNetBase::commit(admin);
+
+	try
+	{
+		name_ = load_opt_plugin(get_path());
+		admin->get_logger().info("loaded optimization plugin '%s'", name_.c_str());
+		return true;
+	}
+	catch (std::runtime_error& e)
+	{
+		admin->get_logger().error("%s", e.what());
+		return false;
+	}
+}
@@ -30,6 +30,7 @@
 #ifndef ADMIN_NET_H
 #define ADMIN_NET_H
 
+#include <p4pserver/traffic_ingest.h>
 #include "admin_state.h"
 
 class AdminNetBase : public AdminAction
@@ -121,4 +122,50 @@ public:
 	virtual bool commit(AdminState* admin) throw (admin_error);
 };
 
+class AdminNetTrafficLoad : public AdminNetBase
+{
+public:
+	/**
+	 * Set link traffic from measurements which have already been
+	 * parsed, so the topology is only locked while they are applied.
+	 * @param traffic	Traffic per link; must be finished
+	 * @param scale		Factor applied to each link's total (e.g., to convert a byte count to a rate)
+	 * @param reset		Whether links without measurements get a traffic of 0
+	 */
+	AdminNetTrafficLoad(TrafficIngestPtr traffic, double scale, bool reset)
+	: AdminNetBase(),
+	  traffic_(traffic),
+	  scale_(scale),
+	  reset_(reset)
+	{}
+
+	virtual bool commit(AdminState* admin) throw (admin_error);
+
+private:
+	TrafficIngestPtr traffic_;
+	double scale_;
+	bool reset_;
+};
+
+class AdminNetPluginLoad : public AdminNetBase
+{
+public:
+	AdminNetPluginLoad(const std::string& path)
+	: AdminNetBase(),
+	  path_(path)
+	{}
+
+	const std::string& get_path() const { return path_; }
+	const std::string& get_name() const { return name_; }
+
+	/* Loading a plugin registers it immediately; it is not undone
+	 * if the transaction is rolled back. */
+	virtual bool commit(AdminState* admin) throw (admin_error);
+
+private:
+	std::string path_;
+	std::string name_;
+};
+typedef boost::shared_ptr<AdminNetPluginLoad> AdminNetPluginLoadPtr;
+
 #endif
@@ -33,6 +33,9 @@
 #include <boost/static_assert.hpp>
 #include "state.h"
 #include "options.h"
+#include "map_response_job.h"
+#include "udp_snapshot_job.h"
+#include "update_stream_job.h"
 
 const AdminState::Token AdminState::INVALID_TOKEN = 0;
 
@@ -362,6 +365,10 @@ bool AdminState::txn_commit(const Token& token)
 		get_logger().debug("updating current state");
 		GLOBAL_STATE->apply(new_state_, *find_lock(write_locks_, new_state_), write_lock);
 		get_logger().debug("finished applying changes to current state");
+
+		/* Drop responses of the old state before anyone can see the new one */
+		if (MAP_RESPONSES)
+			MAP_RESPONSES->invalidate_all();
 	}
 
 	get_logger().debug("finished applying changes; cleaning up transaction");
@@ -370,6 +377,13 @@ bool AdminState::txn_commit(const Token& token)
 	get_logger().debug("signaling current state that it has been updated");
 	GLOBAL_STATE->updated();
 
+	if (MAP_RESPONSES)
+		JOB_QUEUE->enqueue(JobPtr(new MapResponseJob(JOB_QUEUE, boost::get_system_time())));
+	if (UDP_SNAPSHOTS)
+		JOB_QUEUE->enqueue(JobPtr(new UDPSnapshotJob(JOB_QUEUE, boost::get_system_time())));
+	if (UPDATE_STREAMS)
+		JOB_QUEUE->enqueue(JobPtr(new UpdateStreamJob(JOB_QUEUE, boost::get_system_time())));
+
 	get_logger().info("successfully committed transaction");
 
 	return true;
@@ -29,7 +29,9 @@
 
 #include "admin_view.h"
 
+#include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
+#include "state.h"
 #include "view_update.h"
 
 AdminState::ReadLockRecord AdminViewBase::get_view_read() throw (admin_error)
@@ -160,7 +162,14 @@ bool AdminViewPDistanceUpdate::commit(AdminState* admin) throw (admin_error)
 					 intradomain_routing_rec.second,
 					 link_pdistances_rec.second);
 
-	return ViewUpdateDirect(boost::dynamic_pointer_cast<NetState>(net_state_rec.first), *net_state_rec.second, view_state).do_update() != 0;
+	ViewUpdateDirect update(boost::dynamic_pointer_cast<NetState>(net_state_rec.first), *net_state_rec.second, view_state);
+	bool success = update.do_update() != 0;
+
+	update.get_trace()->finish(success);
+	if (UPDATE_TRACES)
+		UPDATE_TRACES->add(update.get_trace());
+
+	return success;
 }
 
 const p4p::PID&  AdminViewBase::lookup_pid(const std::string& name) throw (admin_error)
@@ -321,6 +330,69 @@ bool AdminViewSetLinkWeight::commit(AdminState* admin) throw (admin_error)
 	return intradomain_routing->set_weight(src, dst, get_weight(), *intradomain_routing_rec.second);
 }
 
+bool AdminViewStaticRouteBase::get_route(PIDRouting::NamedRoute& result) throw (admin_error)
+{
+	if (get_links().empty())
+		return false;
+
+	AdminState::ReadLockRecord aggregation_rec = get_aggregation_read();
+	PIDAggregationPtr aggregation = boost::dynamic_pointer_cast<PIDAggregation>(aggregation_rec.first);
+
+	result.clear();
+	result.push_back(lookup_pid(get_src()));
+	BOOST_FOREACH(const p4p::PIDLinkName& link, get_links())
+	{
+		p4p::PID src, dst;
+		if (!aggregation->get_link(link, src, dst, *aggregation_rec.second))
+			return false;
+
+		/* Each link must continue from where the previous one ended */
+		if (src != result.back())
+			return false;
+		result.push_back(dst);
+	}
+
+	return result.back() == lookup_pid(get_dst());
+}
+
+bool AdminViewAddStaticRoute::commit(AdminState* admin) throw (admin_error)
+{
+	AdminViewStaticRouteBase::commit(admin);
+
+	PIDRouting::NamedRoute route;
+	if (!get_route(route))
+		return false;
+
+	AdminState::WriteLockRecord intradomain_routing_rec = get_intradomain_routing_write();
+	PIDRoutingPtr intradomain_routing = boost::dynamic_pointer_cast<PIDRouting>(intradomain_routing_rec.first);
+
+	return intradomain_routing->add_static_route(route, get_weight(), *intradomain_routing_rec.second);
+}
+
+bool AdminViewDeleteStaticRoute::commit(AdminState* admin) throw (admin_error)
+{
+	AdminViewStaticRouteBase::commit(admin);
+
+	PIDRouting::NamedRoute route;
+	if (!get_route(route))
+		return false;
+
+	AdminState::WriteLockRecord intradomain_routing_rec = get_intradomain_routing_write();
+	PIDRoutingPtr intradomain_routing = boost::dynamic_pointer_cast<PIDRouting>(intradomain_routing_rec.first);
+
+	return intradomain_routing->remove_static_route(route, *intradomain_routing_rec.second);
+}
+
+bool AdminViewClearStaticRoutes::commit(AdminState* admin) throw (admin_error)
+{
+	AdminViewBase::commit(admin);
+
+	AdminState::WriteLockRecord intradomain_routing_rec = get_intradomain_routing_write();
+	PIDRoutingPtr intradomain_routing = boost::dynamic_pointer_cast<PIDRouting>(intradomain_routing_rec.first);
+
+	return intradomain_routing->clear_static_routes(*intradomain_routing_rec.second);
+}
+
 bool AdminViewPropGet::commit(AdminState* admin) throw (admin_error)
 {
 	AdminViewPropBase::commit(admin);
@@ -344,6 +416,14 @@ bool AdminViewPropGet::commit(AdminState* admin) throw (admin_error)
 		set_value(boost::lexical_cast<std::string>(view->get_pid_ttl(*view_rec.second)));
 	else if (get_prop() == "pdistance_ttl")
 		set_value(boost::lexical_cast<std::string>(view->get_pdistance_ttl(*view_rec.second)));
+	else if (get_prop() == "plugin")
+		set_value(view->get_plugin_name(*view_rec.second));
+	else if (get_prop() == "route_mode")
+	{
+		AdminState::ReadLockRecord intradomain_routing_rec = get_intradomain_routing_read();
+		PIDRoutingPtr intradomain_routing = boost::dynamic_pointer_cast<PIDRouting>(intradomain_routing_rec.first);
+		set_value(PIDRouting::get_route_mode_name(intradomain_routing->get_route_mode(*intradomain_routing_rec.second)));
+	}
 	else
 		return false;
 
@@ -376,6 +456,21 @@ bool AdminViewPropSet::commit(AdminState* admin) throw (admin_error)
 			view->set_pid_ttl(boost::lexical_cast<unsigned int>(get_value()), *view_rec.second);
 		else if (get_prop() == "pdistance_ttl")
 			view->set_pdistance_ttl(boost::lexical_cast<unsigned int>(get_value()), *view_rec.second);
+		else if (get_prop() == "plugin")
+		{
+			if (!view->set_plugin(get_value(), *view_rec.second))
+				return false;
+		}
+		else if (get_prop() == "route_mode")
+		{
+			PIDRouting::RouteMode mode;
+			if (!PIDRouting::parse_route_mode(get_value(), mode))
+				return false;
+
+			AdminState::WriteLockRecord intradomain_routing_rec = get_intradomain_routing_write();
+			PIDRoutingPtr intradomain_routing = boost::dynamic_pointer_cast<PIDRouting>(intradomain_routing_rec.first);
+			intradomain_routing->set_route_mode(mode, *intradomain_routing_rec.second);
+		}
 		else
 			return false;
 
@@ -324,6 +324,66 @@ private:
 	double weight_;
 };
 
+class AdminViewStaticRouteBase : public AdminViewBase
+{
+public:
+	AdminViewStaticRouteBase(const std::string& view, const std::string& src, const std::string& dst, const std::vector<p4p::PIDLinkName>& links)
+	: AdminViewBase(view),
+	  src_(src),
+	  dst_(dst),
+	  links_(links)
+	{}
+
+	const std::string& get_src() const { return src_; }
+	const std::string& get_dst() const { return dst_; }
+	const std::vector<p4p::PIDLinkName>& get_links() const { return links_; }
+
+protected:
+	/* Resolve the route from 'src' along each PID link in turn to 'dst' */
+	bool get_route(PIDRouting::NamedRoute& result) throw (admin_error);
+
+private:
+	std::string src_;
+	std::string dst_;
+	std::vector<p4p::PIDLinkName> links_;
+};
+
+class AdminViewAddStaticRoute : public AdminViewStaticRouteBase
+{
+public:
+	AdminViewAddStaticRoute(const std::string& view, const std::string& src, const std::string& dst, const std::vector<p4p::PIDLinkName>& links, double weight)
+	: AdminViewStaticRouteBase(view, src, dst, links),
+	  weight_(weight)
+	{}
+
+	double get_weight() const { return weight_; }
+
+	virtual bool commit(AdminState* admin) throw (admin_error);
+
+private:
+	double weight_;
+};
+
+class AdminViewDeleteStaticRoute : public AdminViewStaticRouteBase
+{
+public:
+	AdminViewDeleteStaticRoute(const std::string& view, const std::string& src, const std::string& dst, const std::vector<p4p::PIDLinkName>& links)
+	: AdminViewStaticRouteBase(view, src, dst, links)
+	{}
+
+	virtual bool commit(AdminState* admin) throw (admin_error);
+};
+
+class AdminViewClearStaticRoutes : public AdminViewBase
+{
+public:
+	AdminViewClearStaticRoutes(const std::string& view)
+	: AdminViewBase(view)
+	{}
+
+	virtual bool commit(AdminState* admin) throw (admin_error);
+};
+
 class AdminViewPropBase : public AdminViewBase
 {
 public:
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Benchmark for multipath (ECMP) pdistances.
+ *
+ * Builds a k-ary fat-tree (k pods of k/2 edge and k/2 aggregation
+ * switches, with (k/2)^2 core switches), with unit routing weights so
+ * that edge switches in different pods are joined by (k/2)^2 equal-cost
+ * paths, and a different pdistance on each link. Computes the expected
+ * pdistance between every pair of edge switches with traffic split evenly
+ * at each hop, once by accumulating over the shortest-path DAG toward each
+ * destination, as view updates do, and once by enumerating every
+ * equal-cost path. Reports the time for each and checks that they agree.
+ */
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <p4pserver/net_state.h>
+#include <p4pserver/pid_routing.h>
+
+namespace bpt = boost::posix_time;
+
+/* Pdistance of a link, varying between links */
+static double link_pdistance(unsigned int src, unsigned int dst)
+{
+	return 1 + (src * 7 + dst * 13) % 5;
+}
+
+/* Add up the pdistance of every path from 'v', weighted by the share of traffic it carries */
+static double enumerate_paths(const PIDRouting::RouteComputationContext& context, const std::vector<unsigned int>& vert_ids,
+			      unsigned int v, double share, unsigned long long& paths)
+{
+	PIDRouting::MultipathHopRange hops = context.get_multipath_hops(v);
+	if (hops.first == hops.second)
+	{
+		++paths;
+		return 0.0;
+	}
+
+	double result = 0.0;
+	for (PIDRouting::MultipathHopVector::const_iterator h = hops.first; h != hops.second; ++h)
+		result += share * h->fraction * link_pdistance(vert_ids[v], vert_ids[h->vertex])
+			+ enumerate_paths(context, vert_ids, h->vertex, share * h->fraction, paths);
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int k = argc > 1 ? boost::lexical_cast<unsigned int>(argv[1]) : 8;
+	unsigned int half = k / 2;
+
+	NetStatePtr state(new NetState());
+	PIDRoutingPtr routing(new PIDRouting(1.0));
+	PinnedPIDSet pids;
+	std::vector<NetVertex> verts;
+	std::vector<PinnedPID> edge_switches;
+
+	{
+		BlockWriteLock state_lock(*state);
+		BlockWriteLock routing_lock(*routing);
+		routing->set_route_mode(PIDRouting::RM_ECMP, routing_lock);
+
+		/* Edge switches, then aggregation switches, pod by pod, then core switches */
+		unsigned int num_nodes = k * k + half * half;
+		for (unsigned int i = 0; i < num_nodes; ++i)
+		{
+			NetVertex v;
+			p4p::PID pid("fattree", i + 1, false);
+			state->add_node("switch" + boost::lexical_cast<std::string>(i), v, state_lock);
+			state->set_pid(v, pid, state_lock);
+			routing->add_pid(pid, routing_lock);
+			pids.insert(PinnedPID(pid, v));
+			verts.push_back(v);
+			if (i < k * k && i % k < half)
+				edge_switches.push_back(PinnedPID(pid, v));
+		}
+
+		for (unsigned int pod = 0; pod < k; ++pod)
+		{
+			for (unsigned int a = 0; a < half; ++a)
+			{
+				unsigned int agg = pod * k + half + a;
+				for (unsigned int e = 0; e < half; ++e)
+				{
+					NetEdge edge;
+					state->add_edge(verts[pod * k + e], verts[agg], edge, state_lock);
+					state->add_edge(verts[agg], verts[pod * k + e], edge, state_lock);
+				}
+				for (unsigned int c = 0; c < half; ++c)
+				{
+					NetEdge edge;
+					unsigned int core = k * k + a * half + c;
+					state->add_edge(verts[agg], verts[core], edge, state_lock);
+					state->add_edge(verts[core], verts[agg], edge, state_lock);
+				}
+			}
+		}
+	}
+
+	BlockReadLock state_lock(*state);
+	BlockReadLock routing_lock(*routing);
+	PIDRouting::RouteComputationContext context;
+
+	std::cout << "fattree k=" << k
+		  << " nodes=" << state->get_num_nodes(state_lock)
+		  << " edges=" << state->get_num_edges(state_lock)
+		  << " pairs=" << edge_switches.size() * edge_switches.size()
+		  << std::endl;
+
+	/* Compute the trees toward each destination, so both methods below find them ready */
+	bpt::ptime start = bpt::microsec_clock::universal_time();
+	for (unsigned int d = 0; d < edge_switches.size(); ++d)
+	{
+		if (!routing->get_multipath(edge_switches[d], *state, state_lock, context, routing_lock))
+		{
+			std::cerr << "multipath computation failed" << std::endl;
+			return 1;
+		}
+	}
+	double trees_usec = (bpt::microsec_clock::universal_time() - start).total_microseconds();
+
+	/* Vertex index of each edge switch, and switch of each vertex index */
+	std::vector<unsigned int> edge_indexes(edge_switches.size());
+	std::vector<unsigned int> vert_ids;
+
+	/* Accumulate over the DAG toward each destination, nearest vertex first */
+	std::vector<double> dag_result;
+	std::vector<double> cost;
+	start = bpt::microsec_clock::universal_time();
+	for (unsigned int d = 0; d < edge_switches.size(); ++d)
+	{
+		routing->get_multipath(edge_switches[d], *state, state_lock, context, routing_lock);
+
+		if (d == 0)
+		{
+			for (unsigned int i = 0; i < edge_switches.size(); ++i)
+				context.get_vertex_index(edge_switches[i].get_vertex(), edge_indexes[i]);
+			vert_ids.resize(verts.size());
+			for (unsigned int i = 0; i < verts.size(); ++i)
+			{
+				unsigned int idx = 0;
+				context.get_vertex_index(verts[i], idx);
+				vert_ids[idx] = i;
+			}
+			cost.resize(verts.size());
+		}
+
+		const std::vector<unsigned int>& order = context.get_multipath_order();
+		for (unsigned int i = 0; i < order.size(); ++i)
+		{
+			unsigned int x = order[i];
+			double c = 0.0;
+			PIDRouting::MultipathHopRange hops = context.get_multipath_hops(x);
+			for (PIDRouting::MultipathHopVector::const_iterator h = hops.first; h != hops.second; ++h)
+				c += h->fraction * (link_pdistance(vert_ids[x], vert_ids[h->vertex]) + cost[h->vertex]);
+			cost[x] = c;
+		}
+		for (unsigned int s = 0; s < edge_switches.size(); ++s)
+			dag_result.push_back(cost[edge_indexes[s]]);
+	}
+	double dag_usec = (bpt::microsec_clock::universal_time() - start).total_microseconds();
+
+	/* Enumerate every path instead */
+	std::vector<double> path_result;
+	unsigned long long paths = 0;
+	start = bpt::microsec_clock::universal_time();
+	for (unsigned int d = 0; d < edge_switches.size(); ++d)
+	{
+		routing->get_multipath(edge_switches[d], *state, state_lock, context, routing_lock);
+		for (unsigned int s = 0; s < edge_switches.size(); ++s)
+			path_result.push_back(enumerate_paths(context, vert_ids, edge_indexes[s], 1.0, paths));
+	}
+	double path_usec = (bpt::microsec_clock::universal_time() - start).total_microseconds();
+
+	double max_diff = 0.0;
+	for (unsigned int i = 0; i < dag_result.size(); ++i)
+		max_diff = std::max(max_diff, std::fabs(dag_result[i] - path_result[i]));
+
+	std::cout << "trees usec=" << trees_usec
+		  << std::endl;
+	std::cout << "dag usec=" << dag_usec
+		  << " usec_per_destination=" << dag_usec / edge_switches.size()
+		  << std::endl;
+	std::cout << "enumerate usec=" << path_usec
+		  << " usec_per_destination=" << path_usec / edge_switches.size()
+		  << " paths=" << paths
+		  << std::endl;
+	std::cout << "summary speedup=" << (dag_usec > 0 ? path_usec / dag_usec : 0)
+		  << " max_diff=" << max_diff
+		  << std::endl;
+
+	return max_diff < 1e-9 ? 0 : 1;
+}
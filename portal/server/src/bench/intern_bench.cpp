@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/*
+ * Memory and lookup benchmark for interned PIDs and vertex names.
+ *
+ * Builds a configuration of synthetic PIDs, each aggregating several
+ * vertices, twice: once with the representation used before interning
+ * (PIDs holding their ISP identifier as a string, PID records holding a
+ * set of vertex names, vertices found by name in an ordered map), and
+ * once with the server's own types. Reports the heap used by each and
+ * the time taken by the lookups done for every view update: PIDs in a
+ * pdistance matrix's PID index, and the vertices of each PID in the
+ * topology.
+ *
+ * The interned tables are shared by the whole process, so their size is
+ * reported separately from the size of each copy of the records.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/random_access_index.hpp>
+#include <boost/multi_index/identity.hpp>
+#include <boost/multi_index/member.hpp>
+#include <p4pserver/net_state.h>
+#include <p4pserver/pid_aggregation.h>
+#include <p4pserver/pid_matrix.h>
+
+namespace bpt = boost::posix_time;
+namespace bmi = boost::multi_index;
+
+static const char* ISP = "bench.isp";
+
+/* PID as it was stored before ISP identifiers were interned */
+struct LegacyPID
+{
+	LegacyPID(const std::string& _isp, unsigned int _num, bool _external)
+		: isp(_isp), num(_num), external(_external)
+	{}
+
+	bool operator<(const LegacyPID& rhs) const
+	{
+		if (external != rhs.external)
+			return external < rhs.external;
+		return (num < rhs.num)
+		    || (num == rhs.num && isp < rhs.isp);
+	}
+
+	std::string isp;
+	unsigned int num;
+	bool external;
+};
+
+struct LegacyPIDRecord
+{
+	LegacyPIDRecord(const std::string& _name, const LegacyPID& _pid, const NetVertexNameSet& _vertices)
+		: name(_name), pid(_pid), vertices(_vertices)
+	{}
+
+	std::string name;
+	LegacyPID pid;
+	NetVertexNameSet vertices;
+};
+
+typedef bmi::multi_index_container<
+	LegacyPIDRecord,
+	bmi::indexed_by<
+		bmi::ordered_unique< bmi::member<LegacyPIDRecord, std::string, &LegacyPIDRecord::name> >,
+		bmi::ordered_unique< bmi::member<LegacyPIDRecord, LegacyPID, &LegacyPIDRecord::pid> >
+	>
+> LegacyPIDRecords;
+
+struct LegacyIndexedPID : public LegacyPID
+{
+	LegacyIndexedPID(const LegacyPID& pid, unsigned int i) : LegacyPID(pid), index(i) {}
+	unsigned int index;
+};
+
+typedef bmi::multi_index_container<
+	LegacyIndexedPID,
+	bmi::indexed_by<
+		bmi::random_access<>,
+		bmi::ordered_unique< bmi::identity<LegacyPID> >
+	>
+> LegacyPIDIndex;
+
+typedef std::map<NetVertexName, NetVertex> LegacyNameToVertexMap;
+
+/* Bytes currently allocated with operator new; each block records its size */
+static long allocated = 0;
+static const size_t HEADER = 16;
+
+void* operator new(size_t size) throw (std::bad_alloc)
+{
+	char* p = (char*)malloc(size + HEADER);
+	if (!p)
+		throw std::bad_alloc();
+	*(size_t*)p = size;
+	allocated += size;
+	return p + HEADER;
+}
+
+void operator delete(void* ptr) throw ()
+{
+	if (!ptr)
+		return;
+	char* p = (char*)ptr - HEADER;
+	allocated -= *(size_t*)p;
+	free(p);
+}
+
+void* operator new[](size_t size) throw (std::bad_alloc)	{ return operator new(size); }
+void operator delete[](void* ptr) throw ()			{ operator delete(ptr); }
+
+static long heap_bytes()
+{
+	return allocated;
+}
+
+static double usec_since(const bpt::ptime& start)
+{
+	return (bpt::microsec_clock::universal_time() - start).total_microseconds();
+}
+
+static std::string pid_name(unsigned int p)
+{
+	return "pid" + boost::lexical_cast<std::string>(p);
+}
+
+static NetVertexNameSet pid_vertices(unsigned int p, unsigned int vertices_per_pid)
+{
+	NetVertexNameSet result;
+	for (unsigned int i = 0; i < vertices_per_pid; ++i)
+		result.insert("router" + boost::lexical_cast<std::string>(p * vertices_per_pid + i) + ".pop.bench.isp");
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int pids = argc > 1 ? boost::lexical_cast<unsigned int>(argv[1]) : 10000;
+	unsigned int vertices_per_pid = argc > 2 ? boost::lexical_cast<unsigned int>(argv[2]) : 4;
+	unsigned int lookups = argc > 3 ? boost::lexical_cast<unsigned int>(argv[3]) : 1000000;
+
+	std::vector<NetVertexNameSet> vertices;
+	for (unsigned int p = 0; p < pids; ++p)
+		vertices.push_back(pid_vertices(p, vertices_per_pid));
+
+	std::cout << "config pids=" << pids
+		  << " vertices_per_pid=" << vertices_per_pid
+		  << " sizeof_legacy_pid=" << sizeof(LegacyPID)
+		  << " sizeof_pid=" << sizeof(p4p::PID)
+		  << std::endl;
+
+	/* PID records, as held by each view's aggregation */
+	long base = heap_bytes();
+	LegacyPIDRecords* legacy_records = new LegacyPIDRecords();
+	for (unsigned int p = 0; p < pids; ++p)
+		legacy_records->insert(LegacyPIDRecord(pid_name(p), LegacyPID(ISP, p + 1, false), vertices[p]));
+	long legacy_bytes = heap_bytes() - base;
+
+	base = heap_bytes();
+	PIDAggregation::PIDRecords* records = new PIDAggregation::PIDRecords();
+	for (unsigned int p = 0; p < pids; ++p)
+		records->insert(PIDAggregation::PIDRecord(pid_name(p), p4p::PID(ISP, p + 1, false), vertices[p]));
+	long first_bytes = heap_bytes() - base;
+
+	base = heap_bytes();
+	PIDAggregation::PIDRecords* records_copy = new PIDAggregation::PIDRecords(*records);
+	long copy_bytes = heap_bytes() - base;
+
+	std::cout << "records before_bytes=" << legacy_bytes
+		  << " after_bytes=" << copy_bytes
+		  << " shared_table_bytes=" << first_bytes - copy_bytes
+		  << " reduction=" << (double)legacy_bytes / copy_bytes
+		  << std::endl;
+
+	/* PID index of a pdistance matrix */
+	base = heap_bytes();
+	LegacyPIDIndex* legacy_index = new LegacyPIDIndex();
+	for (unsigned int p = 0; p < pids; ++p)
+		legacy_index->push_back(LegacyIndexedPID(LegacyPID(ISP, p + 1, false), p));
+	legacy_bytes = heap_bytes() - base;
+
+	base = heap_bytes();
+	SparsePIDMatrixPtr matrix(new SparsePIDMatrix());
+	{
+		p4p::PIDSet pid_set;
+		for (unsigned int p = 0; p < pids; ++p)
+			pid_set.insert(p4p::PID(ISP, p + 1, false));
+
+		BlockWriteLock lock(*matrix);
+		matrix->set_pids(pid_set, lock);
+	}
+	copy_bytes = heap_bytes() - base;
+
+	std::vector<LegacyPID> legacy_keys;
+	std::vector<p4p::PID> keys;
+	unsigned int state = 1;
+	for (unsigned int i = 0; i < lookups; ++i)
+	{
+		state = state * 1103515245 + 12345;
+		unsigned int p = (state >> 8) % pids;
+		/* Build keys from a separate string, as parsed from a request */
+		std::string isp(ISP);
+		legacy_keys.push_back(LegacyPID(isp, p + 1, false));
+		keys.push_back(p4p::PID(isp, p + 1, false));
+	}
+
+	unsigned long found = 0;
+	bpt::ptime start = bpt::microsec_clock::universal_time();
+	const LegacyPIDIndex::nth_index<1>::type& legacy_by_pid = legacy_index->get<1>();
+	for (unsigned int i = 0; i < lookups; ++i)
+		found += legacy_by_pid.find(legacy_keys[i])->index;
+	double legacy_usec = usec_since(start);
+
+	start = bpt::microsec_clock::universal_time();
+	{
+		BlockReadLock lock(*matrix);
+		const PIDMatrixPIDsByLoc& by_pid = matrix->get_pids_set(lock);
+		for (unsigned int i = 0; i < lookups; ++i)
+			found -= by_pid.find(keys[i])->get_index();
+	}
+	double usec = usec_since(start);
+
+	std::cout << "pid_index before_bytes=" << legacy_bytes
+		  << " after_bytes=" << copy_bytes
+		  << " before_nsec_per_lookup=" << legacy_usec * 1000 / lookups
+		  << " after_nsec_per_lookup=" << usec * 1000 / lookups
+		  << " speedup=" << legacy_usec / usec
+		  << " check=" << found
+		  << std::endl;
+
+	/* Vertices of each PID in the topology, as found for every view update */
+	NetStatePtr net_state(new NetState());
+	LegacyNameToVertexMap legacy_vertices;
+	{
+		BlockWriteLock lock(*net_state);
+		for (unsigned int p = 0; p < pids; ++p)
+		{
+			BOOST_FOREACH(const NetVertexName& name, vertices[p])
+			{
+				NetVertex v;
+				net_state->add_node(name, v, lock);
+				legacy_vertices.insert(std::make_pair(name, v));
+			}
+		}
+	}
+
+	unsigned int passes = std::max(lookups / (pids * vertices_per_pid), 1u);
+	unsigned long checked = 0;
+	start = bpt::microsec_clock::universal_time();
+	for (unsigned int pass = 0; pass < passes; ++pass)
+	{
+		BOOST_FOREACH(const LegacyPIDRecord& r, legacy_records->get<1>())
+		{
+			BOOST_FOREACH(const NetVertexName& name, r.vertices)
+				checked += legacy_vertices.find(name) != legacy_vertices.end();
+		}
+	}
+	legacy_usec = usec_since(start);
+
+	start = bpt::microsec_clock::universal_time();
+	{
+		BlockReadLock lock(*net_state);
+		for (unsigned int pass = 0; pass < passes; ++pass)
+		{
+			BOOST_FOREACH(const PIDAggregation::PIDRecord& r, records->get<1>())
+			{
+				BOOST_FOREACH(NetVertexNameId name, r.vertices)
+				{
+					NetVertex v;
+					checked -= net_state->get_node(name, v, lock);
+				}
+			}
+		}
+	}
+	usec = usec_since(start);
+
+	std::cout << "vertices passes=" << passes
+		  << " before_usec_per_pass=" << legacy_usec / passes
+		  << " after_usec_per_pass=" << usec / passes
+		  << " speedup=" << legacy_usec / usec
+		  << " check=" << checked
+		  << std::endl;
+
+	delete records_copy;
+	delete records;
+	delete legacy_records;
+	delete legacy_index;
+	return 0;
+}
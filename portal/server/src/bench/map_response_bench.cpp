@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/*
+ * Cost benchmark for precomputed map responses.
+ *
+ * Builds a network map of synthetic PIDs and prefixes and serves it a
+ * number of times, once the way the map is answered without the response
+ * cache (building the JSON on each request, and compressing it on each
+ * request when the client accepts gzip) and once from an encoded body
+ * built a single time. Reports the CPU time per request and the bytes
+ * sent per request for each encoding.
+ */
+
+#include <sys/resource.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <boost/lexical_cast.hpp>
+#include <p4pserver/encoded_body.h>
+#include "info_resource_entity.h"
+#include "network_map.h"
+
+static const char IDENTITY[] = "identity";
+static const char GZIP[] = "gzip, deflate";
+
+/* User and system CPU time used by the process, in microseconds */
+static double cpu_usec()
+{
+	rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e6 + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+/* Network map with consecutive /24 prefixes starting at 10.0.0.0 */
+static std::string make_network_map(unsigned int pids, unsigned int prefixes_per_pid)
+{
+	InfoResourceNetworkMap netmap;
+	netmap.setVerTag("1");
+	for (unsigned int p = 0; p < pids; ++p)
+	{
+		std::string pid = "pid" + boost::lexical_cast<std::string>(p + 1);
+		for (unsigned int i = 0; i < prefixes_per_pid; ++i)
+		{
+			unsigned int n = p * prefixes_per_pid + i;
+			std::ostringstream ip;
+			ip << (10 + n / 65536) << "." << (n / 256 % 256) << "." << (n % 256) << ".0/24";
+			netmap.addIP(pid, ip.str());
+		}
+	}
+	netmap.commit();
+	return InfoResourceEntity::MakeJsonStr(netmap);
+}
+
+static void report(const std::string& name, const char* accept, unsigned int requests, double usec, unsigned long long bytes)
+{
+	std::cout << name
+		  << " accept=\"" << accept << "\""
+		  << " cpu_usec_per_request=" << usec / requests
+		  << " bytes_per_request=" << bytes / requests
+		  << std::endl;
+}
+
+/* Build (and compress, if accepted) the body on every request */
+static void bench_live(unsigned int pids, unsigned int prefixes_per_pid, unsigned int requests, const char* accept)
+{
+	unsigned long long bytes = 0;
+	double start = cpu_usec();
+	for (unsigned int r = 0; r < requests; ++r)
+	{
+		std::string body = make_network_map(pids, prefixes_per_pid);
+		if (EncodedBody::accepts(accept, EncodedBody::GZIP))
+			bytes += EncodedBody(body, 6).get(EncodedBody::GZIP).size();
+		else
+			bytes += body.size();
+	}
+	report("live", accept, requests, cpu_usec() - start, bytes);
+}
+
+/* Build and compress once, then select an encoding on every request */
+static void bench_precomputed(unsigned int pids, unsigned int prefixes_per_pid, unsigned int requests, const char* accept)
+{
+	unsigned long long bytes = 0;
+	double start = cpu_usec();
+	EncodedBody encoded(make_network_map(pids, prefixes_per_pid));
+	double build_usec = cpu_usec() - start;
+	for (unsigned int r = 0; r < requests; ++r)
+		bytes += encoded.get(encoded.select(accept)).size();
+	report("precomputed", accept, requests, cpu_usec() - start, bytes);
+
+	std::cout << "precomputed build_usec=" << build_usec
+		  << " identity_bytes=" << encoded.get(EncodedBody::IDENTITY).size()
+		  << " gzip_bytes=" << (encoded.has(EncodedBody::GZIP) ? encoded.get(EncodedBody::GZIP).size() : 0)
+		  << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int pids = argc > 1 ? boost::lexical_cast<unsigned int>(argv[1]) : 1000;
+	unsigned int prefixes_per_pid = argc > 2 ? boost::lexical_cast<unsigned int>(argv[2]) : 4;
+	unsigned int requests = argc > 3 ? boost::lexical_cast<unsigned int>(argv[3]) : 100;
+
+	bench_live(pids, prefixes_per_pid, requests, IDENTITY);
+	bench_live(pids, prefixes_per_pid, requests, GZIP);
+	bench_precomputed(pids, prefixes_per_pid, requests, IDENTITY);
+	bench_precomputed(pids, prefixes_per_pid, requests, GZIP);
+	return 0;
+}
@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Deterministic benchmark for the pdistance optimization plugins.
+ *
+ * Builds a synthetic topology from a fixed seed, then runs each
+ * registered plugin for a number of updates against a simple traffic
+ * model in which part of the demand moves away from edges with high
+ * pdistances. Reports the cost of each update and how the MLU,
+ * intradomain congestion volume and interdomain traffic above commit
+ * evolve.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <p4pserver/logging.h>
+#include <p4pserver/net_state.h>
+#include "plugin_base.h"
+#include "plugin_registry.h"
+
+namespace bpt = boost::posix_time;
+
+/* Number of edges sharing one movable demand */
+static const unsigned int GROUP_SIZE = 4;
+
+/* Sensitivity of the movable demand to pdistances */
+static const double BETA = 2.0;
+
+/* Fraction of the movable demand that reacts to each update */
+static const double GAMMA = 0.5;
+
+/* Distance from the final objective counted as converged, relative to
+ * the larger of the initial and final values */
+static const double CONVERGED = 0.01;
+
+/*
+ * Small linear congruential generator, so that topologies are identical
+ * across platforms and library versions.
+ */
+class BenchRandom
+{
+public:
+	BenchRandom(unsigned int seed) : state_(seed) {}
+
+	unsigned int next()
+	{
+		state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+		return (unsigned int)(state_ >> 33);
+	}
+
+	unsigned int uniform(unsigned int n)
+	{
+		return next() % n;
+	}
+
+	double uniform(double lo, double hi)
+	{
+		return lo + (hi - lo) * (next() / 2147483648.0);
+	}
+
+private:
+	unsigned long long state_;
+};
+
+struct BenchTopology
+{
+	NetEdgeVector edges;
+	std::vector<p4p::PID> srcs;
+	std::vector<p4p::PID> dsts;
+	std::vector<bool> interdomain;
+	std::vector<double> capacity;
+	std::vector<double> background;
+
+	/* edges sharing each movable demand, GROUP_SIZE per group */
+	std::vector<unsigned int> group_edges;
+	std::vector<double> group_demand;
+};
+
+struct BenchObjectives
+{
+	double mlu;
+	double volume;
+	double overage;
+};
+
+static void build_topology(NetState& state, const WritableLock& lock, BenchTopology& topo,
+			   unsigned int num_nodes, unsigned int num_edges, unsigned int num_external, unsigned int seed)
+{
+	BenchRandom rnd(seed);
+	unsigned int num_internal = num_nodes - num_external;
+
+	std::vector<NetVertex> vertices(num_nodes);
+	for (unsigned int i = 0; i < num_nodes; ++i)
+	{
+		bool external = i >= num_internal;
+		state.add_node("n" + boost::lexical_cast<std::string>(i), vertices[i], lock);
+		state.set_pid(vertices[i], p4p::PID("bench", i, external), lock);
+		state.set_external(vertices[i], external, lock);
+	}
+
+	std::vector<unsigned int> intra, inter;
+	NetEdge e;
+
+	/* every external node is multihomed to two or three internal nodes */
+	for (unsigned int i = num_internal; i < num_nodes; ++i)
+	{
+		unsigned int homes = 2 + rnd.uniform(2u);
+		for (unsigned int h = 0; h < homes; ++h)
+		{
+			unsigned int j = rnd.uniform(num_internal);
+			if (state.add_edge(vertices[i], vertices[j], e, lock))
+			{
+				inter.push_back(topo.edges.size());
+				topo.edges.push_back(e);
+			}
+			if (state.add_edge(vertices[j], vertices[i], e, lock))
+			{
+				inter.push_back(topo.edges.size());
+				topo.edges.push_back(e);
+			}
+		}
+	}
+
+	/* ring over internal nodes for connectivity, then random chords */
+	for (unsigned int i = 0; i < num_internal && topo.edges.size() < num_edges; ++i)
+	{
+		if (state.add_edge(vertices[i], vertices[(i + 1) % num_internal], e, lock))
+		{
+			intra.push_back(topo.edges.size());
+			topo.edges.push_back(e);
+		}
+	}
+	while (topo.edges.size() < num_edges)
+	{
+		unsigned int i = rnd.uniform(num_internal);
+		unsigned int j = rnd.uniform(num_internal);
+		if (i != j && state.add_edge(vertices[i], vertices[j], e, lock))
+		{
+			intra.push_back(topo.edges.size());
+			topo.edges.push_back(e);
+		}
+	}
+
+	static const double INTRA_CAPACITY[] = { 1000.0, 2500.0, 10000.0 };
+	static const double INTER_COMMIT[] = { 500.0, 1000.0, 2000.0 };
+
+	unsigned int n = topo.edges.size();
+	topo.srcs.resize(n);
+	topo.dsts.resize(n);
+	topo.interdomain.resize(n);
+	topo.capacity.resize(n);
+	topo.background.resize(n);
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		NetVertex v_src, v_dst;
+		state.get_edge_vert(topo.edges[i], v_src, v_dst, lock);
+		topo.srcs[i] = state.get_pid(v_src, lock);
+		topo.dsts[i] = state.get_pid(v_dst, lock);
+		topo.interdomain[i] = state.get_external(v_src, lock) || state.get_external(v_dst, lock);
+		topo.capacity[i] = topo.interdomain[i] ? INTER_COMMIT[rnd.uniform(3u)] : INTRA_CAPACITY[rnd.uniform(3u)];
+		topo.background[i] = topo.capacity[i] * rnd.uniform(0.2, 0.7);
+		state.set_capacity(topo.edges[i], topo.capacity[i], lock);
+	}
+
+	/* movable demands are shared among edges of the same kind */
+	std::vector<unsigned int>* kinds[] = { &intra, &inter };
+	for (unsigned int k = 0; k < 2; ++k)
+	{
+		std::vector<unsigned int>& v = *kinds[k];
+		for (unsigned int i = v.size(); i > 1; --i)
+			std::swap(v[i - 1], v[rnd.uniform(i)]);
+		for (unsigned int i = 0; i + GROUP_SIZE <= v.size(); i += GROUP_SIZE)
+		{
+			double sum_c = 0.0;
+			for (unsigned int j = i; j < i + GROUP_SIZE; ++j)
+			{
+				topo.group_edges.push_back(v[j]);
+				sum_c += topo.capacity[v[j]];
+			}
+			topo.group_demand.push_back(sum_c * rnd.uniform(0.1, 0.4));
+		}
+	}
+}
+
+static void apply_traffic(NetState& state, const WritableLock& lock, const BenchTopology& topo,
+			  const std::vector<double>& pdistance, std::vector<double>& share)
+{
+	std::vector<double> traffic(topo.background);
+
+	/*
+	 * Each movable demand prefers its edges in proportion to capacity,
+	 * discounted by the edge's pdistance relative to the largest one
+	 * (pdistance scales differ between plugins). Only part of the
+	 * demand moves towards that preference on each update, as peers
+	 * re-select gradually.
+	 */
+	double max_p = 0.0;
+	for (unsigned int i = 0; i < pdistance.size(); ++i)
+		max_p = std::max(max_p, pdistance[i]);
+	double scale = max_p > 1e-12 ? BETA / max_p : 0.0;
+
+	double w[GROUP_SIZE];
+	for (unsigned int g = 0; g < topo.group_demand.size(); ++g)
+	{
+		const unsigned int* edges = &topo.group_edges[g * GROUP_SIZE];
+		double* s = &share[g * GROUP_SIZE];
+
+		double sum_w = 0.0;
+		for (unsigned int j = 0; j < GROUP_SIZE; ++j)
+		{
+			w[j] = topo.capacity[edges[j]] * std::exp(-scale * pdistance[edges[j]]);
+			sum_w += w[j];
+		}
+		for (unsigned int j = 0; j < GROUP_SIZE; ++j)
+		{
+			s[j] = (1.0 - GAMMA) * s[j] + GAMMA * w[j] / sum_w;
+			traffic[edges[j]] += topo.group_demand[g] * s[j];
+		}
+	}
+
+	for (unsigned int i = 0; i < topo.edges.size(); ++i)
+		state.set_traffic(topo.edges[i], traffic[i], lock);
+}
+
+static BenchObjectives measure(const NetState& state, const ReadableLock& lock, const BenchTopology& topo)
+{
+	BenchObjectives o = { 0.0, 0.0, 0.0 };
+	for (unsigned int i = 0; i < topo.edges.size(); ++i)
+	{
+		double t_e = state.get_traffic(topo.edges[i], lock);
+		double c_e = topo.capacity[i];
+		double excess = t_e > c_e ? t_e - c_e : 0.0;
+		o.mlu = std::max(o.mlu, t_e / c_e);
+		if (topo.interdomain[i])
+			o.overage += excess;
+		else
+			o.volume += excess;
+	}
+	return o;
+}
+
+static unsigned int converged_at(const std::vector<double>& series)
+{
+	double final = series.back();
+	double tol = std::max(std::max(std::fabs(final), std::fabs(series.front())) * CONVERGED, 1e-9);
+	unsigned int at = series.size();
+	while (at > 0 && std::fabs(series[at - 1] - final) <= tol)
+		--at;
+	return at;
+}
+
+static void run_plugin(const std::string& name, const BenchTopology& topo, NetState& state, unsigned int updates)
+{
+	OptPluginBasePtr plugin = OptPluginRegistry::Instance().get_instance(name);
+	if (!plugin)
+	{
+		std::cerr << "plugin '" << name << "' is not registered" << std::endl;
+		return;
+	}
+
+	PinnedPIDSet pids;
+
+	BlockWriteLock state_lock(state);
+	std::vector<double> pdistance(topo.edges.size(), 0.0);
+	std::vector<double> share(topo.group_edges.size(), 0.0);
+	for (unsigned int g = 0; g < topo.group_demand.size(); ++g)
+	{
+		double sum_c = 0.0;
+		for (unsigned int j = 0; j < GROUP_SIZE; ++j)
+			sum_c += topo.capacity[topo.group_edges[g * GROUP_SIZE + j]];
+		for (unsigned int j = 0; j < GROUP_SIZE; ++j)
+			share[g * GROUP_SIZE + j] = topo.capacity[topo.group_edges[g * GROUP_SIZE + j]] / sum_c;
+	}
+	apply_traffic(state, state_lock, topo, pdistance, share);
+
+	/* index 0 holds the objectives before the first update */
+	BenchObjectives o = measure(state, state_lock, topo);
+	std::vector<double> mlu(1, o.mlu), volume(1, o.volume), overage(1, o.overage);
+	double total_usec = 0.0;
+	double max_usec = 0.0;
+	for (unsigned int u = 1; u <= updates; ++u)
+	{
+		bpt::ptime start = bpt::microsec_clock::universal_time();
+		int rc = plugin->compute_pdistances(state, state_lock, pids);
+		double usec = (bpt::microsec_clock::universal_time() - start).total_microseconds();
+		if (rc != 0)
+		{
+			std::cerr << name << ": update " << u << " failed" << std::endl;
+			return;
+		}
+		total_usec += usec;
+		max_usec = std::max(max_usec, usec);
+
+		{
+			const SparsePIDMatrix* result = static_cast<const OptPluginBase&>(*plugin).get_edge_pdistances();
+			BlockReadLock result_lock(*result);
+			for (unsigned int i = 0; i < topo.edges.size(); ++i)
+				pdistance[i] = result->get_by_pid(topo.srcs[i], topo.dsts[i], result_lock, 0.0);
+		}
+
+		apply_traffic(state, state_lock, topo, pdistance, share);
+		o = measure(state, state_lock, topo);
+		mlu.push_back(o.mlu);
+		volume.push_back(o.volume);
+		overage.push_back(o.overage);
+
+		std::cout << "update " << name
+			  << " " << u
+			  << " usec=" << usec
+			  << " mlu=" << o.mlu
+			  << " volume=" << o.volume
+			  << " overage=" << o.overage
+			  << std::endl;
+	}
+
+	std::cout << "summary " << name
+		  << " updates=" << updates
+		  << " mean_ms=" << total_usec / updates / 1000.0
+		  << " max_ms=" << max_usec / 1000.0
+		  << " mlu=" << mlu.front() << "->" << mlu.back() << "@" << converged_at(mlu)
+		  << " volume=" << volume.front() << "->" << volume.back() << "@" << converged_at(volume)
+		  << " overage=" << overage.front() << "->" << overage.back() << "@" << converged_at(overage)
+		  << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 6)
+	{
+		std::cerr << "Usage: " << argv[0] << " [nodes [edges [external-nodes [updates [seed]]]]]" << std::endl;
+		return 1;
+	}
+
+	unsigned int num_nodes    = argc > 1 ? boost::lexical_cast<unsigned int>(argv[1]) : 2000;
+	unsigned int num_edges    = argc > 2 ? boost::lexical_cast<unsigned int>(argv[2]) : 10000;
+	unsigned int num_external = argc > 3 ? boost::lexical_cast<unsigned int>(argv[3]) : num_nodes / 50;
+	unsigned int updates      = argc > 4 ? boost::lexical_cast<unsigned int>(argv[4]) : 50;
+	unsigned int seed         = argc > 5 ? boost::lexical_cast<unsigned int>(argv[5]) : 1;
+
+	if (num_external + 2 > num_nodes || updates == 0)
+	{
+		std::cerr << "need at least two internal nodes and one update" << std::endl;
+		return 1;
+	}
+
+	init_logger(1, "");
+
+	NetState state;
+	BenchTopology topo;
+	{
+		BlockWriteLock lock(state);
+		build_topology(state, lock, topo, num_nodes, num_edges, num_external, seed);
+	}
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "topology nodes=" << num_nodes
+		  << " edges=" << topo.edges.size()
+		  << " external=" << num_external
+		  << " groups=" << topo.group_demand.size()
+		  << " seed=" << seed
+		  << std::endl;
+
+	std::vector<std::string> plugins = OptPluginRegistry::Instance().get_list();
+	std::sort(plugins.begin(), plugins.end());
+	BOOST_FOREACH(const std::string& name, plugins)
+		run_plugin(name, topo, state, updates);
+
+	return 0;
+}
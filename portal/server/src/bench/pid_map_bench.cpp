@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/*
+ * Benchmark for enumerating a large PID map.
+ *
+ * Fills a PID map with synthetic /24 prefixes spread over a number of
+ * PIDs, and times what the network map handlers do with it: listing the
+ * prefixes of all PIDs, and the prefixes of single PIDs. Each is timed
+ * walking the prefix tree on every request, as was done before the
+ * prefix table, and served from the table, which is built once per
+ * version of the map and shared by the requests and copies of the map.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <p4p/detail/patricia_trie.h>
+#include <p4pserver/pid_map.h>
+
+namespace bpt = boost::posix_time;
+
+typedef std::vector<std::pair<p4p::PID, std::vector<p4p::IPPrefix> > > PIDPrefixList;
+
+/* Consecutive /24 prefixes starting at 10.0.0.0, assigned to PIDs in turn */
+static p4p::IPPrefix make_prefix(unsigned int n)
+{
+	uint32_t a = htonl((10U << 24) + n * 256);
+	return p4p::IPPrefix(AF_INET, &a, 24);
+}
+
+static double elapsed_usec(const bpt::ptime& start)
+{
+	return (bpt::microsec_clock::universal_time() - start).total_microseconds();
+}
+
+static void report(const std::string& name, unsigned int requests, double usec)
+{
+	std::cout << name
+		  << " requests=" << requests
+		  << " usec_per_request=" << usec / requests
+		  << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int prefixes = argc > 1 ? boost::lexical_cast<unsigned int>(argv[1]) : 500000;
+	unsigned int pids = argc > 2 ? boost::lexical_cast<unsigned int>(argv[2]) : 5000;
+	unsigned int requests = argc > 3 ? boost::lexical_cast<unsigned int>(argv[3]) : 10;
+	unsigned int lookups = argc > 4 ? boost::lexical_cast<unsigned int>(argv[4]) : 100;
+
+	/* The map served by the portal, and a bare tree with the same contents */
+	PIDMapPtr pidmap(new PIDMap());
+	p4p::detail::PatriciaTrie<p4p::PID> tree;
+	{
+		BlockWriteLock lock(*pidmap);
+		for (unsigned int i = 0; i < prefixes; ++i)
+		{
+			p4p::PID pid("bench", i % pids + 1, false);
+			pidmap->add(make_prefix(i), pid, lock);
+			tree.add(make_prefix(i), pid);
+		}
+	}
+
+	BlockReadLock lock(*pidmap);
+
+	/* All PIDs, walking the tree on each request */
+	unsigned long long total = 0;
+	bpt::ptime start = bpt::microsec_clock::universal_time();
+	for (unsigned int r = 0; r < requests; ++r)
+	{
+		PIDPrefixList result;
+		tree.enumerate(result);
+		total += result.size();
+	}
+	report("enumerate tree", requests, elapsed_usec(start));
+
+	/* All PIDs from the table; the first request builds it */
+	start = bpt::microsec_clock::universal_time();
+	PIDPrefixTableConstPtr table = pidmap->get_table(lock);
+	double build_usec = elapsed_usec(start);
+	start = bpt::microsec_clock::universal_time();
+	for (unsigned int r = 0; r < requests; ++r)
+		total += pidmap->get_table(lock)->get_entries().size();
+	report("enumerate table", requests, elapsed_usec(start));
+	std::cout << "table build_usec=" << build_usec
+		  << " pids=" << table->get_entries().size()
+		  << " prefixes=" << table->get_num_prefixes()
+		  << std::endl;
+
+	/* A copy of an unchanged map shares its table */
+	PIDMapPtr copy = boost::dynamic_pointer_cast<PIDMap>(pidmap->copy(lock));
+	{
+		BlockReadLock copy_lock(*copy);
+		std::cout << "copy shares_table=" << (copy->get_table(copy_lock) == table) << std::endl;
+	}
+
+	/* Prefixes of single PIDs */
+	p4p::IPPrefixVector result;
+	start = bpt::microsec_clock::universal_time();
+	for (unsigned int l = 0; l < lookups; ++l)
+	{
+		tree.get_prefixes(p4p::PID("bench", l % pids + 1, false), result);
+		total += result.size();
+	}
+	report("get_prefixes tree", lookups, elapsed_usec(start));
+
+	start = bpt::microsec_clock::universal_time();
+	for (unsigned int l = 0; l < lookups; ++l)
+	{
+		pidmap->get_prefixes(p4p::PID("bench", l % pids + 1, false), result, lock);
+		total += result.size();
+	}
+	report("get_prefixes table", lookups, elapsed_usec(start));
+
+	/* Keeps the loops from being optimized away */
+	std::cerr << "checksum=" << total << std::endl;
+	return 0;
+}
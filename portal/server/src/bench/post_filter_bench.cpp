@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Micro-benchmark for parsing filtered cost map and endpoint cost
+ * request bodies.
+ *
+ * Compares the streaming parser used by the request handlers against
+ * building a JSON document and walking it into sets of strings, which is
+ * how bodies were parsed before. Both paths start from a copy of the
+ * body, as the handlers do.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include "post_filters.h"
+
+namespace bpt = boost::posix_time;
+
+/* Number of alternating rounds for each size */
+static const unsigned int ROUNDS = 7;
+
+static std::string make_body(const std::string& field, unsigned int names, bool endpoints)
+{
+	std::ostringstream body;
+	body << "{ \"cost-mode\": \"numerical\", \"cost-type\": \"routingcost\",\n"
+	     << "  \"constraints\": [ \"ge1\", \"lt100.5\" ],\n"
+	     << "  \"" << field << "\": {\n";
+	const char* lists[] = { "srcs", "dsts" };
+	for (unsigned int l = 0; l < 2; ++l)
+	{
+		body << "    \"" << lists[l] << "\": [";
+		for (unsigned int i = 0; i < names; ++i)
+		{
+			unsigned int n = (i * 7919 + l) % names;
+			if (i > 0)
+				body << ", ";
+			if (endpoints)
+				body << "\"ipv4:10." << n / 65536 << "." << n / 256 % 256 << "." << n % 256 << "\"";
+			else
+				body << "\"PID" << n << ".isp" << "\"";
+		}
+		body << "]" << (l == 0 ? "," : "") << "\n";
+	}
+	body << "  }\n}\n";
+	return body.str();
+}
+
+/* How bodies were parsed before: a document, then sets of strings */
+static ALTOErrorCode dom_read(const std::string& body, const std::string& field,
+			      std::set<std::string>& srcs, std::set<std::string>& dsts)
+{
+	Object obj;
+	std::stringstream ss(std::stringstream::in | std::stringstream::out);
+	ss << body;
+	try
+	{
+		Reader::Read(obj, ss);
+	}
+	catch (...)
+	{
+		return E_SYNTAX;
+	}
+
+	if (obj.Find(field) == obj.End() || obj.Find(field)->type != ET_OBJECT)
+		return E_JSON_FIELD_MISSING;
+
+	Array& cons = obj["constraints"];
+	for (size_t i = 0; i < cons.Size(); i++)
+	{
+		std::string& c = ((String&)cons[i]).Value();
+		std::strtod(c.substr(2, c.size() - 2).c_str(), NULL);
+	}
+
+	Object& mat = obj[field];
+	Array& s = mat["srcs"];
+	Array& d = mat["dsts"];
+	for (size_t i = 0; i < s.Size(); i++)
+		srcs.insert(((String&)s[i]).Value());
+	for (size_t i = 0; i < d.Size(); i++)
+		dsts.insert(((String&)d[i]).Value());
+	return E_OK;
+}
+
+/* Returns microseconds per parse */
+static double run_dom(const std::string& body, const std::string& field, unsigned int iterations)
+{
+	bpt::ptime start = bpt::microsec_clock::universal_time();
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		std::string copy(body);
+		std::set<std::string> srcs, dsts;
+		if (dom_read(copy, field, srcs, dsts) != E_OK)
+			throw std::runtime_error("DOM parse failed");
+	}
+	return (bpt::microsec_clock::universal_time() - start).total_microseconds() / (double)iterations;
+}
+
+static double run_streaming(const std::string& body, bool endpoints, unsigned int iterations)
+{
+	bpt::ptime start = bpt::microsec_clock::universal_time();
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		std::string copy(body);
+		ALTOErrorCode code;
+		if (endpoints)
+		{
+			JsonEndPointsCost filter;
+			code = filter.readJson(copy);
+		}
+		else
+		{
+			JsonPIDMatrix filter;
+			code = filter.readJson(copy);
+		}
+		if (code != E_OK)
+			throw std::runtime_error("streaming parse failed");
+	}
+	return (bpt::microsec_clock::universal_time() - start).total_microseconds() / (double)iterations;
+}
+
+/* The fastest round is the least disturbed by the rest of the system */
+static double fastest(const std::vector<double>& v)
+{
+	return *std::min_element(v.begin(), v.end());
+}
+
+static void bench(const std::string& name, unsigned int names, bool endpoints, unsigned int budget)
+{
+	std::string field = endpoints ? "endpoints" : "pids";
+	std::string body = make_body(field, names, endpoints);
+
+	/* Roughly constant work per round, whatever the body size */
+	unsigned int iterations = std::max(budget / names, 1u);
+
+	/* Check that both paths read the same names */
+	{
+		std::string copy(body);
+		std::set<std::string> srcs, dsts;
+		dom_read(copy, field, srcs, dsts);
+
+		std::string copy2(body);
+		JsonPIDMatrix pids;
+		JsonEndPointsCost eps;
+		JsonNameSet& s = endpoints ? eps.getEndPointsSrcs() : pids.getPIDSrcs();
+		if (endpoints)
+			eps.readJson(copy2);
+		else
+			pids.readJson(copy2);
+
+		std::set<std::string>::const_iterator itr = srcs.begin();
+		for (size_t i = 0; i < s.size(); ++i, ++itr)
+			if (itr == srcs.end() || *itr != std::string(s[i], s.getLength(i)))
+				throw std::runtime_error("parsers disagree");
+		if (itr != srcs.end())
+			throw std::runtime_error("parsers disagree");
+	}
+
+	std::vector<double> dom, streaming;
+	for (unsigned int r = 0; r < ROUNDS; ++r)
+	{
+		/* Alternate which parser goes first, so neither benefits from a warmer cache */
+		if (r % 2 == 0)
+			dom.push_back(run_dom(body, field, iterations));
+		streaming.push_back(run_streaming(body, endpoints, iterations));
+		if (r % 2 == 1)
+			dom.push_back(run_dom(body, field, iterations));
+	}
+
+	double d = fastest(dom);
+	double s = fastest(streaming);
+	std::cout << name
+		  << " names=" << names
+		  << " bytes=" << body.size()
+		  << " dom_usec=" << d
+		  << " streaming_usec=" << s
+		  << " speedup=" << d / s
+		  << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int max_names = argc > 1 ? boost::lexical_cast<unsigned int>(argv[1]) : 10000;
+	unsigned int budget = argc > 2 ? boost::lexical_cast<unsigned int>(argv[2]) : 200000;
+
+	for (unsigned int names = 10; names <= max_names; names *= 10)
+	{
+		bench("costmap-filtered", names, false, budget);
+		bench("endpoint-cost", names, true, budget);
+	}
+
+	return 0;
+}
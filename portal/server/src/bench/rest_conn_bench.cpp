@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Connection scaling benchmark for the REST interface.
+ *
+ * Starts a REST interface on the loopback address in each connection
+ * mode, opens a number of keep-alive connections that each make one
+ * request and then sit idle, and keeps a small number of them busy
+ * with back-to-back requests. Reports how many connections the server
+ * accepted and the request rate and latency of the busy connections,
+ * which shows what the idle connections cost each mode.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include <p4pserver/protocol_server_rest.h>
+
+namespace bpt = boost::posix_time;
+
+static const unsigned short PORT = 16671;
+
+/* Descriptors reserved for everything other than the connections */
+static const unsigned int RESERVED_FDS = 128;
+
+static const char REQUEST[] = "GET /ok HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+static void finish_ok(void* server, RESTRequestState* state, void* data)
+{
+	state->set_text_response(MHD_HTTP_OK, "ok");
+}
+
+/* Answers every request with a fixed body, so only connection handling is measured */
+class OkHandler
+{
+public:
+	typedef ProtocolServerREST<1, OkHandler> Server;
+
+	int operator()(Server* server, RESTRequestState* state) const
+	{
+		state->set_callbacks(&finish_ok);
+		return MHD_YES;
+	}
+};
+
+/* Client side of the benchmark; drives all connections from one epoll set */
+class LoadClient
+{
+public:
+	LoadClient(unsigned int clients)
+		: epfd_(epoll_create(1024)), conns_(clients)
+	{
+		if (epfd_ < 0)
+			throw std::runtime_error("epoll_create failed");
+	}
+
+	~LoadClient()
+	{
+		for (unsigned int i = 0; i < conns_.size(); ++i)
+			close_conn(i);
+		close(epfd_);
+	}
+
+	/* Connect every client and make one request on each; returns the
+	 * number of connections that were answered */
+	unsigned int open(unsigned int timeout_ms)
+	{
+		sockaddr_in sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family = AF_INET;
+		sa.sin_port = htons(PORT);
+		sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		for (unsigned int i = 0; i < conns_.size(); ++i)
+		{
+			Conn& c = conns_[i];
+			c.fd = socket(AF_INET, SOCK_STREAM, 0);
+			if (c.fd < 0)
+			{
+				c.failed = true;
+				continue;
+			}
+			int one = 1;
+			setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+			fcntl(c.fd, F_SETFL, fcntl(c.fd, F_GETFL) | O_NONBLOCK);
+			if (connect(c.fd, (sockaddr*)&sa, sizeof(sa)) != 0 && errno != EINPROGRESS)
+			{
+				close_conn(i);
+				continue;
+			}
+			c.connecting = true;
+			c.busy = true;
+			c.start = bpt::microsec_clock::universal_time();
+
+			epoll_event ev;
+			ev.events = EPOLLOUT | EPOLLIN;
+			ev.data.u32 = i;
+			epoll_ctl(epfd_, EPOLL_CTL_ADD, c.fd, &ev);
+		}
+
+		bpt::ptime deadline = bpt::microsec_clock::universal_time() + bpt::milliseconds(timeout_ms);
+		while (in_flight() > 0 && bpt::microsec_clock::universal_time() < deadline)
+			poll(100);
+
+		/* Anything still waiting was not served in time */
+		unsigned int answered = 0;
+		for (unsigned int i = 0; i < conns_.size(); ++i)
+		{
+			if (conns_[i].busy)
+				close_conn(i);
+			if (!conns_[i].failed)
+				++answered;
+		}
+		return answered;
+	}
+
+	/* Keep 'active' connections busy for the given time */
+	void run(unsigned int active, unsigned int seconds, unsigned long& requests, double& latency_usec)
+	{
+		requests_ = 0;
+		latency_usec_ = 0;
+
+		bpt::ptime now = bpt::microsec_clock::universal_time();
+		deadline_ = now + bpt::seconds(seconds);
+		for (unsigned int i = 0, n = 0; i < conns_.size() && n < active; ++i)
+		{
+			if (conns_[i].failed)
+				continue;
+			send_request(i, now);
+			++n;
+		}
+
+		/* Let outstanding requests finish after the deadline */
+		bpt::ptime drain = deadline_ + bpt::seconds(5);
+		while (in_flight() > 0 && bpt::microsec_clock::universal_time() < drain)
+			poll(100);
+
+		requests = requests_;
+		latency_usec = latency_usec_;
+	}
+
+private:
+	struct Conn
+	{
+		Conn() : fd(-1), connecting(false), busy(false), failed(false) {}
+
+		int fd;
+		bool connecting;
+		bool busy;
+		bool failed;
+		bpt::ptime start;
+		std::string buf;
+	};
+
+	unsigned int in_flight() const
+	{
+		unsigned int n = 0;
+		for (unsigned int i = 0; i < conns_.size(); ++i)
+			n += conns_[i].busy ? 1 : 0;
+		return n;
+	}
+
+	void close_conn(unsigned int i)
+	{
+		Conn& c = conns_[i];
+		if (c.fd >= 0)
+			close(c.fd);
+		c.fd = -1;
+		c.busy = false;
+		c.failed = true;
+	}
+
+	void send_request(unsigned int i, const bpt::ptime& now)
+	{
+		Conn& c = conns_[i];
+		c.busy = true;
+		c.start = now;
+		if (write(c.fd, REQUEST, sizeof(REQUEST) - 1) != (ssize_t)(sizeof(REQUEST) - 1))
+			close_conn(i);
+	}
+
+	/* Read what is available; returns true once a whole response is in */
+	bool read_response(unsigned int i)
+	{
+		Conn& c = conns_[i];
+		char tmp[4096];
+		while (true)
+		{
+			ssize_t n = read(c.fd, tmp, sizeof(tmp));
+			if (n > 0)
+			{
+				c.buf.append(tmp, n);
+				continue;
+			}
+			if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+				break;
+			close_conn(i);
+			return false;
+		}
+
+		std::string::size_type end = c.buf.find("\r\n\r\n");
+		if (end == std::string::npos)
+			return false;
+
+		unsigned long length = 0;
+		for (std::string::size_type p = c.buf.find("\r\n"); p < end; p = c.buf.find("\r\n", p + 2))
+		{
+			static const char HDR[] = "content-length:";
+			if (strncasecmp(c.buf.c_str() + p + 2, HDR, sizeof(HDR) - 1) == 0)
+				length = strtoul(c.buf.c_str() + p + 2 + sizeof(HDR) - 1, NULL, 10);
+		}
+		if (c.buf.size() < end + 4 + length)
+			return false;
+
+		c.buf.erase(0, end + 4 + length);
+		return true;
+	}
+
+	void poll(int timeout_ms)
+	{
+		epoll_event events[256];
+		int n = epoll_wait(epfd_, events, 256, timeout_ms);
+		bpt::ptime now = bpt::microsec_clock::universal_time();
+		for (int e = 0; e < n; ++e)
+		{
+			unsigned int i = events[e].data.u32;
+			Conn& c = conns_[i];
+			if (c.fd < 0)
+				continue;
+
+			if (c.connecting)
+			{
+				int err = 0;
+				socklen_t len = sizeof(err);
+				if (!(events[e].events & EPOLLOUT))
+					continue;
+				if (getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0)
+				{
+					close_conn(i);
+					continue;
+				}
+				c.connecting = false;
+
+				epoll_event ev;
+				ev.events = EPOLLIN;
+				ev.data.u32 = i;
+				epoll_ctl(epfd_, EPOLL_CTL_MOD, c.fd, &ev);
+				send_request(i, c.start);
+				continue;
+			}
+
+			if (!c.busy)
+			{
+				/* The server closed an idle connection */
+				read_response(i);
+				continue;
+			}
+
+			if (!read_response(i))
+				continue;
+
+			c.busy = false;
+			if (deadline_.is_not_a_date_time())
+				continue;
+
+			++requests_;
+			latency_usec_ += (now - c.start).total_microseconds();
+			if (now < deadline_)
+				send_request(i, now);
+		}
+	}
+
+	int epfd_;
+	std::vector<Conn> conns_;
+	bpt::ptime deadline_;
+	unsigned long requests_;
+	double latency_usec_;
+};
+
+static void bench(ProtocolServerRESTBase::ConnectionMode mode, unsigned int clients,
+		  unsigned int active, unsigned int seconds, unsigned int threads)
+{
+	OkHandler::Server server("", PORT, threads, "", "",
+				 0, clients + RESERVED_FDS, 0,
+				 mode, 4096, 0);
+	server.enable_all();
+	server.start();
+	boost::this_thread::sleep(bpt::milliseconds(200));
+
+	unsigned int connected;
+	double setup_ms;
+	unsigned long requests;
+	double latency_usec;
+	{
+		LoadClient client(clients);
+
+		bpt::ptime start = bpt::microsec_clock::universal_time();
+		connected = client.open(30000);
+		setup_ms = (bpt::microsec_clock::universal_time() - start).total_microseconds() / 1000.0;
+
+		client.run(std::min(active, connected), seconds, requests, latency_usec);
+	}
+
+	std::cout << "mode=" << ProtocolServerRESTBase::get_mode_name(server.get_mode())
+		  << " clients=" << clients
+		  << " connected=" << connected
+		  << " setup_ms=" << setup_ms
+		  << " active=" << std::min(active, connected)
+		  << " requests_per_sec=" << requests / (double)seconds
+		  << " usec_per_request=" << (requests ? latency_usec / requests : 0)
+		  << std::endl;
+
+	server.stop();
+	server.join();
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int max_clients = argc > 1 ? boost::lexical_cast<unsigned int>(argv[1]) : 10000;
+	unsigned int active = argc > 2 ? boost::lexical_cast<unsigned int>(argv[2]) : 64;
+	unsigned int seconds = argc > 3 ? boost::lexical_cast<unsigned int>(argv[3]) : 3;
+	unsigned int threads = argc > 4 ? boost::lexical_cast<unsigned int>(argv[4]) : 4;
+
+	/* Both ends of every connection live in this process */
+	struct rlimit rl;
+	getrlimit(RLIMIT_NOFILE, &rl);
+	rl.rlim_cur = rl.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &rl);
+	getrlimit(RLIMIT_NOFILE, &rl);
+	if (rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur < 2 * max_clients + RESERVED_FDS)
+	{
+		max_clients = rl.rlim_cur > RESERVED_FDS ? (rl.rlim_cur - RESERVED_FDS) / 2 : 0;
+		std::cerr << "descriptor limit " << rl.rlim_cur << " allows only " << max_clients << " clients" << std::endl;
+	}
+
+	std::vector<unsigned int> levels;
+	for (unsigned int c = 100; c < max_clients; c *= 10)
+		levels.push_back(c);
+	levels.push_back(max_clients);
+
+	ProtocolServerRESTBase::ConnectionMode modes[] = {
+		ProtocolServerRESTBase::MODE_SELECT,
+		ProtocolServerRESTBase::MODE_POLL,
+		ProtocolServerRESTBase::MODE_EPOLL,
+		ProtocolServerRESTBase::MODE_THREAD_PER_CONNECTION,
+	};
+	for (unsigned int m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m)
+		for (unsigned int l = 0; l < levels.size(); ++l)
+			bench(modes[m], levels[l], active, seconds, threads);
+
+	return 0;
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Micro-benchmark for the REST request metrics.
+ *
+ * Runs the body of the network map handler (building and serializing a
+ * map of synthetic PIDs) from several threads, alternating rounds with
+ * and without the accounting the REST server performs for each request,
+ * and reports the per-request cost and overhead of the instrumentation.
+ * Since the measured overhead is easily lost in scheduling noise, the
+ * cost of the recording alone is also reported as a share of each
+ * request ('record_pct').
+ * A small and a large map are measured, since the overhead is fixed per
+ * request and matters most for cheap requests.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include <p4pserver/rest_metrics.h>
+#include "info_resource_entity.h"
+#include "network_map.h"
+
+namespace bpt = boost::posix_time;
+
+/* Number of alternating rounds for each mode */
+static const unsigned int ROUNDS = 7;
+
+/* Iterations used to measure the cost of recording alone */
+static const unsigned int RECORD_ITERATIONS = 1000000;
+
+typedef std::vector<std::pair<std::string, std::string> > PrefixList;
+
+static PrefixList make_prefixes(unsigned int pids, unsigned int prefixes_per_pid)
+{
+	PrefixList result;
+	for (unsigned int p = 0; p < pids; ++p)
+	{
+		std::string pid = "pid" + boost::lexical_cast<std::string>(p);
+		for (unsigned int i = 0; i < prefixes_per_pid; ++i)
+		{
+			unsigned int n = p * prefixes_per_pid + i;
+			std::ostringstream ip;
+			ip << (10 + n / 65536) << "." << (n / 256 % 256) << "." << (n % 256) << ".0/24";
+			result.push_back(std::make_pair(pid, ip.str()));
+		}
+	}
+	return result;
+}
+
+/* Same work as GetNetMapProcess, without the view lookup */
+static std::string handle_netmap(const PrefixList& prefixes)
+{
+	InfoResourceNetworkMap netmap;
+	netmap.setVerTag("1266506139");
+	for (PrefixList::const_iterator itr = prefixes.begin(); itr != prefixes.end(); ++itr)
+		netmap.addIP(itr->first, itr->second);
+	netmap.commit();
+
+	InfoResourceEntity ire;
+	InfoResourceMetaData meta;
+	ire.setMeta(meta);
+	ire.setData(netmap);
+	return ire.toJson();
+}
+
+class RequestRunner
+{
+public:
+	RequestRunner(const PrefixList& prefixes, unsigned int requests, RESTMetrics* metrics, unsigned int handler)
+		: prefixes_(prefixes), requests_(requests), metrics_(metrics), handler_(handler)
+	{}
+
+	void operator()() const
+	{
+		for (unsigned int i = 0; i < requests_; ++i)
+		{
+			if (metrics_)
+			{
+				/* What the REST server records for every request */
+				bpt::ptime start = bpt::microsec_clock::universal_time();
+				std::string body = handle_netmap(prefixes_);
+				metrics_->record_bytes_out(handler_, body.size());
+				bpt::time_duration elapsed = bpt::microsec_clock::universal_time() - start;
+				metrics_->record_request(handler_, 200, elapsed.total_microseconds());
+			}
+			else
+				handle_netmap(prefixes_);
+		}
+	}
+
+private:
+	const PrefixList& prefixes_;
+	unsigned int requests_;
+	RESTMetrics* metrics_;
+	unsigned int handler_;
+};
+
+/* Returns the wall-clock time per request in microseconds */
+static double run_round(const PrefixList& prefixes, unsigned int requests, unsigned int threads, RESTMetrics* metrics, unsigned int handler)
+{
+	bpt::ptime start = bpt::microsec_clock::universal_time();
+	boost::thread_group group;
+	for (unsigned int t = 0; t < threads; ++t)
+		group.create_thread(RequestRunner(prefixes, requests, metrics, handler));
+	group.join_all();
+	return (bpt::microsec_clock::universal_time() - start).total_microseconds() / (double)(requests * threads);
+}
+
+/* The fastest round is the least disturbed by the rest of the system */
+static double fastest(const std::vector<double>& v)
+{
+	return *std::min_element(v.begin(), v.end());
+}
+
+static void bench_handler(const std::string& name, unsigned int pids, unsigned int prefixes_per_pid,
+			  unsigned int requests, unsigned int threads, RESTMetrics& metrics, double record_usec)
+{
+	unsigned int handler = RESTMetrics::register_handler(name);
+	PrefixList prefixes = make_prefixes(pids, prefixes_per_pid);
+
+	/* Warm up */
+	run_round(prefixes, std::max(requests / 10, 1u), threads, NULL, handler);
+
+	std::vector<double> base, instrumented;
+	for (unsigned int r = 0; r < ROUNDS; ++r)
+	{
+		/* Alternate which mode goes first, so neither benefits from a warmer cache */
+		if (r % 2 == 0)
+			base.push_back(run_round(prefixes, requests, threads, NULL, handler));
+		instrumented.push_back(run_round(prefixes, requests, threads, &metrics, handler));
+		if (r % 2 == 1)
+			base.push_back(run_round(prefixes, requests, threads, NULL, handler));
+	}
+
+	double b = fastest(base);
+	double i = fastest(instrumented);
+	std::cout << "handler " << name
+		  << " pids=" << pids
+		  << " prefixes=" << prefixes.size()
+		  << " threads=" << threads
+		  << " base_usec=" << b
+		  << " instrumented_usec=" << i
+		  << " overhead_pct=" << (i - b) / b * 100.0
+		  << " record_pct=" << record_usec / (b * threads) * 100.0
+		  << std::endl;
+}
+
+/* Cost of the timestamps and counter updates alone, in microseconds */
+static double bench_record(RESTMetrics& metrics)
+{
+	unsigned int handler = RESTMetrics::register_handler("record");
+	bpt::ptime start = bpt::microsec_clock::universal_time();
+	for (unsigned int n = 0; n < RECORD_ITERATIONS; ++n)
+	{
+		bpt::ptime t = bpt::microsec_clock::universal_time();
+		metrics.record_bytes_out(handler, 100);
+		metrics.record_request(handler, 200, (bpt::microsec_clock::universal_time() - t).total_microseconds());
+	}
+	double ns = (bpt::microsec_clock::universal_time() - start).total_microseconds() * 1000.0 / RECORD_ITERATIONS;
+	std::cout << "record ns_per_request=" << ns << std::endl;
+	return ns / 1000.0;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int pids = argc > 1 ? boost::lexical_cast<unsigned int>(argv[1]) : 1000;
+	unsigned int prefixes_per_pid = argc > 2 ? boost::lexical_cast<unsigned int>(argv[2]) : 4;
+	unsigned int requests = argc > 3 ? boost::lexical_cast<unsigned int>(argv[3]) : 20;
+	unsigned int threads = argc > 4 ? boost::lexical_cast<unsigned int>(argv[4]) : 4;
+
+	RESTMetrics metrics;
+
+	double record_usec = bench_record(metrics);
+	bench_handler("networkmap-small", 10, 1, requests * 100, threads, metrics, record_usec);
+	bench_handler("networkmap", pids, prefixes_per_pid, requests, threads, metrics, record_usec);
+
+	return 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Benchmark for incremental shortest-path maintenance.
+ *
+ * Builds a random directed graph with small integer weights, computes the
+ * shortest-path tree from every node, then applies random single-link
+ * changes (weight raised, weight lowered, link removed, link restored).
+ * Each change is applied once incrementally and once by recomputing every
+ * tree from scratch, as view updates did before. Reports the time per
+ * change for both and checks that the trees agree.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <p4pserver/incremental_shortest_paths.h>
+
+namespace bpt = boost::posix_time;
+
+enum ChangeKind
+{
+	CHANGE_RAISE,
+	CHANGE_LOWER,
+	CHANGE_REMOVE,
+	CHANGE_RESTORE,
+	NUM_CHANGE_KINDS
+};
+
+static const char* CHANGE_NAMES[NUM_CHANGE_KINDS] = { "raise", "lower", "remove", "restore" };
+
+class BenchRandom
+{
+public:
+	BenchRandom(unsigned int seed) : state_(seed) {}
+	unsigned int next(unsigned int n)
+	{
+		state_ = state_ * 1103515245 + 12345;
+		return (state_ >> 8) % n;
+	}
+private:
+	unsigned int state_;
+};
+
+struct Link
+{
+	unsigned int src;
+	unsigned int dst;
+	double weight;
+	bool present;
+};
+
+int main(int argc, char** argv)
+{
+	unsigned int nodes = argc > 1 ? boost::lexical_cast<unsigned int>(argv[1]) : 500;
+	unsigned int degree = argc > 2 ? boost::lexical_cast<unsigned int>(argv[2]) : 4;
+	unsigned int changes = argc > 3 ? boost::lexical_cast<unsigned int>(argv[3]) : 200;
+	unsigned int seed = argc > 4 ? boost::lexical_cast<unsigned int>(argv[4]) : 1;
+
+	BenchRandom rnd(seed);
+	IncrementalShortestPaths paths;
+	std::vector<unsigned int> slots;
+	for (unsigned int i = 0; i < nodes; ++i)
+		slots.push_back(paths.add_node("node" + boost::lexical_cast<std::string>(i)));
+
+	/* A ring keeps the graph connected; the other links are random */
+	std::vector<Link> links;
+	for (unsigned int i = 0; i < nodes; ++i)
+	{
+		for (unsigned int j = 0; j < degree; ++j)
+		{
+			Link link;
+			link.src = slots[i];
+			link.dst = slots[j == 0 ? (i + 1) % nodes : rnd.next(nodes)];
+			link.weight = 1 + rnd.next(10);
+			link.present = true;
+			if (link.src == link.dst)
+				continue;
+			paths.set_edge(link.src, link.dst, link.weight);
+			links.push_back(link);
+		}
+	}
+
+	bpt::ptime start = bpt::microsec_clock::universal_time();
+	for (unsigned int i = 0; i < nodes; ++i)
+		paths.get_tree(slots[i]);
+	double initial_usec = (bpt::microsec_clock::universal_time() - start).total_microseconds();
+
+	std::cout << "graph nodes=" << paths.get_num_nodes()
+		  << " edges=" << paths.get_num_edges()
+		  << " initial_ms=" << initial_usec / 1000
+		  << std::endl;
+
+	double incremental_usec[NUM_CHANGE_KINDS] = { 0 };
+	double full_usec[NUM_CHANGE_KINDS] = { 0 };
+	unsigned int counts[NUM_CHANGE_KINDS] = { 0 };
+	unsigned int mismatches = 0;
+	IncrementalShortestPaths::Tree full;
+
+	for (unsigned int c = 0; c < changes; ++c)
+	{
+		Link& link = links[rnd.next(links.size())];
+		ChangeKind kind;
+		if (!link.present)
+			kind = CHANGE_RESTORE;
+		else
+			kind = (ChangeKind)rnd.next(CHANGE_RESTORE);
+
+		/* Apply the change incrementally */
+		start = bpt::microsec_clock::universal_time();
+		switch (kind)
+		{
+		case CHANGE_RAISE:
+			link.weight += 1 + rnd.next(10);
+			paths.set_edge(link.src, link.dst, link.weight);
+			break;
+		case CHANGE_LOWER:
+			link.weight = 1 + rnd.next((unsigned int)link.weight);
+			paths.set_edge(link.src, link.dst, link.weight);
+			break;
+		case CHANGE_REMOVE:
+			link.present = false;
+			paths.remove_edge(link.src, link.dst);
+			break;
+		default:
+			link.present = true;
+			paths.set_edge(link.src, link.dst, link.weight);
+			break;
+		}
+		incremental_usec[kind] += (bpt::microsec_clock::universal_time() - start).total_microseconds();
+		++counts[kind];
+
+		/* And by recomputing every tree */
+		start = bpt::microsec_clock::universal_time();
+		for (unsigned int i = 0; i < nodes; ++i)
+		{
+			paths.compute_tree(slots[i], full);
+			if (full.pred != paths.get_tree(slots[i]).pred)
+				++mismatches;
+		}
+		full_usec[kind] += (bpt::microsec_clock::universal_time() - start).total_microseconds();
+	}
+
+	double incremental_total = 0, full_total = 0;
+	for (unsigned int k = 0; k < NUM_CHANGE_KINDS; ++k)
+	{
+		if (counts[k] == 0)
+			continue;
+		incremental_total += incremental_usec[k];
+		full_total += full_usec[k];
+		std::cout << "change " << CHANGE_NAMES[k]
+			  << " count=" << counts[k]
+			  << " incremental_usec=" << incremental_usec[k] / counts[k]
+			  << " full_usec=" << full_usec[k] / counts[k]
+			  << std::endl;
+	}
+
+	std::cout << "summary changes=" << changes
+		  << " incremental_usec=" << incremental_total / changes
+		  << " full_usec=" << full_total / changes
+		  << " speedup=" << (incremental_total > 0 ? full_total / incremental_total : 0)
+		  << " repairs=" << paths.get_repairs()
+		  << " mismatches=" << mismatches
+		  << std::endl;
+
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+/*
+ * Throughput benchmark for bulk traffic ingest.
+ *
+ * Builds a topology of synthetic links and generates records spread
+ * over them (as from per-flow exports), in both the text and binary
+ * formats. Each input is loaded twice: through TrafficIngest, which
+ * sums the records apart from the NetState and applies the totals under
+ * one write lock, and record by record, taking the write lock and
+ * looking up the link for each record as a series of per-link updates
+ * would. Reports records per second and how long the NetState was
+ * locked for writing.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <p4pserver/net_state.h>
+#include <p4pserver/traffic_ingest.h>
+
+namespace bpt = boost::posix_time;
+
+static const size_t CHUNK_SIZE = 64 * 1024;
+
+static std::string link_name(unsigned int i)
+{
+	return "link-" + boost::lexical_cast<std::string>(i);
+}
+
+/* Nodes in a ring, each linked to the next node and to one further on */
+static void make_topology(NetState& net, unsigned int links)
+{
+	BlockWriteLock lock(net);
+	unsigned int nodes = (links + 1) / 2;
+	NetVertex v;
+	for (unsigned int i = 0; i < nodes; ++i)
+		net.add_node("node-" + boost::lexical_cast<std::string>(i), v, lock);
+
+	NetEdge e;
+	for (unsigned int i = 0; i < links; ++i)
+	{
+		unsigned int src = i / 2;
+		unsigned int dst = (src + (i % 2 ? 7 : 1)) % nodes;
+		net.add_edge("node-" + boost::lexical_cast<std::string>(src),
+			     "node-" + boost::lexical_cast<std::string>(dst), e, lock);
+		net.set_name(e, link_name(i), lock);
+	}
+}
+
+static void make_input(unsigned int links, unsigned int records, std::string& text, std::string& binary)
+{
+	text.clear();
+	binary.assign(TrafficIngest::BINARY_MAGIC, TrafficIngest::BINARY_MAGIC_LEN);
+
+	unsigned int state = 1;
+	char value[32];
+	for (unsigned int r = 0; r < records; ++r)
+	{
+		state = state * 1103515245 + 12345;
+		std::string name = link_name((state >> 8) % links);
+		unsigned long long bytes = (state >> 4) % 1500000;
+
+		text += name;
+		text += ',';
+		sprintf(value, "%llu\n", bytes);
+		text += value;
+
+		binary += (char)name.size();
+		binary += name;
+		for (int i = 7; i >= 0; --i)
+			binary += (char)((bytes >> (i * 8)) & 0xff);
+	}
+}
+
+static void report(const std::string& name, unsigned int records, double usec, double locked_usec)
+{
+	std::cout << name
+		  << " records=" << records
+		  << " records_per_sec=" << records / usec * 1e6
+		  << " total_ms=" << usec / 1000
+		  << " write_locked_ms=" << locked_usec / 1000
+		  << std::endl;
+}
+
+static void bench_ingest(const std::string& name, NetState& net, const std::string& input, unsigned int records)
+{
+	bpt::ptime start = bpt::microsec_clock::universal_time();
+
+	TrafficIngest ingest;
+	for (size_t pos = 0; pos < input.size(); pos += CHUNK_SIZE)
+		ingest.add_data(input.data() + pos, std::min(CHUNK_SIZE, input.size() - pos));
+	if (!ingest.finish())
+	{
+		std::cerr << name << ": " << ingest.get_error() << std::endl;
+		exit(1);
+	}
+
+	bpt::ptime locked = bpt::microsec_clock::universal_time();
+	{
+		BlockWriteLock lock(net);
+		ingest.apply(net, 1.0, true, lock);
+	}
+	bpt::ptime end = bpt::microsec_clock::universal_time();
+
+	report(name, records, (end - start).total_microseconds(), (end - locked).total_microseconds());
+}
+
+/* One write lock and link lookup per record */
+static void bench_per_record(const std::string& name, NetState& net, const std::string& input, unsigned int records)
+{
+	{
+		BlockWriteLock lock(net);
+		NetEdgeItrPair edges = net.get_edges(lock);
+		for (NetEdgeItr itr = edges.first; itr != edges.second; ++itr)
+			net.set_traffic(*itr, 0, lock);
+	}
+
+	bpt::ptime start = bpt::microsec_clock::universal_time();
+	bpt::time_duration locked;
+
+	std::istringstream is(input);
+	std::string line;
+	while (std::getline(is, line))
+	{
+		std::string::size_type comma = line.find(',');
+		NetEdgeName link = line.substr(0, comma);
+		double value = strtod(line.c_str() + comma + 1, NULL);
+
+		bpt::ptime lock_start = bpt::microsec_clock::universal_time();
+		{
+			BlockWriteLock lock(net);
+			NetEdge e;
+			if (net.get_edge(link, e, lock))
+				net.set_traffic(e, net.get_traffic(e, lock) + value, lock);
+		}
+		locked += bpt::microsec_clock::universal_time() - lock_start;
+	}
+
+	double usec = (bpt::microsec_clock::universal_time() - start).total_microseconds();
+	report(name, records, usec, locked.total_microseconds());
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int links = argc > 1 ? boost::lexical_cast<unsigned int>(argv[1]) : 20000;
+	unsigned int records = argc > 2 ? boost::lexical_cast<unsigned int>(argv[2]) : 2000000;
+
+	NetState net;
+	make_topology(net, links);
+
+	std::string text, binary;
+	make_input(links, records, text, binary);
+	std::cout << "input links=" << links
+		  << " records=" << records
+		  << " text_bytes=" << text.size()
+		  << " binary_bytes=" << binary.size()
+		  << std::endl;
+
+	bench_per_record("per_record_text", net, text, records);
+	bench_ingest("ingest_text", net, text, records);
+	bench_ingest("ingest_binary", net, binary, records);
+	return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Throughput benchmark for the UDP interface.
+ *
+ * Publishes a snapshot of synthetic PIDs and prefixes, starts a UDP
+ * interface on the loopback address, and runs several client threads
+ * looking up random addresses and PID pairs with a range of batch sizes
+ * (queries per call). Reports lookups per second and the time per call.
+ * A batch size of 1 corresponds to a tracker looking up peers one by one.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include <p4p/protocol-portal/udp.h>
+#include "state.h"
+#include "udp_request_handler.h"
+#include "udp_snapshot.h"
+#include "view_registry.h"
+
+namespace bpt = boost::posix_time;
+
+static const unsigned short PORT = 16673;
+
+typedef std::vector<std::pair<p4p::PID, std::vector<p4p::IPPrefix> > > PIDPrefixList;
+
+/* PIDs with consecutive /24 prefixes starting at 10.0.0.0 */
+static PIDPrefixList make_prefixes(unsigned int pids, unsigned int prefixes_per_pid)
+{
+	PIDPrefixList result;
+	for (unsigned int p = 0; p < pids; ++p)
+	{
+		result.push_back(std::make_pair(p4p::PID("bench", p + 1, false), std::vector<p4p::IPPrefix>()));
+		for (unsigned int i = 0; i < prefixes_per_pid; ++i)
+		{
+			unsigned int n = p * prefixes_per_pid + i;
+			std::ostringstream ip;
+			ip << (10 + n / 65536) << "." << (n / 256 % 256) << "." << (n % 256) << ".0";
+			result.back().second.push_back(p4p::IPPrefix(ip.str(), 24));
+		}
+	}
+	return result;
+}
+
+class LookupRunner
+{
+public:
+	LookupRunner(unsigned int num_addrs, unsigned int pids, unsigned int batch, unsigned int calls, bool pdistances, unsigned int seed)
+		: num_addrs_(num_addrs), pids_(pids), batch_(batch), calls_(calls), pdistances_(pdistances), seed_(seed)
+	{}
+
+	void operator()() const
+	{
+		p4p::protocol::portal::UDPPortalProtocol client("127.0.0.1", PORT);
+		unsigned int state = seed_;
+
+		std::vector<p4p::IPPrefix> addrs;
+		p4p::PIDLinkVector pairs;
+		std::vector<p4p::PID> pids;
+		std::vector<uint32_t> pdistances;
+		for (unsigned int c = 0; c < calls_; ++c)
+		{
+			addrs.clear();
+			pairs.clear();
+			pids.clear();
+			pdistances.clear();
+			for (unsigned int i = 0; i < batch_; ++i)
+			{
+				state = state * 1103515245 + 12345;
+				if (pdistances_)
+				{
+					unsigned int src = (state >> 8) % pids_;
+					unsigned int dst = (state >> 20) % pids_;
+					pairs.push_back(std::make_pair(p4p::PID("bench", src + 1, false), p4p::PID("bench", dst + 1, false)));
+				}
+				else
+				{
+					/* Address within the prefixes (host byte order) */
+					uint32_t a = htonl((10U << 24) + (state >> 8) % (num_addrs_ * 256));
+					addrs.push_back(p4p::IPPrefix(AF_INET, &a));
+				}
+			}
+
+			if (pdistances_)
+				client.get_pdistances(pairs, pdistances);
+			else
+				client.get_pids(addrs, pids);
+		}
+	}
+
+private:
+	unsigned int num_addrs_;
+	unsigned int pids_;
+	unsigned int batch_;
+	unsigned int calls_;
+	bool pdistances_;
+	unsigned int seed_;
+};
+
+static void bench(const std::string& name, unsigned int prefixes, unsigned int pids,
+		  unsigned int batch, unsigned int lookups, unsigned int threads, bool pdistances)
+{
+	unsigned int calls = std::max(lookups / batch, 1u);
+
+	bpt::ptime start = bpt::microsec_clock::universal_time();
+	boost::thread_group group;
+	for (unsigned int t = 0; t < threads; ++t)
+		group.create_thread(LookupRunner(prefixes, pids, batch, calls, pdistances, t + 1));
+	group.join_all();
+	double usec = (bpt::microsec_clock::universal_time() - start).total_microseconds();
+
+	std::cout << name
+		  << " batch=" << batch
+		  << " threads=" << threads
+		  << " lookups_per_sec=" << (double)calls * batch * threads / usec * 1e6
+		  << " usec_per_call=" << usec / calls
+		  << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int pids = argc > 1 ? boost::lexical_cast<unsigned int>(argv[1]) : 1000;
+	unsigned int prefixes_per_pid = argc > 2 ? boost::lexical_cast<unsigned int>(argv[2]) : 4;
+	unsigned int lookups = argc > 3 ? boost::lexical_cast<unsigned int>(argv[3]) : 200000;
+	unsigned int threads = argc > 4 ? boost::lexical_cast<unsigned int>(argv[4]) : 4;
+	unsigned int server_threads = argc > 5 ? boost::lexical_cast<unsigned int>(argv[5]) : 2;
+
+	PIDPrefixList prefixes = make_prefixes(pids, prefixes_per_pid);
+	std::vector<uint32_t> pdistances(pids * pids);
+	for (unsigned int i = 0; i < pdistances.size(); ++i)
+		pdistances[i] = i % 100;
+
+	UDP_SNAPSHOTS = UDPSnapshotRegistryPtr(new UDPSnapshotRegistry());
+	UDP_SNAPSHOTS->publish(DEFAULT_VIEW_NAME, UDPViewSnapshotPtr(new UDPViewSnapshot(prefixes, pdistances, 60, 60, 1)));
+
+	UDPHandler::PortalUDPServer server("127.0.0.1", PORT, server_threads);
+	server.enable_all();
+	server.start();
+	boost::this_thread::sleep(bpt::milliseconds(200));
+
+	unsigned int batches[] = { 1, 16, 256 };
+	for (unsigned int i = 0; i < sizeof(batches) / sizeof(batches[0]); ++i)
+		bench("pid", pids * prefixes_per_pid, pids, batches[i], lookups, threads, false);
+	for (unsigned int i = 0; i < sizeof(batches) / sizeof(batches[0]); ++i)
+		bench("pdistance", pids * prefixes_per_pid, pids, batches[i], lookups, threads, true);
+
+	std::cout << "server received=" << server.get_received()
+		  << " sent=" << server.get_sent()
+		  << " send_errors=" << server.get_send_errors()
+		  << std::endl;
+
+	server.stop();
+	server.join();
+	return 0;
+}
@@ -0,0 +1,449 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Fan-out benchmark for update streams.
+ *
+ * Starts a REST interface on the loopback address whose only resource is
+ * an event stream, opens a number of subscriber connections, and
+ * publishes a series of updates to them. Most subscribers read as fast
+ * as they can; the rest never read, so their socket buffers fill and
+ * they are resynced instead of holding back the others or growing
+ * without bound. Reports the time until every reading subscriber has an
+ * update, the rate events are delivered, and the number of resyncs.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include <p4pserver/event_stream.h>
+#include <p4pserver/protocol_server_rest.h>
+
+namespace bpt = boost::posix_time;
+
+static const unsigned short PORT = 16674;
+
+/* Descriptors reserved for everything other than the connections */
+static const unsigned int RESERVED_FDS = 128;
+
+/* HTTP/1.0, so the stream is not chunked and event ids can be read straight off the wire */
+static const char REQUEST[] = "GET /updates HTTP/1.0\r\nHost: localhost\r\n\r\n";
+
+static const char TOPIC[] = "bench";
+
+static EventStreamHubPtr HUB;
+static size_t MAX_BUFFERED;
+
+static void finish_subscribe(void* server, RESTRequestState* state, void* data)
+{
+	bool suspend = ((ProtocolServerRESTBase*)server)->get_suspend_resume();
+	state->set_event_stream_response(HUB, HUB->subscribe(TOPIC, MAX_BUFFERED), suspend);
+}
+
+/* Subscribes every request to the same topic */
+class StreamHandler
+{
+public:
+	typedef ProtocolServerREST<1, StreamHandler> Server;
+
+	int operator()(Server* server, RESTRequestState* state) const
+	{
+		state->set_callbacks(&finish_subscribe);
+		return MHD_YES;
+	}
+};
+
+static EventStreamMessagePtr make_message(const char* event, unsigned long long id, unsigned int size)
+{
+	std::string msg;
+	EventStreamHub::append_message(msg, event, id, std::string(size, 'x'));
+	return EventStreamMessagePtr(new std::string(msg));
+}
+
+/* Publishes numbered updates at a fixed interval */
+class Publisher
+{
+public:
+	Publisher(unsigned int updates, unsigned int interval_ms, unsigned int snapshot_size, unsigned int update_size,
+		  std::vector<bpt::ptime>& published)
+		: updates_(updates), interval_ms_(interval_ms),
+		  snapshot_size_(snapshot_size), update_size_(update_size),
+		  published_(published)
+	{}
+
+	void operator()() const
+	{
+		for (unsigned int id = 1; id <= updates_; ++id)
+		{
+			EventStreamMessagePtr snapshot = make_message("snapshot", id, snapshot_size_);
+			EventStreamMessagePtr update = make_message("update", id, update_size_);
+			published_[id] = bpt::microsec_clock::universal_time();
+			HUB->publish(TOPIC, snapshot, update);
+			boost::this_thread::sleep(bpt::milliseconds(interval_ms_));
+		}
+	}
+
+private:
+	unsigned int updates_;
+	unsigned int interval_ms_;
+	unsigned int snapshot_size_;
+	unsigned int update_size_;
+	std::vector<bpt::ptime>& published_;
+};
+
+/* Subscriber side of the benchmark; drives all connections from one epoll set */
+class Subscribers
+{
+public:
+	Subscribers(unsigned int clients, unsigned int slow, unsigned int updates)
+		: epfd_(epoll_create(1024)), conns_(clients), slow_(slow),
+		  received_(updates + 1, 0), last_received_(updates + 1), bytes_(0)
+	{
+		if (epfd_ < 0)
+			throw std::runtime_error("epoll_create failed");
+	}
+
+	~Subscribers()
+	{
+		for (unsigned int i = 0; i < conns_.size(); ++i)
+			close_conn(i);
+		close(epfd_);
+	}
+
+	/* Connect every subscriber and send its request; returns the number connected */
+	unsigned int open(unsigned int timeout_ms)
+	{
+		sockaddr_in sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family = AF_INET;
+		sa.sin_port = htons(PORT);
+		sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		for (unsigned int i = 0; i < conns_.size(); ++i)
+		{
+			Conn& c = conns_[i];
+			c.slow = i < slow_;
+			c.fd = socket(AF_INET, SOCK_STREAM, 0);
+			if (c.fd < 0)
+				continue;
+			int one = 1;
+			setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+			fcntl(c.fd, F_SETFL, fcntl(c.fd, F_GETFL) | O_NONBLOCK);
+			if (connect(c.fd, (sockaddr*)&sa, sizeof(sa)) != 0 && errno != EINPROGRESS)
+			{
+				close_conn(i);
+				continue;
+			}
+			c.connecting = true;
+
+			epoll_event ev;
+			ev.events = EPOLLOUT;
+			ev.data.u32 = i;
+			epoll_ctl(epfd_, EPOLL_CTL_ADD, c.fd, &ev);
+		}
+
+		bpt::ptime deadline = bpt::microsec_clock::universal_time() + bpt::milliseconds(timeout_ms);
+		while (connecting() > 0 && bpt::microsec_clock::universal_time() < deadline)
+			poll(100);
+
+		unsigned int connected = 0;
+		for (unsigned int i = 0; i < conns_.size(); ++i)
+		{
+			if (conns_[i].connecting)
+				close_conn(i);
+			if (conns_[i].fd >= 0)
+				++connected;
+		}
+		return connected;
+	}
+
+	/* Read until every reading subscriber has update 'last' or the deadline passes */
+	void run(unsigned int last, const bpt::ptime& deadline)
+	{
+		while (bpt::microsec_clock::universal_time() < deadline)
+		{
+			poll(10);
+			if (received_[last] > 0 && received_[last] >= reading())
+				break;
+		}
+	}
+
+	unsigned int reading() const
+	{
+		unsigned int n = 0;
+		for (unsigned int i = 0; i < conns_.size(); ++i)
+			n += conns_[i].fd >= 0 && !conns_[i].slow ? 1 : 0;
+		return n;
+	}
+
+	/* Number of reading subscribers that got an update, and when the last of them did */
+	unsigned int get_received(unsigned int id) const		{ return received_[id]; }
+	const bpt::ptime& get_last_received(unsigned int id) const	{ return last_received_[id]; }
+	unsigned long long get_bytes() const				{ return bytes_; }
+
+private:
+	struct Conn
+	{
+		Conn() : fd(-1), connecting(false), slow(false), last_id(0) {}
+
+		int fd;
+		bool connecting;
+		bool slow;
+		unsigned long long last_id;
+		std::string tail;	/* End of the data read so far, for ids split across reads */
+	};
+
+	unsigned int connecting() const
+	{
+		unsigned int n = 0;
+		for (unsigned int i = 0; i < conns_.size(); ++i)
+			n += conns_[i].connecting ? 1 : 0;
+		return n;
+	}
+
+	void close_conn(unsigned int i)
+	{
+		Conn& c = conns_[i];
+		if (c.fd >= 0)
+			close(c.fd);
+		c.fd = -1;
+		c.connecting = false;
+	}
+
+	/* Note the ids of events read; an id counts once per subscriber */
+	void scan(Conn& c, const bpt::ptime& now)
+	{
+		static const char ID[] = "\nid: ";
+		std::string::size_type p = 0;
+		while ((p = c.tail.find(ID, p)) != std::string::npos)
+		{
+			std::string::size_type start = p + sizeof(ID) - 1;
+			std::string::size_type end = c.tail.find('\n', start);
+			if (end == std::string::npos)
+				break;
+			unsigned long long id = strtoull(c.tail.c_str() + start, NULL, 10);
+			if (id > c.last_id && id < received_.size())
+			{
+				c.last_id = id;
+				++received_[id];
+				last_received_[id] = now;
+			}
+			p = end;
+		}
+
+		/* Keep just enough to finish an id cut off by this read */
+		if (c.tail.size() > 32)
+			c.tail.erase(0, c.tail.size() - 32);
+	}
+
+	void poll(int timeout_ms)
+	{
+		epoll_event events[256];
+		int n = epoll_wait(epfd_, events, 256, timeout_ms);
+		bpt::ptime now = bpt::microsec_clock::universal_time();
+		for (int e = 0; e < n; ++e)
+		{
+			unsigned int i = events[e].data.u32;
+			Conn& c = conns_[i];
+			if (c.fd < 0)
+				continue;
+
+			if (c.connecting)
+			{
+				int err = 0;
+				socklen_t len = sizeof(err);
+				if (getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0
+				    || write(c.fd, REQUEST, sizeof(REQUEST) - 1) != (ssize_t)(sizeof(REQUEST) - 1))
+				{
+					close_conn(i);
+					continue;
+				}
+				c.connecting = false;
+
+				/* Slow subscribers never read again */
+				if (c.slow)
+					epoll_ctl(epfd_, EPOLL_CTL_DEL, c.fd, NULL);
+				else
+				{
+					epoll_event ev;
+					ev.events = EPOLLIN;
+					ev.data.u32 = i;
+					epoll_ctl(epfd_, EPOLL_CTL_MOD, c.fd, &ev);
+				}
+				continue;
+			}
+
+			char buf[16384];
+			while (true)
+			{
+				ssize_t r = read(c.fd, buf, sizeof(buf));
+				if (r > 0)
+				{
+					bytes_ += r;
+					c.tail.append(buf, r);
+					scan(c, now);
+					continue;
+				}
+				if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+					break;
+				close_conn(i);
+				break;
+			}
+		}
+	}
+
+	int epfd_;
+	std::vector<Conn> conns_;
+	unsigned int slow_;
+	std::vector<unsigned int> received_;
+	std::vector<bpt::ptime> last_received_;
+	unsigned long long bytes_;
+};
+
+static void bench(ProtocolServerRESTBase::ConnectionMode mode, unsigned int clients, unsigned int slow,
+		  unsigned int updates, unsigned int interval_ms, unsigned int snapshot_size,
+		  unsigned int update_size, unsigned int threads)
+{
+	HUB = EventStreamHubPtr(new EventStreamHub());
+	HUB->publish(TOPIC, make_message("snapshot", 0, snapshot_size), EventStreamMessagePtr());
+
+	StreamHandler::Server server("", PORT, threads, "", "",
+				     0, clients + RESERVED_FDS, 0,
+				     mode, 4096, 0);
+	server.enable_all();
+	server.start();
+	boost::this_thread::sleep(bpt::milliseconds(200));
+	if (!server.supports_event_streams())
+	{
+		std::cout << "mode=" << ProtocolServerRESTBase::get_mode_name(mode)
+			  << " event streams not supported" << std::endl;
+		server.stop();
+		server.join();
+		return;
+	}
+
+	Subscribers subscribers(clients, slow, updates);
+	bpt::ptime start = bpt::microsec_clock::universal_time();
+	unsigned int connected = subscribers.open(30000);
+	double setup_ms = (bpt::microsec_clock::universal_time() - start).total_microseconds() / 1000.0;
+
+	/* Wait for the server to subscribe every connection */
+	bpt::ptime deadline = bpt::microsec_clock::universal_time() + bpt::seconds(10);
+	while (HUB->get_subscribers() < connected && bpt::microsec_clock::universal_time() < deadline)
+		boost::this_thread::sleep(bpt::milliseconds(10));
+
+	std::vector<bpt::ptime> published(updates + 1);
+	start = bpt::microsec_clock::universal_time();
+	boost::thread publisher(Publisher(updates, interval_ms, snapshot_size, update_size, published));
+	subscribers.run(updates, start + bpt::milliseconds(updates * interval_ms) + bpt::seconds(10));
+	publisher.join();
+	double run_sec = (bpt::microsec_clock::universal_time() - start).total_microseconds() / 1e6;
+
+	/* Time from publishing an update until the last reading subscriber had it */
+	unsigned int reading = subscribers.reading();
+	unsigned int complete = 0;
+	unsigned long long events = 0;
+	double fanout_usec = 0, max_fanout_usec = 0;
+	for (unsigned int id = 1; id <= updates; ++id)
+	{
+		events += subscribers.get_received(id);
+		if (reading == 0 || subscribers.get_received(id) < reading)
+			continue;
+		double usec = (subscribers.get_last_received(id) - published[id]).total_microseconds();
+		fanout_usec += usec;
+		max_fanout_usec = std::max(max_fanout_usec, usec);
+		++complete;
+	}
+
+	std::cout << "mode=" << ProtocolServerRESTBase::get_mode_name(server.get_mode())
+		  << " clients=" << clients
+		  << " connected=" << connected
+		  << " subscribed=" << HUB->get_subscribers()
+		  << " setup_ms=" << setup_ms
+		  << " reading=" << reading
+		  << " updates_complete=" << complete << "/" << updates
+		  << " fanout_ms=" << (complete ? fanout_usec / complete / 1000.0 : 0)
+		  << " max_fanout_ms=" << max_fanout_usec / 1000.0
+		  << " events_per_sec=" << events / run_sec
+		  << " mbytes_per_sec=" << subscribers.get_bytes() / run_sec / 1e6
+		  << " resyncs=" << HUB->get_resyncs()
+		  << std::endl;
+
+	server.stop();
+	server.join();
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int clients = argc > 1 ? boost::lexical_cast<unsigned int>(argv[1]) : 5000;
+	unsigned int slow_percent = argc > 2 ? boost::lexical_cast<unsigned int>(argv[2]) : 10;
+	unsigned int updates = argc > 3 ? boost::lexical_cast<unsigned int>(argv[3]) : 100;
+	unsigned int interval_ms = argc > 4 ? boost::lexical_cast<unsigned int>(argv[4]) : 20;
+	unsigned int snapshot_size = argc > 5 ? boost::lexical_cast<unsigned int>(argv[5]) : 65536;
+	unsigned int update_size = argc > 6 ? boost::lexical_cast<unsigned int>(argv[6]) : 1024;
+	unsigned int threads = argc > 7 ? boost::lexical_cast<unsigned int>(argv[7]) : 4;
+	MAX_BUFFERED = argc > 8 ? boost::lexical_cast<size_t>(argv[8]) : 1048576;
+
+	/* Both ends of every connection live in this process */
+	struct rlimit rl;
+	getrlimit(RLIMIT_NOFILE, &rl);
+	rl.rlim_cur = rl.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &rl);
+	getrlimit(RLIMIT_NOFILE, &rl);
+	if (rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur < 2 * clients + RESERVED_FDS)
+	{
+		clients = rl.rlim_cur > RESERVED_FDS ? (rl.rlim_cur - RESERVED_FDS) / 2 : 0;
+		std::cerr << "descriptor limit " << rl.rlim_cur << " allows only " << clients << " clients" << std::endl;
+	}
+
+	ProtocolServerRESTBase::ConnectionMode modes[] = {
+		ProtocolServerRESTBase::MODE_EPOLL,
+		ProtocolServerRESTBase::MODE_THREAD_PER_CONNECTION,
+	};
+	for (unsigned int m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m)
+		bench(modes[m], clients, clients * slow_percent / 100, updates, interval_ms, snapshot_size, update_size, threads);
+
+	return 0;
+}
@@ -0,0 +1,530 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Benchmark for complete view updates on synthetic ISP topologies.
+ *
+ * Generates a topology in which every PID aggregates a number of router
+ * nodes, configures a view over it in the global state, and runs view
+ * updates through ViewUpdateJob exactly as the job queue would. Each
+ * update is preceded by the phases of the update run on their own (state
+ * copy, aggregation, route computation, optimization plugin) so that a
+ * regression can be attributed. Output is one record per line, as
+ * space-separated key=value fields.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <vector>
+#include <sys/resource.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <p4pserver/logging.h>
+#include <p4pserver/net_state.h>
+#include <p4pserver/pid_routing.h>
+#include "plugin_base.h"
+#include "plugin_registry.h"
+#include "state.h"
+#include "view.h"
+#include "view_update_job.h"
+
+namespace bpt = boost::posix_time;
+
+static const char* VIEW_NAME = "bench";
+static const char* ISP_NAME = "bench";
+
+/*
+ * Allocation counters, maintained by the replacement operator new below.
+ * The benchmark runs everything on the main thread.
+ */
+static unsigned long long ALLOC_COUNT = 0;
+static unsigned long long ALLOC_BYTES = 0;
+
+void* operator new(std::size_t n) throw (std::bad_alloc)
+{
+	++ALLOC_COUNT;
+	ALLOC_BYTES += n;
+	void* p = std::malloc(n ? n : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](std::size_t n) throw (std::bad_alloc)
+{
+	return operator new(n);
+}
+
+void operator delete(void* p) throw ()
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) throw ()
+{
+	std::free(p);
+}
+
+/*
+ * Small linear congruential generator, so that topologies are identical
+ * across platforms and library versions.
+ */
+class BenchRandom
+{
+public:
+	BenchRandom(unsigned int seed) : state_(seed) {}
+
+	unsigned int next()
+	{
+		state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+		return (unsigned int)(state_ >> 33);
+	}
+
+	unsigned int uniform(unsigned int n)
+	{
+		return next() % n;
+	}
+
+	double uniform(double lo, double hi)
+	{
+		return lo + (hi - lo) * (next() / 2147483648.0);
+	}
+
+private:
+	unsigned long long state_;
+};
+
+struct BenchParams
+{
+	unsigned int pids;
+	unsigned int nodes_per_pid;
+	unsigned int degree;
+	unsigned int external;
+	unsigned int updates;
+	unsigned int seed;
+	std::string plugin;
+};
+
+struct BenchTopology
+{
+	unsigned int num_nodes;
+	NetEdgeVector edges;
+	std::vector<double> capacity;
+
+	/* gravity-model traffic: base utilization of each edge */
+	std::vector<double> utilization;
+};
+
+/*
+ * Timing and allocation record for one run of one phase.
+ */
+class PhaseTimer
+{
+public:
+	PhaseTimer()
+		: start_(bpt::microsec_clock::universal_time()),
+		  allocs_(ALLOC_COUNT),
+		  bytes_(ALLOC_BYTES)
+	{}
+
+	void report(const std::string& phase, unsigned int iter, std::vector<double>& usec_series,
+		    const std::string& extra = std::string())
+	{
+		double usec = (bpt::microsec_clock::universal_time() - start_).total_microseconds();
+		unsigned long long allocs = ALLOC_COUNT - allocs_;
+		unsigned long long bytes = ALLOC_BYTES - bytes_;
+
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+
+		std::cout << "phase " << phase
+			  << " " << iter
+			  << " usec=" << usec
+			  << " allocs=" << allocs
+			  << " alloc_bytes=" << bytes
+			  << " peak_rss_kb=" << usage.ru_maxrss
+			  << extra
+			  << std::endl;
+		usec_series.push_back(usec);
+	}
+
+private:
+	bpt::ptime start_;
+	unsigned long long allocs_;
+	unsigned long long bytes_;
+};
+
+static std::string node_name(unsigned int i)
+{
+	return "n" + boost::lexical_cast<std::string>(i);
+}
+
+static void build_topology(NetState& state, const WritableLock& lock, PIDRouting& routing, const WritableLock& routing_lock,
+			   BenchTopology& topo, const BenchParams& p)
+{
+	BenchRandom rnd(p.seed);
+	unsigned int num_internal = p.pids - p.external;
+
+	/* internal PIDs own nodes_per_pid nodes each; external PIDs one each */
+	topo.num_nodes = num_internal * p.nodes_per_pid + p.external;
+	std::vector<NetVertex> vertices(topo.num_nodes);
+	for (unsigned int i = 0; i < topo.num_nodes; ++i)
+	{
+		bool external = i >= num_internal * p.nodes_per_pid;
+		state.add_node(node_name(i), vertices[i], lock);
+		state.set_external(vertices[i], external, lock);
+	}
+
+	NetEdge e;
+	unsigned int num_internal_nodes = num_internal * p.nodes_per_pid;
+
+	/* nodes within a PID form a ring */
+	for (unsigned int pid = 0; pid < num_internal && p.nodes_per_pid > 1; ++pid)
+	{
+		unsigned int base = pid * p.nodes_per_pid;
+		for (unsigned int j = 0; j < p.nodes_per_pid; ++j)
+		{
+			if (state.add_edge(vertices[base + j], vertices[base + (j + 1) % p.nodes_per_pid], e, lock))
+				topo.edges.push_back(e);
+			if (state.add_edge(vertices[base + (j + 1) % p.nodes_per_pid], vertices[base + j], e, lock))
+				topo.edges.push_back(e);
+		}
+	}
+
+	/* PIDs form a backbone ring, then random chords up to the target degree */
+	for (unsigned int pid = 0; pid < num_internal; ++pid)
+	{
+		unsigned int src = pid * p.nodes_per_pid;
+		unsigned int dst = ((pid + 1) % num_internal) * p.nodes_per_pid;
+		if (src != dst && state.add_edge(vertices[src], vertices[dst], e, lock))
+			topo.edges.push_back(e);
+		if (src != dst && state.add_edge(vertices[dst], vertices[src], e, lock))
+			topo.edges.push_back(e);
+	}
+	unsigned int target_edges = num_internal_nodes * p.degree;
+	unsigned int attempts = 0;
+	while (topo.edges.size() < target_edges && attempts++ < 4 * target_edges)
+	{
+		unsigned int i = rnd.uniform(num_internal_nodes);
+		unsigned int j = rnd.uniform(num_internal_nodes);
+		if (i / p.nodes_per_pid == j / p.nodes_per_pid)
+			continue;
+		if (state.add_edge(vertices[i], vertices[j], e, lock))
+			topo.edges.push_back(e);
+		if (state.add_edge(vertices[j], vertices[i], e, lock))
+			topo.edges.push_back(e);
+	}
+
+	/* every external PID is multihomed to two internal nodes */
+	for (unsigned int i = num_internal_nodes; i < topo.num_nodes; ++i)
+	{
+		for (unsigned int h = 0; h < 2; ++h)
+		{
+			unsigned int j = rnd.uniform(num_internal_nodes);
+			if (state.add_edge(vertices[i], vertices[j], e, lock))
+				topo.edges.push_back(e);
+			if (state.add_edge(vertices[j], vertices[i], e, lock))
+				topo.edges.push_back(e);
+		}
+	}
+
+	/* gravity model over PID masses; routing weights per PID pair */
+	std::vector<double> mass(p.pids);
+	for (unsigned int i = 0; i < p.pids; ++i)
+		mass[i] = rnd.uniform(1.0, 10.0);
+
+	static const double CAPACITY[] = { 1000.0, 2500.0, 10000.0 };
+
+	unsigned int n = topo.edges.size();
+	topo.capacity.resize(n);
+	topo.utilization.resize(n);
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		NetVertex v_src, v_dst;
+		state.get_edge_vert(topo.edges[i], v_src, v_dst, lock);
+		unsigned int n_src = boost::lexical_cast<unsigned int>(state.get_name(v_src, lock).substr(1));
+		unsigned int n_dst = boost::lexical_cast<unsigned int>(state.get_name(v_dst, lock).substr(1));
+		unsigned int pid_src = n_src < num_internal_nodes ? n_src / p.nodes_per_pid : num_internal + n_src - num_internal_nodes;
+		unsigned int pid_dst = n_dst < num_internal_nodes ? n_dst / p.nodes_per_pid : num_internal + n_dst - num_internal_nodes;
+
+		topo.capacity[i] = CAPACITY[rnd.uniform(3u)];
+		topo.utilization[i] = std::min(0.95, 0.01 * mass[pid_src] * mass[pid_dst] * rnd.uniform(0.5, 1.5));
+		state.set_capacity(topo.edges[i], topo.capacity[i], lock);
+
+		if (pid_src != pid_dst)
+			routing.set_weight(p4p::PID(ISP_NAME, pid_src, pid_src >= num_internal),
+					   p4p::PID(ISP_NAME, pid_dst, pid_dst >= num_internal),
+					   1 + rnd.uniform(100u), routing_lock);
+	}
+}
+
+static void apply_traffic(NetState& state, const WritableLock& lock, const BenchTopology& topo, BenchRandom& rnd)
+{
+	/* traffic drifts by up to 10% around the gravity model between updates */
+	for (unsigned int i = 0; i < topo.edges.size(); ++i)
+		state.set_traffic(topo.edges[i], topo.capacity[i] * topo.utilization[i] * rnd.uniform(0.9, 1.1), lock);
+}
+
+static void configure_view(const BenchParams& p)
+{
+	GlobalStatePtr global_state = GLOBAL_STATE;
+	BlockReadLock global_state_lock(*global_state);
+
+	ViewRegistryPtr views = global_state->get_views(global_state_lock);
+	BlockWriteLock views_lock(*views);
+	views->add(VIEW_NAME, views_lock);
+
+	ViewPtr view = views->get(VIEW_NAME, views_lock);
+	BlockWriteLock view_lock(*view);
+	if (!p.plugin.empty() && !view->set_plugin(p.plugin, view_lock))
+		throw std::runtime_error("plugin '" + p.plugin + "' is not registered");
+
+	PIDAggregationPtr aggregation = view->get_aggregation(view_lock);
+	PIDRoutingPtr routing = view->get_intradomain_routing(view_lock);
+	SparsePIDMatrixPtr link_pdistances = view->get_link_pdistances(view_lock);
+	BlockWriteLock aggregation_lock(*aggregation);
+	BlockWriteLock routing_lock(*routing);
+	BlockWriteLock link_pdistances_lock(*link_pdistances);
+
+	unsigned int num_internal = p.pids - p.external;
+	for (unsigned int i = 0; i < p.pids; ++i)
+	{
+		bool external = i >= num_internal;
+		p4p::PID pid(ISP_NAME, i, external);
+		view->add_pid("p" + boost::lexical_cast<std::string>(i), pid,
+			      aggregation_lock, routing_lock, link_pdistances_lock, view_lock);
+
+		NetVertexNameSet nodes;
+		if (external)
+			nodes.insert(node_name(num_internal * p.nodes_per_pid + i - num_internal));
+		else
+			for (unsigned int j = 0; j < p.nodes_per_pid; ++j)
+				nodes.insert(node_name(i * p.nodes_per_pid + j));
+		aggregation->add_vertices(pid, nodes, aggregation_lock);
+	}
+}
+
+/*
+ * Aggregate a copy of the network state the way the view update does,
+ * given that every node belongs to exactly one PID.
+ */
+static void aggregate(NetState& state, const WritableLock& lock, const BenchParams& p, PinnedPIDSet& pids)
+{
+	unsigned int num_internal = p.pids - p.external;
+	for (unsigned int i = 0; i < p.pids; ++i)
+	{
+		bool external = i >= num_internal;
+		p4p::PID pid(ISP_NAME, i, external);
+
+		NetVertexSet verts;
+		NetVertex v;
+		if (external)
+		{
+			state.get_node(node_name(num_internal * p.nodes_per_pid + i - num_internal), v, lock);
+			verts.insert(v);
+		}
+		else
+			for (unsigned int j = 0; j < p.nodes_per_pid; ++j)
+			{
+				state.get_node(node_name(i * p.nodes_per_pid + j), v, lock);
+				verts.insert(v);
+			}
+
+		state.aggregate_node(verts, boost::lexical_cast<std::string>(pid), v, lock);
+		state.set_external(v, external, lock);
+		state.set_pid(v, pid, lock);
+		pids.insert(PinnedPID(pid, v));
+	}
+}
+
+static void summarize(const std::string& phase, const std::vector<double>& usec)
+{
+	if (usec.empty())
+		return;
+
+	double total = 0.0, max = 0.0;
+	BOOST_FOREACH(double u, usec)
+	{
+		total += u;
+		max = std::max(max, u);
+	}
+
+	std::vector<double> sorted(usec);
+	std::sort(sorted.begin(), sorted.end());
+
+	std::cout << "summary " << phase
+		  << " iterations=" << usec.size()
+		  << " mean_ms=" << total / usec.size() / 1000.0
+		  << " median_ms=" << sorted[sorted.size() / 2] / 1000.0
+		  << " max_ms=" << max / 1000.0
+		  << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 8)
+	{
+		std::cerr << "Usage: " << argv[0] << " [pids [nodes-per-pid [degree [external-pids [updates [seed [plugin]]]]]]]" << std::endl;
+		return 1;
+	}
+
+	BenchParams p;
+	p.pids          = argc > 1 ? boost::lexical_cast<unsigned int>(argv[1]) : 500;
+	p.nodes_per_pid = argc > 2 ? boost::lexical_cast<unsigned int>(argv[2]) : 4;
+	p.degree        = argc > 3 ? boost::lexical_cast<unsigned int>(argv[3]) : 4;
+	p.external      = argc > 4 ? boost::lexical_cast<unsigned int>(argv[4]) : p.pids / 50;
+	p.updates       = argc > 5 ? boost::lexical_cast<unsigned int>(argv[5]) : 5;
+	p.seed          = argc > 6 ? boost::lexical_cast<unsigned int>(argv[6]) : 1;
+	p.plugin        = argc > 7 ? argv[7] : "MLU";
+
+	if (p.external + 2 > p.pids || p.nodes_per_pid == 0 || p.updates == 0)
+	{
+		std::cerr << "need at least two internal pids, one node per pid and one update" << std::endl;
+		return 1;
+	}
+
+	init_logger(1, "");
+
+	/* The job queue is never started; it only receives the rescheduled jobs */
+	JOB_QUEUE = JobQueuePtr(new JobQueue(1));
+	GLOBAL_STATE = GlobalStatePtr(new GlobalState());
+	GLOBAL_STATE->updated();
+
+	std::cout << std::fixed << std::setprecision(3);
+
+	std::vector<double> build_usec;
+	BenchTopology topo;
+	NetStatePtr net_state;
+	{
+		PhaseTimer timer;
+		configure_view(p);
+
+		BlockReadLock global_state_lock(*GLOBAL_STATE);
+		net_state = GLOBAL_STATE->get_net(global_state_lock);
+		ViewPtr view = GLOBAL_STATE->get_view_blocking(VIEW_NAME, global_state_lock);
+		BlockReadLock view_lock(*view);
+		PIDRoutingPtr routing = view->get_intradomain_routing(view_lock);
+
+		BlockWriteLock net_state_lock(*net_state);
+		BlockWriteLock routing_lock(*routing);
+		build_topology(*net_state, net_state_lock, *routing, routing_lock, topo, p);
+		timer.report("build", 0, build_usec);
+	}
+
+	std::cout << "topology pids=" << p.pids
+		  << " external=" << p.external
+		  << " nodes=" << topo.num_nodes
+		  << " edges=" << topo.edges.size()
+		  << " plugin=" << (p.plugin.empty() ? "none" : p.plugin)
+		  << " seed=" << p.seed
+		  << std::endl;
+
+	OptPluginBasePtr plugin;
+	if (!p.plugin.empty())
+		plugin = OptPluginRegistry::Instance().get_instance(p.plugin);
+
+	BenchRandom rnd(p.seed + 1);
+	std::vector<double> copy_usec, aggregate_usec, routes_usec, plugin_usec, update_usec;
+	for (unsigned int u = 1; u <= p.updates; ++u)
+	{
+		{
+			BlockWriteLock net_state_lock(*net_state);
+			apply_traffic(*net_state, net_state_lock, topo, rnd);
+		}
+
+		/* Phases of the update, run on their own */
+		NetStatePtr copy;
+		{
+			BlockReadLock net_state_lock(*net_state);
+			PhaseTimer timer;
+			copy = boost::dynamic_pointer_cast<NetState>(net_state->copy(net_state_lock));
+			timer.report("copy", u, copy_usec);
+		}
+
+		BlockWriteLock copy_lock(*copy);
+		PinnedPIDSet pids;
+		{
+			PhaseTimer timer;
+			aggregate(*copy, copy_lock, p, pids);
+			timer.report("aggregate", u, aggregate_usec);
+		}
+
+		{
+			BlockReadLock global_state_lock(*GLOBAL_STATE);
+			ViewPtr view = GLOBAL_STATE->get_view_blocking(VIEW_NAME, global_state_lock);
+			BlockReadLock view_lock(*view);
+			PIDRoutingPtr routing = view->get_intradomain_routing(view_lock);
+			BlockReadLock routing_lock(*routing);
+
+			PhaseTimer timer;
+			PIDRouting::RouteComputationContext context;
+			unsigned long long routes = 0;
+			BOOST_FOREACH(const PinnedPID& src, pids)
+			{
+				if (src.get_external())
+					continue;
+				routing->get_routes(src, *copy, copy_lock, pids, context, routing_lock);
+				routes += context.get_result().size();
+			}
+			timer.report("routes", u, routes_usec, " routes=" + boost::lexical_cast<std::string>(routes));
+		}
+
+		if (plugin)
+		{
+			PhaseTimer timer;
+			int rc = plugin->compute_pdistances(*copy, copy_lock, pids);
+			timer.report("plugin", u, plugin_usec, " rc=" + boost::lexical_cast<std::string>(rc));
+		}
+
+		/* The complete update, through the job the queue would run */
+		{
+			PhaseTimer timer;
+			ViewUpdateJob(JOB_QUEUE, boost::get_system_time(), VIEW_NAME).run();
+			timer.report("update", u, update_usec);
+		}
+	}
+
+	summarize("build", build_usec);
+	summarize("copy", copy_usec);
+	summarize("aggregate", aggregate_usec);
+	summarize("routes", routes_usec);
+	summarize("plugin", plugin_usec);
+	summarize("update", update_usec);
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	std::cout << "memory peak_rss_kb=" << usage.ru_maxrss << std::endl;
+
+	return 0;
+}
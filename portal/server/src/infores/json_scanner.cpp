@@ -0,0 +1,402 @@
+#include "json_scanner.h"
+
+#include <string.h>
+#include <algorithm>
+
+// Containers nested deeper than this are rejected, which bounds the
+// recursion in skipValue()
+static const size_t MAX_DEPTH = 64;
+
+static int hexValue(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+JsonScanner::JsonScanner(char* data, size_t len)
+	: _pos(data)
+	, _end(data + len)
+	, _has_member(false)
+	, _after_key(false)
+	, _failed(false)
+	, _str(NULL)
+	, _len(0)
+{
+	;
+}
+
+JsonScanner::JsonScanner(std::string& data)
+	: _pos(data.empty() ? NULL : &data[0])
+	, _end(data.empty() ? NULL : &data[0] + data.size())
+	, _has_member(false)
+	, _after_key(false)
+	, _failed(false)
+	, _str(NULL)
+	, _len(0)
+{
+	;
+}
+
+JsonScanner::Token JsonScanner::fail()
+{
+	_failed = true;
+	return T_ERROR;
+}
+
+void JsonScanner::skipSpace()
+{
+	while (_pos < _end && (*_pos == ' ' || *_pos == '\t' || *_pos == '\n' || *_pos == '\r'))
+		++_pos;
+}
+
+bool JsonScanner::isString(const char* s) const
+{
+	return strlen(s) == _len && memcmp(s, _str, _len) == 0;
+}
+
+JsonScanner::Token JsonScanner::next()
+{
+	if (_failed)
+		return T_ERROR;
+
+	skipSpace();
+	if (_stack.empty())
+	{
+		// Only one value at the top level
+		if (_has_member)
+			return _pos == _end ? T_END : fail();
+	}
+	else if (_stack.back())
+	{
+		// Object members are read with nextKey()
+		if (!_after_key)
+			return fail();
+		if (_pos == _end || *_pos != ':')
+			return fail();
+		++_pos;
+		skipSpace();
+		_after_key = false;
+	}
+	else
+	{
+		if (_pos < _end && *_pos == ']')
+		{
+			++_pos;
+			_stack.pop_back();
+			_has_member = true;
+			return T_END_ARRAY;
+		}
+		if (_has_member)
+		{
+			if (_pos == _end || *_pos != ',')
+				return fail();
+			++_pos;
+			skipSpace();
+		}
+	}
+
+	if (_pos == _end)
+		return fail();
+
+	Token result;
+	switch (*_pos)
+	{
+	case '{':
+	case '[':
+		if (_stack.size() >= MAX_DEPTH)
+			return fail();
+		_stack.push_back(*_pos == '{');
+		++_pos;
+		_has_member = false;
+		return _stack.back() ? T_BEGIN_OBJECT : T_BEGIN_ARRAY;
+	case '"':
+		if (!readString())
+			return fail();
+		result = T_STRING;
+		break;
+	case 't':
+		if (!readLiteral("true", 4))
+			return fail();
+		result = T_TRUE;
+		break;
+	case 'f':
+		if (!readLiteral("false", 5))
+			return fail();
+		result = T_FALSE;
+		break;
+	case 'n':
+		if (!readLiteral("null", 4))
+			return fail();
+		result = T_NULL;
+		break;
+	default:
+		readNumber();
+		if (_failed)
+			return T_ERROR;
+		result = T_NUMBER;
+		break;
+	}
+
+	_has_member = true;
+	return result;
+}
+
+bool JsonScanner::nextKey()
+{
+	if (_failed)
+		return false;
+
+	skipSpace();
+	if (_stack.empty() || !_stack.back() || _after_key)
+		return fail(), false;
+
+	if (_pos < _end && *_pos == '}')
+	{
+		++_pos;
+		_stack.pop_back();
+		_has_member = true;
+		return false;
+	}
+	if (_has_member)
+	{
+		if (_pos == _end || *_pos != ',')
+			return fail(), false;
+		++_pos;
+		skipSpace();
+	}
+	if (_pos == _end || *_pos != '"' || !readString())
+		return fail(), false;
+
+	_has_member = true;
+	_after_key = true;
+	return true;
+}
+
+bool JsonScanner::skipValue(Token first)
+{
+	switch (first)
+	{
+	case T_BEGIN_OBJECT:
+		while (nextKey())
+		{
+			if (!skipValue(next()))
+				return false;
+		}
+		return !_failed;
+	case T_BEGIN_ARRAY:
+		for (;;)
+		{
+			Token t = next();
+			if (t == T_END_ARRAY)
+				return true;
+			if (!skipValue(t))
+				return false;
+		}
+	case T_STRING:
+	case T_NUMBER:
+	case T_TRUE:
+	case T_FALSE:
+	case T_NULL:
+		return true;
+	default:
+		fail();
+		return false;
+	}
+}
+
+bool JsonScanner::readLiteral(const char* word, size_t len)
+{
+	if ((size_t)(_end - _pos) < len || memcmp(_pos, word, len) != 0)
+		return false;
+	_str = _pos;
+	_len = len;
+	_pos += len;
+	return true;
+}
+
+void JsonScanner::readNumber()
+{
+	char* start = _pos;
+	if (_pos < _end && *_pos == '-')
+		++_pos;
+
+	// Integer part: 0, or a digit sequence not starting with 0
+	if (_pos < _end && *_pos == '0')
+		++_pos;
+	else if (_pos < _end && *_pos >= '1' && *_pos <= '9')
+		while (_pos < _end && *_pos >= '0' && *_pos <= '9')
+			++_pos;
+	else
+	{
+		fail();
+		return;
+	}
+
+	if (_pos < _end && *_pos == '.')
+	{
+		++_pos;
+		char* digits = _pos;
+		while (_pos < _end && *_pos >= '0' && *_pos <= '9')
+			++_pos;
+		if (_pos == digits)
+		{
+			fail();
+			return;
+		}
+	}
+
+	if (_pos < _end && (*_pos == 'e' || *_pos == 'E'))
+	{
+		++_pos;
+		if (_pos < _end && (*_pos == '+' || *_pos == '-'))
+			++_pos;
+		char* digits = _pos;
+		while (_pos < _end && *_pos >= '0' && *_pos <= '9')
+			++_pos;
+		if (_pos == digits)
+		{
+			fail();
+			return;
+		}
+	}
+
+	_str = start;
+	_len = _pos - start;
+}
+
+bool JsonScanner::readString()
+{
+	// Decoded text is never longer than its encoding, so it is written
+	// back over the buffer as it is read
+	char* start = ++_pos;
+	char* out = start;
+	while (_pos < _end)
+	{
+		char c = *_pos++;
+		if (c == '"')
+		{
+			*out = '\0';
+			_str = start;
+			_len = out - start;
+			return true;
+		}
+		if ((unsigned char)c < 0x20)
+			return false;
+		if (c != '\\')
+		{
+			*out++ = c;
+			continue;
+		}
+
+		if (_pos == _end)
+			return false;
+		switch (*_pos++)
+		{
+		case '"':	*out++ = '"'; break;
+		case '\\':	*out++ = '\\'; break;
+		case '/':	*out++ = '/'; break;
+		case 'b':	*out++ = '\b'; break;
+		case 'f':	*out++ = '\f'; break;
+		case 'n':	*out++ = '\n'; break;
+		case 'r':	*out++ = '\r'; break;
+		case 't':	*out++ = '\t'; break;
+		case 'u':
+		{
+			unsigned long code = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				int v = _pos < _end ? hexValue(*_pos++) : -1;
+				if (v < 0)
+					return false;
+				code = code * 16 + v;
+			}
+
+			// Combine a surrogate pair
+			if (code >= 0xd800 && code <= 0xdbff && _end - _pos >= 6 && _pos[0] == '\\' && _pos[1] == 'u')
+			{
+				unsigned long low = 0;
+				for (int i = 2; i < 6; i++)
+				{
+					int v = hexValue(_pos[i]);
+					if (v < 0)
+						return false;
+					low = low * 16 + v;
+				}
+				if (low >= 0xdc00 && low <= 0xdfff)
+				{
+					code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+					_pos += 6;
+				}
+			}
+
+			// UTF-8 encode
+			if (code < 0x80)
+				*out++ = (char)code;
+			else if (code < 0x800)
+			{
+				*out++ = (char)(0xc0 | (code >> 6));
+				*out++ = (char)(0x80 | (code & 0x3f));
+			}
+			else if (code < 0x10000)
+			{
+				*out++ = (char)(0xe0 | (code >> 12));
+				*out++ = (char)(0x80 | ((code >> 6) & 0x3f));
+				*out++ = (char)(0x80 | (code & 0x3f));
+			}
+			else
+			{
+				*out++ = (char)(0xf0 | (code >> 18));
+				*out++ = (char)(0x80 | ((code >> 12) & 0x3f));
+				*out++ = (char)(0x80 | ((code >> 6) & 0x3f));
+				*out++ = (char)(0x80 | (code & 0x3f));
+			}
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	return false;
+}
+
+bool JsonNameSet::Name::operator<(const Name& rhs) const
+{
+	// Same order as std::string, so results come out as they did from std::set
+	int c = memcmp(str, rhs.str, std::min(len, rhs.len));
+	return c < 0 || (c == 0 && len < rhs.len);
+}
+
+bool JsonNameSet::Name::operator==(const Name& rhs) const
+{
+	return len == rhs.len && memcmp(str, rhs.str, len) == 0;
+}
+
+void JsonNameSet::add(const char* str, size_t len)
+{
+	Name name;
+	name.str = str;
+	name.len = len;
+	_names.push_back(name);
+}
+
+void JsonNameSet::commit()
+{
+	std::sort(_names.begin(), _names.end());
+	_names.erase(std::unique(_names.begin(), _names.end()), _names.end());
+}
+
+int JsonNameSet::find(const char* str, size_t len) const
+{
+	Name name;
+	name.str = str;
+	name.len = len;
+	std::vector<Name>::const_iterator itr = std::lower_bound(_names.begin(), _names.end(), name);
+	if (itr == _names.end() || !(*itr == name))
+		return -1;
+	return itr - _names.begin();
+}
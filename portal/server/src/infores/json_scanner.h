@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+ * Streaming JSON reader for request bodies. Tokens are pulled one at a
+ * time straight from the buffer, without building a document. Strings
+ * are unescaped in place and NUL-terminated, so the strings it returns
+ * point into the buffer and stay valid as long as the buffer does.
+ */
+class JsonScanner
+{
+public:
+	typedef enum e_Token
+	{
+		T_BEGIN_OBJECT,
+		T_END_OBJECT,
+		T_BEGIN_ARRAY,
+		T_END_ARRAY,
+		T_STRING,
+		T_NUMBER,
+		T_TRUE,
+		T_FALSE,
+		T_NULL,
+		T_END,
+		T_ERROR
+	} Token;
+
+	JsonScanner(char* data, size_t len);
+	JsonScanner(std::string& data);
+
+	// Read the next value's first token, consuming a ',' or ':' before it
+	// where the grammar requires one. Returns T_END_OBJECT/T_END_ARRAY
+	// when the enclosing container ends.
+	Token next();
+
+	// Read the next member name of the current object; returns false at
+	// the end of the object or on error (see failed()).
+	bool nextKey();
+
+	// Skip the rest of a value whose first token was just read
+	bool skipValue(Token first);
+
+	bool failed() const { return _failed; }
+
+	// The string or number text of the last token
+	const char* getString() const { return _str; }
+	size_t getLength() const { return _len; }
+	bool isString(const char* s) const;
+
+private:
+	bool readString();
+	bool readLiteral(const char* word, size_t len);
+	void readNumber();
+	void skipSpace();
+	Token fail();
+
+	char* _pos;
+	char* _end;
+
+	// Containers entered and not yet left: true for objects
+	std::vector<bool> _stack;
+	// Whether the current container already has a member
+	bool _has_member;
+	// Whether the last token was a member name (so a ':' follows)
+	bool _after_key;
+	bool _failed;
+
+	const char* _str;
+	size_t _len;
+};
+
+/*
+ * Distinct strings taken from a request body, in sorted order. Each
+ * string is identified by its index, and points into the body, which
+ * must outlive the set.
+ */
+class JsonNameSet
+{
+public:
+	void add(const char* str, size_t len);
+	// Sort and remove duplicates; call after the last add()
+	void commit();
+
+	void clear() { _names.clear(); }
+	size_t size() const { return _names.size(); }
+	bool empty() const { return _names.empty(); }
+	const char* operator[](size_t i) const { return _names[i].str; }
+	size_t getLength(size_t i) const { return _names[i].len; }
+
+	// Index of a string, or -1 if it is not in the set
+	int find(const char* str, size_t len) const;
+	bool contains(const std::string& str) const { return find(str.data(), str.size()) >= 0; }
+
+private:
+	struct Name
+	{
+		const char* str;
+		size_t len;
+		bool operator<(const Name& rhs) const;
+		bool operator==(const Name& rhs) const;
+	};
+
+	std::vector<Name> _names;
+};
@@ -2,6 +2,7 @@
 #include <limits>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <iostream>
 
 PostFilter::PostFilter()
@@ -22,6 +23,14 @@ std::string PostFilter::StripIP(const std::string& ip_str)
 		return ip_str;
 }
 
+const char* PostFilter::StripIP(const char* ip_str)
+{
+	if (strstr(ip_str, "ip") != NULL && strlen(ip_str) >= 5)
+		return ip_str + 5;
+	else
+		return ip_str;
+}
+
 bool PostFilter::inConstraints(double value)
 {
 	if (!_has_constraints)
@@ -33,264 +42,271 @@ bool PostFilter::inConstraints(double value)
 	return true;
 }
 
-ALTOErrorCode PostFilter::readConstraints(Object& obj)
+// State of a field while a request body is streamed. Fields are checked
+// once the whole body has been read, so that syntax errors take priority
+// and errors are reported in the same order as before.
+typedef enum e_FieldState
 {
-	if (obj.Find("constraints") == obj.End())
-		_has_constraints = false;
-	else
-	{
-		_has_constraints = true;
-		// [TODO] Now it only supports one zone generated by the constraints
-		Array& array = obj["constraints"];
-		if (obj.Find("constraints")->type != ET_ARRAY)	
-			return E_JSON_VALUE_TYPE;
+	FIELD_MISSING,
+	FIELD_OK,
+	FIELD_BAD_TYPE
+} FieldState;
 
-		for (size_t i = 0; i < array.Size(); i++)
-		{
-			std::string& cons = ((String&)array[i]).Value();
-			std::string opr = cons.substr(0, 2);
-			double bound = std::strtod(cons.substr(2, cons.size() - 2).c_str(), NULL);
-			if (opr == "lt" && bound < _upper_bound)
-			{
-				_upper_bound = bound;
-				_upper_tight = false;
-			}
-			else if (opr == "gt" && bound > _lower_bound)
-			{
-				_lower_bound = bound;
-				_lower_tight = false;
-			}
-			else if (opr == "le" && bound < _upper_bound)
-			{
-				_upper_bound = bound;
-				_upper_tight = true;
-
-			}
-			else if (opr == "ge" && bound > _lower_bound)
-			{
-				_lower_bound = bound;
-				_lower_tight = true;
-			
-			}
-			else if (opr == "eq")
-			{
-				_lower_bound = _upper_bound = bound;
-				_lower_tight = _upper_tight = true;
-				break;
-			}
-			else
-				continue;
-		}		
-	}
+static ALTOErrorCode checkField(FieldState state)
+{
+	if (state == FIELD_MISSING)
+		return E_JSON_FIELD_MISSING;
+	if (state == FIELD_BAD_TYPE)
+		return E_JSON_VALUE_TYPE;
 	return E_OK;
 }
 
-ALTOErrorCode JsonPIDSet::readJson(std::string& json_str)
+static FieldState skipField(JsonScanner& scanner, JsonScanner::Token first)
 {
-	Object pl_obj;
-	std::stringstream ss (std::stringstream::in | std::stringstream::out);
-	ss << json_str;
-	try
-	{
-		Reader::Read(pl_obj, ss);
-	}
-	catch (...)
-	{
-		return E_SYNTAX;
-	}
+	scanner.skipValue(first);
+	return FIELD_BAD_TYPE;
+}
 
-	if (pl_obj.Find("pids") == pl_obj.End())
-		return E_JSON_FIELD_MISSING;
-	if (pl_obj.Find("pids")->type != ET_ARRAY)
-		return E_JSON_VALUE_TYPE;
-	
-	Array& array = pl_obj["pids"];
-	for (size_t i = 0; i < array.Size(); i++)
-	{
-		String& pid = array[i];
-		_pid_set.insert(pid.Value());
-	}
-	return E_OK;
+static FieldState readString(JsonScanner& scanner, JsonScanner::Token first, std::string& value)
+{
+	if (first != JsonScanner::T_STRING)
+		return skipField(scanner, first);
+	value.assign(scanner.getString(), scanner.getLength());
+	return FIELD_OK;
 }
 
-ALTOErrorCode JsonPIDMatrix::readJson(std::string& json_str)
+// Read an array of strings into a name set
+static FieldState readNames(JsonScanner& scanner, JsonScanner::Token first, JsonNameSet& names)
 {
-	Object obj;
-	std::stringstream ss (std::stringstream::in | std::stringstream::out);
-	ss << json_str;
+	if (first != JsonScanner::T_BEGIN_ARRAY)
+		return skipField(scanner, first);
 
-	try
-	{
-		Reader::Read(obj, ss);
-	}
-	catch(...)
+	FieldState state = FIELD_OK;
+	names.clear();
+	for (;;)
 	{
-		return E_SYNTAX;
+		JsonScanner::Token t = scanner.next();
+		if (t == JsonScanner::T_END_ARRAY)
+			break;
+		if (t == JsonScanner::T_STRING)
+			names.add(scanner.getString(), scanner.getLength());
+		else
+		{
+			state = FIELD_BAD_TYPE;
+			if (!scanner.skipValue(t))
+				break;
+		}
 	}
+	names.commit();
+	return state;
+}
 
-	if (obj.Find("cost-mode") == obj.End())
-		return E_JSON_FIELD_MISSING;
-	if (obj.Find("cost-mode")->type != ET_STRING)
-		return E_JSON_VALUE_TYPE;
-
-	if (obj.Find("cost-type") == obj.End())
-		return E_JSON_FIELD_MISSING;
-	if (obj.Find("cost-type")->type != ET_STRING)
-		return E_JSON_VALUE_TYPE;
-
-	if (obj.Find("pids") == obj.End())
-		return E_JSON_FIELD_MISSING;
-	if (obj.Find("pids")->type != ET_OBJECT)
-		return E_JSON_VALUE_TYPE;
-
-	ALTOErrorCode code = readConstraints(obj);
-	if (code != E_OK)
-		return code;
-	
-	String& cost_mode = obj["cost-mode"];
-	String& cost_type = obj["cost-type"];
-
-	_cost_mode = cost_mode.Value();
-	_cost_type = cost_type.Value();
-
-	Object& mat = obj["pids"];
-
-	if (mat.Find("srcs") == mat.End())
-		return E_JSON_FIELD_MISSING;
-	if (mat.Find("srcs")->type != ET_ARRAY)
-		return E_JSON_VALUE_TYPE;
+// Read an object of the form {"srcs": [...], "dsts": [...]}
+static FieldState readSrcsDsts(JsonScanner& scanner, JsonScanner::Token first,
+			       JsonNameSet& srcs, FieldState& srcs_state,
+			       JsonNameSet& dsts, FieldState& dsts_state)
+{
+	if (first != JsonScanner::T_BEGIN_OBJECT)
+		return skipField(scanner, first);
 
-	if (mat.Find("dsts") == mat.End())
-		return E_JSON_FIELD_MISSING;
-	if (mat.Find("dsts")->type != ET_ARRAY)
-		return E_JSON_VALUE_TYPE;
+	while (scanner.nextKey())
+	{
+		if (scanner.isString("srcs"))
+			srcs_state = readNames(scanner, scanner.next(), srcs);
+		else if (scanner.isString("dsts"))
+			dsts_state = readNames(scanner, scanner.next(), dsts);
+		else
+			scanner.skipValue(scanner.next());
+	}
+	return FIELD_OK;
+}
 
-	Array& srcs = mat["srcs"];
-	Array& dsts = mat["dsts"];
+// Check that the body has ended after the top-level object
+static bool endOfBody(JsonScanner& scanner)
+{
+	return !scanner.failed() && scanner.next() == JsonScanner::T_END;
+}
 
-	for (size_t i = 0; i < srcs.Size(); i++)
+ALTOErrorCode PostFilter::readConstraints(JsonScanner& scanner, JsonScanner::Token first)
+{
+	_has_constraints = true;
+	if (first != JsonScanner::T_BEGIN_ARRAY)
 	{
-		String& pid = (String&)srcs[i];
-		_srcs.insert(pid.Value());
+		skipField(scanner, first);
+		return E_JSON_VALUE_TYPE;
 	}
 
-	for (size_t i = 0; i < dsts.Size(); i++)
+	// [TODO] Now it only supports one zone generated by the constraints
+	ALTOErrorCode code = E_OK;
+	bool done = false;
+	for (;;)
 	{
-		String& pid = (String&)dsts[i];
-		_dsts.insert(pid.Value());
+		JsonScanner::Token t = scanner.next();
+		if (t == JsonScanner::T_END_ARRAY)
+			break;
+		if (t != JsonScanner::T_STRING)
+		{
+			code = E_JSON_VALUE_TYPE;
+			if (!scanner.skipValue(t))
+				break;
+			continue;
+		}
+		if (done || scanner.getLength() < 2)
+			continue;
+
+		const char* cons = scanner.getString();
+		double bound = std::strtod(cons + 2, NULL);
+		if (strncmp(cons, "lt", 2) == 0 && bound < _upper_bound)
+		{
+			_upper_bound = bound;
+			_upper_tight = false;
+		}
+		else if (strncmp(cons, "gt", 2) == 0 && bound > _lower_bound)
+		{
+			_lower_bound = bound;
+			_lower_tight = false;
+		}
+		else if (strncmp(cons, "le", 2) == 0 && bound < _upper_bound)
+		{
+			_upper_bound = bound;
+			_upper_tight = true;
+		}
+		else if (strncmp(cons, "ge", 2) == 0 && bound > _lower_bound)
+		{
+			_lower_bound = bound;
+			_lower_tight = true;
+		}
+		else if (strncmp(cons, "eq", 2) == 0)
+		{
+			_lower_bound = _upper_bound = bound;
+			_lower_tight = _upper_tight = true;
+			done = true;
+		}
 	}
-	return E_OK;
+	return code;
 }
 
-ALTOErrorCode JsonEndPointsProperty::readJson(std::string& json_str)
+ALTOErrorCode JsonPIDSet::readJson(std::string& json_str)
 {
-	Object obj;
-	std::stringstream ss (std::stringstream::in | std::stringstream::out);
-	ss << json_str;
-	try 
+	JsonScanner scanner(json_str);
+	if (scanner.next() != JsonScanner::T_BEGIN_OBJECT)
+		return E_SYNTAX;
+
+	FieldState pids = FIELD_MISSING;
+	while (scanner.nextKey())
 	{
-		Reader::Read(obj, ss);
+		if (scanner.isString("pids"))
+			pids = readNames(scanner, scanner.next(), _pid_set);
+		else
+			scanner.skipValue(scanner.next());
 	}
-	catch(...)
-	{
+	if (!endOfBody(scanner))
 		return E_SYNTAX;
-	}
-		
-	if (obj.Find("properties") == obj.End()) 
-		return E_JSON_FIELD_MISSING;
-	if (obj.Find("properties")->type != ET_ARRAY)
-		return E_JSON_VALUE_TYPE;
 
-	if (obj.Find("endpoints") == obj.End()) 
-		return E_JSON_FIELD_MISSING;
-	if (obj.Find("endpoints")->type != ET_ARRAY)
-		return E_JSON_VALUE_TYPE;
-
-	Array& array = obj["properties"];
-	Array& array2 = obj["endpoints"];
+	return checkField(pids);
+}
 
-	for (size_t i = 0; i < array.Size(); i++)
-	{
-		String& pid = (String&)array[i];
-		_properties.insert(pid.Value());
-	}
+ALTOErrorCode JsonPIDMatrix::readJson(std::string& json_str)
+{
+	JsonScanner scanner(json_str);
+	if (scanner.next() != JsonScanner::T_BEGIN_OBJECT)
+		return E_SYNTAX;
 
-	for (size_t i = 0; i < array2.Size(); i++)
+	FieldState cost_mode = FIELD_MISSING;
+	FieldState cost_type = FIELD_MISSING;
+	FieldState pids = FIELD_MISSING;
+	FieldState srcs = FIELD_MISSING;
+	FieldState dsts = FIELD_MISSING;
+	ALTOErrorCode constraints = E_OK;
+	while (scanner.nextKey())
 	{
-		String& pid = (String&)array2[i];
-		_end_points.insert(pid.Value());
+		if (scanner.isString("cost-mode"))
+			cost_mode = readString(scanner, scanner.next(), _cost_mode);
+		else if (scanner.isString("cost-type"))
+			cost_type = readString(scanner, scanner.next(), _cost_type);
+		else if (scanner.isString("pids"))
+			pids = readSrcsDsts(scanner, scanner.next(), _srcs, srcs, _dsts, dsts);
+		else if (scanner.isString("constraints"))
+			constraints = readConstraints(scanner, scanner.next());
+		else
+			scanner.skipValue(scanner.next());
 	}
+	if (!endOfBody(scanner))
+		return E_SYNTAX;
 
+	ALTOErrorCode code;
+	if ((code = checkField(cost_mode)) != E_OK
+	    || (code = checkField(cost_type)) != E_OK
+	    || (code = checkField(pids)) != E_OK
+	    || (code = constraints) != E_OK
+	    || (code = checkField(srcs)) != E_OK
+	    || (code = checkField(dsts)) != E_OK)
+		return code;
 	return E_OK;
 }
 
-ALTOErrorCode JsonEndPointsCost::readJson(std::string& json_str)
+ALTOErrorCode JsonEndPointsProperty::readJson(std::string& json_str)
 {
-	Object obj;
-	std::stringstream ss (std::stringstream::in | std::stringstream::out);
-	ss << json_str;
-	
-	try
+	JsonScanner scanner(json_str);
+	if (scanner.next() != JsonScanner::T_BEGIN_OBJECT)
+		return E_SYNTAX;
+
+	FieldState properties = FIELD_MISSING;
+	FieldState endpoints = FIELD_MISSING;
+	while (scanner.nextKey())
 	{
-		Reader::Read(obj, ss);
+		if (scanner.isString("properties"))
+			properties = readNames(scanner, scanner.next(), _properties);
+		else if (scanner.isString("endpoints"))
+			endpoints = readNames(scanner, scanner.next(), _end_points);
+		else
+			scanner.skipValue(scanner.next());
 	}
-	catch(...)
-	{
+	if (!endOfBody(scanner))
 		return E_SYNTAX;
-	}
-
-	if (obj.Find("cost-mode") == obj.End())
-		return E_JSON_FIELD_MISSING;
-	if (obj.Find("cost-mode")->type != ET_STRING)
-		return E_JSON_VALUE_TYPE;
-
-	if (obj.Find("cost-type") == obj.End())
-		return E_JSON_FIELD_MISSING;
-	if (obj.Find("cost-type")->type != ET_STRING)
-		return E_JSON_VALUE_TYPE;
 
-	if (obj.Find("endpoints") == obj.End())
-		return E_JSON_FIELD_MISSING;
-	if (obj.Find("endpoints")->type != ET_OBJECT)
-		return E_JSON_VALUE_TYPE;
-
-	ALTOErrorCode code = readConstraints(obj);
-	if (code != E_OK)
+	ALTOErrorCode code;
+	if ((code = checkField(properties)) != E_OK
+	    || (code = checkField(endpoints)) != E_OK)
 		return code;
+	return E_OK;
+}
 
-	String& cost_mode = obj["cost-mode"];
-	String& cost_type = obj["cost-type"];
-	_cost_mode = cost_mode.Value();
-	_cost_type = cost_type.Value();
-
-	Object& mat = obj["endpoints"];
-		
-	if (mat.Find("srcs") == mat.End())
-		return E_JSON_FIELD_MISSING;
-	if (mat.Find("srcs")->type != ET_ARRAY)
-		return E_JSON_VALUE_TYPE;
-
-	if (mat.Find("dsts") == mat.End())
-		return E_JSON_FIELD_MISSING;
-	if (mat.Find("dsts")->type != ET_ARRAY)
-		return E_JSON_VALUE_TYPE;
-
-	Array& srcs = mat["srcs"];
-	Array& dsts = mat["dsts"];
-
-	for (size_t i = 0; i < srcs.Size(); i++)
-	{
-		String& ip = (String&)srcs[i];
-		_srcs.insert(ip.Value());
-	}
+ALTOErrorCode JsonEndPointsCost::readJson(std::string& json_str)
+{
+	JsonScanner scanner(json_str);
+	if (scanner.next() != JsonScanner::T_BEGIN_OBJECT)
+		return E_SYNTAX;
 
-	for (size_t i = 0; i < dsts.Size(); i++)
+	FieldState cost_mode = FIELD_MISSING;
+	FieldState cost_type = FIELD_MISSING;
+	FieldState endpoints = FIELD_MISSING;
+	FieldState srcs = FIELD_MISSING;
+	FieldState dsts = FIELD_MISSING;
+	ALTOErrorCode constraints = E_OK;
+	while (scanner.nextKey())
 	{
-		String& ip = (String&)dsts[i];
-		_dsts.insert(ip.Value());
+		if (scanner.isString("cost-mode"))
+			cost_mode = readString(scanner, scanner.next(), _cost_mode);
+		else if (scanner.isString("cost-type"))
+			cost_type = readString(scanner, scanner.next(), _cost_type);
+		else if (scanner.isString("endpoints"))
+			endpoints = readSrcsDsts(scanner, scanner.next(), _srcs, srcs, _dsts, dsts);
+		else if (scanner.isString("constraints"))
+			constraints = readConstraints(scanner, scanner.next());
+		else
+			scanner.skipValue(scanner.next());
 	}
+	if (!endOfBody(scanner))
+		return E_SYNTAX;
 
+	ALTOErrorCode code;
+	if ((code = checkField(cost_mode)) != E_OK
+	    || (code = checkField(cost_type)) != E_OK
+	    || (code = checkField(endpoints)) != E_OK
+	    || (code = constraints) != E_OK
+	    || (code = checkField(srcs)) != E_OK
+	    || (code = checkField(dsts)) != E_OK)
+		return code;
 	return E_OK;
 }
-
-
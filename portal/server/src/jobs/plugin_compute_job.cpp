@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "plugin_compute_job.h"
+
+#include <vector>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include "state.h"
+#include "options.h"
+
+boost::mutex PluginComputeJob::BUSY_MUTEX;
+std::set<const OptPluginBase*> PluginComputeJob::BUSY;
+
+PluginComputeJob::PluginComputeJob(JobQueuePtr queue,
+				   OptPluginBasePtr plugin,
+				   NetStatePtr state, boost::shared_ptr<WritableLock> state_lock,
+				   const PinnedPIDSet& pids)
+	: Job(queue, boost::get_system_time()),
+	  name_(plugin->get_descriptor()->get_name()),
+	  plugin_(plugin),
+	  state_(state),
+	  state_lock_(state_lock),
+	  pids_(pids),
+	  started_(false),
+	  cancelled_(false),
+	  done_(false),
+	  rc_(0)
+{
+}
+
+PluginComputeJob::~PluginComputeJob()
+{
+	/* Discarded without running, e.g. by a stopped queue */
+	if (!started_ && !cancelled_)
+		release();
+}
+
+void PluginComputeJob::release()
+{
+	boost::mutex::scoped_lock l(BUSY_MUTEX);
+	BUSY.erase(plugin_.get());
+}
+
+void PluginComputeJob::run()
+{
+	{
+		boost::mutex::scoped_lock l(mutex_);
+		if (cancelled_)
+			return;
+		started_ = true;
+	}
+
+	get_logger()->debug("running optimization");
+	int rc = plugin_->compute_pdistances(*state_, *state_lock_, pids_);
+
+	release();
+
+	boost::mutex::scoped_lock l(mutex_);
+	rc_ = rc;
+	done_ = true;
+	done_cond_.notify_all();
+}
+
+bool PluginComputeJob::wait(const boost::posix_time::time_duration& budget, int& rc)
+{
+	boost::system_time deadline = boost::get_system_time() + budget;
+
+	boost::mutex::scoped_lock l(mutex_);
+	while (!done_)
+		if (!done_cond_.timed_wait(l, deadline))
+			break;
+
+	if (!done_)
+	{
+		if (!started_)
+		{
+			cancelled_ = true;
+			release();
+		}
+		return false;
+	}
+
+	rc = rc_;
+	return true;
+}
+
+int PluginComputeJob::compute(OptPluginBasePtr plugin,
+			      NetStatePtr state, boost::shared_ptr<WritableLock> state_lock,
+			      const PinnedPIDSet& pids)
+{
+	if (!PLUGIN_QUEUE)
+		return plugin->compute_pdistances(*state, *state_lock, pids);
+
+	boost::shared_ptr<PluginComputeJob> job(new PluginComputeJob(PLUGIN_QUEUE, plugin, state, state_lock, pids));
+
+	{
+		boost::mutex::scoped_lock l(BUSY_MUTEX);
+		if (!BUSY.insert(plugin.get()).second)
+		{
+			job->get_logger()->warn("previous computation still running; using last published pdistances");
+			return 0;
+		}
+	}
+
+	PLUGIN_QUEUE->enqueue(job);
+
+	int rc = 0;
+	if (!job->wait(get_budget(job->name_), rc))
+	{
+		job->get_logger()->warn("computation exceeded its time budget; using last published pdistances");
+		return 0;
+	}
+	return rc;
+}
+
+boost::posix_time::time_duration PluginComputeJob::get_budget(const std::string& name)
+{
+	unsigned int budget = OPTIONS["plugin-budget"].as<unsigned int>();
+
+	if (OPTIONS.count("plugin-time-budget"))
+	{
+		BOOST_FOREACH(const std::string& entry, OPTIONS["plugin-time-budget"].as<std::vector<std::string> >())
+		{
+			/* Entries are checked when the options are parsed */
+			std::string entry_name;
+			unsigned int entry_budget;
+			if (parse_budget(entry, entry_name, entry_budget) && entry_name == name)
+				budget = entry_budget;
+		}
+	}
+
+	return boost::posix_time::milliseconds(budget);
+}
+
+bool PluginComputeJob::parse_budget(const std::string& entry, std::string& name, unsigned int& budget)
+{
+	std::string::size_type sep = entry.rfind('=');
+	if (sep == std::string::npos || sep == 0)
+		return false;
+
+	std::string value = entry.substr(sep + 1);
+	if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+		return false;
+
+	try
+	{
+		budget = boost::lexical_cast<unsigned int>(value);
+	}
+	catch (boost::bad_lexical_cast& e)
+	{
+		return false;
+	}
+
+	name = entry.substr(0, sep);
+	return true;
+}
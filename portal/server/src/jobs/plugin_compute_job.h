@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef PLUGIN_COMPUTE_JOB_H
+#define PLUGIN_COMPUTE_JOB_H
+
+#include <set>
+#include <string>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <p4pserver/job_queue.h>
+#include "plugin_base.h"
+
+/**
+ * Runs one optimization plugin computation on the plugin job queue, so
+ * that the view update waiting for it is bounded by the plugin's time
+ * budget rather than by the plugin itself.
+ *
+ * A computation that overruns its budget is left to finish in the
+ * background. It holds only the view update's private copy of the
+ * network state, never any of the view's locks, so later view updates
+ * and admin transactions are not held up by it. No further computation
+ * for the same plugin instance is started in the meantime; the view
+ * update proceeds with the pdistances the plugin last published. A
+ * computation which has not started when its budget runs out (the plugin
+ * threads are busy, or the queue has been stopped) is cancelled.
+ */
+class PluginComputeJob : public Job
+{
+public:
+	PluginComputeJob(JobQueuePtr queue,
+			 OptPluginBasePtr plugin,
+			 NetStatePtr state, boost::shared_ptr<WritableLock> state_lock,
+			 const PinnedPIDSet& pids);
+
+	virtual ~PluginComputeJob();
+
+	virtual void run();
+
+	/**
+	 * Wait for the computation to finish.
+	 * @param budget	Maximum time to wait.
+	 * @param rc		Receives the plugin's return code if it finished.
+	 * @return True if the computation finished within the budget. If
+	 * 	it had not started yet, it is cancelled.
+	 */
+	bool wait(const boost::posix_time::time_duration& budget, int& rc);
+
+	/**
+	 * Run a plugin computation on the plugin job queue and wait for it
+	 * within the plugin's time budget. Runs the plugin inline if no
+	 * plugin job queue is configured.
+	 * @return Plugin's return code, or 0 if the computation overran its
+	 * 	budget or a previous one is still running.
+	 */
+	static int compute(OptPluginBasePtr plugin,
+			   NetStatePtr state, boost::shared_ptr<WritableLock> state_lock,
+			   const PinnedPIDSet& pids);
+
+	/**
+	 * Get the time budget configured for a plugin.
+	 * @param name	Plugin name.
+	 */
+	static boost::posix_time::time_duration get_budget(const std::string& name);
+
+	/**
+	 * Parse a plugin-time-budget entry.
+	 * @param entry		Entry of the form NAME=MILLISECONDS.
+	 * @param name		Receives the plugin name.
+	 * @param budget	Receives the budget in milliseconds.
+	 * @return False if the entry is malformed.
+	 */
+	static bool parse_budget(const std::string& entry, std::string& name, unsigned int& budget);
+
+protected:
+	virtual std::string get_logger_name() const { return "PluginComputeJob(" + name_ + ")"; }
+
+	virtual JobPtr make_next() { return JobPtr(); }
+
+private:
+	std::string name_;
+
+	OptPluginBasePtr plugin_;
+	NetStatePtr state_;
+	boost::shared_ptr<WritableLock> state_lock_;
+	PinnedPIDSet pids_;
+
+	/* Remove the plugin instance from BUSY */
+	void release();
+
+	boost::mutex mutex_;
+	boost::condition_variable done_cond_;
+	bool started_;
+	bool cancelled_;
+	bool done_;
+	int rc_;
+
+	/* Plugin instances with a computation queued or running */
+	static boost::mutex BUSY_MUTEX;
+	static std::set<const OptPluginBase*> BUSY;
+};
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "udp_snapshot_job.h"
+
+#include "state.h"
+
+UDPSnapshotJob::UDPSnapshotJob(JobQueuePtr queue, const boost::system_time& deadline, const std::string& name)
+	: Job(queue, deadline),
+	  name_(name)
+{
+}
+
+void UDPSnapshotJob::run()
+{
+	if (!UDP_SNAPSHOTS)
+		return;
+
+	get_logger()->debug("rebuilding snapshot");
+	if (name_.empty())
+		UDP_SNAPSHOTS->refresh_all();
+	else
+		UDP_SNAPSHOTS->refresh(name_);
+	get_logger()->debug("published snapshot");
+}
+
+bool UDPSnapshotJob::equals(JobPtr job)
+{
+	boost::shared_ptr<UDPSnapshotJob> snapshot_job = boost::dynamic_pointer_cast<UDPSnapshotJob>(job);
+	if (!snapshot_job)
+		return false;
+
+	return name_ == snapshot_job->name_;
+}
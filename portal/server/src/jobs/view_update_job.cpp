@@ -35,6 +35,9 @@
 #include "state.h"
 #include "plugin_base.h"
 #include "view_update.h"
+#include "map_response_job.h"
+#include "udp_snapshot_job.h"
+#include "update_stream_job.h"
 
 ViewUpdateJob::ViewUpdateJob(JobQueuePtr queue, const boost::system_time& deadline, const std::string& name)
 	: Job(queue, deadline),
@@ -47,15 +50,23 @@ void ViewUpdateJob::run()
 {
 	get_logger()->info("starting update");
 
+	UpdateTracePtr trace(new UpdateTrace(name_));
+
 	get_logger()->debug("acquiring locks");
 	GlobalStatePtr global_state = GLOBAL_STATE;
+	boost::posix_time::ptime wait_start = boost::posix_time::microsec_clock::universal_time();
 	UpgradableReadLock global_state_lock(*global_state);
+	trace->add_lock_wait("global", wait_start);
 
 	NetStatePtr net_state = global_state->get_net(global_state_lock);
+	wait_start = boost::posix_time::microsec_clock::universal_time();
 	BlockReadLock net_state_lock(*net_state);
+	trace->add_lock_wait("net", wait_start);
 
 	ViewRegistryPtr views = global_state->get_views(global_state_lock);
+	wait_start = boost::posix_time::microsec_clock::universal_time();
 	UpgradableReadLock views_lock(*views);
+	trace->add_lock_wait("views", wait_start);
 
 	ViewPtr view = views->get(name_, views_lock);
 	if (!view)
@@ -64,15 +75,32 @@ void ViewUpdateJob::run()
 		return;
 	}
 
+	wait_start = boost::posix_time::microsec_clock::universal_time();
 	ViewUpdateStateUpgrade view_state(view);
+	trace->add_lock_wait("view", wait_start);
+
+	ViewUpdateUpgrade update(global_state, global_state_lock,
+				 net_state, net_state_lock,
+				 views, views_lock,
+				 view_state);
+	update.set_trace(trace);
+	interval_ = update.do_update();
 
-	interval_ = ViewUpdateUpgrade(global_state, global_state_lock,
-				      net_state, net_state_lock,
-				      views, views_lock,
-				      view_state).do_update();
+	trace->finish(interval_ > 0);
+	if (UPDATE_TRACES)
+		UPDATE_TRACES->add(trace);
 
 	if (interval_ > 0)
 	{
+		/* Runs once this job has released the view; the update itself
+		 * dropped the responses of the previous version */
+		if (MAP_RESPONSES)
+			get_queue()->enqueue(JobPtr(new MapResponseJob(get_queue(), boost::get_system_time(), name_)));
+		if (UDP_SNAPSHOTS)
+			get_queue()->enqueue(JobPtr(new UDPSnapshotJob(get_queue(), boost::get_system_time(), name_)));
+		if (UPDATE_STREAMS)
+			get_queue()->enqueue(JobPtr(new UpdateStreamJob(get_queue(), boost::get_system_time(), name_)));
+
 		get_logger()->info("update succeeded; rescheduling");
 		reschedule();
 	}
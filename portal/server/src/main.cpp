@@ -30,6 +30,7 @@
 #include <boost/foreach.hpp>
 #include <boost/thread.hpp>
 #include <boost/lexical_cast.hpp>
+#include <algorithm>
 #include <vector>
 #include <queue>
 #include <signal.h>
@@ -39,7 +40,11 @@
 #include "constants.h"
 #include "view_registry.h"
 #include "state.h"
+#include "shared_object.h"
 #include "rest_request_handlers.h"
+#include "udp_request_handler.h"
+#include "map_response_job.h"
+#include "udp_snapshot_job.h"
 #include "build_info.h"
 
 /*
@@ -76,7 +81,9 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
-	init_logger(OPTIONS["log-level"].as<unsigned int>(), OPTIONS["log-ident"].as<std::string>());
+	init_logger(OPTIONS["log-level"].as<unsigned int>(),
+		    OPTIONS["log-ident"].as<std::string>(),
+		    OPTIONS["log-file"].as<std::string>());
 
 	/*
 	 * Logger used for the main loop and request handling
@@ -103,6 +110,26 @@ int main(int argc, char** argv)
 	logger.info("initializing global state");
 	init_state();
 
+	/* Load optimization plugins from shared objects */
+	if (OPTIONS.count("plugin-load"))
+	{
+		BOOST_FOREACH(const std::string& path, OPTIONS["plugin-load"].as<std::vector<std::string> >())
+		{
+			logger.info("loading optimization plugin %s", path.c_str());
+			try
+			{
+				load_opt_plugin(path);
+			}
+			catch (std::exception& e)
+			{
+				logger.error("failed to load optimization plugin %s: %s", path.c_str(), e.what());
+				std::cerr << "Failed to load optimization plugin " << path << ": " << e.what() << std::endl;
+				shutdown_logger();
+				return 1;
+			}
+		}
+	}
+
 	/* Move to the background if configured to do so */
 	if (OPTIONS.count("daemon"))
 	{
@@ -110,8 +137,20 @@ int main(int argc, char** argv)
 		daemon(0, 0);
 	}
 
+	/* The asynchronous logger's thread is only started after forking,
+	 * since it would not survive into the background process. */
+	if (OPTIONS.count("log-async"))
+	{
+		init_logger(OPTIONS["log-level"].as<unsigned int>(),
+			    OPTIONS["log-ident"].as<std::string>(),
+			    OPTIONS["log-file"].as<std::string>(),
+			    std::max(OPTIONS["log-async-buffer"].as<unsigned int>(), 1U));
+	}
+
 	{
 		JOB_QUEUE->start();
+		if (PLUGIN_QUEUE)
+			PLUGIN_QUEUE->start();
 
 		std::vector<ProtocolServerBaseAbstract*> servers;
 		BOOST_FOREACH(const std::string& intf, INTERFACE_LIST)
@@ -128,7 +167,10 @@ int main(int argc, char** argv)
 						INTERFACE_OPTIONS[intf + ".ssl-key-file"].as<std::string>(),
 						INTERFACE_OPTIONS[intf + ".connection-timeout"].as<unsigned int>(),
 						INTERFACE_OPTIONS[intf + ".connection-limit"].as<unsigned int>(),
-						INTERFACE_OPTIONS[intf + ".ip-connection-limit"].as<unsigned int>()
+						INTERFACE_OPTIONS[intf + ".ip-connection-limit"].as<unsigned int>(),
+						ProtocolServerRESTBase::parse_mode(INTERFACE_OPTIONS[intf + ".mode"].as<std::string>()),
+						INTERFACE_OPTIONS[intf + ".listen-backlog"].as<unsigned int>(),
+						INTERFACE_OPTIONS[intf + ".connection-memory-limit"].as<unsigned int>()
 						);
 				server->enable_all();
 				if (allow_admin)
@@ -144,10 +186,29 @@ int main(int argc, char** argv)
 
 				servers.push_back(server);
 			}
+			else if (type == "UDP")
+			{
+				UDPHandler::PortalUDPServer* server = new UDPHandler::PortalUDPServer(
+						INTERFACE_OPTIONS[intf + ".address"].as<std::string>(),
+						INTERFACE_OPTIONS[intf + ".port"].as<unsigned short>(),
+						INTERFACE_OPTIONS[intf + ".threads"].as<unsigned int>(),
+						INTERFACE_OPTIONS[intf + ".batch"].as<unsigned int>()
+						);
+				server->enable_all();
+				servers.push_back(server);
+			}
 			else
 				throw std::runtime_error("Invalid type '" + type + "' for interface '" + intf + "'");
 		}
 
+		/* Build the initial precomputed responses for REST interfaces */
+		if (MAP_RESPONSES)
+			JOB_QUEUE->enqueue(JobPtr(new MapResponseJob(JOB_QUEUE, boost::get_system_time())));
+
+		/* Publish the initial snapshots for UDP interfaces */
+		if (UDP_SNAPSHOTS)
+			JOB_QUEUE->enqueue(JobPtr(new UDPSnapshotJob(JOB_QUEUE, boost::get_system_time())));
+
 		/* Move from just behind init_state() to use information from configuration file */
 		/* Initilize InfoRes */
 		RESTHandler::InitInfoRes();
@@ -177,12 +238,19 @@ int main(int argc, char** argv)
 		/* Cleanup: notify each thread to stop */
 		logger.info("signalling background threads to terminate");
 		JOB_QUEUE->stop();
+		if (PLUGIN_QUEUE)
+			PLUGIN_QUEUE->stop();
 
 		/* Cleanup: join threads and cleanup soap environments */
 		logger.info("waiting for background threads to terminate");
 		JOB_QUEUE->join();
+		if (PLUGIN_QUEUE)
+			PLUGIN_QUEUE->join();
 	}
 
+	/* Write out any buffered log messages */
+	shutdown_logger();
+
 	return 0;
 }
 
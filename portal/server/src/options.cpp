@@ -34,7 +34,9 @@
 #include <boost/filesystem.hpp>
 #include <iostream>
 #include <fstream>
+#include <vector>
 #include "constants.h"
+#include "plugin_compute_job.h"
 
 namespace bpo = boost::program_options;
 namespace bfs = boost::filesystem;
@@ -63,6 +65,11 @@ void options_init()
 				"log level: 0=critical, 1=errors, 2=warnings, 3=info, 4=debug")
 	("log-ident",		bpo::value<std::string>()->default_value("p4p-portal"),
 				"identity for syslog messages")
+	("log-file",		bpo::value<std::string>()->default_value(""),
+				"append log messages to this file instead of syslog")
+	("log-async",		"write log messages from a background thread")
+	("log-async-buffer",	bpo::value<unsigned int>()->default_value(1024),
+				"log messages buffered per thread in log-async mode before further messages are dropped")
 	("cluster",		"run in clustered mode")
 	("daemon",		"run in background (daemon mode)")
 	("state-dir",		bpo::value<std::string>()->default_value(DEFAULT_STATE_DIR.string()),
@@ -71,27 +78,49 @@ void options_init()
 				"size of thread pool for handling background jobs")
 	("admin-txn-timeout",	bpo::value<unsigned int>()->default_value(3),
 				"number of seconds before cancelling an idle admin transaction")
+	("plugin-threads",	bpo::value<unsigned int>()->default_value(2),
+				"size of thread pool for running optimization plugins (0 runs them inside view updates)")
+	("plugin-budget",	bpo::value<unsigned int>()->default_value(10000),
+				"milliseconds a view update waits for its optimization plugin")
+	("plugin-time-budget",	bpo::value<std::vector<std::string> >()->composing(),
+				"per-plugin override of plugin-budget, as NAME=MILLISECONDS (may be repeated)")
+	("plugin-load",		bpo::value<std::vector<std::string> >()->composing(),
+				"shared object to load optimization plugins from at startup (may be repeated)")
+	("update-trace-history",	bpo::value<unsigned int>()->default_value(32),
+				"number of recent view update traces retained for the admin interface")
+	("precompute-responses",	bpo::value<bool>()->default_value(true),
+				"build and compress full network map, cost map and pDistance responses once per view update")
+	("update-stream-buffer",	bpo::value<unsigned int>()->default_value(1048576),
+				"bytes buffered for each update stream subscriber before it is resent the full maps (0 disables update streams)")
 	;
 
 	const_cast<bpo::options_description*>(&AVAILABLE_OPTIONS_INTERFACE)->add_options()
 	("type",		bpo::value<std::string>()->default_value("REST"),
-				"type of interface: only 'REST' is currently supported")
+				"type of interface: 'REST', or 'UDP' for PID and pDistance lookups only")
 	("address",		bpo::value<std::string>()->default_value(""),
-				"binding address (leave blank to bind to all) [NOTE: CURRENTLY UNSUPPORTED]")
+				"binding address (leave blank to bind to all) [NOTE: CURRENTLY UNSUPPORTED FOR REST]")
 	("port",		bpo::value<unsigned short>()->default_value(6671),
 				"listening port")
 	("threads",		bpo::value<unsigned int>()->default_value(4),
 				"maximum number of threads in pool")
+	("batch",		bpo::value<unsigned int>()->default_value(32),
+				"datagrams received and sent per system call (UDP only)")
 	("ssl-cert-file",	bpo::value<std::string>()->default_value(""),
 				"path to SSL certificate (leave blank to disable SSL) [NOTE: CURRENTLY UNSUPPORTED]")
 	("ssl-key-file",	bpo::value<std::string>()->default_value(""),
 				"path to SSL key (required if ssl-cert-file specified) [NOTE: CURRENTLY UNSUPPORTED]")
+	("mode",		bpo::value<std::string>()->default_value("select"),
+				"connection handling: 'select', 'poll', 'epoll' or 'thread-per-connection' (REST only; use 'epoll' for more than 1000 connections)")
 	("connection-timeout",	bpo::value<unsigned int>()->default_value(0),
-				"seconds of inactivity before a connection will be timed out (default is no timeout)")
+				"seconds of inactivity before a connection (including an idle keep-alive connection) will be timed out (default is no timeout)")
 	("connection-limit",	bpo::value<unsigned int>()->default_value(100),
 				"maximum number of connections (default is 100)")
 	("ip-connection-limit",	bpo::value<unsigned int>()->default_value(5),
 				"maximum number of connections per IP (default is 5)")
+	("listen-backlog",	bpo::value<unsigned int>()->default_value(0),
+				"length of the queue of pending connections (default is the system maximum)")
+	("connection-memory-limit", bpo::value<unsigned int>()->default_value(0),
+				"bytes of buffer memory per connection (default is the libmicrohttpd default of 32768)")
 	("allow-admin",		bpo::value<bool>()->default_value(false),
 				"allow administration")
 	;
@@ -177,12 +206,18 @@ void read_interfaces_file(const bfs::path& path, std::set<std::string>& interfac
 			available_options.add_options()
 				((group + ".threads").c_str(),
 				bpo::value<unsigned int>()->default_value(4));
+			available_options.add_options()
+				((group + ".batch").c_str(),
+				bpo::value<unsigned int>()->default_value(32));
 			available_options.add_options()
 				((group + ".ssl-cert-file").c_str(),
 				bpo::value<std::string>()->default_value(""));
 			available_options.add_options()
 				((group + ".ssl-key-file").c_str(),
 				bpo::value<std::string>()->default_value(""));
+			available_options.add_options()
+				((group + ".mode").c_str(),
+				bpo::value<std::string>()->default_value("select"));
 			available_options.add_options()
 				((group + ".connection-timeout").c_str(),
 				bpo::value<unsigned int>()->default_value(0));
@@ -192,6 +227,12 @@ void read_interfaces_file(const bfs::path& path, std::set<std::string>& interfac
 			available_options.add_options()
 				((group + ".ip-connection-limit").c_str(),
 				bpo::value<unsigned int>()->default_value(5));
+			available_options.add_options()
+				((group + ".listen-backlog").c_str(),
+				bpo::value<unsigned int>()->default_value(0));
+			available_options.add_options()
+				((group + ".connection-memory-limit").c_str(),
+				bpo::value<unsigned int>()->default_value(0));
 			available_options.add_options()
 				((group + ".allow-admin").c_str(),
 				bpo::value<bool>()->default_value(false));
@@ -283,6 +324,24 @@ void handle_options(int argc, char** argv)
 	}
 	bpo::notify(OPTIONS);
 
+	/*
+	 * Check per-plugin time budgets
+	 */
+	if (OPTIONS.count("plugin-time-budget"))
+	{
+		const std::vector<std::string>& budgets = OPTIONS["plugin-time-budget"].as<std::vector<std::string> >();
+		for (std::vector<std::string>::const_iterator itr = budgets.begin(); itr != budgets.end(); ++itr)
+		{
+			std::string name;
+			unsigned int budget;
+			if (!PluginComputeJob::parse_budget(*itr, name, budget))
+			{
+				std::cerr << "Error: invalid plugin-time-budget '" << *itr << "' (expected NAME=MILLISECONDS)" << std::endl;
+				exit(1);
+			}
+		}
+	}
+
 	/*
 	 * Handle 'help' option
 	 */
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef OPT_PLUGIN_CONGESTION_VOLUME_H
+#define OPT_PLUGIN_CONGESTION_VOLUME_H
+
+#include <vector>
+
+#include "plugin_base.h"
+#include "edge_pid_index.h"
+
+/**
+ * Minimize the intradomain congestion volume, sum_e max(0, t_e - c_e).
+ *
+ * Each intradomain edge carries a congestion price in [0, 1] which
+ * rises while the edge is loaded beyond its capacity and decays while
+ * it is not; the price is used directly as the edge pdistance. Edges
+ * with an external endpoint are left to the interdomain rule.
+ */
+class CongestionVolumePlugin : public OptPluginBase
+{
+	static const double INIT_PRICE = 0.0;
+	static const double MAX_PRICE = 1.0;
+	static const double EPS = 1e-12;
+
+	/* step size */
+	double mu_;
+
+	/* congestion volume observed at the last update */
+	double volume_;
+
+	/* edge congestion prices */
+	SparsePIDMatrix prices_;
+	BlockWriteLock prices_lock_;
+
+	/*
+	 * Per-edge working arrays for intradomain edges, indexed in edge
+	 * iteration order. Endpoints are indices into pid_index_.
+	 */
+	NetEdgeVector edges_;
+	std::vector<unsigned int> edge_srcs_;
+	std::vector<unsigned int> edge_dsts_;
+	std::vector<double> edge_traffic_;
+	std::vector<double> edge_capacity_;
+	std::vector<double> edge_price_;
+
+	/* endpoints of the edges above, and their entries in prices_ */
+	EdgePIDIndex pid_index_;
+	EdgePIDIndex::ResolvedPIDs price_pids_;
+
+public:
+	CongestionVolumePlugin(const OptPluginDescriptor* descriptor, double mu = 0.5)
+		: OptPluginBase(descriptor),
+		  prices_lock_(prices_)
+	{
+		mu_ = mu;
+		volume_ = 0.0;
+	}
+
+	virtual ~CongestionVolumePlugin() {}
+
+	double get_mu()
+	{
+		return mu_;
+	}
+
+	void set_mu(double mu)
+	{
+		mu_ = mu;
+	}
+
+	double get_volume()
+	{
+		return volume_;
+	}
+
+	virtual int compute_pdistances(const NetState& state, const ReadableLock& state_lock,
+				   const PinnedPIDSet& pids);
+
+private:
+	void load_edges(const NetState& state, const ReadableLock& state_lock);
+	double compute_edge_volume() const;
+	void step_price();
+	void store_edges();
+
+	void dump_edge_price(const NetState& state, const ReadableLock& state_lock);
+};
+
+class CongestionVolumeDescriptor : public OptPluginDescriptor
+{
+public:
+	virtual std::string get_name() const
+	{ return "congestion-volume"; }
+
+	virtual std::string get_description() const
+	{ return "Minimize intradomain congestion volume using congestion prices"; }
+
+	virtual OptPluginBasePtr create_instance()
+	{ return OptPluginBasePtr(new CongestionVolumePlugin(this)); }
+};
+
+extern OptPluginDescriptor* OptPluginCongestionVolumeDescriptor;
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "edge_pid_index.h"
+
+#include <stdexcept>
+
+void EdgePIDIndex::clear()
+{
+	indices_.clear();
+	pids_.clear();
+	pid_set_.clear();
+}
+
+unsigned int EdgePIDIndex::add(const NetState& state, const ReadableLock& state_lock, const NetVertex& v)
+{
+	std::pair<NetVertexIndexMap::iterator, bool> res = indices_.insert(std::make_pair(v, pids_.size()));
+	if (res.second)
+	{
+		const p4p::PID& pid = state.get_pid(v, state_lock);
+		pids_.push_back(&pid);
+		pid_set_.insert(pid);
+	}
+	return res.first->second;
+}
+
+void EdgePIDIndex::resolve(SparsePIDMatrix& matrix, const WritableLock& lock, ResolvedPIDs& result) const
+{
+	/* Matrices only hold entries for PIDs they already know about */
+	matrix.add_pids(pid_set_, lock);
+
+	const PIDMatrixPIDsByLoc& matrix_pids = matrix.get_pids_set(lock);
+	result.resize(pids_.size());
+	for (unsigned int i = 0; i < pids_.size(); ++i)
+	{
+		PIDMatrixPIDsByLoc::const_iterator itr = matrix_pids.find(*pids_[i]);
+		if (itr == matrix_pids.end())
+			throw std::runtime_error("PID missing from matrix after adding it");
+		result[i] = &*itr;
+	}
+}
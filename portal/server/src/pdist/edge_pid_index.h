@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef EDGE_PID_INDEX_H
+#define EDGE_PID_INDEX_H
+
+#include <vector>
+#include <p4p/pid.h>
+#include <p4pserver/net_state.h>
+#include <p4pserver/pid_matrix.h>
+
+/**
+ * Numbers the endpoints of the edges an optimization plugin works on,
+ * so that per-edge arrays can refer to them by a small integer, and
+ * resolves their PIDs against a PID matrix once per vertex rather than
+ * once per edge.
+ */
+class EdgePIDIndex
+{
+public:
+	typedef std::vector<const IndexedPID*> ResolvedPIDs;
+
+	/**
+	 * Forget all recorded vertices.
+	 */
+	void clear();
+
+	/**
+	 * Record an edge endpoint.
+	 * @param state		Network state holding the vertex.
+	 * @param state_lock	Read-lock for the network state.
+	 * @param v		Vertex to record.
+	 * @return Index of the vertex, stable until the next clear().
+	 */
+	unsigned int add(const NetState& state, const ReadableLock& state_lock, const NetVertex& v);
+
+	/**
+	 * Get the number of recorded vertices.
+	 */
+	unsigned int size() const { return pids_.size(); }
+
+	/**
+	 * Get the PID of a recorded vertex.
+	 */
+	const p4p::PID& get_pid(unsigned int i) const { return *pids_[i]; }
+
+	/**
+	 * Add the PIDs of all recorded vertices to a matrix and look them up.
+	 * @param matrix	Matrix to resolve against.
+	 * @param lock		Write-lock for the matrix.
+	 * @param result	Receives one entry per recorded vertex, valid until
+	 * 			the PIDs of the matrix are next changed.
+	 */
+	void resolve(SparsePIDMatrix& matrix, const WritableLock& lock, ResolvedPIDs& result) const;
+
+private:
+	NetVertexIndexMap indices_;
+	std::vector<const p4p::PID*> pids_;
+	p4p::PIDSet pid_set_;
+};
+
+#endif
@@ -35,19 +35,17 @@
 
 int MLUPlugin::
 compute_pdistances(const NetState& state, const ReadableLock& state_lock,
-	       const ViewState& view,
 	       const PinnedPIDSet& pids)
 try {
 	//TODO: error check on the value of p, t, c
 
+	load_edges(state, state_lock);
+
 	// set up scaling factors
-	BOOST_FOREACH(const NetEdge& e, state.get_edges(state_lock))
-	{
-		set_edge_scaling(state, state_lock, e, state.get_capacity(e, state_lock));
-	}
+	rescale_edges();
 
 	/* update: alpha = max(t_e / c_e) */
-	alpha_ = compute_mlu(state, state_lock);
+	alpha_ = compute_edge_mlu();
 	get_logger()->info("current MLU: %f", alpha_);
 
 	if (get_logger()->isDebugEnabled())
@@ -59,7 +57,7 @@ try {
 
 	// update scaled edge pdistances
 	get_logger()->info("adjusting scaled edge pdistances via supergradient");
-	update_scaled_edge_pdistance(state, state_lock, alpha_);
+	step_scaled_edge_pdistance(alpha_);
 
 	if (get_logger()->isDebugEnabled())
 	{
@@ -67,6 +65,8 @@ try {
 		dump_scaled_edge_pdistance(state, state_lock);
 	}
 
+	store_edges();
+
 	get_logger()->info("finished successfully");
 	return 0;
 } catch (...) {
@@ -96,93 +96,176 @@ compute_mlu(const NetState& state, const ReadableLock& state_lock)
 void MLUPlugin::
 update_scaled_edge_pdistance(const NetState& state, const ReadableLock& state_lock, double mlu)
 {
-	NetEdgeItrPair edges = state.get_edges(state_lock);
+	load_edges(state, state_lock);
+	step_scaled_edge_pdistance(mlu);
+	store_edges();
+}
+
+void MLUPlugin::
+load_edges(const NetState& state, const ReadableLock& state_lock)
+{
+	unsigned int num_edges = state.get_num_edges(state_lock);
+	pid_index_.clear();
+	edges_.clear();
+	edges_.reserve(num_edges);
+	edge_srcs_.resize(num_edges);
+	edge_dsts_.resize(num_edges);
+	edge_traffic_.resize(num_edges);
+	edge_capacity_.resize(num_edges);
+	edge_scaled_pdistance_.resize(num_edges);
+	edge_scaling_.resize(num_edges);
+
+	unsigned int i = 0;
+	BOOST_FOREACH(const NetEdge& e, state.get_edges(state_lock))
+	{
+		NetVertex v_src, v_dst;
+		state.get_edge_vert(e, v_src, v_dst, state_lock);
 
+		edges_.push_back(e);
+		edge_srcs_[i] = pid_index_.add(state, state_lock, v_src);
+		edge_dsts_[i] = pid_index_.add(state, state_lock, v_dst);
+		edge_traffic_[i] = state.get_traffic(e, state_lock);
+		edge_capacity_[i] = state.get_capacity(e, state_lock);
+		++i;
+	}
+
+	pid_index_.resolve(scaled_edge_pdistances_, scaled_edge_pdistances_lock_, scaled_edge_pdistance_pids_);
+	pid_index_.resolve(scaling_, scaling_lock_, scaling_pids_);
+	for (i = 0; i < num_edges; ++i)
+	{
+		unsigned int src = edge_srcs_[i];
+		unsigned int dst = edge_dsts_[i];
+		edge_scaled_pdistance_[i] = scaled_edge_pdistances_.get(*scaled_edge_pdistance_pids_[src], *scaled_edge_pdistance_pids_[dst], scaled_edge_pdistances_lock_, INIT_PDISTANCE);
+		edge_scaling_[i] = scaling_.get(*scaling_pids_[src], *scaling_pids_[dst], scaling_lock_, INIT_SCALING);
+	}
+}
+
+void MLUPlugin::
+rescale_edges()
+{
 	/**
-	 * Super-gradient: p_e = p_e + mu * (t_e / c_e - mlu).
+	 * Scale each edge by its capacity, keeping the externally
+	 * observable edge pdistance (scaled / scaling) unchanged.
 	 */
-	double sum_p_e = 0.0;
-	for (NetEdgeItr e_itr = edges.first; e_itr != edges.second; ++e_itr)
+	const unsigned int n = edges_.size();
+	const double* c = n > 0 ? &edge_capacity_[0] : NULL;
+	double* p = n > 0 ? &edge_scaled_pdistance_[0] : NULL;
+	double* s = n > 0 ? &edge_scaling_[0] : NULL;
+
+	for (unsigned int i = 0; i < n; ++i)
 	{
-		double p_e = get_scaled_edge_pdistance(state, state_lock, *e_itr);
-		double t_e = state.get_traffic(*e_itr, state_lock);
-		double c_e = state.get_capacity(*e_itr, state_lock);
+		if (c[i] < EPS)
+			throw std::invalid_argument("scaling factor must be greater than EPS");
+		p[i] = p[i] / s[i] * c[i];
+		s[i] = c[i];
+	}
+}
 
-		p_e += mu_ * (t_e / c_e - mlu);
-		if (p_e < 0) {
-			p_e = 0;
-		}
+double MLUPlugin::
+compute_edge_mlu() const
+{
+	const unsigned int n = edges_.size();
+	double mlu = 0.0;
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		double LU_e = edge_traffic_[i] / edge_capacity_[i];
+		mlu = mlu < LU_e ? LU_e : mlu;
+	}
+	return mlu;
+}
 
-		set_scaled_edge_pdistance(state, state_lock, *e_itr, p_e);
+void MLUPlugin::
+step_scaled_edge_pdistance(double mlu)
+{
+	const unsigned int n = edges_.size();
+	if (n == 0)
+		return;
+
+	const double* t = &edge_traffic_[0];
+	const double* c = &edge_capacity_[0];
+	double* p = &edge_scaled_pdistance_[0];
+
+	/**
+	 * Super-gradient: p_e = p_e + mu * (t_e / c_e - mlu).
+	 */
+	double sum_p_e = 0.0;
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		double p_e = p[i] + mu_ * (t[i] / c[i] - mlu);
+		p_e = p_e < 0 ? 0 : p_e;
+		p[i] = p_e;
 		sum_p_e += p_e;
 	}
 
 	/**
 	 * Projection: p_e = p_e / sum(p_e).
 	 */
-	int num_edges = state.get_num_edges(state_lock);
-	for (NetEdgeItr e_itr = edges.first; e_itr != edges.second; ++e_itr)
+	if (sum_p_e > EPS)
 	{
-		double p_e = get_scaled_edge_pdistance(state, state_lock, *e_itr);
-
-		if (sum_p_e > EPS) {
-			p_e /= sum_p_e;
-		} else {
-			/**
-			 * NOTE: sum_p_e <= EPS indicates that all edge pdistances
-			 * are close to 0, and we must re-calibrate the pdistances.
-			 */
-			p_e = 1.0 / num_edges;
-		}
-
-		set_scaled_edge_pdistance(state, state_lock, *e_itr, p_e);
+		double inv_sum = 1.0 / sum_p_e;
+		for (unsigned int i = 0; i < n; ++i)
+			p[i] *= inv_sum;
 	}
+	else
+	{
+		/**
+		 * NOTE: sum_p_e <= EPS indicates that all edge pdistances
+		 * are close to 0, and we must re-calibrate the pdistances.
+		 */
+		for (unsigned int i = 0; i < n; ++i)
+			p[i] = 1.0 / n;
+	}
+}
 
+void MLUPlugin::
+store_edges()
+{
 	/**
-	 * Update set of unscaled edge pdistances
+	 * Write back scaled pdistances and scaling factors, and update
+	 * the set of unscaled edge pdistances.
 	 */
 	SparsePIDMatrix* result_pdistances = get_edge_pdistances();
 	BlockWriteLock result_pdistances_lock(*result_pdistances);
-	BOOST_FOREACH(const NetEdge& e, state.get_edges(state_lock))
+	EdgePIDIndex::ResolvedPIDs result_pids;
+	pid_index_.resolve(*result_pdistances, result_pdistances_lock, result_pids);
+	for (unsigned int i = 0; i < edges_.size(); ++i)
 	{
-		NetVertex v_src, v_dst;
-		state.get_edge_vert(e, v_src, v_dst, state_lock);
-		const p4p::PID&  l_src = state.get_pid(v_src, state_lock);
-		const p4p::PID&  l_dst = state.get_pid(v_dst, state_lock);
-		result_pdistances->set_by_pid(l_src, l_dst,
-					  scaled_edge_pdistances_.get_by_pid(l_src, l_dst, scaled_edge_pdistances_lock_)
-					  / scaling_.get_by_pid(l_src, l_dst,scaling_lock_),
-					  result_pdistances_lock);
+		unsigned int src = edge_srcs_[i];
+		unsigned int dst = edge_dsts_[i];
+		scaled_edge_pdistances_.set(*scaled_edge_pdistance_pids_[src], *scaled_edge_pdistance_pids_[dst], edge_scaled_pdistance_[i], scaled_edge_pdistances_lock_);
+		scaling_.set(*scaling_pids_[src], *scaling_pids_[dst], edge_scaling_[i], scaling_lock_);
+		result_pdistances->set(*result_pids[src], *result_pids[dst],
+				       edge_scaled_pdistance_[i] / edge_scaling_[i],
+				       result_pdistances_lock);
 	}
 }
 
 void MLUPlugin::
 dump_scaled_edge_pdistance(const NetState& state, const ReadableLock& state_lock)
 {
-	BOOST_FOREACH(const NetEdge& e, state.get_edges(state_lock))
+	for (unsigned int i = 0; i < edges_.size(); ++i)
 	{
 		NetVertex v_src, v_dst;
-		state.get_edge_vert(e, v_src, v_dst, state_lock);
+		state.get_edge_vert(edges_[i], v_src, v_dst, state_lock);
 
 		get_logger()->debug("scaled pdistance for edge %s->%s: %.12lf",
 				    state.get_name(v_src, state_lock).c_str(),
 				    state.get_name(v_dst, state_lock).c_str(),
-				    get_scaled_edge_pdistance(state, state_lock, e));
+				    edge_scaled_pdistance_[i]);
 	}
 }
 
 void MLUPlugin::
 dump_edge_utilization(const NetState& state, const ReadableLock& state_lock)
 {
-	BOOST_FOREACH(const NetEdge& e, state.get_edges(state_lock))
+	for (unsigned int i = 0; i < edges_.size(); ++i)
 	{
 		NetVertex from, to;
-		state.get_edge_vert(e, from, to, state_lock);
+		state.get_edge_vert(edges_[i], from, to, state_lock);
 
 		get_logger()->debug("Edge '%s' -> '%s' utilization: %f",
 				    state.get_name(from, state_lock).c_str(),
 				    state.get_name(to, state_lock).c_str(),
-				    state.get_traffic(e, state_lock)
-				    / state.get_capacity(e, state_lock));
+				    edge_traffic_[i] / edge_capacity_[i]);
 	}
 }
@@ -31,8 +31,10 @@
 #define OPT_PLUGIN_MLU_H
 
 #include <stdexcept>
+#include <vector>
 
 #include "plugin_base.h"
+#include "edge_pid_index.h"
 
 class MLUPlugin : public OptPluginBase
 {
@@ -56,6 +58,26 @@ class MLUPlugin : public OptPluginBase
 	SparsePIDMatrix scaling_;
 	BlockWriteLock scaling_lock_;
 
+	/*
+	 * Per-edge working arrays, indexed in edge iteration order. They are
+	 * filled from the network state and the matrices above once per
+	 * update, so that the super-gradient loops touch only contiguous
+	 * memory, and written back in a single pass afterwards. Endpoints
+	 * are indices into pid_index_.
+	 */
+	NetEdgeVector edges_;
+	std::vector<unsigned int> edge_srcs_;
+	std::vector<unsigned int> edge_dsts_;
+	std::vector<double> edge_traffic_;
+	std::vector<double> edge_capacity_;
+	std::vector<double> edge_scaled_pdistance_;
+	std::vector<double> edge_scaling_;
+
+	/* endpoints of the edges above, and their entries in the matrices */
+	EdgePIDIndex pid_index_;
+	EdgePIDIndex::ResolvedPIDs scaled_edge_pdistance_pids_;
+	EdgePIDIndex::ResolvedPIDs scaling_pids_;
+
 public:
 	MLUPlugin(const OptPluginDescriptor* descriptor, double mu = 1.0)
 		: OptPluginBase(descriptor),
@@ -130,10 +152,15 @@ public:
 	void update_scaled_edge_pdistance(const NetState& state, const ReadableLock& state_lock, double mlu);
 
 	virtual int compute_pdistances(const NetState& state, const ReadableLock& state_lock,
-				   const ViewState& view,
 				   const PinnedPIDSet& pids);
 
 private:
+	void load_edges(const NetState& state, const ReadableLock& state_lock);
+	void rescale_edges();
+	double compute_edge_mlu() const;
+	void step_scaled_edge_pdistance(double mlu);
+	void store_edges();
+
 	void dump_scaled_edge_pdistance(const NetState& state, const ReadableLock& state_lock);
 	void dump_edge_utilization(const NetState& state, const ReadableLock& state_lock);
 };
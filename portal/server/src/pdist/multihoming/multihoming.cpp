@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "multihoming.h"
+
+#include <stdexcept>
+#include <boost/foreach.hpp>
+#include "view.h"
+
+int MultihomingCostPlugin::
+compute_pdistances(const NetState& state, const ReadableLock& state_lock,
+	       const PinnedPIDSet& pids)
+try {
+	load_edges(state, state_lock);
+
+	overage_ = compute_edge_overage();
+	get_logger()->info("current traffic above committed rates: %f", overage_);
+
+	get_logger()->info("adjusting interdomain edge surcharges");
+	step_surcharge();
+
+	if (get_logger()->isDebugEnabled())
+		dump_edge_surcharge(state, state_lock);
+
+	store_edges();
+
+	get_logger()->info("finished successfully");
+	return 0;
+} catch (...) {
+	return -1;
+}
+
+OptPluginDescriptor* OptPluginMultihomingCostDescriptor = new MultihomingCostDescriptor();
+
+void MultihomingCostPlugin::
+load_edges(const NetState& state, const ReadableLock& state_lock)
+{
+	pid_index_.clear();
+	edges_.clear();
+	edge_srcs_.clear();
+	edge_dsts_.clear();
+	edge_traffic_.clear();
+	edge_commit_.clear();
+
+	BOOST_FOREACH(const NetEdge& e, state.get_edges(state_lock))
+	{
+		NetVertex v_src, v_dst;
+		state.get_edge_vert(e, v_src, v_dst, state_lock);
+		if (!state.get_external(v_src, state_lock) && !state.get_external(v_dst, state_lock))
+			continue;
+
+		double c_e = state.get_capacity(e, state_lock);
+		if (c_e < EPS)
+			throw std::invalid_argument("committed rate must be greater than EPS");
+
+		edges_.push_back(e);
+		edge_srcs_.push_back(pid_index_.add(state, state_lock, v_src));
+		edge_dsts_.push_back(pid_index_.add(state, state_lock, v_dst));
+		edge_traffic_.push_back(state.get_traffic(e, state_lock));
+		edge_commit_.push_back(c_e);
+	}
+
+	pid_index_.resolve(surcharges_, surcharges_lock_, surcharge_pids_);
+	edge_surcharge_.resize(edges_.size());
+	for (unsigned int i = 0; i < edges_.size(); ++i)
+		edge_surcharge_[i] = surcharges_.get(*surcharge_pids_[edge_srcs_[i]], *surcharge_pids_[edge_dsts_[i]], surcharges_lock_, INIT_SURCHARGE);
+}
+
+double MultihomingCostPlugin::
+compute_edge_overage() const
+{
+	const unsigned int n = edges_.size();
+	double overage = 0.0;
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		double excess = edge_traffic_[i] - edge_commit_[i];
+		overage += excess > 0 ? excess : 0;
+	}
+	return overage;
+}
+
+void MultihomingCostPlugin::
+step_surcharge()
+{
+	const unsigned int n = edges_.size();
+	if (n == 0)
+		return;
+
+	const double* t = &edge_traffic_[0];
+	const double* c = &edge_commit_[0];
+	double* s = &edge_surcharge_[0];
+
+	/**
+	 * Sub-gradient on the commit constraint t_e <= c_e:
+	 * s_e = [s_e + mu * (t_e - c_e) / c_e] projected onto [0, MAX_SURCHARGE].
+	 */
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		double s_e = s[i] + mu_ * (t[i] - c[i]) / c[i];
+		s_e = s_e < 0 ? 0 : s_e;
+		if (s_e > MAX_SURCHARGE)
+			s_e = MAX_SURCHARGE;
+		s[i] = s_e;
+	}
+}
+
+void MultihomingCostPlugin::
+store_edges()
+{
+	SparsePIDMatrix* result_pdistances = get_edge_pdistances();
+	BlockWriteLock result_pdistances_lock(*result_pdistances);
+	EdgePIDIndex::ResolvedPIDs result_pids;
+	pid_index_.resolve(*result_pdistances, result_pdistances_lock, result_pids);
+	for (unsigned int i = 0; i < edges_.size(); ++i)
+	{
+		unsigned int src = edge_srcs_[i];
+		unsigned int dst = edge_dsts_[i];
+		surcharges_.set(*surcharge_pids_[src], *surcharge_pids_[dst], edge_surcharge_[i], surcharges_lock_);
+		result_pdistances->set(*result_pids[src], *result_pids[dst], BASE_PDISTANCE + edge_surcharge_[i], result_pdistances_lock);
+	}
+}
+
+void MultihomingCostPlugin::
+dump_edge_surcharge(const NetState& state, const ReadableLock& state_lock)
+{
+	for (unsigned int i = 0; i < edges_.size(); ++i)
+	{
+		NetVertex v_src, v_dst;
+		state.get_edge_vert(edges_[i], v_src, v_dst, state_lock);
+
+		get_logger()->debug("surcharge for interdomain edge %s->%s (%f of commit): %.12lf",
+				    state.get_name(v_src, state_lock).c_str(),
+				    state.get_name(v_dst, state_lock).c_str(),
+				    edge_traffic_[i] / edge_commit_[i],
+				    edge_surcharge_[i]);
+	}
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef OPT_PLUGIN_MULTIHOMING_H
+#define OPT_PLUGIN_MULTIHOMING_H
+
+#include <vector>
+
+#include "plugin_base.h"
+#include "edge_pid_index.h"
+
+/**
+ * Minimize the cost of interdomain (multihoming) links, where each link
+ * is billed for the traffic it carries beyond its committed rate. The
+ * capacity configured for an interdomain link is taken as its committed
+ * rate.
+ *
+ * Every interdomain edge has a base pdistance of 1 plus a surcharge
+ * that grows while the link runs beyond its committed rate and decays
+ * once it is back under it, steering peers towards the links that still
+ * have prepaid headroom. Intradomain edges are left untouched.
+ */
+class MultihomingCostPlugin : public OptPluginBase
+{
+	static const double BASE_PDISTANCE = 1.0;
+	static const double INIT_SURCHARGE = 0.0;
+	static const double MAX_SURCHARGE = 99.0;
+	static const double EPS = 1e-12;
+
+	/* step size */
+	double mu_;
+
+	/* traffic above committed rate observed at the last update */
+	double overage_;
+
+	/* edge surcharges */
+	SparsePIDMatrix surcharges_;
+	BlockWriteLock surcharges_lock_;
+
+	/*
+	 * Per-edge working arrays for interdomain edges, indexed in edge
+	 * iteration order. Endpoints are indices into pid_index_.
+	 */
+	NetEdgeVector edges_;
+	std::vector<unsigned int> edge_srcs_;
+	std::vector<unsigned int> edge_dsts_;
+	std::vector<double> edge_traffic_;
+	std::vector<double> edge_commit_;
+	std::vector<double> edge_surcharge_;
+
+	/* endpoints of the edges above, and their entries in surcharges_ */
+	EdgePIDIndex pid_index_;
+	EdgePIDIndex::ResolvedPIDs surcharge_pids_;
+
+public:
+	MultihomingCostPlugin(const OptPluginDescriptor* descriptor, double mu = 1.0)
+		: OptPluginBase(descriptor),
+		  surcharges_lock_(surcharges_)
+	{
+		mu_ = mu;
+		overage_ = 0.0;
+	}
+
+	virtual ~MultihomingCostPlugin() {}
+
+	double get_mu()
+	{
+		return mu_;
+	}
+
+	void set_mu(double mu)
+	{
+		mu_ = mu;
+	}
+
+	double get_overage()
+	{
+		return overage_;
+	}
+
+	virtual int compute_pdistances(const NetState& state, const ReadableLock& state_lock,
+				   const PinnedPIDSet& pids);
+
+private:
+	void load_edges(const NetState& state, const ReadableLock& state_lock);
+	double compute_edge_overage() const;
+	void step_surcharge();
+	void store_edges();
+
+	void dump_edge_surcharge(const NetState& state, const ReadableLock& state_lock);
+};
+
+class MultihomingCostDescriptor : public OptPluginDescriptor
+{
+public:
+	virtual std::string get_name() const
+	{ return "multihoming-cost"; }
+
+	virtual std::string get_description() const
+	{ return "Minimize interdomain traffic beyond committed rates"; }
+
+	virtual OptPluginBasePtr create_instance()
+	{ return OptPluginBasePtr(new MultihomingCostPlugin(this)); }
+};
+
+extern OptPluginDescriptor* OptPluginMultihomingCostDescriptor;
+
+#endif
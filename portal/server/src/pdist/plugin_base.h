@@ -48,14 +48,6 @@ class OptPluginDescriptor;
 class OptPluginBase
 {
 public:
-	typedef ViewWrapper<
-		const ReadableLock, const BlockReadLock,
-		const ReadableLock, const BlockReadLock,
-		const ReadableLock, const BlockReadLock,
-		const ReadableLock, const BlockReadLock,
-		const ReadableLock, const BlockReadLock
-	> ViewState;
-
 	/**
 	 * Default constructor. Will be called to create an instance
 	 * of this plugin.
@@ -70,16 +62,16 @@ public:
 	virtual ~OptPluginBase();
 
 	/**
-	 * Compute new edge pdistances given the current network status.
+	 * Compute new edge pdistances given the current network status. The
+	 * computation may outlive the view update that started it (see
+	 * PluginComputeJob), so it is given no access to the view's locked
+	 * data; 'state' is a private copy of the network status.
 	 * @param state			Current network status.
 	 * @param state_lock		Pre-initialized read-lock for the network status.
-	 * @param view			View which we are optimizing. DO NOT acquire write locks
-	 * 				for any data structures contained in the View.
 	 * @param pids		Set of PIDs with their associated vertices.
 	 * @return Non-zero to indicate error, or 0 for success.
 	 */
 	virtual int compute_pdistances(const NetState& state, const ReadableLock& state_lock,
-				   const ViewState& view,
 				   const PinnedPIDSet& pids) = 0;
 
 	/**
@@ -35,6 +35,8 @@
  * Default plugins
  */
 #include "mlu.h"
+#include "congestion_volume.h"
+#include "multihoming.h"
 
 OptPluginRegistry* OptPluginRegistry::INSTANCE = NULL;
 boost::mutex* OptPluginRegistry::INSTANCE_MUTEX = new boost::mutex();
@@ -42,6 +44,8 @@ boost::mutex* OptPluginRegistry::INSTANCE_MUTEX = new boost::mutex();
 OptPluginRegistry::OptPluginRegistry()
 {
 	register_descriptor(OptPluginMLUDescriptor);
+	register_descriptor(OptPluginCongestionVolumeDescriptor);
+	register_descriptor(OptPluginMultihomingCostDescriptor);
 }
 
 void OptPluginRegistry::register_descriptor(OptPluginDescriptor* desc)
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "shared_object.h"
+
+#include <dlfcn.h>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/foreach.hpp>
+#include <boost/thread/mutex.hpp>
+#include "plugin_registry.h"
+
+SharedObjectPlugin::SharedObjectPlugin(const OptPluginDescriptor* descriptor, const portal_opt_plugin* impl, void* instance)
+	: OptPluginBase(descriptor),
+	  impl_(impl),
+	  instance_(instance)
+{
+}
+
+SharedObjectPlugin::~SharedObjectPlugin()
+{
+	if (impl_->destroy)
+		impl_->destroy(instance_);
+}
+
+int SharedObjectPlugin::
+compute_pdistances(const NetState& state, const ReadableLock& state_lock,
+	       const PinnedPIDSet& pids)
+try {
+	load_edges(state, state_lock);
+
+	portal_opt_edges edges;
+	edges.num_pids = pid_index_.size();
+	edges.num_edges = edge_srcs_.size();
+	edges.src = edge_srcs_.empty() ? NULL : &edge_srcs_[0];
+	edges.dst = edge_dsts_.empty() ? NULL : &edge_dsts_[0];
+	edges.capacity = edge_capacity_.empty() ? NULL : &edge_capacity_[0];
+	edges.traffic = edge_traffic_.empty() ? NULL : &edge_traffic_[0];
+	edges.external = edge_external_.empty() ? NULL : &edge_external_[0];
+	edges.pdistance = edge_pdistance_.empty() ? NULL : &edge_pdistance_[0];
+
+	get_logger()->info("running shared object plugin on %u edges", edges.num_edges);
+	int rc = impl_->compute(instance_, &edges);
+	if (rc != 0)
+	{
+		get_logger()->error("plugin returned error %d", rc);
+		return rc;
+	}
+
+	store_edges();
+
+	get_logger()->info("finished successfully");
+	return 0;
+} catch (...) {
+	return -1;
+}
+
+void SharedObjectPlugin::
+load_edges(const NetState& state, const ReadableLock& state_lock)
+{
+	unsigned int num_edges = state.get_num_edges(state_lock);
+	pid_index_.clear();
+	edge_srcs_.clear();
+	edge_dsts_.clear();
+	edge_capacity_.clear();
+	edge_traffic_.clear();
+	edge_external_.clear();
+	edge_srcs_.reserve(num_edges);
+	edge_dsts_.reserve(num_edges);
+	edge_capacity_.reserve(num_edges);
+	edge_traffic_.reserve(num_edges);
+	edge_external_.reserve(num_edges);
+
+	BOOST_FOREACH(const NetEdge& e, state.get_edges(state_lock))
+	{
+		NetVertex v_src, v_dst;
+		state.get_edge_vert(e, v_src, v_dst, state_lock);
+
+		edge_srcs_.push_back(pid_index_.add(state, state_lock, v_src));
+		edge_dsts_.push_back(pid_index_.add(state, state_lock, v_dst));
+		edge_capacity_.push_back(state.get_capacity(e, state_lock));
+		edge_traffic_.push_back(state.get_traffic(e, state_lock));
+		edge_external_.push_back(state.get_external(v_src, state_lock) || state.get_external(v_dst, state_lock));
+	}
+
+	/* Seed the output with the previously published pdistances */
+	SparsePIDMatrix* pdistances = get_edge_pdistances();
+	BlockWriteLock pdistances_lock(*pdistances);
+	EdgePIDIndex::ResolvedPIDs pdistance_pids;
+	pid_index_.resolve(*pdistances, pdistances_lock, pdistance_pids);
+	edge_pdistance_.resize(edge_srcs_.size());
+	for (unsigned int i = 0; i < edge_srcs_.size(); ++i)
+		edge_pdistance_[i] = pdistances->get(*pdistance_pids[edge_srcs_[i]], *pdistance_pids[edge_dsts_[i]], pdistances_lock, 0.0);
+}
+
+void SharedObjectPlugin::
+store_edges()
+{
+	SparsePIDMatrix* pdistances = get_edge_pdistances();
+	BlockWriteLock pdistances_lock(*pdistances);
+	EdgePIDIndex::ResolvedPIDs pdistance_pids;
+	pid_index_.resolve(*pdistances, pdistances_lock, pdistance_pids);
+	for (unsigned int i = 0; i < edge_srcs_.size(); ++i)
+		pdistances->set(*pdistance_pids[edge_srcs_[i]], *pdistance_pids[edge_dsts_[i]], edge_pdistance_[i], pdistances_lock);
+}
+
+OptPluginBasePtr SharedObjectDescriptor::create_instance()
+{
+	void* instance = impl_->create ? impl_->create() : NULL;
+	if (impl_->create && !instance)
+		return OptPluginBasePtr();
+
+	return OptPluginBasePtr(new SharedObjectPlugin(this, impl_, instance));
+}
+
+std::string load_opt_plugin(const std::string& path)
+{
+	static boost::mutex load_mutex;
+	boost::mutex::scoped_lock l(load_mutex);
+
+	void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (!handle)
+		throw std::runtime_error("failed to load plugin: " + std::string(dlerror()));
+
+	portal_opt_plugin_entry_fn entry = (portal_opt_plugin_entry_fn)dlsym(handle, PORTAL_OPT_PLUGIN_ENTRY);
+	const portal_opt_plugin* impl = entry ? entry() : NULL;
+
+	std::string error;
+	if (!entry)
+		error = "missing entry point " PORTAL_OPT_PLUGIN_ENTRY;
+	else if (!impl || !impl->name || !impl->compute)
+		error = "invalid plugin description";
+	else if (impl->abi_version != PORTAL_OPT_PLUGIN_ABI_VERSION)
+		error = "unsupported plugin interface version";
+	else
+	{
+		std::vector<std::string> names = OptPluginRegistry::Instance().get_list();
+		if (std::find(names.begin(), names.end(), impl->name) != names.end())
+			error = "a plugin named '" + std::string(impl->name) + "' is already registered";
+	}
+
+	if (!error.empty())
+	{
+		dlclose(handle);
+		throw std::runtime_error(path + ": " + error);
+	}
+
+	/* The descriptor (and the shared object) are never released, since
+	 * views may hold instances at any time */
+	register_opt_plugin(new SharedObjectDescriptor(path, handle, impl));
+	return impl->name;
+}
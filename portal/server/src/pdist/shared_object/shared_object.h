@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef OPT_PLUGIN_SHARED_OBJECT_H
+#define OPT_PLUGIN_SHARED_OBJECT_H
+
+#include <string>
+#include <vector>
+#include <p4p/protocol-portal/opt-plugin.h>
+
+#include "plugin_base.h"
+#include "edge_pid_index.h"
+
+/**
+ * Adapter running an optimization plugin loaded from a shared object.
+ *
+ * The network state is flattened into the per-edge arrays of the plugin
+ * interface, and the pdistances written back by the plugin are published
+ * as the edge pdistances of this instance.
+ */
+class SharedObjectPlugin : public OptPluginBase
+{
+public:
+	SharedObjectPlugin(const OptPluginDescriptor* descriptor, const portal_opt_plugin* impl, void* instance);
+	virtual ~SharedObjectPlugin();
+
+	virtual int compute_pdistances(const NetState& state, const ReadableLock& state_lock,
+				   const PinnedPIDSet& pids);
+
+private:
+	void load_edges(const NetState& state, const ReadableLock& state_lock);
+	void store_edges();
+
+	const portal_opt_plugin* impl_;
+	void* instance_;
+
+	/* Per-edge arrays handed to the plugin */
+	std::vector<unsigned int> edge_srcs_;
+	std::vector<unsigned int> edge_dsts_;
+	std::vector<double> edge_capacity_;
+	std::vector<double> edge_traffic_;
+	std::vector<unsigned char> edge_external_;
+	std::vector<double> edge_pdistance_;
+
+	EdgePIDIndex pid_index_;
+};
+
+class SharedObjectDescriptor : public OptPluginDescriptor
+{
+public:
+	SharedObjectDescriptor(const std::string& path, void* handle, const portal_opt_plugin* impl)
+		: path_(path), handle_(handle), impl_(impl)
+	{}
+
+	virtual std::string get_name() const
+	{ return impl_->name; }
+
+	virtual std::string get_description() const
+	{ return std::string(impl_->description ? impl_->description : "") + " (" + path_ + ")"; }
+
+	virtual OptPluginBasePtr create_instance();
+
+private:
+	std::string path_;
+	void* handle_;
+	const portal_opt_plugin* impl_;
+};
+
+/**
+ * Load an optimization plugin from a shared object and register it. The
+ * shared object stays loaded for the lifetime of the process.
+ * @param path	Path of the shared object.
+ * @return Name of the registered plugin.
+ * @throws std::runtime_error if the shared object cannot be loaded, does
+ * 	not export a compatible entry point, or names a plugin that is
+ * 	already registered.
+ */
+std::string load_opt_plugin(const std::string& path);
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef P4PPORTALOPTPLUGIN_H
+#define P4PPORTALOPTPLUGIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Version of the optimization plugin interface described in this file. A
+ * plugin built against a different version is refused when loaded.
+ */
+#define PORTAL_OPT_PLUGIN_ABI_VERSION	1
+
+/**
+ * Name of the symbol a plugin shared object exports. It must have the
+ * type portal_opt_plugin_entry_fn.
+ */
+#define PORTAL_OPT_PLUGIN_ENTRY		"portal_opt_plugin_entry"
+
+/**
+ * Network state handed to a plugin for one update. Edges are numbered
+ * 0..num_edges-1 and their endpoints refer to PIDs numbered
+ * 0..num_pids-1; the numbering is only stable within one update. All
+ * arrays have num_edges entries.
+ */
+typedef struct portal_opt_edges
+{
+	unsigned int num_pids;		/**< Number of PIDs referenced by edges */
+	unsigned int num_edges;		/**< Number of edges */
+	const unsigned int* src;	/**< Source PID of each edge */
+	const unsigned int* dst;	/**< Destination PID of each edge */
+	const double* capacity;		/**< Capacity of each edge */
+	const double* traffic;		/**< Traffic currently carried by each edge */
+	const unsigned char* external;	/**< Non-zero if either endpoint is an external PID */
+	double* pdistance;		/**< In: pdistance from the previous update (0 if none).
+					     Out: new pdistance for each edge */
+} portal_opt_edges;
+
+/**
+ * Plugin description returned by the entry point. The structure and the
+ * strings it points to must remain valid until the process exits.
+ */
+typedef struct portal_opt_plugin
+{
+	unsigned int abi_version;	/**< Must be PORTAL_OPT_PLUGIN_ABI_VERSION */
+	const char* name;		/**< Name used to select the plugin for a view */
+	const char* description;	/**< Human-readable description */
+
+	/**
+	 * Create a plugin instance. One instance is created for each view
+	 * using the plugin.
+	 * @return Opaque instance handle, or NULL on failure.
+	 */
+	void* (*create)(void);
+
+	/**
+	 * Destroy a plugin instance.
+	 * @param instance	Handle returned by create().
+	 */
+	void (*destroy)(void* instance);
+
+	/**
+	 * Compute new edge pdistances. Calls for one instance are never
+	 * concurrent, but calls for different instances may be.
+	 * @param instance	Handle returned by create().
+	 * @param edges		Current network state; pdistances are written back.
+	 * @return Non-zero to indicate error, or 0 for success.
+	 */
+	int (*compute)(void* instance, portal_opt_edges* edges);
+} portal_opt_plugin;
+
+/**
+ * Type of the exported entry point.
+ */
+typedef const portal_opt_plugin* (*portal_opt_plugin_entry_fn)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
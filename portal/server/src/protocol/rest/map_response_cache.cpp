@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "map_response_cache.h"
+
+#include <algorithm>
+#include <sstream>
+#include <boost/foreach.hpp>
+#include <p4p/detail/util.h>
+#include <p4pserver/locking.h>
+#include "global_state.h"
+#include "map_snapshot.h"
+#include "rest_request_handlers.h"
+#include "view_registry.h"
+
+/* Locks needed for the legacy pDistance matrix (as for GetCostsViewState) */
+typedef ViewWrapper<
+		const ReadableLock, const BlockReadLock,
+		const EmptyLock, const NoLock,
+		const ReadableLock, const BlockReadLock,
+		const EmptyLock, const NoLock,
+		const EmptyLock, const NoLock,
+		const ReadableLock, const BlockReadLock,
+		const ReadableLock, const BlockReadLock
+	> MapResponsesViewState;
+
+static std::string get_cost_map_key(const std::string& cost_mode, const std::string& cost_type)
+{
+	return cost_mode + "/" + cost_type;
+}
+
+EncodedBodyConstPtr MapResponses::get_cost_map(const std::string& cost_mode, const std::string& cost_type) const
+{
+	std::map<std::string, EncodedBodyConstPtr>::const_iterator itr = cost_maps.find(get_cost_map_key(cost_mode, cost_type));
+	return itr != cost_maps.end() ? itr->second : EncodedBodyConstPtr();
+}
+
+MapResponseCache::MapResponseCache()
+	: generation_all_(0)
+{
+}
+
+MapResponsesConstPtr MapResponseCache::get(const std::string& name) const
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	ResponsesMap::const_iterator itr = views_.find(name);
+	return itr != views_.end() ? itr->second : MapResponsesConstPtr();
+}
+
+unsigned long long MapResponseCache::get_generation(const std::string& name) const
+{
+	GenerationMap::const_iterator itr = generations_.find(name);
+	return generation_all_ + (itr != generations_.end() ? itr->second : 0);
+}
+
+void MapResponseCache::invalidate(const std::string& name)
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	++generations_[name];
+	views_.erase(name);
+}
+
+void MapResponseCache::invalidate_all()
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	++generation_all_;
+	views_.clear();
+}
+
+MapResponsesConstPtr MapResponseCache::build(ViewPtr view)
+{
+	boost::shared_ptr<MapResponses> responses(new MapResponses());
+
+	/* Same bodies as the ALTO map handlers produce */
+	MapSnapshotPtr snapshot = MapSnapshot::build(view);
+	responses->network_map = EncodedBodyConstPtr(new EncodedBody(snapshot->get_network_map()));
+	BOOST_FOREACH(const std::string& cost_mode, RESTHandler::CostModeSet)
+	{
+		BOOST_FOREACH(const std::string& cost_type, RESTHandler::CostTypeSet)
+		{
+			responses->cost_maps[get_cost_map_key(cost_mode, cost_type)]
+				= EncodedBodyConstPtr(new EncodedBody(snapshot->get_cost_map(cost_mode, cost_type)));
+		}
+	}
+
+	/* Same body as GetCostsWrite produces for the full matrix */
+	MapResponsesViewState view_state(view);
+	const ReadableLock& view_lock = view_state.get_view_lock();
+	PIDMapPtr pidmap = view->get_prefixes(view_lock);
+	p4p::PIDSet pids;
+	pidmap->enumerate_pids(std::inserter(pids, pids.end()), view_state.get_prefixes_lock());
+
+	std::ostringstream os;
+	BOOST_FOREACH(const p4p::PID& src, pids)
+	{
+		os << src << '\t' << "no-reverse" << '\t' << pids.size();
+		BOOST_FOREACH(const p4p::PID& dst, pids)
+			os << '\t' << dst << '\t' << p4p::detail::clip(round_int(view_state.get_pdistance(src, dst)), View::MIN_PDISTANCE, View::MAX_PDISTANCE);
+		os << "\r\n";
+	}
+	responses->pdistances = EncodedBodyConstPtr(new EncodedBody(os.str()));
+	responses->pdistance_ttl = view->get_pdistance_ttl(view_lock);
+	responses->pidmap_version = pidmap->get_version(view_state.get_prefixes_lock());
+
+	return responses;
+}
+
+void MapResponseCache::refresh(const std::string& name)
+{
+	unsigned long long generation;
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		generation = get_generation(name);
+	}
+
+	ViewPtr view = GlobalView<BlockReadLock>(name)();
+	MapResponsesConstPtr responses = view ? build(view) : MapResponsesConstPtr();
+
+	boost::mutex::scoped_lock lock(mutex_);
+	if (get_generation(name) != generation)
+		return;
+	if (responses)
+		views_[name] = responses;
+	else
+		views_.erase(name);
+}
+
+void MapResponseCache::refresh_all()
+{
+	std::vector<std::string> names;
+	{
+		GlobalStatePtr global_state = GLOBAL_STATE;
+		BlockReadLock global_state_lock(*global_state);
+		ViewRegistryPtr views = global_state->get_views(global_state_lock);
+		BlockReadLock views_lock(*views);
+		views->get_names(names, views_lock);
+	}
+
+	/* Drop responses of views which no longer exist */
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		for (ResponsesMap::iterator itr = views_.begin(); itr != views_.end(); )
+		{
+			if (std::find(names.begin(), names.end(), itr->first) == names.end())
+				views_.erase(itr++);
+			else
+				++itr;
+		}
+	}
+
+	BOOST_FOREACH(const std::string& name, names)
+		refresh(name);
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef MAP_RESPONSE_CACHE_H
+#define MAP_RESPONSE_CACHE_H
+
+#include <map>
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <p4pserver/encoded_body.h>
+#include "view.h"
+
+/**
+ * Full-map responses of one version of a view, with their compressed
+ * encodings.
+ */
+struct MapResponses
+{
+	MapResponses() : pdistance_ttl(0), pidmap_version(0) {}
+
+	/** Cost map of a cost mode and type, or NULL */
+	EncodedBodyConstPtr get_cost_map(const std::string& cost_mode, const std::string& cost_type) const;
+
+	EncodedBodyConstPtr network_map;
+
+	/* Keyed by "<cost mode>/<cost type>" */
+	std::map<std::string, EncodedBodyConstPtr> cost_maps;
+
+	/* Legacy pDistance matrix between all PIDs, and its response headers */
+	EncodedBodyConstPtr pdistances;
+	unsigned int pdistance_ttl;
+	unsigned int pidmap_version;
+};
+typedef boost::shared_ptr<const MapResponses> MapResponsesConstPtr;
+
+class MapResponseCache;
+typedef boost::shared_ptr<MapResponseCache> MapResponseCachePtr;
+
+/**
+ * Responses for full network maps, cost maps and pDistance matrices,
+ * built and compressed once per version of each view rather than on
+ * every request.
+ *
+ * A view's responses are dropped as soon as the view changes, and
+ * requests are answered from the view itself until the responses have
+ * been rebuilt, so a stale response is never served. Building happens
+ * in a job.
+ */
+class MapResponseCache
+{
+public:
+	MapResponseCache();
+
+	/** Responses of a view's current version, or NULL if not built yet */
+	MapResponsesConstPtr get(const std::string& name) const;
+
+	/** Drop the responses of a view which has changed, before its write lock is released */
+	void invalidate(const std::string& name);
+
+	/** Drop the responses of all views */
+	void invalidate_all();
+
+	/**
+	 * Build the responses of a view from the global state. They are
+	 * discarded if the view changes while they are being built.
+	 */
+	void refresh(const std::string& name);
+
+	/** Build the responses of all views */
+	void refresh_all();
+
+private:
+	static MapResponsesConstPtr build(ViewPtr view);
+
+	/* Incremented on each change to a view (or to all views), so that
+	 * responses of an older version are not stored */
+	unsigned long long get_generation(const std::string& name) const;
+
+	typedef std::map<std::string, MapResponsesConstPtr> ResponsesMap;
+	typedef std::map<std::string, unsigned long long> GenerationMap;
+
+	mutable boost::mutex mutex_;
+	ResponsesMap views_;
+	GenerationMap generations_;
+	unsigned long long generation_all_;
+};
+
+#endif
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "map_snapshot.h"
+
+#include <algorithm>
+#include <sstream>
+#include <boost/foreach.hpp>
+#include <p4pserver/locking.h>
+#include <json_infores.h>
+#include "rest_request_handlers.h"
+
+typedef ViewWrapper<
+		const ReadableLock, const BlockReadLock,
+		const ReadableLock, const BlockReadLock,
+		const ReadableLock, const BlockReadLock,
+		const ReadableLock, const BlockReadLock,
+		const ReadableLock, const BlockReadLock
+	> MapSnapshotViewState;
+
+/* Costs are sent with a precision of 0.1 (see InfoResBase::addNumber), so
+ * smaller changes are not sent */
+static int round_cost(double cost)
+{
+	return (int)(cost * 10.0 + 0.5);
+}
+
+static std::string to_json(const Object& obj)
+{
+	std::ostringstream os;
+	Writer::Write(obj, os);
+	return os.str();
+}
+
+/* Patch document replacing "map" and "map-vtag" in a map's data */
+static std::string make_patch(const Object& map, const std::string& vtag)
+{
+	Object data;
+	data["map-vtag"] = String(vtag);
+	data["map"] = map;
+
+	Object patch;
+	patch["data"] = data;
+	return to_json(patch);
+}
+
+MapSnapshotPtr MapSnapshot::build(ViewPtr view)
+{
+	MapSnapshotViewState view_state(view);
+	const ReadableLock& view_lock = view_state.get_view_lock();
+
+	PIDMapPtr pidmap = view->get_prefixes(view_lock);
+	PIDAggregationPtr agg = view->get_aggregation(view_lock);
+	SparsePIDMatrixPtr link_pdistances = view->get_link_pdistances(view_lock);
+	PIDRoutingPtr routing = view->get_intradomain_routing(view_lock);
+
+	MapSnapshotPtr snapshot(new MapSnapshot(RESTHandler::GetVerTag()));
+
+	/* Same contents as the REST network map */
+	PIDPrefixTableConstPtr table = pidmap->get_table(view_state.get_prefixes_lock());
+	BOOST_FOREACH(const PIDPrefixTable::Entry& pid, table->get_entries())
+	{
+		std::string name;
+		agg->reverse_lookup(pid.first, name, view_state.get_aggregation_lock());
+		BOOST_FOREACH(const p4p::IPPrefix& prefix, pid.second)
+		{
+			std::ostringstream ip;
+			ip << prefix;
+			snapshot->add_prefix(name, ip.str());
+		}
+		if (name == "defaultpid")
+			snapshot->add_prefix(name, "::/0");
+	}
+
+	/* Same values as the REST cost map */
+	p4p::PIDSet pids;
+	pidmap->enumerate_pids(std::inserter(pids, pids.end()), view_state.get_prefixes_lock());
+	std::vector<std::string> names;
+	BOOST_FOREACH(const p4p::PID& pid, pids)
+	{
+		names.push_back(std::string());
+		agg->reverse_lookup(pid, names.back(), view_state.get_aggregation_lock());
+	}
+
+	unsigned int src_idx = 0;
+	for (p4p::PIDSet::const_iterator src = pids.begin(); src != pids.end(); ++src, ++src_idx)
+	{
+		unsigned int dst_idx = 0;
+		for (p4p::PIDSet::const_iterator dst = pids.begin(); dst != pids.end(); ++dst, ++dst_idx)
+		{
+			double cost = link_pdistances->get_by_pid(*src, *dst, view_state.get_link_pdistances_lock(), -1.0);
+			if (cost < 0.0)
+				continue;
+			snapshot->add_cost(names[src_idx], names[dst_idx], cost,
+					   routing->get_weight(*src, *dst, view_state.get_intradomain_routing_lock()));
+		}
+	}
+
+	return snapshot;
+}
+
+MapSnapshot::MapSnapshot(const std::string& vtag)
+	: vtag_(vtag)
+{
+}
+
+void MapSnapshot::add_prefix(const std::string& pid, const std::string& prefix)
+{
+	if (prefix.find(':') != std::string::npos)
+		prefixes_v6_[pid].push_back(prefix);
+	else
+		prefixes_v4_[pid].push_back(prefix);
+}
+
+void MapSnapshot::add_cost(const std::string& src, const std::string& dst, double ordinal, double numerical)
+{
+	ordinal_[src][dst] = ordinal;
+	numerical_[src][dst] = numerical;
+}
+
+const MapSnapshot::CostMatrix& MapSnapshot::get_costs(const std::string& cost_mode) const
+{
+	return cost_mode == "numerical" ? numerical_ : ordinal_;
+}
+
+std::string MapSnapshot::get_network_map() const
+{
+	InfoResourceNetworkMap netmap;
+	netmap.setVerTag(vtag_);
+	BOOST_FOREACH(const PrefixMap::value_type& pid, prefixes_v4_)
+	{
+		BOOST_FOREACH(const std::string& prefix, pid.second)
+			netmap.addIP(pid.first, prefix);
+	}
+	BOOST_FOREACH(const PrefixMap::value_type& pid, prefixes_v6_)
+	{
+		BOOST_FOREACH(const std::string& prefix, pid.second)
+			netmap.addIP(pid.first, prefix);
+	}
+	netmap.commit();
+
+	/* InfoResourceEntity::MakeJsonStr() is not safe to call from here */
+	InfoResourceEntity ire;
+	InfoResourceMetaData meta;
+	ire.setMeta(meta);
+	ire.setData(netmap);
+	return ire.toJson();
+}
+
+std::string MapSnapshot::get_cost_map(const std::string& cost_mode, const std::string& cost_type) const
+{
+	InfoResourceCostMap costmap;
+	costmap.addCostMode(cost_mode);
+	costmap.addCostType(cost_type);
+	costmap.addVertionTag(vtag_);
+
+	const CostMatrix& costs = get_costs(cost_mode);
+	for (CostMatrix::const_iterator src = costs.begin(); src != costs.end(); ++src)
+	{
+		for (std::map<std::string, double>::const_iterator dst = src->second.begin(); dst != src->second.end(); ++dst)
+			costmap.addCost(src->first, dst->first, dst->second);
+	}
+	costmap.commit();
+
+	InfoResourceEntity ire;
+	InfoResourceMetaData meta;
+	ire.setMeta(meta);
+	ire.setData(costmap);
+	return ire.toJson();
+}
+
+std::string MapSnapshot::get_network_map_patch(const MapSnapshot& prev) const
+{
+	static const PrefixMap::mapped_type NO_PREFIXES;
+
+	/* PIDs in either map; a PID is only in the network map if it has prefixes */
+	const PrefixMap* maps[] = { &prefixes_v4_, &prefixes_v6_, &prev.prefixes_v4_, &prev.prefixes_v6_ };
+	std::vector<std::string> pids;
+	for (unsigned int i = 0; i < sizeof(maps) / sizeof(maps[0]); ++i)
+	{
+		BOOST_FOREACH(const PrefixMap::value_type& pid, *maps[i])
+			pids.push_back(pid.first);
+	}
+	std::sort(pids.begin(), pids.end());
+	pids.erase(std::unique(pids.begin(), pids.end()), pids.end());
+
+	Object map;
+	BOOST_FOREACH(const std::string& pid, pids)
+	{
+		PrefixMap::const_iterator v4 = prefixes_v4_.find(pid);
+		PrefixMap::const_iterator v6 = prefixes_v6_.find(pid);
+		PrefixMap::const_iterator prev_v4 = prev.prefixes_v4_.find(pid);
+		PrefixMap::const_iterator prev_v6 = prev.prefixes_v6_.find(pid);
+		const PrefixMap::mapped_type& cur4 = v4 != prefixes_v4_.end() ? v4->second : NO_PREFIXES;
+		const PrefixMap::mapped_type& cur6 = v6 != prefixes_v6_.end() ? v6->second : NO_PREFIXES;
+		const PrefixMap::mapped_type& old4 = prev_v4 != prev.prefixes_v4_.end() ? prev_v4->second : NO_PREFIXES;
+		const PrefixMap::mapped_type& old6 = prev_v6 != prev.prefixes_v6_.end() ? prev_v6->second : NO_PREFIXES;
+
+		if (cur4 == old4 && cur6 == old6)
+			continue;
+		if (cur4.empty() && cur6.empty())
+		{
+			map[pid] = Null();
+			continue;
+		}
+
+		/* Address lists are replaced whole; a list which is gone is removed */
+		Object group;
+		if (cur4 != old4)
+		{
+			if (cur4.empty())
+				group["ipv4"] = Null();
+			else
+			{
+				std::vector<std::string> addrs(cur4);
+				InfoResArray array(addrs);
+				group["ipv4"] = (Array&)array;
+			}
+		}
+		if (cur6 != old6)
+		{
+			if (cur6.empty())
+				group["ipv6"] = Null();
+			else
+			{
+				std::vector<std::string> addrs(cur6);
+				InfoResArray array(addrs);
+				group["ipv6"] = (Array&)array;
+			}
+		}
+		map[pid] = group;
+	}
+
+	if (map.Empty())
+		return std::string();
+	return make_patch(map, vtag_);
+}
+
+std::string MapSnapshot::get_cost_map_patch(const MapSnapshot& prev, const std::string& cost_mode) const
+{
+	const CostMatrix& costs = get_costs(cost_mode);
+	const CostMatrix& prev_costs = prev.get_costs(cost_mode);
+
+	Object map;
+
+	/* Sources which are gone */
+	for (CostMatrix::const_iterator src = prev_costs.begin(); src != prev_costs.end(); ++src)
+	{
+		if (costs.find(src->first) == costs.end())
+			map[src->first] = Null();
+	}
+
+	for (CostMatrix::const_iterator src = costs.begin(); src != costs.end(); ++src)
+	{
+		static const CostMatrix::mapped_type NO_COSTS;
+		CostMatrix::const_iterator prev_src = prev_costs.find(src->first);
+		const CostMatrix::mapped_type& prev_dsts = prev_src != prev_costs.end() ? prev_src->second : NO_COSTS;
+
+		Object dsts;
+		for (CostMatrix::mapped_type::const_iterator dst = prev_dsts.begin(); dst != prev_dsts.end(); ++dst)
+		{
+			if (src->second.find(dst->first) == src->second.end())
+				dsts[dst->first] = Null();
+		}
+		for (CostMatrix::mapped_type::const_iterator dst = src->second.begin(); dst != src->second.end(); ++dst)
+		{
+			CostMatrix::mapped_type::const_iterator prev_dst = prev_dsts.find(dst->first);
+			if (prev_dst != prev_dsts.end() && round_cost(prev_dst->second) == round_cost(dst->second))
+				continue;
+			dsts[dst->first] = Number(round_cost(dst->second) / 10.0);
+		}
+
+		if (!dsts.Empty())
+			map[src->first] = dsts;
+	}
+
+	if (map.Empty())
+		return std::string();
+	return make_patch(map, vtag_);
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#ifndef MAP_SNAPSHOT_H
+#define MAP_SNAPSHOT_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "view.h"
+
+class MapSnapshot;
+typedef boost::shared_ptr<MapSnapshot> MapSnapshotPtr;
+typedef boost::shared_ptr<const MapSnapshot> MapSnapshotConstPtr;
+
+/**
+ * Copy of a view's network map and cost maps, by PID name, from which
+ * the full maps and the changes between two copies are formatted.
+ * Used wherever the maps are served from something other than the view
+ * itself (update streams, precomputed responses).
+ */
+class MapSnapshot
+{
+public:
+	typedef std::map<std::string, std::vector<std::string> > PrefixMap;
+	typedef std::map<std::string, std::map<std::string, double> > CostMatrix;
+
+	/**
+	 * Build a snapshot of a view. Waits for the view's locks, so this
+	 * must not be called from a request handler.
+	 */
+	static MapSnapshotPtr build(ViewPtr view);
+
+	MapSnapshot(const std::string& vtag);
+
+	void add_prefix(const std::string& pid, const std::string& prefix);
+	void add_cost(const std::string& src, const std::string& dst, double ordinal, double numerical);
+
+	/** Network map document, as returned by GET /networkmap */
+	std::string get_network_map() const;
+
+	/** Cost map document, as returned by GET /costmap/<mode>/<type> */
+	std::string get_cost_map(const std::string& cost_mode, const std::string& cost_type) const;
+
+	/**
+	 * JSON merge patch (RFC 7396) turning the network map document of
+	 * 'prev' into this one's, or an empty string if the maps are equal.
+	 */
+	std::string get_network_map_patch(const MapSnapshot& prev) const;
+
+	/** Same for the cost map document in a cost mode */
+	std::string get_cost_map_patch(const MapSnapshot& prev, const std::string& cost_mode) const;
+
+private:
+	const CostMatrix& get_costs(const std::string& cost_mode) const;
+
+	std::string vtag_;
+	PrefixMap prefixes_v4_;
+	PrefixMap prefixes_v6_;
+	CostMatrix ordinal_;
+	CostMatrix numerical_;
+};
+
+#endif
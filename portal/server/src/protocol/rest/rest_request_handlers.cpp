@@ -33,6 +33,8 @@
 #include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
 #include <p4p/ip_addr.h>
+#include <p4pserver/logging.h>
+#include "state.h"
 
 #include <vector>
 #include <iostream>
@@ -42,6 +44,16 @@
 const char* RESTHandler::HDR_CACHE_CONTROL = "Cache-Control";
 const char* RESTHandler::HDR_PIDMAP_SEQNO = "X-P4P-PIDMap";
 
+const unsigned int RESTHandler::METRICS_ADMIN = RESTMetrics::register_handler("admin");
+const unsigned int RESTHandler::METRICS_DIRECTORY = RESTMetrics::register_handler("directory");
+const unsigned int RESTHandler::METRICS_NETWORKMAP = RESTMetrics::register_handler("networkmap");
+const unsigned int RESTHandler::METRICS_COSTMAP = RESTMetrics::register_handler("costmap");
+const unsigned int RESTHandler::METRICS_ENDPOINTS = RESTMetrics::register_handler("endpoints");
+const unsigned int RESTHandler::METRICS_PID = RESTMetrics::register_handler("pid");
+const unsigned int RESTHandler::METRICS_PDISTANCE = RESTMetrics::register_handler("pdistance");
+const unsigned int RESTHandler::METRICS_METRICS = RESTMetrics::register_handler("metrics");
+const unsigned int RESTHandler::METRICS_UPDATES = RESTMetrics::register_handler("updates");
+
 InfoResourceDirectory RESTHandler::INFO_RES_DIRECTORY = InfoResourceDirectory();
 std::string RESTHandler::VerTag = std::string("1266506139");
 std::set<std::string> RESTHandler::CostModeSet = std::set<std::string>();
@@ -151,6 +163,26 @@ invalid_argument:
 	return MHD_YES;
 }
 
+// Path: /admin/<token>/net/plugin/
+int RESTHandler::parse_request_header_admin_net_plugin(PortalRESTServer* server, RESTRequestState* state)
+{
+	if (state->get_argc() != 4)
+		goto invalid_argument;
+
+	if (state->get_method() == PortalRESTServer::HTTP_METHOD_GET)
+		state->set_callbacks((RESTRequestFinish)AdminNetGetPluginsFinish);
+	else if (state->get_method() == PortalRESTServer::HTTP_METHOD_PUT)
+		state->set_callbacks((RESTRequestFinish)AdminNetLoadPluginFinish);
+	else
+		goto invalid_argument;
+
+	return MHD_YES;
+
+invalid_argument:
+	state->set_empty_response(MHD_HTTP_METHOD_NOT_ACCEPTABLE);
+	return MHD_YES;
+}
+
 // Path: /admin/<token>/net/link/
 int RESTHandler::parse_request_header_admin_net_link(PortalRESTServer* server, RESTRequestState* state)
 {
@@ -183,6 +215,22 @@ invalid_argument:
 	return MHD_YES;
 }
 
+// Path: /admin/<token>/net/traffic
+int RESTHandler::parse_request_header_admin_net_traffic(PortalRESTServer* server, RESTRequestState* state)
+{
+	if (state->get_argc() != 4
+		|| (state->get_method() != PortalRESTServer::HTTP_METHOD_PUT
+			&& state->get_method() != PortalRESTServer::HTTP_METHOD_POST))
+	{
+		state->set_empty_response(MHD_HTTP_METHOD_NOT_ACCEPTABLE);
+		return MHD_YES;
+	}
+
+	state->set_callbacks((RESTRequestFinish)AdminNetLoadTrafficFinish, (RESTRequestFree)AdminNetLoadTrafficFree,
+		new NetTrafficRequestState(), (RESTRequestProcess)AdminNetLoadTrafficProcess);
+	return MHD_YES;
+}
+
 // Path: /admin/<token>/net/
 int RESTHandler::parse_request_header_admin_net(PortalRESTServer* server, RESTRequestState* state)
 {
@@ -197,6 +245,10 @@ int RESTHandler::parse_request_header_admin_net(PortalRESTServer* server, RESTRe
 		parse_request_header_admin_net_link(server, state);
 	else if (strcmp(arg, "node") == 0)
 		parse_request_header_admin_net_node(server, state);
+	else if (strcmp(arg, "plugin") == 0)
+		parse_request_header_admin_net_plugin(server, state);
+	else if (strcmp(arg, "traffic") == 0)
+		parse_request_header_admin_net_traffic(server, state);
 	else
 		goto invalid_argument;
 
@@ -429,6 +481,28 @@ invalid_argument:
 	return MHD_YES;
 }
 
+// Path: /admin/<token>/<view>/route/
+int RESTHandler::parse_request_header_admin_view_route(PortalRESTServer* server, RESTRequestState* state)
+{
+	if (state->get_argc() == 4)
+	{
+		if (state->get_method() == PortalRESTServer::HTTP_METHOD_PUT)
+			state->set_callbacks((RESTRequestFinish)AdminViewAddRouteFinish);
+		else if (state->get_method() == PortalRESTServer::HTTP_METHOD_DELETE)
+			state->set_callbacks((RESTRequestFinish)AdminViewDeleteRouteFinish);
+		else
+			goto invalid_argument;
+	}
+	else
+		goto invalid_argument;
+
+	return MHD_YES;
+
+invalid_argument:
+	state->set_empty_response(MHD_HTTP_METHOD_NOT_ACCEPTABLE);
+	return MHD_YES;
+}
+
 // Path: /admin/<token>/<view>/prop/
 int RESTHandler::parse_request_header_admin_view_prop(PortalRESTServer* server, RESTRequestState* state)
 {
@@ -471,6 +545,26 @@ invalid_argument:
 	return MHD_YES;
 }
 
+// Path: /admin/<token>/<view>/trace/
+int RESTHandler::parse_request_header_admin_view_trace(PortalRESTServer* server, RESTRequestState* state)
+{
+	if (state->get_argc() == 4)
+	{
+		if (state->get_method() == PortalRESTServer::HTTP_METHOD_GET)
+			state->set_callbacks((RESTRequestFinish)AdminViewGetTraceFinish);
+		else
+			goto invalid_argument;
+	}
+	else
+		goto invalid_argument;
+
+	return MHD_YES;
+
+invalid_argument:
+		state->set_empty_response(MHD_HTTP_METHOD_NOT_ACCEPTABLE);
+	return MHD_YES;
+}
+
 // Path: /admin/<token>/<view>/
 int RESTHandler::parse_request_header_admin_view(PortalRESTServer* server, RESTRequestState* state)
 {
@@ -494,10 +588,14 @@ int RESTHandler::parse_request_header_admin_view(PortalRESTServer* server, RESTR
 			parse_request_header_admin_view_pid(server, state);
 		else if (strcmp(arg, "link") == 0)
 			parse_request_header_admin_view_link(server, state);
+		else if (strcmp(arg, "route") == 0)
+			parse_request_header_admin_view_route(server, state);
 		else if (strcmp(arg, "prop") == 0)
 			parse_request_header_admin_view_prop(server, state);
 		else if (strcmp(arg, "pdistance") == 0)
 			parse_request_header_admin_view_pdistance(server, state);
+		else if (strcmp(arg, "trace") == 0)
+			parse_request_header_admin_view_trace(server, state);
 		else
 			goto invalid_argument;
 	}
@@ -710,3 +808,56 @@ invalid_argument:
 	return MHD_YES;
 }
 
+// Path: /updates/<cost mode>/<cost type>
+int RESTHandler::parse_request_header_updates(PortalRESTServer* server, RESTRequestState* state)
+{
+	if (state->get_method() != PortalRESTServer::HTTP_METHOD_GET || state->get_argc() != 3)
+		goto invalid_argument;
+
+	state->set_callbacks((RESTRequestFinish)GetUpdatesFinish);
+	return MHD_YES;
+
+invalid_argument:
+	ReplyError(state, E_SYNTAX);
+	return MHD_YES;
+}
+
+// Path: /metrics
+int RESTHandler::parse_request_header_metrics(PortalRESTServer* server, RESTRequestState* state)
+{
+	if (state->get_argc() != 1)
+		goto invalid_argument;
+
+	if (state->get_method() != PortalRESTServer::HTTP_METHOD_GET)
+		goto invalid_argument;
+
+	state->set_callbacks((RESTRequestFinish)GetMetricsFinish);
+	return MHD_YES;
+
+invalid_argument:
+	state->set_empty_response(MHD_HTTP_METHOD_NOT_ACCEPTABLE);
+	return MHD_YES;
+}
+
+void RESTHandler::GetMetricsFinish(PortalRESTServer* server, RESTRequestState* state, void* data)
+{
+	std::ostringstream os;
+	server->write_metrics(os);
+	os << "# HELP p4p_log_dropped_total Log messages dropped because the asynchronous log buffer was full.\n"
+	   << "# TYPE p4p_log_dropped_total counter\n"
+	   << "p4p_log_dropped_total " << get_logger_dropped() << "\n";
+	if (UPDATE_STREAMS)
+	{
+		EventStreamHubPtr hub = UPDATE_STREAMS->get_hub();
+		os << "# HELP p4p_update_stream_subscribers Clients subscribed to map update streams.\n"
+		   << "# TYPE p4p_update_stream_subscribers gauge\n"
+		   << "p4p_update_stream_subscribers " << hub->get_subscribers() << "\n"
+		   << "# HELP p4p_update_stream_published_total Map updates published to update streams.\n"
+		   << "# TYPE p4p_update_stream_published_total counter\n"
+		   << "p4p_update_stream_published_total " << hub->get_published() << "\n"
+		   << "# HELP p4p_update_stream_resyncs_total Update stream subscribers resent the full maps because they fell behind.\n"
+		   << "# TYPE p4p_update_stream_resyncs_total counter\n"
+		   << "p4p_update_stream_resyncs_total " << hub->get_resyncs() << "\n";
+	}
+	state->set_text_response(MHD_HTTP_OK, os.str(), "text/plain; version=0.0.4");
+}
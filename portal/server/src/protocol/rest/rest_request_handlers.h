@@ -65,6 +65,17 @@ public:
 	static const char* HDR_CACHE_CONTROL;
 	static const char* HDR_PIDMAP_SEQNO;
 
+	// Handler names reported in request metrics
+	static const unsigned int METRICS_ADMIN;
+	static const unsigned int METRICS_DIRECTORY;
+	static const unsigned int METRICS_NETWORKMAP;
+	static const unsigned int METRICS_COSTMAP;
+	static const unsigned int METRICS_ENDPOINTS;
+	static const unsigned int METRICS_PID;
+	static const unsigned int METRICS_PDISTANCE;
+	static const unsigned int METRICS_METRICS;
+	static const unsigned int METRICS_UPDATES;
+
 	typedef ProtocolServerREST<PORTAL_MSG_MAX, RESTHandler> PortalRESTServer;
 
 	int operator()(PortalRESTServer* server, RESTRequestState* state) const
@@ -74,6 +85,7 @@ public:
 		/* Check for admin requests */
 		if (state->get_argc() >= 1 && strcmp(state->get_argv(0), "admin") == 0)
 		{
+			state->set_metrics_handler(METRICS_ADMIN);
 			if (!parse_request_header_admin(server, state))
 				goto invalid_argument;
 			return MHD_YES;
@@ -87,18 +99,48 @@ public:
 
 		/* Harry: The new version (-13) ALTO protocol */
 		if (strcmp(arg, "directory") == 0)
+		{
+			state->set_metrics_handler(METRICS_DIRECTORY);
 			parse_request_header_directory(server, state);
+		}
 		else if (strcmp(arg, "networkmap") == 0)
+		{
+			state->set_metrics_handler(METRICS_NETWORKMAP);
 			parse_request_header_networkmap(server, state);
+		}
 		else if (strcmp(arg, "costmap") == 0)
+		{
+			state->set_metrics_handler(METRICS_COSTMAP);
 			parse_request_header_costmap(server, state);
+		}
 		else if (strcmp(arg, "endpoints") == 0)
+		{
+			state->set_metrics_handler(METRICS_ENDPOINTS);
 			parse_request_header_endpoints(server, state);
+		}
 		/* Legacy View Queries */
 		else if (strcmp(arg, "pid") == 0)
+		{
+			state->set_metrics_handler(METRICS_PID);
 			parse_request_header_client(server, state);
+		}
 		else if (strcmp(arg, "pdistance") == 0)
+		{
+			state->set_metrics_handler(METRICS_PDISTANCE);
 			parse_request_header_pdistance(server, state);
+		}
+		/* Map update streams */
+		else if (strcmp(arg, "updates") == 0)
+		{
+			state->set_metrics_handler(METRICS_UPDATES);
+			parse_request_header_updates(server, state);
+		}
+		/* Request metrics */
+		else if (strcmp(arg, "metrics") == 0)
+		{
+			state->set_metrics_handler(METRICS_METRICS);
+			parse_request_header_metrics(server, state);
+		}
 		else
 			goto invalid_argument;
 
@@ -112,6 +154,8 @@ public:
 private:
 	static int parse_request_header_admin_net_node(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_admin_net_link(PortalRESTServer* server, RESTRequestState* state);
+	static int parse_request_header_admin_net_traffic(PortalRESTServer* server, RESTRequestState* state);
+	static int parse_request_header_admin_net_plugin(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_admin_net(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_admin_view_pid_modify_prefixes(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_admin_view_pid_modify_nodes(PortalRESTServer* server, RESTRequestState* state);
@@ -121,17 +165,21 @@ private:
 	static int parse_request_header_admin_view_link_modify_weight(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_admin_view_link_modify(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_admin_view_link(PortalRESTServer* server, RESTRequestState* state);
+	static int parse_request_header_admin_view_route(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_admin_view_prop(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_admin_view_pdistance(PortalRESTServer* server, RESTRequestState* state);
+	static int parse_request_header_admin_view_trace(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_admin_view(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_admin(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_client(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_pdistance(PortalRESTServer* server, RESTRequestState* state);
+	static int parse_request_header_metrics(PortalRESTServer* server, RESTRequestState* state);
 	/* Harry Updates for ALTO Protocol v13 */
 	static int parse_request_header_directory(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_networkmap(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_costmap(PortalRESTServer* server, RESTRequestState* state);
 	static int parse_request_header_endpoints(PortalRESTServer* server, RESTRequestState* state);
+	static int parse_request_header_updates(PortalRESTServer* server, RESTRequestState* state);
 
 	struct NetReaderResponseState
 	{
@@ -173,6 +221,14 @@ private:
 	};
 	static void ViewNodesReaderFree(ViewNodesReaderResponseState* data);
 
+	struct NetTrafficRequestState
+	{
+		NetTrafficRequestState() : traffic(new TrafficIngest()) {}
+		TrafficIngestPtr traffic;
+	};
+	static bool AdminNetLoadTrafficProcess(PortalRESTServer* server, RESTRequestState* state, NetTrafficRequestState* data, RequestStream& req);
+	static void AdminNetLoadTrafficFree(NetTrafficRequestState* data);
+
 	static int AdminNetGetNodesWrite(NetReaderResponseState* cls, uint64_t pos, char *buf, int max);
 	static int AdminNetGetLinksWrite(NetReaderResponseState* data, uint64_t pos, char *buf, int max);
 	static int AdminViewGetPIDPrefixesWrite(ViewPrefixesReaderResponseState* data, uint64_t pos, char *buf, int max);
@@ -186,6 +242,9 @@ private:
 	static void AdminNetGetLinksFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 	static void AdminNetAddLinkFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 	static void AdminNetDeleteLinkFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
+	static void AdminNetGetPluginsFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
+	static void AdminNetLoadPluginFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
+	static void AdminNetLoadTrafficFinish(PortalRESTServer* server, RESTRequestState* state, NetTrafficRequestState* data);
 	static void AdminViewGetPIDPrefixesFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 	static void AdminViewAddPIDPrefixesFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 	static void AdminViewDeletePIDPrefixesFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
@@ -204,11 +263,14 @@ private:
 	static void AdminViewSetLinkWeightFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 	static void AdminViewGetLinkCostFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 	static void AdminViewSetLinkCostFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
+	static void AdminViewAddRouteFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
+	static void AdminViewDeleteRouteFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 	static void AdminViewGetPropFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 	static void AdminViewSetPropFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 	static void AdminViewAddFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 	static void AdminViewDeleteFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 	static void AdminViewPDistanceUpdateFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
+	static void AdminViewGetTraceFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 	static void AdminGetTokenFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 	static void AdminCommitFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 	static void AdminCancelFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
@@ -246,6 +308,7 @@ private:
 		std::string	net_map;
 		int		len;
 		int		pos;
+		EncodedBodyConstPtr	body;	/* Precomputed response, if any */
 	};
 
 	static int GetNetMapWrite(GetNetMapState* data, uint64_t pos, char *buf, int max);
@@ -409,6 +472,7 @@ private:
 	{
 		GetPIDMapState() : i(0), j(0), pid_state(0) {}
 		std::vector<std::pair<p4p::PID, std::vector<p4p::IPPrefix> > > pids;
+		PIDPrefixTableConstPtr table;	/* All PIDs, if none were requested */
 		unsigned int i;
 		unsigned int j;
 		unsigned int pid_state;
@@ -451,6 +515,10 @@ private:
 	static bool GetCostsProcess(PortalRESTServer* server, RESTRequestState* state, GetCostsState* data, RequestStream& req);
 	static void GetCostsFinish(PortalRESTServer* server, RESTRequestState* state, GetCostsState* data);
 	static void GetCostsFree(GetCostsState* data);
+
+	static void GetMetricsFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
+
+	static void GetUpdatesFinish(PortalRESTServer* server, RESTRequestState* state, void* data);
 };
 
 #define ADMIN_METHOD(server, state, x)									\
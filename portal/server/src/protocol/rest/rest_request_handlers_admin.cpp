@@ -29,6 +29,7 @@
 
 #include "rest_request_handlers.h"
 
+#include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
 #include <boost/iostreams/get.hpp>
 #include <boost/iostreams/seek.hpp>
@@ -40,8 +41,10 @@
 #include "state.h"
 #include "admin_net.h"
 #include "admin_view.h"
+#include "plugin_registry.h"
 
 #include <iostream>
+#include <sstream>
 
 bool parse_prefix(const std::string& prefix, const char* len_str, std::string& result)
 {
@@ -234,6 +237,71 @@ ADMIN_TOKEN_METHOD(server, state,
 )
 }
 
+void RESTHandler::AdminNetGetPluginsFinish(PortalRESTServer* server, RESTRequestState* state, void* data)
+{
+ADMIN_TOKEN_METHOD(server, state,
+	if (!ADMIN_STATE->txn_apply(token, AdminNetBasePtr(new ::AdminNetBase())))
+		goto invalid;
+
+	std::string names;
+	BOOST_FOREACH(const std::string& name, OptPluginRegistry::Instance().get_list())
+		names += name + "\n";
+
+	state->set_text_response(MHD_HTTP_OK, names);
+)
+}
+
+void RESTHandler::AdminNetLoadPluginFinish(PortalRESTServer* server, RESTRequestState* state, void* data)
+{
+ADMIN_TOKEN_METHOD(server, state,
+	const char* path = state->get_qsargv("path");
+	if (!path)
+		goto invalid;
+
+	if (!ADMIN_STATE->txn_apply(token, AdminActionPtr(new ::AdminNetPluginLoad(path))))
+		goto invalid;
+
+	state->set_empty_response(MHD_HTTP_OK);
+)
+}
+
+bool RESTHandler::AdminNetLoadTrafficProcess(PortalRESTServer* server, RESTRequestState* state, NetTrafficRequestState* data, RequestStream& req)
+{
+	/* Records are aggregated as they arrive; errors are reported once the request is complete */
+	data->traffic->add_data(req);
+	return true;
+}
+
+void RESTHandler::AdminNetLoadTrafficFinish(PortalRESTServer* server, RESTRequestState* state, NetTrafficRequestState* data)
+{
+ADMIN_TOKEN_METHOD(server, state,
+	if (!data->traffic->finish())
+	{
+		server->get_logger()->warn("invalid traffic records: %s", data->traffic->get_error().c_str());
+		goto invalid;
+	}
+
+	try
+	{
+		const char* scale = state->get_qsargv("scale");
+		double scale_val = scale ? boost::lexical_cast<double>(scale) : 1.0;
+		if (!ADMIN_STATE->txn_apply(token, AdminActionPtr(new ::AdminNetTrafficLoad(data->traffic, scale_val, parse_qsboolean(server, state, "reset")))))
+			goto invalid;
+	}
+	catch (boost::bad_lexical_cast& e)
+	{
+		goto invalid;
+	}
+
+	state->set_empty_response(MHD_HTTP_OK);
+)
+}
+
+void RESTHandler::AdminNetLoadTrafficFree(NetTrafficRequestState* data)
+{
+	delete data;
+}
+
 int RESTHandler::AdminViewGetPIDPrefixesWrite(ViewPrefixesReaderResponseState* data, uint64_t pos, char *buf, int max)
 {
 	ResponseStream rsp(buf, max);
@@ -387,6 +455,10 @@ ADMIN_TOKEN_METHOD(server, state,
 
 	state->set_empty_response(MHD_HTTP_OK);
 	RESTHandler::UpdateVerTag();
+
+	/* Precomputed responses carry the old version tag */
+	if (MAP_RESPONSES)
+		MAP_RESPONSES->invalidate_all();
 )
 }
 
@@ -665,6 +737,69 @@ ADMIN_TOKEN_METHOD(server, state,
 )
 }
 
+void RESTHandler::AdminViewAddRouteFinish(PortalRESTServer* server, RESTRequestState* state, void* data)
+{
+ADMIN_TOKEN_METHOD(server, state,
+	const char* src;
+	const char* dst;
+	const char* links;
+	const char* weight;
+	std::vector<p4p::PIDLinkName> link_names;
+
+	if (!(src = state->get_qsargv("src")))
+		goto invalid;
+
+	if (!(dst = state->get_qsargv("dst")))
+		goto invalid;
+
+	if (!(links = state->get_qsargv("links")))
+		goto invalid;
+
+	boost::split(link_names, links, boost::is_any_of(","));
+
+	try
+	{
+		weight = state->get_qsargv("w");
+		if (!ADMIN_STATE->txn_apply(token, AdminActionPtr(new ::AdminViewAddStaticRoute(state->get_argv(2), src, dst, link_names, weight ? boost::lexical_cast<double>(weight) : 1.0))))
+			goto invalid;
+	}
+	catch (boost::bad_lexical_cast& e)
+	{
+		goto invalid;
+	}
+
+	state->set_empty_response(MHD_HTTP_OK);
+)
+}
+
+void RESTHandler::AdminViewDeleteRouteFinish(PortalRESTServer* server, RESTRequestState* state, void* data)
+{
+ADMIN_TOKEN_METHOD(server, state,
+	const char* src = state->get_qsargv("src");
+	const char* dst = state->get_qsargv("dst");
+	const char* links = state->get_qsargv("links");
+	std::vector<p4p::PIDLinkName> link_names;
+
+	/* Without a route, clear them all */
+	if (!src && !dst && !links)
+	{
+		if (!ADMIN_STATE->txn_apply(token, AdminActionPtr(new ::AdminViewClearStaticRoutes(state->get_argv(2)))))
+			goto invalid;
+	}
+	else
+	{
+		if (!src || !dst || !links)
+			goto invalid;
+
+		boost::split(link_names, links, boost::is_any_of(","));
+		if (!ADMIN_STATE->txn_apply(token, AdminActionPtr(new ::AdminViewDeleteStaticRoute(state->get_argv(2), src, dst, link_names))))
+			goto invalid;
+	}
+
+	state->set_empty_response(MHD_HTTP_OK);
+)
+}
+
 void RESTHandler::AdminViewGetPropFinish(PortalRESTServer* server, RESTRequestState* state, void* data)
 {
 ADMIN_TOKEN_METHOD(server, state,
@@ -723,6 +858,22 @@ ADMIN_TOKEN_METHOD(server, state,
 )
 }
 
+void RESTHandler::AdminViewGetTraceFinish(PortalRESTServer* server, RESTRequestState* state, void* data)
+{
+ADMIN_TOKEN_METHOD(server, state,
+	if (!ADMIN_STATE->txn_apply(token, AdminActionPtr(new ::AdminViewBase(state->get_argv(2)))))
+		goto invalid;
+
+	UpdateTraceVector traces;
+	if (UPDATE_TRACES)
+		UPDATE_TRACES->get(state->get_argv(2), traces);
+
+	std::ostringstream os;
+	UpdateTraceLog::write_chrome_trace(os, traces);
+	state->set_text_response(MHD_HTTP_OK, os.str(), "application/json");
+)
+}
+
 void RESTHandler::AdminGetTokenFinish(PortalRESTServer* server, RESTRequestState* state, void* data)
 {
 ADMIN_METHOD(server, state,
@@ -38,6 +38,7 @@
 #include <limits.h>
 #include <p4p/detail/util.h>
 #include "state.h"
+#include "update_stream_job.h"
 
 extern const char* get_view_name(RESTRequestState* req);
 
@@ -119,10 +120,16 @@ int RESTHandler::GetNetMapWrite(GetNetMapState* data, uint64_t pos, char *buf, i
 
 bool RESTHandler::GetNetMapProcess(PortalRESTServer* server, RESTRequestState* state, GetNetMapState* data, RequestStream& req)
 {
-	/* Gather all of the PIDs */
-	std::vector<std::pair<p4p::PID, std::vector<p4p::IPPrefix> > > pids;
 	req.mark();
 
+	/* Serve the precomputed map of the current version if there is one */
+	MapResponsesConstPtr responses = MAP_RESPONSES ? MAP_RESPONSES->get(get_view_name(state)) : MapResponsesConstPtr();
+	if (responses && responses->network_map)
+	{
+		data->body = responses->network_map;
+		return true;
+	}
+
 	InfoResourceNetworkMap netmap;
         netmap.setVerTag(GetVerTag());
 
@@ -135,7 +142,10 @@ bool RESTHandler::GetNetMapProcess(PortalRESTServer* server, RESTRequestState* s
 			return true;
 		}
 		GetNetMapViewState view_state(view);
-		view_state.get()->get_prefixes(view_state.get_view_lock())->enumerate(pids, view_state.get_prefixes_lock());
+
+		/* Prefixes of all PIDs, shared by every request for this version of the map */
+		PIDPrefixTableConstPtr table = view_state.get()->get_prefixes(view_state.get_view_lock())->get_table(view_state.get_prefixes_lock());
+		const PIDPrefixTable::EntryVector& pids = table->get_entries();
 
 		for (unsigned int i = 0; i < pids.size(); i++)
 		{
@@ -167,6 +177,11 @@ bool RESTHandler::GetNetMapProcess(PortalRESTServer* server, RESTRequestState* s
 
 void RESTHandler::GetNetMapFinish(PortalRESTServer* server, RESTRequestState* state, GetNetMapState* data)
 {
+	if (data->body)
+	{
+		state->set_encoded_response(MHD_HTTP_OK, data->body, MEDIA_TYPE_NETMAP);
+		return;
+	}
 	state->set_callback_response((RESTContentReaderCallback)GetNetMapWrite, MEDIA_TYPE_NETMAP);
 	return;
 }
@@ -197,13 +212,10 @@ int RESTHandler::GetNetMapFilteredWrite(GetNetMapFilteredState* data, uint64_t p
 
 bool RESTHandler::GetNetMapFilteredProcess(PortalRESTServer* server, RESTRequestState* state, GetNetMapFilteredState* data, RequestStream& req)
 {
-	/* Gather all of the post data */
-	std::string parts;
-	while (req >> parts)
-	{
-		data->filter += parts;
-		req.mark();
-	}
+	/* Gather all of the post data as-is; it is parsed in place once complete */
+	char buf[4096];
+	while (req.read(buf, sizeof(buf)) || req.gcount() > 0)
+		data->filter.append(buf, req.gcount());
 	return true;
 }
 
@@ -219,7 +231,6 @@ void RESTHandler::GetNetMapFilteredFinish(PortalRESTServer* server, RESTRequestS
 	}
 
 	ViewPtr view;
-	std::vector<std::pair<p4p::PID, std::vector<p4p::IPPrefix> > > pids;
 
 	InfoResourceNetworkMap netmap;
         netmap.setVerTag(GetVerTag());
@@ -233,7 +244,10 @@ void RESTHandler::GetNetMapFilteredFinish(PortalRESTServer* server, RESTRequestS
 			return;
 		}
 		GetNetMapFilteredViewState view_state(view);
-		view_state.get()->get_prefixes(view_state.get_view_lock())->enumerate(pids, view_state.get_prefixes_lock());
+
+		/* Prefixes of all PIDs, shared by every request for this version of the map */
+		PIDPrefixTableConstPtr table = view_state.get()->get_prefixes(view_state.get_view_lock())->get_table(view_state.get_prefixes_lock());
+		const PIDPrefixTable::EntryVector& pids = table->get_entries();
 
 
 		for (unsigned int i = 0; i < pids.size(); i++)
@@ -241,7 +255,7 @@ void RESTHandler::GetNetMapFilteredFinish(PortalRESTServer* server, RESTRequestS
 			std::string pid_name;
 			view_state.get()->get_aggregation(view_state.get_view_lock())->reverse_lookup(pids[i].first, pid_name, view_state.get_aggregation_lock());
 
-			if (pid_set.getPIDSet().find(pid_name) == pid_set.getPIDSet().end())
+			if (!pid_set.getPIDSet().contains(pid_name))
 				continue;
 			unsigned int prefixes_size = pids[i].second.size();
 			for (unsigned int j = 0; j < prefixes_size; j++)
@@ -314,6 +328,14 @@ void RESTHandler::GetCostMapFinish(PortalRESTServer* server, RESTRequestState* s
 		return;
 	}
 
+	MapResponsesConstPtr responses = MAP_RESPONSES ? MAP_RESPONSES->get(get_view_name(state)) : MapResponsesConstPtr();
+	EncodedBodyConstPtr body = responses ? responses->get_cost_map(data->cost_mode, data->cost_type) : EncodedBodyConstPtr();
+	if (body)
+	{
+		state->set_encoded_response(MHD_HTTP_OK, body, MEDIA_TYPE_COSTMAP);
+		return;
+	}
+
 	InfoResourceCostMap ircm;	
 	ircm.addCostMode(data->cost_mode);
 	ircm.addCostType(data->cost_type);
@@ -409,13 +431,10 @@ int RESTHandler::GetCostMapFilteredWrite(RESTHandler::GetCostMapFilteredState* d
 
 bool RESTHandler::GetCostMapFilteredProcess(PortalRESTServer* server, RESTRequestState* state, GetCostMapFilteredState* data, RequestStream& req)
 {
-	/* Gather all of the post data */
-	std::string parts;
-	while (req >> parts)
-	{
-		data->filter += parts;
-		req.mark();
-	}
+	/* Gather all of the post data as-is; it is parsed in place once complete */
+	char buf[4096];
+	while (req.read(buf, sizeof(buf)) || req.gcount() > 0)
+		data->filter.append(buf, req.gcount());
 	return true;
 }
 
@@ -467,17 +486,17 @@ void RESTHandler::GetCostMapFilteredFinish(PortalRESTServer* server, RESTRequest
 		const ReadableLock& agg_lock = view_state.get_aggregation_lock();
 
 		p4p::PIDSet all_src, all_dst;
-		std::set<std::string>& srcs = pid_mat.getPIDSrcs();
-		std::set<std::string>& dsts = pid_mat.getPIDDsts();
+		JsonNameSet& srcs = pid_mat.getPIDSrcs();
+		JsonNameSet& dsts = pid_mat.getPIDDsts();
 
-		for (std::set<std::string>::const_iterator it = srcs.begin(); it != srcs.end(); it++)
+		for (size_t i = 0; i < srcs.size(); i++)
 		{
-			all_src.insert(agg->lookup(*it, agg_lock));
+			all_src.insert(agg->lookup(std::string(srcs[i], srcs.getLength(i)), agg_lock));
 		}
 
-		for (std::set<std::string>::const_iterator it = dsts.begin(); it != dsts.end(); it++)
+		for (size_t i = 0; i < dsts.size(); i++)
 		{
-			all_dst.insert(agg->lookup(*it, agg_lock));
+			all_dst.insert(agg->lookup(std::string(dsts[i], dsts.getLength(i)), agg_lock));
 		}
 
 		for (p4p::PIDSet::const_iterator it = all_src.begin(); it != all_src.end(); it++)
@@ -545,13 +564,10 @@ int RESTHandler::GetEndPointsPropertyWrite(GetEndPointsPropertyState* data, uint
 
 bool RESTHandler::GetEndPointsPropertyProcess(PortalRESTServer* server, RESTRequestState* state, GetEndPointsPropertyState* data, RequestStream& req)
 {
-	/* Gather all of the post data */
-	std::string parts;
-	while (req >> parts)
-	{
-		data->filter += parts;
-		req.mark();
-	}
+	/* Gather all of the post data as-is; it is parsed in place once complete */
+	char buf[4096];
+	while (req.read(buf, sizeof(buf)) || req.gcount() > 0)
+		data->filter.append(buf, req.gcount());
 	return true;
 }
 
@@ -565,12 +581,13 @@ void RESTHandler::GetEndPointsPropertyFinish(PortalRESTServer* server, RESTReque
 		return;
 	}
 
-	std::set<std::string>& prop_set = json_epp.getProperties();
+	JsonNameSet& prop_set = json_epp.getProperties();
 	EndPointsProperty epp;
 
-	for (std::set<std::string>::const_iterator it = prop_set.begin(); it != prop_set.end(); it++)
+	for (size_t p = 0; p < prop_set.size(); p++)
 	{
-		if (EndPointsPropertySet.find(*it) == EndPointsPropertySet.end())
+		std::string prop(prop_set[p], prop_set.getLength(p));
+		if (EndPointsPropertySet.find(prop) == EndPointsPropertySet.end())
 		{
 			ReplyError(state, E_INVALID_PROPERTY_TYPE);
 			return;
@@ -592,16 +609,15 @@ void RESTHandler::GetEndPointsPropertyFinish(PortalRESTServer* server, RESTReque
 			PIDAggregationPtr agg = view_state.get()->get_aggregation(view_state.get_view_lock());
 			const ReadableLock& agg_lock = view_state.get_aggregation_lock();
 
-			std::set<std::string>& ip_set = json_epp.getEndPoints();
-			for(std::set<std::string>::const_iterator it2 = ip_set.begin(); it2 != ip_set.end(); it2++)
+			JsonNameSet& ip_set = json_epp.getEndPoints();
+			for (size_t i = 0; i < ip_set.size(); i++)
 			{
-				std::string ip(PostFilter::StripIP(*it2));
-				const p4p::PID* pid = pidmap->lookup(ip.c_str(), pidmap_lock);
+				const p4p::PID* pid = pidmap->lookup(PostFilter::StripIP(ip_set[i]), pidmap_lock);
 				if (pid == NULL)
 					continue; // ignore bad ips
 				std::string pid_name;
 				agg->reverse_lookup(*pid, pid_name, agg_lock);
-				epp.setProp(*it2, pid_name, *it);
+				epp.setProp(std::string(ip_set[i], ip_set.getLength(i)), pid_name, prop);
 			}
 		}
 		catch (TryLockFailed& e)
@@ -648,13 +664,10 @@ int RESTHandler::GetEndPointsCostWrite(GetEndPointsCostState* data, uint64_t pos
 
 bool RESTHandler::GetEndPointsCostProcess(PortalRESTServer* server, RESTRequestState* state, GetEndPointsCostState* data, RequestStream& req)
 {
-	/* Gather all of the post data */
-	std::string parts;
-	while (req >> parts)
-	{
-		data->filter += parts;
-		req.mark();
-	}
+	/* Gather all of the post data as-is; it is parsed in place once complete */
+	char buf[4096];
+	while (req.read(buf, sizeof(buf)) || req.gcount() > 0)
+		data->filter.append(buf, req.gcount());
 	return true;
 }
 
@@ -705,25 +718,40 @@ void RESTHandler::GetEndPointsCostFinish(PortalRESTServer* server, RESTRequestSt
 		PIDRoutingPtr prp = view_state.get()->get_intradomain_routing(view_state.get_view_lock());
 		const ReadableLock& route_lock = view_state.get_intradomain_routing_lock();
 
-		std::set<std::string>& srcs = json_epcost.getEndPointsSrcs();
-		std::set<std::string>& dsts = json_epcost.getEndPointsDsts();
+		JsonNameSet& srcs = json_epcost.getEndPointsSrcs();
+		JsonNameSet& dsts = json_epcost.getEndPointsDsts();
 
-		for (std::set<std::string>::const_iterator sit = srcs.begin(); sit != srcs.end(); sit++)
+		/* Look up each endpoint once, rather than once per pair */
+		std::vector<const p4p::PID*> dst_pids(dsts.size());
+		std::vector<std::string> dst_names(dsts.size());
+		for (size_t d = 0; d < dsts.size(); d++)
 		{
-			const p4p::PID* src_pid = pidmap->lookup(PostFilter::StripIP(*sit).c_str(), pidmap_lock);
-			for (std::set<std::string>::const_iterator dit = dsts.begin(); dit != dsts.end(); dit++)
+			dst_pids[d] = pidmap->lookup(PostFilter::StripIP(dsts[d]), pidmap_lock);
+			dst_names[d].assign(dsts[d], dsts.getLength(d));
+		}
+		bool numerical = json_epcost.getCostMode() == "numerical";
+
+		for (size_t s = 0; s < srcs.size(); s++)
+		{
+			const p4p::PID* src_pid = pidmap->lookup(PostFilter::StripIP(srcs[s]), pidmap_lock);
+			if (src_pid == NULL)
+				continue; // ignore bad ips
+			std::string src_name(srcs[s], srcs.getLength(s));
+			for (size_t d = 0; d < dsts.size(); d++)
 			{
-				const p4p::PID* dst_pid = pidmap->lookup(PostFilter::StripIP(*dit).c_str(), pidmap_lock);
+				const p4p::PID* dst_pid = dst_pids[d];
+				if (dst_pid == NULL)
+					continue;
 				double cost = spmp->get_by_pid(*src_pid, *dst_pid, ln_pdis_lock, -1.0);
 				if (cost < 0.0)
 					continue; // ignore
-				if (json_epcost.getCostMode() == "numerical")
+				if (numerical)
 				{
 					cost = prp->get_weight(*src_pid, *dst_pid, route_lock);
 				}
 				if (!json_epcost.inConstraints(cost))
 					continue;
-				epcost.addCost(*sit, *dit, cost);
+				epcost.addCost(src_name, dst_names[d], cost);
 			}
 		}
 		epcost.commit();
@@ -746,4 +774,35 @@ void RESTHandler::GetEndPointsCostFree(GetEndPointsCostState* data)
 	delete data;
 }
 
+void RESTHandler::GetUpdatesFinish(PortalRESTServer* server, RESTRequestState* state, void* data)
+{
+	std::string cost_mode = state->get_argv(1);
+	std::string cost_type = state->get_argv(2);
+	if (CostModeSet.find(cost_mode) == CostModeSet.end())
+	{
+		ReplyError(state, E_INVALID_COST_MODE);
+		return;
+	}
+	if (CostTypeSet.find(cost_type) == CostTypeSet.end())
+	{
+		ReplyError(state, E_INVALID_COST_TYPE);
+		return;
+	}
+
+	/* Each open stream either keeps a thread or needs its connection
+	 * suspended while idle */
+	UpdateStreamRegistryPtr streams = UPDATE_STREAMS;
+	if (!streams || !server->supports_event_streams())
+	{
+		ReplyError(state, E_SERVICE_UNAVAILABLE);
+		return;
+	}
 
+	std::string view = get_view_name(state);
+	bool need_refresh;
+	EventStreamPtr stream = streams->subscribe(view, cost_mode, cost_type, need_refresh);
+	if (need_refresh)
+		JOB_QUEUE->enqueue(JobPtr(new UpdateStreamJob(JOB_QUEUE, boost::get_system_time(), view)));
+
+	state->set_event_stream_response(streams->get_hub(), stream, server->get_suspend_resume());
+}
@@ -95,6 +95,16 @@ void RESTHandler::GetPIDsFinish(PortalRESTServer* server, RESTRequestState* stat
 {
 	if (!state->get_qsargv("admin"))
 	{
+		/* The full matrix is precomputed for each version of the view */
+		MapResponsesConstPtr responses = MAP_RESPONSES && data->pids.empty() ? MAP_RESPONSES->get(get_view_name(state)) : MapResponsesConstPtr();
+		if (responses && responses->pdistances)
+		{
+			state->set_encoded_response(MHD_HTTP_OK, responses->pdistances);
+			state->add_response_header(HDR_CACHE_CONTROL, "max-age=" + boost::lexical_cast<std::string>(responses->pdistance_ttl));
+			state->add_response_header(HDR_PIDMAP_SEQNO, boost::lexical_cast<std::string>(responses->pidmap_version));
+			return;
+		}
+
 		try
 		{
 			ViewPtr view = GlobalView<TryReadLock>(get_view_name(state))();
@@ -151,7 +161,8 @@ int RESTHandler::GetPIDMapWrite(GetPIDMapState* data, uint64_t pos, char *buf, i
 	unsigned int& i = data->i;
 	unsigned int& j = data->j;
 
-	unsigned int pids_size = data->pids.size();
+	const std::vector<std::pair<p4p::PID, std::vector<p4p::IPPrefix> > >& pids = data->table ? data->table->get_entries() : data->pids;
+	unsigned int pids_size = pids.size();
 
 	if (i >= pids_size)
 		return -1;
@@ -164,17 +175,17 @@ int RESTHandler::GetPIDMapWrite(GetPIDMapState* data, uint64_t pos, char *buf, i
 		{
 		case 0:
 		{
-			if (!(rsp << data->pids[i].first << '\t' << data->pids[i].second.size()))
+			if (!(rsp << pids[i].first << '\t' << pids[i].second.size()))
 				return rsp.get_mark();
 			rsp.mark();
 			data->pid_state = 1;
 		}
 		case 1:
 		{
-			unsigned int prefixes_size = data->pids[i].second.size();
+			unsigned int prefixes_size = pids[i].second.size();
 			for ( ; j < prefixes_size; ++j)
 			{
-				if (!(rsp << '\t' << data->pids[i].second[j]))
+				if (!(rsp << '\t' << pids[i].second[j]))
 					return rsp.get_mark();
 				rsp.mark();
 			}
@@ -197,11 +208,13 @@ int RESTHandler::GetPIDMapWrite(GetPIDMapState* data, uint64_t pos, char *buf, i
 
 bool RESTHandler::GetPIDMapProcess(PortalRESTServer* server, RESTRequestState* state, GetPIDMapState* data, RequestStream& req)
 {
-	/* Gather all of the PIDs */
+	/* Gather all of the PIDs; those of ISPs this process has never seen map to nothing */
 	p4p::PID p;
-	while (req >> p)
+	bool known;
+	while (read_known_pid(req, p, known))
 	{
-		data->pids.push_back(std::make_pair(p, std::vector<p4p::IPPrefix>()));
+		if (known)
+			data->pids.push_back(std::make_pair(p, std::vector<p4p::IPPrefix>()));
 		req.mark();
 	}
 	REQUEST_READ_ERR(req, state);
@@ -229,7 +242,10 @@ void RESTHandler::GetPIDMapFinish(PortalRESTServer* server, RESTRequestState* st
 			GetPIDMapViewState view_state(view);
 			ttl = view_state.get()->get_pid_ttl(view_state.get_view_lock());
 			seqno = view_state.get()->get_prefixes(view_state.get_view_lock())->get_version(view_state.get_prefixes_lock());
-			view_state.get()->get_prefixes(view_state.get_view_lock())->enumerate(data->pids, view_state.get_prefixes_lock());
+			if (data->pids.empty())
+				data->table = view_state.get()->get_prefixes(view_state.get_view_lock())->get_table(view_state.get_prefixes_lock());
+			else
+				view_state.get()->get_prefixes(view_state.get_view_lock())->enumerate(data->pids, view_state.get_prefixes_lock());
 		}
 		catch (TryReadLock& e)
 		{
@@ -245,7 +261,10 @@ void RESTHandler::GetPIDMapFinish(PortalRESTServer* server, RESTRequestState* st
 						      admin_view->get_prefixes_read().second);
 			ttl = view_state.get()->get_pid_ttl(view_state.get_view_lock());
 			seqno = view_state.get()->get_prefixes(view_state.get_view_lock())->get_version(view_state.get_prefixes_lock());
-			view_state.get()->get_prefixes(view_state.get_view_lock())->enumerate(data->pids, view_state.get_prefixes_lock());
+			if (data->pids.empty())
+				data->table = view_state.get()->get_prefixes(view_state.get_view_lock())->get_table(view_state.get_prefixes_lock());
+			else
+				view_state.get()->get_prefixes(view_state.get_view_lock())->enumerate(data->pids, view_state.get_prefixes_lock());
 		)
 	}
 
@@ -311,9 +330,10 @@ int RESTHandler::GetCostsWrite(RESTHandler::GetCostsState* data, uint64_t pos, c
 bool RESTHandler::GetCostsProcess(PortalRESTServer* server, RESTRequestState* state, GetCostsState* data, RequestStream& req)
 {
 	p4p::PID src;
+	bool src_known;
 	std::string reverse;
 	unsigned int dst_count;
-	while (req >> src >> reverse >> dst_count)
+	while (read_known_pid(req, src, src_known) >> reverse >> dst_count)
 	{
 		bool reverse_bool;
 		if (reverse == "inc-reverse")
@@ -323,29 +343,33 @@ bool RESTHandler::GetCostsProcess(PortalRESTServer* server, RESTRequestState* st
 		else
 			goto invalid_argument;
 
-		/* Initialize the entry */
-		data->pids[src] = std::make_pair(reverse_bool, p4p::PIDSet());
+		/* Initialize the entry. PIDs of ISPs this process has never seen
+		 * have no pDistances, so their rows and columns are left out. */
+		p4p::PIDSet unknown_dsts;
+		p4p::PIDSet* dsts = &unknown_dsts;
+		if (src_known)
+		{
+			data->pids[src] = std::make_pair(reverse_bool, p4p::PIDSet());
+			dsts = &data->pids[src].second;
+		}
 
 		if (dst_count == 0)
 		{
 			/* Flag that we'll need the set of all available PIDs */
-			data->need_all = true;
+			if (src_known)
+				data->need_all = true;
 		}
 		else
 		{
-			/* Read explicit list of destinations */
-
-			/* Reset to empty list */
-			p4p::PIDSet& dsts = data->pids[src].second;
-			dsts.clear();
-
 			/* Read all of the destination PIDs */
 			p4p::PID dst;
+			bool dst_known;
 			for (unsigned int i = 0; i < dst_count; ++i)
 			{
-				if (!(req >> dst))
+				if (!read_known_pid(req, dst, dst_known))
 					REQUEST_READ_ERR(req, state);
-				dsts.insert(dst);
+				if (dst_known)
+					dsts->insert(dst);
 			}
 		}
 
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "update_stream.h"
+
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include <p4pserver/locking.h>
+#include "global_state.h"
+#include "rest_request_handlers.h"
+#include "view_registry.h"
+
+UpdateStreamRegistry::UpdateStreamRegistry(size_t max_buffered)
+	: max_buffered_(max_buffered),
+	  hub_(new EventStreamHub())
+{
+}
+
+std::string UpdateStreamRegistry::get_topic(const std::string& name, const std::string& cost_mode, const std::string& cost_type)
+{
+	return name + "/" + cost_mode + "/" + cost_type;
+}
+
+EventStreamPtr UpdateStreamRegistry::subscribe(const std::string& name, const std::string& cost_mode, const std::string& cost_type, bool& need_refresh)
+{
+	std::string topic = get_topic(name, cost_mode, cost_type);
+	EventStreamPtr stream = hub_->subscribe(topic, max_buffered_);
+	need_refresh = !hub_->has_snapshot(topic);
+	return stream;
+}
+
+void UpdateStreamRegistry::remove_view(const std::string& name)
+{
+	BOOST_FOREACH(const std::string& cost_mode, RESTHandler::CostModeSet)
+	{
+		BOOST_FOREACH(const std::string& cost_type, RESTHandler::CostTypeSet)
+			hub_->remove(get_topic(name, cost_mode, cost_type));
+	}
+	views_.erase(name);
+}
+
+void UpdateStreamRegistry::refresh(const std::string& name)
+{
+	boost::mutex::scoped_lock lock(mutex_);
+
+	/* Only topics with subscribers are kept up to date; the others are
+	 * forgotten so that a new subscriber waits for a fresh snapshot */
+	std::vector<std::pair<std::string, std::string> > subscribed;
+	BOOST_FOREACH(const std::string& cost_mode, RESTHandler::CostModeSet)
+	{
+		BOOST_FOREACH(const std::string& cost_type, RESTHandler::CostTypeSet)
+		{
+			if (!hub_->remove_if_unused(get_topic(name, cost_mode, cost_type)))
+				subscribed.push_back(std::make_pair(cost_mode, cost_type));
+		}
+	}
+	if (subscribed.empty())
+	{
+		views_.erase(name);
+		return;
+	}
+
+	ViewPtr view = GlobalView<BlockReadLock>(name)();
+	if (!view)
+	{
+		remove_view(name);
+		return;
+	}
+
+	MapSnapshotPtr snapshot = MapSnapshot::build(view);
+	ViewState& state = views_[name];
+	unsigned long long seqno = ++state.seqno;
+
+	std::string network_map = snapshot->get_network_map();
+	std::string network_map_patch;
+	if (state.snapshot)
+		network_map_patch = snapshot->get_network_map_patch(*state.snapshot);
+
+	/* Cost maps only depend on the cost mode */
+	std::map<std::string, std::string> cost_maps;
+	std::map<std::string, std::string> cost_map_patches;
+
+	for (unsigned int i = 0; i < subscribed.size(); ++i)
+	{
+		const std::string& cost_mode = subscribed[i].first;
+		const std::string& cost_type = subscribed[i].second;
+		std::string topic = get_topic(name, cost_mode, cost_type);
+
+		if (cost_map_patches.find(cost_mode) == cost_map_patches.end())
+			cost_map_patches[cost_mode] = state.snapshot ? snapshot->get_cost_map_patch(*state.snapshot, cost_mode) : "";
+
+		std::string update;
+		if (!network_map_patch.empty())
+			EventStreamHub::append_message(update, "networkmap-patch", seqno, network_map_patch);
+		if (!cost_map_patches[cost_mode].empty())
+			EventStreamHub::append_message(update, "costmap-patch", seqno, cost_map_patches[cost_mode]);
+
+		/* Nothing changed, and subscribers already have the maps */
+		if (state.snapshot && update.empty() && hub_->has_snapshot(topic))
+			continue;
+
+		if (cost_maps.find(cost_mode) == cost_maps.end())
+			cost_maps[cost_mode] = snapshot->get_cost_map(cost_mode, cost_type);
+
+		std::string full;
+		EventStreamHub::append_message(full, "networkmap", seqno, network_map);
+		EventStreamHub::append_message(full, "costmap", seqno, cost_maps[cost_mode]);
+
+		hub_->publish(topic,
+			      EventStreamMessagePtr(new std::string(full)),
+			      state.snapshot && !update.empty() ? EventStreamMessagePtr(new std::string(update)) : EventStreamMessagePtr());
+	}
+
+	state.snapshot = snapshot;
+}
+
+void UpdateStreamRegistry::refresh_all()
+{
+	std::vector<std::string> names;
+	{
+		GlobalStatePtr global_state = GLOBAL_STATE;
+		BlockReadLock global_state_lock(*global_state);
+		ViewRegistryPtr views = global_state->get_views(global_state_lock);
+		BlockReadLock views_lock(*views);
+		views->get_names(names, views_lock);
+	}
+
+	/* End the streams of views which no longer exist */
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		std::vector<std::string> removed;
+		for (ViewStateMap::const_iterator itr = views_.begin(); itr != views_.end(); ++itr)
+		{
+			if (std::find(names.begin(), names.end(), itr->first) == names.end())
+				removed.push_back(itr->first);
+		}
+		BOOST_FOREACH(const std::string& name, removed)
+			remove_view(name);
+	}
+
+	BOOST_FOREACH(const std::string& name, names)
+		refresh(name);
+}
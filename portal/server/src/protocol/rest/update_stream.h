@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UPDATE_STREAM_H
+#define UPDATE_STREAM_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <p4pserver/event_stream.h>
+#include "map_snapshot.h"
+
+class UpdateStreamRegistry;
+typedef boost::shared_ptr<UpdateStreamRegistry> UpdateStreamRegistryPtr;
+
+/**
+ * Streams of changes to the maps of views, for clients subscribed via
+ * the REST interface. There is a topic for each view and cost map; its
+ * subscribers are sent the network map and cost map, then a patch to
+ * each whenever it changes. Views are only tracked while they have
+ * subscribers.
+ */
+class UpdateStreamRegistry
+{
+public:
+	/**
+	 * @param max_buffered	Bytes queued for each subscriber before it is
+	 *			resynced with the full maps
+	 */
+	UpdateStreamRegistry(size_t max_buffered);
+
+	EventStreamHubPtr get_hub() const		{ return hub_; }
+
+	/**
+	 * Subscribe to a view's maps. 'need_refresh' is set if the topic has
+	 * no snapshot yet, in which case the view must be refreshed before
+	 * anything is sent.
+	 */
+	EventStreamPtr subscribe(const std::string& name, const std::string& cost_mode, const std::string& cost_type, bool& need_refresh);
+
+	/**
+	 * Rebuild the maps of a view from the global state and publish the
+	 * changes. Streams of deleted views are ended.
+	 */
+	void refresh(const std::string& name);
+
+	/** Refresh all views with subscribers */
+	void refresh_all();
+
+private:
+	struct ViewState
+	{
+		ViewState() : seqno(0) {}
+		MapSnapshotConstPtr snapshot;
+		unsigned long long seqno;
+	};
+	typedef std::map<std::string, ViewState> ViewStateMap;
+
+	static std::string get_topic(const std::string& name, const std::string& cost_mode, const std::string& cost_type);
+
+	void remove_view(const std::string& name);
+
+	size_t max_buffered_;
+	EventStreamHubPtr hub_;
+
+	/* Serializes refreshes, and protects 'views_' */
+	boost::mutex mutex_;
+	ViewStateMap views_;
+};
+
+#endif
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "udp_request_handler.h"
+
+#include <algorithm>
+#include <string>
+#include <netinet/in.h>
+#include "state.h"
+#include "udp_snapshot.h"
+#include "view_registry.h"
+
+namespace udp = p4p::protocol::portal::udp;
+
+static unsigned int write_error(udp::Writer& rsp, uint32_t id, uint8_t status)
+{
+	rsp.truncate(0);
+	rsp.put_u8(udp::VERSION);
+	rsp.put_u8(udp::MSG_ERROR_RSP);
+	rsp.put_u16(0);
+	rsp.put_u32(id);
+	rsp.put_u8(status);
+	rsp.put_u8(0);
+	rsp.put_u16(0);
+	rsp.put_u32(0);
+	rsp.put_u32(0);
+	return rsp.ok() ? rsp.size() : 0;
+}
+
+/* Returns the address family, treating IPv4-mapped IPv6 addresses as IPv4 */
+static int unmap_addr(int family, const void* addr, const void** result)
+{
+	*result = addr;
+	if (family == AF_INET6 && IN6_IS_ADDR_V4MAPPED((const struct in6_addr*)addr))
+	{
+		*result = ((const char*)addr) + 12;
+		return AF_INET;
+	}
+	return family;
+}
+
+unsigned int UDPHandler::operator()(PortalUDPServer* server,
+				    const char* req, unsigned int req_len,
+				    char* rsp_buf, unsigned int rsp_max,
+				    const struct sockaddr_storage& sender) const
+{
+	udp::Reader req_rd(req, req_len);
+
+	/* Drop datagrams too short to answer */
+	uint8_t version, type, view_len;
+	uint16_t count;
+	uint32_t id;
+	std::string view;
+	if (!req_rd.get_u8(version) || !req_rd.get_u8(type) || !req_rd.get_u16(count) || !req_rd.get_u32(id))
+		return 0;
+
+	/* Never answer with more bytes than were received, so that the
+	 * interface cannot be used to amplify traffic. Clients pad requests
+	 * to the size of response they can accept. */
+	udp::Writer rsp(rsp_buf, std::min(rsp_max, req_len));
+
+	if (version != udp::VERSION)
+		return write_error(rsp, id, udp::STATUS_UNSUPPORTED);
+	if (!req_rd.get_u8(view_len) || !req_rd.get_string(view, view_len))
+		return write_error(rsp, id, udp::STATUS_MALFORMED);
+
+	uint8_t rsp_type;
+	if (type == udp::MSG_GET_PIDS_REQ)
+	{
+		if (!server->is_enabled(PORTAL_MSG_GET_PID_REQ))
+			return write_error(rsp, id, udp::STATUS_DISABLED);
+		rsp_type = udp::MSG_GET_PIDS_RSP;
+	}
+	else if (type == udp::MSG_GET_PDISTANCES_REQ)
+	{
+		if (!server->is_enabled(PORTAL_MSG_GET_PDISTANCES_REQ))
+			return write_error(rsp, id, udp::STATUS_DISABLED);
+		rsp_type = udp::MSG_GET_PDISTANCES_RSP;
+	}
+	else
+		return write_error(rsp, id, udp::STATUS_UNSUPPORTED);
+
+	UDPViewSnapshotConstPtr snapshot = UDP_SNAPSHOTS ? UDP_SNAPSHOTS->get(view.empty() ? DEFAULT_VIEW_NAME : view) : UDPViewSnapshotConstPtr();
+	if (!snapshot)
+		return write_error(rsp, id, udp::STATUS_NO_VIEW);
+
+	rsp.put_u8(udp::VERSION);
+	rsp.put_u8(rsp_type);
+	unsigned int count_pos = rsp.size();
+	rsp.put_u16(0);
+	rsp.put_u32(id);
+	rsp.put_u8(udp::STATUS_OK);
+	rsp.put_u8(0);
+	rsp.put_u16(0);
+	rsp.put_u32(type == udp::MSG_GET_PIDS_REQ ? snapshot->get_pid_ttl() : snapshot->get_pdistance_ttl());
+	rsp.put_u32(snapshot->get_seqno());
+	if (!rsp.ok())
+		return 0;
+
+	/* Answer as many queries as fit; the client re-sends the rest */
+	unsigned int answered = 0;
+	if (type == udp::MSG_GET_PIDS_REQ)
+	{
+		/* With no addresses, look up the sender */
+		if (count == 0)
+		{
+			const void* addr = sender.ss_family == AF_INET
+				? (const void*)&((const struct sockaddr_in*)&sender)->sin_addr
+				: (const void*)&((const struct sockaddr_in6*)&sender)->sin6_addr;
+			int family = unmap_addr(sender.ss_family, addr, &addr);
+			if (rsp.put_pid(snapshot->lookup(family, addr)))
+				answered = 1;
+		}
+
+		for ( ; answered < count; ++answered)
+		{
+			struct in6_addr buf;
+			int family = req_rd.get_addr(&buf);
+			if (!family)
+				return write_error(rsp, id, udp::STATUS_MALFORMED);
+
+			const void* addr;
+			family = unmap_addr(family, &buf, &addr);
+
+			unsigned int mark = rsp.size();
+			if (!rsp.put_pid(snapshot->lookup(family, addr)))
+			{
+				rsp.truncate(mark);
+				break;
+			}
+		}
+	}
+	else
+	{
+		for ( ; answered < count; ++answered)
+		{
+			/* PIDs of ISPs this process has never seen have no pDistance */
+			p4p::PID src, dst;
+			bool src_known, dst_known;
+			if (!req_rd.get_known_pid(src, src_known) || !req_rd.get_known_pid(dst, dst_known))
+				return write_error(rsp, id, udp::STATUS_MALFORMED);
+
+			if (!rsp.put_u32(src_known && dst_known ? snapshot->get_pdistance(src, dst) : udp::PDISTANCE_UNAVAILABLE))
+				break;
+		}
+	}
+
+	rsp.set_u16(count_pos, answered);
+	return rsp.size();
+}
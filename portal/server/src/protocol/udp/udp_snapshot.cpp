@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "udp_snapshot.h"
+
+#include <algorithm>
+#include <math.h>
+#include <netinet/in.h>
+#include <boost/foreach.hpp>
+#include <p4p/detail/util.h>
+#include <p4pserver/locking.h>
+#include "global_state.h"
+#include "view_registry.h"
+
+typedef ViewWrapper<
+		const ReadableLock, const BlockReadLock,
+		const EmptyLock, const NoLock,
+		const ReadableLock, const BlockReadLock,
+		const EmptyLock, const NoLock,
+		const EmptyLock, const NoLock,
+		const ReadableLock, const BlockReadLock,
+		const ReadableLock, const BlockReadLock
+	> UDPSnapshotViewState;
+
+typedef std::vector<std::pair<p4p::PID, std::vector<p4p::IPPrefix> > > PIDPrefixList;
+
+/* IPv4 prefix as an inclusive range of host-order addresses */
+struct PrefixRange4
+{
+	PrefixRange4(uint64_t _start, uint64_t _end, unsigned int _pid) : start(_start), end(_end), pid(_pid) {}
+
+	/* Enclosing prefixes sort before the prefixes they contain */
+	bool operator<(const PrefixRange4& rhs) const
+	{
+		return start < rhs.start || (start == rhs.start && end > rhs.end);
+	}
+
+	uint64_t start;
+	uint64_t end;
+	unsigned int pid;
+};
+
+UDPViewSnapshot::UDPViewSnapshot(unsigned int pid_ttl, unsigned int pdistance_ttl, unsigned int seqno)
+	: pid_ttl_(pid_ttl),
+	  pdistance_ttl_(pdistance_ttl),
+	  seqno_(seqno)
+{
+}
+
+UDPViewSnapshot::UDPViewSnapshot(const PIDPrefixList& prefixes,
+				 const std::vector<uint32_t>& pdistances,
+				 unsigned int pid_ttl, unsigned int pdistance_ttl, unsigned int seqno)
+	: pdistances_(pdistances),
+	  pid_ttl_(pid_ttl),
+	  pdistance_ttl_(pdistance_ttl),
+	  seqno_(seqno)
+{
+	set_prefixes(prefixes);
+	pdistances_.resize(pids_.size() * pids_.size(), PDISTANCE_UNAVAILABLE);
+}
+
+UDPViewSnapshotPtr UDPViewSnapshot::build(ViewPtr view)
+{
+	UDPSnapshotViewState view_state(view);
+	const ReadableLock& view_lock = view_state.get_view_lock();
+
+	PIDPrefixTableConstPtr table = view->get_prefixes(view_lock)->get_table(view_state.get_prefixes_lock());
+
+	UDPViewSnapshotPtr snapshot(new UDPViewSnapshot(view->get_pid_ttl(view_lock),
+							view->get_pdistance_ttl(view_lock),
+							view->get_prefixes(view_lock)->get_version(view_state.get_prefixes_lock())));
+	snapshot->set_prefixes(table->get_entries());
+
+	/* Same values as the REST interface returns */
+	const std::vector<p4p::PID>& pids = snapshot->pids_;
+	unsigned int n = pids.size();
+	snapshot->pdistances_.resize(n * n);
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		for (unsigned int j = 0; j < n; ++j)
+		{
+			double d = view_state.get_pdistance(pids[i], pids[j]);
+			snapshot->pdistances_[i * n + j] = isnan(d)
+				? PDISTANCE_UNAVAILABLE
+				: p4p::detail::clip(round_int(d), View::MIN_PDISTANCE, View::MAX_PDISTANCE);
+		}
+	}
+
+	return snapshot;
+}
+
+void UDPViewSnapshot::add_range(uint64_t start, unsigned int pid)
+{
+	/* Past the end of the address space */
+	if (start > 0xffffffffULL)
+		return;
+
+	/* An empty range is replaced by the one starting at the same address */
+	if (!ranges4_.empty() && ranges4_.back().start == start)
+		ranges4_.pop_back();
+
+	/* Merge with the previous range if it maps to the same PID */
+	if (!ranges4_.empty() && ranges4_.back().pid == pid)
+		return;
+
+	ranges4_.push_back(Range(start, pid));
+}
+
+void UDPViewSnapshot::set_prefixes(const PIDPrefixList& prefixes)
+{
+	std::vector<PrefixRange4> ranges;
+	for (unsigned int i = 0; i < prefixes.size(); ++i)
+	{
+		pid_index_[prefixes[i].first] = pids_.size();
+		pids_.push_back(prefixes[i].first);
+
+		BOOST_FOREACH(const p4p::IPPrefix& prefix, prefixes[i].second)
+		{
+			if (prefix.get_family() == AF_INET)
+			{
+				uint64_t start = ntohl(((const struct in_addr*)prefix.get_address())->s_addr);
+				uint64_t size = 1ULL << (32 - std::min(prefix.get_length(), (unsigned short)32));
+				ranges.push_back(PrefixRange4(start, start + size - 1, i));
+			}
+			else
+				prefixes6_.add(prefix, prefixes[i].first);
+		}
+	}
+
+	/* Flatten the (nested) prefixes into disjoint ranges, each mapping to
+	 * the PID of the longest prefix covering it. 'open' holds the
+	 * prefixes containing the current address, innermost last. */
+	std::sort(ranges.begin(), ranges.end());
+	std::vector<PrefixRange4> open;
+	add_range(0, NO_PID);
+	BOOST_FOREACH(const PrefixRange4& r, ranges)
+	{
+		while (!open.empty() && open.back().end < r.start)
+		{
+			uint64_t end = open.back().end;
+			open.pop_back();
+			add_range(end + 1, open.empty() ? NO_PID : open.back().pid);
+		}
+		add_range(r.start, r.pid);
+		open.push_back(r);
+	}
+	while (!open.empty())
+	{
+		uint64_t end = open.back().end;
+		open.pop_back();
+		add_range(end + 1, open.empty() ? NO_PID : open.back().pid);
+	}
+}
+
+const p4p::PID& UDPViewSnapshot::lookup(int family, const void* addr) const
+{
+	if (family == AF_INET)
+	{
+		/* Last range starting at or before the address; the first range starts at 0 */
+		Range key(ntohl(((const struct in_addr*)addr)->s_addr), NO_PID);
+		std::vector<Range>::const_iterator itr = std::upper_bound(ranges4_.begin(), ranges4_.end(), key);
+		unsigned int pid = (itr - 1)->pid;
+		return pid == NO_PID ? p4p::PID::DEFAULT : pids_[pid];
+	}
+
+	const p4p::PID* pid = prefixes6_.lookup(p4p::IPPrefix(family, addr));
+	return pid ? *pid : p4p::PID::DEFAULT;
+}
+
+uint32_t UDPViewSnapshot::get_pdistance(const p4p::PID& src, const p4p::PID& dst) const
+{
+	boost::unordered_map<p4p::PID, unsigned int>::const_iterator src_i = pid_index_.find(src);
+	if (src_i == pid_index_.end())
+		return PDISTANCE_UNAVAILABLE;
+	boost::unordered_map<p4p::PID, unsigned int>::const_iterator dst_i = pid_index_.find(dst);
+	if (dst_i == pid_index_.end())
+		return PDISTANCE_UNAVAILABLE;
+	return pdistances_[src_i->second * pids_.size() + dst_i->second];
+}
+
+UDPViewSnapshotConstPtr UDPSnapshotRegistry::get(const std::string& name) const
+{
+	boost::mutex::scoped_lock l(mutex_);
+	SnapshotMap::const_iterator itr = snapshots_.find(name);
+	return itr != snapshots_.end() ? itr->second : UDPViewSnapshotConstPtr();
+}
+
+void UDPSnapshotRegistry::publish(const std::string& name, UDPViewSnapshotConstPtr snapshot)
+{
+	/* The previous snapshot is freed by the last reader still holding it */
+	boost::mutex::scoped_lock l(mutex_);
+	if (snapshot)
+		snapshots_[name] = snapshot;
+	else
+		snapshots_.erase(name);
+}
+
+void UDPSnapshotRegistry::refresh(const std::string& name)
+{
+	ViewPtr view = GlobalView<BlockReadLock>(name)();
+	publish(name, view ? UDPViewSnapshot::build(view) : UDPViewSnapshotPtr());
+}
+
+void UDPSnapshotRegistry::refresh_all()
+{
+	std::vector<std::string> names;
+	{
+		GlobalStatePtr global_state = GLOBAL_STATE;
+		BlockReadLock global_state_lock(*global_state);
+		ViewRegistryPtr views = global_state->get_views(global_state_lock);
+		BlockReadLock views_lock(*views);
+		views->get_names(names, views_lock);
+	}
+
+	/* Drop snapshots of views which no longer exist */
+	{
+		boost::mutex::scoped_lock l(mutex_);
+		for (SnapshotMap::iterator itr = snapshots_.begin(); itr != snapshots_.end(); )
+		{
+			if (std::find(names.begin(), names.end(), itr->first) == names.end())
+				snapshots_.erase(itr++);
+			else
+				++itr;
+		}
+	}
+
+	BOOST_FOREACH(const std::string& name, names)
+		refresh(name);
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UDP_SNAPSHOT_H
+#define UDP_SNAPSHOT_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+#include <p4p/pid.h>
+#include <p4p/detail/patricia_trie.h>
+#include "view.h"
+
+class UDPViewSnapshot;
+typedef boost::shared_ptr<UDPViewSnapshot> UDPViewSnapshotPtr;
+typedef boost::shared_ptr<const UDPViewSnapshot> UDPViewSnapshotConstPtr;
+
+/**
+ * Immutable copy of the parts of a view needed to answer PID and pDistance
+ * lookups, so that the UDP interface can answer without taking any view
+ * locks. IPv4 lookups use a flattened, sorted table of address ranges;
+ * pDistances are precomputed for every pair of PIDs with prefixes.
+ */
+class UDPViewSnapshot
+{
+public:
+	static const uint32_t PDISTANCE_UNAVAILABLE = 0xffffffff;
+
+	/**
+	 * Build a snapshot of a view. Waits for the view's locks, so this
+	 * must not be called from a request handler.
+	 */
+	static UDPViewSnapshotPtr build(ViewPtr view);
+
+	/**
+	 * Build a snapshot from explicit data (used by benchmarks).
+	 * @param prefixes	PIDs and their prefixes
+	 * @param pdistances	pDistance between each pair of PIDs in 'prefixes' (row-major
+	 *			in the same order), or PDISTANCE_UNAVAILABLE
+	 */
+	UDPViewSnapshot(const std::vector<std::pair<p4p::PID, std::vector<p4p::IPPrefix> > >& prefixes,
+			const std::vector<uint32_t>& pdistances,
+			unsigned int pid_ttl, unsigned int pdistance_ttl, unsigned int seqno);
+
+	/** Returns the PID for an address (AF_INET or AF_INET6), or PID::DEFAULT if not covered */
+	const p4p::PID& lookup(int family, const void* addr) const;
+
+	uint32_t get_pdistance(const p4p::PID& src, const p4p::PID& dst) const;
+
+	unsigned int get_pid_ttl() const		{ return pid_ttl_; }
+	unsigned int get_pdistance_ttl() const		{ return pdistance_ttl_; }
+	unsigned int get_seqno() const			{ return seqno_; }
+	unsigned int get_num_pids() const		{ return pids_.size(); }
+
+private:
+	static const unsigned int NO_PID = 0xffffffff;
+
+	/* Address range starting at 'start' (and ending where the next begins) */
+	struct Range
+	{
+		Range(uint32_t _start, unsigned int _pid) : start(_start), pid(_pid) {}
+		bool operator<(const Range& rhs) const	{ return start < rhs.start; }
+		uint32_t start;
+		unsigned int pid;
+	};
+
+	UDPViewSnapshot(unsigned int pid_ttl, unsigned int pdistance_ttl, unsigned int seqno);
+
+	void set_prefixes(const std::vector<std::pair<p4p::PID, std::vector<p4p::IPPrefix> > >& prefixes);
+	void add_range(uint64_t start, unsigned int pid);
+
+	std::vector<p4p::PID> pids_;
+	boost::unordered_map<p4p::PID, unsigned int> pid_index_;
+
+	std::vector<Range> ranges4_;
+	p4p::detail::PatriciaTrie<p4p::PID> prefixes6_;
+
+	/* Row-major matrix indexed by position in 'pids_' */
+	std::vector<uint32_t> pdistances_;
+
+	unsigned int pid_ttl_;
+	unsigned int pdistance_ttl_;
+	unsigned int seqno_;
+};
+
+class UDPSnapshotRegistry;
+typedef boost::shared_ptr<UDPSnapshotRegistry> UDPSnapshotRegistryPtr;
+
+/**
+ * Most recently published snapshot of each view.
+ */
+class UDPSnapshotRegistry
+{
+public:
+	UDPViewSnapshotConstPtr get(const std::string& name) const;
+
+	/** Replace a view's snapshot (or remove it if 'snapshot' is NULL) */
+	void publish(const std::string& name, UDPViewSnapshotConstPtr snapshot);
+
+	/** Rebuild the snapshot of a view from the global state */
+	void refresh(const std::string& name);
+
+	/** Rebuild the snapshots of all views, dropping those of deleted views */
+	void refresh_all();
+
+private:
+	typedef std::map<std::string, UDPViewSnapshotConstPtr> SnapshotMap;
+
+	mutable boost::mutex mutex_;
+	SnapshotMap snapshots_;
+};
+
+#endif
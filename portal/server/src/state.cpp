@@ -30,18 +30,43 @@
 #include "state.h"
 
 #include <stdexcept>
+#include <boost/foreach.hpp>
 #include <p4pserver/logging.h>
 #include "constants.h"
 #include "options.h"
 
 JobQueuePtr JOB_QUEUE;
+JobQueuePtr PLUGIN_QUEUE;
 AdminStatePtr ADMIN_STATE;
 GlobalStatePtr GLOBAL_STATE;
+UpdateTraceLogPtr UPDATE_TRACES;
+UDPSnapshotRegistryPtr UDP_SNAPSHOTS;
+MapResponseCachePtr MAP_RESPONSES;
+UpdateStreamRegistryPtr UPDATE_STREAMS;
 
 void init_state()
 {
 	JOB_QUEUE = JobQueuePtr(new JobQueue(OPTIONS["job-threads"].as<unsigned int>()));
+	if (OPTIONS["plugin-threads"].as<unsigned int>() > 0)
+		PLUGIN_QUEUE = JobQueuePtr(new JobQueue(OPTIONS["plugin-threads"].as<unsigned int>()));
+	UPDATE_TRACES = UpdateTraceLogPtr(new UpdateTraceLog(OPTIONS["update-trace-history"].as<unsigned int>()));
 	ADMIN_STATE = AdminStatePtr(new AdminState());
+
+	/* Snapshots, update streams and precomputed responses are only maintained if they are served */
+	BOOST_FOREACH(const std::string& intf, INTERFACE_LIST)
+	{
+		const std::string& type = INTERFACE_OPTIONS[intf + ".type"].as<std::string>();
+		if (type == "UDP" && !UDP_SNAPSHOTS)
+			UDP_SNAPSHOTS = UDPSnapshotRegistryPtr(new UDPSnapshotRegistry());
+		else if (type == "REST")
+		{
+			if (!UPDATE_STREAMS && OPTIONS["update-stream-buffer"].as<unsigned int>() > 0)
+				UPDATE_STREAMS = UpdateStreamRegistryPtr(new UpdateStreamRegistry(OPTIONS["update-stream-buffer"].as<unsigned int>()));
+			if (!MAP_RESPONSES && OPTIONS["precompute-responses"].as<bool>())
+				MAP_RESPONSES = MapResponseCachePtr(new MapResponseCache());
+		}
+	}
+
 	GLOBAL_STATE = GlobalStatePtr(new GlobalState());
 	GLOBAL_STATE->updated();
 }
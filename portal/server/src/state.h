@@ -32,10 +32,19 @@
 
 #include "admin_state.h"
 #include "global_state.h"
+#include "update_trace.h"
+#include "map_response_cache.h"
+#include "udp_snapshot.h"
+#include "update_stream.h"
 
 extern JobQueuePtr JOB_QUEUE;
+extern JobQueuePtr PLUGIN_QUEUE;
 extern AdminStatePtr ADMIN_STATE;
 extern GlobalStatePtr GLOBAL_STATE;
+extern UpdateTraceLogPtr UPDATE_TRACES;
+extern UDPSnapshotRegistryPtr UDP_SNAPSHOTS;
+extern MapResponseCachePtr MAP_RESPONSES;
+extern UpdateStreamRegistryPtr UPDATE_STREAMS;
 
 void init_state();
 
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "update_trace.h"
+
+#include <fstream>
+#include <unistd.h>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+
+namespace bpt = boost::posix_time;
+
+static const bpt::ptime EPOCH(boost::gregorian::date(1970, 1, 1));
+
+static long long to_usec(const bpt::time_duration& d)
+{
+	return d.total_microseconds();
+}
+
+static void write_json_string(std::ostream& os, const std::string& s)
+{
+	os << '"';
+	for (std::string::const_iterator i = s.begin(); i != s.end(); ++i)
+	{
+		if (*i == '"' || *i == '\\')
+			os << '\\' << *i;
+		else if ((unsigned char)*i < 0x20)
+			os << ' ';
+		else
+			os << *i;
+	}
+	os << '"';
+}
+
+UpdateTrace::UpdateTrace(const std::string& view)
+	: view_(view),
+	  seq_(0),
+	  start_(bpt::microsec_clock::universal_time()),
+	  duration_(0, 0, 0, 0),
+	  success_(false)
+{
+}
+
+void UpdateTrace::add_phase(const std::string& name, const bpt::ptime& start, long rss_delta_kb)
+{
+	Phase phase;
+	phase.name = name;
+	phase.start = start;
+	phase.duration = bpt::microsec_clock::universal_time() - start;
+	phase.rss_delta_kb = rss_delta_kb;
+	phases_.push_back(phase);
+}
+
+void UpdateTrace::add_lock_wait(const std::string& lock, const bpt::ptime& start)
+{
+	add_phase("lock-wait:" + lock, start);
+	count("lock_wait_usec", to_usec(phases_.back().duration));
+}
+
+void UpdateTrace::count(const std::string& name, unsigned long long delta)
+{
+	counters_[name] += delta;
+}
+
+void UpdateTrace::finish(bool success)
+{
+	success_ = success;
+	duration_ = bpt::microsec_clock::universal_time() - start_;
+}
+
+long UpdateTrace::get_rss_kb()
+{
+	std::ifstream statm("/proc/self/statm");
+	long size, resident;
+	if (!(statm >> size >> resident))
+		return 0;
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+UpdateTraceLog::UpdateTraceLog(unsigned int capacity)
+	: capacity_(capacity),
+	  next_seq_(1)
+{
+}
+
+void UpdateTraceLog::add(UpdateTracePtr trace)
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	if (capacity_ == 0)
+		return;
+
+	trace->seq_ = next_seq_++;
+	while (traces_.size() >= capacity_)
+		traces_.pop_front();
+	traces_.push_back(trace);
+}
+
+void UpdateTraceLog::get(const std::string& view, UpdateTraceVector& result) const
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	BOOST_FOREACH(const UpdateTraceConstPtr& trace, traces_)
+	{
+		if (view.empty() || trace->get_view() == view)
+			result.push_back(trace);
+	}
+}
+
+void UpdateTraceLog::write_chrome_trace(std::ostream& os, const UpdateTraceVector& traces)
+{
+	os << "{\"traceEvents\":[";
+	bool first = true;
+	BOOST_FOREACH(const UpdateTraceConstPtr& trace, traces)
+	{
+		/* Name the thread after the view and update sequence number */
+		os << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << trace->get_seq()
+		   << ",\"args\":{\"name\":";
+		write_json_string(os, trace->get_view() + " #" + boost::lexical_cast<std::string>(trace->get_seq()));
+		os << "}}";
+		first = false;
+
+		/* One event covering the whole update; counters are attached as arguments */
+		os << ",\n{\"name\":\"update\",\"cat\":\"view\",\"ph\":\"X\",\"pid\":1,\"tid\":" << trace->get_seq()
+		   << ",\"ts\":" << to_usec(trace->get_start() - EPOCH)
+		   << ",\"dur\":" << to_usec(trace->get_duration())
+		   << ",\"args\":{\"view\":";
+		write_json_string(os, trace->get_view());
+		os << ",\"success\":" << (trace->get_success() ? "true" : "false");
+		BOOST_FOREACH(const UpdateTrace::CounterMap::value_type& counter, trace->get_counters())
+		{
+			os << ",";
+			write_json_string(os, counter.first);
+			os << ":" << counter.second;
+		}
+		os << "}}";
+
+		BOOST_FOREACH(const UpdateTrace::Phase& phase, trace->get_phases())
+		{
+			os << ",\n{\"name\":";
+			write_json_string(os, phase.name);
+			os << ",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":" << trace->get_seq()
+			   << ",\"ts\":" << to_usec(phase.start - EPOCH)
+			   << ",\"dur\":" << to_usec(phase.duration)
+			   << ",\"args\":{\"rss_delta_kb\":" << phase.rss_delta_kb << "}}";
+		}
+	}
+	os << "\n]}\n";
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UPDATE_TRACE_H
+#define UPDATE_TRACE_H
+
+#include <deque>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+/**
+ * Timings and counters recorded for a single view update: the duration
+ * and resident memory change of each phase (including time spent waiting
+ * for locks), plus named counters such as routes computed and pdistance
+ * matrix cells written.
+ */
+class UpdateTrace
+{
+public:
+	struct Phase
+	{
+		std::string name;
+		boost::posix_time::ptime start;
+		boost::posix_time::time_duration duration;
+		long rss_delta_kb;
+	};
+	typedef std::vector<Phase> PhaseVector;
+	typedef std::map<std::string, unsigned long long> CounterMap;
+
+	/**
+	 * Records a phase lasting for the lifetime of the object.
+	 */
+	class ScopedPhase
+	{
+	public:
+		ScopedPhase(UpdateTrace& trace, const std::string& name)
+			: trace_(trace),
+			  name_(name),
+			  start_(boost::posix_time::microsec_clock::universal_time()),
+			  start_rss_kb_(get_rss_kb())
+		{}
+
+		~ScopedPhase()
+		{
+			trace_.add_phase(name_, start_, get_rss_kb() - start_rss_kb_);
+		}
+
+	private:
+		UpdateTrace& trace_;
+		std::string name_;
+		boost::posix_time::ptime start_;
+		long start_rss_kb_;
+	};
+
+	UpdateTrace(const std::string& view);
+
+	/**
+	 * Record a phase which started at 'start' and ends now.
+	 */
+	void add_phase(const std::string& name, const boost::posix_time::ptime& start, long rss_delta_kb = 0);
+
+	/**
+	 * Record a phase spent waiting for a lock. The wait is also added to
+	 * the 'lock_wait_usec' counter.
+	 */
+	void add_lock_wait(const std::string& lock, const boost::posix_time::ptime& start);
+
+	/**
+	 * Add to a named counter.
+	 */
+	void count(const std::string& name, unsigned long long delta);
+
+	/**
+	 * Mark the update as finished.
+	 * @param success	Whether the update was applied to the view.
+	 */
+	void finish(bool success);
+
+	const std::string& get_view() const { return view_; }
+	unsigned long long get_seq() const { return seq_; }
+	const boost::posix_time::ptime& get_start() const { return start_; }
+	const boost::posix_time::time_duration& get_duration() const { return duration_; }
+	bool get_success() const { return success_; }
+	const PhaseVector& get_phases() const { return phases_; }
+	const CounterMap& get_counters() const { return counters_; }
+
+	/**
+	 * Get the resident set size of the process, or 0 if unavailable.
+	 */
+	static long get_rss_kb();
+
+private:
+	friend class UpdateTraceLog;
+
+	std::string view_;
+	unsigned long long seq_;
+	boost::posix_time::ptime start_;
+	boost::posix_time::time_duration duration_;
+	bool success_;
+	PhaseVector phases_;
+	CounterMap counters_;
+};
+typedef boost::shared_ptr<UpdateTrace> UpdateTracePtr;
+typedef boost::shared_ptr<const UpdateTrace> UpdateTraceConstPtr;
+typedef std::vector<UpdateTraceConstPtr> UpdateTraceVector;
+
+/**
+ * Bounded history of the most recent view update traces.
+ */
+class UpdateTraceLog
+{
+public:
+	UpdateTraceLog(unsigned int capacity);
+
+	/**
+	 * Add a finished trace, discarding the oldest one if full.
+	 */
+	void add(UpdateTracePtr trace);
+
+	/**
+	 * Get the retained traces, oldest first.
+	 * @param view		Only return traces for this view (all if empty).
+	 * @param result	Receives the traces.
+	 */
+	void get(const std::string& view, UpdateTraceVector& result) const;
+
+	/**
+	 * Write traces in the Chrome trace event format, one complete event
+	 * per update and per phase. Each update is shown as its own thread.
+	 */
+	static void write_chrome_trace(std::ostream& os, const UpdateTraceVector& traces);
+
+private:
+	mutable boost::mutex mutex_;
+	unsigned int capacity_;
+	unsigned long long next_seq_;
+	std::deque<UpdateTraceConstPtr> traces_;
+};
+typedef boost::shared_ptr<UpdateTraceLog> UpdateTraceLogPtr;
+
+#endif
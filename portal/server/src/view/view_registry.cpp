@@ -67,6 +67,13 @@ ViewPtr ViewRegistry::get(const std::string& name, const ReadableLock& lock)
 	return boost::dynamic_pointer_cast<View>(get_child(v_itr->second, lock));
 }
 
+void ViewRegistry::get_names(std::vector<std::string>& result, const ReadableLock& lock) const
+{
+	lock.check_read(get_local_mutex());
+	for (ViewMap::const_iterator itr = views_.begin(); itr != views_.end(); ++itr)
+		result.push_back(itr->first);
+}
+
 bool ViewRegistry::add(const std::string& name, const WritableLock& lock)
 {
 	lock.check_write(get_local_mutex());
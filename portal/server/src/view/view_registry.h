@@ -33,6 +33,7 @@
 #include <boost/shared_ptr.hpp>
 #include <map>
 #include <string>
+#include <vector>
 #include <p4pserver/locking.h>
 #include <p4pserver/dist_obj.h>
 #include <p4pserver/job_queue.h>
@@ -57,6 +58,8 @@ public:
 
 	ViewPtr get(const std::string& name, const ReadableLock& lock);
 
+	void get_names(std::vector<std::string>& result, const ReadableLock& lock) const;
+
 	bool add(const std::string& name, const WritableLock& lock);
 	bool remove(const std::string& name, const WritableLock& lock);
 
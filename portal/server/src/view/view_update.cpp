@@ -29,6 +29,17 @@
 
 #include "view_update.h"
 
+#include "state.h"
+
+/* Drop the responses built from the previous version while the view is
+ * still write-locked, so a request which sees the new version is never
+ * answered from the old one */
+static void invalidate_responses(const View& view, const ReadableLock& lock)
+{
+	if (MAP_RESPONSES)
+		MAP_RESPONSES->invalidate(view.get_name(lock));
+}
+
 unsigned int ViewUpdateDirect::do_update()
 {
 	get_logger().debug("Computing update");
@@ -36,8 +47,12 @@ unsigned int ViewUpdateDirect::do_update()
 		return 0;
 
 	get_logger().debug("Updating matrices");
-	get_view_state().get()->set_intradomain_pdistances(result_intradomain_pdistances_, get_view_state().get_view_lock());
-	get_view_state().get()->set_interdomain_pdistances(result_interdomain_pdistances_, get_view_state().get_view_lock());
+	{
+		UpdateTrace::ScopedPhase phase(*get_trace(), "commit");
+		get_view_state().get()->set_intradomain_pdistances(result_intradomain_pdistances_, get_view_state().get_view_lock());
+		get_view_state().get()->set_interdomain_pdistances(result_interdomain_pdistances_, get_view_state().get_view_lock());
+		invalidate_responses(*get_view_state().get(), get_view_state().get_view_lock());
+	}
 	get_logger().debug("Finished updating matrices");
 
 	return result_update_interval_;
@@ -49,16 +64,28 @@ unsigned int ViewUpdateUpgrade::do_update()
 	if (!compute_result())
 		return 0;
 
+	boost::posix_time::ptime wait_start = boost::posix_time::microsec_clock::universal_time();
 	get_logger().debug("Acquiring locks: global");
 	UpgradedWriteLock global_state_write_lock(global_state_lock_);
+	get_trace()->add_lock_wait("global-write", wait_start);
+
+	wait_start = boost::posix_time::microsec_clock::universal_time();
 	get_logger().debug("Acquiring locks: views");
 	UpgradedWriteLock views_write_lock(views_lock_);
+	get_trace()->add_lock_wait("views-write", wait_start);
+
+	wait_start = boost::posix_time::microsec_clock::universal_time();
 	get_logger().debug("Acquiring locks: view");
 	UpgradedWriteLock view_write_lock(*static_cast<const UpgradableReadLock*>(&get_view_state().get_view_lock()));
+	get_trace()->add_lock_wait("view-write", wait_start);
 
 	get_logger().debug("Updating matrices");
-	get_view_state().get()->set_intradomain_pdistances(result_intradomain_pdistances_, view_write_lock);
-	get_view_state().get()->set_interdomain_pdistances(result_interdomain_pdistances_, view_write_lock);
+	{
+		UpdateTrace::ScopedPhase phase(*get_trace(), "commit");
+		get_view_state().get()->set_intradomain_pdistances(result_intradomain_pdistances_, view_write_lock);
+		get_view_state().get()->set_interdomain_pdistances(result_interdomain_pdistances_, view_write_lock);
+		invalidate_responses(*get_view_state().get(), view_write_lock);
+	}
 	get_logger().debug("Finished updating matrices");
 
 	return result_update_interval_;
@@ -41,6 +41,8 @@
 #include "view.h"
 #include "global_state.h"
 #include "plugin_base.h"
+#include "plugin_compute_job.h"
+#include "update_trace.h"
 
 typedef ViewWrapper<
 		const ReadableLock, const UpgradableReadLock,
@@ -58,6 +60,37 @@ typedef ViewWrapper<
 		const ReadableLock, const BlockReadLock
 	> ViewUpdateStateDirect;
 
+/* Pdistances of single links: the static pdistance if one is defined,
+ * then the dynamic pdistance, then the view's default pid-link pdistance */
+class LinkPDistances
+{
+public:
+	LinkPDistances(const SparsePIDMatrix& static_pdistances, const ReadableLock& static_pdistances_lock,
+		       const SparsePIDMatrix& dynamic_pdistances, const ReadableLock& dynamic_pdistances_lock,
+		       double pidlink_pdistance)
+		: static_pdistances_(static_pdistances), static_pdistances_lock_(static_pdistances_lock),
+		  dynamic_pdistances_(dynamic_pdistances), dynamic_pdistances_lock_(dynamic_pdistances_lock),
+		  pidlink_pdistance_(pidlink_pdistance)
+	{}
+
+	double get(const p4p::PID& e_src, const p4p::PID& e_dst) const
+	{
+		double e_p;
+		if (!std::isnan((e_p = static_pdistances_.get_by_pid(e_src, e_dst, static_pdistances_lock_))))
+			return e_p;
+		if (!std::isnan((e_p = dynamic_pdistances_.get_by_pid(e_src, e_dst, dynamic_pdistances_lock_))))
+			return e_p;
+		return pidlink_pdistance_;
+	}
+
+private:
+	const SparsePIDMatrix& static_pdistances_;
+	const ReadableLock& static_pdistances_lock_;
+	const SparsePIDMatrix& dynamic_pdistances_;
+	const ReadableLock& dynamic_pdistances_lock_;
+	double pidlink_pdistance_;
+};
+
 template <class ViewUpdateState>
 class ViewUpdateBase
 {
@@ -75,11 +108,26 @@ protected:
 		  result_intradomain_pdistances_lock_(*result_intradomain_pdistances_),
 		  result_interdomain_pdistances_(SparsePIDMatrixPtr(new SparsePIDMatrix())),
 		  result_interdomain_pdistances_lock_(*result_interdomain_pdistances_),
-		  result_update_interval_(0)
+		  result_update_interval_(0),
+		  trace_(new UpdateTrace(view_state.get()->get_name(view_state.get_view_lock())))
 	{}
 
 	virtual ~ViewUpdateBase() {}
 
+public:
+	/**
+	 * Get the trace recording timings and counters for this update.
+	 */
+	UpdateTracePtr get_trace() const { return trace_; }
+
+	/**
+	 * Record into an existing trace (e.g., one which already includes
+	 * the time spent acquiring locks).
+	 */
+	void set_trace(UpdateTracePtr trace) { trace_ = trace; }
+
+protected:
+
 	bool compute_result()
 	{
 		result_update_interval_ = view_state_.get()->get_update_interval(view_state_.get_view_lock());
@@ -87,6 +135,7 @@ protected:
 		/* Copy network state; we'll make some local modifications here prior to
 		 * performing the optimizations */
 		{
+			UpdateTrace::ScopedPhase phase(*trace_, "copy");
 			get_logger().info("copying current network state");
 			net_state_ = boost::dynamic_pointer_cast<NetState>(net_state_orig_->copy(net_state_orig_lock_));
 		}
@@ -99,13 +148,17 @@ protected:
 		{
 			get_logger().debug("parsing pids");
 			PinnedPIDSet unagg_pids;
-			find_pids(pids_internal, pids_external, pids_all, unagg_pids);
+			{
+				UpdateTrace::ScopedPhase phase(*trace_, "find-pids");
+				find_pids(pids_internal, pids_external, pids_all, unagg_pids);
+			}
 	
 			get_logger().debug("total pids: %u ", unagg_pids.size());
 			get_logger().debug("internal pids: %u", pids_internal.size());
 			get_logger().debug("external pids: %u", pids_external.size());
 	
 			get_logger().info("aggregating topology");
+			UpdateTrace::ScopedPhase phase(*trace_, "aggregate");
 			if (!aggregate_topology(unagg_pids, pids))
 			{
 				get_logger().error("aggregation failed; cancelling job");
@@ -116,15 +169,21 @@ protected:
 		}
 	
 		get_logger().info("handling unaggregated nodes");
-		handle_extra_nodes(pids);
+		{
+			UpdateTrace::ScopedPhase phase(*trace_, "extra-nodes");
+			handle_extra_nodes(pids);
+		}
 	
 		get_logger().debug("total pids after handling unaggregated nodes: %u", pids.size());
 	
 		get_logger().info("verifying static routing (if applicable)");
-		if (!verify_static_routing(pids))
 		{
-			get_logger().error("static route verification failed; cancelling job");
-			return false;
+			UpdateTrace::ScopedPhase phase(*trace_, "verify-routing");
+			if (!verify_static_routing(pids))
+			{
+				get_logger().error("static route verification failed; cancelling job");
+				return false;
+			}
 		}
 	
 		/* Kick off the optimization */
@@ -133,7 +192,8 @@ protected:
 		if (plugin)
 		{
 			get_logger().info("running optimization");
-			rc = plugin->compute_pdistances(*net_state_, *net_state_lock_, view_state_, pids);
+			UpdateTrace::ScopedPhase phase(*trace_, "plugin:" + view_state_.get()->get_plugin_name(view_state_.get_view_lock()));
+			rc = PluginComputeJob::compute(plugin, net_state_, net_state_lock_, pids);
 		}
 
 		/* Fill in the intradomain pdistances */
@@ -145,12 +205,15 @@ protected:
 		result_interdomain_pdistances_->set_pids(pids_all, result_interdomain_pdistances_lock_);
 	
 		get_logger().info("updating peering pdistances");
-		if (!compute_pdistances(plugin, pids, pids_external,
-				*result_intradomain_pdistances_, result_intradomain_pdistances_lock_,
-				*result_interdomain_pdistances_, result_interdomain_pdistances_lock_))
 		{
-			get_logger().error("peering pdistance computation failed; cancelling job");
-			return false;
+			UpdateTrace::ScopedPhase phase(*trace_, "pdistances");
+			if (!compute_pdistances(plugin, pids, pids_external,
+					*result_intradomain_pdistances_, result_intradomain_pdistances_lock_,
+					*result_interdomain_pdistances_, result_interdomain_pdistances_lock_))
+			{
+				get_logger().error("peering pdistance computation failed; cancelling job");
+				return false;
+			}
 		}
 	
 		/* Update the pdistances matrix for the view if it was successful */
@@ -225,14 +288,14 @@ private:
 			 * descriptors we find.
 			 */
 			bool is_internal = true;
-			BOOST_FOREACH(const NetVertexName& v_name, view_loc.vertices)
+			BOOST_FOREACH(NetVertexNameId v_name, view_loc.vertices)
 			{
 				NetVertex v;
 				if (!net_state_->get_node(v_name, v, *net_state_lock_))
 				{
 					std::string pid_str = boost::lexical_cast<std::string>(view_loc.pid);
 					get_logger().warn("omitting node %s for pid %s since it doesn't exist in topology",
-						v_name.c_str(), pid_str.c_str());
+						get_vertex_names().get(v_name).c_str(), pid_str.c_str());
 					continue;
 				}
 	
@@ -393,6 +456,13 @@ private:
 		double pidlink_pdistance		= view_state_.get()->get_default_pidlink_pdistance(view_state_.get_view_lock());
 		bool interdomain_includes_intra		= view_state_.get()->get_interdomain_includes_intradomain(view_state_.get_view_lock());
 
+		LinkPDistances link_pdistances(static_pdistances, static_pdistances_lock, *dynamic_pdistances, dynamic_pdistances_lock, pidlink_pdistance);
+
+		/* Counters reported in the update trace */
+		unsigned long long route_computations = 0;
+		unsigned long long routes = 0;
+		unsigned long long cells = 0;
+
 		/* Fill in entries of the interdomain pdistance matrix */
 		get_logger().info("computing interdomain pdistances for view");
 		p4p::PIDLinkVector interdomain_links;
@@ -401,6 +471,7 @@ private:
 		BOOST_FOREACH(const p4p::PIDLink& link, interdomain_links)
 		{
 			double e_p;
+			++cells;
 	
 			if (get_logger().isDebugEnabled())
 				get_logger().debug("computing pdistance for %s->%s", PIDCStr(link.first), PIDCStr(link.second));
@@ -433,6 +504,25 @@ private:
 		const PIDMatrixPIDsByIdx& intradomain_pdistances_pids = intradomain_pdistances.get_pids_vector(intradomain_pdistances_lock);
 		PIDRouting::RouteComputationContext route_context;
 
+		/* With multipath routing, traffic is split over all shortest paths;
+		 * fall back to single paths if they can't be computed */
+		if (intradomain_routing.get_route_mode(intradomain_routing_lock) == PIDRouting::RM_ECMP)
+		{
+			get_logger().info("computing multipath pdistances");
+			if (compute_multipath_pdistances(pids, link_pdistances, route_context,
+						intradomain_pdistances, intradomain_pdistances_lock,
+						interdomain_pdistances, interdomain_pdistances_lock,
+						route_computations, routes, cells))
+			{
+				trace_->count("route_computations", route_computations);
+				trace_->count("routes", routes);
+				trace_->count("cells_written", cells);
+				return true;
+			}
+			get_logger().warn("multipath routing requires positive link weights; using single paths");
+			route_context = PIDRouting::RouteComputationContext();
+		}
+
 		get_logger().info("computing pdistances from intradomain pids");
 		BOOST_FOREACH(const IndexedPID& l_src, intradomain_pdistances_pids)
 		{
@@ -442,12 +532,16 @@ private:
 						pids,
 						route_context,
 						intradomain_routing_lock);
+			++route_computations;
+			routes += route_context.get_result().size();
 
 			/* Fill in pdistances to all other intradomain PIDs */
 			BOOST_FOREACH(const IndexedPID& l_dst, intradomain_pdistances_pids)
 			{
 				if (get_logger().isDebugEnabled())
 					get_logger().debug("computing intradomain pdistance for %s->%s", PIDCStr(l_src), PIDCStr(l_dst));
+
+				++cells;
 	
 				if (l_src.get_index() == l_dst.get_index())
 				{
@@ -467,34 +561,16 @@ private:
 					continue;
 				}
 	
-				/* Trace along the route and compute the pdistance */
-				const PIDRouting::PinnedRoute& route = route_itr->second;
+				/* Trace along the route and compute the pdistance, weighing
+				 * each route by its share if traffic is split between several */
 				double p = 0.0;
-				for (unsigned int hop = 1; hop < route.size(); ++hop)
+				PIDRouting::PinnedRouteSplitMap::const_iterator split_itr = route_context.get_splits().find(PinnedPID(l_dst, NULL));
+				if (split_itr == route_context.get_splits().end())
+					p = get_route_pdistance(route_itr->second, link_pdistances);
+				else
 				{
-					const p4p::PID&  e_src = route.at(hop-1);
-					const p4p::PID&  e_dst = route.at(hop);
-					double e_p;
-	
-					if (get_logger().isDebugEnabled())
-						get_logger().debug("tracing link %s->%s", PIDCStr(e_src), PIDCStr(e_dst));
-	
-					/* Use static pdistance if one is defined */
-					if (!std::isnan((e_p = static_pdistances.get_by_pid(e_src, e_dst, static_pdistances_lock))))
-					{
-						p += e_p;
-						continue;
-					}
-	
-					/* Next try the dynamic edge pdistance */
-					if (!std::isnan((e_p = dynamic_pdistances->get_by_pid(e_src, e_dst, dynamic_pdistances_lock))))
-					{
-						p += e_p;
-						continue;
-					}
-	
-					/* Fall back to the view's default pid-link pdistance */
-					p += pidlink_pdistance;
+					for (unsigned int i = 0; i < split_itr->second.size(); ++i)
+						p += split_itr->second[i].second * get_route_pdistance(split_itr->second[i].first, link_pdistances);
 				}
 				get_logger().debug("using pdistance: %lf", p);
 				intradomain_pdistances.set(l_src, l_dst, p, intradomain_pdistances_lock);
@@ -515,37 +591,27 @@ private:
 
 				double pdistance = interdomain_pdistance;
 
-				/* Dummy loop allows some cleaner code below by allowing us to use 'break' */
-				do
+				/* Find route from intradomain PID ('l_src') to interdomain ('l_inter'). */
+				PIDRouting::PinnedRouteMap::const_iterator route_itr = route_context.get_result().find(PinnedPID(l_inter, NULL));
+				PIDRouting::PinnedRouteSplitMap::const_iterator split_itr = route_context.get_splits().find(PinnedPID(l_inter, NULL));
+				if (route_itr == route_context.get_result().end())
+					get_logger().debug("no route; using default interdomain pdistance");
+				else if (split_itr == route_context.get_splits().end())
+					get_outbound_pdistance(route_itr->second, intradomain_pdistances, intradomain_pdistances_lock, interdomain_pdistances, interdomain_pdistances_lock, interdomain_includes_intra, pdistance);
+				else
 				{
-					/* Find route from intradomain PID ('l_src') to interdomain ('l_inter'). */
-					PIDRouting::PinnedRouteMap::const_iterator route_itr = route_context.get_result().find(PinnedPID(l_inter, NULL));
-					if (route_itr == route_context.get_result().end())
+					pdistance = 0.0;
+					for (unsigned int i = 0; i < split_itr->second.size(); ++i)
 					{
-						get_logger().debug("no route; using default interdomain pdistance");
-						break;
+						double p = interdomain_pdistance;
+						get_outbound_pdistance(split_itr->second[i].first, intradomain_pdistances, intradomain_pdistances_lock, interdomain_pdistances, interdomain_pdistances_lock, interdomain_includes_intra, p);
+						pdistance += split_itr->second[i].second * p;
 					}
-
-					/* Find egress PID. This is the next-to-last hop of the path */
-					const PIDRouting::PinnedRoute& route = route_itr->second;
-					PIDRouting::PinnedRoute::const_reverse_iterator hop_itr = route.rbegin();
-					if (++hop_itr == route.rend())
-					{
-						get_logger().debug("route has length 1; using default interdomain pdistance");
-						break;
-					}
-					const PinnedPID& p_egress = *hop_itr;
-
-					/* Start off with the cost of the egress link */
-					pdistance = interdomain_pdistances.get_by_pid(p_egress, l_inter, interdomain_pdistances_lock);
-
-					/* Include the intradomain pdistance if configured to do so */
-					if (interdomain_includes_intra)
-						pdistance += intradomain_pdistances.get_by_pid(l_src, p_egress, intradomain_pdistances_lock);
-				} while (0);
+				}
 
 				/* Set the cost */
 				get_logger().debug("using pdistance: %lf", pdistance);
+				++cells;
 				interdomain_pdistances.set_by_pid(l_src, l_inter, pdistance, interdomain_pdistances_lock);
 			}
 
@@ -565,6 +631,8 @@ private:
 						pids,
 						route_context,
 						intradomain_routing_lock);
+			++route_computations;
+			routes += route_context.get_result().size();
 
 			/* Fill in pdistances to each intradomain PID */
 			BOOST_FOREACH(const IndexedPID& l_intra, intradomain_pdistances_pids)
@@ -581,41 +649,283 @@ private:
 
 				double pdistance = interdomain_pdistance;
 
-				do
+				/* Find route from interdomain PID ('l_src') to intradomain ('l_intra'). */
+				PIDRouting::PinnedRouteMap::const_iterator route_itr = route_context.get_result().find(PinnedPID(l_intra, NULL));
+				PIDRouting::PinnedRouteSplitMap::const_iterator split_itr = route_context.get_splits().find(PinnedPID(l_intra, NULL));
+				if (route_itr == route_context.get_result().end())
+					get_logger().debug("no route; using default interdomain pdistance");
+				else if (split_itr == route_context.get_splits().end())
+					get_inbound_pdistance(route_itr->second, intradomain_pdistances, intradomain_pdistances_lock, interdomain_pdistances, interdomain_pdistances_lock, interdomain_includes_intra, pdistance);
+				else
 				{
-					/* Find route from interdomain PID ('l_src') to intradomain ('l_intra'). */
-					PIDRouting::PinnedRouteMap::const_iterator route_itr = route_context.get_result().find(PinnedPID(l_intra, NULL));
-					if (route_itr == route_context.get_result().end())
+					pdistance = 0.0;
+					for (unsigned int i = 0; i < split_itr->second.size(); ++i)
 					{
-						get_logger().debug("no route; using default interdomain pdistance");
-						break;
+						double p = interdomain_pdistance;
+						get_inbound_pdistance(split_itr->second[i].first, intradomain_pdistances, intradomain_pdistances_lock, interdomain_pdistances, interdomain_pdistances_lock, interdomain_includes_intra, p);
+						pdistance += split_itr->second[i].second * p;
 					}
+				}
 
-					/* Find egress PID. This is the second hop of the path */
-					const PIDRouting::PinnedRoute& route = route_itr->second;
-					PIDRouting::PinnedRoute::const_iterator hop_itr = route.begin();
-					if (++hop_itr == route.end())
-					{
-						get_logger().debug("route has length 1; using default interdomain pdistance");
-						break;
-					}
-					const PinnedPID& p_egress = *hop_itr;
+				get_logger().debug("using pdistance: %lf", pdistance);
+				++cells;
+				interdomain_pdistances.set_by_pid(l_src, l_intra, pdistance, interdomain_pdistances_lock);
+			}
 
-					/* Start off with the cost of the egress link */
-					pdistance = interdomain_pdistances.get_by_pid(l_src, p_egress, interdomain_pdistances_lock);
+		}
 
-					/* Include the intradomain pdistance if configured to do so */
-					if (interdomain_includes_intra)
-						pdistance += intradomain_pdistances.get_by_pid(p_egress, l_intra, intradomain_pdistances_lock);
+		trace_->count("route_computations", route_computations);
+		trace_->count("routes", routes);
+		trace_->count("cells_written", cells);
 
-				} while (0);
+		return true;
+	}
 
-				get_logger().debug("using pdistance: %lf", pdistance);
-				interdomain_pdistances.set_by_pid(l_src, l_intra, pdistance, interdomain_pdistances_lock);
-			}
+	double get_route_pdistance(const PIDRouting::PinnedRoute& route, const LinkPDistances& link_pdistances) const
+	{
+		double p = 0.0;
+		for (unsigned int hop = 1; hop < route.size(); ++hop)
+		{
+			if (get_logger().isDebugEnabled())
+				get_logger().debug("tracing link %s->%s", PIDCStr(route[hop-1]), PIDCStr(route[hop]));
 
+			p += link_pdistances.get(route[hop-1], route[hop]);
+		}
+		return p;
+	}
+
+	/* Pdistance along a route leaving the domain: the cost of the egress
+	 * link (from the next-to-last hop), plus the intradomain pdistance to
+	 * the egress PID if configured. Returns false (leaving 'result'
+	 * unchanged) if the route is too short. */
+	bool get_outbound_pdistance(const PIDRouting::PinnedRoute& route,
+				    const PIDMatrix& intradomain_pdistances, const ReadableLock& intradomain_pdistances_lock,
+				    const SparsePIDMatrix& interdomain_pdistances, const ReadableLock& interdomain_pdistances_lock,
+				    bool interdomain_includes_intra, double& result) const
+	{
+		PIDRouting::PinnedRoute::const_reverse_iterator hop_itr = route.rbegin();
+		if (++hop_itr == route.rend())
+		{
+			get_logger().debug("route has length 1; using default interdomain pdistance");
+			return false;
 		}
+		const PinnedPID& p_egress = *hop_itr;
 
+		/* Start off with the cost of the egress link */
+		result = interdomain_pdistances.get_by_pid(p_egress, route.back(), interdomain_pdistances_lock);
+
+		/* Include the intradomain pdistance if configured to do so */
+		if (interdomain_includes_intra)
+			result += intradomain_pdistances.get_by_pid(route.front(), p_egress, intradomain_pdistances_lock);
+		return true;
+	}
+
+	/* Pdistance along a route entering the domain: the cost of the ingress
+	 * link (to the second hop), plus the intradomain pdistance from there
+	 * if configured. */
+	bool get_inbound_pdistance(const PIDRouting::PinnedRoute& route,
+				   const PIDMatrix& intradomain_pdistances, const ReadableLock& intradomain_pdistances_lock,
+				   const SparsePIDMatrix& interdomain_pdistances, const ReadableLock& interdomain_pdistances_lock,
+				   bool interdomain_includes_intra, double& result) const
+	{
+		PIDRouting::PinnedRoute::const_iterator hop_itr = route.begin();
+		if (++hop_itr == route.end())
+		{
+			get_logger().debug("route has length 1; using default interdomain pdistance");
+			return false;
+		}
+		const PinnedPID& p_egress = *hop_itr;
+
+		/* Start off with the cost of the egress link */
+		result = interdomain_pdistances.get_by_pid(route.front(), p_egress, interdomain_pdistances_lock);
+
+		/* Include the intradomain pdistance if configured to do so */
+		if (interdomain_includes_intra)
+			result += intradomain_pdistances.get_by_pid(p_egress, route.back(), intradomain_pdistances_lock);
+		return true;
+	}
+
+	/*
+	 * Compute all pdistances with traffic split evenly between equal-cost
+	 * next hops (RM_ECMP). Rather than enumerating the shortest paths,
+	 * which grow exponentially in topologies with many parallel links,
+	 * expected pdistances are accumulated over the shortest-path DAG toward
+	 * each destination, nearest vertex first, so each destination costs
+	 * time linear in the size of the topology.
+	 *
+	 * Returns false without changing any pdistances if multipath routes
+	 * can't be computed.
+	 */
+	bool compute_multipath_pdistances(const PinnedPIDSet& pids, const LinkPDistances& link_pdistances,
+				    PIDRouting::RouteComputationContext& route_context,
+				    PIDMatrix& intradomain_pdistances, const WritableLock& intradomain_pdistances_lock,
+				    SparsePIDMatrix& interdomain_pdistances, const WritableLock& interdomain_pdistances_lock,
+				    unsigned long long& route_computations, unsigned long long& routes, unsigned long long& cells) const
+	{
+		const PIDRouting& intradomain_routing		= *view_state_.get()->get_intradomain_routing(view_state_.get_view_lock());
+		const ReadableLock& intradomain_routing_lock	= view_state_.get_intradomain_routing_lock();
+
+		double intrapid_pdistance		= view_state_.get()->get_default_intrapid_pdistance(view_state_.get_view_lock());
+		double interpid_pdistance		= view_state_.get()->get_default_interpid_pdistance(view_state_.get_view_lock());
+		double interdomain_pdistance		= view_state_.get()->get_default_interdomain_pdistance(view_state_.get_view_lock());
+		bool interdomain_includes_intra		= view_state_.get()->get_interdomain_includes_intradomain(view_state_.get_view_lock());
+
+		const PIDMatrixPIDsByIdx& intradomain_pids = intradomain_pdistances.get_pids_vector(intradomain_pdistances_lock);
+		std::vector<IndexedPID> interdomain_pids;
+		BOOST_FOREACH(const IndexedPID& pid, interdomain_pdistances.get_pids_vector(interdomain_pdistances_lock))
+		{
+			if (pid.get_external())
+				interdomain_pids.push_back(pid);
+		}
+
+		/* PID of each vertex index, and vertex index of each pid; filled in
+		 * with the first destination */
+		std::vector<p4p::PID> vert_pids;
+		std::vector<unsigned int> intradomain_verts(intradomain_pids.size());
+		std::vector<unsigned int> interdomain_verts(interdomain_pids.size());
+
+		/* Per-vertex values accumulated toward the current destination */
+		std::vector<double> cost;
+		std::vector<double> egress_cost;
+		std::vector<double> intra_cost;
+		std::vector<double> direct;
+		std::vector<char> reached;
+
+		for (unsigned int d = 0; d < intradomain_pids.size() + interdomain_pids.size(); ++d)
+		{
+			bool external = d >= intradomain_pids.size();
+			const IndexedPID& l_dst = external ? interdomain_pids[d - intradomain_pids.size()] : intradomain_pids[d];
+
+			if (!intradomain_routing.get_multipath(*pids.find(PinnedPID(l_dst, NULL)),
+						*net_state_, *net_state_lock_,
+						route_context,
+						intradomain_routing_lock))
+			{
+				if (d == 0)
+					return false;
+				throw std::runtime_error("Illegal state: multipath routes failed after the first destination");
+			}
+			++route_computations;
+
+			const std::vector<unsigned int>& order = route_context.get_multipath_order();
+			routes += order.size() - 1;
+
+			if (d == 0)
+			{
+				BOOST_FOREACH(const NetVertex& v, net_state_->get_nodes(*net_state_lock_))
+				{
+					unsigned int v_idx;
+					if (!route_context.get_vertex_index(v, v_idx))
+						throw std::runtime_error("Illegal state: vertex missing from route computation");
+					if (v_idx >= vert_pids.size())
+						vert_pids.resize(v_idx + 1);
+					vert_pids[v_idx] = net_state_->get_pid(v, *net_state_lock_);
+				}
+				for (unsigned int i = 0; i < intradomain_pids.size(); ++i)
+					route_context.get_vertex_index(pids.find(PinnedPID(intradomain_pids[i], NULL))->get_vertex(), intradomain_verts[i]);
+				for (unsigned int i = 0; i < interdomain_pids.size(); ++i)
+					route_context.get_vertex_index(pids.find(PinnedPID(interdomain_pids[i], NULL))->get_vertex(), interdomain_verts[i]);
+
+				cost.resize(vert_pids.size());
+				egress_cost.resize(vert_pids.size());
+				intra_cost.resize(vert_pids.size());
+				direct.resize(vert_pids.size());
+			}
+
+			unsigned int dst_idx = order.front();
+			reached.assign(vert_pids.size(), 0);
+
+			if (!external)
+			{
+				/* Expected pdistance from each vertex to the destination */
+				BOOST_FOREACH(unsigned int x, order)
+				{
+					reached[x] = 1;
+					double c = 0.0;
+					PIDRouting::MultipathHopRange hops = route_context.get_multipath_hops(x);
+					for (PIDRouting::MultipathHopVector::const_iterator h = hops.first; h != hops.second; ++h)
+						c += h->fraction * (link_pdistances.get(vert_pids[x], vert_pids[h->vertex]) + cost[h->vertex]);
+					cost[x] = c;
+				}
+
+				for (unsigned int s = 0; s < intradomain_pids.size(); ++s)
+				{
+					unsigned int x = intradomain_verts[s];
+					double p = (x == dst_idx) ? intrapid_pdistance : (reached[x] ? cost[x] : interpid_pdistance);
+					intradomain_pdistances.set(intradomain_pids[s], l_dst, p, intradomain_pdistances_lock);
+					++cells;
+				}
+
+				/* From interdomain PIDs: the ingress link, then on to the destination */
+				for (unsigned int s = 0; s < interdomain_pids.size(); ++s)
+				{
+					const IndexedPID& l_src = interdomain_pids[s];
+					if (!std::isnan(interdomain_pdistances.get_by_pid(l_src, l_dst, interdomain_pdistances_lock)))
+						continue;
+
+					unsigned int x = interdomain_verts[s];
+					PIDRouting::MultipathHopRange hops = route_context.get_multipath_hops(x);
+					double p = interdomain_pdistance;
+					if (reached[x] && hops.first != hops.second)
+					{
+						p = 0.0;
+						for (PIDRouting::MultipathHopVector::const_iterator h = hops.first; h != hops.second; ++h)
+						{
+							double hop_p = interdomain_pdistances.get_by_pid(l_src, vert_pids[h->vertex], interdomain_pdistances_lock);
+							if (interdomain_includes_intra)
+								hop_p += (h->vertex == dst_idx) ? intrapid_pdistance : cost[h->vertex];
+							p += h->fraction * hop_p;
+						}
+					}
+					interdomain_pdistances.set_by_pid(l_src, l_dst, p, interdomain_pdistances_lock);
+					++cells;
+				}
+			}
+			else
+			{
+				/* Expected cost of the egress link toward the destination, the
+				 * expected intradomain pdistance to the egress PID, and the
+				 * share of traffic leaving directly from each vertex */
+				BOOST_FOREACH(unsigned int x, order)
+				{
+					reached[x] = 1;
+					double e_c = 0.0, i_c = 0.0, dir = 0.0;
+					PIDRouting::MultipathHopRange hops = route_context.get_multipath_hops(x);
+					for (PIDRouting::MultipathHopVector::const_iterator h = hops.first; h != hops.second; ++h)
+					{
+						if (h->vertex == dst_idx)
+						{
+							e_c += h->fraction * interdomain_pdistances.get_by_pid(vert_pids[x], l_dst, interdomain_pdistances_lock);
+							dir += h->fraction;
+							continue;
+						}
+						e_c += h->fraction * egress_cost[h->vertex];
+						i_c += h->fraction * (link_pdistances.get(vert_pids[x], vert_pids[h->vertex]) + intra_cost[h->vertex]);
+					}
+					egress_cost[x] = e_c;
+					intra_cost[x] = i_c;
+					direct[x] = dir;
+				}
+
+				for (unsigned int s = 0; s < intradomain_pids.size(); ++s)
+				{
+					const IndexedPID& l_src = intradomain_pids[s];
+					if (!std::isnan(interdomain_pdistances.get_by_pid(l_src, l_dst, interdomain_pdistances_lock)))
+						continue;
+
+					unsigned int x = intradomain_verts[s];
+					double p = interdomain_pdistance;
+					if (reached[x])
+					{
+						p = egress_cost[x];
+						if (interdomain_includes_intra)
+							p += intra_cost[x] + direct[x] * intrapid_pdistance;
+					}
+					interdomain_pdistances.set_by_pid(l_src, l_dst, p, interdomain_pdistances_lock);
+					++cells;
+				}
+			}
+		}
 		return true;
 	}
 
@@ -641,6 +951,8 @@ protected:
 
 	unsigned int				result_update_interval_;
 
+	UpdateTracePtr				trace_;
+
 };
 
 class ViewUpdateDirect : public ViewUpdateBase<ViewUpdateStateDirect>
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+#include "json_scanner.h"
+#include "post_filters.h"
+
+/* Scan a whole body; true if it holds exactly one valid value */
+static bool scanAll(const std::string& text)
+{
+	std::string body(text);
+	JsonScanner scanner(body);
+	return scanner.skipValue(scanner.next()) && scanner.next() == JsonScanner::T_END;
+}
+
+/* Decode a single string value */
+static bool scanString(const std::string& text, std::string& result)
+{
+	std::string body(text);
+	JsonScanner scanner(body);
+	if (scanner.next() != JsonScanner::T_STRING)
+		return false;
+	result.assign(scanner.getString(), scanner.getLength());
+	return scanner.next() == JsonScanner::T_END;
+}
+
+BOOST_AUTO_TEST_CASE ( json_scanner_string_escapes )
+{
+	std::string s;
+	BOOST_REQUIRE(scanString("\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\"", s));
+	BOOST_CHECK_EQUAL(s, "a\"b\\c/d\b\f\n\r\t");
+
+	BOOST_REQUIRE(scanString("\"\\u0041\\u00e9\\u20AC\"", s));
+	BOOST_CHECK_EQUAL(s, "A\xc3\xa9\xe2\x82\xac");
+
+	/* Surrogate pairs become one 4-byte sequence */
+	BOOST_REQUIRE(scanString("\"\\ud83d\\ude00\"", s));
+	BOOST_CHECK_EQUAL(s, "\xf0\x9f\x98\x80");
+
+	BOOST_REQUIRE(scanString("\"\"", s));
+	BOOST_CHECK(s.empty());
+
+	BOOST_CHECK(!scanString("\"\\x\"", s));
+	BOOST_CHECK(!scanString("\"\\u12g4\"", s));
+	BOOST_CHECK(!scanString("\"\\u12\"", s));
+	BOOST_CHECK(!scanString("\"\\ud83d\\uzzzz\"", s));
+	BOOST_CHECK(!scanString("\"tab\there\"", s));
+	BOOST_CHECK(!scanString("\"unterminated", s));
+	BOOST_CHECK(!scanString("\"trailing\\", s));
+}
+
+BOOST_AUTO_TEST_CASE ( json_scanner_numbers )
+{
+	BOOST_CHECK(scanAll("0"));
+	BOOST_CHECK(scanAll("-0"));
+	BOOST_CHECK(scanAll("[12, -3.25, 1e10, 1.5E+3, 2e-2]"));
+
+	BOOST_CHECK(!scanAll("01"));
+	BOOST_CHECK(!scanAll("[01]"));
+	BOOST_CHECK(!scanAll("-"));
+	BOOST_CHECK(!scanAll("+1"));
+	BOOST_CHECK(!scanAll(".5"));
+	BOOST_CHECK(!scanAll("1."));
+	BOOST_CHECK(!scanAll("1e"));
+	BOOST_CHECK(!scanAll("1e+"));
+	BOOST_CHECK(!scanAll("[1.e3]"));
+	BOOST_CHECK(!scanAll("[0x10]"));
+}
+
+BOOST_AUTO_TEST_CASE ( json_scanner_depth_limit )
+{
+	const size_t depth = 64;
+	BOOST_CHECK(scanAll(std::string(depth, '[') + std::string(depth, ']')));
+	BOOST_CHECK(!scanAll(std::string(depth + 1, '[') + std::string(depth + 1, ']')));
+
+	std::string objects;
+	for (size_t i = 0; i < depth; i++)
+		objects += "{\"a\":";
+	BOOST_CHECK(scanAll(objects + "1" + std::string(depth, '}')));
+	BOOST_CHECK(!scanAll("{\"a\":" + objects + "1" + std::string(depth + 1, '}')));
+}
+
+BOOST_AUTO_TEST_CASE ( json_scanner_trailing_garbage )
+{
+	BOOST_CHECK(scanAll("{\"a\": [1, true, null]} \r\n\t"));
+	BOOST_CHECK(!scanAll("{\"a\": 1} x"));
+	BOOST_CHECK(!scanAll("{\"a\": 1}{}"));
+	BOOST_CHECK(!scanAll("[1] 2"));
+	BOOST_CHECK(!scanAll("{\"a\": 1,}"));
+	BOOST_CHECK(!scanAll("[1,]"));
+	BOOST_CHECK(!scanAll("{\"a\" 1}"));
+	BOOST_CHECK(!scanAll("[tru]"));
+	BOOST_CHECK(!scanAll("{\"a\": 1"));
+	BOOST_CHECK(!scanAll(""));
+}
+
+static ALTOErrorCode readPIDSet(const std::string& text)
+{
+	std::string body(text);
+	JsonPIDSet filter;
+	return filter.readJson(body);
+}
+
+static ALTOErrorCode readPIDMatrix(const std::string& text)
+{
+	std::string body(text);
+	JsonPIDMatrix filter;
+	return filter.readJson(body);
+}
+
+/* The codes are those the DOM reader used to return for the same bodies */
+BOOST_AUTO_TEST_CASE ( json_post_filter_error_priority )
+{
+	BOOST_CHECK_EQUAL(readPIDSet("{\"pids\": [\"a\"]}"), E_OK);
+	BOOST_CHECK_EQUAL(readPIDSet("{}"), E_JSON_FIELD_MISSING);
+	BOOST_CHECK_EQUAL(readPIDSet("{\"pids\": \"a\"}"), E_JSON_VALUE_TYPE);
+	BOOST_CHECK_EQUAL(readPIDSet("[\"a\"]"), E_SYNTAX);
+
+	/* Syntax errors come first, even after a missing or mistyped field */
+	BOOST_CHECK_EQUAL(readPIDSet("{\"other\": 1"), E_SYNTAX);
+	BOOST_CHECK_EQUAL(readPIDSet("{\"pids\": 1} x"), E_SYNTAX);
+
+	const std::string mode = "\"cost-mode\": \"numerical\", ";
+	const std::string type = "\"cost-type\": \"routingcost\", ";
+	BOOST_CHECK_EQUAL(readPIDMatrix("{" + mode + type + "\"pids\": {\"srcs\": [], \"dsts\": []}}"), E_OK);
+
+	/* Fields are checked in order: cost-mode, cost-type, pids, constraints, srcs, dsts */
+	BOOST_CHECK_EQUAL(readPIDMatrix("{" + type + "\"cost-mode\": 1}"), E_JSON_VALUE_TYPE);
+	BOOST_CHECK_EQUAL(readPIDMatrix("{\"cost-type\": 1, \"pids\": 1}"), E_JSON_FIELD_MISSING);
+	BOOST_CHECK_EQUAL(readPIDMatrix("{" + mode + "\"pids\": {}}"), E_JSON_FIELD_MISSING);
+	BOOST_CHECK_EQUAL(readPIDMatrix("{" + mode + type + "\"pids\": []}"), E_JSON_VALUE_TYPE);
+	BOOST_CHECK_EQUAL(readPIDMatrix("{" + mode + type + "\"pids\": {\"srcs\": []}, \"constraints\": 1}"), E_JSON_VALUE_TYPE);
+	BOOST_CHECK_EQUAL(readPIDMatrix("{" + mode + type + "\"pids\": {\"srcs\": []}}"), E_JSON_FIELD_MISSING);
+	BOOST_CHECK_EQUAL(readPIDMatrix("{" + mode + type + "\"pids\": {\"srcs\": 1}}"), E_JSON_VALUE_TYPE);
+	BOOST_CHECK_EQUAL(readPIDMatrix("{" + mode + type + "\"pids\": {\"srcs\": [], \"dsts\": {}}}"), E_JSON_VALUE_TYPE);
+	BOOST_CHECK_EQUAL(readPIDMatrix("{" + mode + type + "\"pids\": {\"srcs\": []}, \"constraints\": 1"), E_SYNTAX);
+}
+
+BOOST_AUTO_TEST_CASE ( json_post_filter_names )
+{
+	std::string body = "{\"cost-mode\": \"numerical\", \"cost-type\": \"routingcost\", "
+			   "\"pids\": {\"srcs\": [\"b\", \"a\\u0062\", \"a\"], \"dsts\": [\"c\"]}, \"constraints\": [\"le5\", \"gt1\"]}";
+	JsonPIDMatrix filter;
+	BOOST_REQUIRE_EQUAL(filter.readJson(body), E_OK);
+	BOOST_CHECK_EQUAL(filter.getCostMode(), "numerical");
+	BOOST_CHECK_EQUAL(filter.getCostType(), "routingcost");
+
+	/* Names come out sorted and without duplicates */
+	JsonNameSet& srcs = filter.getPIDSrcs();
+	BOOST_REQUIRE_EQUAL(srcs.size(), 3u);
+	BOOST_CHECK_EQUAL(std::string(srcs[0], srcs.getLength(0)), "a");
+	BOOST_CHECK_EQUAL(std::string(srcs[1], srcs.getLength(1)), "ab");
+	BOOST_CHECK_EQUAL(std::string(srcs[2], srcs.getLength(2)), "b");
+	BOOST_CHECK(filter.getPIDDsts().contains("c"));
+	BOOST_CHECK(!filter.getPIDDsts().contains("a"));
+
+	BOOST_CHECK(filter.hasConstraints());
+	BOOST_CHECK(filter.inConstraints(5.0));
+	BOOST_CHECK(!filter.inConstraints(5.5));
+	BOOST_CHECK(!filter.inConstraints(1.0));
+}
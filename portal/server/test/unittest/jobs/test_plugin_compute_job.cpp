@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include "options.h"
+#include "state.h"
+#include "plugin_compute_job.h"
+
+class GatedPluginDescriptor : public OptPluginDescriptor
+{
+public:
+	virtual std::string get_name() const { return "unittest-gated"; }
+	virtual std::string get_description() const { return "Computation held until released by the test"; }
+	virtual OptPluginBasePtr create_instance() { return OptPluginBasePtr(); }
+};
+
+static GatedPluginDescriptor GATED_PLUGIN_DESCRIPTOR;
+
+/* Plugin whose computations wait while its gate is closed */
+class GatedPlugin : public OptPluginBase
+{
+public:
+	GatedPlugin(int rc = 7)
+		: OptPluginBase(&GATED_PLUGIN_DESCRIPTOR),
+		  rc_(rc), open_(true), calls_(0), running_(0)
+	{}
+
+	virtual int compute_pdistances(const NetState& state, const ReadableLock& state_lock,
+				       const PinnedPIDSet& pids)
+	{
+		boost::mutex::scoped_lock l(mutex_);
+		++calls_;
+		++running_;
+		cond_.notify_all();
+		while (!open_)
+			cond_.wait(l);
+		--running_;
+		return rc_;
+	}
+
+	void close()
+	{
+		boost::mutex::scoped_lock l(mutex_);
+		open_ = false;
+	}
+
+	void open()
+	{
+		boost::mutex::scoped_lock l(mutex_);
+		open_ = true;
+		cond_.notify_all();
+	}
+
+	/* Wait until a computation is held at the gate */
+	void wait_running()
+	{
+		boost::mutex::scoped_lock l(mutex_);
+		while (!running_)
+			cond_.wait(l);
+	}
+
+	unsigned int calls()
+	{
+		boost::mutex::scoped_lock l(mutex_);
+		return calls_;
+	}
+
+private:
+	int rc_;
+	boost::mutex mutex_;
+	boost::condition_variable cond_;
+	bool open_;
+	unsigned int calls_;
+	unsigned int running_;
+};
+
+typedef boost::shared_ptr<GatedPlugin> GatedPluginPtr;
+
+/* A single plugin thread, and an empty network state to compute on */
+struct PluginComputeJobFixture
+{
+	PluginComputeJobFixture()
+		: state(new NetState()),
+		  state_lock(new BlockWriteLock(*state))
+	{
+		set_budget(50);
+		PLUGIN_QUEUE = JobQueuePtr(new JobQueue(1));
+		PLUGIN_QUEUE->start();
+	}
+
+	~PluginComputeJobFixture()
+	{
+		if (PLUGIN_QUEUE)
+		{
+			PLUGIN_QUEUE->stop();
+			PLUGIN_QUEUE->join();
+		}
+		PLUGIN_QUEUE.reset();
+		OPTIONS.erase("plugin-budget");
+		OPTIONS.erase("plugin-time-budget");
+	}
+
+	void set_budget(unsigned int ms)
+	{
+		OPTIONS.erase("plugin-budget");
+		OPTIONS.insert(std::make_pair(std::string("plugin-budget"),
+					      boost::program_options::variable_value(boost::any(ms), false)));
+	}
+
+	int compute(GatedPluginPtr plugin)
+	{
+		return PluginComputeJob::compute(plugin, state, state_lock, PinnedPIDSet());
+	}
+
+	NetStatePtr state;
+	boost::shared_ptr<WritableLock> state_lock;
+};
+
+BOOST_FIXTURE_TEST_CASE ( plugin_compute_returns_rc, PluginComputeJobFixture )
+{
+	GatedPluginPtr plugin(new GatedPlugin(7));
+
+	/* Inline without a plugin queue */
+	JobQueuePtr queue = PLUGIN_QUEUE;
+	PLUGIN_QUEUE.reset();
+	BOOST_CHECK_EQUAL(compute(plugin), 7);
+	PLUGIN_QUEUE = queue;
+
+	/* Each finished computation lets the next one in */
+	BOOST_CHECK_EQUAL(compute(plugin), 7);
+	BOOST_CHECK_EQUAL(compute(plugin), 7);
+	BOOST_CHECK_EQUAL(plugin->calls(), 3u);
+}
+
+BOOST_FIXTURE_TEST_CASE ( plugin_compute_timeout_fallback, PluginComputeJobFixture )
+{
+	GatedPluginPtr plugin(new GatedPlugin(7));
+	plugin->close();
+
+	/* Overrunning the budget falls back to the last published pdistances */
+	BOOST_CHECK_EQUAL(compute(plugin), 0);
+	plugin->wait_running();
+	BOOST_CHECK_EQUAL(plugin->calls(), 1u);
+
+	/* A second computation is refused while the first runs, without
+	 * waiting out its budget */
+	set_budget(10000);
+	boost::system_time start = boost::get_system_time();
+	BOOST_CHECK_EQUAL(compute(plugin), 0);
+	BOOST_CHECK(boost::get_system_time() - start < boost::posix_time::seconds(5));
+	BOOST_CHECK_EQUAL(plugin->calls(), 1u);
+
+	/* Once the first one finishes, computations run again */
+	plugin->open();
+	int rc = 0;
+	for (int i = 0; i < 1000 && plugin->calls() < 2; ++i)
+	{
+		rc = compute(plugin);
+		if (plugin->calls() < 2)
+			boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+	}
+	BOOST_CHECK_EQUAL(plugin->calls(), 2u);
+	BOOST_CHECK_EQUAL(rc, 7);
+}
+
+BOOST_FIXTURE_TEST_CASE ( plugin_compute_cancelled_before_start, PluginComputeJobFixture )
+{
+	/* Occupy the only plugin thread */
+	GatedPluginPtr blocker(new GatedPlugin(7));
+	blocker->close();
+	BOOST_CHECK_EQUAL(compute(blocker), 0);
+	blocker->wait_running();
+
+	/* A computation that cannot start in time is cancelled, and does not
+	 * keep the next one out */
+	GatedPluginPtr plugin(new GatedPlugin(5));
+	BOOST_CHECK_EQUAL(compute(plugin), 0);
+	BOOST_CHECK_EQUAL(PLUGIN_QUEUE->length(), 1);
+	BOOST_CHECK_EQUAL(compute(plugin), 0);
+	BOOST_CHECK_EQUAL(PLUGIN_QUEUE->length(), 2);
+	BOOST_CHECK_EQUAL(plugin->calls(), 0u);
+
+	/* The cancelled jobs never reach the plugin */
+	blocker->open();
+	set_budget(10000);
+	BOOST_CHECK_EQUAL(compute(plugin), 5);
+	BOOST_CHECK_EQUAL(plugin->calls(), 1u);
+}
+
+BOOST_FIXTURE_TEST_CASE ( plugin_compute_dropped_by_stopped_queue, PluginComputeJobFixture )
+{
+	GatedPluginPtr plugin(new GatedPlugin(7));
+
+	PLUGIN_QUEUE->stop();
+	PLUGIN_QUEUE->join();
+	BOOST_CHECK_EQUAL(compute(plugin), 0);
+	BOOST_CHECK_EQUAL(plugin->calls(), 0u);
+
+	/* Dropping the queue and its job leaves the plugin free */
+	PLUGIN_QUEUE = JobQueuePtr(new JobQueue(1));
+	PLUGIN_QUEUE->start();
+	set_budget(10000);
+	BOOST_CHECK_EQUAL(compute(plugin), 7);
+	BOOST_CHECK_EQUAL(plugin->calls(), 1u);
+}
+
+BOOST_FIXTURE_TEST_CASE ( plugin_compute_budget_options, PluginComputeJobFixture )
+{
+	std::string name;
+	unsigned int budget = 0;
+	BOOST_CHECK(PluginComputeJob::parse_budget("mlu=250", name, budget));
+	BOOST_CHECK_EQUAL(name, "mlu");
+	BOOST_CHECK_EQUAL(budget, 250u);
+	BOOST_CHECK(PluginComputeJob::parse_budget("a=b=5", name, budget));
+	BOOST_CHECK_EQUAL(name, "a=b");
+	BOOST_CHECK_EQUAL(budget, 5u);
+
+	BOOST_CHECK(!PluginComputeJob::parse_budget("mlu", name, budget));
+	BOOST_CHECK(!PluginComputeJob::parse_budget("=5", name, budget));
+	BOOST_CHECK(!PluginComputeJob::parse_budget("mlu=", name, budget));
+	BOOST_CHECK(!PluginComputeJob::parse_budget("mlu=-1", name, budget));
+	BOOST_CHECK(!PluginComputeJob::parse_budget("mlu=99999999999", name, budget));
+
+	OPTIONS.insert(std::make_pair(std::string("plugin-time-budget"),
+				      boost::program_options::variable_value(boost::any(std::vector<std::string>(1, "mlu=250")), false)));
+	BOOST_CHECK_EQUAL(PluginComputeJob::get_budget("mlu"), boost::posix_time::milliseconds(250));
+	BOOST_CHECK_EQUAL(PluginComputeJob::get_budget("multihoming-cost"), boost::posix_time::milliseconds(50));
+}
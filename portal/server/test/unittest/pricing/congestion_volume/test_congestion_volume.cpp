@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+#include "congestion_volume.h"
+
+/*
+ * Internal PIDs a and b, joined both ways, and an external PID x on a
+ * link from a. Only the link from a to b runs beyond its capacity.
+ */
+struct CongestionVolumeFixture
+{
+	NetState network;
+	NetEdge ab, ba, ax;
+	p4p::PID a, b, x;
+
+	CongestionVolumeFixture()
+		: a("unittest", 1), b("unittest", 2), x("unittest", 3, true)
+	{
+		BlockWriteLock network_lock(network);
+		add_node("a", a, network_lock);
+		add_node("b", b, network_lock);
+		add_node("x", x, network_lock);
+		add_edge("a", "b", 10.0, 15.0, ab, network_lock);
+		add_edge("b", "a", 10.0, 5.0, ba, network_lock);
+		add_edge("a", "x", 4.0, 6.0, ax, network_lock);
+	}
+
+	void add_node(const std::string& name, const p4p::PID& pid, const WritableLock& lock)
+	{
+		NetVertex v;
+		BOOST_REQUIRE(network.add_node(name, v, lock));
+		network.set_external(v, pid.get_external(), lock);
+		network.set_pid(v, pid, lock);
+	}
+
+	void add_edge(const std::string& src, const std::string& dst, double capacity, double traffic,
+		      NetEdge& e, const WritableLock& lock)
+	{
+		BOOST_REQUIRE(network.add_edge(src, dst, e, lock));
+		network.set_capacity(e, capacity, lock);
+		network.set_traffic(e, traffic, lock);
+	}
+
+	int compute(CongestionVolumePlugin& plugin)
+	{
+		BlockReadLock network_lock(network);
+		return plugin.compute_pdistances(network, network_lock, PinnedPIDSet());
+	}
+
+	double price(const CongestionVolumePlugin& plugin, const p4p::PID& src, const p4p::PID& dst)
+	{
+		const SparsePIDMatrix& pdistances = *plugin.get_edge_pdistances();
+		BlockReadLock pdistances_lock(pdistances);
+		return pdistances.get_by_pid(src, dst, pdistances_lock, -1.0);
+	}
+};
+
+BOOST_FIXTURE_TEST_CASE ( congestion_volume_prices, CongestionVolumeFixture )
+{
+	CongestionVolumePlugin plugin(OptPluginCongestionVolumeDescriptor, 0.5);
+
+	BOOST_REQUIRE_EQUAL(compute(plugin), 0);
+	BOOST_CHECK_CLOSE(plugin.get_volume(), 5.0, 1e-6);
+	BOOST_CHECK_CLOSE(price(plugin, a, b), 0.25, 1e-6);
+	BOOST_CHECK_EQUAL(price(plugin, b, a), 0.0);
+
+	/* The interdomain link is left to the interdomain rule */
+	BOOST_CHECK_EQUAL(price(plugin, a, x), -1.0);
+
+	/* Prices carry over between updates */
+	BOOST_REQUIRE_EQUAL(compute(plugin), 0);
+	BOOST_CHECK_CLOSE(price(plugin, a, b), 0.5, 1e-6);
+}
+
+BOOST_FIXTURE_TEST_CASE ( congestion_volume_price_bounds, CongestionVolumeFixture )
+{
+	CongestionVolumePlugin plugin(OptPluginCongestionVolumeDescriptor, 0.5);
+	{
+		BlockWriteLock network_lock(network);
+		network.set_traffic(ab, 100.0, network_lock);
+	}
+	BOOST_REQUIRE_EQUAL(compute(plugin), 0);
+	BOOST_CHECK_CLOSE(plugin.get_volume(), 90.0, 1e-6);
+	BOOST_CHECK_EQUAL(price(plugin, a, b), 1.0);
+
+	/* Once the link is back under capacity its price decays to 0 */
+	{
+		BlockWriteLock network_lock(network);
+		network.set_traffic(ab, 0.0, network_lock);
+	}
+	BOOST_REQUIRE_EQUAL(compute(plugin), 0);
+	BOOST_CHECK_EQUAL(plugin.get_volume(), 0.0);
+	BOOST_CHECK_CLOSE(price(plugin, a, b), 0.5, 1e-6);
+	BOOST_REQUIRE_EQUAL(compute(plugin), 0);
+	BOOST_REQUIRE_EQUAL(compute(plugin), 0);
+	BOOST_CHECK_EQUAL(price(plugin, a, b), 0.0);
+}
+
+BOOST_FIXTURE_TEST_CASE ( congestion_volume_zero_capacity, CongestionVolumeFixture )
+{
+	CongestionVolumePlugin plugin(OptPluginCongestionVolumeDescriptor);
+	{
+		BlockWriteLock network_lock(network);
+		network.set_capacity(ba, 0.0, network_lock);
+	}
+	BOOST_CHECK_EQUAL(compute(plugin), -1);
+}
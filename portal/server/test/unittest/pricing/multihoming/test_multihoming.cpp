@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+#include "multihoming.h"
+
+/*
+ * Internal PIDs a and b, and external PIDs x and y each linked both
+ * ways with a. Only the link from a to x runs beyond its committed rate.
+ */
+struct MultihomingFixture
+{
+	NetState network;
+	NetEdge ab, ax, xa, ay;
+	p4p::PID a, b, x, y;
+
+	MultihomingFixture()
+		: a("unittest", 1), b("unittest", 2), x("unittest", 3, true), y("unittest", 4, true)
+	{
+		BlockWriteLock network_lock(network);
+		add_node("a", a, network_lock);
+		add_node("b", b, network_lock);
+		add_node("x", x, network_lock);
+		add_node("y", y, network_lock);
+		add_edge("a", "b", 10.0, 50.0, ab, network_lock);
+		add_edge("a", "x", 4.0, 6.0, ax, network_lock);
+		add_edge("x", "a", 4.0, 1.0, xa, network_lock);
+		add_edge("a", "y", 8.0, 2.0, ay, network_lock);
+	}
+
+	void add_node(const std::string& name, const p4p::PID& pid, const WritableLock& lock)
+	{
+		NetVertex v;
+		BOOST_REQUIRE(network.add_node(name, v, lock));
+		network.set_external(v, pid.get_external(), lock);
+		network.set_pid(v, pid, lock);
+	}
+
+	void add_edge(const std::string& src, const std::string& dst, double capacity, double traffic,
+		      NetEdge& e, const WritableLock& lock)
+	{
+		BOOST_REQUIRE(network.add_edge(src, dst, e, lock));
+		network.set_capacity(e, capacity, lock);
+		network.set_traffic(e, traffic, lock);
+	}
+
+	int compute(MultihomingCostPlugin& plugin)
+	{
+		BlockReadLock network_lock(network);
+		return plugin.compute_pdistances(network, network_lock, PinnedPIDSet());
+	}
+
+	double pdistance(const MultihomingCostPlugin& plugin, const p4p::PID& src, const p4p::PID& dst)
+	{
+		const SparsePIDMatrix& pdistances = *plugin.get_edge_pdistances();
+		BlockReadLock pdistances_lock(pdistances);
+		return pdistances.get_by_pid(src, dst, pdistances_lock, -1.0);
+	}
+};
+
+BOOST_FIXTURE_TEST_CASE ( multihoming_surcharges, MultihomingFixture )
+{
+	MultihomingCostPlugin plugin(OptPluginMultihomingCostDescriptor, 1.0);
+
+	BOOST_REQUIRE_EQUAL(compute(plugin), 0);
+	BOOST_CHECK_CLOSE(plugin.get_overage(), 2.0, 1e-6);
+	BOOST_CHECK_CLOSE(pdistance(plugin, a, x), 1.5, 1e-6);
+	BOOST_CHECK_EQUAL(pdistance(plugin, x, a), 1.0);
+	BOOST_CHECK_EQUAL(pdistance(plugin, a, y), 1.0);
+
+	/* The overloaded intradomain link is left alone */
+	BOOST_CHECK_EQUAL(pdistance(plugin, a, b), -1.0);
+
+	/* Surcharges carry over between updates */
+	BOOST_REQUIRE_EQUAL(compute(plugin), 0);
+	BOOST_CHECK_CLOSE(pdistance(plugin, a, x), 2.0, 1e-6);
+}
+
+BOOST_FIXTURE_TEST_CASE ( multihoming_surcharge_bounds, MultihomingFixture )
+{
+	MultihomingCostPlugin plugin(OptPluginMultihomingCostDescriptor, 1.0);
+	{
+		BlockWriteLock network_lock(network);
+		network.set_traffic(ax, 1000.0, network_lock);
+	}
+	BOOST_REQUIRE_EQUAL(compute(plugin), 0);
+	BOOST_CHECK_CLOSE(plugin.get_overage(), 996.0, 1e-6);
+	BOOST_CHECK_EQUAL(pdistance(plugin, a, x), 100.0);
+
+	/* Back under the committed rate, the surcharge decays to 0 */
+	{
+		BlockWriteLock network_lock(network);
+		network.set_traffic(ax, 0.0, network_lock);
+	}
+	for (int i = 0; i < 99; ++i)
+		BOOST_REQUIRE_EQUAL(compute(plugin), 0);
+	BOOST_CHECK_EQUAL(plugin.get_overage(), 0.0);
+	BOOST_CHECK_EQUAL(pdistance(plugin, a, x), 1.0);
+}
+
+BOOST_FIXTURE_TEST_CASE ( multihoming_zero_commit, MultihomingFixture )
+{
+	MultihomingCostPlugin plugin(OptPluginMultihomingCostDescriptor);
+	{
+		BlockWriteLock network_lock(network);
+		network.set_capacity(ay, 0.0, network_lock);
+	}
+	BOOST_CHECK_EQUAL(compute(plugin), -1);
+}
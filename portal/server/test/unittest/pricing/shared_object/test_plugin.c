@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Optimization plugin loaded by the shared object tests. Each update adds
+ * traffic / capacity to the previous pdistance of every edge, and an
+ * update without edges fails.
+ */
+
+#include <stdlib.h>
+#include <p4p/protocol-portal/opt-plugin.h>
+
+#ifndef TEST_PLUGIN_ABI_VERSION
+#define TEST_PLUGIN_ABI_VERSION	PORTAL_OPT_PLUGIN_ABI_VERSION
+#endif
+
+static void* test_create(void)
+{
+	return malloc(1);
+}
+
+static void test_destroy(void* instance)
+{
+	free(instance);
+}
+
+static int test_compute(void* instance, portal_opt_edges* edges)
+{
+	unsigned int i;
+	if (edges->num_edges == 0)
+		return 3;
+	for (i = 0; i < edges->num_edges; ++i)
+		edges->pdistance[i] += edges->traffic[i] / edges->capacity[i];
+	return 0;
+}
+
+static const portal_opt_plugin TEST_PLUGIN = {
+	TEST_PLUGIN_ABI_VERSION,
+	"unittest-shared-object",
+	"Adds the utilization of each edge to its pdistance",
+	test_create,
+	test_destroy,
+	test_compute
+};
+
+/* Exported despite -fvisibility=hidden */
+__attribute__((visibility("default")))
+const portal_opt_plugin* portal_opt_plugin_entry(void)
+{
+	return &TEST_PLUGIN;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include "options.h"
+#include "state.h"
+#include "plugin_compute_job.h"
+#include "plugin_registry.h"
+#include "shared_object.h"
+
+/* Built from test_plugin.c next to the test binary */
+#define TEST_PLUGIN_PATH	TEST_PLUGIN_DIR "/portal_test_plugin.so"
+#define TEST_PLUGIN_ABI_PATH	TEST_PLUGIN_DIR "/portal_test_plugin_abi.so"
+
+/* The plugin can be registered only once per process */
+static OptPluginBasePtr create_test_plugin()
+{
+	static const std::string name = load_opt_plugin(TEST_PLUGIN_PATH);
+	return OptPluginRegistry::Instance().get_instance(name);
+}
+
+/*
+ * Internal PIDs a and b, joined both ways, and an external PID x on a
+ * link from a.
+ */
+struct SharedObjectFixture
+{
+	NetStatePtr network;
+	NetEdge ab, ba, ax;
+	p4p::PID a, b, x;
+
+	SharedObjectFixture()
+		: network(new NetState()),
+		  a("unittest", 1), b("unittest", 2), x("unittest", 3, true)
+	{
+		BlockWriteLock network_lock(*network);
+		add_node("a", a, network_lock);
+		add_node("b", b, network_lock);
+		add_node("x", x, network_lock);
+		add_edge("a", "b", 10.0, 5.0, ab, network_lock);
+		add_edge("b", "a", 10.0, 1.0, ba, network_lock);
+		add_edge("a", "x", 4.0, 2.0, ax, network_lock);
+	}
+
+	void add_node(const std::string& name, const p4p::PID& pid, const WritableLock& lock)
+	{
+		NetVertex v;
+		BOOST_REQUIRE(network->add_node(name, v, lock));
+		network->set_external(v, pid.get_external(), lock);
+		network->set_pid(v, pid, lock);
+	}
+
+	void add_edge(const std::string& src, const std::string& dst, double capacity, double traffic,
+		      NetEdge& e, const WritableLock& lock)
+	{
+		BOOST_REQUIRE(network->add_edge(src, dst, e, lock));
+		network->set_capacity(e, capacity, lock);
+		network->set_traffic(e, traffic, lock);
+	}
+
+	int compute(OptPluginBasePtr plugin)
+	{
+		BlockReadLock network_lock(*network);
+		return plugin->compute_pdistances(*network, network_lock, PinnedPIDSet());
+	}
+
+	double price(OptPluginBaseConstPtr plugin, const p4p::PID& src, const p4p::PID& dst)
+	{
+		const SparsePIDMatrix& pdistances = *plugin->get_edge_pdistances();
+		BlockReadLock pdistances_lock(pdistances);
+		return pdistances.get_by_pid(src, dst, pdistances_lock, -1.0);
+	}
+};
+
+BOOST_AUTO_TEST_CASE ( shared_object_load )
+{
+	OptPluginBasePtr plugin = create_test_plugin();
+	BOOST_REQUIRE(plugin);
+
+	std::vector<std::string> names = OptPluginRegistry::Instance().get_list();
+	BOOST_CHECK(std::find(names.begin(), names.end(), "unittest-shared-object") != names.end());
+
+	/* Already registered */
+	BOOST_CHECK_THROW(load_opt_plugin(TEST_PLUGIN_PATH), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE ( shared_object_load_errors )
+{
+	BOOST_CHECK_THROW(load_opt_plugin(TEST_PLUGIN_DIR "/missing.so"), std::runtime_error);
+
+	try
+	{
+		load_opt_plugin(TEST_PLUGIN_ABI_PATH);
+		BOOST_ERROR("plugin with an unsupported interface version loaded");
+	}
+	catch (std::runtime_error& e)
+	{
+		BOOST_CHECK(std::string(e.what()).find("unsupported plugin interface version") != std::string::npos);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE ( shared_object_compute, SharedObjectFixture )
+{
+	OptPluginBasePtr plugin = create_test_plugin();
+	BOOST_REQUIRE(plugin);
+
+	BOOST_REQUIRE_EQUAL(compute(plugin), 0);
+	BOOST_CHECK_CLOSE(price(plugin, a, b), 0.5, 1e-6);
+	BOOST_CHECK_CLOSE(price(plugin, b, a), 0.1, 1e-6);
+	BOOST_CHECK_CLOSE(price(plugin, a, x), 0.5, 1e-6);
+
+	/* The plugin is handed the pdistances it published last */
+	BOOST_REQUIRE_EQUAL(compute(plugin), 0);
+	BOOST_CHECK_CLOSE(price(plugin, a, b), 1.0, 1e-6);
+
+	/* Errors from the plugin are passed through */
+	NetStatePtr empty(new NetState());
+	BlockReadLock empty_lock(*empty);
+	BOOST_CHECK_EQUAL(plugin->compute_pdistances(*empty, empty_lock, PinnedPIDSet()), 3);
+	BOOST_CHECK_CLOSE(price(plugin, a, b), 1.0, 1e-6);
+}
+
+BOOST_FIXTURE_TEST_CASE ( shared_object_compute_job, SharedObjectFixture )
+{
+	OptPluginBasePtr plugin = create_test_plugin();
+	BOOST_REQUIRE(plugin);
+
+	OPTIONS.insert(std::make_pair(std::string("plugin-budget"),
+				      boost::program_options::variable_value(boost::any(10000U), false)));
+	PLUGIN_QUEUE = JobQueuePtr(new JobQueue(1));
+	PLUGIN_QUEUE->start();
+
+	boost::shared_ptr<WritableLock> network_lock(new BlockWriteLock(*network));
+	BOOST_CHECK_EQUAL(PluginComputeJob::compute(plugin, network, network_lock, PinnedPIDSet()), 0);
+	network_lock.reset();
+	BOOST_CHECK_CLOSE(price(plugin, a, b), 0.5, 1e-6);
+
+	PLUGIN_QUEUE->stop();
+	PLUGIN_QUEUE->join();
+	PLUGIN_QUEUE.reset();
+	OPTIONS.erase("plugin-budget");
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+#include "options.h"
+#include "state.h"
+#include "view_registry.h"
+#include "view_update.h"
+#include "admin_view.h"
+
+/* Global state with the DEFAULT view and its responses built */
+struct MapResponseCacheFixture
+{
+	MapResponseCacheFixture()
+	{
+		OPTIONS.insert(std::make_pair(std::string("admin-txn-timeout"),
+					      boost::program_options::variable_value(boost::any(60U), false)));
+
+		JOB_QUEUE = JobQueuePtr(new JobQueue(1));
+		GLOBAL_STATE = GlobalStatePtr(new GlobalState());
+		GLOBAL_STATE->updated();
+		MAP_RESPONSES = MapResponseCachePtr(new MapResponseCache());
+
+		MAP_RESPONSES->refresh(DEFAULT_VIEW_NAME);
+		BOOST_REQUIRE(MAP_RESPONSES->get(DEFAULT_VIEW_NAME));
+	}
+
+	~MapResponseCacheFixture()
+	{
+		MAP_RESPONSES.reset();
+		GLOBAL_STATE.reset();
+		JOB_QUEUE.reset();
+		OPTIONS.erase("admin-txn-timeout");
+	}
+};
+
+BOOST_FIXTURE_TEST_CASE ( map_responses_dropped_by_view_update, MapResponseCacheFixture )
+{
+	GlobalStatePtr global_state = GLOBAL_STATE;
+	UpgradableReadLock global_state_lock(*global_state);
+	NetStatePtr net_state = global_state->get_net(global_state_lock);
+	BlockReadLock net_state_lock(*net_state);
+	ViewRegistryPtr views = global_state->get_views(global_state_lock);
+	UpgradableReadLock views_lock(*views);
+
+	ViewUpdateStateUpgrade view_state(views->get(DEFAULT_VIEW_NAME, views_lock));
+	ViewUpdateUpgrade update(global_state, global_state_lock,
+				 net_state, net_state_lock,
+				 views, views_lock,
+				 view_state);
+	update.do_update();
+
+	/* Nobody can read the new version yet, and the old responses are already gone */
+	BOOST_CHECK(!MAP_RESPONSES->get(DEFAULT_VIEW_NAME));
+}
+
+BOOST_FIXTURE_TEST_CASE ( map_responses_follow_admin_commit, MapResponseCacheFixture )
+{
+	AdminState admin;
+	AdminState::Token token = admin.txn_begin(AdminState::TXN_COPY_ON_WRITE);
+	admin.txn_apply(token, AdminActionPtr(new AdminViewPropSet(DEFAULT_VIEW_NAME, "pdistance_ttl", "1234")));
+	BOOST_REQUIRE(admin.txn_commit(token));
+
+	BOOST_CHECK(!MAP_RESPONSES->get(DEFAULT_VIEW_NAME));
+
+	MAP_RESPONSES->refresh(DEFAULT_VIEW_NAME);
+	MapResponsesConstPtr responses = MAP_RESPONSES->get(DEFAULT_VIEW_NAME);
+	BOOST_REQUIRE(responses);
+	BOOST_CHECK_EQUAL(responses->pdistance_ttl, 1234U);
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+#include <string.h>
+#include <arpa/inet.h>
+#include "state.h"
+#include "udp_request_handler.h"
+#include "udp_snapshot.h"
+#include "view_registry.h"
+
+namespace udp = p4p::protocol::portal::udp;
+
+typedef std::vector<std::pair<p4p::PID, std::vector<p4p::IPPrefix> > > PIDPrefixList;
+
+/* Handler and server with a single-PID DEFAULT view */
+struct UDPHandlerFixture
+{
+	UDPHandlerFixture()
+		: server("127.0.0.1", 0, 1),
+		  pid("isp.example.net", 1, false),
+		  rsp(udp::MAX_DATAGRAM)
+	{
+		PIDPrefixList prefixes(1, std::make_pair(pid, std::vector<p4p::IPPrefix>(1, p4p::IPPrefix("10.0.0.0", 8))));
+		UDP_SNAPSHOTS = UDPSnapshotRegistryPtr(new UDPSnapshotRegistry());
+		UDP_SNAPSHOTS->publish(DEFAULT_VIEW_NAME, UDPViewSnapshotPtr(new UDPViewSnapshot(prefixes, std::vector<uint32_t>(1, 7), 60, 60, 1)));
+		server.enable_all();
+
+		memset(&sender, 0, sizeof(sender));
+		sender.ss_family = AF_INET;
+	}
+
+	~UDPHandlerFixture()
+	{
+		UDP_SNAPSHOTS.reset();
+	}
+
+	/* Build a request with 'count' queries, padded to 'pad_to' bytes */
+	std::vector<char> make_request(uint8_t version, uint8_t type, unsigned int count, unsigned int pad_to = 0)
+	{
+		std::vector<char> req(udp::MAX_DATAGRAM);
+		udp::Writer w(&req[0], req.size());
+		w.put_u8(version);
+		w.put_u8(type);
+		w.put_u16(count);
+		w.put_u32(42);
+		w.put_u8(0);
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			if (type == udp::MSG_GET_PIDS_REQ)
+				w.put_addr(p4p::IPPrefix("10.1.2.3"));
+			else
+			{
+				w.put_pid(pid);
+				w.put_pid(pid);
+			}
+		}
+		BOOST_REQUIRE(w.ok());
+		req.resize(std::max(w.size(), pad_to));
+		return req;
+	}
+
+	unsigned int handle(const std::vector<char>& req)
+	{
+		return handler(&server, &req[0], req.size(), &rsp[0], rsp.size(), sender);
+	}
+
+	uint16_t answered() const
+	{
+		uint16_t count;
+		memcpy(&count, &rsp[2], sizeof(count));
+		return ntohs(count);
+	}
+
+	UDPHandler handler;
+	UDPHandler::PortalUDPServer server;
+	p4p::PID pid;
+	std::vector<char> rsp;
+	struct sockaddr_storage sender;
+};
+
+BOOST_FIXTURE_TEST_CASE ( udp_short_request_not_answered, UDPHandlerFixture )
+{
+	/* An error response does not fit in a bare request header */
+	std::vector<char> req = make_request(udp::VERSION + 1, udp::MSG_GET_PIDS_REQ, 0);
+	BOOST_CHECK_EQUAL(handle(req), 0U);
+
+	req = make_request(udp::VERSION, udp::MSG_GET_PIDS_REQ, 0);
+	BOOST_CHECK_EQUAL(handle(req), 0U);
+}
+
+BOOST_FIXTURE_TEST_CASE ( udp_error_fits_request, UDPHandlerFixture )
+{
+	std::vector<char> req = make_request(udp::VERSION + 1, udp::MSG_GET_PIDS_REQ, 0, udp::RESPONSE_HEADER_LEN);
+	BOOST_CHECK_EQUAL(handle(req), udp::RESPONSE_HEADER_LEN);
+	BOOST_CHECK_EQUAL(rsp[1], (char)udp::MSG_ERROR_RSP);
+}
+
+BOOST_FIXTURE_TEST_CASE ( udp_pids_response_within_request, UDPHandlerFixture )
+{
+	/* Each PID answer is larger than its IPv4 query */
+	for (unsigned int count = 1; count <= 64; count *= 2)
+	{
+		std::vector<char> req = make_request(udp::VERSION, udp::MSG_GET_PIDS_REQ, count);
+		unsigned int len = handle(req);
+		BOOST_CHECK_LE(len, req.size());
+		if (len > 0)
+			BOOST_CHECK_LT(answered(), count);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE ( udp_pdistances_response_within_request, UDPHandlerFixture )
+{
+	for (unsigned int count = 1; count <= 64; count *= 2)
+	{
+		std::vector<char> req = make_request(udp::VERSION, udp::MSG_GET_PDISTANCES_REQ, count);
+		unsigned int len = handle(req);
+		BOOST_CHECK_LE(len, req.size());
+		BOOST_CHECK_EQUAL(answered(), count);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE ( udp_padded_request_answered, UDPHandlerFixture )
+{
+	std::vector<char> req = make_request(udp::VERSION, udp::MSG_GET_PIDS_REQ, 64, udp::DEFAULT_DATAGRAM);
+	unsigned int len = handle(req);
+	BOOST_CHECK_LE(len, req.size());
+	BOOST_CHECK_EQUAL(answered(), 64);
+}
@@ -95,8 +95,8 @@ AdminPortalProtocol* api = NULL;
 //#define FORMAT_PID_LINK 	"pid link <PID-NAME> <PID-NAME> <PID-link> [capacity <capacity>] [traffic {static <volume> | dynamic}] routing-weight <weight> [\"<description>\"]"
 #define FORMAT_PID_LINK 	"pid link <PID-NAME> <PID-NAME> <PID-LINK> [capacity <capacity>] [traffic {static <volume> | dynamic}] routing-weight <weight> [description <text>]"
 //#define	FORMAT_PID_ROUTING 	"pid routing {weights | static}"
-#define	FORMAT_PID_ROUTING 	"pid routing weights"
-#define	FORMAT_PID_PATH		"pid path <source PID> <destination PID> : <intermediate PID-link> ... <intermediate PID-link>"
+#define	FORMAT_PID_ROUTING 	"pid routing {weights | ecmp | static}"
+#define	FORMAT_PID_PATH		"pid path <source PID> <destination PID> : <intermediate PID-link> ... <intermediate PID-link> [weight <weight>]"
 #define	FORMAT_PID_TTL		"pid ttl <seconds>"
 #define FORMAT_PID_DELETE	"pid del <PID-NAME>"
 #define FORMAT_RULE		"dynamic-update-rule {intradomain {MLU | congestion-volume} | interdomain multihoming-cost}"
@@ -104,6 +104,7 @@ AdminPortalProtocol* api = NULL;
 #define	FORMAT_PDISTANCE_DEFAULT	"pdistance {intra-pid | inter-pid | pid-link | interdomain} default <value (0.0-100.0)>"
 #define FORMAT_PDISTANCE_TTL	"pdistance ttl <seconds>"
 #define FORMAT_PDISTANCE_UPDATE	"pdistance update"
+#define FORMAT_TRAFFIC_LOAD	"traffic load <file> [scale <factor>] [reset]"
 #define FORMAT_SHOW_ISP		"show isp"
 #define FORMAT_SHOW_TOPOLOGY	"show topology {nodes | links}"
 #define FORMAT_SHOW_PID		"show pid {nodes | links}"
@@ -133,12 +134,13 @@ int help()
 		"\t\t" FORMAT_PID_ROUTING "\n"
 		"\t\t" FORMAT_PID_TTL "\n"
 		"\t\t" FORMAT_PID_DELETE "\n"
-		//"\t\t" FORMAT_PID_PATH "\n"
+		"\t\t" FORMAT_PID_PATH "\n"
 		"\t\t" FORMAT_RULE "\n"
 		"\t\t" FORMAT_PDISTANCE_LINK "\n"
 		"\t\t" FORMAT_PDISTANCE_DEFAULT "\n"
 		"\t\t" FORMAT_PDISTANCE_UPDATE "\n"
 		"\t\t" FORMAT_PDISTANCE_TTL "\n"
+		"\t\t" FORMAT_TRAFFIC_LOAD "\n"
 		"\tshow commands:\n"
 		"\t\t" FORMAT_SHOW_ISP "\n"
 		"\t\t" FORMAT_SHOW_TOPOLOGY "\n"
@@ -394,16 +396,26 @@ int config_pid_routing(std::istream& is)
 		goto format_error;
 
 	//configure PID routing:
-	//  set P4P portal routemode to computing shortest path routing
+	//  set P4P portal routemode to computing shortest path routing,
+	//  either along a single path or split over all equal-cost paths
 
-	//weights
-	if (p == "weights")
+	//weights, ecmp
+	if (p == "weights" || p == "ecmp")
 	{
-		/* TODO: Set explicitly */
+		API_ACTION(api->admin_view_set_prop("DEFAULT", "route_mode", p))
+		{
+			fprintf(stderr, "Failed to set PID routing (%s): %s\n", p.c_str(), API_ACTION_ERROR.c_str());
+			return -1;
+		}
 	}
+	//static: routes are configured with "pid path"
 	else if (p == "static")
 	{
-		/* TODO: Not yet implemented */
+		API_ACTION(api->admin_view_set_prop("DEFAULT", "route_mode", p))
+		{
+			fprintf(stderr, "Failed to set PID routing (%s): %s\n", p.c_str(), API_ACTION_ERROR.c_str());
+			return -1;
+		}
 	}
 	else
 		goto format_error;
@@ -427,6 +439,7 @@ int config_pid_path(std::istream& is)
 
 	std::string src, dst, sep, hop;
 	std::vector<std::string> links;
+	double weight = 1.0;
 
 	if (!(is >> src >> dst))
 		goto format_error;
@@ -435,9 +448,26 @@ int config_pid_path(std::istream& is)
 		goto format_error;
 
 	while (is >> hop)
+	{
+		if (hop == "weight")
+		{
+			if (!(is >> weight) || (is >> hop))
+				goto format_error;
+			break;
+		}
 		links.push_back(hop);
+	}
 
-	/* TODO: Not yet implemented */
+	if (links.empty())
+		goto format_error;
+
+	{
+		API_ACTION(api->admin_view_add_static_route("DEFAULT", src, dst, links, weight))
+		{
+			fprintf(stderr, "Failed to add PID path from %s to %s: %s\n", src.c_str(), dst.c_str(), API_ACTION_ERROR.c_str());
+			return -1;
+		}
+	}
 
 	return 0;
 
@@ -646,6 +676,7 @@ format_error_pid:
 int config_rule(std::istream& is)
 {
 	std::string token;
+	std::string plugin;
 
 	if (!(is >> token))
 		goto format_error_rule;
@@ -656,9 +687,7 @@ int config_rule(std::istream& is)
 			goto format_error_rule;
 
 		if (token == "multihoming-cost")
-		{
-			/* TODO: Handle this */
-		}
+			plugin = token;
 		else
 			goto format_error_rule;
 	}
@@ -667,21 +696,21 @@ int config_rule(std::istream& is)
 		if (!(is >> token))
 			goto format_error_rule;
 
-		if (token == "congestion-volume")
-		{
-			/* TODO: Handle this */
-		}
-		else if (token == "MLU")
-		{
-			/* TODO: Handle this */
-		}
+		if (token == "congestion-volume" || token == "MLU")
+			plugin = token;
 		else
 			goto format_error_rule;
 	}
 	else
 		goto format_error_rule;
 
-	/* TODO: Not Yet Implemented */
+	{
+		API_ACTION(api->admin_view_set_prop("DEFAULT", "plugin", plugin))
+		{
+			fprintf(stderr, "Failed to set dynamic update rule (%s): %s\n", plugin.c_str(), API_ACTION_ERROR.c_str());
+			return -1;
+		}
+	}
 
 	return 0;
 
@@ -1203,6 +1232,54 @@ format_error_dump_all:
 	return -1;
 }
 
+int config_traffic(std::istream& is)
+{
+	//load link traffic records from a file
+
+	std::string cmd, filename, option;
+	double scale = 1.0;
+	bool reset = false;
+
+	if (!(is >> cmd) || cmd != "load")
+		goto format_error;
+	if (!(is >> filename))
+		goto format_error;
+
+	while (is >> option)
+	{
+		if (option == "scale")
+		{
+			if (!(is >> scale) || scale < 0)
+				goto format_error;
+		}
+		else if (option == "reset")
+			reset = true;
+		else
+			goto format_error;
+	}
+
+	{
+		std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+		if (!file)
+		{
+			fprintf(stderr, "Failed to open traffic file (%s)\n", filename.c_str());
+			return -1;
+		}
+
+		API_ACTION(api->admin_net_load_traffic(file, scale, reset))
+		{
+			fprintf(stderr, "Failed to load traffic (%s): %s\n", filename.c_str(), API_ACTION_ERROR.c_str());
+			return -1;
+		}
+	}
+
+	return 0;
+
+format_error:
+	fprintf(stderr, "Format: " FORMAT_TRAFFIC_LOAD "\n");
+	return -1;
+}
+
 int config_load(std::istream& is)
 {
 	std::string filename;
@@ -1245,6 +1322,7 @@ int parse(const std::string& command)
 	if (keyword == "pid")			return config_pid(line);
 	if (keyword == "dynamic-update-rule")	return config_rule(line);
 	if (keyword == "pdistance")		return config_pdistance(line);
+	if (keyword == "traffic")		return config_traffic(line);
 	if (keyword == "show")			return config_dump(line);
 
 	return CMD_INVALID;
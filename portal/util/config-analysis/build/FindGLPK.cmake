@@ -0,0 +1,17 @@
+FIND_PATH(GLPK_INCLUDE_DIR glpk.h /usr/include/glpk)
+FIND_LIBRARY(GLPK_LIBRARY NAMES glpk) 
+
+IF (GLPK_INCLUDE_DIR AND GLPK_LIBRARY)
+	SET(GLPK_FOUND TRUE)
+ENDIF (GLPK_INCLUDE_DIR AND GLPK_LIBRARY)
+
+IF (GLPK_FOUND)
+	IF (NOT GLPK_FIND_QUIETLY)
+		MESSAGE(STATUS "Found glpk: ${GLPK_LIBRARY}")
+	ENDIF (NOT GLPK_FIND_QUIETLY)
+ELSE (GLPK_FOUND)
+	IF (GLPK_FIND_REQUIRED)
+		MESSAGE(FATAL_ERROR "Could not find glpk")
+	ENDIF (GLPK_FIND_REQUIRED)
+ENDIF (GLPK_FOUND)
+
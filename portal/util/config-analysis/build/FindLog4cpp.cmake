@@ -0,0 +1,29 @@
+FIND_PATH(Log4cpp_INCLUDE_DIR log4cpp/Category.hh)
+IF (Log4cpp_USE_STATIC_LIBS)
+	SET( _log4cpp_ORIG_CMAKE_FIND_LIBRARY_SUFFIXES ${CMAKE_FIND_LIBRARY_SUFFIXES})
+	IF(WIN32)
+		SET(CMAKE_FIND_LIBRARY_SUFFIXES .lib .a ${CMAKE_FIND_LIBRARY_SUFFIXES})
+	ELSE(WIN32)
+		SET(CMAKE_FIND_LIBRARY_SUFFIXES .a ${CMAKE_FIND_LIBRARY_SUFFIXES})
+	ENDIF(WIN32)
+ENDIF (Log4cpp_USE_STATIC_LIBS)
+FIND_LIBRARY(Log4cpp_LIBRARY NAMES log4cpp) 
+IF (Log4cpp_USE_STATIC_LIBS)
+	SET(CMAKE_FIND_LIBRARY_SUFFIXES ${_log4cpp_ORIG_CMAKE_FIND_LIBRARY_SUFFIXES})
+ENDIF (Log4cpp_USE_STATIC_LIBS )
+
+IF (Log4cpp_INCLUDE_DIR AND Log4cpp_LIBRARY)
+	SET(Log4cpp_FOUND TRUE)
+ENDIF (Log4cpp_INCLUDE_DIR AND Log4cpp_LIBRARY)
+
+
+IF (Log4cpp_FOUND)
+	IF (NOT Log4cpp_FIND_QUIETLY)
+		MESSAGE(STATUS "Found log4cpp: ${Log4cpp_LIBRARY}")
+	ENDIF (NOT Log4cpp_FIND_QUIETLY)
+ELSE (Log4cpp_FOUND)
+	IF (Log4cpp_FIND_REQUIRED)
+		MESSAGE(FATAL_ERROR "Could not find log4cpp")
+	ENDIF (Log4cpp_FIND_REQUIRED)
+ENDIF (Log4cpp_FOUND)
+
@@ -1,11 +1,14 @@
 #/bin/bash
 
 portalshell=p4p_portal_shell
-geovspdistanalysis=p4p_portal_config_geovspdist.pl
+configanalysis=p4p_portal_config_analysis
 
 if [ $# -le 1 ]
 then
 	echo "Usage: $0 <p4p portal server>:<port> <output (e.g., ISP name)>"
+	echo "Environment:"
+	echo "       GEOIP_LOCATIONS: GeoLite2 City blocks CSV file, or file of"
+	echo "                        '<prefix> <latitude> <longitude>' lines"
 	echo "Output:"
 	echo "       pidmap.<output>: PID map visible to applications"
 	echo "       pdistance.<output>: pDistances visible to applications"
@@ -14,6 +17,12 @@ then
 	exit 1
 fi
 
+if [ -z "$GEOIP_LOCATIONS" ]
+then
+	echo "Path to the IP locations must be specified in GEOIP_LOCATIONS environment variable."
+	exit 1
+fi
+
 server=$1; shift
 isp=$1; shift
 
@@ -43,7 +52,8 @@ cp -f $results pdistance.$isp
 
 
 # Analysis: geographical distance vs pDistance
-perl "${path}${geovspdistanalysis}" pidmap.$isp pdistance.$isp > geovspdist
+$configanalysis --pidmap pidmap.$isp --pdistance pdistance.$isp \
+	--locations "$GEOIP_LOCATIONS" --geo-output geovspdist
 
 gnuplot ${path}p4p_portal_config_geovspdist.gp
 
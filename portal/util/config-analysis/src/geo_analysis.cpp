@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "geo_analysis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <arpa/inet.h>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+
+/* Column of the network, latitude and longitude in GeoLite2 City blocks */
+static const unsigned int CSV_NETWORK = 0;
+static const unsigned int CSV_LATITUDE = 7;
+static const unsigned int CSV_LONGITUDE = 8;
+
+/* Parse a prefix without going through getaddrinfo(), which is the
+ * bulk of the time spent on a full GeoLite2 file */
+static bool parse_prefix(const std::string& text, p4p::IPPrefix& result)
+{
+	std::string::size_type slash = text.find('/');
+	std::string address = text.substr(0, slash);
+	int family = address.find(':') == std::string::npos ? AF_INET : AF_INET6;
+	unsigned short length = family == AF_INET ? 32 : 128;
+
+	if (slash != std::string::npos)
+	{
+		char* end;
+		unsigned long value = strtoul(text.c_str() + slash + 1, &end, 10);
+		if (*end != '\0' || end == text.c_str() + slash + 1 || value > length)
+			return false;
+		length = value;
+	}
+
+	in6_addr addr;
+	if (inet_pton(family, address.c_str(), &addr) != 1)
+		return false;
+
+	result = p4p::IPPrefix(family, &addr, length);
+	return true;
+}
+
+static double deg2rad(double deg)
+{
+	return deg * M_PI / 180.0;
+}
+
+static double rad2deg(double rad)
+{
+	return rad * 180.0 / M_PI;
+}
+
+/* Average (1-based) rank of each value, ties sharing their ranks */
+static void rank(const std::vector<double>& values, std::vector<double>& result)
+{
+	std::vector<std::pair<double, unsigned int> > sorted(values.size());
+	for (unsigned int i = 0; i < values.size(); ++i)
+		sorted[i] = std::make_pair(values[i], i);
+	std::sort(sorted.begin(), sorted.end());
+
+	result.resize(values.size());
+	for (unsigned int i = 0; i < sorted.size(); )
+	{
+		unsigned int j = i;
+		while (j < sorted.size() && sorted[j].first == sorted[i].first)
+			++j;
+		double r = (i + 1 + j) / 2.0;
+		for (unsigned int k = i; k < j; ++k)
+			result[sorted[k].second] = r;
+		i = j;
+	}
+}
+
+static double pearson(const std::vector<double>& x, const std::vector<double>& y)
+{
+	double n = x.size();
+	double sum_x = 0.0, sum_y = 0.0;
+	for (unsigned int i = 0; i < x.size(); ++i)
+	{
+		sum_x += x[i];
+		sum_y += y[i];
+	}
+	double mean_x = sum_x / n, mean_y = sum_y / n;
+
+	double cov = 0.0, var_x = 0.0, var_y = 0.0;
+	for (unsigned int i = 0; i < x.size(); ++i)
+	{
+		cov += (x[i] - mean_x) * (y[i] - mean_y);
+		var_x += (x[i] - mean_x) * (x[i] - mean_x);
+		var_y += (y[i] - mean_y) * (y[i] - mean_y);
+	}
+	if (var_x == 0.0 || var_y == 0.0)
+		return NAN;
+	return cov / std::sqrt(var_x * var_y);
+}
+
+void LocationTable::read(std::istream& is)
+{
+	std::string text;
+	unsigned int line = 0;
+	while (std::getline(is, text))
+	{
+		++line;
+		if (text.empty() || text[0] == '#' || text.compare(0, 8, "network,") == 0)
+			continue;
+
+		std::vector<std::string> fields;
+		if (text.find(',') != std::string::npos)
+		{
+			std::string::size_type begin = 0, end;
+			while ((end = text.find(',', begin)) != std::string::npos)
+			{
+				fields.push_back(text.substr(begin, end - begin));
+				begin = end + 1;
+			}
+			fields.push_back(text.substr(begin));
+
+			/* Blocks known only by country have no coordinates */
+			if (fields.size() <= CSV_LONGITUDE)
+				throw std::runtime_error("Malformed line " + boost::lexical_cast<std::string>(line) + ": " + text);
+			if (fields[CSV_LATITUDE].empty() || fields[CSV_LONGITUDE].empty())
+				continue;
+			fields[0] = fields[CSV_NETWORK];
+			fields[1] = fields[CSV_LATITUDE];
+			fields[2] = fields[CSV_LONGITUDE];
+		}
+		else
+		{
+			std::istringstream line_is(text);
+			std::string field;
+			while (line_is >> field)
+				fields.push_back(field);
+			if (fields.size() != 3)
+				throw std::runtime_error("Malformed line " + boost::lexical_cast<std::string>(line) + ": " + text);
+		}
+
+		try
+		{
+			add(fields[0], fields[1], fields[2]);
+		}
+		catch (std::exception& e)
+		{
+			throw std::runtime_error("Malformed line " + boost::lexical_cast<std::string>(line) + ": " + text);
+		}
+	}
+}
+
+void LocationTable::add(const std::string& prefix, const std::string& latitude, const std::string& longitude)
+{
+	p4p::IPPrefix p;
+	if (!parse_prefix(prefix, p))
+		throw std::invalid_argument(prefix);
+
+	GeoLocation location(boost::lexical_cast<double>(latitude), boost::lexical_cast<double>(longitude));
+	std::map<GeoLocation, unsigned int>::iterator itr = location_index_.find(location);
+	if (itr == location_index_.end())
+	{
+		itr = location_index_.insert(std::make_pair(location, (unsigned int)locations_.size())).first;
+		locations_.push_back(location);
+	}
+
+	/* A prefix listed again keeps its first location */
+	trie_.add(p, itr->second);
+	++num_prefixes_;
+}
+
+bool LocationTable::lookup(const p4p::IPPrefix& address, GeoLocation& result) const
+{
+	const unsigned int* index = trie_.lookup(address);
+	if (!index)
+		return false;
+	result = locations_[*index];
+	return true;
+}
+
+void locate_pids(const PIDPrefixTable& table, const LocationTable& locations, PIDLocationMap& result)
+{
+	BOOST_FOREACH(const PIDPrefixTable::Entry& entry, table.get_entries())
+	{
+		BOOST_FOREACH(const p4p::IPPrefix& prefix, entry.second)
+		{
+			GeoLocation location;
+			if (locations.lookup(p4p::IPPrefix(prefix.get_family(), prefix.get_address()), location))
+			{
+				result[entry.first] = location;
+				break;
+			}
+		}
+	}
+}
+
+double geo_distance(const GeoLocation& a, const GeoLocation& b)
+{
+	double theta = a.second - b.second;
+	double dist = std::sin(deg2rad(a.first)) * std::sin(deg2rad(b.first))
+		+ std::cos(deg2rad(a.first)) * std::cos(deg2rad(b.first)) * std::cos(deg2rad(theta));
+	dist = std::acos(std::max(-1.0, std::min(1.0, dist)));
+
+	/* Statute miles, then kilometers */
+	return rad2deg(dist) * 60 * 1.1515 * 1.609344;
+}
+
+Correlation::Correlation()
+	: n(0),
+	  pearson(NAN),
+	  spearman(NAN)
+{
+}
+
+void Correlation::compute(const std::vector<double>& x, const std::vector<double>& y)
+{
+	n = x.size();
+	if (n < 2)
+		return;
+
+	pearson = ::pearson(x, y);
+
+	std::vector<double> rank_x, rank_y;
+	rank(x, rank_x);
+	rank(y, rank_y);
+	spearman = ::pearson(rank_x, rank_y);
+}
+
+void geo_vs_pdistance(const PDistanceVector& pdistances, const PIDLocationMap& locations, std::ostream* os,
+		      std::vector<double>& result_pdistances, std::vector<double>& result_distances)
+{
+	PIDLocationMap::const_iterator src = locations.end();
+	BOOST_FOREACH(const PDistanceEntry& entry, pdistances)
+	{
+		if (!std::isfinite(entry.value))
+			continue;
+
+		/* Entries come grouped by source */
+		if (src == locations.end() || src->first != entry.src)
+			src = locations.find(entry.src);
+		if (src == locations.end())
+			continue;
+		PIDLocationMap::const_iterator dst = locations.find(entry.dst);
+		if (dst == locations.end())
+			continue;
+
+		double distance = geo_distance(src->second, dst->second);
+		if (os)
+			*os << entry.value << ' ' << distance << '\n';
+		result_pdistances.push_back(entry.value);
+		result_distances.push_back(distance);
+	}
+}
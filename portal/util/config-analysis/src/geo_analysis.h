@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#ifndef GEO_ANALYSIS_H
+#define GEO_ANALYSIS_H
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <utility>
+#include <vector>
+#include <p4p/ip_addr.h>
+#include <p4p/pid.h>
+#include <p4p/detail/patricia_trie.h>
+#include <p4pserver/pid_map.h>
+#include "portal_dumps.h"
+
+/* Latitude and longitude, in degrees */
+typedef std::pair<double, double> GeoLocation;
+typedef std::map<p4p::PID, GeoLocation> PIDLocationMap;
+
+/*
+ * Locations of IP addresses, found by longest prefix match. Read from
+ * "<prefix> <latitude> <longitude>" lines, or from a MaxMind GeoLite2
+ * City blocks CSV file ("network,...,latitude,longitude,...").
+ */
+class LocationTable
+{
+public:
+	LocationTable() : num_prefixes_(0) {}
+
+	/* Throws std::runtime_error on a malformed line */
+	void read(std::istream& is);
+
+	bool lookup(const p4p::IPPrefix& address, GeoLocation& result) const;
+
+	unsigned int get_num_prefixes() const			{ return num_prefixes_; }
+
+private:
+	void add(const std::string& prefix, const std::string& latitude, const std::string& longitude);
+
+	/* Blocks mostly share a few locations, which are kept once */
+	p4p::detail::PatriciaTrie<unsigned int> trie_;
+	std::vector<GeoLocation> locations_;
+	std::map<GeoLocation, unsigned int> location_index_;
+	unsigned int num_prefixes_;
+};
+
+/*
+ * Locate each PID at the first of its prefixes whose (network) address
+ * has a location.
+ */
+void locate_pids(const PIDPrefixTable& table, const LocationTable& locations, PIDLocationMap& result);
+
+/* Great-circle distance in kilometers (spherical law of cosines) */
+double geo_distance(const GeoLocation& a, const GeoLocation& b);
+
+/* Pearson and Spearman (rank) correlation of two series; NAN if either is constant */
+struct Correlation
+{
+	Correlation();
+
+	void compute(const std::vector<double>& x, const std::vector<double>& y);
+
+	unsigned long long	n;
+	double			pearson;
+	double			spearman;
+};
+
+/*
+ * Pair the pDistance of each pair of located PIDs with their distance,
+ * writing "<pDistance> <km>" lines to 'os' if it isn't NULL (the input
+ * of the geovspdist plot). Pairs with an infinite pDistance are left
+ * out.
+ */
+void geo_vs_pdistance(const PDistanceVector& pdistances, const PIDLocationMap& locations, std::ostream* os,
+		      std::vector<double>& result_pdistances, std::vector<double>& result_distances);
+
+#endif
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <p4pserver/locking.h>
+#include "geo_analysis.h"
+#include "pdistance_stats.h"
+#include "portal_config.h"
+#include "portal_dumps.h"
+#include "route_analysis.h"
+#include "test_config.h"
+#include "options.h"
+
+namespace bpt = boost::posix_time;
+
+/* Seconds since 'start', for the report */
+static double elapsed(const bpt::ptime& start)
+{
+	return (bpt::microsec_clock::universal_time() - start).total_microseconds() / 1e6;
+}
+
+static void open_input(const std::string& option, std::ifstream& is)
+{
+	is.open(OPTIONS[option].as<std::string>().c_str());
+	if (!is)
+		throw std::runtime_error("failed to open " + OPTIONS[option].as<std::string>());
+}
+
+static void open_output(const std::string& option, std::ofstream& os)
+{
+	os.open(OPTIONS[option].as<std::string>().c_str());
+	if (!os)
+		throw std::runtime_error("failed to open " + OPTIONS[option].as<std::string>());
+}
+
+static void print_problem(const ConfigProblem& problem)
+{
+	if (problem.line > 0)
+		std::cout << "line " << problem.line << ": ";
+	std::cout << (problem.severity == ConfigProblem::ERROR ? "error: " : "warning: ") << problem.message << std::endl;
+}
+
+static unsigned int analyze()
+{
+	bpt::ptime start;
+	PortalConfig config;
+	ConfigProblemVector problems;
+	PDistanceVector computed;
+
+	if (OPTIONS.count("config") > 0)
+	{
+		start = bpt::microsec_clock::universal_time();
+		{
+			std::ifstream is;
+			open_input("config", is);
+			config.load(is);
+		}
+		problems = config.get_problems();
+
+		unsigned int prefixes;
+		{
+			BlockReadLock prefixes_lock(*config.get_prefixes());
+			prefixes = config.get_prefixes()->get_table(prefixes_lock)->get_num_prefixes();
+		}
+		std::cout << "configuration: " << config.get_pids().size() << " PIDs ("
+			  << config.get_internal_pids().size() << " internal), "
+			  << config.get_links().size() << " PID links, "
+			  << prefixes << " prefixes, "
+			  << PIDRouting::get_route_mode_name(config.get_route_mode()) << " routing"
+			  << " (" << elapsed(start) << " s)" << std::endl;
+
+		start = bpt::microsec_clock::universal_time();
+		unsigned int threads = OPTIONS["threads"].as<unsigned int>();
+		RouteAnalysis routes(config);
+		routes.run(threads);
+		routes.get_pdistances(computed);
+		routes.get_problems(problems);
+		std::cout << "routes: " << routes.get_routes() << " between internal PIDs, "
+			  << routes.get_unreachable() << " PID pairs without a route, "
+			  << routes.get_invalid() << " invalid"
+			  << " (" << threads << " threads, " << elapsed(start) << " s)" << std::endl;
+
+		if (OPTIONS.count("pdistance-output") > 0)
+		{
+			std::ofstream os;
+			open_output("pdistance-output", os);
+			write_pdistances(os, computed);
+		}
+	}
+
+	PDistanceVector dumped;
+	if (OPTIONS.count("pdistance") > 0)
+	{
+		start = bpt::microsec_clock::universal_time();
+		{
+			std::ifstream is;
+			open_input("pdistance", is);
+			read_pdistances(is, dumped);
+		}
+		std::sort(dumped.begin(), dumped.end());
+		std::cout << "pdistance dump: " << dumped.size() << " PID pairs (" << elapsed(start) << " s)" << std::endl;
+
+		if (OPTIONS.count("config") > 0)
+		{
+			PDistanceDifferenceVector differences;
+			unsigned long long compared = compare_pdistances(computed, dumped, differences);
+			BOOST_FOREACH(const PDistanceDifference& d, differences)
+			{
+				problems.push_back(ConfigProblem(ConfigProblem::WARNING, 0,
+					"pDistance from " + boost::lexical_cast<std::string>(d.src) + " to " + boost::lexical_cast<std::string>(d.dst)
+					+ " is " + boost::lexical_cast<std::string>(d.actual) + " in the dump but "
+					+ boost::lexical_cast<std::string>(d.expected) + " from the configuration"));
+			}
+			std::cout << "comparison: " << compared << " PID pairs in both, "
+				  << differences.size() << " with different pDistances" << std::endl;
+		}
+	}
+
+	/* Dumped pDistances are what clients see, so they take precedence */
+	const PDistanceVector& pdistances = OPTIONS.count("pdistance") > 0 ? dumped : computed;
+
+	PDistanceStats stats;
+	stats.compute(pdistances);
+	std::cout << "pdistances: " << stats.pairs << " PID pairs, "
+		  << stats.infinite << " infinite, "
+		  << stats.asymmetric << " asymmetric; "
+		  << "min " << stats.min << ", median " << stats.median
+		  << ", p90 " << stats.p90 << ", p99 " << stats.p99
+		  << ", max " << stats.max << ", mean " << stats.mean
+		  << " (stddev " << stats.stddev << ")" << std::endl;
+
+	if (OPTIONS.count("locations") > 0)
+	{
+		start = bpt::microsec_clock::universal_time();
+
+		PIDMapPtr pid_map = config.get_prefixes();
+		if (OPTIONS.count("pidmap") > 0)
+		{
+			pid_map = PIDMapPtr(new PIDMap());
+			std::ifstream is;
+			open_input("pidmap", is);
+			BlockWriteLock pid_map_lock(*pid_map);
+			read_pid_map(is, *pid_map, pid_map_lock);
+		}
+
+		LocationTable locations;
+		{
+			std::ifstream is;
+			open_input("locations", is);
+			locations.read(is);
+		}
+
+		PIDLocationMap pid_locations;
+		PIDPrefixTableConstPtr table;
+		{
+			BlockReadLock pid_map_lock(*pid_map);
+			table = pid_map->get_table(pid_map_lock);
+		}
+		locate_pids(*table, locations, pid_locations);
+
+		std::ofstream os;
+		if (OPTIONS.count("geo-output") > 0)
+			open_output("geo-output", os);
+
+		std::vector<double> x, y;
+		geo_vs_pdistance(pdistances, pid_locations, OPTIONS.count("geo-output") > 0 ? &os : NULL, x, y);
+		Correlation correlation;
+		correlation.compute(x, y);
+
+		std::cout << "geo vs pdistance: " << pid_locations.size() << " of " << table->get_entries().size() << " PIDs located ("
+			  << locations.get_num_prefixes() << " location prefixes), "
+			  << correlation.n << " PID pairs, pearson " << correlation.pearson
+			  << ", spearman " << correlation.spearman
+			  << " (" << elapsed(start) << " s)" << std::endl;
+	}
+
+	unsigned int errors = 0;
+	BOOST_FOREACH(const ConfigProblem& problem, problems)
+	{
+		if (problem.severity == ConfigProblem::ERROR)
+			++errors;
+	}
+
+	unsigned int max_problems = OPTIONS["max-problems"].as<unsigned int>();
+	for (unsigned int i = 0; i < problems.size() && i < max_problems; ++i)
+		print_problem(problems[i]);
+	if (problems.size() > max_problems)
+		std::cout << "... " << problems.size() - max_problems << " more" << std::endl;
+	std::cout << "problems: " << errors << " errors, " << problems.size() - errors << " warnings" << std::endl;
+
+	return errors;
+}
+
+int main(int argc, char** argv)
+{
+	handle_options(argc, argv);
+
+	try
+	{
+		if (OPTIONS.count("test-config") > 0)
+		{
+			std::ifstream is;
+			open_input("test-config", is);
+			write_test_config(is, OPTIONS["isp"].as<std::string>(), std::cout);
+			return 0;
+		}
+
+		return analyze() > 0 ? 2 : 0;
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return 1;
+	}
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "options.h"
+
+#include <boost/program_options.hpp>
+#include <boost/thread/thread.hpp>
+#include <iostream>
+#include <string>
+
+namespace bpo = boost::program_options;
+
+bpo::variables_map OPTIONS;
+
+const bpo::options_description AVAILABLE_OPTIONS = bpo::options_description("Options");
+
+void handle_options(int argc, char** argv)
+{
+	const_cast<bpo::options_description*>(&AVAILABLE_OPTIONS)->add_options()
+	("help",	"print this help message")
+	("config",	bpo::value<std::string>(),
+			"portal configuration file to check and compute pDistances from")
+	("pidmap",	bpo::value<std::string>(),
+			"PID map dumped by the portal shell ('show pidmap'); default is the configuration's")
+	("pdistance",	bpo::value<std::string>(),
+			"pDistances dumped by the portal shell ('show pdistance'); default is those computed from the configuration")
+	("locations",	bpo::value<std::string>(),
+			"IP locations, as 'prefix latitude longitude' lines or a GeoLite2 City blocks CSV file")
+	("geo-output",	bpo::value<std::string>(),
+			"file of 'pdistance km' lines for the PID pairs with known locations")
+	("pdistance-output",	bpo::value<std::string>(),
+			"file of the pDistances computed from the configuration, in the format of 'show pdistance'")
+	("threads",	bpo::value<unsigned int>()->default_value(std::max(1u, boost::thread::hardware_concurrency())),
+			"threads computing routes")
+	("max-problems",	bpo::value<unsigned int>()->default_value(100),
+			"most problems listed; the others are only counted")
+	("test-config",	bpo::value<std::string>(),
+			"write a configuration with the pDistances of a file of 'pid1 pid2 pdistance' lines, and exit")
+	("isp",		bpo::value<std::string>()->default_value("default"),
+			"ISP of the test configuration")
+	;
+
+	try
+	{
+		bpo::store(bpo::parse_command_line(argc, argv, AVAILABLE_OPTIONS), OPTIONS);
+	}
+	catch (bpo::error& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl
+			  << AVAILABLE_OPTIONS << std::endl;
+		exit(1);
+	}
+
+	bpo::notify(OPTIONS);
+
+	/*
+	 *	Handle 'help' option
+	 */
+	if (OPTIONS.count("help") > 0)
+	{
+		std::cerr << AVAILABLE_OPTIONS << std::endl;
+		exit(0);
+	}
+
+	if (OPTIONS.count("test-config") > 0)
+		return;
+
+	if (OPTIONS.count("config") == 0 && OPTIONS.count("pdistance") == 0)
+	{
+		std::cerr << "Error: --config or --pdistance is required" << std::endl
+			  << AVAILABLE_OPTIONS << std::endl;
+		exit(1);
+	}
+
+	if (OPTIONS.count("pdistance-output") > 0 && OPTIONS.count("config") == 0)
+	{
+		std::cerr << "Error: --pdistance-output requires --config" << std::endl;
+		exit(1);
+	}
+
+	if (OPTIONS.count("geo-output") > 0 && OPTIONS.count("locations") == 0)
+	{
+		std::cerr << "Error: --geo-output requires --locations" << std::endl;
+		exit(1);
+	}
+
+	if (OPTIONS.count("locations") > 0 && OPTIONS.count("config") == 0 && OPTIONS.count("pidmap") == 0)
+	{
+		std::cerr << "Error: --locations requires --config or --pidmap" << std::endl;
+		exit(1);
+	}
+}
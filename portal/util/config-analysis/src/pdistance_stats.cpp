@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "pdistance_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <boost/foreach.hpp>
+
+/* Relative difference below which two pDistances are the same; the
+ * portal shell writes 6 significant digits */
+static const double TOLERANCE = 1e-5;
+
+static bool same_pdistance(double a, double b)
+{
+	if (std::isinf(a) || std::isinf(b))
+		return a == b;
+	return std::fabs(a - b) <= TOLERANCE * std::max(1.0, std::max(std::fabs(a), std::fabs(b)));
+}
+
+/* Nearest-rank percentile of sorted values */
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	unsigned int rank = (unsigned int)std::ceil(p * sorted.size());
+	return sorted[std::max(rank, 1u) - 1];
+}
+
+PDistanceStats::PDistanceStats()
+	: pairs(0),
+	  infinite(0),
+	  asymmetric(0),
+	  min(0),
+	  max(0),
+	  mean(0),
+	  stddev(0),
+	  median(0),
+	  p90(0),
+	  p99(0)
+{
+}
+
+void PDistanceStats::compute(const PDistanceVector& pdistances)
+{
+	std::vector<double> values;
+	values.reserve(pdistances.size());
+
+	BOOST_FOREACH(const PDistanceEntry& entry, pdistances)
+	{
+		if (entry.src == entry.dst)
+			continue;
+		++pairs;
+
+		if (!std::isfinite(entry.value))
+			++infinite;
+		else
+			values.push_back(entry.value);
+
+		/* Each unordered pair once, from its lesser PID */
+		if (entry.dst < entry.src)
+			continue;
+		PDistanceVector::const_iterator reverse = std::lower_bound(pdistances.begin(), pdistances.end(),
+									    PDistanceEntry(entry.dst, entry.src, 0.0));
+		if (reverse != pdistances.end() && reverse->src == entry.dst && reverse->dst == entry.src
+				&& !same_pdistance(entry.value, reverse->value))
+			++asymmetric;
+	}
+
+	if (values.empty())
+		return;
+
+	double sum = 0.0;
+	BOOST_FOREACH(double v, values)
+		sum += v;
+	mean = sum / values.size();
+
+	double squares = 0.0;
+	BOOST_FOREACH(double v, values)
+		squares += (v - mean) * (v - mean);
+	stddev = std::sqrt(squares / values.size());
+
+	std::sort(values.begin(), values.end());
+	min = values.front();
+	max = values.back();
+	median = percentile(values, 0.5);
+	p90 = percentile(values, 0.9);
+	p99 = percentile(values, 0.99);
+}
+
+unsigned long long compare_pdistances(const PDistanceVector& expected, const PDistanceVector& actual, PDistanceDifferenceVector& result)
+{
+	unsigned long long compared = 0;
+	PDistanceVector::const_iterator a = actual.begin();
+	BOOST_FOREACH(const PDistanceEntry& entry, expected)
+	{
+		while (a != actual.end() && *a < entry)
+			++a;
+		if (a == actual.end())
+			break;
+		if (entry < *a)
+			continue;
+
+		++compared;
+		if (!same_pdistance(entry.value, a->value))
+			result.push_back(PDistanceDifference(entry, a->value));
+	}
+	return compared;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#ifndef PDISTANCE_STATS_H
+#define PDISTANCE_STATS_H
+
+#include <vector>
+#include "portal_dumps.h"
+
+/* Summary of the pDistances between distinct PIDs */
+struct PDistanceStats
+{
+	PDistanceStats();
+
+	/* Compute from pDistances sorted by source and destination */
+	void compute(const PDistanceVector& pdistances);
+
+	unsigned long long	pairs;		/**< Pairs of distinct PIDs */
+	unsigned long long	infinite;	/**< Pairs without a finite pDistance */
+	unsigned long long	asymmetric;	/**< Pairs (counted once) whose pDistance depends on the direction */
+	double			min;
+	double			max;
+	double			mean;
+	double			stddev;
+	double			median;
+	double			p90;
+	double			p99;
+};
+
+/* A PID pair whose pDistance differs between two sets of pDistances */
+struct PDistanceDifference
+{
+	PDistanceDifference(const PDistanceEntry& expected, double actual)
+		: src(expected.src), dst(expected.dst), expected(expected.value), actual(actual)
+	{}
+
+	p4p::PID	src;
+	p4p::PID	dst;
+	double		expected;
+	double		actual;
+};
+typedef std::vector<PDistanceDifference> PDistanceDifferenceVector;
+
+/*
+ * Compare the pDistances of the PID pairs in both 'expected' and
+ * 'actual' (both sorted by source and destination), allowing for the
+ * rounding of the portal shell's output. Returns the number of pairs
+ * compared.
+ */
+unsigned long long compare_pdistances(const PDistanceVector& expected, const PDistanceVector& actual, PDistanceDifferenceVector& result);
+
+#endif
@@ -0,0 +1,490 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "portal_config.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <sstream>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <p4pserver/locking.h>
+
+/* Same as the routing weight of a view's links without one */
+static const double DEFAULT_WEIGHT = 1.0;
+
+/* Range the portal shell accepts for configured pDistances */
+static const double MAX_PDISTANCE = 100.0;
+
+static std::string pid_str(const p4p::PID& pid)
+{
+	return boost::lexical_cast<std::string>(pid);
+}
+
+PortalConfig::PortalConfig()
+	: net_state_(new NetState()),
+	  aggregation_(new PIDAggregation()),
+	  prefixes_(new PIDMap()),
+	  link_pdistances_(new SparsePIDMatrix()),
+	  isp_("default"),
+	  route_mode_(PIDRouting::RM_WEIGHTS),
+	  intrapid_pdistance_(0),
+	  interpid_pdistance_(INFINITY),
+	  pidlink_pdistance_(1)
+{
+}
+
+void PortalConfig::load(std::istream& is)
+{
+	std::string text;
+	unsigned int line = 0;
+	while (std::getline(is, text))
+	{
+		++line;
+		std::istringstream line_is(text);
+		std::string keyword;
+		if (!(line_is >> keyword) || keyword[0] == '#')
+			continue;
+		if (keyword == "exit")
+			break;
+
+		std::istringstream command(text);
+		parse_line(command, line);
+	}
+
+	finish();
+}
+
+void PortalConfig::parse_line(std::istream& is, unsigned int line)
+{
+	std::string keyword, token;
+	is >> keyword;
+
+	if (keyword == "pid")
+		parse_pid(is, line);
+	else if (keyword == "pdistance")
+		parse_pdistance(is, line);
+	else if (keyword == "isp")
+	{
+		if (!(is >> token) || token != "default" || !(is >> token))
+		{
+			error(line, "format: isp default <ISP>");
+			return;
+		}
+		if (!pids_.empty())
+			warning(line, "ISP changed after PIDs were defined; they keep ISP " + isp_);
+		isp_ = token;
+	}
+	else if (keyword == "version" || keyword == "dynamic-update-rule" || keyword == "traffic"
+		 || keyword == "txn" || keyword == "verbose" || keyword == "server" || keyword == "show")
+	{
+		/* Not part of the configuration the portal analyzes */
+	}
+	else
+		error(line, "unknown command '" + keyword + "'");
+}
+
+void PortalConfig::parse_pid(std::istream& is, unsigned int line)
+{
+	std::string token, name;
+	unsigned int num;
+	bool external;
+
+	if (!(is >> token))
+	{
+		error(line, "format: pid {internal | external} <number> <PID-NAME> [prefixes <prefix> ...]");
+		return;
+	}
+
+	if (token == "link")
+	{
+		parse_pid_link(is, line);
+		return;
+	}
+	if (token == "routing")
+	{
+		if (!(is >> token) || !PIDRouting::parse_route_mode(token, route_mode_))
+			error(line, "format: pid routing {weights | ecmp | static}");
+		else if (route_mode_ == PIDRouting::RM_STATIC)
+			warning(line, "static routing has no routes until paths are configured, which the portal does not support");
+		return;
+	}
+	if (token == "path")
+	{
+		warning(line, "'pid path' is not applied by the portal shell; ignored");
+		return;
+	}
+	if (token == "ttl")
+		return;
+	if (token == "del")
+	{
+		if (!(is >> name))
+			error(line, "format: pid del <PID-NAME>");
+		else
+			remove_pid(name, line);
+		return;
+	}
+
+	if (token == "internal")
+		external = false;
+	else if (token == "external")
+		external = true;
+	else
+	{
+		error(line, "format: pid {internal | external} <number> <PID-NAME> [prefixes <prefix> ...]");
+		return;
+	}
+
+	if (!(is >> num) || !(is >> name))
+	{
+		error(line, "format: pid {internal | external} <number> <PID-NAME> [prefixes <prefix> ...]");
+		return;
+	}
+
+	p4p::PID pid(isp_, num, external);
+	NetVertexNameSet vertices;
+	vertices.insert(name);
+
+	BlockWriteLock aggregation_lock(*aggregation_);
+	if (aggregation_->has(name, aggregation_lock))
+	{
+		error(line, "PID " + name + " is already defined");
+		return;
+	}
+	if (aggregation_->has(pid, aggregation_lock))
+	{
+		std::string other;
+		aggregation_->reverse_lookup(pid, other, aggregation_lock);
+		error(line, "PID " + name + " has the same number as PID " + other);
+		return;
+	}
+
+	{
+		BlockWriteLock net_state_lock(*net_state_);
+		NetVertex v;
+		if (!net_state_->add_node(name, v, net_state_lock))
+		{
+			error(line, "node " + name + " is already defined");
+			return;
+		}
+		net_state_->set_external(v, external, net_state_lock);
+		net_state_->set_pid(v, pid, net_state_lock);
+	}
+	aggregation_->add(name, pid, vertices, aggregation_lock);
+
+	pids_.insert(std::lower_bound(pids_.begin(), pids_.end(), pid), pid);
+	if (!external)
+		internal_pids_.insert(std::lower_bound(internal_pids_.begin(), internal_pids_.end(), pid), pid);
+
+	/* Prefixes, up to an optional description */
+	unsigned int num_prefixes = 0;
+	if (is >> token)
+	{
+		if (token == "prefixes")
+		{
+			BlockWriteLock prefixes_lock(*prefixes_);
+			/* Like the shell, accept prefixes separated by commas as well as whitespace */
+			while (is >> token && token != "description")
+			{
+				std::istringstream list(token);
+				std::string text;
+				while (std::getline(list, text, ','))
+				{
+					if (text.empty())
+						continue;
+
+					p4p::IPPrefix prefix(text, text.find('/') == std::string::npos ? 32 : USHRT_MAX);
+					if (prefix == p4p::IPPrefix::INVALID)
+					{
+						error(line, "invalid prefix " + text + " in PID " + name);
+						continue;
+					}
+
+					const p4p::PID* owner = prefixes_->lookup(prefix, prefixes_lock);
+					if (!prefixes_->add(prefix, pid, prefixes_lock))
+					{
+						std::string other = owner ? pid_str(*owner) : std::string("another PID");
+						if (owner)
+							aggregation_->reverse_lookup(*owner, other, aggregation_lock);
+						error(line, "prefix " + text + " of PID " + name + " is already in PID " + other);
+						continue;
+					}
+					++num_prefixes;
+				}
+			}
+		}
+		else if (token != "description")
+			error(line, "unexpected '" + token + "' after PID " + name);
+	}
+
+	if (num_prefixes == 0 && !external)
+		warning(line, "internal PID " + name + " has no prefixes");
+}
+
+void PortalConfig::remove_pid(const std::string& name, unsigned int line)
+{
+	BlockWriteLock aggregation_lock(*aggregation_);
+	if (!aggregation_->has(name, aggregation_lock))
+	{
+		error(line, "PID " + name + " is not defined");
+		return;
+	}
+
+	p4p::PID pid = aggregation_->lookup(name, aggregation_lock);
+	aggregation_->remove(pid, aggregation_lock);
+	{
+		BlockWriteLock prefixes_lock(*prefixes_);
+		prefixes_->remove(pid, prefixes_lock);
+	}
+	{
+		BlockWriteLock net_state_lock(*net_state_);
+		net_state_->remove_node(name, net_state_lock);
+	}
+
+	pids_.erase(std::lower_bound(pids_.begin(), pids_.end(), pid));
+	if (!pid.get_external())
+		internal_pids_.erase(std::lower_bound(internal_pids_.begin(), internal_pids_.end(), pid));
+}
+
+void PortalConfig::parse_pid_link(std::istream& is, unsigned int line)
+{
+	static const char* FORMAT = "format: pid link <PID-NAME> <PID-NAME> <PID-LINK> [capacity <capacity>] "
+				    "[traffic {static <volume> | dynamic}] routing-weight <weight> [description <text>]";
+
+	PendingLink link;
+	link.line = line;
+	link.weight = DEFAULT_WEIGHT;
+	link.has_weight = false;
+
+	if (!(is >> link.src >> link.dst >> link.name))
+	{
+		error(line, FORMAT);
+		return;
+	}
+
+	std::string attr;
+	double val;
+	while (is >> attr && attr != "description")
+	{
+		if (attr == "capacity")
+		{
+			if (!(is >> val) || val < 0.0)
+			{
+				error(line, FORMAT);
+				return;
+			}
+		}
+		else if (attr == "traffic")
+		{
+			if (!(is >> attr) || (attr == "static" && !(is >> val)) || (attr != "static" && attr != "dynamic"))
+			{
+				error(line, FORMAT);
+				return;
+			}
+		}
+		else if (attr == "routing-weight")
+		{
+			if (!(is >> link.weight))
+			{
+				error(line, FORMAT);
+				return;
+			}
+			link.has_weight = true;
+		}
+		else
+		{
+			error(line, FORMAT);
+			return;
+		}
+	}
+
+	pending_links_.push_back(link);
+}
+
+void PortalConfig::parse_pdistance(std::istream& is, unsigned int line)
+{
+	std::string token;
+	double value;
+
+	if (!(is >> token))
+	{
+		error(line, "format: pdistance {link | intra-pid | inter-pid | pid-link | interdomain | update | ttl} ...");
+		return;
+	}
+
+	if (token == "link")
+	{
+		PendingPDistance pdistance;
+		pdistance.line = line;
+		if (!(is >> pdistance.link) || !(is >> token) || (token != "static" && token != "dynamic"))
+		{
+			error(line, "format: pdistance link <PID-LINK> {static <pdistance> | dynamic}");
+			return;
+		}
+		if (token == "dynamic")
+			return;
+		if (!(is >> pdistance.value) || pdistance.value < 0.0 || pdistance.value > MAX_PDISTANCE)
+		{
+			error(line, "format: pdistance link <PID-LINK> {static <pdistance> | dynamic}, with 0 <= pdistance <= 100");
+			return;
+		}
+		pending_pdistances_.push_back(pdistance);
+	}
+	else if (token == "intra-pid" || token == "inter-pid" || token == "pid-link")
+	{
+		std::string kind = token;
+		if (!(is >> token) || token != "default" || !(is >> value) || value < 0.0 || value > MAX_PDISTANCE)
+		{
+			error(line, "format: pdistance " + kind + " default <pdistance>, with 0 <= pdistance <= 100");
+			return;
+		}
+		if (kind == "intra-pid")
+			intrapid_pdistance_ = value;
+		else if (kind == "inter-pid")
+			interpid_pdistance_ = value;
+		else
+			pidlink_pdistance_ = value;
+	}
+	else if (token == "interdomain" || token == "update" || token == "ttl")
+	{
+		/* Only affect interdomain pDistances and when they are sent */
+	}
+	else
+		error(line, "unknown pdistance setting '" + token + "'");
+}
+
+void PortalConfig::finish()
+{
+	/* Size the matrix once rather than for each PID */
+	BlockWriteLock link_pdistances_lock(*link_pdistances_);
+	link_pdistances_->add_pids(pids_, link_pdistances_lock);
+
+	BlockWriteLock net_state_lock(*net_state_);
+	BlockWriteLock aggregation_lock(*aggregation_);
+
+	std::set<p4p::PID> linked;
+	BOOST_FOREACH(const PendingLink& link, pending_links_)
+	{
+		if (!aggregation_->has(link.src, aggregation_lock))
+		{
+			error(link.line, "PID link " + link.name + " starts at unknown PID " + link.src);
+			continue;
+		}
+		if (!aggregation_->has(link.dst, aggregation_lock))
+		{
+			error(link.line, "PID link " + link.name + " ends at unknown PID " + link.dst);
+			continue;
+		}
+		/* The server accepts loops (the example configurations define one per
+		 * internal PID); they never lie on a shortest path */
+		if (link.src == link.dst)
+			warning(link.line, "PID link " + link.name + " is a loop at PID " + link.src);
+
+		p4p::PID src = aggregation_->lookup(link.src, aggregation_lock);
+		p4p::PID dst = aggregation_->lookup(link.dst, aggregation_lock);
+
+		p4p::PIDLinkName other;
+		if (aggregation_->get_link(src, dst, other, aggregation_lock))
+		{
+			error(link.line, "PID link " + link.name + " duplicates PID link " + other + " from " + link.src + " to " + link.dst);
+			continue;
+		}
+		if (!aggregation_->define_link(link.name, src, dst, aggregation_lock))
+		{
+			error(link.line, "PID link " + link.name + " is already defined");
+			continue;
+		}
+
+		NetEdge e;
+		net_state_->add_edge(link.src, link.dst, e, net_state_lock);
+		net_state_->set_name(e, link.name, net_state_lock);
+
+		if (!link.has_weight)
+			warning(link.line, "PID link " + link.name + " has no routing weight; it gets " + boost::lexical_cast<std::string>(DEFAULT_WEIGHT));
+		else if (link.weight <= 0.0)
+			warning(link.line, "PID link " + link.name + " has a routing weight which is not positive");
+
+		links_.push_back(Link(link.name, src, dst, link.weight));
+		linked.insert(src);
+		linked.insert(dst);
+	}
+
+	std::set<std::string> with_pdistance;
+	BOOST_FOREACH(const PendingPDistance& pdistance, pending_pdistances_)
+	{
+		p4p::PID src, dst;
+		if (!aggregation_->get_link(pdistance.link, src, dst, aggregation_lock))
+		{
+			error(pdistance.line, "pDistance for unknown PID link " + pdistance.link);
+			continue;
+		}
+		if (!with_pdistance.insert(pdistance.link).second)
+			warning(pdistance.line, "pDistance of PID link " + pdistance.link + " set again");
+		link_pdistances_->set_by_pid(src, dst, pdistance.value, link_pdistances_lock);
+	}
+
+	BOOST_FOREACH(const PendingLink& link, pending_links_)
+	{
+		PIDAggregation::LinkRecordsByName::const_iterator itr = aggregation_->get_link_map(aggregation_lock).find(link.name);
+		if (itr == aggregation_->get_link_map(aggregation_lock).end() || with_pdistance.count(link.name) > 0)
+			continue;
+		warning(link.line, "PID link " + link.name + " has no static pDistance; it gets the pid-link default "
+			+ boost::lexical_cast<std::string>(pidlink_pdistance_));
+	}
+
+	if (pids_.size() > 1)
+	{
+		BOOST_FOREACH(const p4p::PID& pid, pids_)
+		{
+			if (linked.count(pid) > 0)
+				continue;
+			std::string name;
+			aggregation_->reverse_lookup(pid, name, aggregation_lock);
+			warning(0, "PID " + name + " has no PID links");
+		}
+	}
+
+	pending_links_.clear();
+	pending_pdistances_.clear();
+}
+
+PIDRoutingPtr PortalConfig::create_routing() const
+{
+	PIDRoutingPtr routing(new PIDRouting(DEFAULT_WEIGHT));
+	BlockWriteLock routing_lock(*routing);
+
+	routing->add_pids(p4p::PIDSet(pids_.begin(), pids_.end()), routing_lock);
+	BOOST_FOREACH(const Link& link, links_)
+		routing->set_weight(link.src, link.dst, link.weight, routing_lock);
+	routing->set_route_mode(route_mode_, routing_lock);
+
+	return routing;
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#ifndef PORTAL_CONFIG_H
+#define PORTAL_CONFIG_H
+
+#include <istream>
+#include <string>
+#include <vector>
+#include <p4p/pid.h>
+#include <p4pserver/net_state.h>
+#include <p4pserver/pid_aggregation.h>
+#include <p4pserver/pid_map.h>
+#include <p4pserver/pid_matrix.h>
+#include <p4pserver/pid_routing.h>
+
+/* Something wrong found in a configuration or in its routes */
+struct ConfigProblem
+{
+	enum Severity
+	{
+		WARNING,
+		ERROR,
+	};
+
+	ConfigProblem(Severity severity, unsigned int line, const std::string& message)
+		: severity(severity), line(line), message(message)
+	{}
+
+	Severity	severity;
+	unsigned int	line;		/**< Line of the configuration file, or 0 */
+	std::string	message;
+};
+typedef std::vector<ConfigProblem> ConfigProblemVector;
+
+/*
+ * A portal configuration file (the format loaded by the portal shell)
+ * held in the server's own state objects, as the DEFAULT view has it
+ * once the shell has sent the configuration: each PID is a node of the
+ * same name, each PID link an edge with the link's name.
+ *
+ * Commands the portal does not act on (traffic, dynamic update rules,
+ * TTLs, interdomain settings) are accepted and ignored.
+ */
+class PortalConfig
+{
+public:
+	/* A PID link and its routing weight */
+	struct Link
+	{
+		Link(const std::string& name, const p4p::PID& src, const p4p::PID& dst, double weight)
+			: name(name), src(src), dst(dst), weight(weight)
+		{}
+
+		std::string	name;
+		p4p::PID	src;
+		p4p::PID	dst;
+		double		weight;
+	};
+	typedef std::vector<Link> LinkVector;
+
+	PortalConfig();
+
+	/* Read a configuration. Problems are recorded rather than thrown;
+	 * the lines with errors are left out. */
+	void load(std::istream& is);
+
+	const ConfigProblemVector& get_problems() const		{ return problems_; }
+
+	NetStatePtr get_net_state() const			{ return net_state_; }
+	PIDAggregationPtr get_aggregation() const		{ return aggregation_; }
+	PIDMapPtr get_prefixes() const				{ return prefixes_; }
+	SparsePIDMatrixPtr get_link_pdistances() const		{ return link_pdistances_; }
+
+	/* PIDs ordered by PID, and the subset which are internal */
+	const p4p::PIDVector& get_pids() const			{ return pids_; }
+	const p4p::PIDVector& get_internal_pids() const		{ return internal_pids_; }
+	const LinkVector& get_links() const			{ return links_; }
+
+	PIDRouting::RouteMode get_route_mode() const		{ return route_mode_; }
+
+	/* A routing object with the configured mode and link weights. Copies
+	 * of a PIDRouting share their shortest-path trees (and a mutex), so
+	 * threads computing routes at the same time each create their own. */
+	PIDRoutingPtr create_routing() const;
+
+	/* Defaults, the same as those of a view which doesn't set them */
+	double get_intrapid_pdistance() const			{ return intrapid_pdistance_; }
+	double get_interpid_pdistance() const			{ return interpid_pdistance_; }
+	double get_pidlink_pdistance() const			{ return pidlink_pdistance_; }
+
+private:
+	struct PendingLink
+	{
+		unsigned int	line;
+		std::string	name;
+		std::string	src;
+		std::string	dst;
+		double		weight;
+		bool		has_weight;
+	};
+
+	struct PendingPDistance
+	{
+		unsigned int	line;
+		std::string	link;
+		double		value;
+	};
+
+	void error(unsigned int line, const std::string& message)	{ problems_.push_back(ConfigProblem(ConfigProblem::ERROR, line, message)); }
+	void warning(unsigned int line, const std::string& message)	{ problems_.push_back(ConfigProblem(ConfigProblem::WARNING, line, message)); }
+
+	void parse_line(std::istream& is, unsigned int line);
+	void parse_pid(std::istream& is, unsigned int line);
+	void parse_pid_link(std::istream& is, unsigned int line);
+	void remove_pid(const std::string& name, unsigned int line);
+	void parse_pdistance(std::istream& is, unsigned int line);
+
+	/* Resolve links and link pDistances once all PIDs are known */
+	void finish();
+
+	NetStatePtr net_state_;
+	PIDAggregationPtr aggregation_;
+	PIDMapPtr prefixes_;
+	SparsePIDMatrixPtr link_pdistances_;
+
+	std::string isp_;
+	p4p::PIDVector pids_;
+	p4p::PIDVector internal_pids_;
+	LinkVector links_;
+
+	std::vector<PendingLink> pending_links_;
+	std::vector<PendingPDistance> pending_pdistances_;
+
+	PIDRouting::RouteMode route_mode_;
+	double intrapid_pdistance_;
+	double interpid_pdistance_;
+	double pidlink_pdistance_;
+
+	ConfigProblemVector problems_;
+};
+
+#endif
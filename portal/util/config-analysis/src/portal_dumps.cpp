@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "portal_dumps.h"
+
+#include <cctype>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <p4p/ip_addr.h>
+
+/* Whether a line of a dump carries no record */
+static bool skip_line(const std::string& line)
+{
+	return line.empty() || line[0] == '#' || isspace((unsigned char)line[0]);
+}
+
+static std::runtime_error format_error(unsigned int line, const std::string& text)
+{
+	return std::runtime_error("Malformed line " + boost::lexical_cast<std::string>(line) + ": " + text);
+}
+
+void read_pdistances(std::istream& is, PDistanceVector& result)
+{
+	std::string text;
+	unsigned int line = 0;
+	while (std::getline(is, text))
+	{
+		++line;
+		if (skip_line(text))
+			continue;
+
+		std::istringstream line_is(text);
+		p4p::PID src, dst;
+		std::string value;
+		if (!(line_is >> src >> dst >> value))
+			throw format_error(line, text);
+
+		/* Disconnected pairs may have an infinite pDistance */
+		try
+		{
+			result.push_back(PDistanceEntry(src, dst, value == "inf" ? INFINITY : boost::lexical_cast<double>(value)));
+		}
+		catch (boost::bad_lexical_cast& e)
+		{
+			throw format_error(line, text);
+		}
+	}
+}
+
+void write_pdistances(std::ostream& os, const PDistanceVector& pdistances)
+{
+	BOOST_FOREACH(const PDistanceEntry& entry, pdistances)
+		os << entry.src << '\t' << entry.dst << '\t' << entry.value << '\n';
+}
+
+void read_pid_map(std::istream& is, PIDMap& result, const WritableLock& lock)
+{
+	std::string text;
+	unsigned int line = 0;
+	while (std::getline(is, text))
+	{
+		++line;
+		if (skip_line(text))
+			continue;
+
+		std::istringstream line_is(text);
+		p4p::PID pid;
+		if (!(line_is >> pid))
+			throw format_error(line, text);
+
+		p4p::IPPrefix prefix;
+		while (line_is >> prefix)
+		{
+			if (!result.add(prefix, pid, lock))
+				throw std::runtime_error("Prefix on line " + boost::lexical_cast<std::string>(line) + " is already in another PID: " + text);
+		}
+		if (!line_is.eof())
+			throw format_error(line, text);
+	}
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#ifndef PORTAL_DUMPS_H
+#define PORTAL_DUMPS_H
+
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <p4p/pid.h>
+#include <p4pserver/locking.h>
+#include <p4pserver/pid_map.h>
+
+/* pDistance from one PID to another */
+struct PDistanceEntry
+{
+	PDistanceEntry(const p4p::PID& src, const p4p::PID& dst, double value)
+		: src(src), dst(dst), value(value)
+	{}
+
+	bool operator<(const PDistanceEntry& rhs) const
+	{
+		return src < rhs.src || (src == rhs.src && dst < rhs.dst);
+	}
+
+	p4p::PID	src;
+	p4p::PID	dst;
+	double		value;
+};
+typedef std::vector<PDistanceEntry> PDistanceVector;
+
+/*
+ * Read the output of the portal shell's "show pdistance": one
+ * "<source PID> <destination PID> <pDistance>" line per PID pair.
+ * Blank lines, lines starting with '#' and indented lines (the verbose
+ * TTL and version) are skipped. Throws std::runtime_error on a
+ * malformed line.
+ */
+void read_pdistances(std::istream& is, PDistanceVector& result);
+
+/* Write pDistances in the format read_pdistances() reads */
+void write_pdistances(std::ostream& os, const PDistanceVector& pdistances);
+
+/*
+ * Read the output of the portal shell's "show pidmap" into a PID map:
+ * one "<PID> <prefix> <prefix> ..." line per PID, skipping the same
+ * lines as read_pdistances(). Throws std::runtime_error on a malformed
+ * line.
+ */
+void read_pid_map(std::istream& is, PIDMap& result, const WritableLock& lock);
+
+#endif
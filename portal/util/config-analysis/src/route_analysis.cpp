@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "route_analysis.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/thread/thread.hpp>
+#include <p4pserver/locking.h>
+
+struct RouteAnalysis::Worker
+{
+	Worker(const PortalConfig& config)
+		: routing(config.create_routing()),
+		  routing_lock(*routing),
+		  net_state_lock(*config.get_net_state()),
+		  routes(0),
+		  unreachable(0),
+		  invalid(0)
+	{}
+
+	PIDRoutingPtr routing;
+	BlockReadLock routing_lock;
+	BlockReadLock net_state_lock;
+	PIDRouting::RouteComputationContext context;
+
+	/* Vertex index of each internal PID, and values accumulated toward
+	 * a destination, for ECMP routing */
+	std::vector<unsigned int> internal_verts;
+	std::vector<double> cost;
+	std::vector<char> reached;
+
+	/* Nodes on the route being checked */
+	std::vector<NetVertex> visited;
+
+	unsigned long long routes;
+	unsigned long long unreachable;
+	unsigned long long invalid;
+};
+
+RouteAnalysis::RouteAnalysis(const PortalConfig& config)
+	: config_(config),
+	  pids_(config.get_internal_pids()),
+	  problems_(config.get_internal_pids().size()),
+	  multipath_(false),
+	  next_(0),
+	  routes_(0),
+	  unreachable_(0),
+	  invalid_(0)
+{
+	NetStatePtr net_state = config_.get_net_state();
+	PIDAggregationPtr aggregation = config_.get_aggregation();
+	SparsePIDMatrixPtr link_pdistances = config_.get_link_pdistances();
+	BlockReadLock net_state_lock(*net_state);
+	BlockReadLock aggregation_lock(*aggregation);
+	BlockReadLock link_pdistances_lock(*link_pdistances);
+
+	BOOST_FOREACH(const p4p::PID& pid, config_.get_pids())
+	{
+		std::string name;
+		NetVertex v;
+		aggregation->reverse_lookup(pid, name, aggregation_lock);
+		net_state->get_node(name, v, net_state_lock);
+		all_.insert(PinnedPID(pid, v));
+		if (!pid.get_external())
+		{
+			internal_.push_back(PinnedPID(pid, v));
+			names_.push_back(name);
+		}
+	}
+
+	multipath_ = config_.get_route_mode() == PIDRouting::RM_ECMP;
+	BOOST_FOREACH(const PortalConfig::Link& link, config_.get_links())
+	{
+		NetVertex src = all_.find(PinnedPID(link.src, NULL))->get_vertex();
+		NetVertex dst = all_.find(PinnedPID(link.dst, NULL))->get_vertex();
+		links_[NetVertexPair(src, dst)] = link_pdistances->get_by_pid(link.src, link.dst, link_pdistances_lock,
+									      config_.get_pidlink_pdistance());
+		if (link.weight <= 0.0)
+			multipath_ = false;
+	}
+
+	if (config_.get_route_mode() == PIDRouting::RM_ECMP && !multipath_ && !problems_.empty())
+		problems_[0].push_back(ConfigProblem(ConfigProblem::WARNING, 0,
+			"ECMP routing needs positive routing weights; the portal uses single paths instead"));
+}
+
+void RouteAnalysis::run(unsigned int threads)
+{
+	unsigned int n = pids_.size();
+	pdistances_.assign(n * n, 0.0);
+	threads = std::max(1u, std::min(threads, n));
+
+	boost::thread_group workers;
+	for (unsigned int i = 0; i < threads; ++i)
+		workers.create_thread(boost::bind(&RouteAnalysis::work, this));
+	workers.join_all();
+}
+
+bool RouteAnalysis::next_item(unsigned int& result)
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	if (next_ >= pids_.size())
+		return false;
+	result = next_++;
+	return true;
+}
+
+void RouteAnalysis::work()
+{
+	Worker worker(config_);
+
+	unsigned int item;
+	while (next_item(item))
+	{
+		if (!multipath_)
+			compute_source(worker, item);
+		else if (!compute_destination(worker, item))
+			throw std::runtime_error("Illegal state: multipath routes failed with positive weights");
+	}
+
+	boost::mutex::scoped_lock lock(mutex_);
+	routes_ += worker.routes;
+	unreachable_ += worker.unreachable;
+	invalid_ += worker.invalid;
+}
+
+bool RouteAnalysis::trace_route(Worker& worker, unsigned int src, unsigned int dst, const PIDRouting::PinnedRoute& route, double& result)
+{
+	const NetState& net_state = *config_.get_net_state();
+	std::ostringstream problem;
+	problem << "route from " << names_[src] << " to " << names_[dst];
+
+	if (route.size() < 2 || route.front().get_vertex() != internal_[src].get_vertex() || route.back().get_vertex() != internal_[dst].get_vertex())
+	{
+		problem << " does not run between them";
+		problems_[src].push_back(ConfigProblem(ConfigProblem::ERROR, 0, problem.str()));
+		return false;
+	}
+
+	worker.visited.clear();
+	result = 0.0;
+	for (unsigned int hop = 0; hop < route.size(); ++hop)
+	{
+		const NetVertex& v = route[hop].get_vertex();
+		if (std::find(worker.visited.begin(), worker.visited.end(), v) != worker.visited.end())
+		{
+			problem << " visits " << net_state.get_name(v, worker.net_state_lock) << " twice";
+			problems_[src].push_back(ConfigProblem(ConfigProblem::ERROR, 0, problem.str()));
+			return false;
+		}
+		worker.visited.push_back(v);
+
+		if (hop == 0)
+			continue;
+
+		const NetVertex& prev = route[hop - 1].get_vertex();
+		LinkPDistanceMap::const_iterator link = links_.find(NetVertexPair(prev, v));
+		if (link == links_.end())
+		{
+			problem << " goes from " << net_state.get_name(prev, worker.net_state_lock)
+				<< " to " << net_state.get_name(v, worker.net_state_lock) << " without a PID link";
+			problems_[src].push_back(ConfigProblem(ConfigProblem::ERROR, 0, problem.str()));
+			return false;
+		}
+		result += link->second;
+	}
+	return true;
+}
+
+void RouteAnalysis::compute_source(Worker& worker, unsigned int src)
+{
+	unsigned int n = pids_.size();
+	double* row = &pdistances_[src * n];
+
+	worker.routing->get_routes(internal_[src], *config_.get_net_state(), worker.net_state_lock,
+				   all_, worker.context, worker.routing_lock);
+	const PIDRouting::PinnedRouteMap& routes = worker.context.get_result();
+	const PIDRouting::PinnedRouteSplitMap& splits = worker.context.get_splits();
+
+	unsigned int unreachable = 0, first_unreachable = 0;
+	for (unsigned int dst = 0; dst < n; ++dst)
+	{
+		if (dst == src)
+		{
+			row[dst] = config_.get_intrapid_pdistance();
+			continue;
+		}
+
+		PIDRouting::PinnedRouteMap::const_iterator route_itr = routes.find(internal_[dst]);
+		if (route_itr == routes.end())
+		{
+			if (unreachable++ == 0)
+				first_unreachable = dst;
+			row[dst] = config_.get_interpid_pdistance();
+			continue;
+		}
+		++worker.routes;
+
+		/* Weigh each route by its share if traffic is split between several */
+		PIDRouting::PinnedRouteSplitMap::const_iterator split_itr = splits.find(internal_[dst]);
+		double p = 0.0;
+		bool valid = true;
+		if (split_itr == splits.end())
+			valid = trace_route(worker, src, dst, route_itr->second, p);
+		else
+		{
+			for (unsigned int i = 0; valid && i < split_itr->second.size(); ++i)
+			{
+				double route_p;
+				valid = trace_route(worker, src, dst, split_itr->second[i].first, route_p);
+				p += split_itr->second[i].second * route_p;
+			}
+		}
+		if (!valid)
+			++worker.invalid;
+		row[dst] = p;
+	}
+
+	if (unreachable > 0)
+	{
+		std::ostringstream problem;
+		problem << "no route from " << names_[src] << " to " << unreachable << " of " << n - 1
+			<< " internal PIDs (such as " << names_[first_unreachable] << ")";
+		problems_[src].push_back(ConfigProblem(ConfigProblem::WARNING, 0, problem.str()));
+		worker.unreachable += unreachable;
+	}
+}
+
+bool RouteAnalysis::compute_destination(Worker& worker, unsigned int dst)
+{
+	unsigned int n = pids_.size();
+	PIDRouting::RouteComputationContext& context = worker.context;
+
+	if (!worker.routing->get_multipath(internal_[dst], *config_.get_net_state(), worker.net_state_lock,
+					   context, worker.routing_lock))
+		return false;
+
+	if (worker.internal_verts.empty())
+	{
+		unsigned int num_verts = config_.get_net_state()->get_num_nodes(worker.net_state_lock);
+		worker.internal_verts.resize(n);
+		for (unsigned int i = 0; i < n; ++i)
+			context.get_vertex_index(internal_[i].get_vertex(), worker.internal_verts[i]);
+		worker.cost.resize(num_verts);
+	}
+
+	/* Expected pDistance from each node to the destination, nearest first */
+	const std::vector<unsigned int>& order = context.get_multipath_order();
+	worker.reached.assign(worker.cost.size(), 0);
+	worker.routes += order.size() - 1;
+	BOOST_FOREACH(unsigned int x, order)
+	{
+		worker.reached[x] = 1;
+		double c = 0.0;
+		PIDRouting::MultipathHopRange hops = context.get_multipath_hops(x);
+		for (PIDRouting::MultipathHopVector::const_iterator h = hops.first; h != hops.second; ++h)
+		{
+			LinkPDistanceMap::const_iterator link = links_.find(NetVertexPair(context.get_vertex(x), context.get_vertex(h->vertex)));
+			if (link == links_.end())
+			{
+				const NetState& net_state = *config_.get_net_state();
+				std::ostringstream problem;
+				problem << "routes to " << names_[dst] << " go from " << net_state.get_name(context.get_vertex(x), worker.net_state_lock)
+					<< " to " << net_state.get_name(context.get_vertex(h->vertex), worker.net_state_lock) << " without a PID link";
+				problems_[dst].push_back(ConfigProblem(ConfigProblem::ERROR, 0, problem.str()));
+				++worker.invalid;
+				continue;
+			}
+			c += h->fraction * (link->second + worker.cost[h->vertex]);
+		}
+		worker.cost[x] = c;
+	}
+
+	unsigned int dst_idx = order.front();
+	unsigned int unreachable = 0, first_unreachable = 0;
+	for (unsigned int src = 0; src < n; ++src)
+	{
+		unsigned int x = worker.internal_verts[src];
+		double p;
+		if (x == dst_idx)
+			p = config_.get_intrapid_pdistance();
+		else if (worker.reached[x])
+			p = worker.cost[x];
+		else
+		{
+			if (unreachable++ == 0)
+				first_unreachable = src;
+			p = config_.get_interpid_pdistance();
+		}
+		pdistances_[src * n + dst] = p;
+	}
+
+	if (unreachable > 0)
+	{
+		std::ostringstream problem;
+		problem << "no route to " << names_[dst] << " from " << unreachable << " of " << n - 1
+			<< " internal PIDs (such as " << names_[first_unreachable] << ")";
+		problems_[dst].push_back(ConfigProblem(ConfigProblem::WARNING, 0, problem.str()));
+		worker.unreachable += unreachable;
+	}
+	return true;
+}
+
+void RouteAnalysis::get_pdistances(PDistanceVector& result) const
+{
+	unsigned int n = pids_.size();
+	result.clear();
+	result.reserve(n * n);
+	for (unsigned int src = 0; src < n; ++src)
+	{
+		for (unsigned int dst = 0; dst < n; ++dst)
+			result.push_back(PDistanceEntry(pids_[src], pids_[dst], pdistances_[src * n + dst]));
+	}
+}
+
+void RouteAnalysis::get_problems(ConfigProblemVector& result) const
+{
+	BOOST_FOREACH(const ConfigProblemVector& problems, problems_)
+		result.insert(result.end(), problems.begin(), problems.end());
+}
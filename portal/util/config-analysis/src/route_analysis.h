@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#ifndef ROUTE_ANALYSIS_H
+#define ROUTE_ANALYSIS_H
+
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
+#include <boost/functional/hash.hpp>
+#include <boost/thread/mutex.hpp>
+#include <p4p/pid.h>
+#include "portal_config.h"
+#include "portal_dumps.h"
+
+/*
+ * Intradomain pDistances of a configuration, computed as a view update
+ * does: along the routes PIDRouting picks (split evenly over equal-cost
+ * next hops with ECMP routing), adding up the link pDistances. Routes
+ * are checked on the way: each must run from its source to its
+ * destination without revisiting a PID, over defined PID links.
+ *
+ * Source PIDs (destination PIDs with ECMP routing) are shared out to
+ * worker threads, each with its own routing object.
+ */
+class RouteAnalysis
+{
+public:
+	RouteAnalysis(const PortalConfig& config);
+
+	void run(unsigned int threads);
+
+	/* pDistances between all internal PIDs, ordered by source and destination */
+	void get_pdistances(PDistanceVector& result) const;
+
+	/* Problems found in the routes, ordered by PID */
+	void get_problems(ConfigProblemVector& result) const;
+
+	unsigned long long get_routes() const			{ return routes_; }
+	unsigned long long get_unreachable() const		{ return unreachable_; }
+	unsigned long long get_invalid() const			{ return invalid_; }
+
+private:
+	typedef std::tr1::unordered_map<NetVertexPair, double, boost::hash<NetVertexPair> > LinkPDistanceMap;
+
+	/* State of one worker thread */
+	struct Worker;
+
+	void work();
+	bool next_item(unsigned int& result);
+
+	void compute_source(Worker& worker, unsigned int src);
+	bool compute_destination(Worker& worker, unsigned int dst);
+
+	/* Check a route from internal PID 'src' to internal PID 'dst' and add up its pDistance */
+	bool trace_route(Worker& worker, unsigned int src, unsigned int dst, const PIDRouting::PinnedRoute& route, double& result);
+
+	const PortalConfig& config_;
+	const p4p::PIDVector& pids_;
+
+	/* Internal PIDs with their nodes, and all PIDs */
+	std::vector<PinnedPID> internal_;
+	std::vector<std::string> names_;
+	PinnedPIDSet all_;
+
+	/* pDistance of each PID link, by its nodes: the static pDistance
+	 * if one is configured, else the pid-link default */
+	LinkPDistanceMap links_;
+
+	/* pdistances_[src * n + dst] */
+	std::vector<double> pdistances_;
+
+	/* Problems found from (or with ECMP routing, to) each PID */
+	std::vector<ConfigProblemVector> problems_;
+
+	/* Whether ECMP routing can be followed; it needs positive weights */
+	bool multipath_;
+
+	boost::mutex mutex_;
+	unsigned int next_;
+	unsigned long long routes_;
+	unsigned long long unreachable_;
+	unsigned long long invalid_;
+};
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "test_config.h"
+
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+
+/* Prefix of the first PID; the others follow on */
+static const unsigned int FIRST_ADDRESS = (1 << 24) | (2 << 16) | (3 << 8);
+
+struct TestLink
+{
+	TestLink(unsigned int src, unsigned int dst, const std::string& pdistance)
+		: src(src), dst(dst), pdistance(pdistance)
+	{}
+
+	unsigned int src;
+	unsigned int dst;
+	std::string pdistance;
+};
+
+static unsigned int number(std::map<std::string, unsigned int>& pids, const std::string& name)
+{
+	std::map<std::string, unsigned int>::iterator itr = pids.find(name);
+	if (itr == pids.end())
+		itr = pids.insert(std::make_pair(name, (unsigned int)pids.size())).first;
+	return itr->second;
+}
+
+void write_test_config(std::istream& is, const std::string& isp, std::ostream& os)
+{
+	std::map<std::string, unsigned int> pids;
+	std::vector<TestLink> links;
+	std::map<std::pair<unsigned int, unsigned int>, unsigned int> link_index;
+
+	std::string text;
+	unsigned int line = 0;
+	while (std::getline(is, text))
+	{
+		++line;
+		std::istringstream line_is(text);
+		std::string src, dst, pdistance;
+		if (!(line_is >> src))
+			continue;
+		if (!(line_is >> dst >> pdistance))
+			throw std::runtime_error("Malformed line " + boost::lexical_cast<std::string>(line) + ": " + text);
+
+		unsigned int src_num = number(pids, src);
+		unsigned int dst_num = number(pids, dst);
+		if (src_num == dst_num)
+			continue;
+
+		/* A pair given again keeps its place but takes the later pDistance */
+		std::pair<unsigned int, unsigned int> pair(src_num, dst_num);
+		std::map<std::pair<unsigned int, unsigned int>, unsigned int>::iterator itr = link_index.find(pair);
+		if (itr != link_index.end())
+		{
+			links[itr->second].pdistance = pdistance;
+			continue;
+		}
+		link_index[pair] = links.size();
+		links.push_back(TestLink(src_num, dst_num, pdistance));
+	}
+
+	os << "version 2.1\n\n";
+	os << "isp default " << isp << "\n\n";
+
+	for (unsigned int i = 0; i < pids.size(); ++i)
+	{
+		unsigned int addr = FIRST_ADDRESS + i;
+		os << "pid internal " << i << " pid" << i << " prefixes "
+		   << (addr >> 24) << '.' << ((addr >> 16) & 0xff) << '.' << ((addr >> 8) & 0xff) << '.' << (addr & 0xff) << "/32\n";
+	}
+	os << "\n";
+
+	BOOST_FOREACH(const TestLink& link, links)
+		os << "pid link pid" << link.src << " pid" << link.dst << " link-" << link.src << "-" << link.dst
+		   << " capacity 10.0 traffic static 1.0 routing-weight 100\n";
+	os << "\n";
+	os << "pid routing weights\n";
+
+	BOOST_FOREACH(const TestLink& link, links)
+		os << "pdistance link link-" << link.src << "-" << link.dst << " static " << link.pdistance << "\n";
+	os << "\n";
+
+	os << "pdistance intra-pid default 0\n";
+	os << "pdistance inter-pid default 10\n";
+	os << "pdistance interdomain exclude intradomain\n";
+	os << "pdistance interdomain default 65\n";
+	os << "pdistance update\n";
+}
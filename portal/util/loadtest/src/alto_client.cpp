@@ -0,0 +1,782 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "alto_client.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include "options.h"
+
+static const char* REQUEST_NAMES[ALTO_NUM_REQUEST_TYPES] = {
+	"networkmap",
+	"networkmap-filtered",
+	"costmap",
+	"costmap-filtered",
+	"endpointprop",
+	"endpointcost",
+};
+
+static boost::mutex SUMMARY_MUTEX;
+static AltoStats SUMMARY[ALTO_NUM_REQUEST_TYPES];
+
+static unsigned long long now_usec()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return 1000000ULL * tv.tv_sec + tv.tv_usec;
+}
+
+AltoStats::AltoStats()
+	: ok(0),
+	  unavailable(0),
+	  http_errors(0),
+	  failures(0),
+	  timeouts(0),
+	  dropped(0),
+	  bytes(0)
+{
+}
+
+void AltoStats::merge(const AltoStats& rhs)
+{
+	latency.merge(rhs.latency);
+	ok += rhs.ok;
+	unavailable += rhs.unavailable;
+	http_errors += rhs.http_errors;
+	failures += rhs.failures;
+	timeouts += rhs.timeouts;
+	dropped += rhs.dropped;
+	bytes += rhs.bytes;
+}
+
+HttpResponseParser::HttpResponseParser()
+{
+	reset();
+}
+
+void HttpResponseParser::reset()
+{
+	state_ = HEADERS;
+	buf_.clear();
+	remaining_ = 0;
+	bytes_ = 0;
+	status_ = 0;
+	keep_alive_ = false;
+}
+
+bool HttpResponseParser::parse_headers(const std::string& headers)
+{
+	/* Status line: HTTP/1.x NNN Reason */
+	if (headers.compare(0, 7, "HTTP/1.") != 0 || headers.size() < 12)
+		return false;
+	status_ = atoi(headers.c_str() + 9);
+	keep_alive_ = headers[7] == '1';
+
+	state_ = BODY_CLOSE;
+	std::istringstream lines(headers);
+	std::string line;
+	std::getline(lines, line);
+	while (std::getline(lines, line))
+	{
+		std::string::size_type colon = line.find(':');
+		if (colon == std::string::npos)
+			continue;
+
+		std::string name = line.substr(0, colon);
+		std::string value = line.substr(colon + 1);
+		for (std::string::size_type i = 0; i < name.size(); ++i)
+			name[i] = tolower(name[i]);
+		for (std::string::size_type i = 0; i < value.size(); ++i)
+			value[i] = tolower(value[i]);
+
+		if (name == "content-length")
+		{
+			state_ = BODY_LENGTH;
+			remaining_ = strtoull(value.c_str(), NULL, 10);
+		}
+		else if (name == "transfer-encoding" && value.find("chunked") != std::string::npos)
+			state_ = CHUNK_SIZE;
+		else if (name == "connection" && value.find("close") != std::string::npos)
+			keep_alive_ = false;
+	}
+
+	/* Responses without a body */
+	if ((status_ >= 100 && status_ < 200) || status_ == 204 || status_ == 304)
+		state_ = DONE;
+	else if (state_ == BODY_LENGTH && remaining_ == 0)
+		state_ = DONE;
+	else if (state_ == BODY_CLOSE)
+		keep_alive_ = false;
+	return true;
+}
+
+bool HttpResponseParser::feed(const char* data, size_t len)
+{
+	bytes_ += len;
+	buf_.append(data, len);
+
+	std::string::size_type pos = 0;
+	while (state_ != DONE)
+	{
+		if (state_ == HEADERS)
+		{
+			std::string::size_type end = buf_.find("\r\n\r\n", pos);
+			if (end == std::string::npos)
+				break;
+			if (!parse_headers(buf_.substr(pos, end - pos)))
+				return false;
+			pos = end + 4;
+		}
+		else if (state_ == BODY_LENGTH || state_ == CHUNK_DATA)
+		{
+			unsigned long long n = std::min<unsigned long long>(remaining_, buf_.size() - pos);
+			pos += n;
+			remaining_ -= n;
+			if (remaining_ > 0)
+				break;
+			state_ = state_ == BODY_LENGTH ? DONE : CHUNK_SIZE;
+		}
+		else if (state_ == BODY_CLOSE)
+		{
+			pos = buf_.size();
+			break;
+		}
+		else
+		{
+			/* CHUNK_SIZE and CHUNK_TRAILER both consume one line at a time */
+			std::string::size_type end = buf_.find("\r\n", pos);
+			if (end == std::string::npos)
+				break;
+			std::string line = buf_.substr(pos, end - pos);
+			pos = end + 2;
+
+			if (state_ == CHUNK_TRAILER)
+			{
+				if (line.empty())
+					state_ = DONE;
+			}
+			else if (line.empty())
+			{
+				/* CRLF terminating the previous chunk's data */
+			}
+			else
+			{
+				char* endp;
+				remaining_ = strtoull(line.c_str(), &endp, 16);
+				if (endp == line.c_str())
+					return false;
+				state_ = remaining_ == 0 ? CHUNK_TRAILER : CHUNK_DATA;
+			}
+		}
+	}
+
+	buf_.erase(0, pos);
+	return true;
+}
+
+bool HttpResponseParser::close()
+{
+	if (state_ == BODY_CLOSE)
+		state_ = DONE;
+	return state_ == DONE;
+}
+
+AltoClientThread::AltoClientThread()
+	: server_(OPTIONS["server"].as<std::string>()),
+	  port_(OPTIONS["port"].as<unsigned short>()),
+	  rate_(OPTIONS["alto-rate"].as<double>()),
+	  connections_(OPTIONS["alto-connections"].as<unsigned int>()),
+	  filter_size_(OPTIONS["alto-filter-size"].as<unsigned int>()),
+	  timeout_(1000ULL * OPTIONS["alto-timeout"].as<unsigned int>()),
+	  max_backlog_(OPTIONS["alto-backlog"].as<unsigned int>()),
+	  persistent_(OPTIONS.count("persistent") > 0),
+	  seed_(0)
+{
+	if (rate_ <= 0)
+		throw std::runtime_error("Invalid value for alto-rate");
+	if (connections_ == 0)
+		throw std::runtime_error("Invalid value for alto-connections");
+
+	parse_mix(OPTIONS["alto-mix"].as<std::string>());
+
+	/* Endpoint addresses are drawn from the same prefix as GetPIDs */
+	std::string prefix_str = OPTIONS["getpids-prefix"].as<std::string>();
+	std::string::size_type prefix_slash_pos = prefix_str.rfind('/');
+	if (prefix_slash_pos == std::string::npos)
+		throw std::runtime_error("Invalid value for getpids-prefix");
+	unsigned int prefix_length = boost::lexical_cast<unsigned int>(prefix_str.substr(prefix_slash_pos + 1));
+	if (prefix_length > 32)
+		throw std::runtime_error("Invalid value for getpids-prefix");
+	prefix_mask_ = prefix_length == 32 ? 0 : 0xffffffffU >> prefix_length;
+	struct in_addr addrv4;
+	if (inet_pton(AF_INET, prefix_str.substr(0, prefix_slash_pos).c_str(), &addrv4) <= 0)
+		throw std::runtime_error("Invalid value for getpids-prefix");
+	prefix_ = ntohl(addrv4.s_addr) & ~prefix_mask_;
+
+	if (OPTIONS.count("alto-pids") > 0)
+	{
+		std::istringstream pids(OPTIONS["alto-pids"].as<std::string>());
+		std::string pid;
+		while (std::getline(pids, pid, ','))
+			if (!pid.empty())
+				pids_.push_back(pid);
+	}
+
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	struct addrinfo* ai;
+	if (getaddrinfo(server_.c_str(), NULL, &hints, &ai) != 0)
+		throw std::runtime_error("Failed to resolve server address: " + server_);
+	memcpy(&addr_, ai->ai_addr, sizeof(addr_));
+	addr_.sin_port = htons(port_);
+	freeaddrinfo(ai);
+}
+
+void AltoClientThread::parse_mix(const std::string& mix)
+{
+	/* Comma-separated list of resource:weight */
+	mix_.assign(ALTO_NUM_REQUEST_TYPES, 0.0);
+	std::istringstream entries(mix);
+	std::string entry;
+	while (std::getline(entries, entry, ','))
+	{
+		std::string::size_type colon = entry.find(':');
+		std::string name = entry.substr(0, colon);
+		double weight = colon == std::string::npos ? 1.0 : atof(entry.c_str() + colon + 1);
+
+		int type = 0;
+		while (type < ALTO_NUM_REQUEST_TYPES && name != REQUEST_NAMES[type])
+			++type;
+		if (type == ALTO_NUM_REQUEST_TYPES || weight < 0)
+			throw std::runtime_error("Invalid value for alto-mix: " + entry);
+		mix_[type] = weight;
+	}
+
+	double total = 0;
+	for (int i = 0; i < ALTO_NUM_REQUEST_TYPES; ++i)
+		total += mix_[i];
+	if (total <= 0)
+		throw std::runtime_error("Invalid value for alto-mix");
+}
+
+AltoRequestType AltoClientThread::choose_type()
+{
+	double total = 0;
+	for (int i = 0; i < ALTO_NUM_REQUEST_TYPES; ++i)
+		total += mix_[i];
+
+	double r = rand_r(&seed_) / (RAND_MAX + 1.0) * total;
+	for (int i = 0; i < ALTO_NUM_REQUEST_TYPES; ++i)
+	{
+		if (r < mix_[i])
+			return (AltoRequestType)i;
+		r -= mix_[i];
+	}
+
+	/* Rounding; fall back to the last resource with non-zero weight */
+	int i = ALTO_NUM_REQUEST_TYPES - 1;
+	while (mix_[i] <= 0)
+		--i;
+	return (AltoRequestType)i;
+}
+
+double AltoClientThread::exp_random(double mean)
+{
+	return -mean * log(1.0 - rand_r(&seed_) / (RAND_MAX + 1.0));
+}
+
+void AltoClientThread::load_pids()
+{
+	/* Fetch the network map once, synchronously, and collect the PID
+	 * names (the keys of its "map" object) for filtered requests. */
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		return;
+	if (::connect(fd, (const sockaddr*)&addr_, sizeof(addr_)) != 0)
+	{
+		::close(fd);
+		return;
+	}
+
+	std::string req = "GET /networkmap HTTP/1.0\r\nHost: " + server_ + "\r\nAccept: application/alto-networkmap+json\r\n\r\n";
+	if (send(fd, req.data(), req.size(), 0) != (ssize_t)req.size())
+	{
+		::close(fd);
+		return;
+	}
+
+	std::string rsp;
+	char buf[16384];
+	ssize_t n;
+	while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+		rsp.append(buf, n);
+	::close(fd);
+
+	std::string::size_type pos = rsp.find("\"map\"");
+	if (pos == std::string::npos)
+		return;
+	pos = rsp.find('{', pos);
+	if (pos == std::string::npos)
+		return;
+
+	int depth = 0;
+	for (; pos < rsp.size(); ++pos)
+	{
+		char c = rsp[pos];
+		if (c == '{' || c == '[')
+			++depth;
+		else if (c == '}' || c == ']')
+		{
+			if (--depth == 0)
+				break;
+		}
+		else if (c == '"')
+		{
+			std::string::size_type end = rsp.find('"', pos + 1);
+			if (end == std::string::npos)
+				break;
+			if (depth == 1)
+				pids_.push_back(rsp.substr(pos + 1, end - pos - 1));
+			pos = end;
+		}
+	}
+}
+
+void AltoClientThread::append_pids(std::string& out, unsigned int count)
+{
+	out += '[';
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		if (i > 0)
+			out += ',';
+		out += '"';
+		out += pids_[rand_r(&seed_) % pids_.size()];
+		out += '"';
+	}
+	out += ']';
+}
+
+void AltoClientThread::append_endpoints(std::string& out, unsigned int count)
+{
+	char buf[INET_ADDRSTRLEN];
+	struct in_addr addr;
+
+	out += '[';
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		addr.s_addr = htonl(prefix_ | (rand_r(&seed_) & prefix_mask_));
+		if (i > 0)
+			out += ',';
+		out += "\"ipv4:";
+		out += inet_ntop(AF_INET, &addr, buf, sizeof(buf));
+		out += '"';
+	}
+	out += ']';
+}
+
+void AltoClientThread::make_request(AltoRequestType type, std::string& out)
+{
+	const char* method = "POST";
+	const char* path = NULL;
+	const char* content_type = NULL;
+	const char* accept = NULL;
+	std::string body;
+
+	switch (type)
+	{
+	case ALTO_NETWORKMAP:
+		method = "GET";
+		path = "/networkmap";
+		accept = "application/alto-networkmap+json";
+		break;
+	case ALTO_NETWORKMAP_FILTERED:
+		path = "/networkmap/filtered";
+		content_type = "application/alto-networkmapfilter+json";
+		accept = "application/alto-networkmap+json";
+		body = "{\"pids\":";
+		append_pids(body, filter_size_);
+		body += '}';
+		break;
+	case ALTO_COSTMAP:
+		method = "GET";
+		path = "/costmap/numerical/routingcost";
+		accept = "application/alto-costmap+json";
+		break;
+	case ALTO_COSTMAP_FILTERED:
+		path = "/costmap/filtered";
+		content_type = "application/alto-costmapfilter+json";
+		accept = "application/alto-costmap+json";
+		body = "{\"cost-mode\":\"numerical\",\"cost-type\":\"routingcost\",\"pids\":{\"srcs\":";
+		append_pids(body, filter_size_);
+		body += ",\"dsts\":";
+		append_pids(body, filter_size_);
+		body += "}}";
+		break;
+	case ALTO_ENDPOINT_PROPERTY:
+		path = "/endpoints/property";
+		content_type = "application/alto-endpointpropparams+json";
+		accept = "application/alto-endpointprop+json";
+		body = "{\"properties\":[\"pid\"],\"endpoints\":";
+		append_endpoints(body, filter_size_);
+		body += '}';
+		break;
+	case ALTO_ENDPOINT_COST:
+		path = "/endpoints/cost";
+		content_type = "application/alto-endpointcostparams+json";
+		accept = "application/alto-endpointcost+json";
+		body = "{\"cost-mode\":\"numerical\",\"cost-type\":\"routingcost\",\"endpoints\":{\"srcs\":";
+		append_endpoints(body, filter_size_);
+		body += ",\"dsts\":";
+		append_endpoints(body, filter_size_);
+		body += "}}";
+		break;
+	default:
+		break;
+	}
+
+	out.clear();
+	out += method;
+	out += ' ';
+	out += path;
+	out += " HTTP/1.1\r\nHost: ";
+	out += server_;
+	out += "\r\nAccept: ";
+	out += accept;
+	out += "\r\n";
+	if (!persistent_)
+		out += "Connection: close\r\n";
+	if (content_type)
+	{
+		out += "Content-Type: ";
+		out += content_type;
+		out += "\r\nContent-Length: ";
+		out += boost::lexical_cast<std::string>(body.size());
+		out += "\r\n";
+	}
+	out += "\r\n";
+	out += body;
+}
+
+bool AltoClientThread::connect(Connection& c)
+{
+	c.fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (c.fd < 0)
+		return false;
+
+	int one = 1;
+	setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	fcntl(c.fd, F_SETFL, fcntl(c.fd, F_GETFL) | O_NONBLOCK);
+
+	if (::connect(c.fd, (const sockaddr*)&addr_, sizeof(addr_)) == 0)
+		c.state = Connection::SENDING;
+	else if (errno == EINPROGRESS)
+		c.state = Connection::CONNECTING;
+	else
+	{
+		::close(c.fd);
+		c.fd = -1;
+		return false;
+	}
+	return true;
+}
+
+bool AltoClientThread::start(Connection& c, const Request& r, unsigned long long now)
+{
+	c.request = r;
+	c.deadline = now + timeout_;
+	c.out_pos = 0;
+	c.response.reset();
+	make_request(r.type, c.out);
+
+	if (c.state == Connection::IDLE)
+	{
+		c.state = Connection::SENDING;
+		return true;
+	}
+
+	if (!connect(c))
+	{
+		++stats_[r.type].failures;
+		return false;
+	}
+	return true;
+}
+
+void AltoClientThread::close(Connection& c)
+{
+	if (c.fd >= 0)
+		::close(c.fd);
+	c.fd = -1;
+	c.state = Connection::CLOSED;
+}
+
+void AltoClientThread::fail(Connection& c, bool timeout)
+{
+	if (timeout)
+		++stats_[c.request.type].timeouts;
+	else
+		++stats_[c.request.type].failures;
+	close(c);
+}
+
+void AltoClientThread::complete(Connection& c, unsigned long long now)
+{
+	AltoStats& stats = stats_[c.request.type];
+	stats.latency.record(now - c.request.arrival);
+	stats.bytes += c.response.bytes();
+
+	int status = c.response.status();
+	if (status >= 200 && status < 300)
+		++stats.ok;
+	else if (status == 503)
+		++stats.unavailable;
+	else
+		++stats.http_errors;
+
+	if (persistent_ && c.response.keep_alive())
+		c.state = Connection::IDLE;
+	else
+		close(c);
+}
+
+void AltoClientThread::handle_events(Connection& c, short revents, unsigned long long now)
+{
+	if (c.state == Connection::CONNECTING)
+	{
+		int err = 0;
+		socklen_t len = sizeof(err);
+		if (getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0)
+		{
+			fail(c, false);
+			return;
+		}
+		c.state = Connection::SENDING;
+	}
+
+	if (c.state == Connection::SENDING)
+	{
+		ssize_t n = send(c.fd, c.out.data() + c.out_pos, c.out.size() - c.out_pos, MSG_NOSIGNAL);
+		if (n < 0 && errno != EAGAIN && errno != EINTR)
+		{
+			fail(c, false);
+			return;
+		}
+		if (n > 0)
+			c.out_pos += n;
+		if (c.out_pos == c.out.size())
+			c.state = Connection::RECEIVING;
+		return;
+	}
+
+	if (c.state == Connection::RECEIVING && (revents & (POLLIN | POLLHUP | POLLERR)))
+	{
+		char buf[65536];
+		ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+		if (n < 0)
+		{
+			if (errno != EAGAIN && errno != EINTR)
+				fail(c, false);
+			return;
+		}
+		if (n == 0)
+		{
+			if (c.response.close())
+				complete(c, now);
+			else
+				fail(c, false);
+			return;
+		}
+		if (!c.response.feed(buf, n))
+			fail(c, false);
+		else if (c.response.done())
+			complete(c, now);
+	}
+}
+
+bool AltoClientThread::operator()()
+{
+	seed_ = (unsigned int)now_usec() ^ (unsigned int)(size_t)this;
+
+	if (pids_.empty())
+		load_pids();
+	if (pids_.empty() && (mix_[ALTO_NETWORKMAP_FILTERED] > 0 || mix_[ALTO_COSTMAP_FILTERED] > 0))
+	{
+		std::cerr << "WARNING: no PIDs available; disabling filtered network and cost map requests" << std::endl;
+		mix_[ALTO_NETWORKMAP_FILTERED] = 0;
+		mix_[ALTO_COSTMAP_FILTERED] = 0;
+		double total = 0;
+		for (int i = 0; i < ALTO_NUM_REQUEST_TYPES; ++i)
+			total += mix_[i];
+		if (total <= 0)
+			return false;
+	}
+
+	conns_.resize(connections_);
+	std::vector<pollfd> fds;
+	std::vector<Connection*> polled;
+
+	const double mean_interval = 1000000.0 / rate_;
+	unsigned long long next_arrival = now_usec() + (unsigned long long)exp_random(mean_interval);
+
+	while (!boost::this_thread::interruption_requested())
+	{
+		unsigned long long now = now_usec();
+
+		/* Generate arrivals that are due */
+		while (next_arrival <= now)
+		{
+			Request r;
+			r.type = choose_type();
+			r.arrival = next_arrival;
+			if (backlog_.size() < max_backlog_)
+				backlog_.push_back(r);
+			else
+				++stats_[r.type].dropped;
+			next_arrival += (unsigned long long)exp_random(mean_interval);
+		}
+
+		/* Hand waiting requests to free connections, preferring ones
+		 * that are already open */
+		for (int pass = 0; pass < 2 && !backlog_.empty(); ++pass)
+		{
+			Connection::State wanted = pass == 0 ? Connection::IDLE : Connection::CLOSED;
+			for (unsigned int i = 0; i < conns_.size() && !backlog_.empty(); ++i)
+			{
+				if (conns_[i].state != wanted)
+					continue;
+				Request r = backlog_.front();
+				backlog_.pop_front();
+				start(conns_[i], r, now);
+			}
+		}
+
+		/* Poll busy connections */
+		fds.clear();
+		polled.clear();
+		for (unsigned int i = 0; i < conns_.size(); ++i)
+		{
+			Connection& c = conns_[i];
+			if (c.state == Connection::CLOSED || c.state == Connection::IDLE)
+				continue;
+			if (now >= c.deadline)
+			{
+				fail(c, true);
+				continue;
+			}
+
+			pollfd p;
+			p.fd = c.fd;
+			p.events = c.state == Connection::RECEIVING ? POLLIN : POLLOUT;
+			p.revents = 0;
+			fds.push_back(p);
+			polled.push_back(&c);
+		}
+
+		int timeout = std::min<unsigned long long>(100, (next_arrival - now + 999) / 1000);
+		int rc = poll(fds.empty() ? NULL : &fds[0], fds.size(), timeout);
+		if (rc < 0 && errno != EINTR)
+		{
+			std::cerr << "WARNING: poll failed: " << strerror(errno) << std::endl;
+			break;
+		}
+
+		now = now_usec();
+		for (unsigned int i = 0; rc > 0 && i < fds.size(); ++i)
+		{
+			if (fds[i].revents != 0)
+				handle_events(*polled[i], fds[i].revents, now);
+		}
+	}
+
+	for (unsigned int i = 0; i < conns_.size(); ++i)
+		close(conns_[i]);
+
+	/* Requests still waiting never got a connection */
+	for (unsigned int i = 0; i < backlog_.size(); ++i)
+		++stats_[backlog_[i].type].dropped;
+
+	boost::mutex::scoped_lock lock(SUMMARY_MUTEX);
+	for (int i = 0; i < ALTO_NUM_REQUEST_TYPES; ++i)
+		SUMMARY[i].merge(stats_[i]);
+	return true;
+}
+
+void AltoClientThread::print_summary(double elapsed)
+{
+	boost::mutex::scoped_lock lock(SUMMARY_MUTEX);
+
+	AltoStats total;
+	for (int i = 0; i < ALTO_NUM_REQUEST_TYPES; ++i)
+		total.merge(SUMMARY[i]);
+	if (total.latency.getCount() == 0 && total.dropped == 0 && total.failures == 0 && total.timeouts == 0)
+		return;
+
+	std::cout << "ALTO" << std::endl;
+	std::cout << "\tTotal Time (sec) : " << elapsed << std::endl;
+	for (int i = 0; i <= ALTO_NUM_REQUEST_TYPES; ++i)
+	{
+		const AltoStats& s = i < ALTO_NUM_REQUEST_TYPES ? SUMMARY[i] : total;
+		if (s.latency.getCount() == 0 && s.dropped == 0 && s.failures == 0 && s.timeouts == 0)
+			continue;
+
+		std::cout << "\t" << (i < ALTO_NUM_REQUEST_TYPES ? REQUEST_NAMES[i] : "total") << ": " << std::endl;
+		std::cout << "\t\tResponses      : " << s.latency.getCount() << std::endl;
+		std::cout << "\t\tThroughput     : " << (s.latency.getCount() / elapsed) << " req/s, " << (s.bytes / elapsed) << " bytes/s" << std::endl;
+		std::cout << "\t\tOK (2xx)       : " << s.ok << std::endl;
+		std::cout << "\t\tUnavailable    : " << s.unavailable << std::endl;
+		std::cout << "\t\tOther Errors   : " << s.http_errors << std::endl;
+		std::cout << "\t\tFailed         : " << s.failures << std::endl;
+		std::cout << "\t\tTimed Out      : " << s.timeouts << std::endl;
+		std::cout << "\t\tDropped        : " << s.dropped << std::endl;
+		std::cout << "\t\tLatency (usec) : mean " << s.latency.getMean()
+			  << " p50 " << s.latency.getPercentile(50)
+			  << " p90 " << s.latency.getPercentile(90)
+			  << " p99 " << s.latency.getPercentile(99)
+			  << " p99.9 " << s.latency.getPercentile(99.9)
+			  << " max " << s.latency.getMax() << std::endl;
+	}
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef ALTO_CLIENT_H
+#define ALTO_CLIENT_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include <p4p/detail/latency_histogram.h>
+
+/*
+ * ALTO JSON resources exercised by AltoClientThread
+ */
+enum AltoRequestType
+{
+	ALTO_NETWORKMAP,
+	ALTO_NETWORKMAP_FILTERED,
+	ALTO_COSTMAP,
+	ALTO_COSTMAP_FILTERED,
+	ALTO_ENDPOINT_PROPERTY,
+	ALTO_ENDPOINT_COST,
+	ALTO_NUM_REQUEST_TYPES,
+};
+
+/*
+ * Per-resource results; merged across threads for the final report
+ */
+struct AltoStats
+{
+	AltoStats();
+	void merge(const AltoStats& rhs);
+
+	p4p::detail::LatencyHistogram latency;	/* Microseconds from scheduled arrival to last response byte */
+	unsigned long long ok;		/* 2xx responses */
+	unsigned long long unavailable;	/* 503 responses */
+	unsigned long long http_errors;	/* Other non-2xx responses */
+	unsigned long long failures;	/* Connect, I/O and protocol errors */
+	unsigned long long timeouts;
+	unsigned long long dropped;	/* Arrivals discarded because the backlog was full */
+	unsigned long long bytes;	/* Response bytes received */
+};
+
+/*
+ * Incremental parser for a single HTTP/1.x response. Handles
+ * Content-Length, chunked and close-delimited bodies; the body itself
+ * is discarded.
+ */
+class HttpResponseParser
+{
+public:
+	HttpResponseParser();
+
+	void reset();
+
+	/* Consume received data; returns false on a malformed response */
+	bool feed(const char* data, size_t len);
+
+	/* Called when the peer closes the connection; returns true if that
+	 * completes the response */
+	bool close();
+
+	bool done() const		{ return state_ == DONE; }
+	int status() const		{ return status_; }
+	bool keep_alive() const		{ return keep_alive_; }
+	unsigned long long bytes() const	{ return bytes_; }
+
+private:
+	enum State
+	{
+		HEADERS,
+		BODY_LENGTH,
+		BODY_CLOSE,
+		CHUNK_SIZE,
+		CHUNK_DATA,
+		CHUNK_TRAILER,
+		DONE,
+	};
+
+	bool parse_headers(const std::string& headers);
+
+	State state_;
+	std::string buf_;
+	unsigned long long remaining_;
+	unsigned long long bytes_;
+	int status_;
+	bool keep_alive_;
+};
+
+/*
+ * Open-loop ALTO load generator. Each thread drives many concurrent
+ * connections from a single poll() loop. Requests arrive as a Poisson
+ * process at alto-rate per thread, with the resource chosen according
+ * to alto-mix; an arrival that finds no free connection waits in a
+ * backlog, and that wait is part of its measured latency. Results are
+ * merged into a global report printed by print_summary().
+ */
+class AltoClientThread
+{
+public:
+	AltoClientThread();
+
+	bool operator()();
+
+	static void print_summary(double elapsed);
+
+private:
+	struct Request
+	{
+		AltoRequestType type;
+		unsigned long long arrival;	/* Scheduled arrival time (usec) */
+	};
+
+	struct Connection
+	{
+		enum State
+		{
+			CLOSED,
+			IDLE,
+			CONNECTING,
+			SENDING,
+			RECEIVING,
+		};
+
+		Connection() : fd(-1), state(CLOSED), out_pos(0), deadline(0) {}
+
+		int fd;
+		State state;
+		std::string out;
+		size_t out_pos;
+		unsigned long long deadline;
+		Request request;
+		HttpResponseParser response;
+	};
+
+	void parse_mix(const std::string& mix);
+	AltoRequestType choose_type();
+	double exp_random(double mean);
+
+	void load_pids();
+	void make_request(AltoRequestType type, std::string& out);
+	void append_pids(std::string& out, unsigned int count);
+	void append_endpoints(std::string& out, unsigned int count);
+
+	bool start(Connection& c, const Request& r, unsigned long long now);
+	bool connect(Connection& c);
+	void handle_events(Connection& c, short revents, unsigned long long now);
+	void complete(Connection& c, unsigned long long now);
+	void fail(Connection& c, bool timeout);
+	void close(Connection& c);
+
+	std::string server_;
+	unsigned short port_;
+	sockaddr_in addr_;
+	double rate_;
+	unsigned int connections_;
+	unsigned int filter_size_;
+	unsigned long long timeout_;
+	unsigned int max_backlog_;
+	bool persistent_;
+	std::vector<double> mix_;
+	unsigned int prefix_;
+	unsigned int prefix_mask_;
+	unsigned int seed_;
+
+	std::vector<std::string> pids_;
+	std::vector<Connection> conns_;
+	std::deque<Request> backlog_;
+	AltoStats stats_[ALTO_NUM_REQUEST_TYPES];
+};
+
+#endif
@@ -31,6 +31,9 @@
 
 #include "options.h"
 #include "client.h"
+#include "alto_client.h"
+#include <iostream>
+#include <time.h>
 #include <boost/thread.hpp>
 
 sig_atomic_t TERMINATED = 0;
@@ -44,15 +47,32 @@ int main(int argc, char** argv)
 	signal(SIGTERM, term_handler);
 
 	boost::thread_group client_threads;
-	for (unsigned int i = 0; i < OPTIONS["clients"].as<unsigned int>(); ++i)
-		client_threads.add_thread(new boost::thread(ClientThread()));
+	try
+	{
+		for (unsigned int i = 0; i < OPTIONS["clients"].as<unsigned int>(); ++i)
+			client_threads.add_thread(new boost::thread(ClientThread()));
+		for (unsigned int i = 0; i < OPTIONS["alto-threads"].as<unsigned int>(); ++i)
+			client_threads.add_thread(new boost::thread(AltoClientThread()));
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		client_threads.interrupt_all();
+		client_threads.join_all();
+		return 1;
+	}
+
+	time_t start_time = time(NULL);
+	unsigned int duration = OPTIONS["duration"].as<unsigned int>();
 
 	boost::posix_time::time_duration interval = boost::posix_time::milliseconds(500);
-	while (!TERMINATED)
+	while (!TERMINATED && (duration == 0 || time(NULL) - start_time < duration))
 		boost::thread::sleep(boost::get_system_time() + interval);
 
 	client_threads.interrupt_all();
 	client_threads.join_all();
+
+	AltoClientThread::print_summary(difftime(time(NULL), start_time));
 	return 0;
 }
 
@@ -59,6 +59,25 @@ void handle_options(int argc, char** argv)
 				"percentage of PIDs to include in GetPDistance request")
 	("getpdistance-rate",	bpo::value<double>()->default_value(0.1),
 				"requests per second for GetPDistance (per client)")
+	("duration",		bpo::value<unsigned int>()->default_value(0),
+				"seconds to run before stopping (0 runs until interrupted)")
+	("alto-threads",	bpo::value<unsigned int>()->default_value(0),
+				"number of ALTO load generator threads")
+	("alto-rate",		bpo::value<double>()->default_value(100.0),
+				"ALTO request arrivals per second (per ALTO thread, open-loop)")
+	("alto-connections",	bpo::value<unsigned int>()->default_value(16),
+				"concurrent connections per ALTO thread")
+	("alto-mix",		bpo::value<std::string>()->default_value("networkmap:1,costmap:1,costmap-filtered:4,endpointprop:4,endpointcost:4"),
+				"ALTO resource weights: comma-separated list of NAME:WEIGHT where NAME is one of "
+				"networkmap, networkmap-filtered, costmap, costmap-filtered, endpointprop, endpointcost")
+	("alto-filter-size",	bpo::value<unsigned int>()->default_value(10),
+				"PIDs or endpoints per source/destination list in filtered ALTO requests")
+	("alto-pids",		bpo::value<std::string>(),
+				"comma-separated PID names for filtered requests (default: read from the network map)")
+	("alto-timeout",	bpo::value<unsigned int>()->default_value(10000),
+				"ALTO request timeout in milliseconds")
+	("alto-backlog",	bpo::value<unsigned int>()->default_value(10000),
+				"maximum ALTO requests waiting for a free connection; further arrivals are dropped")
 	;
 
 
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+/*
+ * Memory and time benchmark for exporting a large topology.
+ *
+ * Generates a synthetic network (a ring of nodes with extra links to
+ * pseudo-random neighbours, aggregated into PIDs) and writes it to a
+ * stream that only counts bytes, either streamed through the DOT or
+ * GraphML writer as records arrive, or as topoviz did before: reading
+ * every record, building a Boost graph, and writing it with
+ * write_graphviz. Run one mode per process, since the peak resident
+ * size reported is that of the whole process.
+ *
+ * Usage: p4p_portal_topoviz_bench <graph|dot|graphml> [nodes] [links per node] [PIDs]
+ */
+
+#include <sys/resource.h>
+#include <iostream>
+#include <map>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/foreach.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/graphviz.hpp>
+#include <boost/lexical_cast.hpp>
+#include "graph_writer.h"
+#include "topology_export.h"
+
+namespace bpt = boost::posix_time;
+using namespace p4p::protocol::portal;
+
+/* Discards output, counting the bytes */
+class CountingBuf : public std::streambuf
+{
+public:
+	CountingBuf() : bytes_(0) {}
+	unsigned long long get_bytes() const { return bytes_; }
+protected:
+	virtual int overflow(int c)				{ ++bytes_; return c; }
+	virtual std::streamsize xsputn(const char* s, std::streamsize n)	{ bytes_ += n; return n; }
+private:
+	unsigned long long bytes_;
+};
+
+/* The synthetic network, generated one record at a time */
+class Network
+{
+public:
+	Network(unsigned int nodes, unsigned int degree, unsigned int pids)
+		: nodes_(nodes), degree_(degree), pids_(pids)
+	{}
+
+	static std::string node_name(unsigned int i)	{ return "node" + boost::lexical_cast<std::string>(i); }
+	std::string pid_name(unsigned int i) const	{ return "pid" + boost::lexical_cast<std::string>(i % pids_); }
+
+	template <class OutputIterator>
+	void list_nodes(OutputIterator out) const
+	{
+		for (unsigned int i = 0; i < nodes_; ++i)
+			*out++ = NetNode(node_name(i), i % 100 == 0);
+	}
+
+	template <class OutputIterator>
+	void list_links(OutputIterator out) const
+	{
+		unsigned int state = 1;
+		for (unsigned int i = 0; i < nodes_; ++i)
+		{
+			for (unsigned int d = 0; d < degree_; ++d)
+			{
+				state = state * 1103515245 + 12345;
+				unsigned int j = d == 0 ? (i + 1) % nodes_ : (state >> 8) % nodes_;
+				std::string name = "link" + boost::lexical_cast<std::string>(i * degree_ + d);
+				*out++ = NamedNetLink(name, NetLink(node_name(i), node_name(j)));
+			}
+		}
+	}
+
+	unsigned int get_nodes() const	{ return nodes_; }
+	unsigned int get_pids() const	{ return pids_; }
+
+private:
+	unsigned int nodes_;
+	unsigned int degree_;
+	unsigned int pids_;
+};
+
+/*
+ * Export as done before streaming (see the history of main.cpp)
+ */
+
+struct netvertex_external_t  { typedef boost::vertex_property_tag kind; };
+struct netvertex_name_t  { typedef boost::vertex_property_tag kind; };
+typedef boost::property<netvertex_external_t, bool,
+	boost::property<netvertex_name_t, std::string,
+	boost::property<boost::vertex_index_t, unsigned int
+	> > > NetGraphVertexProps;
+
+typedef boost::adjacency_list<boost::setS, boost::listS, boost::directedS, NetGraphVertexProps> NetGraph;
+typedef boost::graph_traits<NetGraph>::vertex_descriptor NetVertex;
+typedef boost::graph_traits<NetGraph>::edge_descriptor NetEdge;
+
+class NetGraphWriter
+{
+public:
+	NetGraphWriter(const NetGraph& g) : g_(g) {}
+
+	void operator()(std::ostream& os, const NetVertex& v) const
+	{
+		os << "[label = \"" << boost::get(boost::get(netvertex_name_t(), g_), v) << "\","
+		   << "fontcolor = " << (boost::get(boost::get(netvertex_external_t(), g_), v) ? "black" : "blue") << "]";
+	}
+
+	void operator()(std::ostream& os, const NetEdge& e) const	{ os << "[label = \"\"]"; }
+	void operator()(std::ostream& os) const				{}
+
+private:
+	const NetGraph& g_;
+};
+
+static void export_graph(const Network& net, std::ostream& os)
+{
+	std::vector<NetNode> net_nodes;
+	net.list_nodes(std::back_inserter(net_nodes));
+	std::vector<NamedNetLink> net_links;
+	net.list_links(std::back_inserter(net_links));
+
+	NetGraph topo;
+	std::map<std::string, NetVertex> node_names;
+	unsigned int v_idx = 0;
+	BOOST_FOREACH(const NetNode& node, net_nodes)
+	{
+		NetVertex v = boost::add_vertex(topo);
+		boost::put(boost::get(netvertex_name_t(), topo), v, node.name);
+		boost::put(boost::get(netvertex_external_t(), topo), v, node.external);
+		boost::put(boost::get(boost::vertex_index, topo), v, v_idx++);
+		node_names[node.name] = v;
+	}
+	BOOST_FOREACH(const NamedNetLink& link, net_links)
+		boost::add_edge(node_names[link.link.src], node_names[link.link.dst], topo);
+
+	boost::write_graphviz(os, topo, NetGraphWriter(topo), NetGraphWriter(topo), NetGraphWriter(topo));
+}
+
+/* Same order as topoviz: PID aggregation, nodes, links, then PID members */
+static void export_stream(const Network& net, GraphWriter& writer)
+{
+	TopologyExport exp(writer);
+	for (unsigned int i = 0; i < net.get_nodes(); ++i)
+		exp.add_pid_node(net.pid_name(i), Network::node_name(i));
+
+	writer.begin();
+	net.list_nodes(exp.node_inserter());
+	net.list_links(exp.link_inserter());
+	exp.write_pids();
+	writer.end();
+}
+
+int main(int argc, char** argv)
+{
+	std::string mode = argc > 1 ? argv[1] : "dot";
+	unsigned int nodes = argc > 2 ? boost::lexical_cast<unsigned int>(argv[2]) : 50000;
+	unsigned int degree = argc > 3 ? boost::lexical_cast<unsigned int>(argv[3]) : 4;
+	unsigned int pids = argc > 4 ? boost::lexical_cast<unsigned int>(argv[4]) : 500;
+
+	Network net(nodes, degree, pids);
+	CountingBuf buf;
+	std::ostream os(&buf);
+
+	bpt::ptime start = bpt::microsec_clock::universal_time();
+	if (mode == "graph")
+		export_graph(net, os);
+	else
+	{
+		GraphWriterPtr writer = GraphWriter::create(mode, os);
+		if (!writer)
+		{
+			std::cerr << "Unknown mode: " << mode << std::endl;
+			return 1;
+		}
+		export_stream(net, *writer);
+	}
+	double msec = (bpt::microsec_clock::universal_time() - start).total_microseconds() / 1000.0;
+
+	rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	std::cout << "mode=" << mode
+		  << " nodes=" << nodes
+		  << " links=" << nodes * degree
+		  << " msec=" << msec
+		  << " bytes=" << buf.get_bytes()
+		  << " max_rss_kb=" << ru.ru_maxrss
+		  << std::endl;
+	return 0;
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#include "graph_writer.h"
+
+#include <math.h>
+
+GraphWriterPtr GraphWriter::create(const std::string& format, std::ostream& os)
+{
+	if (format == "dot")
+		return GraphWriterPtr(new DotGraphWriter(os));
+	if (format == "graphml")
+		return GraphWriterPtr(new GraphMLGraphWriter(os));
+	return GraphWriterPtr();
+}
+
+/*
+ * DOT
+ */
+
+void DotGraphWriter::write_id(const std::string& id)
+{
+	os_ << '"';
+	for (std::string::const_iterator itr = id.begin(); itr != id.end(); ++itr)
+	{
+		if (*itr == '"' || *itr == '\\')
+			os_ << '\\';
+		os_ << *itr;
+	}
+	os_ << '"';
+}
+
+void DotGraphWriter::begin()
+{
+	os_ << "digraph G {" << '\n'
+	    << "node [height = 0.40, width = 0.40, fixedsize = true, fontsize = 8];" << '\n'
+	    << "edge [arrowsize = 0.35, label = \"\"];" << '\n';
+}
+
+void DotGraphWriter::end()
+{
+	os_ << "}" << std::endl;
+}
+
+void DotGraphWriter::node(const std::string& name, bool external, const std::string& pid)
+{
+	write_id(name);
+	os_ << " [fontcolor = " << (external ? "black" : "blue") << "];" << '\n';
+}
+
+void DotGraphWriter::link(const std::string& name, const std::string& src, const std::string& dst,
+			  double traffic, double capacity)
+{
+	write_id(src);
+	os_ << " -> ";
+	write_id(dst);
+
+	/* Label with the utilization if it is known, or else the traffic */
+	if (!isnan(traffic) && !isnan(capacity) && capacity > 0)
+	{
+		double utilization = traffic / capacity;
+		os_ << " [label = \"" << utilization << "\"";
+		if (utilization >= 1.0)
+			os_ << ", color = red";
+		os_ << "]";
+	}
+	else if (!isnan(traffic))
+		os_ << " [label = \"" << traffic << "\"]";
+	os_ << ";" << '\n';
+}
+
+void DotGraphWriter::begin_pid(const std::string& name)
+{
+	os_ << "subgraph \"cluster_" << pid_++ << "\" {" << '\n'
+	    << "label = ";
+	write_id(name);
+	os_ << ";" << '\n';
+}
+
+void DotGraphWriter::pid_node(const std::string& node)
+{
+	write_id(node);
+	os_ << ";" << '\n';
+}
+
+void DotGraphWriter::end_pid()
+{
+	os_ << "}" << '\n';
+}
+
+void DotGraphWriter::pdistance(const std::string& src, const std::string& dst, double value)
+{
+	write_id("pid:" + src);
+	os_ << " -> ";
+	write_id("pid:" + dst);
+	os_ << " [style = dashed, label = \"" << value << "\"];" << '\n';
+}
+
+/*
+ * GraphML
+ */
+
+void GraphMLGraphWriter::write_escaped(const std::string& s)
+{
+	for (std::string::const_iterator itr = s.begin(); itr != s.end(); ++itr)
+	{
+		switch (*itr)
+		{
+		case '&':	os_ << "&amp;"; break;
+		case '<':	os_ << "&lt;"; break;
+		case '>':	os_ << "&gt;"; break;
+		case '"':	os_ << "&quot;"; break;
+		case '\'':	os_ << "&apos;"; break;
+		default:	os_ << *itr; break;
+		}
+	}
+}
+
+void GraphMLGraphWriter::write_data(const char* key, const std::string& value)
+{
+	os_ << "<data key=\"" << key << "\">";
+	write_escaped(value);
+	os_ << "</data>";
+}
+
+void GraphMLGraphWriter::write_data(const char* key, double value)
+{
+	if (!isnan(value))
+		os_ << "<data key=\"" << key << "\">" << value << "</data>";
+}
+
+void GraphMLGraphWriter::begin()
+{
+	os_ << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << '\n'
+	    << "<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">" << '\n'
+	    << "<key id=\"kind\" for=\"node\" attr.name=\"kind\" attr.type=\"string\"/>" << '\n'
+	    << "<key id=\"name\" for=\"all\" attr.name=\"name\" attr.type=\"string\"/>" << '\n'
+	    << "<key id=\"external\" for=\"node\" attr.name=\"external\" attr.type=\"boolean\"/>" << '\n'
+	    << "<key id=\"pid\" for=\"node\" attr.name=\"pid\" attr.type=\"string\"/>" << '\n'
+	    << "<key id=\"traffic\" for=\"edge\" attr.name=\"traffic\" attr.type=\"double\"/>" << '\n'
+	    << "<key id=\"capacity\" for=\"edge\" attr.name=\"capacity\" attr.type=\"double\"/>" << '\n'
+	    << "<key id=\"utilization\" for=\"edge\" attr.name=\"utilization\" attr.type=\"double\"/>" << '\n'
+	    << "<key id=\"pdistance\" for=\"edge\" attr.name=\"pdistance\" attr.type=\"double\"/>" << '\n'
+	    << "<graph id=\"G\" edgedefault=\"directed\">" << '\n';
+}
+
+void GraphMLGraphWriter::end()
+{
+	os_ << "</graph>" << '\n'
+	    << "</graphml>" << std::endl;
+}
+
+/* Node ids are prefixed so that nodes and PIDs of the same name are distinct */
+void GraphMLGraphWriter::node(const std::string& name, bool external, const std::string& pid)
+{
+	os_ << "<node id=\"n:";
+	write_escaped(name);
+	os_ << "\">";
+	write_data("kind", std::string("node"));
+	write_data("name", name);
+	os_ << "<data key=\"external\">" << (external ? "true" : "false") << "</data>";
+	if (!pid.empty())
+		write_data("pid", pid);
+	os_ << "</node>" << '\n';
+}
+
+void GraphMLGraphWriter::link(const std::string& name, const std::string& src, const std::string& dst,
+			      double traffic, double capacity)
+{
+	os_ << "<edge id=\"e" << link_++ << "\" source=\"n:";
+	write_escaped(src);
+	os_ << "\" target=\"n:";
+	write_escaped(dst);
+	os_ << "\">";
+	write_data("name", name);
+	write_data("traffic", traffic);
+	write_data("capacity", capacity);
+	if (!isnan(traffic) && !isnan(capacity) && capacity > 0)
+		write_data("utilization", traffic / capacity);
+	os_ << "</edge>" << '\n';
+}
+
+void GraphMLGraphWriter::begin_pid(const std::string& name)
+{
+	os_ << "<node id=\"p:";
+	write_escaped(name);
+	os_ << "\">";
+	write_data("kind", std::string("pid"));
+	write_data("name", name);
+	os_ << "</node>" << '\n';
+}
+
+void GraphMLGraphWriter::pdistance(const std::string& src, const std::string& dst, double value)
+{
+	os_ << "<edge id=\"e" << link_++ << "\" source=\"p:";
+	write_escaped(src);
+	os_ << "\" target=\"p:";
+	write_escaped(dst);
+	os_ << "\">";
+	write_data("pdistance", value);
+	os_ << "</edge>" << '\n';
+}
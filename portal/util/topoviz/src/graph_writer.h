@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#ifndef GRAPH_WRITER_H
+#define GRAPH_WRITER_H
+
+#include <ostream>
+#include <string>
+#include <boost/shared_ptr.hpp>
+
+class GraphWriter;
+typedef boost::shared_ptr<GraphWriter> GraphWriterPtr;
+
+/*
+ * Writes a graph description one element at a time, as the elements are
+ * read from the portal. Nothing is kept once it has been written, so the
+ * size of the graph is bounded by the output rather than by memory.
+ *
+ * Nodes must be written before the links and PIDs which refer to them;
+ * values which are not known are passed as NaN and left out.
+ */
+class GraphWriter
+{
+public:
+	virtual ~GraphWriter() {}
+
+	/* Writer for a format name ("dot" or "graphml"), or NULL if unknown */
+	static GraphWriterPtr create(const std::string& format, std::ostream& os);
+
+	virtual void begin() = 0;
+	virtual void end() = 0;
+
+	/* 'pid' is empty if the node is not aggregated into a PID */
+	virtual void node(const std::string& name, bool external, const std::string& pid) = 0;
+	virtual void link(const std::string& name, const std::string& src, const std::string& dst,
+			  double traffic, double capacity) = 0;
+
+	/* A PID and its member nodes, written between begin_pid() and end_pid() */
+	virtual void begin_pid(const std::string& name) = 0;
+	virtual void pid_node(const std::string& node) = 0;
+	virtual void end_pid() = 0;
+
+	/* pDistance between two PIDs (after all PIDs have been written) */
+	virtual void pdistance(const std::string& src, const std::string& dst, double value) = 0;
+
+protected:
+	GraphWriter(std::ostream& os) : os_(os) {}
+
+	std::ostream& os_;
+};
+
+/* GraphViz DOT; PIDs are drawn as clusters around their nodes */
+class DotGraphWriter : public GraphWriter
+{
+public:
+	DotGraphWriter(std::ostream& os) : GraphWriter(os), pid_(0) {}
+
+	virtual void begin();
+	virtual void end();
+	virtual void node(const std::string& name, bool external, const std::string& pid);
+	virtual void link(const std::string& name, const std::string& src, const std::string& dst,
+			  double traffic, double capacity);
+	virtual void begin_pid(const std::string& name);
+	virtual void pid_node(const std::string& node);
+	virtual void end_pid();
+	virtual void pdistance(const std::string& src, const std::string& dst, double value);
+
+private:
+	void write_id(const std::string& id);
+
+	unsigned int pid_;
+};
+
+/* GraphML; PIDs are attributes of their nodes, and nodes of their own for pDistances */
+class GraphMLGraphWriter : public GraphWriter
+{
+public:
+	GraphMLGraphWriter(std::ostream& os) : GraphWriter(os), link_(0) {}
+
+	virtual void begin();
+	virtual void end();
+	virtual void node(const std::string& name, bool external, const std::string& pid);
+	virtual void link(const std::string& name, const std::string& src, const std::string& dst,
+			  double traffic, double capacity);
+	virtual void begin_pid(const std::string& name);
+	virtual void pid_node(const std::string& node) {}
+	virtual void end_pid() {}
+	virtual void pdistance(const std::string& src, const std::string& dst, double value);
+
+private:
+	void write_escaped(const std::string& s);
+	void write_data(const char* key, const std::string& value);
+	void write_data(const char* key, double value);
+
+	unsigned long long link_;
+};
+
+#endif
@@ -27,146 +27,188 @@
  */
 
 
+#include <fstream>
 #include <string>
 #include <stdexcept>
 #include <iostream>
-#include <boost/lexical_cast.hpp>
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/graphviz.hpp>
+#include <iterator>
+#include <map>
+#include <vector>
 #include <boost/foreach.hpp>
 #include <p4p/protocol-portal/admin.h>
+#include <p4p/protocol-portal/pdistance.h>
+#include "graph_writer.h"
+#include "topology_export.h"
 #include "options.h"
 
 using namespace p4p;
 using namespace p4p::protocol;
 using namespace p4p::protocol::portal;
 
-/*
- * NOTE: These typedefs and graph data structures are mostly copied
- *       from the iTracker code.  See the original code there for
- *       more details.
- */
+/* Number of source PIDs requested at a time for the pDistance overlay */
+static const unsigned int PDISTANCE_BATCH = 64;
 
-struct netvertex_external_t  { typedef boost::vertex_property_tag kind; };
-struct netvertex_name_t  { typedef boost::vertex_property_tag kind; };
-typedef boost::property<netvertex_external_t, bool,		/* Vertex is external (i.e., interdomain)? */
-	boost::property<netvertex_name_t, std::string,		/* Vertex name */
-	boost::property<boost::vertex_index_t, unsigned int	/* Vertex index (unused, but boost wants it) */
-	> > > NetGraphVertexProps;
+/* Output iterator recording the nodes of a PID for the export */
+class PIDNodeRecorder : public std::iterator<std::output_iterator_tag, void, void, void, void>
+{
+public:
+	PIDNodeRecorder(TopologyExport& exp, const std::string& pid) : exp_(&exp), pid_(&pid) {}
+	PIDNodeRecorder& operator=(const std::string& node)	{ exp_->add_pid_node(*pid_, node); return *this; }
+	PIDNodeRecorder& operator*()				{ return *this; }
+	PIDNodeRecorder& operator++()				{ return *this; }
+	PIDNodeRecorder& operator++(int)			{ return *this; }
+private:
+	TopologyExport* exp_;
+	const std::string* pid_;
+};
 
-typedef boost::adjacency_list<
-		boost::setS,					/* Data structure for edge lists */
-		boost::listS,					/* Data structure for vertex lists */
-		boost::directedS,				/* Directed graph */
-		NetGraphVertexProps				/* Vertex properties */
-	> NetGraph;
+/* pDistances between the selected PIDs, a batch of source PIDs at a time */
+static void write_pdistances(const std::string& server, unsigned short port, const std::string& view,
+			     const std::vector<NamedPID>& pids, GraphWriter& writer)
+{
+	typedef std::vector<std::pair<PID, std::vector<PID> > > SourceList;
 
-typedef boost::graph_traits<NetGraph>::vertex_descriptor NetVertex;
-typedef boost::graph_traits<NetGraph>::edge_descriptor NetEdge;
+	PDistancePortalProtocol portal(server, port, view);
 
-bool is_quote(char c) { return c == '\'' || c == '"'; }
+	std::map<PID, std::string> names;
+	std::vector<PID> dsts;
+	BOOST_FOREACH(const NamedPID& pid, pids)
+	{
+		names.insert(std::make_pair(pid.pid, pid.name));
+		dsts.push_back(pid.pid);
+	}
 
-std::string cleanse_name(const std::string& s)
-{
-	std::string result;
-	std::remove_copy_if(s.begin(), s.end(), std::back_inserter(result), is_quote);
-	return result;
+	for (unsigned int first = 0; first < pids.size(); first += PDISTANCE_BATCH)
+	{
+		SourceList srcs;
+		for (unsigned int i = first; i < pids.size() && i < first + PDISTANCE_BATCH; ++i)
+			srcs.push_back(std::make_pair(pids[i].pid, dsts));
+
+		PDistanceMatrix matrix;
+		portal.get_pdistance(srcs.begin(), srcs.end(), false, matrix);
+
+		BOOST_FOREACH(const SourceList::value_type& src, srcs)
+		{
+			if (!matrix.has_row(src.first))
+				continue;
+			BOOST_FOREACH(const PDistanceMatrix::RowEntry& e, matrix.get_row(src.first))
+			{
+				std::map<PID, std::string>::const_iterator dst = names.find(e.first);
+				if (e.first != src.first && dst != names.end())
+					writer.pdistance(names[src.first], dst->second, e.second);
+			}
+		}
+	}
 }
 
-void read_topology(const std::string& server, unsigned short port, NetGraph& topo)
+static void export_topology(const std::string& server, unsigned short port, TopologyExport& exp, GraphWriter& writer)
 {
 	AdminPortalProtocol portal(server, port);
 
 	portal.admin_begin_txn();
 
-	std::map<std::string, NetVertex> node_names;
-
-	/* Read the nodes */
-	std::vector<NetNode> net_nodes;
-	portal.admin_net_list_nodes(std::back_inserter(net_nodes));
-	unsigned int v_idx = 0;
-	BOOST_FOREACH(const NetNode& node, net_nodes)
+	/* PID aggregation of the view, if one was given */
+	std::vector<NamedPID> pids;
+	if (OPTIONS.count("view") > 0)
 	{
-		NetVertex v_desc = boost::add_vertex(topo);
-		std::string v_name = cleanse_name(node.name);
-		boost::put(boost::get(netvertex_name_t(), topo), v_desc, v_name);
-		boost::put(boost::get(netvertex_external_t(), topo), v_desc, node.external);
-		boost::put(boost::get(boost::vertex_index, topo), v_desc, v_idx++);
-		node_names[v_name] = v_desc;
+		std::vector<NamedPID> all_pids;
+		portal.admin_view_list_pids(OPTIONS["view"].as<std::string>(), std::back_inserter(all_pids));
+		BOOST_FOREACH(const NamedPID& pid, all_pids)
+		{
+			if (exp.is_selected(pid.name))
+				pids.push_back(pid);
+		}
+
+		BOOST_FOREACH(const NamedPID& pid, pids)
+			portal.admin_view_list_pid_nodes(OPTIONS["view"].as<std::string>(), pid.name, PIDNodeRecorder(exp, pid.name));
 	}
 
-	/* Read the links */
-	std::vector<NamedNetLink> net_links;
-	portal.admin_net_list_links(std::back_inserter(net_links));
-	BOOST_FOREACH(const NamedNetLink& link, net_links)
-	{
-		std::map<std::string, NetVertex>::const_iterator v_src_itr = node_names.find(cleanse_name(link.link.src));
-		if (v_src_itr == node_names.end())
-			throw std::runtime_error("Failed to locate vertex " + link.link.src);
-		std::map<std::string, NetVertex>::const_iterator v_dst_itr = node_names.find(cleanse_name(link.link.dst));
-		if (v_dst_itr == node_names.end())
-			throw std::runtime_error("Failed to locate vertex " + link.link.dst);
-		boost::add_edge(v_src_itr->second, v_dst_itr->second, topo);
-	}
+	/* Nodes and links are written as they are read */
+	writer.begin();
+	portal.admin_net_list_nodes(exp.node_inserter());
+	portal.admin_net_list_links(exp.link_inserter());
+
+	/* PID members were read along with the aggregation */
+	exp.write_pids();
+
+	if (OPTIONS["pdistances"].as<bool>())
+		write_pdistances(server, port, OPTIONS["view"].as<std::string>(), pids, writer);
+
+	writer.end();
 
 	portal.admin_cancel_txn();
 }
 
-
-class NetGraphWriter
+int main(int argc, char** argv)
 {
-public:
-	NetGraphWriter(const NetGraph& g) : g_(g) {}
+	handle_options(argc, argv);
 
-	void operator()(std::ostream& os, const NetVertex& v) const
+	std::ofstream file;
+	const std::string& output = OPTIONS["output"].as<std::string>();
+	if (output != "-")
 	{
-		std::string label = boost::get(boost::get(netvertex_name_t(), g_), v);
-		bool external = boost::get(boost::get(netvertex_external_t(), g_), v);
-		std::string color = external ? "black" : "blue";
-		os << "["
-		   << "height = 0.40,"
-		   << "width = 0.40,"
-		   << "fixedsize = true,"
-		   << "fontsize = 8,"
-		   << "label = \"" << label << "\","
-		   << "fontcolor = " << color << ","
-		   << "]";
+		file.open(output.c_str());
+		if (!file)
+		{
+			std::cerr << "Failed to open " << output << std::endl;
+			return 1;
+		}
 	}
+	std::ostream& os = output != "-" ? file : std::cout;
 
-	void operator()(std::ostream& os, const NetEdge& e) const
+	GraphWriterPtr writer = GraphWriter::create(OPTIONS["format"].as<std::string>(), os);
+	if (!writer)
 	{
-		os << "["
-		   << "arrowsize = 0.35,"
-		   << "label = \"\","
-		   << "]";
+		std::cerr << "Unknown output format: " << OPTIONS["format"].as<std::string>() << std::endl;
+		return 1;
 	}
 
-	void operator()(std::ostream& os) const
+	TopologyExport exp(*writer);
+	try
 	{
-		os << "node []" << std::endl;
-		os << "edge []" << std::endl;
+		if (OPTIONS.count("pid") > 0)
+		{
+			BOOST_FOREACH(const std::string& pid, OPTIONS["pid"].as<std::vector<std::string> >())
+				exp.select_pid(pid);
+		}
+		if (OPTIONS.count("traffic") > 0)
+		{
+			std::ifstream is(OPTIONS["traffic"].as<std::string>().c_str());
+			if (!is)
+				throw std::runtime_error("failed to open " + OPTIONS["traffic"].as<std::string>());
+			exp.set_traffic(is);
+		}
+		if (OPTIONS.count("capacity") > 0)
+		{
+			std::ifstream is(OPTIONS["capacity"].as<std::string>().c_str());
+			if (!is)
+				throw std::runtime_error("failed to open " + OPTIONS["capacity"].as<std::string>());
+			exp.set_capacity(is);
+		}
+		if (OPTIONS.count("min-utilization") > 0)
+			exp.set_min_utilization(OPTIONS["min-utilization"].as<double>());
+	}
+	catch (std::runtime_error& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return 1;
 	}
 
-private:
-	const NetGraph& g_;
-};
-
-int main(int argc, char** argv)
-{
-	handle_options(argc, argv);
-
-	NetGraph topo;
 	try
 	{
-		read_topology(OPTIONS["server"].as<std::string>(), OPTIONS["port"].as<unsigned short>(), topo);
+		export_topology(OPTIONS["server"].as<std::string>(), OPTIONS["port"].as<unsigned short>(), exp, *writer);
 	}
 	catch (P4PProtocolHTTPError& e)
 	{
-		std::cout << "Portal returned HTTP status code: " << e.get_status() << std::endl;
+		std::cerr << "Portal returned HTTP status code: " << e.get_status() << std::endl;
+		return 1;
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
 		return 1;
 	}
-	boost::write_graphviz(std::cout, topo, NetGraphWriter(topo), NetGraphWriter(topo), NetGraphWriter(topo));
 
+	std::cerr << "Wrote " << exp.get_nodes() << " nodes and " << exp.get_links() << " links" << std::endl;
 	return 0;
 }
-
@@ -31,6 +31,8 @@
 
 #include <boost/program_options.hpp>
 #include <iostream>
+#include <string>
+#include <vector>
 
 namespace bpo = boost::program_options;
 
@@ -46,6 +48,22 @@ void handle_options(int argc, char** argv)
 			"server address")
 	("port",	bpo::value<unsigned short>()->default_value(6671),
 			"server port")
+	("format",	bpo::value<std::string>()->default_value("dot"),
+			"output format: dot or graphml")
+	("output",	bpo::value<std::string>()->default_value("-"),
+			"output file ('-' for standard output)")
+	("view",	bpo::value<std::string>(),
+			"view whose PIDs are drawn around their nodes")
+	("pid",		bpo::value<std::vector<std::string> >()->composing(),
+			"only write nodes of this PID of the view (may be repeated)")
+	("pdistances",	bpo::bool_switch()->default_value(false),
+			"write pDistances between the PIDs of the view")
+	("traffic",	bpo::value<std::string>(),
+			"file of link traffic, as 'link value' lines")
+	("capacity",	bpo::value<std::string>(),
+			"file of link capacities, as 'link value' lines")
+	("min-utilization",	bpo::value<double>(),
+			"only write links whose traffic/capacity is at least this")
 	;
 
 	try
@@ -69,4 +87,10 @@ void handle_options(int argc, char** argv)
 		std::cerr << AVAILABLE_OPTIONS << std::endl;
 		exit(0);
 	}
+
+	if ((OPTIONS.count("pid") > 0 || OPTIONS["pdistances"].as<bool>()) && OPTIONS.count("view") == 0)
+	{
+		std::cerr << "Error: --pid and --pdistances require --view" << std::endl;
+		exit(1);
+	}
 }
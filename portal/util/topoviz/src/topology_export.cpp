@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#include "topology_export.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <limits>
+#include <stdexcept>
+#include <boost/lexical_cast.hpp>
+
+using namespace p4p::protocol::portal;
+
+static const double UNKNOWN = std::numeric_limits<double>::quiet_NaN();
+
+TopologyExport::TopologyExport(GraphWriter& writer)
+	: writer_(writer),
+	  min_utilization_(UNKNOWN),
+	  nodes_(0),
+	  links_(0)
+{
+}
+
+void TopologyExport::read_link_values(std::istream& is, LinkValueMap& values)
+{
+	std::string line;
+	unsigned int line_num = 0;
+	while (std::getline(is, line))
+	{
+		++line_num;
+
+		std::string::size_type start = line.find_first_not_of(" \t\r");
+		if (start == std::string::npos || line[start] == '#')
+			continue;
+
+		std::string::size_type sep = line.find_first_of(" \t,", start);
+		std::string::size_type value_start = sep == std::string::npos ? sep : line.find_first_not_of(" \t,", sep);
+		if (value_start == std::string::npos)
+			throw std::runtime_error("missing value on line " + boost::lexical_cast<std::string>(line_num));
+
+		const char* value_str = line.c_str() + value_start;
+		char* value_end;
+		double value = strtod(value_str, &value_end);
+		if (value_end == value_str || value < 0
+		    || line.find_first_not_of(" \t\r", value_end - line.c_str()) != std::string::npos)
+			throw std::runtime_error("invalid value on line " + boost::lexical_cast<std::string>(line_num));
+
+		values[line.substr(start, sep - start)] += value;
+	}
+}
+
+void TopologyExport::add_pid_node(const std::string& pid, const std::string& node)
+{
+	std::map<std::string, unsigned int>::const_iterator itr = pid_index_.find(pid);
+	if (itr == pid_index_.end())
+	{
+		itr = pid_index_.insert(std::make_pair(pid, (unsigned int)pid_names_.size())).first;
+		pid_names_.push_back(pid);
+	}
+	node_pids_[node] = itr->second;
+}
+
+void TopologyExport::write_pids()
+{
+	/* Group the nodes by PID without copying their names */
+	std::vector<std::vector<const std::string*> > members(pid_names_.size());
+	for (std::map<std::string, unsigned int>::const_iterator itr = node_pids_.begin(); itr != node_pids_.end(); ++itr)
+		members[itr->second].push_back(&itr->first);
+
+	for (unsigned int i = 0; i < pid_names_.size(); ++i)
+	{
+		writer_.begin_pid(pid_names_[i]);
+		for (unsigned int j = 0; j < members[i].size(); ++j)
+			writer_.pid_node(*members[i][j]);
+		writer_.end_pid();
+	}
+}
+
+bool TopologyExport::is_kept(const std::string& node) const
+{
+	if (selected_pids_.empty())
+		return true;
+
+	std::map<std::string, unsigned int>::const_iterator itr = node_pids_.find(node);
+	return itr != node_pids_.end() && selected_pids_.count(pid_names_[itr->second]) > 0;
+}
+
+double TopologyExport::find_value(const LinkValueMap& values, const std::string& link)
+{
+	LinkValueMap::const_iterator itr = values.find(link);
+	return itr != values.end() ? itr->second : UNKNOWN;
+}
+
+void TopologyExport::add(const NetNode& node)
+{
+	if (!is_kept(node.name))
+		return;
+
+	std::map<std::string, unsigned int>::const_iterator itr = node_pids_.find(node.name);
+	writer_.node(node.name, node.external, itr != node_pids_.end() ? pid_names_[itr->second] : std::string());
+	++nodes_;
+}
+
+void TopologyExport::add(const NamedNetLink& link)
+{
+	if (!is_kept(link.link.src) || !is_kept(link.link.dst))
+		return;
+
+	double traffic = find_value(traffic_, link.name);
+	double capacity = find_value(capacity_, link.name);
+
+	/* Links whose utilization is not known never pass the threshold */
+	if (!isnan(min_utilization_)
+	    && (isnan(traffic) || isnan(capacity) || capacity <= 0 || traffic / capacity < min_utilization_))
+		return;
+
+	writer_.link(link.name, link.link.src, link.link.dst, traffic, capacity);
+	++links_;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2008,2009, Yale Laboratory of Networked Systems
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice,
+ *       this list of conditions and the following disclaimer in the documentation
+ *       and/or other materials provided with the distribution.
+ *     * Neither the name of Yale University nor the names of its contributors may
+ *       be used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#ifndef TOPOLOGY_EXPORT_H
+#define TOPOLOGY_EXPORT_H
+
+#include <istream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <p4p/pid.h>
+#include <p4p/protocol-portal/admin_types.h>
+#include "graph_writer.h"
+
+/*
+ * Passes the topology to a GraphWriter as it is read from the portal,
+ * leaving out what the filters exclude. Only the PID of each node and
+ * the per-link overlay values are kept, never the graph itself.
+ */
+class TopologyExport
+{
+public:
+	/* Output iterator handing each record read to the export */
+	template <class Record>
+	class Inserter : public std::iterator<std::output_iterator_tag, void, void, void, void>
+	{
+	public:
+		Inserter(TopologyExport& exp) : exp_(&exp) {}
+		Inserter& operator=(const Record& record)	{ exp_->add(record); return *this; }
+		Inserter& operator*()				{ return *this; }
+		Inserter& operator++()				{ return *this; }
+		Inserter& operator++(int)			{ return *this; }
+	private:
+		TopologyExport* exp_;
+	};
+
+	TopologyExport(GraphWriter& writer);
+
+	/*
+	 * Read per-link values: one record per line, a link name and a
+	 * number separated by a comma or whitespace (the text format of
+	 * the portal's traffic input). Blank lines and lines starting with
+	 * '#' are skipped; values for the same link are added up. Throws
+	 * std::runtime_error on a malformed line.
+	 */
+	static void read_link_values(std::istream& is, std::map<std::string, double>& values);
+
+	void set_traffic(std::istream& is)			{ read_link_values(is, traffic_); }
+	void set_capacity(std::istream& is)			{ read_link_values(is, capacity_); }
+
+	/* Only write links at least this utilized */
+	void set_min_utilization(double value)			{ min_utilization_ = value; }
+
+	/* Only write nodes of these PIDs (and the links between them) */
+	void select_pid(const std::string& pid)			{ selected_pids_.insert(pid); }
+	bool is_selected(const std::string& pid) const		{ return selected_pids_.empty() || selected_pids_.count(pid) > 0; }
+
+	/* Record that a node is aggregated into a PID; call before the nodes are added */
+	void add_pid_node(const std::string& pid, const std::string& node);
+
+	/* Write each PID with its nodes, in the order they were recorded */
+	void write_pids();
+
+	void add(const p4p::protocol::portal::NetNode& node);
+	void add(const p4p::protocol::portal::NamedNetLink& link);
+
+	Inserter<p4p::protocol::portal::NetNode> node_inserter()		{ return Inserter<p4p::protocol::portal::NetNode>(*this); }
+	Inserter<p4p::protocol::portal::NamedNetLink> link_inserter()	{ return Inserter<p4p::protocol::portal::NamedNetLink>(*this); }
+
+	unsigned long long get_nodes() const			{ return nodes_; }
+	unsigned long long get_links() const			{ return links_; }
+
+private:
+	typedef std::map<std::string, double> LinkValueMap;
+
+	/* Whether a node passes the PID filter */
+	bool is_kept(const std::string& node) const;
+
+	static double find_value(const LinkValueMap& values, const std::string& link);
+
+	GraphWriter& writer_;
+
+	std::set<std::string> selected_pids_;
+
+	/* PID of each aggregated node, as an index into pid_names_ */
+	std::vector<std::string> pid_names_;
+	std::map<std::string, unsigned int> pid_index_;
+	std::map<std::string, unsigned int> node_pids_;
+
+	LinkValueMap traffic_;
+	LinkValueMap capacity_;
+	double min_utilization_;
+
+	unsigned long long nodes_;
+	unsigned long long links_;
+};
+
+#endif